@@ -93,6 +93,19 @@ BOOLEAN  gDispatcherRunning = FALSE;
 //
 BOOLEAN  gRequestDispatch = FALSE;
 
+//
+// Address ranges of the loaded images, sorted by image base. The table is built once at
+// ready to lock, after which no image is loaded or unloaded, and is never changed afterwards.
+//
+typedef struct {
+  EFI_PHYSICAL_ADDRESS    ImageBase;
+  UINT64                  ImageSize;
+  EFI_GUID                FileName;
+} MM_LOADED_IMAGE_RANGE;
+
+MM_LOADED_IMAGE_RANGE  *mLoadedImageTable     = NULL;
+UINTN                  mLoadedImageTableCount = 0;
+
 /**
   Loads an EFI image into SMRAM.
 
@@ -941,3 +954,130 @@ FindFileNameFromDiscoveredList (
 Exit:
   return Status;
 }
+
+/**
+  Build the sorted table of loaded image ranges used by FindLoadedImageByAddress.
+
+  Should be called once all drivers have been dispatched, the table is not updated afterwards.
+
+  @retval EFI_SUCCESS             The table is built.
+  @retval EFI_ALREADY_STARTED     The table was built before.
+  @retval EFI_OUT_OF_RESOURCES    Failed to allocate the table.
+
+**/
+EFI_STATUS
+BuildLoadedImageTable (
+  VOID
+  )
+{
+  LIST_ENTRY             *Link;
+  EFI_MM_DRIVER_ENTRY    *DriverEntry;
+  MM_LOADED_IMAGE_RANGE  *Table;
+  MM_LOADED_IMAGE_RANGE  Entry;
+  UINTN                  Count;
+  UINTN                  Index;
+  EFI_STATUS             Status;
+
+  if (mLoadedImageTable != NULL) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  // One slot for the core itself
+  Count = 1;
+  for (Link = mDiscoveredList.ForwardLink; Link != &mDiscoveredList; Link = Link->ForwardLink) {
+    DriverEntry = CR (Link, EFI_MM_DRIVER_ENTRY, Link, EFI_MM_DRIVER_ENTRY_SIGNATURE);
+    if (DriverEntry->LoadedImage != NULL) {
+      Count++;
+    }
+  }
+
+  Status = MmAllocateSupervisorPool (EfiRuntimeServicesData, Count * sizeof (MM_LOADED_IMAGE_RANGE), (VOID **)&Table);
+  if (EFI_ERROR (Status)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Table[0].ImageBase = (EFI_PHYSICAL_ADDRESS)(UINTN)mMmCoreDriverEntry->LoadedImage->ImageBase;
+  Table[0].ImageSize = mMmCoreDriverEntry->LoadedImage->ImageSize;
+  CopyMem (&Table[0].FileName, &gEfiCallerIdGuid, sizeof (EFI_GUID));
+
+  Count = 1;
+  for (Link = mDiscoveredList.ForwardLink; Link != &mDiscoveredList; Link = Link->ForwardLink) {
+    DriverEntry = CR (Link, EFI_MM_DRIVER_ENTRY, Link, EFI_MM_DRIVER_ENTRY_SIGNATURE);
+    if (DriverEntry->LoadedImage == NULL) {
+      continue;
+    }
+
+    Entry.ImageBase = (EFI_PHYSICAL_ADDRESS)(UINTN)DriverEntry->LoadedImage->ImageBase;
+    Entry.ImageSize = DriverEntry->LoadedImage->ImageSize;
+    CopyMem (&Entry.FileName, &DriverEntry->FileName, sizeof (EFI_GUID));
+
+    // Images are mostly loaded at increasing addresses, so insertion sort is close to linear
+    for (Index = Count; (Index > 0) && (Table[Index - 1].ImageBase > Entry.ImageBase); Index--) {
+      CopyMem (&Table[Index], &Table[Index - 1], sizeof (MM_LOADED_IMAGE_RANGE));
+    }
+
+    CopyMem (&Table[Index], &Entry, sizeof (MM_LOADED_IMAGE_RANGE));
+    Count++;
+  }
+
+  mLoadedImageTableCount = Count;
+  mLoadedImageTable      = Table;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Look up the loaded image containing an address and its driver GUID.
+
+  @param  Address         The address of interest, e.g. a faulting instruction pointer.
+  @param  ImageBase       The pointer to hold the base of the image containing Address.
+  @param  Guid            The pointer to hold returned driver GUID.
+
+  @return EFI_SUCCESS             The image is found successfully.
+  @return EFI_INVALID_PARAMETER   Incoming ImageBase or Guid pointer is null.
+  @return EFI_NOT_READY           The loaded image table is not built yet.
+  @return EFI_NOT_FOUND           Address does not belong to any loaded image.
+
+**/
+EFI_STATUS
+FindLoadedImageByAddress (
+  IN  EFI_PHYSICAL_ADDRESS  Address,
+  OUT EFI_PHYSICAL_ADDRESS  *ImageBase,
+  OUT EFI_GUID              *Guid
+  )
+{
+  UINTN  Low;
+  UINTN  High;
+  UINTN  Middle;
+
+  if ((ImageBase == NULL) || (Guid == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mLoadedImageTable == NULL) {
+    return EFI_NOT_READY;
+  }
+
+  //
+  // Find the last image starting at or below Address.
+  //
+  Low  = 0;
+  High = mLoadedImageTableCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (mLoadedImageTable[Middle].ImageBase <= Address) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  if ((Low == 0) || (Address - mLoadedImageTable[Low - 1].ImageBase >= mLoadedImageTable[Low - 1].ImageSize)) {
+    return EFI_NOT_FOUND;
+  }
+
+  *ImageBase = mLoadedImageTable[Low - 1].ImageBase;
+  CopyMem (Guid, &mLoadedImageTable[Low - 1].FileName, sizeof (EFI_GUID));
+
+  return EFI_SUCCESS;
+}
@@ -18,6 +18,37 @@ MmCoreInitializeSmiHandlerProfile (
   VOID
   );
 
+//
+// Set when MmiManage should time the handlers it dispatches.
+//
+extern BOOLEAN  mSmiHandlerLatencyEnabled;
+
+/**
+  Allocate the per-CPU latency statistics of a MMI handler, so that recording
+  an invocation never allocates on the dispatch path.
+
+  @param MmiHandler      The MMI handler.
+**/
+VOID
+SmiHandlerProfileAllocateLatency (
+  IN MMI_HANDLER  *MmiHandler
+  );
+
+/**
+  Account one invocation of a MMI handler in the latency statistics of the
+  CPU that executed it.
+
+  @param MmiHandler      The MMI handler that was invoked.
+  @param CpuIndex        The index of the CPU that executed the handler.
+  @param Ticks           The number of TSC ticks the invocation took.
+**/
+VOID
+SmiHandlerProfileRecordLatency (
+  IN MMI_HANDLER  *MmiHandler,
+  IN UINTN        CpuIndex,
+  IN UINT64       Ticks
+  );
+
 /**
   This function is called by SyscallDispatcher to process user request on registering
   a child SMI handler from user space.
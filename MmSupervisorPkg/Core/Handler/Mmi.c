@@ -10,6 +10,8 @@
 #include "MmSupervisorCore.h"
 #include "PrivilegeMgmt/PrivilegeMgmt.h"
 #include "Mem/Mem.h"
+#include "Relocate/Relocate.h"
+#include "Handler.h"
 
 //
 // mMmiManageCallingDepth is used to track the depth of recursive calls of MmiManage.
@@ -42,6 +44,10 @@ RemoveMmiHandler (
 {
   ASSERT (MmiHandler->ToRemove);
   RemoveEntryList (&MmiHandler->Link);
+  if (MmiHandler->Latency != NULL) {
+    FreePool (MmiHandler->Latency);
+  }
+
   FreePool (MmiHandler);
 
   //
@@ -153,6 +159,8 @@ MmiManage (
   BOOLEAN      SupervisorPath;
   EFI_STATUS   Status;
   BOOLEAN      IsUserRange;
+  UINT64       StartTicks;
+  UINTN        CpuIndex;
 
   PERF_FUNCTION_BEGIN ();
 
@@ -200,11 +208,13 @@ MmiManage (
     }
   }
 
-  Head = &MmiEntry->MmiHandlers;
+  Head     = &MmiEntry->MmiHandlers;
+  CpuIndex = mSmiHandlerLatencyEnabled ? GetCpuIndex () : 0;
 
   for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
     MmiHandler = CR (Link, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
 
+    StartTicks = mSmiHandlerLatencyEnabled ? AsmReadTsc () : 0;
     if (!SupervisorPath && !MmiHandler->IsSupervisor) {
       Status = InvokeDemotedMmHandler (
                  MmiHandler,
@@ -224,6 +234,10 @@ MmiManage (
       continue;
     }
 
+    if (mSmiHandlerLatencyEnabled) {
+      SmiHandlerProfileRecordLatency (MmiHandler, CpuIndex, AsmReadTsc () - StartTicks);
+    }
+
     switch (Status) {
       case EFI_INTERRUPT_PENDING:
         //
@@ -399,6 +413,9 @@ CoreMmiHandlerRegister (
   MmiHandler->Handler      = Handler;
   MmiHandler->ToRemove     = FALSE;
   MmiHandler->IsSupervisor = IsSupervisorHandler;
+  if (mSmiHandlerLatencyEnabled) {
+    SmiHandlerProfileAllocateLatency (MmiHandler);
+  }
 
   if (HandlerType == NULL) {
     //
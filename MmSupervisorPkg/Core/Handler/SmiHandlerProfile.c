@@ -24,9 +24,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/SmmEndOfDxe.h>
 
 #include <Guid/SmiHandlerProfile.h>
+#include <Guid/SmiHandlerProfileLatency.h>
 
 #include "MmSupervisorCore.h"
 #include "Mem/Mem.h"
+#include "Relocate/Relocate.h"
+#include "Handler.h"
 
 #define GET_OCCUPIED_SIZE(ActualSize, Alignment) \
   ((ActualSize) + (((Alignment) - ((ActualSize) & ((Alignment) - 1))) & ((Alignment) - 1)))
@@ -173,6 +176,8 @@ GLOBAL_REMOVE_IF_UNREFERENCED UINTN  mSmmHardwareSmiDatabaseSize;
 
 GLOBAL_REMOVE_IF_UNREFERENCED BOOLEAN  mSmiHandlerProfileRecordingStatus;
 
+BOOLEAN  mSmiHandlerLatencyEnabled = FALSE;
+
 GLOBAL_REMOVE_IF_UNREFERENCED USER_HANDLER_REG_STRUCT  UserHandlerRegHolder;
 
 GLOBAL_REMOVE_IF_UNREFERENCED SMI_HANDLER_PROFILE_PROTOCOL  mSmiHandlerProfile = {
@@ -240,9 +245,38 @@ AddImageStruct (
   mImageStructCount++;
 }
 
+/**
+  Sort the image structures by image base, so that they can be binary searched.
+  The ImageRef of each image is kept as assigned by AddImageStruct.
+**/
+VOID
+SortImageStruct (
+  VOID
+  )
+{
+  UINTN         Index;
+  UINTN         Position;
+  IMAGE_STRUCT  ImageStruct;
+
+  for (Index = 1; Index < mImageStructCount; Index++) {
+    CopyMem (&ImageStruct, &mImageStruct[Index], sizeof (IMAGE_STRUCT));
+    for (Position = Index; Position > 0; Position--) {
+      if (mImageStruct[Position - 1].ImageBase <= ImageStruct.ImageBase) {
+        break;
+      }
+
+      CopyMem (&mImageStruct[Position], &mImageStruct[Position - 1], sizeof (IMAGE_STRUCT));
+    }
+
+    CopyMem (&mImageStruct[Position], &ImageStruct, sizeof (IMAGE_STRUCT));
+  }
+}
+
 /**
   return an image structure based upon image address.
 
+  The image structures must have been sorted by SortImageStruct.
+
   @param  Address  image address
 
   @return image structure
@@ -252,16 +286,30 @@ AddressToImageStruct (
   IN UINTN  Address
   )
 {
-  UINTN  Index;
+  UINTN  Low;
+  UINTN  High;
+  UINTN  Middle;
 
-  for (Index = 0; Index < mImageStructCount; Index++) {
-    if ((Address >= mImageStruct[Index].ImageBase) &&
-        (Address < mImageStruct[Index].ImageBase + mImageStruct[Index].ImageSize))
-    {
-      return &mImageStruct[Index];
+  //
+  // Find the last image whose base is not above Address.
+  //
+  Low  = 0;
+  High = mImageStructCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (mImageStruct[Middle].ImageBase <= Address) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
     }
   }
 
+  if ((Low > 0) &&
+      (Address < mImageStruct[Low - 1].ImageBase + mImageStruct[Low - 1].ImageSize))
+  {
+    return &mImageStruct[Low - 1];
+  }
+
   return NULL;
 }
 
@@ -455,6 +503,8 @@ GetSmmLoadedImage (
     AddImageStruct (RealImageBase, LoadedImage->ImageSize, EntryPoint, &Guid, PdbString);
   }
 
+  SortImageStruct ();
+
 Done:
   FreePool (HandleBuffer);
   return;
@@ -1088,6 +1138,219 @@ Done:
   mSmiHandlerProfileRecordingStatus = SmiHandlerProfileRecordingStatus;
 }
 
+/**
+  Allocate the per-CPU latency statistics of a MMI handler, so that recording
+  an invocation never allocates on the dispatch path.
+
+  @param MmiHandler      The MMI handler.
+**/
+VOID
+SmiHandlerProfileAllocateLatency (
+  IN MMI_HANDLER  *MmiHandler
+  )
+{
+  if ((MmiHandler->Latency != NULL) || (mMaxNumberOfCpus == 0)) {
+    return;
+  }
+
+  MmiHandler->Latency = AllocateZeroPool (mMaxNumberOfCpus * sizeof (MMI_HANDLER_LATENCY));
+  if (MmiHandler->Latency == NULL) {
+    DEBUG ((DEBUG_WARN, "%a - Failed to allocate latency statistics of handler 0x%p\n", __func__, MmiHandler->Handler));
+  }
+}
+
+/**
+  Allocate the per-CPU latency statistics of the handlers on a SMI entry list.
+
+  @param SmiEntryList  The SMI entry list.
+**/
+VOID
+AllocateSmiHandlerLatencyOnSmiEntryList (
+  IN LIST_ENTRY  *SmiEntryList
+  )
+{
+  LIST_ENTRY   *ListEntry;
+  LIST_ENTRY   *Link;
+  MMI_ENTRY    *SmiEntry;
+  MMI_HANDLER  *SmiHandler;
+
+  for (ListEntry = SmiEntryList->ForwardLink; ListEntry != SmiEntryList; ListEntry = ListEntry->ForwardLink) {
+    SmiEntry = CR (ListEntry, MMI_ENTRY, AllEntries, MMI_ENTRY_SIGNATURE);
+    for (Link = SmiEntry->MmiHandlers.ForwardLink; Link != &SmiEntry->MmiHandlers; Link = Link->ForwardLink) {
+      SmiHandler = CR (Link, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
+      SmiHandlerProfileAllocateLatency (SmiHandler);
+    }
+  }
+}
+
+/**
+  Account one invocation of a MMI handler in the latency statistics of the
+  CPU that executed it.
+
+  The statistics are allocated when the handler is registered, or when latency
+  profiling is enabled, so a handler without them is not accounted.
+
+  @param MmiHandler      The MMI handler that was invoked.
+  @param CpuIndex        The index of the CPU that executed the handler.
+  @param Ticks           The number of TSC ticks the invocation took.
+**/
+VOID
+SmiHandlerProfileRecordLatency (
+  IN MMI_HANDLER  *MmiHandler,
+  IN UINTN        CpuIndex,
+  IN UINT64       Ticks
+  )
+{
+  MMI_HANDLER_LATENCY  *Latency;
+  INTN                 Bucket;
+
+  if ((MmiHandler->Latency == NULL) || (CpuIndex >= mMaxNumberOfCpus)) {
+    return;
+  }
+
+  Latency = &MmiHandler->Latency[CpuIndex];
+  Latency->InvocationCount++;
+  Latency->TotalTicks += Ticks;
+  if (Ticks > Latency->MaxTicks) {
+    Latency->MaxTicks = Ticks;
+  }
+
+  Bucket = HighBitSet64 (Ticks);
+  if (Bucket < 0) {
+    Bucket = 0;
+  } else if (Bucket >= SMI_HANDLER_LATENCY_BUCKET_COUNT) {
+    Bucket = SMI_HANDLER_LATENCY_BUCKET_COUNT - 1;
+  }
+
+  Latency->Histogram[Bucket]++;
+}
+
+/**
+  Merge the per-CPU latency statistics of a MMI handler into one record.
+
+  @param MmiHandler  The MMI handler.
+  @param Record      The record to fill.
+**/
+VOID
+MergeSmiHandlerLatency (
+  IN  MMI_HANDLER                 *MmiHandler,
+  OUT SMI_HANDLER_LATENCY_RECORD  *Record
+  )
+{
+  UINTN  CpuIndex;
+  UINTN  Bucket;
+
+  ZeroMem (Record, sizeof (*Record));
+  CopyGuid (&Record->HandlerType, &MmiHandler->MmiEntry->HandlerType);
+  Record->Handler       = (UINTN)MmiHandler->Handler;
+  Record->CallerAddress = MmiHandler->CallerAddr;
+  Record->IsSupervisor  = MmiHandler->IsSupervisor;
+
+  if (MmiHandler->Latency == NULL) {
+    return;
+  }
+
+  for (CpuIndex = 0; CpuIndex < mMaxNumberOfCpus; CpuIndex++) {
+    Record->InvocationCount += MmiHandler->Latency[CpuIndex].InvocationCount;
+    Record->TotalTicks      += MmiHandler->Latency[CpuIndex].TotalTicks;
+    if (MmiHandler->Latency[CpuIndex].MaxTicks > Record->MaxTicks) {
+      Record->MaxTicks = MmiHandler->Latency[CpuIndex].MaxTicks;
+    }
+
+    for (Bucket = 0; Bucket < SMI_HANDLER_LATENCY_BUCKET_COUNT; Bucket++) {
+      Record->Histogram[Bucket] += MmiHandler->Latency[CpuIndex].Histogram[Bucket];
+    }
+  }
+}
+
+/**
+  Copy the latency records of the handlers on a SMI entry list.
+
+  @param SmiEntryList  The SMI entry list.
+  @param Parameter     The local copy of the request. DataBuffer and DataSize describe
+                       the output buffer, RecordOffset is the first record to copy.
+  @param RecordIndex   On input, index of the first handler on the list.
+                       On output, index past the last handler on the list.
+  @param CopiedSize    On input and output, size in bytes copied to the output buffer.
+**/
+VOID
+GetSmiHandlerLatencyOnSmiEntryList (
+  IN     LIST_ENTRY                                           *SmiEntryList,
+  IN     SMI_HANDLER_PROFILE_PARAMETER_GET_LATENCY_BY_OFFSET  *Parameter,
+  IN OUT UINT64                                               *RecordIndex,
+  IN OUT UINT64                                               *CopiedSize
+  )
+{
+  LIST_ENTRY                  *ListEntry;
+  LIST_ENTRY                  *Link;
+  MMI_ENTRY                   *SmiEntry;
+  MMI_HANDLER                 *SmiHandler;
+  SMI_HANDLER_LATENCY_RECORD  Record;
+
+  for (ListEntry = SmiEntryList->ForwardLink; ListEntry != SmiEntryList; ListEntry = ListEntry->ForwardLink) {
+    SmiEntry = CR (ListEntry, MMI_ENTRY, AllEntries, MMI_ENTRY_SIGNATURE);
+    for (Link = SmiEntry->MmiHandlers.ForwardLink; Link != &SmiEntry->MmiHandlers; Link = Link->ForwardLink) {
+      SmiHandler = CR (Link, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
+      if ((*RecordIndex >= Parameter->RecordOffset) &&
+          (Parameter->DataSize - *CopiedSize >= sizeof (Record)))
+      {
+        MergeSmiHandlerLatency (SmiHandler, &Record);
+        CopyMem ((UINT8 *)(UINTN)Parameter->DataBuffer + *CopiedSize, &Record, sizeof (Record));
+        *CopiedSize += sizeof (Record);
+      }
+
+      (*RecordIndex)++;
+    }
+  }
+}
+
+/**
+  SMI handler profile handler to get handler latency records by offset.
+
+  @param SmiHandlerProfileParameterGetLatencyByOffset   The parameter of SMI handler profile get latency by offset.
+
+**/
+VOID
+SmiHandlerProfileHandlerGetLatencyByOffset (
+  IN SMI_HANDLER_PROFILE_PARAMETER_GET_LATENCY_BY_OFFSET  *SmiHandlerProfileParameterGetLatencyByOffset
+  )
+{
+  SMI_HANDLER_PROFILE_PARAMETER_GET_LATENCY_BY_OFFSET  SmiHandlerProfileGetLatencyByOffset;
+  UINT64                                               RecordIndex;
+  UINT64                                               CopiedSize;
+
+  CopyMem (&SmiHandlerProfileGetLatencyByOffset, SmiHandlerProfileParameterGetLatencyByOffset, sizeof (SmiHandlerProfileGetLatencyByOffset));
+
+  //
+  // Sanity check
+  //
+  if (!MmIsBufferOutsideMmValid ((UINTN)SmiHandlerProfileGetLatencyByOffset.DataBuffer, (UINTN)SmiHandlerProfileGetLatencyByOffset.DataSize)) {
+    DEBUG ((DEBUG_ERROR, "SmiHandlerProfileHandlerGetLatencyByOffset: SMI handler profile get latency in SMRAM or overflow!\n"));
+    SmiHandlerProfileParameterGetLatencyByOffset->Header.ReturnStatus = (UINT64)(INT64)(INTN)EFI_ACCESS_DENIED;
+    return;
+  }
+
+  //
+  // Root handlers first, then GUID handlers. Hardware SMI handlers are dispatched by
+  // their child dispatcher rather than MmiManage, so there is nothing to report for them.
+  //
+  RecordIndex = 0;
+  CopiedSize  = 0;
+  GetSmiHandlerLatencyOnSmiEntryList (mSmmCoreRootSmiEntryList, &SmiHandlerProfileGetLatencyByOffset, &RecordIndex, &CopiedSize);
+  GetSmiHandlerLatencyOnSmiEntryList (mSmmCoreSmiEntryList, &SmiHandlerProfileGetLatencyByOffset, &RecordIndex, &CopiedSize);
+
+  SmiHandlerProfileGetLatencyByOffset.RecordCount = RecordIndex;
+  SmiHandlerProfileGetLatencyByOffset.DataSize    = CopiedSize;
+  if (SmiHandlerProfileGetLatencyByOffset.RecordOffset > RecordIndex) {
+    SmiHandlerProfileGetLatencyByOffset.RecordOffset = RecordIndex;
+  }
+
+  SmiHandlerProfileGetLatencyByOffset.RecordOffset += CopiedSize / sizeof (SMI_HANDLER_LATENCY_RECORD);
+
+  CopyMem (SmiHandlerProfileParameterGetLatencyByOffset, &SmiHandlerProfileGetLatencyByOffset, sizeof (SmiHandlerProfileGetLatencyByOffset));
+  SmiHandlerProfileParameterGetLatencyByOffset->Header.ReturnStatus = 0;
+}
+
 /**
   Dispatch function for a Software SMI handler.
 
@@ -1162,6 +1425,15 @@ SmiHandlerProfileHandler (
 
       SmiHandlerProfileHandlerGetDataByOffset ((SMI_HANDLER_PROFILE_PARAMETER_GET_DATA_BY_OFFSET *)(UINTN)CommBuffer);
       break;
+    case SMI_HANDLER_PROFILE_COMMAND_GET_LATENCY_BY_OFFSET:
+      DEBUG ((DEBUG_ERROR, "SmiHandlerProfileHandlerGetLatencyByOffset\n"));
+      if (TempCommBufferSize != sizeof (SMI_HANDLER_PROFILE_PARAMETER_GET_LATENCY_BY_OFFSET)) {
+        DEBUG ((DEBUG_ERROR, "SmiHandlerProfileHandler: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+
+      SmiHandlerProfileHandlerGetLatencyByOffset ((SMI_HANDLER_PROFILE_PARAMETER_GET_LATENCY_BY_OFFSET *)(UINTN)CommBuffer);
+      break;
     default:
       break;
   }
@@ -1610,6 +1882,10 @@ SmiHandlerProfileUnregisterHandler (
     FreePool (SmiHandler->Context);
   }
 
+  if (SmiHandler->Latency != NULL) {
+    FreePool (SmiHandler->Latency);
+  }
+
   FreePool (SmiHandler);
 
   if (IsListEmpty (&SmiEntry->MmiHandlers)) {
@@ -1732,6 +2008,13 @@ MmCoreInitializeSmiHandlerProfile (
   if ((PcdGet8 (PcdSmiHandlerProfilePropertyMask) & 0x1) != 0) {
     InsertTailList (&mRootSmiEntryList, &mRootMmiEntry.AllEntries);
 
+    //
+    // Handlers registered from here on get their latency statistics at registration.
+    //
+    AllocateSmiHandlerLatencyOnSmiEntryList (mSmmCoreRootSmiEntryList);
+    AllocateSmiHandlerLatencyOnSmiEntryList (mSmmCoreSmiEntryList);
+    mSmiHandlerLatencyEnabled = TRUE;
+
     Handle = NULL;
     Status = gMmCoreMmst.MmInstallProtocolInterface (
                            &Handle,
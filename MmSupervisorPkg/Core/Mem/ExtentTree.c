@@ -0,0 +1,559 @@
+/** @file
+  Extent tree used to track page ranges in the MM core.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+
+#include "ExtentTree.h"
+
+/**
+  Get the height of a subtree.
+
+  @param[in] Node  Root of the subtree, may be NULL.
+
+  @return The height of the subtree.
+
+**/
+STATIC
+UINTN
+NodeHeight (
+  IN MM_EXTENT_NODE  *Node
+  )
+{
+  return (Node == NULL) ? 0 : Node->Height;
+}
+
+/**
+  Get the largest range held in a subtree.
+
+  @param[in] Node  Root of the subtree, may be NULL.
+
+  @return The largest NumberOfPages of the subtree.
+
+**/
+STATIC
+UINTN
+NodeMaxPages (
+  IN MM_EXTENT_NODE  *Node
+  )
+{
+  return (Node == NULL) ? 0 : Node->MaxPages;
+}
+
+/**
+  Recompute the height and the largest range of a node from its children.
+
+  @param[in, out] Node  The node to refresh.
+
+**/
+STATIC
+VOID
+RefreshNode (
+  IN OUT MM_EXTENT_NODE  *Node
+  )
+{
+  Node->Height   = MAX (NodeHeight (Node->Left), NodeHeight (Node->Right)) + 1;
+  Node->MaxPages = MAX (Node->NumberOfPages, MAX (NodeMaxPages (Node->Left), NodeMaxPages (Node->Right)));
+}
+
+/**
+  Make the parent of a node, or the tree, point to another node instead.
+
+  @param[in, out] Tree     The tree holding OldNode.
+  @param[in]      OldNode  The node being replaced.
+  @param[in]      NewNode  The node to take the place of OldNode, may be NULL.
+
+**/
+STATIC
+VOID
+ReplaceChild (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN     MM_EXTENT_NODE  *OldNode,
+  IN     MM_EXTENT_NODE  *NewNode
+  )
+{
+  if (OldNode->Parent == NULL) {
+    Tree->Root = NewNode;
+  } else if (OldNode->Parent->Left == OldNode) {
+    OldNode->Parent->Left = NewNode;
+  } else {
+    OldNode->Parent->Right = NewNode;
+  }
+}
+
+/**
+  Rotate a subtree to the left.
+
+  @param[in, out] Tree  The tree holding the subtree.
+  @param[in, out] Node  Root of the subtree, must have a right child.
+
+  @return The new root of the subtree.
+
+**/
+STATIC
+MM_EXTENT_NODE *
+RotateLeft (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN OUT MM_EXTENT_NODE  *Node
+  )
+{
+  MM_EXTENT_NODE  *Pivot;
+
+  Pivot       = Node->Right;
+  Node->Right = Pivot->Left;
+  if (Pivot->Left != NULL) {
+    Pivot->Left->Parent = Node;
+  }
+
+  ReplaceChild (Tree, Node, Pivot);
+  Pivot->Parent = Node->Parent;
+  Pivot->Left   = Node;
+  Node->Parent  = Pivot;
+
+  RefreshNode (Node);
+  RefreshNode (Pivot);
+  return Pivot;
+}
+
+/**
+  Rotate a subtree to the right.
+
+  @param[in, out] Tree  The tree holding the subtree.
+  @param[in, out] Node  Root of the subtree, must have a left child.
+
+  @return The new root of the subtree.
+
+**/
+STATIC
+MM_EXTENT_NODE *
+RotateRight (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN OUT MM_EXTENT_NODE  *Node
+  )
+{
+  MM_EXTENT_NODE  *Pivot;
+
+  Pivot      = Node->Left;
+  Node->Left = Pivot->Right;
+  if (Pivot->Right != NULL) {
+    Pivot->Right->Parent = Node;
+  }
+
+  ReplaceChild (Tree, Node, Pivot);
+  Pivot->Parent = Node->Parent;
+  Pivot->Right  = Node;
+  Node->Parent  = Pivot;
+
+  RefreshNode (Node);
+  RefreshNode (Pivot);
+  return Pivot;
+}
+
+/**
+  Restore the balance and the cached data of every node from a node up to the root.
+
+  @param[in, out] Tree  The tree to rebalance.
+  @param[in, out] Node  The lowest node whose subtree changed, may be NULL.
+
+**/
+STATIC
+VOID
+Rebalance (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN OUT MM_EXTENT_NODE  *Node
+  )
+{
+  UINTN  LeftHeight;
+  UINTN  RightHeight;
+
+  while (Node != NULL) {
+    RefreshNode (Node);
+    LeftHeight  = NodeHeight (Node->Left);
+    RightHeight = NodeHeight (Node->Right);
+
+    if (LeftHeight > RightHeight + 1) {
+      if (NodeHeight (Node->Left->Left) < NodeHeight (Node->Left->Right)) {
+        RotateLeft (Tree, Node->Left);
+      }
+
+      Node = RotateRight (Tree, Node);
+    } else if (RightHeight > LeftHeight + 1) {
+      if (NodeHeight (Node->Right->Right) < NodeHeight (Node->Right->Left)) {
+        RotateRight (Tree, Node->Right);
+      }
+
+      Node = RotateLeft (Tree, Node);
+    }
+
+    Node = Node->Parent;
+  }
+}
+
+/**
+  Insert a node into an extent tree.
+
+  The caller initializes Start and NumberOfPages of the node. No node of the tree may
+  have the same Start.
+
+  @param[in, out] Tree  The tree to insert into.
+  @param[in, out] Node  The node to insert.
+
+**/
+VOID
+MmExtentTreeInsert (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN OUT MM_EXTENT_NODE  *Node
+  )
+{
+  MM_EXTENT_NODE  *Parent;
+  MM_EXTENT_NODE  **Link;
+
+  Parent = NULL;
+  Link   = &Tree->Root;
+  while (*Link != NULL) {
+    Parent = *Link;
+    ASSERT (Node->Start != Parent->Start);
+    Link = (Node->Start < Parent->Start) ? &Parent->Left : &Parent->Right;
+  }
+
+  Node->Left   = NULL;
+  Node->Right  = NULL;
+  Node->Parent = Parent;
+  *Link        = Node;
+  Tree->Count++;
+
+  Rebalance (Tree, Node);
+}
+
+/**
+  Remove a node from an extent tree.
+
+  @param[in, out] Tree  The tree holding the node.
+  @param[in, out] Node  The node to remove.
+
+**/
+VOID
+MmExtentTreeRemove (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN OUT MM_EXTENT_NODE  *Node
+  )
+{
+  MM_EXTENT_NODE  *Child;
+  MM_EXTENT_NODE  *Successor;
+  MM_EXTENT_NODE  *Changed;
+
+  if ((Node->Left != NULL) && (Node->Right != NULL)) {
+    //
+    // Move the successor, which has no left child, to the place of the node.
+    //
+    Successor = Node->Right;
+    while (Successor->Left != NULL) {
+      Successor = Successor->Left;
+    }
+
+    if (Successor->Parent != Node) {
+      Changed       = Successor->Parent;
+      Changed->Left = Successor->Right;
+      if (Successor->Right != NULL) {
+        Successor->Right->Parent = Changed;
+      }
+
+      Successor->Right    = Node->Right;
+      Node->Right->Parent = Successor;
+    } else {
+      Changed = Successor;
+    }
+
+    Successor->Left    = Node->Left;
+    Node->Left->Parent = Successor;
+    ReplaceChild (Tree, Node, Successor);
+    Successor->Parent = Node->Parent;
+  } else {
+    Child = (Node->Left != NULL) ? Node->Left : Node->Right;
+    ReplaceChild (Tree, Node, Child);
+    if (Child != NULL) {
+      Child->Parent = Node->Parent;
+    }
+
+    Changed = Node->Parent;
+  }
+
+  Node->Left   = NULL;
+  Node->Right  = NULL;
+  Node->Parent = NULL;
+  Tree->Count--;
+
+  Rebalance (Tree, Changed);
+}
+
+/**
+  Refresh the tree after the NumberOfPages or the Start of a node changed.
+
+  A new Start must keep the node between its predecessor and its successor.
+
+  @param[in, out] Tree  The tree holding the node.
+  @param[in, out] Node  The node that changed.
+
+**/
+VOID
+MmExtentTreeUpdate (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN OUT MM_EXTENT_NODE  *Node
+  )
+{
+  ASSERT ((MmExtentTreePrevious (Node) == NULL) || (MmExtentTreePrevious (Node)->Start < Node->Start));
+  ASSERT ((MmExtentTreeNext (Node) == NULL) || (MmExtentTreeNext (Node)->Start > Node->Start));
+
+  //
+  // Heights do not change, only the largest ranges on the way to the root.
+  //
+  while (Node != NULL) {
+    RefreshNode (Node);
+    Node = Node->Parent;
+  }
+}
+
+/**
+  Put a node at the place of another node of the tree.
+
+  The caller copies the Start and NumberOfPages of OldNode to NewNode beforehand. OldNode
+  is no longer part of the tree on return.
+
+  @param[in, out] Tree     The tree holding OldNode.
+  @param[in]      OldNode  The node to replace.
+  @param[out]     NewNode  The node to take the place of OldNode.
+
+**/
+VOID
+MmExtentTreeReplace (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN     MM_EXTENT_NODE  *OldNode,
+  OUT    MM_EXTENT_NODE  *NewNode
+  )
+{
+  ASSERT (NewNode->Start == OldNode->Start);
+  ASSERT (NewNode->NumberOfPages == OldNode->NumberOfPages);
+
+  ReplaceChild (Tree, OldNode, NewNode);
+  NewNode->Left     = OldNode->Left;
+  NewNode->Right    = OldNode->Right;
+  NewNode->Parent   = OldNode->Parent;
+  NewNode->Height   = OldNode->Height;
+  NewNode->MaxPages = OldNode->MaxPages;
+  if (NewNode->Left != NULL) {
+    NewNode->Left->Parent = NewNode;
+  }
+
+  if (NewNode->Right != NULL) {
+    NewNode->Right->Parent = NewNode;
+  }
+
+  OldNode->Left   = NULL;
+  OldNode->Right  = NULL;
+  OldNode->Parent = NULL;
+}
+
+/**
+  Get the node with the lowest Start.
+
+  @param[in] Tree  The tree to inspect.
+
+  @return The first node, or NULL if the tree is empty.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreeFirst (
+  IN MM_EXTENT_TREE  *Tree
+  )
+{
+  MM_EXTENT_NODE  *Node;
+
+  Node = Tree->Root;
+  if (Node != NULL) {
+    while (Node->Left != NULL) {
+      Node = Node->Left;
+    }
+  }
+
+  return Node;
+}
+
+/**
+  Get the node with the highest Start.
+
+  @param[in] Tree  The tree to inspect.
+
+  @return The last node, or NULL if the tree is empty.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreeLast (
+  IN MM_EXTENT_TREE  *Tree
+  )
+{
+  MM_EXTENT_NODE  *Node;
+
+  Node = Tree->Root;
+  if (Node != NULL) {
+    while (Node->Right != NULL) {
+      Node = Node->Right;
+    }
+  }
+
+  return Node;
+}
+
+/**
+  Get the node following a node in address order.
+
+  @param[in] Node  A node of the tree.
+
+  @return The next node, or NULL if Node is the last node.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreeNext (
+  IN MM_EXTENT_NODE  *Node
+  )
+{
+  if (Node->Right != NULL) {
+    Node = Node->Right;
+    while (Node->Left != NULL) {
+      Node = Node->Left;
+    }
+
+    return Node;
+  }
+
+  while ((Node->Parent != NULL) && (Node->Parent->Right == Node)) {
+    Node = Node->Parent;
+  }
+
+  return Node->Parent;
+}
+
+/**
+  Get the node preceding a node in address order.
+
+  @param[in] Node  A node of the tree.
+
+  @return The previous node, or NULL if Node is the first node.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreePrevious (
+  IN MM_EXTENT_NODE  *Node
+  )
+{
+  if (Node->Left != NULL) {
+    Node = Node->Left;
+    while (Node->Right != NULL) {
+      Node = Node->Right;
+    }
+
+    return Node;
+  }
+
+  while ((Node->Parent != NULL) && (Node->Parent->Left == Node)) {
+    Node = Node->Parent;
+  }
+
+  return Node->Parent;
+}
+
+/**
+  Get the node with the highest Start not above an address.
+
+  @param[in] Tree     The tree to search.
+  @param[in] Address  The address to look up.
+
+  @return The node, or NULL if every node starts above Address.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreeFloor (
+  IN MM_EXTENT_TREE  *Tree,
+  IN UINT64          Address
+  )
+{
+  MM_EXTENT_NODE  *Node;
+  MM_EXTENT_NODE  *Floor;
+
+  Floor = NULL;
+  Node  = Tree->Root;
+  while (Node != NULL) {
+    if (Node->Start <= Address) {
+      Floor = Node;
+      Node  = Node->Right;
+    } else {
+      Node = Node->Left;
+    }
+  }
+
+  return Floor;
+}
+
+/**
+  Get the node with the highest Start not above MaxStart that holds at least NumberOfPages.
+
+  @param[in] Tree           The tree to search.
+  @param[in] MaxStart       The highest acceptable Start.
+  @param[in] NumberOfPages  The minimal acceptable NumberOfPages.
+
+  @return The node, or NULL if no node qualifies.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreeFindHighestFit (
+  IN MM_EXTENT_TREE  *Tree,
+  IN UINT64          MaxStart,
+  IN UINTN           NumberOfPages
+  )
+{
+  MM_EXTENT_NODE  *Node;
+  MM_EXTENT_NODE  *Candidate;
+
+  //
+  // Walk down towards MaxStart. Whenever the walk turns right, the node and its left
+  // subtree all start at or below MaxStart, and anything found further down the walk
+  // starts higher. So only the last node where a fit exists needs to be remembered.
+  //
+  Candidate = NULL;
+  Node      = Tree->Root;
+  while ((Node != NULL) && (Node->MaxPages >= NumberOfPages)) {
+    if (Node->Start > MaxStart) {
+      Node = Node->Left;
+    } else {
+      if ((Node->NumberOfPages >= NumberOfPages) || (NodeMaxPages (Node->Left) >= NumberOfPages)) {
+        Candidate = Node;
+      }
+
+      Node = Node->Right;
+    }
+  }
+
+  if ((Candidate == NULL) || (Candidate->NumberOfPages >= NumberOfPages)) {
+    return Candidate;
+  }
+
+  //
+  // The fit is in the left subtree of the candidate, take its highest one.
+  //
+  Node = Candidate->Left;
+  while (TRUE) {
+    if (NodeMaxPages (Node->Right) >= NumberOfPages) {
+      Node = Node->Right;
+    } else if (Node->NumberOfPages >= NumberOfPages) {
+      return Node;
+    } else {
+      Node = Node->Left;
+    }
+  }
+}
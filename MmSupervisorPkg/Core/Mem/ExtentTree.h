@@ -0,0 +1,186 @@
+/** @file
+  Definitions of the extent tree used to track page ranges in the MM core.
+
+  The extent tree is an intrusive AVL tree of page ranges keyed by their base address.
+  Every node also records the largest range held in its subtree, so a free range of a
+  given size can be located without visiting every range. All lookups, insertions and
+  removals are O(log n) in the number of ranges held by the tree.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef MM_EXTENT_TREE_H_
+#define MM_EXTENT_TREE_H_
+
+typedef struct _MM_EXTENT_NODE MM_EXTENT_NODE;
+
+struct _MM_EXTENT_NODE {
+  MM_EXTENT_NODE    *Left;
+  MM_EXTENT_NODE    *Right;
+  MM_EXTENT_NODE    *Parent;
+  UINTN             Height;
+  //
+  // Base address of the range, the key of the tree.
+  //
+  UINT64            Start;
+  UINTN             NumberOfPages;
+  //
+  // Largest NumberOfPages in the subtree rooted at this node.
+  //
+  UINTN             MaxPages;
+};
+
+typedef struct {
+  MM_EXTENT_NODE    *Root;
+  UINTN             Count;
+} MM_EXTENT_TREE;
+
+/**
+  Insert a node into an extent tree.
+
+  The caller initializes Start and NumberOfPages of the node. No node of the tree may
+  have the same Start.
+
+  @param[in, out] Tree  The tree to insert into.
+  @param[in, out] Node  The node to insert.
+
+**/
+VOID
+MmExtentTreeInsert (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN OUT MM_EXTENT_NODE  *Node
+  );
+
+/**
+  Remove a node from an extent tree.
+
+  @param[in, out] Tree  The tree holding the node.
+  @param[in, out] Node  The node to remove.
+
+**/
+VOID
+MmExtentTreeRemove (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN OUT MM_EXTENT_NODE  *Node
+  );
+
+/**
+  Refresh the tree after the NumberOfPages or the Start of a node changed.
+
+  A new Start must keep the node between its predecessor and its successor.
+
+  @param[in, out] Tree  The tree holding the node.
+  @param[in, out] Node  The node that changed.
+
+**/
+VOID
+MmExtentTreeUpdate (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN OUT MM_EXTENT_NODE  *Node
+  );
+
+/**
+  Put a node at the place of another node of the tree.
+
+  The caller copies the Start and NumberOfPages of OldNode to NewNode beforehand. OldNode
+  is no longer part of the tree on return.
+
+  @param[in, out] Tree     The tree holding OldNode.
+  @param[in]      OldNode  The node to replace.
+  @param[out]     NewNode  The node to take the place of OldNode.
+
+**/
+VOID
+MmExtentTreeReplace (
+  IN OUT MM_EXTENT_TREE  *Tree,
+  IN     MM_EXTENT_NODE  *OldNode,
+  OUT    MM_EXTENT_NODE  *NewNode
+  );
+
+/**
+  Get the node with the lowest Start.
+
+  @param[in] Tree  The tree to inspect.
+
+  @return The first node, or NULL if the tree is empty.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreeFirst (
+  IN MM_EXTENT_TREE  *Tree
+  );
+
+/**
+  Get the node with the highest Start.
+
+  @param[in] Tree  The tree to inspect.
+
+  @return The last node, or NULL if the tree is empty.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreeLast (
+  IN MM_EXTENT_TREE  *Tree
+  );
+
+/**
+  Get the node following a node in address order.
+
+  @param[in] Node  A node of the tree.
+
+  @return The next node, or NULL if Node is the last node.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreeNext (
+  IN MM_EXTENT_NODE  *Node
+  );
+
+/**
+  Get the node preceding a node in address order.
+
+  @param[in] Node  A node of the tree.
+
+  @return The previous node, or NULL if Node is the first node.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreePrevious (
+  IN MM_EXTENT_NODE  *Node
+  );
+
+/**
+  Get the node with the highest Start not above an address.
+
+  @param[in] Tree     The tree to search.
+  @param[in] Address  The address to look up.
+
+  @return The node, or NULL if every node starts above Address.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreeFloor (
+  IN MM_EXTENT_TREE  *Tree,
+  IN UINT64          Address
+  );
+
+/**
+  Get the node with the highest Start not above MaxStart that holds at least NumberOfPages.
+
+  @param[in] Tree           The tree to search.
+  @param[in] MaxStart       The highest acceptable Start.
+  @param[in] NumberOfPages  The minimal acceptable NumberOfPages.
+
+  @return The node, or NULL if no node qualifies.
+
+**/
+MM_EXTENT_NODE *
+MmExtentTreeFindHighestFit (
+  IN MM_EXTENT_TREE  *Tree,
+  IN UINT64          MaxStart,
+  IN UINTN           NumberOfPages
+  );
+
+#endif // MM_EXTENT_TREE_H_
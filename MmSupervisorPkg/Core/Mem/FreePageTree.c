@@ -0,0 +1,226 @@
+/** @file
+  SMM free page tree management functions.
+
+  The free SMRAM ranges are kept in an extent tree whose nodes are stored at the start
+  of the free ranges themselves, so that looking up a range that fits a request, at or
+  below a given address, takes O(log n) in the number of free ranges.
+
+  Copyright (c) 2009 - 2018, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+
+#include "Mem.h"
+
+#define TRUNCATE_TO_PAGES(a)  ((a) >> EFI_PAGE_SHIFT)
+
+/**
+  Internal Function. Allocate n pages from given free page node.
+
+  @param  FreePageTree           The free page tree holding the node.
+  @param  Pages                  The free page node.
+  @param  NumberOfPages          Number of pages to be allocated.
+  @param  MaxAddress             Request to allocate memory below this address.
+
+  @return Memory address of allocated pages.
+
+**/
+UINTN
+InternalAllocPagesOnOneNode (
+  IN OUT MM_EXTENT_TREE  *FreePageTree,
+  IN OUT FREE_PAGE_NODE  *Pages,
+  IN     UINTN           NumberOfPages,
+  IN     UINTN           MaxAddress
+  )
+{
+  UINTN           Top;
+  UINTN           Bottom;
+  FREE_PAGE_NODE  *Node;
+
+  Top = TRUNCATE_TO_PAGES (MaxAddress + 1 - (UINTN)Pages);
+  if (Top > Pages->NumberOfPages) {
+    Top = Pages->NumberOfPages;
+  }
+
+  Bottom = Top - NumberOfPages;
+
+  if (Top < Pages->NumberOfPages) {
+    Node                = (FREE_PAGE_NODE *)((UINTN)Pages + EFI_PAGES_TO_SIZE (Top));
+    Node->Start         = (UINTN)Node;
+    Node->NumberOfPages = Pages->NumberOfPages - Top;
+    MmExtentTreeInsert (FreePageTree, Node);
+  }
+
+  if (Bottom > 0) {
+    Pages->NumberOfPages = Bottom;
+    MmExtentTreeUpdate (FreePageTree, Pages);
+  } else {
+    MmExtentTreeRemove (FreePageTree, Pages);
+  }
+
+  return (UINTN)Pages + EFI_PAGES_TO_SIZE (Bottom);
+}
+
+/**
+  Internal Function. Find the free page node with the highest address from which n pages
+  can be allocated below MaxAddress.
+
+  @param  FreePageTree           The free page tree.
+  @param  NumberOfPages          Number of pages to be allocated.
+  @param  MaxAddress             Request to allocate memory below this address.
+
+  @return The free page node, or NULL if no node can satisfy the request.
+
+**/
+FREE_PAGE_NODE *
+InternalFindMaxAddressNode (
+  IN MM_EXTENT_TREE  *FreePageTree,
+  IN UINTN           NumberOfPages,
+  IN UINTN           MaxAddress
+  )
+{
+  UINTN  MaxStart;
+
+  //
+  // A node qualifies when its first NumberOfPages pages end at or below MaxAddress.
+  //
+  if (NumberOfPages == 0) {
+    MaxStart = (MaxAddress == MAX_UINTN) ? MAX_UINTN : MaxAddress + 1;
+  } else if (EFI_PAGES_TO_SIZE (NumberOfPages) - 1 > MaxAddress) {
+    return NULL;
+  } else {
+    MaxStart = MaxAddress - (EFI_PAGES_TO_SIZE (NumberOfPages) - 1);
+  }
+
+  return MmExtentTreeFindHighestFit (FreePageTree, MaxStart, NumberOfPages);
+}
+
+/**
+  Internal Function. Allocate n pages from free page tree below MaxAddress.
+
+  @param  FreePageTree           The free page tree.
+  @param  NumberOfPages          Number of pages to be allocated.
+  @param  MaxAddress             Request to allocate memory below this address.
+
+  @return Memory address of allocated pages.
+
+**/
+UINTN
+InternalAllocMaxAddress (
+  IN OUT MM_EXTENT_TREE  *FreePageTree,
+  IN     UINTN           NumberOfPages,
+  IN     UINTN           MaxAddress
+  )
+{
+  FREE_PAGE_NODE  *Pages;
+
+  Pages = InternalFindMaxAddressNode (FreePageTree, NumberOfPages, MaxAddress);
+  if (Pages == NULL) {
+    return (UINTN)(-1);
+  }
+
+  return InternalAllocPagesOnOneNode (FreePageTree, Pages, NumberOfPages, MaxAddress);
+}
+
+/**
+  Internal Function. Allocate n pages from free page tree at given address.
+
+  @param  FreePageTree           The free page tree.
+  @param  NumberOfPages          Number of pages to be allocated.
+  @param  Address                Request to allocate new memory at this address.
+
+  @return Memory address of allocated pages. Any returned value that differs from
+          Address should be treated as EFI_NOT_FOUND.
+
+**/
+UINTN
+InternalAllocAddress (
+  IN OUT MM_EXTENT_TREE  *FreePageTree,
+  IN     UINTN           NumberOfPages,
+  IN     UINTN           Address
+  )
+{
+  UINTN           EndAddress;
+  FREE_PAGE_NODE  *Pages;
+
+  if ((Address & EFI_PAGE_MASK) != 0) {
+    return ~Address;
+  }
+
+  EndAddress = Address + EFI_PAGES_TO_SIZE (NumberOfPages);
+  Pages      = MmExtentTreeFloor (FreePageTree, Address);
+  if ((Pages == NULL) ||
+      ((UINTN)Pages + EFI_PAGES_TO_SIZE (Pages->NumberOfPages) < EndAddress))
+  {
+    return ~Address;
+  }
+
+  return InternalAllocPagesOnOneNode (FreePageTree, Pages, NumberOfPages, EndAddress);
+}
+
+/**
+  Internal Function. Return pages to the free page tree, merging them with the adjacent
+  free ranges.
+
+  @param  FreePageTree           The free page tree.
+  @param  Memory                 Base address of the pages.
+  @param  NumberOfPages          The number of pages.
+
+  @retval EFI_INVALID_PARAMETER  The pages overlap a free range.
+  @retval EFI_SUCCESS            The pages are free.
+
+**/
+EFI_STATUS
+InternalInsertFreePages (
+  IN OUT MM_EXTENT_TREE        *FreePageTree,
+  IN     EFI_PHYSICAL_ADDRESS  Memory,
+  IN     UINTN                 NumberOfPages
+  )
+{
+  FREE_PAGE_NODE  *Previous;
+  FREE_PAGE_NODE  *Next;
+  FREE_PAGE_NODE  *Pages;
+
+  Previous = MmExtentTreeFloor (FreePageTree, Memory);
+  Next     = (Previous != NULL) ? MmExtentTreeNext (Previous) : MmExtentTreeFirst (FreePageTree);
+
+  if ((Next != NULL) &&
+      (Memory + EFI_PAGES_TO_SIZE (NumberOfPages) > (UINTN)Next))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Previous != NULL) &&
+      ((UINTN)Previous + EFI_PAGES_TO_SIZE (Previous->NumberOfPages) > Memory))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Previous != NULL) &&
+      ((UINTN)Previous + EFI_PAGES_TO_SIZE (Previous->NumberOfPages) == Memory))
+  {
+    Pages                 = Previous;
+    Pages->NumberOfPages += NumberOfPages;
+  } else {
+    Pages                = (FREE_PAGE_NODE *)(UINTN)Memory;
+    Pages->Start         = (UINTN)Pages;
+    Pages->NumberOfPages = NumberOfPages;
+    MmExtentTreeInsert (FreePageTree, Pages);
+  }
+
+  if ((Next != NULL) &&
+      ((UINTN)Pages + EFI_PAGES_TO_SIZE (Pages->NumberOfPages) == (UINTN)Next))
+  {
+    Pages->NumberOfPages += Next->NumberOfPages;
+    MmExtentTreeRemove (FreePageTree, Next);
+  }
+
+  MmExtentTreeUpdate (FreePageTree, Pages);
+  return EFI_SUCCESS;
+}
@@ -1031,7 +1031,7 @@ AdjustPoolHeadF (
 /**
   Helper function of memory allocation with Guard pages.
 
-  @param  FreePageList           The free page node.
+  @param  FreePageTree           The free page tree.
   @param  NumberOfPages          Number of pages to be allocated.
   @param  MaxAddress             Request to allocate memory below this address.
   @param  MemoryType             Type of memory requested.
@@ -1040,7 +1040,7 @@ AdjustPoolHeadF (
 **/
 UINTN
 InternalAllocMaxAddressWithGuard (
-  IN OUT LIST_ENTRY       *FreePageList,
+  IN OUT MM_EXTENT_TREE   *FreePageTree,
   IN     UINTN            NumberOfPages,
   IN     UINTN            MaxAddress,
   IN     EFI_MEMORY_TYPE  MemoryType,
@@ -1048,61 +1048,62 @@ InternalAllocMaxAddressWithGuard (
   IN     BOOLEAN          SupervisorPage
   )
 {
-  LIST_ENTRY      *Node;
-  FREE_PAGE_LIST  *Pages;
+  FREE_PAGE_NODE  *Pages;
   UINTN           PagesToAlloc;
   UINTN           HeadGuard;
   UINTN           TailGuard;
   UINTN           Address;
+  UINTN           SearchLimit;
 
-  for (Node = FreePageList->BackLink; Node != FreePageList;
-       Node = Node->BackLink)
+  SearchLimit = MaxAddress;
+  for (Pages = InternalFindMaxAddressNode (FreePageTree, NumberOfPages, SearchLimit);
+       Pages != NULL;
+       Pages = InternalFindMaxAddressNode (FreePageTree, NumberOfPages, SearchLimit))
   {
-    Pages = BASE_CR (Node, FREE_PAGE_LIST, Link);
-    if ((Pages->NumberOfPages >= NumberOfPages) &&
-        ((UINTN)Pages + EFI_PAGES_TO_SIZE (NumberOfPages) - 1 <= MaxAddress))
-    {
+    //
+    // We may need 1 or 2 more pages for Guard. Check it out.
+    //
+    PagesToAlloc = NumberOfPages;
+    TailGuard    = (UINTN)Pages + EFI_PAGES_TO_SIZE (Pages->NumberOfPages);
+    if (!IsGuardPage (TailGuard)) {
       //
-      // We may need 1 or 2 more pages for Guard. Check it out.
+      // Add one if no Guard at the end of current free memory block.
       //
-      PagesToAlloc = NumberOfPages;
-      TailGuard    = (UINTN)Pages + EFI_PAGES_TO_SIZE (Pages->NumberOfPages);
-      if (!IsGuardPage (TailGuard)) {
-        //
-        // Add one if no Guard at the end of current free memory block.
-        //
-        PagesToAlloc += 1;
-        TailGuard     = 0;
-      }
-
-      HeadGuard = (UINTN)Pages +
-                  EFI_PAGES_TO_SIZE (Pages->NumberOfPages - PagesToAlloc) -
-                  EFI_PAGE_SIZE;
-      if (!IsGuardPage (HeadGuard)) {
-        //
-        // Add one if no Guard at the page before the address to allocate
-        //
-        PagesToAlloc += 1;
-        HeadGuard     = 0;
-      }
+      PagesToAlloc += 1;
+      TailGuard     = 0;
+    }
 
-      if (Pages->NumberOfPages < PagesToAlloc) {
-        // Not enough space to allocate memory with Guards? Try next block.
-        continue;
-      }
+    HeadGuard = (UINTN)Pages +
+                EFI_PAGES_TO_SIZE (Pages->NumberOfPages - PagesToAlloc) -
+                EFI_PAGE_SIZE;
+    if (!IsGuardPage (HeadGuard)) {
+      //
+      // Add one if no Guard at the page before the address to allocate
+      //
+      PagesToAlloc += 1;
+      HeadGuard     = 0;
+    }
 
-      Address = InternalAllocPagesOnOneNode (Pages, PagesToAlloc, MaxAddress);
-      // MU_CHANGE: MM_SUPV: Pass extra argument to indicate the original ownership of allocation call
-      ConvertMmMemoryMapEntry (MemoryType, Address, PagesToAlloc, FALSE, SupervisorPage);
-      CoreFreeMemoryMapStack ();
-      if (HeadGuard == 0) {
-        // Don't pass the Guard page to user.
-        Address += EFI_PAGE_SIZE;
-      }
+    if (Pages->NumberOfPages < PagesToAlloc) {
+      //
+      // Not enough space to allocate memory with Guards? Try next block, which is the
+      // highest one that fits below this block.
+      //
+      SearchLimit = (UINTN)Pages + EFI_PAGES_TO_SIZE (NumberOfPages) - 2;
+      continue;
+    }
 
-      SetGuardForMemory (Address, NumberOfPages);
-      return Address;
+    Address = InternalAllocPagesOnOneNode (FreePageTree, Pages, PagesToAlloc, MaxAddress);
+    // MU_CHANGE: MM_SUPV: Pass extra argument to indicate the original ownership of allocation call
+    ConvertMmMemoryMapEntry (MemoryType, Address, PagesToAlloc, FALSE, SupervisorPage);
+    CoreFreeMemoryMapStack ();
+    if (HeadGuard == 0) {
+      // Don't pass the Guard page to user.
+      Address += EFI_PAGE_SIZE;
     }
+
+    SetGuardForMemory (Address, NumberOfPages);
+    return Address;
   }
 
   return (UINTN)(-1);
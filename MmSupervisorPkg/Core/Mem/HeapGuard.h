@@ -329,7 +329,7 @@ AdjustPoolHeadF (
 /**
   Helper function of memory allocation with Guard pages.
 
-  @param  FreePageList           The free page node.
+  @param  FreePageTree           The free page tree.
   @param  NumberOfPages          Number of pages to be allocated.
   @param  MaxAddress             Request to allocate memory below this address.
   @param  MemoryType             Type of memory requested.
@@ -338,7 +338,7 @@ AdjustPoolHeadF (
 **/
 UINTN
 InternalAllocMaxAddressWithGuard (
-  IN OUT LIST_ENTRY       *FreePageList,
+  IN OUT MM_EXTENT_TREE   *FreePageTree,
   IN     UINTN            NumberOfPages,
   IN     UINTN            MaxAddress,
   IN     EFI_MEMORY_TYPE  MemoryType,
@@ -14,6 +14,8 @@
 
 #include <Library/CpuPageTableLib.h>
 
+#include "ExtentTree.h"
+
 ///
 /// Page Table Entry
 ///
@@ -68,10 +70,11 @@ typedef struct {
 // Page management
 //
 
-typedef struct {
-  LIST_ENTRY    Link;
-  UINTN         NumberOfPages;
-} FREE_PAGE_LIST;
+//
+// Free page nodes are kept at the start of the free ranges they describe, so their Start
+// is their own address.
+//
+typedef MM_EXTENT_NODE FREE_PAGE_NODE;
 
 //
 // Pool management
@@ -127,8 +130,8 @@ typedef enum {
   MmPoolTypeMax,
 } MM_POOL_TYPE;
 
-extern LIST_ENTRY  mMmMemoryMap;
-extern LIST_ENTRY  mMmPoolLists[MmPoolTypeMax][MAX_POOL_INDEX];
+extern MM_EXTENT_TREE  mMmMemoryMap;
+extern LIST_ENTRY      mMmPoolLists[MmPoolTypeMax][MAX_POOL_INDEX];
 
 #define PAGE_TABLE_POOL_EX_UNIT_SIZE   SIZE_512KB
 #define PAGE_TABLE_POOL_EX_UNIT_PAGES  EFI_SIZE_TO_PAGES (PAGE_TABLE_POOL_EX_UNIT_SIZE)
@@ -178,6 +181,7 @@ EnableCet (
 /**
   Internal Function. Allocate n pages from given free page node.
 
+  @param  FreePageTree           The free page tree holding the node.
   @param  Pages                  The free page node.
   @param  NumberOfPages          Number of pages to be allocated.
   @param  MaxAddress             Request to allocate memory below this address.
@@ -187,11 +191,102 @@ EnableCet (
 **/
 UINTN
 InternalAllocPagesOnOneNode (
-  IN OUT FREE_PAGE_LIST  *Pages,
+  IN OUT MM_EXTENT_TREE  *FreePageTree,
+  IN OUT FREE_PAGE_NODE  *Pages,
+  IN     UINTN           NumberOfPages,
+  IN     UINTN           MaxAddress
+  );
+
+/**
+  Internal Function. Find the free page node with the highest address from which n pages
+  can be allocated below MaxAddress.
+
+  @param  FreePageTree           The free page tree.
+  @param  NumberOfPages          Number of pages to be allocated.
+  @param  MaxAddress             Request to allocate memory below this address.
+
+  @return The free page node, or NULL if no node can satisfy the request.
+
+**/
+FREE_PAGE_NODE *
+InternalFindMaxAddressNode (
+  IN MM_EXTENT_TREE  *FreePageTree,
+  IN UINTN           NumberOfPages,
+  IN UINTN           MaxAddress
+  );
+
+/**
+  Internal Function. Allocate n pages from free page tree below MaxAddress.
+
+  @param  FreePageTree           The free page tree.
+  @param  NumberOfPages          Number of pages to be allocated.
+  @param  MaxAddress             Request to allocate memory below this address.
+
+  @return Memory address of allocated pages.
+
+**/
+UINTN
+InternalAllocMaxAddress (
+  IN OUT MM_EXTENT_TREE  *FreePageTree,
   IN     UINTN           NumberOfPages,
   IN     UINTN           MaxAddress
   );
 
+/**
+  Internal Function. Allocate n pages from free page tree at given address.
+
+  @param  FreePageTree           The free page tree.
+  @param  NumberOfPages          Number of pages to be allocated.
+  @param  Address                Request to allocate new memory at this address.
+
+  @return Memory address of allocated pages. Any returned value that differs from
+          Address should be treated as EFI_NOT_FOUND.
+
+**/
+UINTN
+InternalAllocAddress (
+  IN OUT MM_EXTENT_TREE  *FreePageTree,
+  IN     UINTN           NumberOfPages,
+  IN     UINTN           Address
+  );
+
+/**
+  Internal Function. Return pages to the free page tree, merging them with the adjacent
+  free ranges.
+
+  @param  FreePageTree           The free page tree.
+  @param  Memory                 Base address of the pages.
+  @param  NumberOfPages          The number of pages.
+
+  @retval EFI_INVALID_PARAMETER  The pages overlap a free range.
+  @retval EFI_SUCCESS            The pages are free.
+
+**/
+EFI_STATUS
+InternalInsertFreePages (
+  IN OUT MM_EXTENT_TREE        *FreePageTree,
+  IN     EFI_PHYSICAL_ADDRESS  Memory,
+  IN     UINTN                 NumberOfPages
+  );
+
+/**
+  Check whether the input range is in memory map.
+
+  @param  Memory                 Base address of memory being passed in.
+  @param  NumberOfPages          The number of pages.
+  @param  SupervisorPage         Placeholder for flag of this page ownership.
+
+  @retval TRUE   In memory map.
+  @retval FALSE  Not in memory map.
+
+**/
+BOOLEAN
+InMemMap (
+  IN  EFI_PHYSICAL_ADDRESS  Memory,
+  IN  UINTN                 NumberOfPages,
+  OUT BOOLEAN               *SupervisorPage
+  );
+
 /**
   Update SMM memory map entry.
 
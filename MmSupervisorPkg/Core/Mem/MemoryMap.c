@@ -0,0 +1,583 @@
+/** @file
+  SMM memory map management functions.
+
+  The memory map entries are kept in an extent tree keyed by their base address, so that
+  the entry covering an address is found in O(log n) in the number of entries.
+
+  Copyright (c) 2009 - 2018, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2020, AMD Incorporated. All rights reserved.<BR>
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+
+#include "Mem.h"
+
+//
+// For GetMemoryMap()
+//
+
+#define MEMORY_MAP_SIGNATURE  SIGNATURE_32('m','m','a','p')
+typedef struct {
+  UINTN              Signature;
+  //
+  // Link in mFreeMemoryMapEntryList. For an entry on the descriptor stack, a NULL
+  // ForwardLink marks an entry that was removed from the memory map.
+  //
+  LIST_ENTRY         Link;
+  MM_EXTENT_NODE     Node;
+
+  BOOLEAN            FromStack;
+  BOOLEAN            IsSupervisorPage;
+  EFI_MEMORY_TYPE    Type;
+} MEMORY_MAP;
+
+#define MEMORY_MAP_FROM_NODE(a)  CR (a, MEMORY_MAP, Node, MEMORY_MAP_SIGNATURE)
+#define MEMORY_MAP_END(a)        ((a)->Node.Start + EFI_PAGES_TO_SIZE ((a)->Node.NumberOfPages) - 1)
+
+MM_EXTENT_TREE  gMemoryMap = { NULL, 0 };
+
+#define MAX_MAP_DEPTH  6
+
+///
+/// mMapDepth - depth of new descriptor stack
+///
+UINTN  mMapDepth = 0;
+///
+/// mMapStack - space to use as temp storage to build new map descriptors
+///
+MEMORY_MAP  mMapStack[MAX_MAP_DEPTH];
+UINTN       mFreeMapStack = 0;
+///
+/// This list maintain the free memory map list
+///
+LIST_ENTRY  mFreeMemoryMapEntryList = INITIALIZE_LIST_HEAD_VARIABLE (mFreeMemoryMapEntryList);
+
+/**
+  Allocates pages from the memory map.
+
+  @param[in]   Type                   The type of allocation to perform.
+  @param[in]   MemoryType             The type of memory to turn the allocated pages
+                                      into.
+  @param[in]   NumberOfPages          The number of pages to allocate.
+  @param[out]  Memory                 A pointer to receive the base allocated memory
+                                      address.
+  @param[in]   AddRegion              If this memory is new added region.
+  @param[in]   NeedGuard              Flag to indicate Guard page is needed
+                                      or not
+  @param[in]   SupervisorPage         True as this is requesting to apply attribute of supervisor pages
+
+  @retval EFI_INVALID_PARAMETER  Parameters violate checking rules defined in spec.
+  @retval EFI_NOT_FOUND          Could not allocate pages match the requirement.
+  @retval EFI_OUT_OF_RESOURCES   No enough pages to allocate.
+  @retval EFI_SUCCESS            Pages successfully allocated.
+
+**/
+EFI_STATUS
+MmInternalAllocatePagesEx (
+  IN  EFI_ALLOCATE_TYPE     Type,
+  IN  EFI_MEMORY_TYPE       MemoryType,
+  IN  UINTN                 NumberOfPages,
+  OUT EFI_PHYSICAL_ADDRESS  *Memory,
+  IN  BOOLEAN               AddRegion,
+  IN  BOOLEAN               NeedGuard,
+  IN  BOOLEAN               SupervisorPage
+  );
+
+/**
+  Internal function.  Deque a descriptor entry from the mFreeMemoryMapEntryList.
+  If the list is empty, then allocate a new page to refuel the list.
+  Please Note this algorithm to allocate the memory map descriptor has a property
+  that the memory allocated for memory entries always grows, and will never really be freed.
+
+  @return The Memory map descriptor dequeued from the mFreeMemoryMapEntryList
+
+**/
+MEMORY_MAP *
+AllocateMemoryMapEntry (
+  VOID
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Mem;
+  EFI_STATUS            Status;
+  MEMORY_MAP            *FreeDescriptorEntries;
+  MEMORY_MAP            *Entry;
+  UINTN                 Index;
+
+  // DEBUG((DEBUG_INFO, "AllocateMemoryMapEntry\n"));
+
+  if (IsListEmpty (&mFreeMemoryMapEntryList)) {
+    // DEBUG((DEBUG_INFO, "mFreeMemoryMapEntryList is empty\n"));
+    //
+    // The list is empty, to allocate one page to refuel the list
+    //
+    Status = MmInternalAllocatePagesEx (
+               AllocateAnyPages,
+               EfiRuntimeServicesData,
+               EFI_SIZE_TO_PAGES (RUNTIME_PAGE_ALLOCATION_GRANULARITY),
+               &Mem,
+               TRUE,
+               FALSE,
+               TRUE
+               );
+    ASSERT_EFI_ERROR (Status);
+    if (!EFI_ERROR (Status)) {
+      FreeDescriptorEntries = (MEMORY_MAP *)(UINTN)Mem;
+      // DEBUG((DEBUG_INFO, "New FreeDescriptorEntries - 0x%x\n", FreeDescriptorEntries));
+      //
+      // Enqueue the free memory map entries into the list
+      //
+      for (Index = 0; Index < RUNTIME_PAGE_ALLOCATION_GRANULARITY / sizeof (MEMORY_MAP); Index++) {
+        FreeDescriptorEntries[Index].Signature = MEMORY_MAP_SIGNATURE;
+        InsertTailList (&mFreeMemoryMapEntryList, &FreeDescriptorEntries[Index].Link);
+      }
+    } else {
+      return NULL;
+    }
+  }
+
+  //
+  // dequeue the first descriptor from the list
+  //
+  Entry = CR (mFreeMemoryMapEntryList.ForwardLink, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
+  RemoveEntryList (&Entry->Link);
+
+  return Entry;
+}
+
+/**
+  Internal function.  Moves any memory descriptors that are on the
+  temporary descriptor stack to heap.
+
+**/
+VOID
+CoreFreeMemoryMapStack (
+  VOID
+  )
+{
+  MEMORY_MAP  *Entry;
+
+  //
+  // If already freeing the map stack, then return
+  //
+  if (mFreeMapStack != 0) {
+    ASSERT (FALSE);
+    return;
+  }
+
+  //
+  // Move the temporary memory descriptor stack into pool
+  //
+  mFreeMapStack += 1;
+
+  while (mMapDepth != 0) {
+    //
+    // Deque an memory map entry from mFreeMemoryMapEntryList
+    //
+    Entry = AllocateMemoryMapEntry ();
+    if (Entry == NULL) {
+      ASSERT (FALSE);
+      goto Done;
+    }
+
+    //
+    // Update to proper entry
+    //
+    mMapDepth -= 1;
+
+    if (mMapStack[mMapDepth].Link.ForwardLink != NULL) {
+      CopyMem (Entry, &mMapStack[mMapDepth], sizeof (MEMORY_MAP));
+      Entry->FromStack = FALSE;
+      InitializeListHead (&Entry->Link);
+
+      //
+      // Move this entry to general memory
+      //
+      MmExtentTreeReplace (&gMemoryMap, &mMapStack[mMapDepth].Node, &Entry->Node);
+      mMapStack[mMapDepth].Link.ForwardLink = NULL;
+    } else {
+      //
+      // The entry was removed from the memory map meanwhile, keep the descriptor for later
+      //
+      InsertTailList (&mFreeMemoryMapEntryList, &Entry->Link);
+    }
+  }
+
+Done:
+  mFreeMapStack -= 1;
+}
+
+/**
+  Insert new entry into memory map.
+
+  @param[in]  Start      The start address of new memory map entry.
+  @param[in]  End        The end address of new memory map entry.
+  @param[in]  Type       The type of new memory map entry.
+  @param[in]  AddRegion  If this memory is new added region.
+  @param[in]  SupervisorPage  If this memory is a supervisor region.
+**/
+VOID
+InsertNewEntry (
+  IN UINT64           Start,
+  IN UINT64           End,
+  IN EFI_MEMORY_TYPE  Type,
+  IN BOOLEAN          AddRegion,
+  IN BOOLEAN          SupervisorPage
+  )
+{
+  MEMORY_MAP  *Entry;
+
+  Entry      = &mMapStack[mMapDepth];
+  mMapDepth += 1;
+  ASSERT (mMapDepth < MAX_MAP_DEPTH);
+  Entry->FromStack = TRUE;
+
+  Entry->Signature          = MEMORY_MAP_SIGNATURE;
+  Entry->Type               = Type;
+  Entry->Node.Start         = Start;
+  Entry->Node.NumberOfPages = (UINTN)RShiftU64 (End - Start + 1, EFI_PAGE_SHIFT);
+  Entry->IsSupervisorPage   = SupervisorPage;
+  InitializeListHead (&Entry->Link);
+  MmExtentTreeInsert (&gMemoryMap, &Entry->Node);
+}
+
+/**
+  Remove old entry from memory map.
+
+  @param[in] Entry Memory map entry to be removed.
+**/
+VOID
+RemoveOldEntry (
+  IN MEMORY_MAP  *Entry
+  )
+{
+  MmExtentTreeRemove (&gMemoryMap, &Entry->Node);
+
+  if (!Entry->FromStack) {
+    InsertTailList (&mFreeMemoryMapEntryList, &Entry->Link);
+  } else {
+    Entry->Link.ForwardLink = NULL;
+  }
+}
+
+/**
+  Update SMM memory map entry.
+
+  @param[in]  Type                   The type of allocation to perform.
+  @param[in]  Memory                 The base of memory address.
+  @param[in]  NumberOfPages          The number of pages to allocate.
+  @param[in]  AddRegion              If this memory is new added region.
+  @param[in]  SupervisorPage         If this memory is allocated as supervisor region.
+**/
+VOID
+ConvertMmMemoryMapEntry (
+  IN EFI_MEMORY_TYPE       Type,
+  IN EFI_PHYSICAL_ADDRESS  Memory,
+  IN UINTN                 NumberOfPages,
+  IN BOOLEAN               AddRegion,
+  IN BOOLEAN               SupervisorPage
+  )
+{
+  MM_EXTENT_NODE        *Node;
+  MEMORY_MAP            *Entry;
+  MEMORY_MAP            *NextEntry;
+  MEMORY_MAP            *PreviousEntry;
+  EFI_PHYSICAL_ADDRESS  Start;
+  EFI_PHYSICAL_ADDRESS  End;
+  EFI_PHYSICAL_ADDRESS  EntryStart;
+  EFI_PHYSICAL_ADDRESS  EntryEnd;
+
+  Start = Memory;
+  End   = Memory + EFI_PAGES_TO_SIZE (NumberOfPages) - 1;
+
+  //
+  // Exclude memory region
+  //
+  Node = MmExtentTreeFloor (&gMemoryMap, Start);
+  if ((Node != NULL) && (MEMORY_MAP_END (MEMORY_MAP_FROM_NODE (Node)) >= End)) {
+    Entry = MEMORY_MAP_FROM_NODE (Node);
+    if ((Entry->Type != Type) || (Entry->IsSupervisorPage != SupervisorPage)) {
+      EntryStart = Entry->Node.Start;
+      EntryEnd   = MEMORY_MAP_END (Entry);
+
+      //
+      // Update this node
+      //
+      Entry->Node.Start         = Start;
+      Entry->Node.NumberOfPages = NumberOfPages;
+      MmExtentTreeUpdate (&gMemoryMap, &Entry->Node);
+
+      if (EntryStart < Start) {
+        //
+        // +------+   +------+   +------+
+        // |Entry1|---|EntryA|---|EntryX|
+        // +------+   +------+   +------+
+        //
+        InsertNewEntry (
+          EntryStart,
+          Start - 1,
+          Entry->Type,
+          AddRegion,
+          Entry->IsSupervisorPage
+          );
+      }
+
+      if (EntryEnd > End) {
+        //
+        // +------+   +------+   +------+
+        // |EntryX|---|EntryZ|---|Entry3|
+        // +------+   +------+   +------+
+        //
+        InsertNewEntry (
+          End + 1,
+          EntryEnd,
+          Entry->Type,
+          AddRegion,
+          Entry->IsSupervisorPage
+          );
+      }
+
+      Entry->Type             = Type;
+      Entry->IsSupervisorPage = SupervisorPage;
+
+      //
+      // Check adjacent
+      //
+      Node = MmExtentTreeNext (&Entry->Node);
+      if (Node != NULL) {
+        NextEntry = MEMORY_MAP_FROM_NODE (Node);
+        //
+        // +------+   +-----------------+
+        // |Entry1|---|EntryX     Entry3|
+        // +------+   +-----------------+
+        //
+        if ((Entry->Type == NextEntry->Type) && (Entry->IsSupervisorPage == NextEntry->IsSupervisorPage) && (MEMORY_MAP_END (Entry) + 1 == NextEntry->Node.Start)) {
+          Entry->Node.NumberOfPages += NextEntry->Node.NumberOfPages;
+          RemoveOldEntry (NextEntry);
+          MmExtentTreeUpdate (&gMemoryMap, &Entry->Node);
+        }
+      }
+
+      Node = MmExtentTreePrevious (&Entry->Node);
+      if (Node != NULL) {
+        PreviousEntry = MEMORY_MAP_FROM_NODE (Node);
+        //
+        // +-----------------+   +------+
+        // |Entry1     EntryX|---|Entry3|
+        // +-----------------+   +------+
+        //
+        if ((PreviousEntry->Type == Entry->Type) && (PreviousEntry->IsSupervisorPage == Entry->IsSupervisorPage) && (MEMORY_MAP_END (PreviousEntry) + 1 == Entry->Node.Start)) {
+          PreviousEntry->Node.NumberOfPages += Entry->Node.NumberOfPages;
+          RemoveOldEntry (Entry);
+          MmExtentTreeUpdate (&gMemoryMap, &PreviousEntry->Node);
+        }
+      }
+    }
+
+    return;
+  }
+
+  //
+  // The range is not covered by a single entry. Find the first entry above it.
+  //
+  Node = MmExtentTreeFloor (&gMemoryMap, End);
+  Node = (Node != NULL) ? MmExtentTreeNext (Node) : MmExtentTreeFirst (&gMemoryMap);
+  if (Node != NULL) {
+    //
+    // +------+   +------+   +------+
+    // |Entry1|---|EntryX|---|Entry2|
+    // +------+   +------+   +------+
+    //
+    Entry = MEMORY_MAP_FROM_NODE (Node);
+    if ((Entry->Node.Start == End + 1) && (Entry->Type == Type) && (Entry->IsSupervisorPage == SupervisorPage)) {
+      Entry->Node.Start          = Start;
+      Entry->Node.NumberOfPages += NumberOfPages;
+      MmExtentTreeUpdate (&gMemoryMap, &Entry->Node);
+      return;
+    }
+
+    InsertNewEntry (
+      Start,
+      End,
+      Type,
+      AddRegion,
+      SupervisorPage
+      );
+    return;
+  }
+
+  //
+  // +------+   +------+   +------+
+  // |Entry2|---|Entry3|---|EntryX|
+  // +------+   +------+   +------+
+  //
+  Node = MmExtentTreeLast (&gMemoryMap);
+  if (Node != NULL) {
+    Entry = MEMORY_MAP_FROM_NODE (Node);
+    if ((MEMORY_MAP_END (Entry) + 1 == Start) && (Entry->Type == Type) && (Entry->IsSupervisorPage == SupervisorPage)) {
+      Entry->Node.NumberOfPages += NumberOfPages;
+      MmExtentTreeUpdate (&gMemoryMap, &Entry->Node);
+      return;
+    }
+  }
+
+  InsertNewEntry (
+    Start,
+    End,
+    Type,
+    AddRegion,
+    SupervisorPage
+    );
+  return;
+}
+
+/**
+  Return the count of Mm memory map entry.
+
+  @return The count of Mm memory map entry.
+**/
+UINTN
+GetMmMemoryMapEntryCount (
+  VOID
+  )
+{
+  return gMemoryMap.Count;
+}
+
+/**
+  Check whether the input range is in memory map.
+
+  @param  Memory                 Base address of memory being passed in.
+  @param  NumberOfPages          The number of pages.
+  @param  SupervisorPage         Placeholder for flag of this page ownership.
+
+  @retval TRUE   In memory map.
+  @retval FALSE  Not in memory map.
+
+**/
+BOOLEAN
+InMemMap (
+  IN  EFI_PHYSICAL_ADDRESS  Memory,
+  IN  UINTN                 NumberOfPages,
+  OUT BOOLEAN               *SupervisorPage
+  )
+{
+  MM_EXTENT_NODE        *Node;
+  MEMORY_MAP            *Entry;
+  EFI_PHYSICAL_ADDRESS  Last;
+
+  if (SupervisorPage == NULL) {
+    return FALSE;
+  }
+
+  Last = Memory + EFI_PAGES_TO_SIZE (NumberOfPages) - 1;
+
+  Node = MmExtentTreeFloor (&gMemoryMap, Memory);
+  if (Node == NULL) {
+    return FALSE;
+  }
+
+  Entry = MEMORY_MAP_FROM_NODE (Node);
+  if (MEMORY_MAP_END (Entry) >= Last) {
+    *SupervisorPage = Entry->IsSupervisorPage;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/**
+  This function returns a copy of the current memory map. The map is an array of
+  memory descriptors, each of which describes a contiguous block of memory.
+
+  @param[in, out]  MemoryMapSize          A pointer to the size, in bytes, of the
+                                          MemoryMap buffer. On input, this is the size of
+                                          the buffer allocated by the caller.  On output,
+                                          it is the size of the buffer returned by the
+                                          firmware  if the buffer was large enough, or the
+                                          size of the buffer needed  to contain the map if
+                                          the buffer was too small.
+  @param[in, out]  MemoryMap              A pointer to the buffer in which firmware places
+                                          the current memory map.
+  @param[out]      MapKey                 A pointer to the location in which firmware
+                                          returns the key for the current memory map.
+  @param[out]      DescriptorSize         A pointer to the location in which firmware
+                                          returns the size, in bytes, of an individual
+                                          EFI_MEMORY_DESCRIPTOR.
+  @param[out]      DescriptorVersion      A pointer to the location in which firmware
+                                          returns the version number associated with the
+                                          EFI_MEMORY_DESCRIPTOR.
+
+  @retval EFI_SUCCESS            The memory map was returned in the MemoryMap
+                                 buffer.
+  @retval EFI_BUFFER_TOO_SMALL   The MemoryMap buffer was too small. The current
+                                 buffer size needed to hold the memory map is
+                                 returned in MemoryMapSize.
+  @retval EFI_INVALID_PARAMETER  One of the parameters has an invalid value.
+
+**/
+EFI_STATUS
+EFIAPI
+MmCoreGetMemoryMap (
+  IN OUT UINTN                  *MemoryMapSize,
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  OUT UINTN                     *MapKey,
+  OUT UINTN                     *DescriptorSize,
+  OUT UINT32                    *DescriptorVersion
+  )
+{
+  UINTN           Count;
+  MM_EXTENT_NODE  *Node;
+  MEMORY_MAP      *Entry;
+  UINTN           Size;
+  UINTN           BufferSize;
+
+  Size = sizeof (EFI_MEMORY_DESCRIPTOR);
+
+  //
+  // Make sure Size != sizeof(EFI_MEMORY_DESCRIPTOR). This will
+  // prevent people from having pointer math bugs in their code.
+  // now you have to use *DescriptorSize to make things work.
+  //
+  Size += sizeof (UINT64) - (Size % sizeof (UINT64));
+
+  if (DescriptorSize != NULL) {
+    *DescriptorSize = Size;
+  }
+
+  if (DescriptorVersion != NULL) {
+    *DescriptorVersion = EFI_MEMORY_DESCRIPTOR_VERSION;
+  }
+
+  Count      = GetMmMemoryMapEntryCount ();
+  BufferSize = Size * Count;
+  if (*MemoryMapSize < BufferSize) {
+    *MemoryMapSize = BufferSize;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *MemoryMapSize = BufferSize;
+  if (MemoryMap == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (MemoryMap, BufferSize);
+  for (Node = MmExtentTreeFirst (&gMemoryMap); Node != NULL; Node = MmExtentTreeNext (Node)) {
+    Entry = MEMORY_MAP_FROM_NODE (Node);
+
+    MemoryMap->Type          = Entry->Type;
+    MemoryMap->PhysicalStart = Entry->Node.Start;
+    MemoryMap->NumberOfPages = Entry->Node.NumberOfPages;
+    MemoryMap->Attribute     = Entry->IsSupervisorPage ? EFI_MEMORY_SP : 0;
+
+    MemoryMap = NEXT_MEMORY_DESCRIPTOR (MemoryMap, Size);
+  }
+
+  return EFI_SUCCESS;
+}
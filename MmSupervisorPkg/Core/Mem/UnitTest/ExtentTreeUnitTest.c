@@ -0,0 +1,1070 @@
+/** @file
+  Unit tests of the extent tree backing the MM core free page and memory map bookkeeping.
+
+  The tree based implementations are run side by side with a copy of the linked list
+  implementations they replaced, on random sequences of operations, and must produce
+  exactly the same allocations and the same free ranges and memory maps.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <PiMm.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+#include <UnitTest/UnitTestRandom.h>
+
+#include "../Mem.h"
+
+#define UNIT_TEST_APP_NAME     "MM Supervisor Extent Tree Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TRUNCATE_TO_PAGES(a)  ((a) >> EFI_PAGE_SHIFT)
+
+//
+// Number of pages of each simulated SMRAM arena, and number of random operations per test.
+//
+#define TEST_ARENA_PAGES  512
+#define TEST_ITERATIONS   20000
+
+//
+// Maximal number of outstanding allocations tracked by the free page test.
+//
+#define TEST_MAX_ALLOCATIONS  256
+
+//
+// Simulated SMRAM base of the memory map test. Memory map entries are never dereferenced.
+//
+#define TEST_MAP_BASE   0x100000000ull
+#define TEST_MAP_PAGES  4096
+
+extern MM_EXTENT_TREE  gMemoryMap;
+
+EFI_STATUS
+EFIAPI
+MmCoreGetMemoryMap (
+  IN OUT UINTN                  *MemoryMapSize,
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  OUT UINTN                     *MapKey,
+  OUT UINTN                     *DescriptorSize,
+  OUT UINT32                    *DescriptorVersion
+  );
+
+typedef struct {
+  UINTN    Offset;
+  UINTN    NumberOfPages;
+} TEST_ALLOCATION;
+
+//
+// Reference free page list, as implemented before the extent tree.
+//
+typedef struct {
+  LIST_ENTRY    Link;
+  UINTN         NumberOfPages;
+} REFERENCE_FREE_PAGE_LIST;
+
+//
+// Reference memory map entry, as implemented before the extent tree.
+//
+typedef struct {
+  LIST_ENTRY         Link;
+  BOOLEAN            IsSupervisorPage;
+  EFI_MEMORY_TYPE    Type;
+  UINT64             Start;
+  UINT64             End;
+} REFERENCE_MEMORY_MAP;
+
+/**
+  Allocate page aligned host memory.
+
+  @param[in] NumberOfPages  Number of pages to allocate.
+
+  @return The host memory, never NULL.
+
+**/
+VOID *
+AllocateHostPages (
+  IN UINTN  NumberOfPages
+  )
+{
+  VOID  *Buffer;
+
+  Buffer = AllocateAlignedPages (NumberOfPages, EFI_PAGE_SIZE);
+  assert_non_null (Buffer);
+  return Buffer;
+}
+
+/**
+  Simulated page allocator, only used by the memory map to get descriptor pages.
+
+  @return EFI_SUCCESS with the allocated pages in Memory.
+
+**/
+EFI_STATUS
+MmInternalAllocatePagesEx (
+  IN  EFI_ALLOCATE_TYPE     Type,
+  IN  EFI_MEMORY_TYPE       MemoryType,
+  IN  UINTN                 NumberOfPages,
+  OUT EFI_PHYSICAL_ADDRESS  *Memory,
+  IN  BOOLEAN               AddRegion,
+  IN  BOOLEAN               NeedGuard,
+  IN  BOOLEAN               SupervisorPage
+  )
+{
+  *Memory = (UINTN)AllocateHostPages (NumberOfPages);
+  return EFI_SUCCESS;
+}
+
+// ----------------------------------------------------------------------------------------
+// Reference free page list
+// ----------------------------------------------------------------------------------------
+
+/**
+  Reference of InternalAllocPagesOnOneNode.
+**/
+UINTN
+ReferenceAllocPagesOnOneNode (
+  IN OUT REFERENCE_FREE_PAGE_LIST  *Pages,
+  IN     UINTN                     NumberOfPages,
+  IN     UINTN                     MaxAddress
+  )
+{
+  UINTN                     Top;
+  UINTN                     Bottom;
+  REFERENCE_FREE_PAGE_LIST  *Node;
+
+  Top = TRUNCATE_TO_PAGES (MaxAddress + 1 - (UINTN)Pages);
+  if (Top > Pages->NumberOfPages) {
+    Top = Pages->NumberOfPages;
+  }
+
+  Bottom = Top - NumberOfPages;
+
+  if (Top < Pages->NumberOfPages) {
+    Node                = (REFERENCE_FREE_PAGE_LIST *)((UINTN)Pages + EFI_PAGES_TO_SIZE (Top));
+    Node->NumberOfPages = Pages->NumberOfPages - Top;
+    InsertHeadList (&Pages->Link, &Node->Link);
+  }
+
+  if (Bottom > 0) {
+    Pages->NumberOfPages = Bottom;
+  } else {
+    RemoveEntryList (&Pages->Link);
+  }
+
+  return (UINTN)Pages + EFI_PAGES_TO_SIZE (Bottom);
+}
+
+/**
+  Reference of InternalAllocMaxAddress.
+**/
+UINTN
+ReferenceAllocMaxAddress (
+  IN OUT LIST_ENTRY  *FreePageList,
+  IN     UINTN       NumberOfPages,
+  IN     UINTN       MaxAddress
+  )
+{
+  LIST_ENTRY                *Node;
+  REFERENCE_FREE_PAGE_LIST  *Pages;
+
+  for (Node = FreePageList->BackLink; Node != FreePageList; Node = Node->BackLink) {
+    Pages = BASE_CR (Node, REFERENCE_FREE_PAGE_LIST, Link);
+    if ((Pages->NumberOfPages >= NumberOfPages) &&
+        ((UINTN)Pages + EFI_PAGES_TO_SIZE (NumberOfPages) - 1 <= MaxAddress))
+    {
+      return ReferenceAllocPagesOnOneNode (Pages, NumberOfPages, MaxAddress);
+    }
+  }
+
+  return (UINTN)(-1);
+}
+
+/**
+  Reference of InternalAllocAddress.
+**/
+UINTN
+ReferenceAllocAddress (
+  IN OUT LIST_ENTRY  *FreePageList,
+  IN     UINTN       NumberOfPages,
+  IN     UINTN       Address
+  )
+{
+  UINTN                     EndAddress;
+  LIST_ENTRY                *Node;
+  REFERENCE_FREE_PAGE_LIST  *Pages;
+
+  if ((Address & EFI_PAGE_MASK) != 0) {
+    return ~Address;
+  }
+
+  EndAddress = Address + EFI_PAGES_TO_SIZE (NumberOfPages);
+  for (Node = FreePageList->BackLink; Node != FreePageList; Node = Node->BackLink) {
+    Pages = BASE_CR (Node, REFERENCE_FREE_PAGE_LIST, Link);
+    if ((UINTN)Pages <= Address) {
+      if ((UINTN)Pages + EFI_PAGES_TO_SIZE (Pages->NumberOfPages) < EndAddress) {
+        break;
+      }
+
+      return ReferenceAllocPagesOnOneNode (Pages, NumberOfPages, EndAddress);
+    }
+  }
+
+  return ~Address;
+}
+
+/**
+  Reference of the merge of two adjacent free page nodes.
+**/
+REFERENCE_FREE_PAGE_LIST *
+ReferenceMergeNodes (
+  IN REFERENCE_FREE_PAGE_LIST  *First
+  )
+{
+  REFERENCE_FREE_PAGE_LIST  *Next;
+
+  Next = BASE_CR (First->Link.ForwardLink, REFERENCE_FREE_PAGE_LIST, Link);
+  if (TRUNCATE_TO_PAGES ((UINTN)Next - (UINTN)First) == First->NumberOfPages) {
+    First->NumberOfPages += Next->NumberOfPages;
+    RemoveEntryList (&Next->Link);
+    Next = First;
+  }
+
+  return Next;
+}
+
+/**
+  Reference of InternalInsertFreePages, the list part of the former MmInternalFreePagesEx.
+**/
+EFI_STATUS
+ReferenceInsertFreePages (
+  IN OUT LIST_ENTRY            *FreePageList,
+  IN     EFI_PHYSICAL_ADDRESS  Memory,
+  IN     UINTN                 NumberOfPages
+  )
+{
+  LIST_ENTRY                *Node;
+  REFERENCE_FREE_PAGE_LIST  *Pages;
+
+  Pages = NULL;
+  Node  = FreePageList->ForwardLink;
+  while (Node != FreePageList) {
+    Pages = BASE_CR (Node, REFERENCE_FREE_PAGE_LIST, Link);
+    if (Memory < (UINTN)Pages) {
+      break;
+    }
+
+    Node = Node->ForwardLink;
+  }
+
+  if ((Node != FreePageList) &&
+      (Memory + EFI_PAGES_TO_SIZE (NumberOfPages) > (UINTN)Pages))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Node->BackLink != FreePageList) {
+    Pages = BASE_CR (Node->BackLink, REFERENCE_FREE_PAGE_LIST, Link);
+    if ((UINTN)Pages + EFI_PAGES_TO_SIZE (Pages->NumberOfPages) > Memory) {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  Pages                = (REFERENCE_FREE_PAGE_LIST *)(UINTN)Memory;
+  Pages->NumberOfPages = NumberOfPages;
+  InsertTailList (Node, &Pages->Link);
+
+  if (Pages->Link.BackLink != FreePageList) {
+    Pages = ReferenceMergeNodes (
+              BASE_CR (Pages->Link.BackLink, REFERENCE_FREE_PAGE_LIST, Link)
+              );
+  }
+
+  if (Node != FreePageList) {
+    ReferenceMergeNodes (Pages);
+  }
+
+  return EFI_SUCCESS;
+}
+
+// ----------------------------------------------------------------------------------------
+// Reference memory map
+// ----------------------------------------------------------------------------------------
+
+LIST_ENTRY  mReferenceMemoryMap = INITIALIZE_LIST_HEAD_VARIABLE (mReferenceMemoryMap);
+
+/**
+  Reference of InsertNewEntry. Entries come from the host heap instead of a stack.
+**/
+VOID
+ReferenceInsertNewEntry (
+  IN LIST_ENTRY       *Link,
+  IN UINT64           Start,
+  IN UINT64           End,
+  IN EFI_MEMORY_TYPE  Type,
+  IN BOOLEAN          Next,
+  IN BOOLEAN          SupervisorPage
+  )
+{
+  REFERENCE_MEMORY_MAP  *Entry;
+
+  Entry = AllocatePool (sizeof (REFERENCE_MEMORY_MAP));
+  assert_non_null (Entry);
+  Entry->Type             = Type;
+  Entry->Start            = Start;
+  Entry->End              = End;
+  Entry->IsSupervisorPage = SupervisorPage;
+  if (Next) {
+    InsertHeadList (Link, &Entry->Link);
+  } else {
+    InsertTailList (Link, &Entry->Link);
+  }
+}
+
+/**
+  Reference of RemoveOldEntry.
+**/
+VOID
+ReferenceRemoveOldEntry (
+  IN REFERENCE_MEMORY_MAP  *Entry
+  )
+{
+  RemoveEntryList (&Entry->Link);
+  FreePool (Entry);
+}
+
+/**
+  Reference of ConvertMmMemoryMapEntry.
+**/
+VOID
+ReferenceConvertMemoryMapEntry (
+  IN EFI_MEMORY_TYPE       Type,
+  IN EFI_PHYSICAL_ADDRESS  Memory,
+  IN UINTN                 NumberOfPages,
+  IN BOOLEAN               SupervisorPage
+  )
+{
+  LIST_ENTRY            *Link;
+  REFERENCE_MEMORY_MAP  *Entry;
+  REFERENCE_MEMORY_MAP  *NextEntry;
+  REFERENCE_MEMORY_MAP  *PreviousEntry;
+  EFI_PHYSICAL_ADDRESS  Start;
+  EFI_PHYSICAL_ADDRESS  End;
+
+  Start = Memory;
+  End   = Memory + EFI_PAGES_TO_SIZE (NumberOfPages) - 1;
+
+  Link = mReferenceMemoryMap.ForwardLink;
+  while (Link != &mReferenceMemoryMap) {
+    Entry = BASE_CR (Link, REFERENCE_MEMORY_MAP, Link);
+    Link  = Link->ForwardLink;
+
+    if (Entry->Start > End) {
+      if ((Entry->Start == End + 1) && (Entry->Type == Type) && (Entry->IsSupervisorPage == SupervisorPage)) {
+        Entry->Start = Start;
+        return;
+      }
+
+      ReferenceInsertNewEntry (&Entry->Link, Start, End, Type, FALSE, SupervisorPage);
+      return;
+    }
+
+    if ((Entry->Start <= Start) && (Entry->End >= End)) {
+      if ((Entry->Type != Type) || (Entry->IsSupervisorPage != SupervisorPage)) {
+        if (Entry->Start < Start) {
+          ReferenceInsertNewEntry (&Entry->Link, Entry->Start, Start - 1, Entry->Type, FALSE, Entry->IsSupervisorPage);
+        }
+
+        if (Entry->End > End) {
+          ReferenceInsertNewEntry (&Entry->Link, End + 1, Entry->End, Entry->Type, TRUE, Entry->IsSupervisorPage);
+        }
+
+        Entry->Start            = Start;
+        Entry->End              = End;
+        Entry->Type             = Type;
+        Entry->IsSupervisorPage = SupervisorPage;
+
+        if (Entry->Link.ForwardLink != &mReferenceMemoryMap) {
+          NextEntry = BASE_CR (Entry->Link.ForwardLink, REFERENCE_MEMORY_MAP, Link);
+          if ((Entry->Type == NextEntry->Type) && (Entry->IsSupervisorPage == NextEntry->IsSupervisorPage) && (Entry->End + 1 == NextEntry->Start)) {
+            Entry->End = NextEntry->End;
+            ReferenceRemoveOldEntry (NextEntry);
+          }
+        }
+
+        if (Entry->Link.BackLink != &mReferenceMemoryMap) {
+          PreviousEntry = BASE_CR (Entry->Link.BackLink, REFERENCE_MEMORY_MAP, Link);
+          if ((PreviousEntry->Type == Entry->Type) && (PreviousEntry->IsSupervisorPage == Entry->IsSupervisorPage) && (PreviousEntry->End + 1 == Entry->Start)) {
+            PreviousEntry->End = Entry->End;
+            ReferenceRemoveOldEntry (Entry);
+          }
+        }
+      }
+
+      return;
+    }
+  }
+
+  Link = mReferenceMemoryMap.BackLink;
+  if (Link != &mReferenceMemoryMap) {
+    Entry = BASE_CR (Link, REFERENCE_MEMORY_MAP, Link);
+    if ((Entry->End + 1 == Start) && (Entry->Type == Type) && (Entry->IsSupervisorPage == SupervisorPage)) {
+      Entry->End = End;
+      return;
+    }
+  }
+
+  ReferenceInsertNewEntry (&mReferenceMemoryMap, Start, End, Type, FALSE, SupervisorPage);
+}
+
+/**
+  Reference of InMemMap.
+**/
+BOOLEAN
+ReferenceInMemMap (
+  IN  EFI_PHYSICAL_ADDRESS  Memory,
+  IN  UINTN                 NumberOfPages,
+  OUT BOOLEAN               *SupervisorPage
+  )
+{
+  LIST_ENTRY            *Link;
+  REFERENCE_MEMORY_MAP  *Entry;
+  EFI_PHYSICAL_ADDRESS  Last;
+
+  Last = Memory + EFI_PAGES_TO_SIZE (NumberOfPages) - 1;
+
+  for (Link = mReferenceMemoryMap.ForwardLink; Link != &mReferenceMemoryMap; Link = Link->ForwardLink) {
+    Entry = BASE_CR (Link, REFERENCE_MEMORY_MAP, Link);
+    if ((Entry->Start <= Memory) && (Entry->End >= Last)) {
+      *SupervisorPage = Entry->IsSupervisorPage;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+// ----------------------------------------------------------------------------------------
+// Checkers
+// ----------------------------------------------------------------------------------------
+
+/**
+  Check the structure of a subtree of an extent tree.
+
+  @param[in]  Node      Root of the subtree, may be NULL.
+  @param[in]  Parent    Expected parent of Node.
+  @param[out] Count     Incremented by the number of nodes of the subtree.
+
+  @return The height of the subtree, or MAX_UINTN if the subtree is malformed.
+
+**/
+UINTN
+CheckSubtree (
+  IN  MM_EXTENT_NODE  *Node,
+  IN  MM_EXTENT_NODE  *Parent,
+  OUT UINTN           *Count
+  )
+{
+  UINTN  LeftHeight;
+  UINTN  RightHeight;
+  UINTN  MaxPages;
+
+  if (Node == NULL) {
+    return 0;
+  }
+
+  if (Node->Parent != Parent) {
+    return MAX_UINTN;
+  }
+
+  if (((Node->Left != NULL) && (Node->Left->Start >= Node->Start)) ||
+      ((Node->Right != NULL) && (Node->Right->Start <= Node->Start)))
+  {
+    return MAX_UINTN;
+  }
+
+  LeftHeight  = CheckSubtree (Node->Left, Node, Count);
+  RightHeight = CheckSubtree (Node->Right, Node, Count);
+  if ((LeftHeight == MAX_UINTN) || (RightHeight == MAX_UINTN) ||
+      (LeftHeight > RightHeight + 1) || (RightHeight > LeftHeight + 1) ||
+      (Node->Height != MAX (LeftHeight, RightHeight) + 1))
+  {
+    return MAX_UINTN;
+  }
+
+  MaxPages = Node->NumberOfPages;
+  if ((Node->Left != NULL) && (Node->Left->MaxPages > MaxPages)) {
+    MaxPages = Node->Left->MaxPages;
+  }
+
+  if ((Node->Right != NULL) && (Node->Right->MaxPages > MaxPages)) {
+    MaxPages = Node->Right->MaxPages;
+  }
+
+  if (Node->MaxPages != MaxPages) {
+    return MAX_UINTN;
+  }
+
+  *Count += 1;
+  return Node->Height;
+}
+
+/**
+  Check the ordering, balance, parent links and cached data of an extent tree.
+
+  @param[in] Tree  The tree to check.
+
+  @retval TRUE   The tree is well formed.
+  @retval FALSE  The tree is malformed.
+
+**/
+BOOLEAN
+IsTreeWellFormed (
+  IN MM_EXTENT_TREE  *Tree
+  )
+{
+  UINTN           Count;
+  MM_EXTENT_NODE  *Node;
+
+  Count = 0;
+  if (CheckSubtree (Tree->Root, NULL, &Count) == MAX_UINTN) {
+    return FALSE;
+  }
+
+  if (Count != Tree->Count) {
+    return FALSE;
+  }
+
+  //
+  // The in order walk must visit every node in increasing address order.
+  //
+  for (Node = MmExtentTreeFirst (Tree); Node != NULL; Node = MmExtentTreeNext (Node)) {
+    Count--;
+    if ((MmExtentTreeNext (Node) != NULL) && (MmExtentTreeNext (Node)->Start <= Node->Start)) {
+      return FALSE;
+    }
+
+    if ((MmExtentTreeNext (Node) != NULL) && (MmExtentTreePrevious (MmExtentTreeNext (Node)) != Node)) {
+      return FALSE;
+    }
+  }
+
+  return (BOOLEAN)(Count == 0);
+}
+
+/**
+  Check that a free page tree and a reference free page list hold the same ranges,
+  relative to their arenas.
+
+  @retval TRUE   The free ranges are the same.
+  @retval FALSE  The free ranges differ.
+
+**/
+BOOLEAN
+IsFreePageTreeSameAsReference (
+  IN MM_EXTENT_TREE  *Tree,
+  IN UINT8           *TreeArena,
+  IN LIST_ENTRY      *List,
+  IN UINT8           *ListArena
+  )
+{
+  MM_EXTENT_NODE            *Node;
+  LIST_ENTRY                *Link;
+  REFERENCE_FREE_PAGE_LIST  *Pages;
+
+  Link = List->ForwardLink;
+  for (Node = MmExtentTreeFirst (Tree); Node != NULL; Node = MmExtentTreeNext (Node)) {
+    if (Link == List) {
+      return FALSE;
+    }
+
+    Pages = BASE_CR (Link, REFERENCE_FREE_PAGE_LIST, Link);
+    if ((Node->Start != (UINTN)Node) ||
+        ((UINTN)Node - (UINTN)TreeArena != (UINTN)Pages - (UINTN)ListArena) ||
+        (Node->NumberOfPages != Pages->NumberOfPages))
+    {
+      return FALSE;
+    }
+
+    Link = Link->ForwardLink;
+  }
+
+  return (BOOLEAN)(Link == List);
+}
+
+/**
+  Check that the memory map and the reference memory map hold the same entries.
+
+  @retval TRUE   The memory maps are the same.
+  @retval FALSE  The memory maps differ.
+
+**/
+BOOLEAN
+IsMemoryMapSameAsReference (
+  VOID
+  )
+{
+  EFI_STATUS             Status;
+  UINTN                  MapSize;
+  UINTN                  DescriptorSize;
+  UINT32                 DescriptorVersion;
+  UINTN                  MapKey;
+  UINT8                  *Map;
+  EFI_MEMORY_DESCRIPTOR  *Descriptor;
+  LIST_ENTRY             *Link;
+  REFERENCE_MEMORY_MAP   *Entry;
+  BOOLEAN                Same;
+
+  MapSize = 0;
+  Status  = MmCoreGetMemoryMap (&MapSize, NULL, &MapKey, &DescriptorSize, &DescriptorVersion);
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    return FALSE;
+  }
+
+  Map = AllocatePool (MapSize);
+  assert_non_null (Map);
+
+  Status = MmCoreGetMemoryMap (&MapSize, (EFI_MEMORY_DESCRIPTOR *)Map, &MapKey, &DescriptorSize, &DescriptorVersion);
+  if (EFI_ERROR (Status)) {
+    FreePool (Map);
+    return FALSE;
+  }
+
+  Same = TRUE;
+  Link = mReferenceMemoryMap.ForwardLink;
+  for (Descriptor = (EFI_MEMORY_DESCRIPTOR *)Map;
+       (UINT8 *)Descriptor < Map + MapSize;
+       Descriptor = NEXT_MEMORY_DESCRIPTOR (Descriptor, DescriptorSize))
+  {
+    if (Link == &mReferenceMemoryMap) {
+      Same = FALSE;
+      break;
+    }
+
+    Entry = BASE_CR (Link, REFERENCE_MEMORY_MAP, Link);
+    if ((Descriptor->Type != Entry->Type) ||
+        (Descriptor->PhysicalStart != Entry->Start) ||
+        (Descriptor->NumberOfPages != RShiftU64 (Entry->End - Entry->Start + 1, EFI_PAGE_SHIFT)) ||
+        (Descriptor->Attribute != (Entry->IsSupervisorPage ? EFI_MEMORY_SP : 0)))
+    {
+      Same = FALSE;
+      break;
+    }
+
+    Link = Link->ForwardLink;
+  }
+
+  FreePool (Map);
+  return (BOOLEAN)(Same && (Link == &mReferenceMemoryMap));
+}
+
+// ----------------------------------------------------------------------------------------
+// Tests
+// ----------------------------------------------------------------------------------------
+
+/**
+  Highest fit lookups should return the same node as a linear scan.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ExtentTreeFindsHighestFit (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MM_EXTENT_TREE  Tree;
+  MM_EXTENT_NODE  Nodes[200];
+  MM_EXTENT_NODE  *Node;
+  MM_EXTENT_NODE  *Expected;
+  UINTN           Index;
+  UINTN           Iteration;
+  UINT64          MaxStart;
+  UINTN           NumberOfPages;
+
+  mRandomState = 0x5EED0001;
+  ZeroMem (&Tree, sizeof (Tree));
+
+  for (Index = 0; Index < ARRAY_SIZE (Nodes); Index++) {
+    //
+    // Scatter the insertion order over the address space.
+    //
+    Nodes[Index].Start         = (UINT64)((Index * 7919) % ARRAY_SIZE (Nodes)) * 0x100;
+    Nodes[Index].NumberOfPages = RandomBelow (64);
+    MmExtentTreeInsert (&Tree, &Nodes[Index]);
+    UT_ASSERT_TRUE (IsTreeWellFormed (&Tree));
+  }
+
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    //
+    // Randomly resize, remove or reinsert a node, then compare a lookup with a scan.
+    //
+    Index = RandomBelow (ARRAY_SIZE (Nodes));
+    if (Nodes[Index].Height == 0) {
+      Nodes[Index].NumberOfPages = RandomBelow (64);
+      MmExtentTreeInsert (&Tree, &Nodes[Index]);
+    } else if (RandomBelow (3) == 0) {
+      MmExtentTreeRemove (&Tree, &Nodes[Index]);
+      Nodes[Index].Height = 0;
+    } else {
+      Nodes[Index].NumberOfPages = RandomBelow (64);
+      MmExtentTreeUpdate (&Tree, &Nodes[Index]);
+    }
+
+    UT_ASSERT_TRUE (IsTreeWellFormed (&Tree));
+
+    MaxStart      = RandomBelow (ARRAY_SIZE (Nodes) * 0x100 + 0x100);
+    NumberOfPages = RandomBelow (72);
+    Expected      = NULL;
+    for (Node = MmExtentTreeFirst (&Tree); Node != NULL; Node = MmExtentTreeNext (Node)) {
+      if ((Node->Start <= MaxStart) && (Node->NumberOfPages >= NumberOfPages)) {
+        Expected = Node;
+      }
+    }
+
+    UT_ASSERT_TRUE (MmExtentTreeFindHighestFit (&Tree, MaxStart, NumberOfPages) == Expected);
+
+    Expected = NULL;
+    for (Node = MmExtentTreeFirst (&Tree); Node != NULL; Node = MmExtentTreeNext (Node)) {
+      if (Node->Start <= MaxStart) {
+        Expected = Node;
+      }
+    }
+
+    UT_ASSERT_TRUE (MmExtentTreeFloor (&Tree, MaxStart) == Expected);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Random page allocations and frees should behave exactly like the free page list.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FreePageTreeMatchesList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MM_EXTENT_TREE   Tree;
+  LIST_ENTRY       List;
+  UINT8            *TreeArena;
+  UINT8            *ListArena;
+  TEST_ALLOCATION  Allocations[TEST_MAX_ALLOCATIONS];
+  UINTN            AllocationCount;
+  UINTN            Iteration;
+  UINTN            Index;
+  UINTN            Offset;
+  UINTN            NumberOfPages;
+  UINTN            TreeResult;
+  UINTN            ListResult;
+  EFI_STATUS       TreeStatus;
+  EFI_STATUS       ListStatus;
+
+  mRandomState = 0x5EED0002;
+  ZeroMem (&Tree, sizeof (Tree));
+  InitializeListHead (&List);
+  TreeArena       = AllocateHostPages (TEST_ARENA_PAGES);
+  ListArena       = AllocateHostPages (TEST_ARENA_PAGES);
+  AllocationCount = 0;
+
+  //
+  // Hand the arenas over as a few disjoint regions, leaving holes that are never free.
+  //
+  for (Offset = 0; Offset < TEST_ARENA_PAGES; Offset += 64) {
+    NumberOfPages = 48 + RandomBelow (16);
+    TreeStatus    = InternalInsertFreePages (&Tree, (UINTN)TreeArena + EFI_PAGES_TO_SIZE (Offset), NumberOfPages);
+    ListStatus    = ReferenceInsertFreePages (&List, (UINTN)ListArena + EFI_PAGES_TO_SIZE (Offset), NumberOfPages);
+    UT_ASSERT_STATUS_EQUAL (TreeStatus, EFI_SUCCESS);
+    UT_ASSERT_STATUS_EQUAL (ListStatus, EFI_SUCCESS);
+  }
+
+  UT_ASSERT_TRUE (IsFreePageTreeSameAsReference (&Tree, TreeArena, &List, ListArena));
+
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    NumberOfPages = 1 + RandomBelow ((RandomBelow (8) == 0) ? 40 : 6);
+    switch (RandomBelow (5)) {
+      case 0:
+        //
+        // Allocate anywhere.
+        //
+        TreeResult = InternalAllocMaxAddress (&Tree, NumberOfPages, (UINTN)-1);
+        ListResult = ReferenceAllocMaxAddress (&List, NumberOfPages, (UINTN)-1);
+        break;
+      case 1:
+        //
+        // Allocate below an address within the arena, not necessarily page aligned.
+        //
+        Offset     = RandomBelow (EFI_PAGES_TO_SIZE (TEST_ARENA_PAGES));
+        TreeResult = InternalAllocMaxAddress (&Tree, NumberOfPages, (UINTN)TreeArena + Offset);
+        ListResult = ReferenceAllocMaxAddress (&List, NumberOfPages, (UINTN)ListArena + Offset);
+        break;
+      case 2:
+        //
+        // Allocate at an address within the arena, sometimes not page aligned.
+        //
+        Offset = EFI_PAGES_TO_SIZE (RandomBelow (TEST_ARENA_PAGES));
+        if (RandomBelow (16) == 0) {
+          Offset += 8;
+        }
+
+        TreeResult = InternalAllocAddress (&Tree, NumberOfPages, (UINTN)TreeArena + Offset);
+        ListResult = ReferenceAllocAddress (&List, NumberOfPages, (UINTN)ListArena + Offset);
+        if (TreeResult != (UINTN)TreeArena + Offset) {
+          UT_ASSERT_TRUE (ListResult != (UINTN)ListArena + Offset);
+          TreeResult = ListResult = (UINTN)-1;
+        }
+
+        break;
+      case 3:
+        //
+        // Free a random part of an outstanding allocation.
+        //
+        TreeResult = ListResult = (UINTN)-1;
+        if (AllocationCount == 0) {
+          break;
+        }
+
+        Index         = RandomBelow (AllocationCount);
+        Offset        = RandomBelow (Allocations[Index].NumberOfPages);
+        NumberOfPages = 1 + RandomBelow (Allocations[Index].NumberOfPages - Offset);
+        TreeStatus    = InternalInsertFreePages (&Tree, (UINTN)TreeArena + Allocations[Index].Offset + EFI_PAGES_TO_SIZE (Offset), NumberOfPages);
+        ListStatus    = ReferenceInsertFreePages (&List, (UINTN)ListArena + Allocations[Index].Offset + EFI_PAGES_TO_SIZE (Offset), NumberOfPages);
+        UT_ASSERT_STATUS_EQUAL (TreeStatus, EFI_SUCCESS);
+        UT_ASSERT_STATUS_EQUAL (ListStatus, EFI_SUCCESS);
+
+        //
+        // Keep tracking whatever remains allocated on both sides of the freed pages.
+        //
+        if ((Offset + NumberOfPages < Allocations[Index].NumberOfPages) && (AllocationCount < TEST_MAX_ALLOCATIONS)) {
+          Allocations[AllocationCount].Offset        = Allocations[Index].Offset + EFI_PAGES_TO_SIZE (Offset + NumberOfPages);
+          Allocations[AllocationCount].NumberOfPages = Allocations[Index].NumberOfPages - Offset - NumberOfPages;
+          AllocationCount++;
+        }
+
+        if (Offset > 0) {
+          Allocations[Index].NumberOfPages = Offset;
+        } else {
+          Allocations[Index] = Allocations[--AllocationCount];
+        }
+
+        break;
+      default:
+        //
+        // Free a random range, which must fail the same way when it overlaps free pages.
+        //
+        TreeResult    = ListResult = (UINTN)-1;
+        Offset        = EFI_PAGES_TO_SIZE (RandomBelow (TEST_ARENA_PAGES));
+        NumberOfPages = 1 + RandomBelow (4);
+        if (Offset + EFI_PAGES_TO_SIZE (NumberOfPages) > EFI_PAGES_TO_SIZE (TEST_ARENA_PAGES)) {
+          break;
+        }
+
+        for (Index = 0; Index < AllocationCount; Index++) {
+          if ((Offset < Allocations[Index].Offset + EFI_PAGES_TO_SIZE (Allocations[Index].NumberOfPages)) &&
+              (Offset + EFI_PAGES_TO_SIZE (NumberOfPages) > Allocations[Index].Offset))
+          {
+            break;
+          }
+        }
+
+        if (Index < AllocationCount) {
+          //
+          // The range overlaps an allocation, freeing it would corrupt the bookkeeping of the test.
+          //
+          break;
+        }
+
+        TreeStatus = InternalInsertFreePages (&Tree, (UINTN)TreeArena + Offset, NumberOfPages);
+        ListStatus = ReferenceInsertFreePages (&List, (UINTN)ListArena + Offset, NumberOfPages);
+        UT_ASSERT_STATUS_EQUAL (TreeStatus, ListStatus);
+        break;
+    }
+
+    if (TreeResult != (UINTN)-1) {
+      UT_ASSERT_TRUE (ListResult != (UINTN)-1);
+      UT_ASSERT_EQUAL (TreeResult - (UINTN)TreeArena, ListResult - (UINTN)ListArena);
+      if (AllocationCount < TEST_MAX_ALLOCATIONS) {
+        Allocations[AllocationCount].Offset        = TreeResult - (UINTN)TreeArena;
+        Allocations[AllocationCount].NumberOfPages = NumberOfPages;
+        AllocationCount++;
+      }
+    } else {
+      UT_ASSERT_TRUE (ListResult == (UINTN)-1);
+    }
+
+    UT_ASSERT_TRUE (IsTreeWellFormed (&Tree));
+    UT_ASSERT_TRUE (IsFreePageTreeSameAsReference (&Tree, TreeArena, &List, ListArena));
+  }
+
+  FreeAlignedPages (TreeArena, TEST_ARENA_PAGES);
+  FreeAlignedPages (ListArena, TEST_ARENA_PAGES);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Random memory map conversions should produce exactly the same map as the list.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MemoryMapTreeMatchesList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST EFI_MEMORY_TYPE  Types[] = { EfiConventionalMemory, EfiRuntimeServicesCode, EfiRuntimeServicesData };
+  UINTN                         Iteration;
+  UINTN                         Page;
+  UINTN                         NumberOfPages;
+  EFI_MEMORY_TYPE               Type;
+  BOOLEAN                       SupervisorPage;
+  BOOLEAN                       Covered;
+  BOOLEAN                       TreeSupervisorPage;
+  BOOLEAN                       ListSupervisorPage;
+  EFI_PHYSICAL_ADDRESS          Memory;
+  MM_EXTENT_NODE                *Node;
+  UINT64                        Start;
+  UINT64                        End;
+
+  mRandomState = 0x5EED0003;
+
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    Type           = Types[RandomBelow (ARRAY_SIZE (Types))];
+    SupervisorPage = (BOOLEAN)RandomBelow (2);
+    Page           = RandomBelow (TEST_MAP_PAGES);
+    Memory         = TEST_MAP_BASE + EFI_PAGES_TO_SIZE (Page);
+
+    //
+    // The memory map is only ever asked to convert a range within a single entry, or a
+    // range of pages that are not in the map yet. Clip the random range accordingly.
+    //
+    Node = MmExtentTreeFloor (&gMemoryMap, Memory);
+    if ((Node != NULL) && (Node->Start + EFI_PAGES_TO_SIZE (Node->NumberOfPages) > Memory)) {
+      End = Node->Start + EFI_PAGES_TO_SIZE (Node->NumberOfPages);
+    } else {
+      Node = (Node != NULL) ? MmExtentTreeNext (Node) : MmExtentTreeFirst (&gMemoryMap);
+      End  = (Node != NULL) ? Node->Start : TEST_MAP_BASE + EFI_PAGES_TO_SIZE (TEST_MAP_PAGES + 64);
+    }
+
+    NumberOfPages = 1 + RandomBelow (MIN (32, (UINTN)TRUNCATE_TO_PAGES (End - Memory)));
+
+    ConvertMmMemoryMapEntry (Type, Memory, NumberOfPages, FALSE, SupervisorPage);
+    CoreFreeMemoryMapStack ();
+    ReferenceConvertMemoryMapEntry (Type, Memory, NumberOfPages, SupervisorPage);
+
+    UT_ASSERT_TRUE (IsTreeWellFormed (&gMemoryMap));
+    UT_ASSERT_TRUE (IsMemoryMapSameAsReference ());
+
+    //
+    // Look up a random range, which may straddle entries or fall outside of the map.
+    //
+    Start              = TEST_MAP_BASE + EFI_PAGES_TO_SIZE (RandomBelow (TEST_MAP_PAGES + 64)) - EFI_PAGES_TO_SIZE (32);
+    NumberOfPages      = 1 + RandomBelow (8);
+    TreeSupervisorPage = ListSupervisorPage = FALSE;
+    Covered            = InMemMap (Start, NumberOfPages, &TreeSupervisorPage);
+    UT_ASSERT_EQUAL (Covered, ReferenceInMemMap (Start, NumberOfPages, &ListSupervisorPage));
+    UT_ASSERT_EQUAL (TreeSupervisorPage, ListSupervisorPage);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  extent tree and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      ExtentTreeTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the extent tree Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&ExtentTreeTests, Framework, "Extent Tree Tests", "MmSupervisorCore.ExtentTree", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for ExtentTreeTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (ExtentTreeTests, "Highest fit lookups should match a linear scan", "HighestFit", ExtentTreeFindsHighestFit, NULL, NULL, NULL);
+  AddTestCase (ExtentTreeTests, "Free page tree should match the free page list", "FreePages", FreePageTreeMatchesList, NULL, NULL, NULL);
+  AddTestCase (ExtentTreeTests, "Memory map tree should match the memory map list", "MemoryMap", MemoryMapTreeMatchesList, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -21,9 +21,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "MmSupervisorCore.h"
 #include "Mem/Mem.h"
-
-#define PREVIOUS_MEMORY_DESCRIPTOR(MemoryDescriptor, Size) \
-  ((EFI_MEMORY_DESCRIPTOR *)((UINT8 *)(MemoryDescriptor) - (Size)))
+#include "MemoryAttributesTableMerge.h"
 
 #define IMAGE_PROPERTIES_PRIVATE_DATA_SIGNATURE  SIGNATURE_32 ('I','P','P','D')
 
@@ -49,110 +47,6 @@ UINT64  mMemoryProtectionAttribute = EFI_MEMORY_ATTRIBUTES_RUNTIME_MEMORY_PROTEC
 // Below functions are for MemoryMap
 //
 
-/**
-  Merge continuous memory map entries whose have same attributes.
-
-  @param[in, out]  MemoryMap              A pointer to the buffer in which firmware places
-                                          the current memory map.
-  @param[in, out]  MemoryMapSize          A pointer to the size, in bytes, of the
-                                          MemoryMap buffer. On input, this is the size of
-                                          the current memory map.  On output,
-                                          it is the size of new memory map after merge.
-  @param[in]       DescriptorSize         Size, in bytes, of an individual EFI_MEMORY_DESCRIPTOR.
-**/
-STATIC
-VOID
-MergeMemoryMap (
-  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
-  IN OUT UINTN                  *MemoryMapSize,
-  IN UINTN                      DescriptorSize
-  )
-{
-  EFI_MEMORY_DESCRIPTOR  *MemoryMapEntry;
-  EFI_MEMORY_DESCRIPTOR  *MemoryMapEnd;
-  UINT64                 MemoryBlockLength;
-  EFI_MEMORY_DESCRIPTOR  *NewMemoryMapEntry;
-  EFI_MEMORY_DESCRIPTOR  *NextMemoryMapEntry;
-
-  MemoryMapEntry    = MemoryMap;
-  NewMemoryMapEntry = MemoryMap;
-  MemoryMapEnd      = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)MemoryMap + *MemoryMapSize);
-  while ((UINTN)MemoryMapEntry < (UINTN)MemoryMapEnd) {
-    CopyMem (NewMemoryMapEntry, MemoryMapEntry, sizeof (EFI_MEMORY_DESCRIPTOR));
-    NextMemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
-
-    do {
-      MemoryBlockLength = LShiftU64 (MemoryMapEntry->NumberOfPages, EFI_PAGE_SHIFT);
-      if (((UINTN)NextMemoryMapEntry < (UINTN)MemoryMapEnd) &&
-          (MemoryMapEntry->Type == NextMemoryMapEntry->Type) &&
-          (MemoryMapEntry->Attribute == NextMemoryMapEntry->Attribute) &&
-          ((MemoryMapEntry->PhysicalStart + MemoryBlockLength) == NextMemoryMapEntry->PhysicalStart))
-      {
-        MemoryMapEntry->NumberOfPages += NextMemoryMapEntry->NumberOfPages;
-        if (NewMemoryMapEntry != MemoryMapEntry) {
-          NewMemoryMapEntry->NumberOfPages += NextMemoryMapEntry->NumberOfPages;
-        }
-
-        NextMemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (NextMemoryMapEntry, DescriptorSize);
-        continue;
-      } else {
-        MemoryMapEntry = PREVIOUS_MEMORY_DESCRIPTOR (NextMemoryMapEntry, DescriptorSize);
-        break;
-      }
-    } while (TRUE);
-
-    MemoryMapEntry    = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
-    NewMemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (NewMemoryMapEntry, DescriptorSize);
-  }
-
-  *MemoryMapSize = (UINTN)NewMemoryMapEntry - (UINTN)MemoryMap;
-
-  return;
-}
-
-/**
-  Enforce memory map attributes.
-  This function will set EfiRuntimeServicesData/EfiMemoryMappedIO/EfiMemoryMappedIOPortSpace to be EFI_MEMORY_XP.
-
-  @param[in, out]  MemoryMap              A pointer to the buffer in which firmware places
-                                          the current memory map.
-  @param[in]       MemoryMapSize          Size, in bytes, of the MemoryMap buffer.
-  @param[in]       DescriptorSize         Size, in bytes, of an individual EFI_MEMORY_DESCRIPTOR.
-**/
-STATIC
-VOID
-EnforceMemoryMapAttribute (
-  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
-  IN UINTN                      MemoryMapSize,
-  IN UINTN                      DescriptorSize
-  )
-{
-  EFI_MEMORY_DESCRIPTOR  *MemoryMapEntry;
-  EFI_MEMORY_DESCRIPTOR  *MemoryMapEnd;
-
-  MemoryMapEntry = MemoryMap;
-  MemoryMapEnd   = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)MemoryMap + MemoryMapSize);
-  while ((UINTN)MemoryMapEntry < (UINTN)MemoryMapEnd) {
-    if (MemoryMapEntry->Attribute != 0) {
-      // It is PE image, the attribute is already set.
-    } else {
-      switch (MemoryMapEntry->Type) {
-        case EfiRuntimeServicesCode:
-          MemoryMapEntry->Attribute = EFI_MEMORY_RO;
-          break;
-        case EfiRuntimeServicesData:
-        default:
-          MemoryMapEntry->Attribute |= EFI_MEMORY_XP;
-          break;
-      }
-    }
-
-    MemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
-  }
-
-  return;
-}
-
 /**
   This function for GetMemoryMap() with memory attributes table.
 
@@ -196,9 +90,10 @@ SmmCoreGetMemoryMapMemoryAttributesTable (
   OUT UINT32                    *DescriptorVersion
   )
 {
-  EFI_STATUS  Status;
-  UINTN       OldMemoryMapSize;
-  UINTN       AdditionalRecordCount;
+  EFI_STATUS             Status;
+  UINTN                  RawMemoryMapSize;
+  UINTN                  AdditionalRecordCount;
+  EFI_MEMORY_DESCRIPTOR  *RawMemoryMap;
 
   //
   // If PE code/data is not aligned, just return.
@@ -213,37 +108,39 @@ SmmCoreGetMemoryMapMemoryAttributesTable (
 
   AdditionalRecordCount = (2 * mImagePropertiesPrivateData.CodeSegmentCountMax + 3) * mImagePropertiesPrivateData.ImageRecordCount;
 
-  OldMemoryMapSize = *MemoryMapSize;
-  Status           = MmCoreGetMemoryMap (MemoryMapSize, MemoryMap, MapKey, DescriptorSize, DescriptorVersion);
-  if (Status == EFI_BUFFER_TOO_SMALL) {
-    *MemoryMapSize = *MemoryMapSize + (*DescriptorSize) * AdditionalRecordCount;
-  } else if (Status == EFI_SUCCESS) {
-    if (OldMemoryMapSize - *MemoryMapSize < (*DescriptorSize) * AdditionalRecordCount) {
-      *MemoryMapSize = *MemoryMapSize + (*DescriptorSize) * AdditionalRecordCount;
-      //
-      // Need update status to buffer too small
-      //
-      Status = EFI_BUFFER_TOO_SMALL;
-    } else {
-      //
-      // Split PE code/data
-      //
-      ASSERT (MemoryMap != NULL);
-      SplitTable (MemoryMapSize, MemoryMap, *DescriptorSize, &mImagePropertiesPrivateData.ImageRecordList, AdditionalRecordCount);
-
-      //
-      // Set RuntimeData to XP
-      //
-      EnforceMemoryMapAttribute (MemoryMap, *MemoryMapSize, *DescriptorSize);
-
-      //
-      // Merge same type to save entry size
-      //
-      MergeMemoryMap (MemoryMap, MemoryMapSize, *DescriptorSize);
-    }
+  //
+  // Query the size of the memory map first, so that it can be placed after the room for the
+  // additional records and the table generated in front of it.
+  //
+  RawMemoryMapSize = 0;
+  MmCoreGetMemoryMap (&RawMemoryMapSize, NULL, MapKey, DescriptorSize, DescriptorVersion);
+  if (*MemoryMapSize < RawMemoryMapSize + (*DescriptorSize) * AdditionalRecordCount) {
+    *MemoryMapSize = RawMemoryMapSize + (*DescriptorSize) * AdditionalRecordCount;
+    return EFI_BUFFER_TOO_SMALL;
   }
 
-  return Status;
+  if (MemoryMap == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  RawMemoryMap = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)MemoryMap + (*DescriptorSize) * AdditionalRecordCount);
+  Status       = MmCoreGetMemoryMap (&RawMemoryMapSize, RawMemoryMap, MapKey, DescriptorSize, DescriptorVersion);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Split PE code/data, set RuntimeData to XP and merge same type to save entry size, all in one pass
+  //
+  *MemoryMapSize = MergeMemoryAttributesTable (
+                     RawMemoryMap,
+                     RawMemoryMapSize,
+                     *DescriptorSize,
+                     &mImagePropertiesPrivateData.ImageRecordList,
+                     MemoryMap
+                     );
+
+  return EFI_SUCCESS;
 }
 
 //
@@ -274,6 +171,7 @@ SmmCreateImageRecordInternal (
   IMAGE_PROPERTIES_RECORD  *ImageRecord;
   CHAR8                    *PdbPointer;
   UINT32                   RequiredAlignment;
+  LIST_ENTRY               *Link;
 
   DEBUG ((DEBUG_VERBOSE, "SMM InsertImageRecord - 0x%x\n", DriverEntry));
 
@@ -334,7 +232,19 @@ SmmCreateImageRecordInternal (
   }
 
   if (NeedInsert) {
-    InsertTailList (&mImagePropertiesPrivateData.ImageRecordList, &ImageRecord->Link);
+    //
+    // Keep the list sorted by image base, the memory attributes table is generated in one pass over it.
+    //
+    for (Link = mImagePropertiesPrivateData.ImageRecordList.BackLink;
+         Link != &mImagePropertiesPrivateData.ImageRecordList;
+         Link = Link->BackLink)
+    {
+      if (CR (Link, IMAGE_PROPERTIES_RECORD, Link, IMAGE_PROPERTIES_RECORD_SIGNATURE)->ImageBase < ImageRecord->ImageBase) {
+        break;
+      }
+    }
+
+    InsertHeadList (Link, &ImageRecord->Link);
     mImagePropertiesPrivateData.ImageRecordCount++;
 
     if (mImagePropertiesPrivateData.CodeSegmentCountMax < ImageRecord->CodeSegmentCount) {
@@ -353,87 +263,83 @@ Finish:
 }
 
 /**
-  This function sets the memory attributes of the read-only data sections of a
-  Pe/Coff image to RO.
-
-  @param[in]  DriverEntry           Driver information
-  @param[in]  IsSupervisorImage     Indicator of whether the DriverEntry represents a supervisor image.
-
-  @retval   EFI_SUCCESS             Image attribute was set up successfully.
-  @retval   EFI_INVALID_PARAMETER   DriverEntry is NULL pointer.
+  This function marks a data range of a Pe/Coff image as XP, and makes everything in it writable
+  except the read-only data sections.
+
+  The whole image is expected to be RO already, so that every writable run between read-only
+  sections only takes one call.
+
+  @param[in]  ImageBase           Base address of the image.
+  @param[in]  Section             Section headers of the image.
+  @param[in]  NumberOfSections    Number of section headers, sorted by virtual address.
+  @param[in]  SectionAlignment    Section alignment of the image.
+  @param[in]  DataStart           Start of the data range.
+  @param[in]  DataEnd             End of the data range.
 **/
-EFI_STATUS
-EFIAPI
-ProtectReadonlyData (
-  IN CONST EFI_MM_DRIVER_ENTRY  *DriverEntry,
-  IN BOOLEAN                    IsSupervisorImage
+STATIC
+VOID
+MarkImageDataRange (
+  IN EFI_PHYSICAL_ADDRESS      ImageBase,
+  IN EFI_IMAGE_SECTION_HEADER  *Section,
+  IN UINTN                     NumberOfSections,
+  IN UINT32                    SectionAlignment,
+  IN EFI_PHYSICAL_ADDRESS      DataStart,
+  IN EFI_PHYSICAL_ADDRESS      DataEnd
   )
 {
-  UINTN                                Index;
-  EFI_IMAGE_DOS_HEADER                 *DosHdr;
-  UINT32                               PeCoffHeaderOffset;
-  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
-  UINT32                               SectionAlignment;
-  EFI_IMAGE_SECTION_HEADER             *Section;
-  UINT64                               SectionStart;
-  UINT64                               SectionEnd;
-  EFI_PHYSICAL_ADDRESS                 ImageBase;
+  UINTN                 Index;
+  UINT64                SectionStart;
+  UINT64                SectionEnd;
+  EFI_PHYSICAL_ADDRESS  WritableStart;
 
-  if (DriverEntry == NULL) {
-    ASSERT (DriverEntry != NULL);
-    return EFI_INVALID_PARAMETER;
-  }
-
-  ImageBase          = DriverEntry->ImageBuffer;
-  DosHdr             = (EFI_IMAGE_DOS_HEADER *)ImageBase;
-  PeCoffHeaderOffset = 0;
-  if (DosHdr->e_magic == EFI_IMAGE_DOS_SIGNATURE) {
-    PeCoffHeaderOffset = DosHdr->e_lfanew;
-  }
-
-  Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)((UINTN)ImageBase + PeCoffHeaderOffset);
-  if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-    SectionAlignment = Hdr.Pe32->OptionalHeader.SectionAlignment;
-  } else {
-    SectionAlignment = Hdr.Pe32Plus->OptionalHeader.SectionAlignment;
-  }
+  DEBUG ((
+    DEBUG_INFO,
+    "Marking 0x%11p - 0x%11p to XP\n",
+    DataStart,
+    DataEnd
+    ));
+  SmmSetMemoryAttributes (DataStart, DataEnd - DataStart, EFI_MEMORY_XP);
 
-  Section = (EFI_IMAGE_SECTION_HEADER *)(
-                                         (UINT8 *)ImageBase +
-                                         PeCoffHeaderOffset +
-                                         sizeof (UINT32) +
-                                         sizeof (EFI_IMAGE_FILE_HEADER) +
-                                         Hdr.Pe32->FileHeader.SizeOfOptionalHeader
-                                         );
+  WritableStart = DataStart;
+  for (Index = 0; Index < NumberOfSections; Index++) {
+    if ((Section[Index].Characteristics & (EFI_IMAGE_SCN_MEM_WRITE | EFI_IMAGE_SCN_CNT_CODE)) != 0) {
+      continue;
+    }
 
-  for (Index = 0; Index < Hdr.Pe32->FileHeader.NumberOfSections; Index++) {
     SectionStart = (UINT64)ImageBase + Section[Index].VirtualAddress;
     SectionEnd   = SectionStart + ALIGN_VALUE (Section[Index].SizeOfRawData, SectionAlignment);
+    if ((SectionEnd <= WritableStart) || (SectionStart >= DataEnd)) {
+      continue;
+    }
 
-    if ((Section[Index].Characteristics & (EFI_IMAGE_SCN_MEM_WRITE | EFI_IMAGE_SCN_CNT_CODE)) == 0) {
-      // Not writable, so set it to RO
-      // Note that we don't need to set it to XP, as the image is already marked as XP.
-      DEBUG ((
-        DEBUG_INFO,
-        "%a Marking 0x%11p - 0x%11p to RO\n",
-        __func__,
-        SectionStart,
-        SectionEnd
-        ));
-      SmmSetMemoryAttributes (
-        SectionStart,
-        SectionEnd - SectionStart,
-        EFI_MEMORY_RO | (IsSupervisorImage ? EFI_MEMORY_SP : 0)
-        );
+    // Not writable, so leave it RO
+    DEBUG ((
+      DEBUG_INFO,
+      "%a Keeping 0x%11p - 0x%11p RO\n",
+      __func__,
+      SectionStart,
+      SectionEnd
+      ));
+    if (SectionStart > WritableStart) {
+      SmmClearMemoryAttributes (WritableStart, SectionStart - WritableStart, EFI_MEMORY_RO);
     }
+
+    WritableStart = SectionEnd;
   }
 
-  return EFI_SUCCESS;
+  if (WritableStart < DataEnd) {
+    SmmClearMemoryAttributes (WritableStart, DataEnd - WritableStart, EFI_MEMORY_RO);
+  }
 }
 
 /**
   This function allows supervisor to mark the target image page attributes after loading.
 
+  Attributes are applied in as few ranges as possible: the whole image first gets RO and the
+  supervisor ownership, code segments drop XP, and every data range between them gets XP and
+  drops RO outside of its read-only data sections. Code is never marked XP on the way, as this
+  also runs on the MM core itself.
+
   @param[in]  DriverEntry           Driver information
   @param[in]  IsSupervisorImage     Indicator of whether the DriverEntry represents a supervisor image.
 
@@ -456,7 +362,13 @@ SmmSetImagePageAttributes (
   LIST_ENTRY                            *ImageRecordCodeSectionList;
   UINTN                                 SupervisorPageAttr;
   EFI_PHYSICAL_ADDRESS                  TempDataAddressStart;
+  EFI_PHYSICAL_ADDRESS                  CodeEnd;
   EFI_PHYSICAL_ADDRESS                  ImageEnd;
+  EFI_IMAGE_DOS_HEADER                  *DosHdr;
+  UINT32                                PeCoffHeaderOffset;
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION   Hdr;
+  UINT32                                SectionAlignment;
+  EFI_IMAGE_SECTION_HEADER              *Section;
   EFI_STATUS                            Status;
 
   if (DriverEntry == NULL) {
@@ -477,6 +389,27 @@ SmmSetImagePageAttributes (
     SupervisorPageAttr = 0;
   }
 
+  DosHdr             = (EFI_IMAGE_DOS_HEADER *)(UINTN)DriverEntry->ImageBuffer;
+  PeCoffHeaderOffset = 0;
+  if (DosHdr->e_magic == EFI_IMAGE_DOS_SIGNATURE) {
+    PeCoffHeaderOffset = DosHdr->e_lfanew;
+  }
+
+  Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)((UINTN)DriverEntry->ImageBuffer + PeCoffHeaderOffset);
+  if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    SectionAlignment = Hdr.Pe32->OptionalHeader.SectionAlignment;
+  } else {
+    SectionAlignment = Hdr.Pe32Plus->OptionalHeader.SectionAlignment;
+  }
+
+  Section = (EFI_IMAGE_SECTION_HEADER *)(
+                                         (UINT8 *)(UINTN)DriverEntry->ImageBuffer +
+                                         PeCoffHeaderOffset +
+                                         sizeof (UINT32) +
+                                         sizeof (EFI_IMAGE_FILE_HEADER) +
+                                         Hdr.Pe32->FileHeader.SizeOfOptionalHeader
+                                         );
+
   DEBUG ((
     DEBUG_INFO,
     "Pre-processing MM driver at 0x%11p Length=0x%11p\n",
@@ -484,8 +417,7 @@ SmmSetImagePageAttributes (
     ReturnImageRecord->ImageSize
     ));
 
-  // Mark the entire image region as RO and non-XP first
-  SmmClearMemoryAttributes (ReturnImageRecord->ImageBase, ReturnImageRecord->ImageSize, EFI_MEMORY_XP);
+  // Mark the entire image region as RO first
   SmmSetMemoryAttributes (ReturnImageRecord->ImageBase, ReturnImageRecord->ImageSize, EFI_MEMORY_RO | SupervisorPageAttr);
 
   ImageRecordCodeSectionList = &ReturnImageRecord->CodeSegmentList;
@@ -502,31 +434,43 @@ SmmSetImagePageAttributes (
                                IMAGE_PROPERTIES_RECORD_CODE_SECTION_SIGNATURE
                                );
     ImageRecordCodeSectionLink = ImageRecordCodeSectionLink->ForwardLink;
+    if (TempDataAddressStart > ImageRecordCodeSection->CodeSegmentBase) {
+      continue;
+    }
+
+    //
+    // CODE
+    //
+    CodeEnd = ImageRecordCodeSection->CodeSegmentBase + ALIGN_VALUE (ImageRecordCodeSection->CodeSegmentSize, EFI_PAGE_SIZE);
+    DEBUG ((
+      DEBUG_INFO,
+      "Marking 0x%11p - 0x%11p to RO and non-XP\n",
+      ImageRecordCodeSection->CodeSegmentBase,
+      CodeEnd
+      ));
+    SmmClearMemoryAttributes (
+      ImageRecordCodeSection->CodeSegmentBase,
+      CodeEnd - ImageRecordCodeSection->CodeSegmentBase,
+      EFI_MEMORY_XP
+      );
+
+    //
+    // DATA
+    //
     if (TempDataAddressStart < ImageRecordCodeSection->CodeSegmentBase) {
-      DEBUG ((
-        DEBUG_INFO,
-        "Marking 0x%11p - 0x%11p to XP and WR\n",
+      MarkImageDataRange (
+        DriverEntry->ImageBuffer,
+        Section,
+        Hdr.Pe32->FileHeader.NumberOfSections,
+        SectionAlignment,
         TempDataAddressStart,
         ImageRecordCodeSection->CodeSegmentBase
-        ));
-      //
-      // DATA
-      //
-      SmmSetMemoryAttributes (
-        TempDataAddressStart,
-        ImageRecordCodeSection->CodeSegmentBase - TempDataAddressStart,
-        EFI_MEMORY_XP | SupervisorPageAttr
-        );
-      SmmClearMemoryAttributes (
-        TempDataAddressStart,
-        ImageRecordCodeSection->CodeSegmentBase - TempDataAddressStart,
-        EFI_MEMORY_RO
         );
+    }
 
-      TempDataAddressStart = ImageRecordCodeSection->CodeSegmentBase + ALIGN_VALUE (ImageRecordCodeSection->CodeSegmentSize, EFI_PAGE_SIZE);
-      if (EFI_SIZE_TO_PAGES (ImageEnd - TempDataAddressStart) == 0) {
-        break;
-      }
+    TempDataAddressStart = CodeEnd;
+    if (EFI_SIZE_TO_PAGES (ImageEnd - TempDataAddressStart) == 0) {
+      break;
     }
   }
 
@@ -534,28 +478,14 @@ SmmSetImagePageAttributes (
   // Final DATA
   //
   if (TempDataAddressStart < ImageEnd) {
-    DEBUG ((
-      DEBUG_INFO,
-      "Marking 0x%11p - 0x%11p to XP and WR\n",
+    MarkImageDataRange (
+      DriverEntry->ImageBuffer,
+      Section,
+      Hdr.Pe32->FileHeader.NumberOfSections,
+      SectionAlignment,
       TempDataAddressStart,
       ImageEnd
-      ));
-    SmmSetMemoryAttributes (
-      TempDataAddressStart,
-      ImageEnd - TempDataAddressStart,
-      EFI_MEMORY_XP | SupervisorPageAttr
       );
-    SmmClearMemoryAttributes (
-      TempDataAddressStart,
-      ImageEnd - TempDataAddressStart,
-      EFI_MEMORY_RO
-      );
-  }
-
-  Status = ProtectReadonlyData (DriverEntry, IsSupervisorImage);
-  if (EFI_ERROR (Status)) {
-    ASSERT_EFI_ERROR (Status);
-    return Status;
   }
 
   return Status;
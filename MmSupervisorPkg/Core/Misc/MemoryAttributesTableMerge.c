@@ -0,0 +1,249 @@
+/** @file
+  Single pass generation of the MM memory attributes table from the memory map and image records.
+
+  The memory map and the image records are both sorted by address, so they are walked side by
+  side and every output descriptor is written once, directly at its final position.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include "MemoryAttributesTableMerge.h"
+
+//
+// Output cursor of the table, Last is the most recently written descriptor or NULL.
+//
+typedef struct {
+  EFI_MEMORY_DESCRIPTOR    *Next;
+  EFI_MEMORY_DESCRIPTOR    *Last;
+  UINTN                    DescriptorSize;
+} MEMORY_ATTRIBUTES_TABLE_WRITER;
+
+/**
+  Append a descriptor to the table, or extend the last one when they are adjacent and alike.
+
+  Descriptors without attributes get EFI_MEMORY_RO for runtime code and EFI_MEMORY_XP otherwise.
+
+  @param[in, out]  Writer           The output cursor.
+  @param[in]       Type             Memory type of the range.
+  @param[in]       PhysicalStart    Start of the range.
+  @param[in]       VirtualStart     Virtual start of the range.
+  @param[in]       NumberOfPages    Size of the range in pages.
+  @param[in]       Attribute        Attributes of the range.
+**/
+STATIC
+VOID
+EmitDescriptor (
+  IN OUT MEMORY_ATTRIBUTES_TABLE_WRITER  *Writer,
+  IN     UINT32                          Type,
+  IN     EFI_PHYSICAL_ADDRESS            PhysicalStart,
+  IN     EFI_VIRTUAL_ADDRESS             VirtualStart,
+  IN     UINT64                          NumberOfPages,
+  IN     UINT64                          Attribute
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *Last;
+
+  if (Attribute == 0) {
+    Attribute = (Type == EfiRuntimeServicesCode) ? EFI_MEMORY_RO : EFI_MEMORY_XP;
+  }
+
+  Last = Writer->Last;
+  if ((Last != NULL) &&
+      (Last->Type == Type) &&
+      (Last->Attribute == Attribute) &&
+      (Last->PhysicalStart + LShiftU64 (Last->NumberOfPages, EFI_PAGE_SHIFT) == PhysicalStart))
+  {
+    Last->NumberOfPages += NumberOfPages;
+    return;
+  }
+
+  Last                = Writer->Next;
+  Last->Type          = Type;
+  Last->PhysicalStart = PhysicalStart;
+  Last->VirtualStart  = VirtualStart;
+  Last->NumberOfPages = NumberOfPages;
+  Last->Attribute     = Attribute;
+  if (Writer->DescriptorSize > sizeof (EFI_MEMORY_DESCRIPTOR)) {
+    ZeroMem (Last + 1, Writer->DescriptorSize - sizeof (EFI_MEMORY_DESCRIPTOR));
+  }
+
+  Writer->Last = Last;
+  Writer->Next = NEXT_MEMORY_DESCRIPTOR (Last, Writer->DescriptorSize);
+}
+
+/**
+  Emit the data and code ranges of an image contained in a memory map descriptor.
+
+  Data ranges start from RangeStart, so any gap between the previous image and this one is
+  accounted as data of this image.
+
+  @param[in, out]  Writer         The output cursor.
+  @param[in]       Descriptor     The memory map descriptor containing the image.
+  @param[in]       RangeStart     Start of the part of Descriptor not emitted yet.
+  @param[in]       ImageRecord    The image record.
+**/
+STATIC
+VOID
+EmitImageRanges (
+  IN OUT MEMORY_ATTRIBUTES_TABLE_WRITER  *Writer,
+  IN     CONST EFI_MEMORY_DESCRIPTOR     *Descriptor,
+  IN     EFI_PHYSICAL_ADDRESS            RangeStart,
+  IN     IMAGE_PROPERTIES_RECORD         *ImageRecord
+  )
+{
+  IMAGE_PROPERTIES_RECORD_CODE_SECTION  *CodeSection;
+  LIST_ENTRY                            *Link;
+  EFI_PHYSICAL_ADDRESS                  PhysicalEnd;
+  EFI_PHYSICAL_ADDRESS                  ImageEnd;
+  UINT64                                Pages;
+
+  PhysicalEnd = Descriptor->PhysicalStart + LShiftU64 (Descriptor->NumberOfPages, EFI_PAGE_SHIFT);
+
+  for (Link = ImageRecord->CodeSegmentList.ForwardLink; Link != &ImageRecord->CodeSegmentList; Link = Link->ForwardLink) {
+    CodeSection = CR (Link, IMAGE_PROPERTIES_RECORD_CODE_SECTION, Link, IMAGE_PROPERTIES_RECORD_CODE_SECTION_SIGNATURE);
+    if (RangeStart > CodeSection->CodeSegmentBase) {
+      continue;
+    }
+
+    //
+    // DATA
+    //
+    Pages = EFI_SIZE_TO_PAGES (CodeSection->CodeSegmentBase - RangeStart);
+    if (Pages != 0) {
+      EmitDescriptor (Writer, Descriptor->Type, RangeStart, 0, Pages, Descriptor->Attribute | EFI_MEMORY_XP);
+    }
+
+    //
+    // CODE
+    //
+    Pages = EFI_SIZE_TO_PAGES (CodeSection->CodeSegmentSize);
+    if (Pages != 0) {
+      EmitDescriptor (Writer, Descriptor->Type, CodeSection->CodeSegmentBase, 0, Pages, (Descriptor->Attribute & ~EFI_MEMORY_XP) | EFI_MEMORY_RO);
+    }
+
+    RangeStart = CodeSection->CodeSegmentBase + EFI_PAGES_TO_SIZE (Pages);
+    if (EFI_SIZE_TO_PAGES (PhysicalEnd - RangeStart) == 0) {
+      break;
+    }
+  }
+
+  //
+  // Final DATA
+  //
+  ImageEnd = ImageRecord->ImageBase + ImageRecord->ImageSize;
+  if (RangeStart < ImageEnd) {
+    EmitDescriptor (Writer, Descriptor->Type, RangeStart, 0, EFI_SIZE_TO_PAGES (ImageEnd - RangeStart), Descriptor->Attribute | EFI_MEMORY_XP);
+  }
+}
+
+/**
+  Generate the memory attributes table from the memory map and the image records.
+
+  Every descriptor fully containing images is split into the data and code ranges of those images,
+  descriptors without attributes get the default protection of their type, and adjacent descriptors
+  with the same type and attributes are coalesced as they are written. The result is the same as
+  SplitTable followed by enforcing and merging the attributes of the split map.
+
+  @param[in]   MemoryMap          The memory map, sorted by PhysicalStart without overlapping descriptors.
+  @param[in]   MemoryMapSize      Size, in bytes, of MemoryMap.
+  @param[in]   DescriptorSize     Size, in bytes, of an individual EFI_MEMORY_DESCRIPTOR.
+  @param[in]   ImageRecordList    List of IMAGE_PROPERTIES_RECORD sorted by ImageBase, with the code
+                                  sections of every record sorted by CodeSegmentBase.
+  @param[out]  Table              Buffer receiving the table. MemoryMap may live in the same buffer, as
+                                  long as it starts at least (2 * CodeSegmentCountMax + 3) * ImageRecordCount
+                                  descriptors after Table.
+
+  @return The size, in bytes, of the generated table.
+**/
+UINTN
+MergeMemoryAttributesTable (
+  IN  CONST EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN  UINTN                        MemoryMapSize,
+  IN  UINTN                        DescriptorSize,
+  IN  LIST_ENTRY                   *ImageRecordList,
+  OUT EFI_MEMORY_DESCRIPTOR        *Table
+  )
+{
+  MEMORY_ATTRIBUTES_TABLE_WRITER  Writer;
+  CONST EFI_MEMORY_DESCRIPTOR     *MemoryMapEntry;
+  CONST EFI_MEMORY_DESCRIPTOR     *MemoryMapEnd;
+  EFI_MEMORY_DESCRIPTOR           Descriptor;
+  LIST_ENTRY                      *ImageLink;
+  IMAGE_PROPERTIES_RECORD         *ImageRecord;
+  EFI_PHYSICAL_ADDRESS            PhysicalStart;
+  EFI_PHYSICAL_ADDRESS            PhysicalEnd;
+  BOOLEAN                         Split;
+
+  Writer.Next           = Table;
+  Writer.Last           = NULL;
+  Writer.DescriptorSize = DescriptorSize;
+
+  ImageLink      = ImageRecordList->ForwardLink;
+  MemoryMapEntry = MemoryMap;
+  MemoryMapEnd   = (CONST EFI_MEMORY_DESCRIPTOR *)((CONST UINT8 *)MemoryMap + MemoryMapSize);
+  while ((UINTN)MemoryMapEntry < (UINTN)MemoryMapEnd) {
+    //
+    // The output may catch up with this entry when it shares the buffer, so work on a copy.
+    //
+    CopyMem (&Descriptor, MemoryMapEntry, sizeof (EFI_MEMORY_DESCRIPTOR));
+    MemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
+
+    PhysicalStart = Descriptor.PhysicalStart;
+    PhysicalEnd   = Descriptor.PhysicalStart + LShiftU64 (Descriptor.NumberOfPages, EFI_PAGE_SHIFT);
+    Split         = FALSE;
+
+    //
+    // Only images entirely inside the descriptor are split out. Images starting below the part
+    // left to emit cannot be contained in it, nor in any later descriptor.
+    //
+    while ((ImageLink != ImageRecordList) && (PhysicalStart < PhysicalEnd)) {
+      ImageRecord = CR (ImageLink, IMAGE_PROPERTIES_RECORD, Link, IMAGE_PROPERTIES_RECORD_SIGNATURE);
+      if (ImageRecord->ImageBase >= PhysicalEnd) {
+        break;
+      }
+
+      ImageLink = ImageLink->ForwardLink;
+      if ((ImageRecord->ImageBase < PhysicalStart) ||
+          (ImageRecord->ImageBase + ImageRecord->ImageSize > PhysicalEnd))
+      {
+        continue;
+      }
+
+      EmitImageRanges (&Writer, &Descriptor, PhysicalStart, ImageRecord);
+      PhysicalStart = ImageRecord->ImageBase + ImageRecord->ImageSize;
+      Split         = TRUE;
+    }
+
+    if (!Split) {
+      EmitDescriptor (
+        &Writer,
+        Descriptor.Type,
+        Descriptor.PhysicalStart,
+        Descriptor.VirtualStart,
+        Descriptor.NumberOfPages,
+        Descriptor.Attribute
+        );
+    } else if (PhysicalStart < PhysicalEnd) {
+      //
+      // Whatever follows the last image keeps the attributes of the descriptor.
+      //
+      EmitDescriptor (
+        &Writer,
+        Descriptor.Type,
+        PhysicalStart,
+        0,
+        EFI_SIZE_TO_PAGES (PhysicalEnd - PhysicalStart),
+        Descriptor.Attribute
+        );
+    }
+  }
+
+  return (UINTN)Writer.Next - (UINTN)Table;
+}
@@ -0,0 +1,42 @@
+/** @file
+  Single pass generation of the MM memory attributes table from the memory map and image records.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef MEMORY_ATTRIBUTES_TABLE_MERGE_H_
+#define MEMORY_ATTRIBUTES_TABLE_MERGE_H_
+
+#include <Library/ImagePropertiesRecordLib.h>
+
+/**
+  Generate the memory attributes table from the memory map and the image records.
+
+  Every descriptor fully containing images is split into the data and code ranges of those images,
+  descriptors without attributes get the default protection of their type, and adjacent descriptors
+  with the same type and attributes are coalesced as they are written. The result is the same as
+  SplitTable followed by enforcing and merging the attributes of the split map.
+
+  @param[in]   MemoryMap          The memory map, sorted by PhysicalStart without overlapping descriptors.
+  @param[in]   MemoryMapSize      Size, in bytes, of MemoryMap.
+  @param[in]   DescriptorSize     Size, in bytes, of an individual EFI_MEMORY_DESCRIPTOR.
+  @param[in]   ImageRecordList    List of IMAGE_PROPERTIES_RECORD sorted by ImageBase, with the code
+                                  sections of every record sorted by CodeSegmentBase.
+  @param[out]  Table              Buffer receiving the table. MemoryMap may live in the same buffer, as
+                                  long as it starts at least (2 * CodeSegmentCountMax + 3) * ImageRecordCount
+                                  descriptors after Table.
+
+  @return The size, in bytes, of the generated table.
+**/
+UINTN
+MergeMemoryAttributesTable (
+  IN  CONST EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN  UINTN                        MemoryMapSize,
+  IN  UINTN                        DescriptorSize,
+  IN  LIST_ENTRY                   *ImageRecordList,
+  OUT EFI_MEMORY_DESCRIPTOR        *Table
+  );
+
+#endif
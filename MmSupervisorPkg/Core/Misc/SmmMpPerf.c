@@ -9,6 +9,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <PiMm.h>
 
+#include <Library/BaseLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/TimerLib.h>
@@ -16,6 +17,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/PerformanceLib.h>
 
 #include "SmmMpPerf.h"
+#include "SmmMpPerfTimeline.h"
 
 #define  SMM_MP_PERF_PROCEDURE_NAME(procedure)  # procedure
 GLOBAL_REMOVE_IF_UNREFERENCED
@@ -23,10 +25,18 @@ CHAR8  *gSmmMpPerfProcedureName[] = {
   SMM_MP_PERF_PROCEDURE_LIST (SMM_MP_PERF_PROCEDURE_NAME)
 };
 //
-// Each element holds the performance data for one processor.
+// Each element holds the event ring of one processor.
 //
 GLOBAL_REMOVE_IF_UNREFERENCED
 SMM_PERF_AP_PROCEDURE_PERFORMANCE  *mSmmMpProcedurePerformance = NULL;
+GLOBAL_REMOVE_IF_UNREFERENCED
+UINTN  mSmmMpPerfNumberOfCpus = 0;
+//
+// Number of completed MMIs. It is advanced by the BSP once all APs have left APHandler(),
+// and sampled by each processor when it enters the rendezvous of the next MMI.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED
+volatile UINT64  mSmmMpPerfSmiSequence = 0;
 
 /**
   Initialize the perf-logging feature for APs.
@@ -38,13 +48,53 @@ InitializeMpPerf (
   UINTN  NumberofCpus
   )
 {
+  UINTN  CpuIndex;
+
   mSmmMpProcedurePerformance = AllocateZeroPool (NumberofCpus * sizeof (*mSmmMpProcedurePerformance));
   ASSERT (mSmmMpProcedurePerformance != NULL);
+  if (mSmmMpProcedurePerformance != NULL) {
+    //
+    // Events logged before a processor first enters the rendezvous, such as InitializeSmm,
+    // do not belong to any MMI.
+    //
+    for (CpuIndex = 0; CpuIndex < NumberofCpus; CpuIndex++) {
+      mSmmMpProcedurePerformance[CpuIndex].SmiSequence = MM_SUPERVISOR_MP_PERF_NO_SMI;
+    }
+
+    mSmmMpPerfNumberOfCpus = NumberofCpus;
+  }
+}
+
+/**
+  Return the index of the oldest event retained by the ring of a processor.
+
+  @param Ring            The event ring.
+  @param Head            The head of the ring sampled by the caller.
+
+  @return The index of the oldest event.
+**/
+UINT64
+MpPerfFirstRetainedEvent (
+  IN SMM_PERF_AP_PROCEDURE_PERFORMANCE  *Ring,
+  IN UINT64                             Head
+  )
+{
+  //
+  // The slot of the oldest event is the one the owner writes next, so leave it out.
+  //
+  if (Head >= SMM_MP_PERF_EVENT_RING_SIZE) {
+    return Head - SMM_MP_PERF_EVENT_RING_SIZE + 1;
+  }
+
+  return 0;
 }
 
 /**
   Migrate MP performance data to standardized performance database.
 
+  Only the events logged since the previous migration are migrated; the rings keep
+  their content for the MP perf request of the supervisor request handler.
+
   @param NumberofCpus    Number of processors in the platform.
   @param BspIndex        The index of the BSP.
 **/
@@ -54,26 +104,34 @@ MigrateMpPerf (
   UINTN  BspIndex
   )
 {
-  UINTN  CpuIndex;
-  UINTN  MpProcecureId;
+  UINTN                              CpuIndex;
+  SMM_PERF_AP_PROCEDURE_PERFORMANCE  *Ring;
+  MM_SUPERVISOR_MP_PERF_EVENT        *Event;
+  UINT64                             Head;
+  UINT64                             Index;
 
   for (CpuIndex = 0; CpuIndex < NumberofCpus; CpuIndex++) {
+    Ring = &mSmmMpProcedurePerformance[CpuIndex];
+    Head = Ring->Head;
     if ((CpuIndex != BspIndex) && !FeaturePcdGet (PcdSmmApPerfLogEnable)) {
       //
       // Skip migrating AP performance data if AP perf-logging is disabled.
       //
+      Ring->Migrated = Head;
       continue;
     }
 
-    for (MpProcecureId = 0; MpProcecureId < SMM_MP_PERF_PROCEDURE_ID (SmmMpProcedureMax); MpProcecureId++) {
-      if (mSmmMpProcedurePerformance[CpuIndex].Begin[MpProcecureId] != 0) {
-        PERF_START (NULL, gSmmMpPerfProcedureName[MpProcecureId], NULL, mSmmMpProcedurePerformance[CpuIndex].Begin[MpProcecureId]);
-        PERF_END (NULL, gSmmMpPerfProcedureName[MpProcecureId], NULL, mSmmMpProcedurePerformance[CpuIndex].End[MpProcecureId]);
-      }
+    Index = MAX (Ring->Migrated, MpPerfFirstRetainedEvent (Ring, Head));
+    for ( ; Index < Head; Index++) {
+      Event = &Ring->Events[Index & (SMM_MP_PERF_EVENT_RING_SIZE - 1)];
+      PERF_START (NULL, gSmmMpPerfProcedureName[Event->ProcedureId], NULL, Event->Begin);
+      PERF_END (NULL, gSmmMpPerfProcedureName[Event->ProcedureId], NULL, Event->End);
     }
+
+    Ring->Migrated = Head;
   }
 
-  ZeroMem (mSmmMpProcedurePerformance, NumberofCpus * sizeof (*mSmmMpProcedurePerformance));
+  mSmmMpPerfSmiSequence++;
 }
 
 /**
@@ -88,7 +146,14 @@ MpPerfBegin (
   IN UINTN  MpProcedureId
   )
 {
-  mSmmMpProcedurePerformance[CpuIndex].Begin[MpProcedureId] = GetPerformanceCounter ();
+  SMM_PERF_AP_PROCEDURE_PERFORMANCE  *Ring;
+
+  Ring = &mSmmMpProcedurePerformance[CpuIndex];
+  if (MpProcedureId == SMM_MP_PERF_PROCEDURE_ID (SmmRendezvousEntry)) {
+    Ring->SmiSequence = mSmmMpPerfSmiSequence;
+  }
+
+  Ring->Begin[MpProcedureId] = GetPerformanceCounter ();
 }
 
 /**
@@ -103,5 +168,106 @@ MpPerfEnd (
   IN UINTN  MpProcedureId
   )
 {
-  mSmmMpProcedurePerformance[CpuIndex].End[MpProcedureId] = GetPerformanceCounter ();
+  SMM_PERF_AP_PROCEDURE_PERFORMANCE  *Ring;
+  MM_SUPERVISOR_MP_PERF_EVENT        *Event;
+  UINT64                             End;
+
+  End  = GetPerformanceCounter ();
+  Ring = &mSmmMpProcedurePerformance[CpuIndex];
+
+  Event              = &Ring->Events[Ring->Head & (SMM_MP_PERF_EVENT_RING_SIZE - 1)];
+  Event->SmiSequence = Ring->SmiSequence;
+  Event->Begin       = Ring->Begin[MpProcedureId];
+  Event->End         = End;
+  Event->CpuIndex    = (UINT32)CpuIndex;
+  Event->ProcedureId = (UINT32)MpProcedureId;
+
+  //
+  // Publish the event only once it is complete.
+  //
+  MemoryFence ();
+  Ring->Head++;
+}
+
+/**
+  Process the MP perf request of the supervisor request handler.
+
+  @param MpPerfBuffer    The request parameters.
+  @param BufferSize      Size of the buffer holding MpPerfBuffer and the events that follow it.
+
+  @retval EFI_SUCCESS            The request is completed.
+  @retval EFI_INVALID_PARAMETER  The command is unknown.
+  @retval EFI_NOT_READY          MP perf logging is not enabled.
+  @retval EFI_NOT_FOUND          No events are retained for the requested MMI.
+**/
+EFI_STATUS
+ProcessMpPerfRequest (
+  IN OUT MM_SUPERVISOR_MP_PERF_BUFFER  *MpPerfBuffer,
+  IN     UINTN                         BufferSize
+  )
+{
+  SMM_PERF_AP_PROCEDURE_PERFORMANCE  *Ring;
+  SMM_MP_PERF_TIMELINE               Timeline;
+  MM_SUPERVISOR_MP_PERF_EVENT        *Events;
+  UINTN                              CpuIndex;
+  UINT64                             SmiSequence;
+  UINT64                             Head;
+  UINT64                             Index;
+  UINT64                             Total;
+  UINT64                             Copied;
+  UINT64                             Capacity;
+
+  if (mSmmMpProcedurePerformance == NULL) {
+    return EFI_NOT_READY;
+  }
+
+  switch (MpPerfBuffer->Command) {
+    case MM_SUPERVISOR_MP_PERF_GET_SUMMARY:
+      SmiSequence = MpPerfBuffer->SmiSequence;
+      if (SmiSequence == MM_SUPERVISOR_MP_PERF_LAST_SMI) {
+        if (mSmmMpPerfSmiSequence == 0) {
+          return EFI_NOT_FOUND;
+        }
+
+        SmiSequence = mSmmMpPerfSmiSequence - 1;
+      }
+
+      MpPerfTimelineInit (&Timeline, SmiSequence);
+      for (CpuIndex = 0; CpuIndex < mSmmMpPerfNumberOfCpus; CpuIndex++) {
+        Ring = &mSmmMpProcedurePerformance[CpuIndex];
+        MpPerfTimelineAddCpu (&Timeline, Ring->Events, (UINTN)MIN (Ring->Head, SMM_MP_PERF_EVENT_RING_SIZE));
+      }
+
+      MpPerfBuffer->SmiSequence = SmiSequence;
+      return MpPerfTimelineGetSummary (&Timeline, &MpPerfBuffer->Summary);
+
+    case MM_SUPERVISOR_MP_PERF_GET_EVENTS:
+      //
+      // Events are reported processor by processor, oldest first.
+      //
+      Events   = (MM_SUPERVISOR_MP_PERF_EVENT *)(MpPerfBuffer + 1);
+      Capacity = (BufferSize - sizeof (*MpPerfBuffer)) / sizeof (*Events);
+      Total    = 0;
+      Copied   = 0;
+      for (CpuIndex = 0; CpuIndex < mSmmMpPerfNumberOfCpus; CpuIndex++) {
+        Ring = &mSmmMpProcedurePerformance[CpuIndex];
+        Head = Ring->Head;
+        for (Index = MpPerfFirstRetainedEvent (Ring, Head); Index < Head; Index++) {
+          if ((Total >= MpPerfBuffer->EventOffset) && (Copied < Capacity)) {
+            CopyMem (&Events[Copied], &Ring->Events[Index & (SMM_MP_PERF_EVENT_RING_SIZE - 1)], sizeof (*Events));
+            Copied++;
+          }
+
+          Total++;
+        }
+      }
+
+      MpPerfBuffer->TotalEvents = Total;
+      MpPerfBuffer->EventCount  = Copied;
+      MpPerfBuffer->EventOffset = MIN (MpPerfBuffer->EventOffset, Total) + Copied;
+      return EFI_SUCCESS;
+
+    default:
+      return EFI_INVALID_PARAMETER;
+  }
 }
@@ -10,6 +10,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #ifndef MP_PERF_H_
 #define MP_PERF_H_
 
+#include <Guid/MmSupervisorRequestData.h>
+
 //
 // The list of all MP procedures that need to be perf-logged.
 //
@@ -29,9 +31,21 @@ enum {
   SMM_MP_PERF_PROCEDURE_LIST (SMM_MP_PERF_PROCEDURE_ID)
 };
 
+//
+// Number of events each processor retains. Must be a power of 2.
+//
+#define  SMM_MP_PERF_EVENT_RING_SIZE  64
+
+//
+// Append-only event ring of one processor. Only the owning processor writes to it;
+// an event is published by incrementing Head after it has been written.
+//
 typedef struct {
-  UINT64    Begin[SMM_MP_PERF_PROCEDURE_ID (SmmMpProcedureMax)];
-  UINT64    End[SMM_MP_PERF_PROCEDURE_ID (SmmMpProcedureMax)];
+  volatile UINT64                Head;         // Number of events ever appended
+  UINT64                         Migrated;     // Number of events migrated to the performance database
+  UINT64                         SmiSequence;  // MMI the processor is currently in
+  UINT64                         Begin[SMM_MP_PERF_PROCEDURE_ID (SmmMpProcedureMax)];
+  MM_SUPERVISOR_MP_PERF_EVENT    Events[SMM_MP_PERF_EVENT_RING_SIZE];
 } SMM_PERF_AP_PROCEDURE_PERFORMANCE;
 
 /**
@@ -80,4 +94,21 @@ MpPerfEnd (
   IN UINTN  MpProcedureId
   );
 
+/**
+  Process the MP perf request of the supervisor request handler.
+
+  @param MpPerfBuffer    The request parameters.
+  @param BufferSize      Size of the buffer holding MpPerfBuffer and the events that follow it.
+
+  @retval EFI_SUCCESS            The request is completed.
+  @retval EFI_INVALID_PARAMETER  The command is unknown.
+  @retval EFI_NOT_READY          MP perf logging is not enabled.
+  @retval EFI_NOT_FOUND          No events are retained for the requested MMI.
+**/
+EFI_STATUS
+ProcessMpPerfRequest (
+  IN OUT MM_SUPERVISOR_MP_PERF_BUFFER  *MpPerfBuffer,
+  IN     UINTN                         BufferSize
+  );
+
 #endif
@@ -0,0 +1,151 @@
+/** @file
+  Aggregation of the MP procedure timeline logged by SmmMpPerf into per-MMI summaries.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseMemoryLib.h>
+
+#include "SmmMpPerfTimeline.h"
+
+/**
+  Start the summary of one MMI.
+
+  @param Timeline       The accumulator to initialize.
+  @param SmiSequence    The sequence number of the MMI to summarize.
+**/
+VOID
+MpPerfTimelineInit (
+  OUT SMM_MP_PERF_TIMELINE  *Timeline,
+  IN  UINT64                SmiSequence
+  )
+{
+  ZeroMem (Timeline, sizeof (*Timeline));
+  Timeline->Summary.SmiSequence = SmiSequence;
+}
+
+/**
+  Account the events of one processor.
+
+  The events may be in any order. Events of other MMIs, and events logged outside of any
+  MMI, are ignored. Every processor must be added at most once.
+
+  @param Timeline       The accumulator.
+  @param Events         The events logged by the processor.
+  @param EventCount     The number of events.
+**/
+VOID
+MpPerfTimelineAddCpu (
+  IN OUT SMM_MP_PERF_TIMELINE               *Timeline,
+  IN     CONST MM_SUPERVISOR_MP_PERF_EVENT  *Events,
+  IN     UINTN                              EventCount
+  )
+{
+  MM_SUPERVISOR_MP_PERF_SUMMARY  *Summary;
+  UINTN                          Index;
+  BOOLEAN                        Found;
+  UINT64                         Arrival;
+  UINT64                         Departure;
+  UINT64                         Longest;
+  UINT32                         LongestProcedureId;
+  UINT32                         CpuIndex;
+
+  Summary            = &Timeline->Summary;
+  Found              = FALSE;
+  Arrival            = 0;
+  Departure          = 0;
+  Longest            = 0;
+  LongestProcedureId = 0;
+  CpuIndex           = 0;
+
+  for (Index = 0; Index < EventCount; Index++) {
+    if ((Events[Index].SmiSequence != Summary->SmiSequence) ||
+        (Events[Index].SmiSequence == MM_SUPERVISOR_MP_PERF_NO_SMI))
+    {
+      continue;
+    }
+
+    if (!Found || (Events[Index].Begin < Arrival)) {
+      Arrival = Events[Index].Begin;
+    }
+
+    if (!Found || (Events[Index].End > Departure)) {
+      Departure = Events[Index].End;
+    }
+
+    if (!Found || (Events[Index].End - Events[Index].Begin > Longest)) {
+      Longest            = Events[Index].End - Events[Index].Begin;
+      LongestProcedureId = Events[Index].ProcedureId;
+    }
+
+    CpuIndex = Events[Index].CpuIndex;
+    Found    = TRUE;
+  }
+
+  if (!Found) {
+    return;
+  }
+
+  if (Summary->CpuCount == 0) {
+    Timeline->ArrivalBase        = Arrival;
+    Summary->FirstArrival        = Arrival;
+    Summary->LastArrival         = Arrival;
+    Summary->StragglerCpu        = CpuIndex;
+    Summary->LastDeparture       = Departure;
+    Summary->CriticalCpu         = CpuIndex;
+    Summary->CriticalProcedureId = LongestProcedureId;
+  } else {
+    if (Arrival < Summary->FirstArrival) {
+      Summary->FirstArrival = Arrival;
+    }
+
+    if (Arrival > Summary->LastArrival) {
+      Summary->LastArrival  = Arrival;
+      Summary->StragglerCpu = CpuIndex;
+    }
+
+    if (Departure > Summary->LastDeparture) {
+      Summary->LastDeparture       = Departure;
+      Summary->CriticalCpu         = CpuIndex;
+      Summary->CriticalProcedureId = LongestProcedureId;
+    }
+  }
+
+  Timeline->ArrivalOffsetSum += (INT64)(Arrival - Timeline->ArrivalBase);
+  Summary->CpuCount++;
+}
+
+/**
+  Complete the summary once all processors have been added.
+
+  @param Timeline       The accumulator.
+  @param Summary        Receives the summary of the MMI.
+
+  @retval EFI_SUCCESS       The summary is returned.
+  @retval EFI_NOT_FOUND     No processor logged events during the MMI.
+**/
+EFI_STATUS
+MpPerfTimelineGetSummary (
+  IN  SMM_MP_PERF_TIMELINE           *Timeline,
+  OUT MM_SUPERVISOR_MP_PERF_SUMMARY  *Summary
+  )
+{
+  CopyMem (Summary, &Timeline->Summary, sizeof (*Summary));
+  if (Summary->CpuCount == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  Summary->CriticalPath = Summary->LastDeparture - Summary->FirstArrival;
+  Summary->ArrivalSkew  = Summary->LastArrival - Summary->FirstArrival;
+
+  //
+  // Every processor waits from its arrival until the last one arrives.
+  //
+  Summary->RendezvousWait = (UINT64)((INT64)Summary->CpuCount * (INT64)(Summary->LastArrival - Timeline->ArrivalBase) - Timeline->ArrivalOffsetSum);
+
+  return EFI_SUCCESS;
+}
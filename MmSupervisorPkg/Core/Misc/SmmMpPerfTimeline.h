@@ -0,0 +1,68 @@
+/** @file
+  Aggregation of the MP procedure timeline logged by SmmMpPerf into per-MMI summaries.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef MP_PERF_TIMELINE_H_
+#define MP_PERF_TIMELINE_H_
+
+#include <Guid/MmSupervisorRequestData.h>
+
+//
+// Accumulator of the events of one MMI. Arrivals are summed relative to the first
+// processor added, so the rendezvous wait can be computed in one pass over each processor.
+//
+typedef struct {
+  MM_SUPERVISOR_MP_PERF_SUMMARY    Summary;
+  UINT64                           ArrivalBase;
+  INT64                            ArrivalOffsetSum;
+} SMM_MP_PERF_TIMELINE;
+
+/**
+  Start the summary of one MMI.
+
+  @param Timeline       The accumulator to initialize.
+  @param SmiSequence    The sequence number of the MMI to summarize.
+**/
+VOID
+MpPerfTimelineInit (
+  OUT SMM_MP_PERF_TIMELINE  *Timeline,
+  IN  UINT64                SmiSequence
+  );
+
+/**
+  Account the events of one processor.
+
+  The events may be in any order. Events of other MMIs, and events logged outside of any
+  MMI, are ignored. Every processor must be added at most once.
+
+  @param Timeline       The accumulator.
+  @param Events         The events logged by the processor.
+  @param EventCount     The number of events.
+**/
+VOID
+MpPerfTimelineAddCpu (
+  IN OUT SMM_MP_PERF_TIMELINE               *Timeline,
+  IN     CONST MM_SUPERVISOR_MP_PERF_EVENT  *Events,
+  IN     UINTN                              EventCount
+  );
+
+/**
+  Complete the summary once all processors have been added.
+
+  @param Timeline       The accumulator.
+  @param Summary        Receives the summary of the MMI.
+
+  @retval EFI_SUCCESS       The summary is returned.
+  @retval EFI_NOT_FOUND     No processor logged events during the MMI.
+**/
+EFI_STATUS
+MpPerfTimelineGetSummary (
+  IN  SMM_MP_PERF_TIMELINE           *Timeline,
+  OUT MM_SUPERVISOR_MP_PERF_SUMMARY  *Summary
+  );
+
+#endif
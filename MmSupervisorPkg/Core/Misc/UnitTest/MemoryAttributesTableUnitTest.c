@@ -0,0 +1,703 @@
+/** @file
+  Unit tests of the single pass generation of the MM memory attributes table.
+
+  The generated tables are compared byte for byte with the previous algorithm, which split the
+  memory map with SplitTable, then enforced and merged the attributes of the result in place.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <PiMm.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/ImagePropertiesRecordLib.h>
+
+#include <Library/UnitTestLib.h>
+#include <UnitTest/UnitTestRandom.h>
+
+#include "../MemoryAttributesTableMerge.h"
+
+#define UNIT_TEST_APP_NAME     "MM Supervisor Memory Attributes Table Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Same descriptor size as MmCoreGetMemoryMap, padded so that pointer math on
+// sizeof (EFI_MEMORY_DESCRIPTOR) is caught.
+//
+#define TEST_DESCRIPTOR_SIZE  (sizeof (EFI_MEMORY_DESCRIPTOR) + sizeof (UINT64))
+
+#define TEST_MAP_BASE        0x7F000000ull
+#define TEST_MAX_MAP_ENTRIES  64
+#define TEST_ITERATIONS      2000
+
+#define PREVIOUS_MEMORY_DESCRIPTOR(MemoryDescriptor, Size) \
+  ((EFI_MEMORY_DESCRIPTOR *)((UINT8 *)(MemoryDescriptor) - (Size)))
+
+//
+// Code sections of a test image, in pages from the image base and in bytes.
+//
+typedef struct {
+  UINTN     PageOffset;
+  UINT64    Size;
+} TEST_CODE_SECTION;
+
+// ----------------------------------------------------------------------------------------
+// Reference implementation, as found in MemoryAttributesTable.c before the single pass merge
+// ----------------------------------------------------------------------------------------
+
+/**
+  Merge continuous memory map entries whose have same attributes.
+
+  @param[in, out]  MemoryMap              A pointer to the buffer in which firmware places
+                                          the current memory map.
+  @param[in, out]  MemoryMapSize          A pointer to the size, in bytes, of the
+                                          MemoryMap buffer. On input, this is the size of
+                                          the current memory map.  On output,
+                                          it is the size of new memory map after merge.
+  @param[in]       DescriptorSize         Size, in bytes, of an individual EFI_MEMORY_DESCRIPTOR.
+**/
+STATIC
+VOID
+ReferenceMergeMemoryMap (
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN OUT UINTN                  *MemoryMapSize,
+  IN UINTN                      DescriptorSize
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *MemoryMapEntry;
+  EFI_MEMORY_DESCRIPTOR  *MemoryMapEnd;
+  UINT64                 MemoryBlockLength;
+  EFI_MEMORY_DESCRIPTOR  *NewMemoryMapEntry;
+  EFI_MEMORY_DESCRIPTOR  *NextMemoryMapEntry;
+
+  MemoryMapEntry    = MemoryMap;
+  NewMemoryMapEntry = MemoryMap;
+  MemoryMapEnd      = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)MemoryMap + *MemoryMapSize);
+  while ((UINTN)MemoryMapEntry < (UINTN)MemoryMapEnd) {
+    CopyMem (NewMemoryMapEntry, MemoryMapEntry, sizeof (EFI_MEMORY_DESCRIPTOR));
+    NextMemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
+
+    do {
+      MemoryBlockLength = LShiftU64 (MemoryMapEntry->NumberOfPages, EFI_PAGE_SHIFT);
+      if (((UINTN)NextMemoryMapEntry < (UINTN)MemoryMapEnd) &&
+          (MemoryMapEntry->Type == NextMemoryMapEntry->Type) &&
+          (MemoryMapEntry->Attribute == NextMemoryMapEntry->Attribute) &&
+          ((MemoryMapEntry->PhysicalStart + MemoryBlockLength) == NextMemoryMapEntry->PhysicalStart))
+      {
+        MemoryMapEntry->NumberOfPages += NextMemoryMapEntry->NumberOfPages;
+        if (NewMemoryMapEntry != MemoryMapEntry) {
+          NewMemoryMapEntry->NumberOfPages += NextMemoryMapEntry->NumberOfPages;
+        }
+
+        NextMemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (NextMemoryMapEntry, DescriptorSize);
+        continue;
+      } else {
+        MemoryMapEntry = PREVIOUS_MEMORY_DESCRIPTOR (NextMemoryMapEntry, DescriptorSize);
+        break;
+      }
+    } while (TRUE);
+
+    MemoryMapEntry    = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
+    NewMemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (NewMemoryMapEntry, DescriptorSize);
+  }
+
+  *MemoryMapSize = (UINTN)NewMemoryMapEntry - (UINTN)MemoryMap;
+
+  return;
+}
+
+/**
+  Enforce memory map attributes.
+  This function will set EfiRuntimeServicesData/EfiMemoryMappedIO/EfiMemoryMappedIOPortSpace to be EFI_MEMORY_XP.
+
+  @param[in, out]  MemoryMap              A pointer to the buffer in which firmware places
+                                          the current memory map.
+  @param[in]       MemoryMapSize          Size, in bytes, of the MemoryMap buffer.
+  @param[in]       DescriptorSize         Size, in bytes, of an individual EFI_MEMORY_DESCRIPTOR.
+**/
+STATIC
+VOID
+ReferenceEnforceMemoryMapAttribute (
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN UINTN                      MemoryMapSize,
+  IN UINTN                      DescriptorSize
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *MemoryMapEntry;
+  EFI_MEMORY_DESCRIPTOR  *MemoryMapEnd;
+
+  MemoryMapEntry = MemoryMap;
+  MemoryMapEnd   = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)MemoryMap + MemoryMapSize);
+  while ((UINTN)MemoryMapEntry < (UINTN)MemoryMapEnd) {
+    if (MemoryMapEntry->Attribute != 0) {
+      // It is PE image, the attribute is already set.
+    } else {
+      switch (MemoryMapEntry->Type) {
+        case EfiRuntimeServicesCode:
+          MemoryMapEntry->Attribute = EFI_MEMORY_RO;
+          break;
+        case EfiRuntimeServicesData:
+        default:
+          MemoryMapEntry->Attribute |= EFI_MEMORY_XP;
+          break;
+      }
+    }
+
+    MemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
+  }
+
+  return;
+}
+
+// ----------------------------------------------------------------------------------------
+// Helpers
+// ----------------------------------------------------------------------------------------
+
+/**
+  Append a descriptor to a test memory map.
+
+  @param[in, out]  MemoryMap      The memory map.
+  @param[in, out]  Count          Number of descriptors in the map, updated.
+  @param[in]       Type           Memory type of the descriptor.
+  @param[in]       PhysicalStart  Start of the descriptor.
+  @param[in]       NumberOfPages  Size of the descriptor in pages.
+  @param[in]       Attribute      Attributes of the descriptor.
+**/
+STATIC
+VOID
+AddDescriptor (
+  IN OUT UINT8                 *MemoryMap,
+  IN OUT UINTN                 *Count,
+  IN     UINT32                Type,
+  IN     EFI_PHYSICAL_ADDRESS  PhysicalStart,
+  IN     UINT64                NumberOfPages,
+  IN     UINT64                Attribute
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *Descriptor;
+
+  Descriptor = (EFI_MEMORY_DESCRIPTOR *)(MemoryMap + *Count * TEST_DESCRIPTOR_SIZE);
+  ZeroMem (Descriptor, TEST_DESCRIPTOR_SIZE);
+  Descriptor->Type          = Type;
+  Descriptor->PhysicalStart = PhysicalStart;
+  Descriptor->NumberOfPages = NumberOfPages;
+  Descriptor->Attribute     = Attribute;
+  (*Count)++;
+}
+
+/**
+  Insert an image record into a list sorted by image base, as InsertImageRecord does.
+
+  @param[in, out]  ImageRecordList      The image record list.
+  @param[in, out]  CodeSegmentCountMax  Highest code section count of the list, updated.
+  @param[in]       ImageBase            Base of the image.
+  @param[in]       ImagePages           Size of the image in pages.
+  @param[in]       CodeSections         Code sections of the image, sorted.
+  @param[in]       CodeSectionCount     Number of code sections.
+**/
+STATIC
+VOID
+AddImageRecord (
+  IN OUT LIST_ENTRY               *ImageRecordList,
+  IN OUT UINTN                    *CodeSegmentCountMax,
+  IN     EFI_PHYSICAL_ADDRESS     ImageBase,
+  IN     UINTN                    ImagePages,
+  IN     CONST TEST_CODE_SECTION  *CodeSections,
+  IN     UINTN                    CodeSectionCount
+  )
+{
+  IMAGE_PROPERTIES_RECORD               *ImageRecord;
+  IMAGE_PROPERTIES_RECORD_CODE_SECTION  *CodeSection;
+  UINTN                                 Index;
+  LIST_ENTRY                            *Link;
+
+  ImageRecord = AllocateZeroPool (sizeof (IMAGE_PROPERTIES_RECORD));
+  assert_non_null (ImageRecord);
+  ImageRecord->Signature        = IMAGE_PROPERTIES_RECORD_SIGNATURE;
+  ImageRecord->ImageBase        = ImageBase;
+  ImageRecord->ImageSize        = EFI_PAGES_TO_SIZE (ImagePages);
+  ImageRecord->CodeSegmentCount = CodeSectionCount;
+  InitializeListHead (&ImageRecord->CodeSegmentList);
+
+  for (Index = 0; Index < CodeSectionCount; Index++) {
+    CodeSection = AllocateZeroPool (sizeof (IMAGE_PROPERTIES_RECORD_CODE_SECTION));
+    assert_non_null (CodeSection);
+    CodeSection->Signature       = IMAGE_PROPERTIES_RECORD_CODE_SECTION_SIGNATURE;
+    CodeSection->CodeSegmentBase = ImageBase + EFI_PAGES_TO_SIZE (CodeSections[Index].PageOffset);
+    CodeSection->CodeSegmentSize = CodeSections[Index].Size;
+    InsertTailList (&ImageRecord->CodeSegmentList, &CodeSection->Link);
+  }
+
+  for (Link = ImageRecordList->BackLink; Link != ImageRecordList; Link = Link->BackLink) {
+    if (CR (Link, IMAGE_PROPERTIES_RECORD, Link, IMAGE_PROPERTIES_RECORD_SIGNATURE)->ImageBase < ImageBase) {
+      break;
+    }
+  }
+
+  InsertHeadList (Link, &ImageRecord->Link);
+  if (*CodeSegmentCountMax < CodeSectionCount) {
+    *CodeSegmentCountMax = CodeSectionCount;
+  }
+}
+
+/**
+  Free all image records of a list.
+
+  @param[in, out]  ImageRecordList  The image record list.
+**/
+STATIC
+VOID
+FreeImageRecords (
+  IN OUT LIST_ENTRY  *ImageRecordList
+  )
+{
+  IMAGE_PROPERTIES_RECORD               *ImageRecord;
+  IMAGE_PROPERTIES_RECORD_CODE_SECTION  *CodeSection;
+
+  while (!IsListEmpty (ImageRecordList)) {
+    ImageRecord = CR (ImageRecordList->ForwardLink, IMAGE_PROPERTIES_RECORD, Link, IMAGE_PROPERTIES_RECORD_SIGNATURE);
+    while (!IsListEmpty (&ImageRecord->CodeSegmentList)) {
+      CodeSection = CR (ImageRecord->CodeSegmentList.ForwardLink, IMAGE_PROPERTIES_RECORD_CODE_SECTION, Link, IMAGE_PROPERTIES_RECORD_CODE_SECTION_SIGNATURE);
+      RemoveEntryList (&CodeSection->Link);
+      FreePool (CodeSection);
+    }
+
+    RemoveEntryList (&ImageRecord->Link);
+    FreePool (ImageRecord);
+  }
+}
+
+/**
+  Generate the table of a memory map with both algorithms and compare them.
+
+  The single pass merge runs in place, with the memory map placed after the room for the
+  additional records as SmmCoreGetMemoryMapMemoryAttributesTable does.
+
+  @param[in]  MemoryMap            The memory map.
+  @param[in]  Count                Number of descriptors in the map.
+  @param[in]  ImageRecordList      The image records, sorted by image base.
+  @param[in]  CodeSegmentCountMax  Highest code section count of the image records.
+
+  @retval TRUE   Both tables are identical.
+  @retval FALSE  The tables differ.
+**/
+STATIC
+BOOLEAN
+TablesMatch (
+  IN CONST UINT8  *MemoryMap,
+  IN UINTN        Count,
+  IN LIST_ENTRY   *ImageRecordList,
+  IN UINTN        CodeSegmentCountMax
+  )
+{
+  UINTN       AdditionalRecordCount;
+  UINTN       ImageRecordCount;
+  LIST_ENTRY  *Link;
+  UINTN       BufferSize;
+  UINT8       *Reference;
+  UINTN       ReferenceSize;
+  UINT8       *Actual;
+  UINTN       ActualSize;
+  BOOLEAN     Same;
+
+  ImageRecordCount = 0;
+  for (Link = ImageRecordList->ForwardLink; Link != ImageRecordList; Link = Link->ForwardLink) {
+    ImageRecordCount++;
+  }
+
+  AdditionalRecordCount = (2 * CodeSegmentCountMax + 3) * ImageRecordCount;
+  BufferSize            = (Count + AdditionalRecordCount) * TEST_DESCRIPTOR_SIZE;
+
+  Reference = AllocateZeroPool (BufferSize);
+  Actual    = AllocateZeroPool (BufferSize);
+  assert_non_null (Reference);
+  assert_non_null (Actual);
+
+  CopyMem (Reference, MemoryMap, Count * TEST_DESCRIPTOR_SIZE);
+  ReferenceSize = Count * TEST_DESCRIPTOR_SIZE;
+  SplitTable (&ReferenceSize, (EFI_MEMORY_DESCRIPTOR *)Reference, TEST_DESCRIPTOR_SIZE, ImageRecordList, AdditionalRecordCount);
+  ReferenceEnforceMemoryMapAttribute ((EFI_MEMORY_DESCRIPTOR *)Reference, ReferenceSize, TEST_DESCRIPTOR_SIZE);
+  ReferenceMergeMemoryMap ((EFI_MEMORY_DESCRIPTOR *)Reference, &ReferenceSize, TEST_DESCRIPTOR_SIZE);
+
+  CopyMem (Actual + AdditionalRecordCount * TEST_DESCRIPTOR_SIZE, MemoryMap, Count * TEST_DESCRIPTOR_SIZE);
+  ActualSize = MergeMemoryAttributesTable (
+                 (EFI_MEMORY_DESCRIPTOR *)(Actual + AdditionalRecordCount * TEST_DESCRIPTOR_SIZE),
+                 Count * TEST_DESCRIPTOR_SIZE,
+                 TEST_DESCRIPTOR_SIZE,
+                 ImageRecordList,
+                 (EFI_MEMORY_DESCRIPTOR *)Actual
+                 );
+
+  Same = (BOOLEAN)((ActualSize == ReferenceSize) && (CompareMem (Actual, Reference, ActualSize) == 0));
+
+  FreePool (Reference);
+  FreePool (Actual);
+  return Same;
+}
+
+// ----------------------------------------------------------------------------------------
+// Tests
+// ----------------------------------------------------------------------------------------
+
+/**
+  Images loaded in descriptors of their own should be split into code and data, and the
+  surrounding descriptors merged.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SplitsImagesInOwnDescriptors (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                    MemoryMap[8 * TEST_DESCRIPTOR_SIZE];
+  UINTN                    Count;
+  LIST_ENTRY               ImageRecordList;
+  UINTN                    CodeSegmentCountMax;
+  EFI_MEMORY_DESCRIPTOR    *Table;
+  EFI_MEMORY_DESCRIPTOR    *Entry;
+  UINTN                    TableSize;
+  CONST TEST_CODE_SECTION  SingleCode[] = {
+    { 1, 0x2800 }
+  };
+  CONST TEST_CODE_SECTION  DoubleCode[] = {
+    { 1, 0x1000 }, { 3, 0x1200 }
+  };
+
+  InitializeListHead (&ImageRecordList);
+  CodeSegmentCountMax = 0;
+  Count               = 0;
+
+  AddDescriptor (MemoryMap, &Count, EfiRuntimeServicesData, TEST_MAP_BASE, 16, 0);
+  AddDescriptor (MemoryMap, &Count, EfiRuntimeServicesCode, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (16), 8, 0);
+  AddDescriptor (MemoryMap, &Count, EfiRuntimeServicesCode, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (24), 6, EFI_MEMORY_SP);
+  AddDescriptor (MemoryMap, &Count, EfiRuntimeServicesData, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (30), 4, 0);
+  AddDescriptor (MemoryMap, &Count, EfiRuntimeServicesData, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (34), 4, 0);
+
+  AddImageRecord (&ImageRecordList, &CodeSegmentCountMax, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (16), 8, SingleCode, ARRAY_SIZE (SingleCode));
+  AddImageRecord (&ImageRecordList, &CodeSegmentCountMax, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (24), 6, DoubleCode, ARRAY_SIZE (DoubleCode));
+
+  UT_ASSERT_TRUE (TablesMatch (MemoryMap, Count, &ImageRecordList, CodeSegmentCountMax));
+
+  //
+  // Spot check the result: the data descriptor, then data, code and data of the first image,
+  // five ranges of the second image, and the trailing data descriptors merged into one.
+  //
+  Table = AllocateZeroPool ((Count + (2 * CodeSegmentCountMax + 3) * 2) * TEST_DESCRIPTOR_SIZE);
+  assert_non_null (Table);
+  TableSize = MergeMemoryAttributesTable ((EFI_MEMORY_DESCRIPTOR *)MemoryMap, Count * TEST_DESCRIPTOR_SIZE, TEST_DESCRIPTOR_SIZE, &ImageRecordList, Table);
+  UT_ASSERT_EQUAL (TableSize, 10 * TEST_DESCRIPTOR_SIZE);
+
+  Entry = Table;
+  UT_ASSERT_EQUAL (Entry->NumberOfPages, 16);
+  UT_ASSERT_EQUAL (Entry->Attribute, EFI_MEMORY_XP);
+  Entry = NEXT_MEMORY_DESCRIPTOR (Entry, TEST_DESCRIPTOR_SIZE);
+  UT_ASSERT_EQUAL (Entry->NumberOfPages, 1);
+  UT_ASSERT_EQUAL (Entry->Attribute, EFI_MEMORY_XP);
+  Entry = NEXT_MEMORY_DESCRIPTOR (Entry, TEST_DESCRIPTOR_SIZE);
+  UT_ASSERT_EQUAL (Entry->PhysicalStart, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (17));
+  UT_ASSERT_EQUAL (Entry->NumberOfPages, 3);
+  UT_ASSERT_EQUAL (Entry->Attribute, EFI_MEMORY_RO);
+  Entry = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)Table + 9 * TEST_DESCRIPTOR_SIZE);
+  UT_ASSERT_EQUAL (Entry->PhysicalStart, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (30));
+  UT_ASSERT_EQUAL (Entry->NumberOfPages, 8);
+
+  FreePool (Table);
+  FreeImageRecords (&ImageRecordList);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Several images sharing a descriptor, images crossing descriptors and code sections starting
+  at the image base should be handled like the previous algorithm.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SplitsImagesSharingDescriptors (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                    MemoryMap[8 * TEST_DESCRIPTOR_SIZE];
+  UINTN                    Count;
+  LIST_ENTRY               ImageRecordList;
+  UINTN                    CodeSegmentCountMax;
+  CONST TEST_CODE_SECTION  HeadCode[] = {
+    { 0, 0x1000 }
+  };
+  CONST TEST_CODE_SECTION  TailCode[] = {
+    { 1, 0x10 }, { 2, 0x2FFF }
+  };
+
+  InitializeListHead (&ImageRecordList);
+  CodeSegmentCountMax = 0;
+  Count               = 0;
+
+  AddDescriptor (MemoryMap, &Count, EfiRuntimeServicesCode, TEST_MAP_BASE, 32, 0);
+  AddDescriptor (MemoryMap, &Count, EfiRuntimeServicesCode, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (32), 8, 0);
+  AddDescriptor (MemoryMap, &Count, EfiRuntimeServicesData, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (48), 8, EFI_MEMORY_SP);
+
+  // Two images in the first descriptor, with a gap in between and after
+  AddImageRecord (&ImageRecordList, &CodeSegmentCountMax, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (2), 4, HeadCode, ARRAY_SIZE (HeadCode));
+  AddImageRecord (&ImageRecordList, &CodeSegmentCountMax, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (9), 6, TailCode, ARRAY_SIZE (TailCode));
+  // One image crossing into the second descriptor, which is not split
+  AddImageRecord (&ImageRecordList, &CodeSegmentCountMax, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (28), 8, TailCode, ARRAY_SIZE (TailCode));
+  // One image filling the last descriptor
+  AddImageRecord (&ImageRecordList, &CodeSegmentCountMax, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (48), 8, TailCode, ARRAY_SIZE (TailCode));
+
+  UT_ASSERT_TRUE (TablesMatch (MemoryMap, Count, &ImageRecordList, CodeSegmentCountMax));
+
+  FreeImageRecords (&ImageRecordList);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Images loaded in a different order than their addresses in one descriptor should each be split
+  out of it. The previous algorithm looked the images of a descriptor up in load order and folded
+  the images below the first one found into its data, the sorted image record list fixes that.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SplitsImagesLoadedOutOfOrder (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                    MemoryMap[8 * TEST_DESCRIPTOR_SIZE];
+  UINTN                    Count;
+  LIST_ENTRY               ImageRecordList;
+  UINTN                    CodeSegmentCountMax;
+  EFI_MEMORY_DESCRIPTOR    *Table;
+  EFI_MEMORY_DESCRIPTOR    *Entry;
+  UINTN                    TableSize;
+  UINTN                    Index;
+  CONST TEST_CODE_SECTION  Code[] = {
+    { 1, 0x1000 }
+  };
+  CONST UINTN              LoadOrder[] = { 20, 2, 11 };
+
+  InitializeListHead (&ImageRecordList);
+  CodeSegmentCountMax = 0;
+  Count               = 0;
+
+  AddDescriptor (MemoryMap, &Count, EfiRuntimeServicesCode, TEST_MAP_BASE, 32, 0);
+  for (Index = 0; Index < ARRAY_SIZE (LoadOrder); Index++) {
+    AddImageRecord (&ImageRecordList, &CodeSegmentCountMax, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (LoadOrder[Index]), 4, Code, ARRAY_SIZE (Code));
+  }
+
+  UT_ASSERT_TRUE (TablesMatch (MemoryMap, Count, &ImageRecordList, CodeSegmentCountMax));
+
+  //
+  // The code of every image is split out, everything else up to the end of the last image is
+  // data, and the rest of the descriptor stays runtime code.
+  //
+  Table = AllocateZeroPool ((Count + (2 * CodeSegmentCountMax + 3) * ARRAY_SIZE (LoadOrder)) * TEST_DESCRIPTOR_SIZE);
+  assert_non_null (Table);
+  TableSize = MergeMemoryAttributesTable ((EFI_MEMORY_DESCRIPTOR *)MemoryMap, Count * TEST_DESCRIPTOR_SIZE, TEST_DESCRIPTOR_SIZE, &ImageRecordList, Table);
+  UT_ASSERT_EQUAL (TableSize, 8 * TEST_DESCRIPTOR_SIZE);
+
+  for (Index = 0; Index < ARRAY_SIZE (LoadOrder); Index++) {
+    Entry = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)Table + (2 * Index + 1) * TEST_DESCRIPTOR_SIZE);
+    UT_ASSERT_EQUAL (Entry->PhysicalStart, TEST_MAP_BASE + EFI_PAGES_TO_SIZE (3 + 9 * Index));
+    UT_ASSERT_EQUAL (Entry->NumberOfPages, 1);
+    UT_ASSERT_EQUAL (Entry->Attribute, EFI_MEMORY_RO);
+    Entry = PREVIOUS_MEMORY_DESCRIPTOR (Entry, TEST_DESCRIPTOR_SIZE);
+    UT_ASSERT_EQUAL (Entry->Attribute, EFI_MEMORY_XP);
+  }
+
+  FreePool (Table);
+  FreeImageRecords (&ImageRecordList);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Random memory maps and image layouts should produce the same table as the previous algorithm.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MatchesOnRandomMaps (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINT32   Types[]      = { EfiRuntimeServicesCode, EfiRuntimeServicesData, EfiConventionalMemory };
+  STATIC CONST UINT64   Attributes[] = { 0, 0, EFI_MEMORY_SP };
+  UINT8                 MemoryMap[TEST_MAX_MAP_ENTRIES * TEST_DESCRIPTOR_SIZE];
+  UINTN                 Count;
+  UINTN                 Target;
+  LIST_ENTRY            ImageRecordList;
+  UINTN                 CodeSegmentCountMax;
+  TEST_CODE_SECTION     CodeSections[4];
+  UINTN                 CodeSectionCount;
+  UINTN                 Iteration;
+  EFI_PHYSICAL_ADDRESS  Address;
+  UINTN                 Pages;
+  UINTN                 Offset;
+  UINTN                 ImagePages;
+  UINTN                 CodeOffset;
+  UINTN                 CodePages;
+
+  mRandomState = 0x5EED0038;
+
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    InitializeListHead (&ImageRecordList);
+    CodeSegmentCountMax = 0;
+    Count               = 0;
+    Target              = 1 + RandomBelow (TEST_MAX_MAP_ENTRIES);
+    Address             = TEST_MAP_BASE;
+    Offset              = 0;
+
+    while (Count < Target) {
+      //
+      // Leave an occasional hole in the map, unless the last image crosses into the next descriptor.
+      //
+      if ((Offset == 0) && (RandomBelow (4) == 0)) {
+        Address += EFI_PAGES_TO_SIZE (1 + RandomBelow (2));
+      }
+
+      Pages = 1 + RandomBelow (24);
+      AddDescriptor (MemoryMap, &Count, Types[RandomBelow (ARRAY_SIZE (Types))], Address, Pages, Attributes[RandomBelow (ARRAY_SIZE (Attributes))]);
+
+      //
+      // Lay out images at increasing addresses after whatever the previous descriptor spilled
+      // over, the last one possibly crossing into the next descriptor.
+      //
+      while ((Offset < Pages) && (RandomBelow (3) != 0)) {
+        Offset    += RandomBelow (3);
+        ImagePages = 1 + RandomBelow (8);
+        if ((Offset + ImagePages > Pages) && (RandomBelow (4) != 0)) {
+          break;
+        }
+
+        CodeSectionCount = 0;
+        CodeOffset       = RandomBelow (2);
+        while ((CodeSectionCount < ARRAY_SIZE (CodeSections)) && (CodeOffset < ImagePages)) {
+          CodePages                                 = 1 + RandomBelow (ImagePages - CodeOffset);
+          CodeSections[CodeSectionCount].PageOffset = CodeOffset;
+          CodeSections[CodeSectionCount].Size       = EFI_PAGES_TO_SIZE (CodePages) - RandomBelow (EFI_PAGE_SIZE);
+          CodeSectionCount++;
+          CodeOffset += CodePages + RandomBelow (3);
+        }
+
+        if (CodeSectionCount != 0) {
+          AddImageRecord (&ImageRecordList, &CodeSegmentCountMax, Address + EFI_PAGES_TO_SIZE (Offset), ImagePages, CodeSections, CodeSectionCount);
+        }
+
+        Offset += ImagePages;
+      }
+
+      Address += EFI_PAGES_TO_SIZE (Pages);
+      Offset   = (Offset > Pages) ? Offset - Pages : 0;
+    }
+
+    UT_ASSERT_TRUE (TablesMatch (MemoryMap, Count, &ImageRecordList, CodeSegmentCountMax));
+    FreeImageRecords (&ImageRecordList);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  memory attributes table generation and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      MatTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the memory attributes table Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&MatTests, Framework, "Memory Attributes Table Tests", "MmSupervisorCore.MemoryAttributesTable", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for MatTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (MatTests, "Images in their own descriptors should be split", "OwnDescriptors", SplitsImagesInOwnDescriptors, NULL, NULL, NULL);
+  AddTestCase (MatTests, "Images sharing descriptors should be split", "SharedDescriptors", SplitsImagesSharingDescriptors, NULL, NULL, NULL);
+  AddTestCase (MatTests, "Images loaded out of address order should be split", "LoadOrder", SplitsImagesLoadedOutOfOrder, NULL, NULL, NULL);
+  AddTestCase (MatTests, "Random maps should match the previous algorithm", "RandomMaps", MatchesOnRandomMaps, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,352 @@
+/** @file
+  Unit tests of the MP procedure timeline aggregation behind the MM_SUPERVISOR_REQUEST_MP_PERF request
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../SmmMpPerf.h"
+#include "../SmmMpPerfTimeline.h"
+
+#define UNIT_TEST_APP_NAME     "MM Supervisor MP Perf Timeline Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Shape of the simulated system.
+//
+#define TEST_NUMBER_OF_CPUS    4
+#define TEST_EVENTS_PER_CPU    16
+#define TEST_SMI_SEQUENCE      7
+
+//
+// Simulated per-CPU event logs.
+//
+MM_SUPERVISOR_MP_PERF_EVENT  mEvents[TEST_NUMBER_OF_CPUS][TEST_EVENTS_PER_CPU];
+UINTN                        mEventCount[TEST_NUMBER_OF_CPUS];
+
+/*
+  Helper function to clear the simulated event logs.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+ResetEvents (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ZeroMem (mEvents, sizeof (mEvents));
+  ZeroMem (mEventCount, sizeof (mEventCount));
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Helper function to log one procedure run of a simulated CPU.
+*/
+VOID
+LogEvent (
+  IN UINT32  CpuIndex,
+  IN UINT64  SmiSequence,
+  IN UINT32  ProcedureId,
+  IN UINT64  Begin,
+  IN UINT64  End
+  )
+{
+  MM_SUPERVISOR_MP_PERF_EVENT  *Event;
+
+  Event              = &mEvents[CpuIndex][mEventCount[CpuIndex]++];
+  Event->SmiSequence = SmiSequence;
+  Event->Begin       = Begin;
+  Event->End         = End;
+  Event->CpuIndex    = CpuIndex;
+  Event->ProcedureId = ProcedureId;
+}
+
+/*
+  Helper function to log the rendezvous of a simulated CPU in one MMI.
+*/
+VOID
+LogRendezvous (
+  IN UINT32  CpuIndex,
+  IN UINT64  SmiSequence,
+  IN UINT64  Arrival,
+  IN UINT64  ExitBegin,
+  IN UINT64  Departure
+  )
+{
+  LogEvent (CpuIndex, SmiSequence, SMM_MP_PERF_PROCEDURE_ID (SmmRendezvousEntry), Arrival, Arrival + 10);
+  LogEvent (CpuIndex, SmiSequence, SMM_MP_PERF_PROCEDURE_ID (PlatformValidSmi), Arrival + 10, Arrival + 15);
+  LogEvent (CpuIndex, SmiSequence, SMM_MP_PERF_PROCEDURE_ID (SmmRendezvousExit), ExitBegin, Departure);
+}
+
+/*
+  Helper function to summarize the simulated event logs.
+*/
+EFI_STATUS
+Summarize (
+  IN  UINT64                         SmiSequence,
+  OUT MM_SUPERVISOR_MP_PERF_SUMMARY  *Summary
+  )
+{
+  SMM_MP_PERF_TIMELINE  Timeline;
+  UINTN                 CpuIndex;
+
+  MpPerfTimelineInit (&Timeline, SmiSequence);
+  for (CpuIndex = 0; CpuIndex < TEST_NUMBER_OF_CPUS; CpuIndex++) {
+    MpPerfTimelineAddCpu (&Timeline, mEvents[CpuIndex], mEventCount[CpuIndex]);
+  }
+
+  return MpPerfTimelineGetSummary (&Timeline, Summary);
+}
+
+/*
+  Unit test for the summary of a timeline with a late CPU and a slow exit.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+SummaryFindsStragglerAndCriticalPath (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MM_SUPERVISOR_MP_PERF_SUMMARY  Summary;
+
+  LogRendezvous (0, TEST_SMI_SEQUENCE, 1100, 1900, 2000);
+  LogRendezvous (1, TEST_SMI_SEQUENCE, 1120, 1900, 2010);
+  //
+  // CPU 2 takes the longest in its exit hook.
+  //
+  LogRendezvous (2, TEST_SMI_SEQUENCE, 1100, 1900, 2200);
+  //
+  // CPU 3 arrives last.
+  //
+  LogRendezvous (3, TEST_SMI_SEQUENCE, 1180, 1900, 1990);
+
+  UT_ASSERT_NOT_EFI_ERROR (Summarize (TEST_SMI_SEQUENCE, &Summary));
+  UT_ASSERT_EQUAL (Summary.SmiSequence, TEST_SMI_SEQUENCE);
+  UT_ASSERT_EQUAL (Summary.CpuCount, TEST_NUMBER_OF_CPUS);
+  UT_ASSERT_EQUAL (Summary.FirstArrival, 1100);
+  UT_ASSERT_EQUAL (Summary.LastArrival, 1180);
+  UT_ASSERT_EQUAL (Summary.StragglerCpu, 3);
+  UT_ASSERT_EQUAL (Summary.ArrivalSkew, 80);
+  UT_ASSERT_EQUAL (Summary.RendezvousWait, 80 + 60 + 80 + 0);
+  UT_ASSERT_EQUAL (Summary.LastDeparture, 2200);
+  UT_ASSERT_EQUAL (Summary.CriticalCpu, 2);
+  UT_ASSERT_EQUAL (Summary.CriticalProcedureId, SMM_MP_PERF_PROCEDURE_ID (SmmRendezvousExit));
+  UT_ASSERT_EQUAL (Summary.CriticalPath, 1100);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for the summary only accounting the events of the requested MMI.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+SummaryIgnoresOtherSmis (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MM_SUPERVISOR_MP_PERF_SUMMARY  Summary;
+
+  //
+  // CPU 1 misses the requested MMI, and every CPU also has events of the MMIs around it.
+  //
+  LogRendezvous (0, TEST_SMI_SEQUENCE - 1, 100, 500, 600);
+  LogRendezvous (1, TEST_SMI_SEQUENCE - 1, 90, 500, 610);
+  LogRendezvous (2, TEST_SMI_SEQUENCE - 1, 95, 500, 620);
+  LogRendezvous (3, TEST_SMI_SEQUENCE - 1, 80, 500, 630);
+
+  LogRendezvous (0, TEST_SMI_SEQUENCE, 1000, 1500, 1600);
+  LogRendezvous (2, TEST_SMI_SEQUENCE, 1040, 1500, 1620);
+  LogRendezvous (3, TEST_SMI_SEQUENCE, 1010, 1500, 1610);
+
+  LogRendezvous (0, TEST_SMI_SEQUENCE + 1, 3000, 3500, 9000);
+  LogRendezvous (1, TEST_SMI_SEQUENCE + 1, 2000, 3500, 3600);
+
+  UT_ASSERT_NOT_EFI_ERROR (Summarize (TEST_SMI_SEQUENCE, &Summary));
+  UT_ASSERT_EQUAL (Summary.CpuCount, 3);
+  UT_ASSERT_EQUAL (Summary.FirstArrival, 1000);
+  UT_ASSERT_EQUAL (Summary.LastArrival, 1040);
+  UT_ASSERT_EQUAL (Summary.StragglerCpu, 2);
+  UT_ASSERT_EQUAL (Summary.RendezvousWait, 40 + 0 + 30);
+  UT_ASSERT_EQUAL (Summary.CriticalCpu, 2);
+  UT_ASSERT_EQUAL (Summary.CriticalPath, 620);
+
+  UT_ASSERT_STATUS_EQUAL (Summarize (TEST_SMI_SEQUENCE + 2, &Summary), EFI_NOT_FOUND);
+  UT_ASSERT_EQUAL (Summary.CpuCount, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for the summary leaving out the events logged before the first MMI.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+SummaryIgnoresEventsOutsideSmi (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MM_SUPERVISOR_MP_PERF_SUMMARY  Summary;
+  UINT32                         CpuIndex;
+
+  //
+  // Every CPU is initialized long before the first MMI, which has sequence 0.
+  //
+  for (CpuIndex = 0; CpuIndex < TEST_NUMBER_OF_CPUS; CpuIndex++) {
+    LogEvent (CpuIndex, MM_SUPERVISOR_MP_PERF_NO_SMI, SMM_MP_PERF_PROCEDURE_ID (InitializeSmm), 10 + CpuIndex, 500);
+  }
+
+  LogRendezvous (0, 0, 1000, 1500, 1600);
+  LogRendezvous (1, 0, 1020, 1500, 1610);
+  LogRendezvous (2, 0, 1010, 1500, 1620);
+  LogRendezvous (3, 0, 1030, 1500, 1630);
+
+  UT_ASSERT_NOT_EFI_ERROR (Summarize (0, &Summary));
+  UT_ASSERT_EQUAL (Summary.CpuCount, TEST_NUMBER_OF_CPUS);
+  UT_ASSERT_EQUAL (Summary.FirstArrival, 1000);
+  UT_ASSERT_EQUAL (Summary.LastArrival, 1030);
+  UT_ASSERT_EQUAL (Summary.StragglerCpu, 3);
+  UT_ASSERT_EQUAL (Summary.CriticalCpu, 3);
+  UT_ASSERT_EQUAL (Summary.CriticalProcedureId, SMM_MP_PERF_PROCEDURE_ID (SmmRendezvousExit));
+  UT_ASSERT_EQUAL (Summary.CriticalPath, 630);
+
+  UT_ASSERT_STATUS_EQUAL (Summarize (MM_SUPERVISOR_MP_PERF_NO_SMI, &Summary), EFI_NOT_FOUND);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for the summary not depending on the order of the events, as they come
+  out of a wrapped ring, nor on the first CPU added being the first to arrive.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+SummaryIsOrderIndependent (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MM_SUPERVISOR_MP_PERF_SUMMARY  Expected;
+  MM_SUPERVISOR_MP_PERF_SUMMARY  Summary;
+  MM_SUPERVISOR_MP_PERF_EVENT    Event;
+  UINTN                          CpuIndex;
+  UINTN                          Index;
+
+  LogRendezvous (0, TEST_SMI_SEQUENCE, 5000, 5400, 5500);
+  LogRendezvous (1, TEST_SMI_SEQUENCE, 4000, 5400, 5450);
+  LogRendezvous (2, TEST_SMI_SEQUENCE, 4500, 5400, 5700);
+  LogRendezvous (3, TEST_SMI_SEQUENCE, 4100, 5400, 5460);
+  LogEvent (2, TEST_SMI_SEQUENCE + 1, SMM_MP_PERF_PROCEDURE_ID (SmmRendezvousEntry), 9000, 9010);
+
+  UT_ASSERT_NOT_EFI_ERROR (Summarize (TEST_SMI_SEQUENCE, &Expected));
+  UT_ASSERT_EQUAL (Expected.FirstArrival, 4000);
+  UT_ASSERT_EQUAL (Expected.StragglerCpu, 0);
+  UT_ASSERT_EQUAL (Expected.RendezvousWait, 0 + 1000 + 500 + 900);
+  UT_ASSERT_EQUAL (Expected.CriticalCpu, 2);
+  UT_ASSERT_EQUAL (Expected.CriticalPath, 1700);
+
+  //
+  // Rotate every log, as if the ring of each CPU had wrapped.
+  //
+  for (CpuIndex = 0; CpuIndex < TEST_NUMBER_OF_CPUS; CpuIndex++) {
+    for (Index = 0; Index + 1 < mEventCount[CpuIndex]; Index++) {
+      CopyMem (&Event, &mEvents[CpuIndex][Index], sizeof (Event));
+      CopyMem (&mEvents[CpuIndex][Index], &mEvents[CpuIndex][Index + 1], sizeof (Event));
+      CopyMem (&mEvents[CpuIndex][Index + 1], &Event, sizeof (Event));
+    }
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Summarize (TEST_SMI_SEQUENCE, &Summary));
+  UT_ASSERT_MEM_EQUAL (&Summary, &Expected, sizeof (Summary));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  MP perf timeline and run the MP perf timeline unit test.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      TimelineTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the MP perf timeline Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&TimelineTests, Framework, "MP Perf Timeline Tests", "MmSupervisorCore.MpPerfTimeline", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for TimelineTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (TimelineTests, "Summary should find the straggler and the critical path", "Straggler", SummaryFindsStragglerAndCriticalPath, ResetEvents, NULL, NULL);
+  AddTestCase (TimelineTests, "Summary should only account the requested MMI", "Sequence", SummaryIgnoresOtherSmis, ResetEvents, NULL, NULL);
+  AddTestCase (TimelineTests, "Summary should leave out events logged outside of any MMI", "NoSmi", SummaryIgnoresEventsOutsideSmi, ResetEvents, NULL, NULL);
+  AddTestCase (TimelineTests, "Summary should not depend on the event order", "Order", SummaryIsOrderIndependent, ResetEvents, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -23,6 +23,7 @@
 #include <Guid/MmCommonRegion.h>
 #include <Library/MmSupervisorCoreInitLib.h>
 #include <Library/SecurePolicyLib.h>
+#include <Library/IhvSmmSaveStateSupervisionLib.h>
 
 EFI_STATUS
 MmCoreFfsFindMmDriver (
@@ -124,6 +125,12 @@ BOOLEAN                           mCoreInitializationComplete = FALSE;
 VOID                              *mInternalCommBufferCopy[MM_OPEN_BUFFER_CNT];
 SMM_SUPV_SECURE_POLICY_DATA_V1_0  *FirmwarePolicy = NULL;
 
+//
+// Number of MMIs entered so far, save state information cached during an MMI is only
+// valid while this number does not change.
+//
+volatile UINT64  mMmSmiSequence = 0;
+
 /**
   Place holder function until all the MM System Table Service are available.
 
@@ -405,6 +412,12 @@ MmReadyToLockHandler (
     ASSERT_EFI_ERROR (Status);
   }
 
+  // Same for the loaded images, index them so that faults can be attributed without walking the driver list
+  Status = BuildLoadedImageTable ();
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed to build loaded image table at ready to lock - %r\n", Status));
+  }
+
   // If MMI handler profile is supported, traverse them after unregistering
   // Since this is after the CPL3 ready to lock event completely, thus whatever
   // remains will be the one impacting runtime.
@@ -462,6 +475,20 @@ InternalIsBufferOverlapped (
   return TRUE;
 }
 
+/**
+  Get the sequence number of the current MMI.
+
+  @return The number of MMIs entered so far, 0 before the first MMI.
+
+**/
+UINT64
+MmGetSmiSequence (
+  VOID
+  )
+{
+  return mMmSmiSequence;
+}
+
 /**
   The main entry point to MM Foundation.
 
@@ -489,6 +516,11 @@ MmEntryPoint (
 
   DEBUG ((DEBUG_VERBOSE, "MmEntryPoint ...\n"));
 
+  //
+  // Start a new MMI, so that save state information cached during the previous one is not reused
+  //
+  mMmSmiSequence++;
+
   //
   // Update MMST using the context
   //
@@ -981,6 +1013,7 @@ InitializePolicy (
     }
 
     CopyMem (FirmwarePolicy, SectionData, PolicySize);
+    IhvSmmSaveStatePolicyApplied (FirmwarePolicy);
 
     DEBUG_CODE_BEGIN ();
     DumpSmmPolicyData (FirmwarePolicy);
@@ -1220,6 +1253,8 @@ MmSupervisorMain (
 
   mCoreInitializationComplete = TRUE;
 
+  PublishUnblockedView ();
+
   PostRelocationRun ();
 
   DEBUG ((DEBUG_INFO, "MmMain Done!\n"));
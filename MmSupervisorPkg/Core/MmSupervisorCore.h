@@ -33,6 +33,7 @@
 #include <Guid/MmramMemoryReserve.h>
 #include <Guid/MmCommBuffer.h>
 #include <Guid/MmCommonRegion.h>
+#include <Guid/SmiHandlerProfileLatency.h>
 
 #include <Library/StandaloneMmCoreEntryPoint.h>
 #include <Library/BaseLib.h>
@@ -208,6 +209,16 @@ typedef struct {
   LIST_ENTRY    MmiHandlers; // All handlers
 } MMI_ENTRY;
 
+//
+// Latency statistics of a MMI handler, kept per CPU and merged when queried.
+//
+typedef struct {
+  UINT64    InvocationCount;
+  UINT64    TotalTicks;
+  UINT64    MaxTicks;
+  UINT32    Histogram[SMI_HANDLER_LATENCY_BUCKET_COUNT];
+} MMI_HANDLER_LATENCY;
+
 #define MMI_HANDLER_SIGNATURE  SIGNATURE_32('m','m','i','h')
 
 typedef struct {
@@ -220,6 +231,7 @@ typedef struct {
   VOID                          *Context;     // for profile
   UINTN                         ContextSize;  // for profile
   BOOLEAN                       IsSupervisor; // for isolation
+  MMI_HANDLER_LATENCY           *Latency;     // for profile, one entry per CPU
 } MMI_HANDLER;
 
 #define DEFAULT_SUPV_TO_USER_BUFFER_PAGE  1  // Leave 4KB space known to the supervisor that is in CPL3
@@ -735,6 +747,41 @@ FindFileNameFromDiscoveredList (
   OUT EFI_GUID              *Guid
   );
 
+/**
+  Build the sorted table of loaded image ranges used by FindLoadedImageByAddress.
+
+  Should be called once all drivers have been dispatched, the table is not updated afterwards.
+
+  @retval EFI_SUCCESS             The table is built.
+  @retval EFI_ALREADY_STARTED     The table was built before.
+  @retval EFI_OUT_OF_RESOURCES    Failed to allocate the table.
+
+**/
+EFI_STATUS
+BuildLoadedImageTable (
+  VOID
+  );
+
+/**
+  Look up the loaded image containing an address and its driver GUID.
+
+  @param  Address         The address of interest, e.g. a faulting instruction pointer.
+  @param  ImageBase       The pointer to hold the base of the image containing Address.
+  @param  Guid            The pointer to hold returned driver GUID.
+
+  @return EFI_SUCCESS             The image is found successfully.
+  @return EFI_INVALID_PARAMETER   Incoming ImageBase or Guid pointer is null.
+  @return EFI_NOT_READY           The loaded image table is not built yet.
+  @return EFI_NOT_FOUND           Address does not belong to any loaded image.
+
+**/
+EFI_STATUS
+FindLoadedImageByAddress (
+  IN  EFI_PHYSICAL_ADDRESS  Address,
+  OUT EFI_PHYSICAL_ADDRESS  *ImageBase,
+  OUT EFI_GUID              *Guid
+  );
+
 /**
   Helper function to protect temporarily allocated buffer for ffs. They should not be changed before ready to lock.
 
@@ -933,6 +980,55 @@ MmIsSchedulable (
   IN  EFI_MM_DRIVER_ENTRY  *DriverEntry
   );
 
+/**
+  Get the sequence number of the current MMI.
+
+  @return The number of MMIs entered so far, 0 before the first MMI.
+
+**/
+UINT64
+MmGetSmiSequence (
+  VOID
+  );
+
+/**
+  Publish the MMRAM ranges and the user unblocked regions to the read only view of ring 3.
+
+  Nothing is published before the core initialization completes.
+
+**/
+VOID
+PublishUnblockedView (
+  VOID
+  );
+
+/**
+  Get the read only view of the unblocked regions published to ring 3.
+
+  @return The address of the view, 0 if none is published.
+
+**/
+EFI_PHYSICAL_ADDRESS
+GetUnblockedViewAddress (
+  VOID
+  );
+
+/**
+  Check if pages overlap the read only view of the unblocked regions published to ring 3.
+
+  @param[in]  Address        Start of the pages.
+  @param[in]  NumberOfPages  Number of pages.
+
+  @retval TRUE   The pages overlap the view, ring 3 must not free them.
+  @retval FALSE  The pages do not overlap the view.
+
+**/
+BOOLEAN
+IsUnblockedViewRange (
+  IN EFI_PHYSICAL_ADDRESS  Address,
+  IN UINT64                NumberOfPages
+  );
+
 extern UINTN                 mMmramRangeCount;
 extern EFI_MMRAM_DESCRIPTOR  *mMmramRanges;
 extern EFI_SYSTEM_TABLE      *mEfiSystemTable;
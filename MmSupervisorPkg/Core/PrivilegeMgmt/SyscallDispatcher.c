@@ -22,6 +22,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "MmSupervisorCore.h"
 #include "PrivilegeMgmt.h"
+#include "SyscallIoFifo.h"
 #include "Relocate/Relocate.h"
 #include "Handler/Handler.h"
 #include "Mem/Mem.h"
@@ -225,10 +226,13 @@ SyscallDispatcher (
   UINTN  Ring3StackPointer
   )
 {
-  UINT64      Ret = 0;
-  EFI_HANDLE  MmHandle;
-  BOOLEAN     IsUserRange = FALSE;
-  EFI_STATUS  Status      = EFI_SUCCESS;
+  UINT64           Ret = 0;
+  EFI_HANDLE       MmHandle;
+  BOOLEAN          IsUserRange = FALSE;
+  EFI_STATUS       Status      = EFI_SUCCESS;
+  EFI_MM_IO_WIDTH  IoWidth;
+  UINTN            IoCount;
+  UINTN            IoBufferSize;
 
   if (FeaturePcdGet (PcdEnableSyscallLogs)) {
     while (!AcquireSpinLockOrFail (mCpuToken)) {
@@ -438,6 +442,59 @@ SyscallDispatcher (
         Ret = EFI_SUCCESS;
       }
 
+      break;
+    case SMM_SC_SVST_READ_BATCH:
+      DEBUG ((DEBUG_VERBOSE, "%a Save state read batch\n", __func__));
+      Ret = 0;
+      if ((Arg2 == 0) || (Arg2 > SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES)) {
+        Status = EFI_INVALID_PARAMETER;
+        goto Exit;
+      }
+
+      if (EFI_ERROR (InspectTargetRangeOwnership (Arg1, Arg2 * sizeof (SMM_SAVE_STATE_READ_ENTRY), &IsUserRange)) || !IsUserRange) {
+        Status = EFI_SECURITY_VIOLATION;
+        goto Exit;
+      }
+
+      Status = ProcessUserSaveStateBatchRead (Arg1, Arg2, Arg3);
+      if (!EFI_ERROR (Status)) {
+        Ret = EFI_SUCCESS;
+      }
+
+      break;
+    case SMM_SC_IO_READ_FIFO:
+    case SMM_SC_IO_WRITE_FIFO:
+      //
+      // The status of the transfer is returned, so that a denied transfer can be told apart from
+      // a successful one when the supervisor returns to the caller.
+      //
+      Status = SyscallIoFifoValidate (Arg1, Arg2, &IoWidth, &IoCount, &IoBufferSize);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "%a IO FIFO incompatible port 0x%x or width and count 0x%x\n", __func__, Arg1, Arg2));
+        Ret = Status;
+        goto Exit;
+      }
+
+      if (EFI_ERROR (InspectTargetRangeOwnership (Arg3, IoBufferSize, &IsUserRange)) || !IsUserRange) {
+        Status = EFI_SECURITY_VIOLATION;
+        Ret    = Status;
+        goto Exit;
+      }
+
+      Status = SyscallIoFifoTransfer (FirmwarePolicy, (CallIndex == SMM_SC_IO_WRITE_FIFO), Arg1, IoWidth, IoCount, (VOID *)Arg3);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "%a IO FIFO port 0x%x with width type %d blocked by policy - %r\n", __func__, Arg1, IoWidth, Status));
+        Ret = Status;
+        goto Exit;
+      }
+
+      Ret = EFI_SUCCESS;
+
+      DEBUG ((DEBUG_VERBOSE, "%a IO FIFO %a type %d at %x, %d times\n", __func__, (CallIndex == SMM_SC_IO_WRITE_FIFO) ? "write" : "read", IoWidth, Arg1, IoCount));
+      if (FeaturePcdGet (PcdMmSupervisorPrintPortsEnable)) {
+        AddToDict ((UINT32)Arg1, (UINT32)IoWidth, FALSE);
+      }
+
       break;
     case SMM_REG_HDL_JMP:
       if ((RegisteredRing3JumpPointer != 0) ||
@@ -494,9 +551,11 @@ SyscallDispatcher (
       break;
     case SMM_FREE_PAGE:
       // Making sure Arg2 does not overflow when supplying into inspector
-      // Then also making sure this entire range is owned by user
+      // Then also making sure this entire range is owned by user, and is not the user readable
+      // unblocked region view that the supervisor keeps updating
       if ((Arg2 <= EFI_SIZE_TO_PAGES ((UINTN)-1)) &&
-          !EFI_ERROR (InspectTargetRangeOwnership (Arg1, EFI_PAGES_TO_SIZE (Arg2), &IsUserRange)) && IsUserRange)
+          !EFI_ERROR (InspectTargetRangeOwnership (Arg1, EFI_PAGES_TO_SIZE (Arg2), &IsUserRange)) && IsUserRange &&
+          !IsUnblockedViewRange (Arg1, Arg2))
       {
         Status = MmFreePages ((EFI_PHYSICAL_ADDRESS)Arg1, Arg2);
       } else {
@@ -610,6 +669,9 @@ SyscallDispatcher (
     case SMM_MM_IS_COMM_BUFF:
       Ret = (UINT64)VerifyRequestUserCommBuffer ((VOID *)(UINTN)Arg1, (UINTN)Arg2);
       break;
+    case SMM_MM_UNBLOCKED_VIEW:
+      Ret = (UINT64)GetUnblockedViewAddress ();
+      break;
     default:
       Status = EFI_INVALID_PARAMETER;
       break;
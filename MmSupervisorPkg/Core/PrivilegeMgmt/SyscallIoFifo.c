@@ -0,0 +1,147 @@
+/** @file
+  IO port FIFO transfers behind the SMM_SC_IO_READ_FIFO and SMM_SC_IO_WRITE_FIFO syscalls.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+#include <SmmSecurePolicy.h>
+
+#include <Protocol/MmCpuIo.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/IoLib.h>
+#include <Library/SysCallLib.h>
+#include <Library/SmmPolicyGateLib.h>
+
+#include "SyscallIoFifo.h"
+
+/**
+  Decode and validate the arguments of an IO port FIFO syscall.
+
+  @param[in]  Port           The IO port, Arg1 of the syscall.
+  @param[in]  WidthAndCount  Access width and count packed by SMM_IO_FIFO_ARG, Arg2 of the syscall.
+  @param[out] Width          The access width.
+  @param[out] Count          The number of port accesses.
+  @param[out] BufferSize     Size in bytes of the buffer the transfer reads from or writes to.
+
+  @retval EFI_SUCCESS            The arguments are well formed.
+  @retval EFI_INVALID_PARAMETER  The port is not a 16-bit port number, the width is not a single
+                                 port access width, or the count is 0 or exceeds SMM_IO_FIFO_MAX_COUNT.
+
+**/
+EFI_STATUS
+SyscallIoFifoValidate (
+  IN  UINTN            Port,
+  IN  UINTN            WidthAndCount,
+  OUT EFI_MM_IO_WIDTH  *Width,
+  OUT UINTN            *Count,
+  OUT UINTN            *BufferSize
+  )
+{
+  UINTN  ElementSize;
+
+  if (Port > MAX_UINT16) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  switch (SMM_IO_FIFO_ARG_WIDTH (WidthAndCount)) {
+    case MM_IO_UINT8:
+      ElementSize = sizeof (UINT8);
+      break;
+    case MM_IO_UINT16:
+      ElementSize = sizeof (UINT16);
+      break;
+    case MM_IO_UINT32:
+      ElementSize = sizeof (UINT32);
+      break;
+    default:
+      return EFI_INVALID_PARAMETER;
+  }
+
+  *Count = SMM_IO_FIFO_ARG_COUNT (WidthAndCount);
+  if ((*Count == 0) || (*Count > SMM_IO_FIFO_MAX_COUNT)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *Width      = (EFI_MM_IO_WIDTH)SMM_IO_FIFO_ARG_WIDTH (WidthAndCount);
+  *BufferSize = *Count * ElementSize;
+  return EFI_SUCCESS;
+}
+
+/**
+  Perform a policy checked IO port FIFO transfer.
+
+  The port is checked against the policy once for the whole transfer, then it is read or written
+  Count times through the IoLib FIFO routines. Nothing is transferred when the policy rejects the
+  access.
+
+  @param[in]      Policy   The security policy in force.
+  @param[in]      Write    TRUE to write Buffer to the port, FALSE to read the port into Buffer.
+  @param[in]      Port     The IO port, validated by SyscallIoFifoValidate.
+  @param[in]      Width    The access width, validated by SyscallIoFifoValidate.
+  @param[in]      Count    The number of port accesses, validated by SyscallIoFifoValidate.
+  @param[in, out] Buffer   Buffer of the size reported by SyscallIoFifoValidate.
+
+  @retval EFI_SUCCESS    The transfer is complete.
+  @retval Others         The access is rejected by IsIoReadWriteAllowed.
+
+**/
+EFI_STATUS
+SyscallIoFifoTransfer (
+  IN     SMM_SUPV_SECURE_POLICY_DATA_V1_0  *Policy,
+  IN     BOOLEAN                           Write,
+  IN     UINTN                             Port,
+  IN     EFI_MM_IO_WIDTH                   Width,
+  IN     UINTN                             Count,
+  IN OUT VOID                              *Buffer
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = IsIoReadWriteAllowed (
+             Policy,
+             (UINT32)Port,
+             Width,
+             Write ? SECURE_POLICY_RESOURCE_ATTR_WRITE_DIS : SECURE_POLICY_RESOURCE_ATTR_READ_DIS
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  switch (Width) {
+    case MM_IO_UINT8:
+      if (Write) {
+        IoWriteFifo8 (Port, Count, Buffer);
+      } else {
+        IoReadFifo8 (Port, Count, Buffer);
+      }
+
+      break;
+    case MM_IO_UINT16:
+      if (Write) {
+        IoWriteFifo16 (Port, Count, Buffer);
+      } else {
+        IoReadFifo16 (Port, Count, Buffer);
+      }
+
+      break;
+    case MM_IO_UINT32:
+      if (Write) {
+        IoWriteFifo32 (Port, Count, Buffer);
+      } else {
+        IoReadFifo32 (Port, Count, Buffer);
+      }
+
+      break;
+    default:
+      // Should not happen
+      ASSERT (FALSE);
+      return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_SUCCESS;
+}
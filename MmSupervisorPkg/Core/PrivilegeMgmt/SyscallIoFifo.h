@@ -0,0 +1,67 @@
+/** @file
+  Definitions of the IO port FIFO transfers behind the SMM_SC_IO_READ_FIFO and
+  SMM_SC_IO_WRITE_FIFO syscalls.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef SYSCALL_IO_FIFO_H_
+#define SYSCALL_IO_FIFO_H_
+
+#include <SmmSecurePolicy.h>
+#include <Protocol/MmCpuIo.h>
+
+/**
+  Decode and validate the arguments of an IO port FIFO syscall.
+
+  @param[in]  Port           The IO port, Arg1 of the syscall.
+  @param[in]  WidthAndCount  Access width and count packed by SMM_IO_FIFO_ARG, Arg2 of the syscall.
+  @param[out] Width          The access width.
+  @param[out] Count          The number of port accesses.
+  @param[out] BufferSize     Size in bytes of the buffer the transfer reads from or writes to.
+
+  @retval EFI_SUCCESS            The arguments are well formed.
+  @retval EFI_INVALID_PARAMETER  The port is not a 16-bit port number, the width is not a single
+                                 port access width, or the count is 0 or exceeds SMM_IO_FIFO_MAX_COUNT.
+
+**/
+EFI_STATUS
+SyscallIoFifoValidate (
+  IN  UINTN            Port,
+  IN  UINTN            WidthAndCount,
+  OUT EFI_MM_IO_WIDTH  *Width,
+  OUT UINTN            *Count,
+  OUT UINTN            *BufferSize
+  );
+
+/**
+  Perform a policy checked IO port FIFO transfer.
+
+  The port is checked against the policy once for the whole transfer, then it is read or written
+  Count times through the IoLib FIFO routines. Nothing is transferred when the policy rejects the
+  access.
+
+  @param[in]      Policy   The security policy in force.
+  @param[in]      Write    TRUE to write Buffer to the port, FALSE to read the port into Buffer.
+  @param[in]      Port     The IO port, validated by SyscallIoFifoValidate.
+  @param[in]      Width    The access width, validated by SyscallIoFifoValidate.
+  @param[in]      Count    The number of port accesses, validated by SyscallIoFifoValidate.
+  @param[in, out] Buffer   Buffer of the size reported by SyscallIoFifoValidate.
+
+  @retval EFI_SUCCESS    The transfer is complete.
+  @retval Others         The access is rejected by IsIoReadWriteAllowed.
+
+**/
+EFI_STATUS
+SyscallIoFifoTransfer (
+  IN     SMM_SUPV_SECURE_POLICY_DATA_V1_0  *Policy,
+  IN     BOOLEAN                           Write,
+  IN     UINTN                             Port,
+  IN     EFI_MM_IO_WIDTH                   Width,
+  IN     UINTN                             Count,
+  IN OUT VOID                              *Buffer
+  );
+
+#endif // SYSCALL_IO_FIFO_H_
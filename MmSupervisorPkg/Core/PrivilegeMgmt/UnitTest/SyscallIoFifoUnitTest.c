@@ -0,0 +1,521 @@
+/** @file
+  Unit tests of the IO port FIFO transfers behind the SMM_SC_IO_READ_FIFO and SMM_SC_IO_WRITE_FIFO syscalls
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <SmmSecurePolicy.h>
+#include <Protocol/MmCpuIo.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SysCallLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../SyscallIoFifo.h"
+
+#define UNIT_TEST_APP_NAME     "MM Supervisor IO FIFO Syscall Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Ports of the simulated policy: a read only pair of ports and a read/write 4-port window.
+//
+#define TEST_READ_ONLY_PORT    0x60
+#define TEST_READ_ONLY_SIZE    2
+#define TEST_READ_WRITE_PORT   0x80
+#define TEST_READ_WRITE_SIZE   4
+#define TEST_UNLISTED_PORT     0x70
+
+//
+// Length of the simulated bulk transfer, spanning several syscalls.
+//
+#define TEST_BULK_LENGTH  (SMM_IO_FIFO_MAX_COUNT * 2 + 17)
+
+//
+// Value written to buffers before a transfer, to detect writes of rejected transfers.
+//
+#define TEST_POISON  0xA5
+
+//
+// Counters of the simulated supervisor services.
+//
+UINTN  mPolicyEvaluations;
+UINTN  mPortReads;
+UINTN  mPortWrites;
+UINTN  mRingTransitions;
+
+//
+// Last value written to the simulated ports, and the sequence generating the data read.
+//
+UINT32  mLastWritten;
+UINT32  mReadSequence;
+
+UINT8  mBuffer[TEST_BULK_LENGTH];
+
+/**
+  Simulated IO policy.
+
+  The whole range of the access must fall in one of the ports described by the policy,
+  and writes are only allowed to the read/write window.
+**/
+EFI_STATUS
+EFIAPI
+IsIoReadWriteAllowed (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy,
+  IN UINT32                            IoAddress,
+  IN EFI_MM_IO_WIDTH                   IoWidth,
+  IN UINT32                            AccessMask
+  )
+{
+  UINT32  IoSize;
+
+  mPolicyEvaluations++;
+
+  IoSize = 1 << IoWidth;
+  if ((IoAddress >= TEST_READ_ONLY_PORT) &&
+      (IoAddress + IoSize <= TEST_READ_ONLY_PORT + TEST_READ_ONLY_SIZE) &&
+      (AccessMask == SECURE_POLICY_RESOURCE_ATTR_READ_DIS))
+  {
+    return EFI_SUCCESS;
+  }
+
+  if ((IoAddress >= TEST_READ_WRITE_PORT) &&
+      (IoAddress + IoSize <= TEST_READ_WRITE_PORT + TEST_READ_WRITE_SIZE))
+  {
+    return EFI_SUCCESS;
+  }
+
+  return EFI_ACCESS_DENIED;
+}
+
+/**
+  Simulated port read, returning the next value of the read sequence.
+**/
+UINT32
+TestPortRead (
+  VOID
+  )
+{
+  mPortReads++;
+  return mReadSequence++;
+}
+
+/**
+  Simulated port write, remembering the value written.
+**/
+VOID
+TestPortWrite (
+  IN UINT32  Value
+  )
+{
+  mPortWrites++;
+  mLastWritten = Value;
+}
+
+VOID
+EFIAPI
+IoReadFifo8 (
+  IN      UINTN  Port,
+  IN      UINTN  Count,
+  OUT     VOID   *Buffer
+  )
+{
+  UINT8  *Buffer8;
+
+  for (Buffer8 = (UINT8 *)Buffer; Count-- > 0; Buffer8++) {
+    *Buffer8 = (UINT8)TestPortRead ();
+  }
+}
+
+VOID
+EFIAPI
+IoWriteFifo8 (
+  IN      UINTN  Port,
+  IN      UINTN  Count,
+  IN      VOID   *Buffer
+  )
+{
+  UINT8  *Buffer8;
+
+  for (Buffer8 = (UINT8 *)Buffer; Count-- > 0; Buffer8++) {
+    TestPortWrite (*Buffer8);
+  }
+}
+
+VOID
+EFIAPI
+IoReadFifo16 (
+  IN      UINTN  Port,
+  IN      UINTN  Count,
+  OUT     VOID   *Buffer
+  )
+{
+  UINT16  *Buffer16;
+
+  for (Buffer16 = (UINT16 *)Buffer; Count-- > 0; Buffer16++) {
+    *Buffer16 = (UINT16)TestPortRead ();
+  }
+}
+
+VOID
+EFIAPI
+IoWriteFifo16 (
+  IN      UINTN  Port,
+  IN      UINTN  Count,
+  IN      VOID   *Buffer
+  )
+{
+  UINT16  *Buffer16;
+
+  for (Buffer16 = (UINT16 *)Buffer; Count-- > 0; Buffer16++) {
+    TestPortWrite (*Buffer16);
+  }
+}
+
+VOID
+EFIAPI
+IoReadFifo32 (
+  IN      UINTN  Port,
+  IN      UINTN  Count,
+  OUT     VOID   *Buffer
+  )
+{
+  UINT32  *Buffer32;
+
+  for (Buffer32 = (UINT32 *)Buffer; Count-- > 0; Buffer32++) {
+    *Buffer32 = TestPortRead ();
+  }
+}
+
+VOID
+EFIAPI
+IoWriteFifo32 (
+  IN      UINTN  Port,
+  IN      UINTN  Count,
+  IN      VOID   *Buffer
+  )
+{
+  UINT32  *Buffer32;
+
+  for (Buffer32 = (UINT32 *)Buffer; Count-- > 0; Buffer32++) {
+    TestPortWrite (*Buffer32);
+  }
+}
+
+/**
+  Simulated syscall entry, counting ring transitions and servicing the IO syscalls the way
+  the supervisor does.
+**/
+UINT64
+TestSysCall (
+  IN UINTN  CallIndex,
+  IN UINTN  Arg1,
+  IN UINTN  Arg2,
+  IN UINTN  Arg3
+  )
+{
+  EFI_STATUS       Status;
+  EFI_MM_IO_WIDTH  Width;
+  UINTN            Count;
+  UINTN            BufferSize;
+  UINT8            Value;
+
+  mRingTransitions++;
+
+  switch (CallIndex) {
+    case SMM_SC_IO_READ:
+      Status = IsIoReadWriteAllowed (NULL, (UINT32)Arg1, (EFI_MM_IO_WIDTH)Arg2, SECURE_POLICY_RESOURCE_ATTR_READ_DIS);
+      if (EFI_ERROR (Status)) {
+        return 0;
+      }
+
+      IoReadFifo8 (Arg1, 1, &Value);
+      return Value;
+    case SMM_SC_IO_READ_FIFO:
+    case SMM_SC_IO_WRITE_FIFO:
+      Status = SyscallIoFifoValidate (Arg1, Arg2, &Width, &Count, &BufferSize);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      return SyscallIoFifoTransfer (NULL, (CallIndex == SMM_SC_IO_WRITE_FIFO), Arg1, Width, Count, (VOID *)Arg3);
+    default:
+      return EFI_INVALID_PARAMETER;
+  }
+}
+
+/*
+  Helper function to reset the counters and the state of the simulated supervisor services.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+ResetCounters (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mPolicyEvaluations = 0;
+  mPortReads         = 0;
+  mPortWrites        = 0;
+  mRingTransitions   = 0;
+  mLastWritten       = 0;
+  mReadSequence      = 0;
+  SetMem (mBuffer, sizeof (mBuffer), TEST_POISON);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for SyscallIoFifoValidate () rejecting malformed arguments.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+FifoValidateRejectsMalformed (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_MM_IO_WIDTH  Width;
+  UINTN            Count;
+  UINTN            BufferSize;
+
+  UT_ASSERT_STATUS_EQUAL (SyscallIoFifoValidate (MAX_UINT16 + 1, SMM_IO_FIFO_ARG (MM_IO_UINT8, 1), &Width, &Count, &BufferSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (SyscallIoFifoValidate (TEST_READ_WRITE_PORT, SMM_IO_FIFO_ARG (MM_IO_UINT64, 1), &Width, &Count, &BufferSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (SyscallIoFifoValidate (TEST_READ_WRITE_PORT, SMM_IO_FIFO_ARG (MM_IO_UINT8, 0), &Width, &Count, &BufferSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (SyscallIoFifoValidate (TEST_READ_WRITE_PORT, SMM_IO_FIFO_ARG (MM_IO_UINT8, SMM_IO_FIFO_MAX_COUNT + 1), &Width, &Count, &BufferSize), EFI_INVALID_PARAMETER);
+
+  UT_ASSERT_NOT_EFI_ERROR (SyscallIoFifoValidate (TEST_READ_WRITE_PORT, SMM_IO_FIFO_ARG (MM_IO_UINT32, SMM_IO_FIFO_MAX_COUNT), &Width, &Count, &BufferSize));
+  UT_ASSERT_EQUAL (Width, MM_IO_UINT32);
+  UT_ASSERT_EQUAL (Count, SMM_IO_FIFO_MAX_COUNT);
+  UT_ASSERT_EQUAL (BufferSize, SMM_IO_FIFO_MAX_COUNT * sizeof (UINT32));
+
+  UT_ASSERT_NOT_EFI_ERROR (SyscallIoFifoValidate (MAX_UINT16, SMM_IO_FIFO_ARG (MM_IO_UINT16, 3), &Width, &Count, &BufferSize));
+  UT_ASSERT_EQUAL (Width, MM_IO_UINT16);
+  UT_ASSERT_EQUAL (BufferSize, 3 * sizeof (UINT16));
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for SyscallIoFifoTransfer () moving every element after a single policy check.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+FifoTransferChecksPolicyOnce (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT16  *Buffer16;
+  UINTN   Index;
+
+  UT_ASSERT_NOT_EFI_ERROR (SyscallIoFifoTransfer (NULL, FALSE, TEST_READ_WRITE_PORT, MM_IO_UINT16, 100, mBuffer));
+  UT_ASSERT_EQUAL (mPolicyEvaluations, 1);
+  UT_ASSERT_EQUAL (mPortReads, 100);
+
+  Buffer16 = (UINT16 *)mBuffer;
+  for (Index = 0; Index < 100; Index++) {
+    UT_ASSERT_EQUAL (Buffer16[Index], Index);
+  }
+
+  UT_ASSERT_EQUAL (mBuffer[100 * sizeof (UINT16)], TEST_POISON);
+
+  UT_ASSERT_NOT_EFI_ERROR (SyscallIoFifoTransfer (NULL, TRUE, TEST_READ_WRITE_PORT, MM_IO_UINT16, 100, mBuffer));
+  UT_ASSERT_EQUAL (mPolicyEvaluations, 2);
+  UT_ASSERT_EQUAL (mPortWrites, 100);
+  UT_ASSERT_EQUAL (mLastWritten, 99);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for SyscallIoFifoTransfer () touching neither the port nor the buffer when the policy
+  rejects the access.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+FifoTransferHonorsDenials (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  //
+  // Port missing from the policy.
+  //
+  UT_ASSERT_STATUS_EQUAL (SyscallIoFifoTransfer (NULL, FALSE, TEST_UNLISTED_PORT, MM_IO_UINT8, 16, mBuffer), EFI_ACCESS_DENIED);
+
+  //
+  // Write to a read only port.
+  //
+  UT_ASSERT_STATUS_EQUAL (SyscallIoFifoTransfer (NULL, TRUE, TEST_READ_ONLY_PORT, MM_IO_UINT8, 16, mBuffer), EFI_ACCESS_DENIED);
+
+  UT_ASSERT_EQUAL (mPolicyEvaluations, 2);
+  UT_ASSERT_EQUAL (mPortReads, 0);
+  UT_ASSERT_EQUAL (mPortWrites, 0);
+  for (Index = 0; Index < 16; Index++) {
+    UT_ASSERT_EQUAL (mBuffer[Index], TEST_POISON);
+  }
+
+  //
+  // Read from the read only port is fine.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (SyscallIoFifoTransfer (NULL, FALSE, TEST_READ_ONLY_PORT, MM_IO_UINT8, 16, mBuffer));
+  UT_ASSERT_EQUAL (mPortReads, 16);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for SyscallIoFifoTransfer () rejecting accesses wider than the ports allowed by the policy.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+FifoTransferRejectsPartialRanges (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  //
+  // The 16-bit access at the last read only port spills over the next, unlisted, port.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (SyscallIoFifoTransfer (NULL, FALSE, TEST_READ_ONLY_PORT + 1, MM_IO_UINT8, 4, mBuffer));
+  UT_ASSERT_STATUS_EQUAL (SyscallIoFifoTransfer (NULL, FALSE, TEST_READ_ONLY_PORT + 1, MM_IO_UINT16, 4, mBuffer), EFI_ACCESS_DENIED);
+  UT_ASSERT_EQUAL (mPortReads, 4);
+
+  //
+  // A 32-bit access fits the read/write window only at its start.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (SyscallIoFifoTransfer (NULL, TRUE, TEST_READ_WRITE_PORT, MM_IO_UINT32, 4, mBuffer));
+  UT_ASSERT_STATUS_EQUAL (SyscallIoFifoTransfer (NULL, TRUE, TEST_READ_WRITE_PORT + 2, MM_IO_UINT32, 4, mBuffer), EFI_ACCESS_DENIED);
+  UT_ASSERT_STATUS_EQUAL (SyscallIoFifoTransfer (NULL, FALSE, TEST_READ_WRITE_PORT - 1, MM_IO_UINT16, 4, mBuffer), EFI_ACCESS_DENIED);
+  UT_ASSERT_EQUAL (mPortWrites, 4);
+  UT_ASSERT_EQUAL (mPortReads, 4);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for a bulk FIFO read taking one ring transition per SMM_IO_FIFO_MAX_COUNT bytes, where
+  reading the port byte by byte takes one per byte.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+FifoReducesRingTransitions (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+  UINTN  Remaining;
+  UINTN  Chunk;
+
+  //
+  // One syscall per byte, as IoReadFifo8 used to do.
+  //
+  for (Index = 0; Index < TEST_BULK_LENGTH; Index++) {
+    mBuffer[Index] = (UINT8)TestSysCall (SMM_SC_IO_READ, TEST_READ_WRITE_PORT, MM_IO_UINT8, 0);
+  }
+
+  UT_ASSERT_EQUAL (mRingTransitions, TEST_BULK_LENGTH);
+  UT_ASSERT_EQUAL (mPolicyEvaluations, TEST_BULK_LENGTH);
+
+  //
+  // Bounded FIFO syscalls, the way IoReadFifo8 splits the transfer now.
+  //
+  ResetCounters (NULL);
+  for (Index = 0, Remaining = TEST_BULK_LENGTH; Remaining > 0; Index += Chunk, Remaining -= Chunk) {
+    Chunk = MIN (Remaining, SMM_IO_FIFO_MAX_COUNT);
+    UT_ASSERT_NOT_EFI_ERROR (TestSysCall (SMM_SC_IO_READ_FIFO, TEST_READ_WRITE_PORT, SMM_IO_FIFO_ARG (MM_IO_UINT8, Chunk), (UINTN)&mBuffer[Index]));
+  }
+
+  UT_ASSERT_EQUAL (mRingTransitions, 3);
+  UT_ASSERT_EQUAL (mPolicyEvaluations, 3);
+  UT_ASSERT_EQUAL (mPortReads, TEST_BULK_LENGTH);
+  for (Index = 0; Index < TEST_BULK_LENGTH; Index++) {
+    UT_ASSERT_EQUAL (mBuffer[Index], (UINT8)Index);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  IO FIFO syscalls and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      FifoTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the IO FIFO syscall Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&FifoTests, Framework, "IO FIFO Syscall Tests", "MmSupervisorCore.SyscallIoFifo", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for FifoTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (FifoTests, "FIFO validation should reject malformed arguments", "Validate", FifoValidateRejectsMalformed, NULL, NULL, NULL);
+  AddTestCase (FifoTests, "FIFO transfer should check the policy once", "PolicyOnce", FifoTransferChecksPolicyOnce, ResetCounters, NULL, NULL);
+  AddTestCase (FifoTests, "FIFO transfer should not touch port or buffer when denied", "Denied", FifoTransferHonorsDenials, ResetCounters, NULL, NULL);
+  AddTestCase (FifoTests, "FIFO transfer should reject accesses partially outside of the policy", "PartialRange", FifoTransferRejectsPartialRanges, ResetCounters, NULL, NULL);
+  AddTestCase (FifoTests, "FIFO syscalls should take fewer ring transitions than single port reads", "Transitions", FifoReducesRingTransitions, ResetCounters, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
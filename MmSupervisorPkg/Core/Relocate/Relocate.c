@@ -962,6 +962,9 @@ SetupSmiEntryExit (
   gSmmCpuPrivate->CpuSaveState = (VOID **)AllocatePool (sizeof (VOID *) * mMaxNumberOfCpus);
   ASSERT (gSmmCpuPrivate->CpuSaveState != NULL);
 
+  mUserSaveStateAccessHolder = (USER_SAVE_STATE_ACCESS_STRUCT *)AllocateZeroPool (sizeof (USER_SAVE_STATE_ACCESS_STRUCT) * mMaxNumberOfCpus);
+  ASSERT (mUserSaveStateAccessHolder != NULL);
+
   gSmmCpuPrivate->SmmCoreEntryContext.CpuSaveStateSize = gSmmCpuPrivate->CpuSaveStateSize;
   gSmmCpuPrivate->SmmCoreEntryContext.CpuSaveState     = gSmmCpuPrivate->CpuSaveState;
 
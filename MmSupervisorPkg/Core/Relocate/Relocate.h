@@ -66,6 +66,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "CpuService.h"
 #include "SmmProfile.h"
 #include "SmmMpPerf.h"
+#include "SmramSaveStateBatch.h"
 
 //
 // CET definition
@@ -237,6 +238,22 @@ typedef struct {
   SMM_CPU_SEMAPHORE_CPU       SemaphoreCpu;
 } SMM_CPU_SEMAPHORES;
 
+///
+/// Save state access requested by user space, held per processor
+///
+typedef struct {
+  EFI_MM_CPU_PROTOCOL           *UserMmCpuProtocol;
+  EFI_MM_SAVE_STATE_REGISTER    Register;
+  UINTN                         CpuIndex;
+  UINTN                         Width;
+  VOID                          *Buffer;
+  UINTN                         CompletedSyscall;
+  SMM_SAVE_STATE_READ_ENTRY     Batch[SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES];
+  SAVE_STATE_POLICY_CACHE       PolicyCache;
+} USER_SAVE_STATE_ACCESS_STRUCT;
+
+extern USER_SAVE_STATE_ACCESS_STRUCT  *mUserSaveStateAccessHolder;
+
 extern IA32_DESCRIPTOR       gcSmiGdtr;
 extern EFI_PHYSICAL_ADDRESS  mGdtBuffer;
 extern UINTN                 mGdtBufferSize;
@@ -395,6 +412,20 @@ GetSmiHandlerSize (
   VOID
   );
 
+/**
+  Build the fixup table used by InstallSmiHandler to write the SMI entry stub of every CPU.
+
+  Once the table is built, the per-CPU operands are written into each CPU's copy of the
+  template, and the shared template is no longer patched between copies. Without it, or when
+  PcdMmSupervisorSerialSmiEntryInstall is set, InstallSmiHandler patches the shared template
+  for every CPU as before.
+
+**/
+VOID
+InitializeSmiEntryTemplate (
+  VOID
+  );
+
 /**
   Install the SMI handler for the CPU specified by CpuIndex.  This function
   is called by the CPU that was elected as monarch during System Management
@@ -724,6 +755,34 @@ ProcessUserSaveStateAccess (
   IN UINT64               Arg3
   );
 
+/**
+  This function is called by SyscallDispatcher to process a SMM_SC_SVST_READ_BATCH request,
+  which reads any number of save state registers in a single syscall.
+
+  The request array is copied into the holder of the executing CPU before it is validated,
+  so that user code cannot alter it while it is being processed. The result of every read
+  is written back to the Status field of the user request array.
+
+  @param UserEntries          User buffer holding the array of SMM_SAVE_STATE_READ_ENTRY.
+                              Caller should validate this buffer covers EntryCount entries
+                              before invoking this interface.
+  @param EntryCount           Number of requests in UserEntries.
+  @param UserBuffer           User buffer to hold the data of all requests, packed in request
+                              order.
+
+  @retval EFI_SUCCESS             The batch is processed, individual results are in the Status
+                                  field of each request.
+  @retval EFI_INVALID_PARAMETER   The batch is malformed.
+  @retval EFI_SECURITY_VIOLATION  UserBuffer is not owned by user.
+  @retval EFI_NOT_STARTED         The holder of the executing CPU is not available.
+**/
+EFI_STATUS
+ProcessUserSaveStateBatchRead (
+  IN UINT64  UserEntries,
+  IN UINT64  EntryCount,
+  IN UINT64  UserBuffer
+  );
+
 /**
   Function to perform post relocation logic before handing back to the IPL.
 
@@ -0,0 +1,97 @@
+/** @file
+  Per-CPU SMI entry stubs built from the shared SMI handler template and a table of fixups.
+
+  The template is copied as is and the per-CPU operands are written into the copy, instead of
+  patching the shared template before every copy.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include "SmiEntryTemplate.h"
+
+/**
+  Build the fixup table of the SMI handler template.
+
+  @param[out]  EntryTemplate    The template description to initialize.
+  @param[in]   Template         The SMI handler template.
+  @param[in]   TemplateSize     Size, in bytes, of Template.
+  @param[in]   PatchLabels      Address of the patch label of every SMI_ENTRY_FIXUP_ID.
+
+  @retval EFI_SUCCESS             The fixup table is built.
+  @retval EFI_INVALID_PARAMETER   A pointer is NULL, an operand lies outside of the template,
+                                  or two operands overlap.
+**/
+EFI_STATUS
+SmiEntryTemplateInit (
+  OUT SMI_ENTRY_TEMPLATE  *EntryTemplate,
+  IN  CONST VOID          *Template,
+  IN  UINTN               TemplateSize,
+  IN  CONST UINTN         *PatchLabels
+  )
+{
+  UINTN  Index;
+  UINTN  Other;
+  UINTN  Offset;
+
+  if ((EntryTemplate == NULL) || (Template == NULL) || (PatchLabels == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for (Index = 0; Index < SmiEntryFixupCount; Index++) {
+    //
+    // The operand is the immediate right before the label.
+    //
+    if ((PatchLabels[Index] < (UINTN)Template + SMI_ENTRY_FIXUP_SIZE) ||
+        (PatchLabels[Index] > (UINTN)Template + TemplateSize))
+    {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    Offset = PatchLabels[Index] - (UINTN)Template - SMI_ENTRY_FIXUP_SIZE;
+    for (Other = 0; Other < Index; Other++) {
+      if ((Offset < EntryTemplate->Offset[Other] + SMI_ENTRY_FIXUP_SIZE) &&
+          (EntryTemplate->Offset[Other] < Offset + SMI_ENTRY_FIXUP_SIZE))
+      {
+        return EFI_INVALID_PARAMETER;
+      }
+    }
+
+    EntryTemplate->Offset[Index] = Offset;
+  }
+
+  EntryTemplate->Template     = Template;
+  EntryTemplate->TemplateSize = TemplateSize;
+  return EFI_SUCCESS;
+}
+
+/**
+  Write the SMI entry stub of one CPU.
+
+  The shared template is only read, so stubs of different CPUs can be written in any order
+  or concurrently.
+
+  @param[in]   EntryTemplate    The template description built by SmiEntryTemplateInit.
+  @param[in]   Values           The operands of the CPU.
+  @param[out]  Destination      Receives the TemplateSize bytes of the stub.
+**/
+VOID
+SmiEntryTemplateInstall (
+  IN  CONST SMI_ENTRY_TEMPLATE      *EntryTemplate,
+  IN  CONST SMI_ENTRY_FIXUP_VALUES  *Values,
+  OUT VOID                          *Destination
+  )
+{
+  UINTN  Index;
+
+  CopyMem (Destination, EntryTemplate->Template, EntryTemplate->TemplateSize);
+  for (Index = 0; Index < SmiEntryFixupCount; Index++) {
+    WriteUnaligned32 ((UINT32 *)((UINT8 *)Destination + EntryTemplate->Offset[Index]), Values->Value[Index]);
+  }
+}
@@ -0,0 +1,72 @@
+/** @file
+  Per-CPU SMI entry stubs built from the shared SMI handler template and a table of fixups.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef SMI_ENTRY_TEMPLATE_H_
+#define SMI_ENTRY_TEMPLATE_H_
+
+//
+// Per-CPU operands of the SMI handler template. Every one of them is the 32-bit immediate
+// of the instruction ending at the corresponding patch label.
+//
+typedef enum {
+  SmiEntryFixupSmbase,
+  SmiEntryFixupSmiStack,
+  SmiEntryFixupCr3,
+  SmiEntryFixupCount
+} SMI_ENTRY_FIXUP_ID;
+
+#define SMI_ENTRY_FIXUP_SIZE  sizeof (UINT32)
+
+typedef struct {
+  CONST UINT8    *Template;
+  UINTN          TemplateSize;
+  UINTN          Offset[SmiEntryFixupCount];
+} SMI_ENTRY_TEMPLATE;
+
+typedef struct {
+  UINT32    Value[SmiEntryFixupCount];
+} SMI_ENTRY_FIXUP_VALUES;
+
+/**
+  Build the fixup table of the SMI handler template.
+
+  @param[out]  EntryTemplate    The template description to initialize.
+  @param[in]   Template         The SMI handler template.
+  @param[in]   TemplateSize     Size, in bytes, of Template.
+  @param[in]   PatchLabels      Address of the patch label of every SMI_ENTRY_FIXUP_ID.
+
+  @retval EFI_SUCCESS             The fixup table is built.
+  @retval EFI_INVALID_PARAMETER   A pointer is NULL, an operand lies outside of the template,
+                                  or two operands overlap.
+**/
+EFI_STATUS
+SmiEntryTemplateInit (
+  OUT SMI_ENTRY_TEMPLATE  *EntryTemplate,
+  IN  CONST VOID          *Template,
+  IN  UINTN               TemplateSize,
+  IN  CONST UINTN         *PatchLabels
+  );
+
+/**
+  Write the SMI entry stub of one CPU.
+
+  The shared template is only read, so stubs of different CPUs can be written in any order
+  or concurrently.
+
+  @param[in]   EntryTemplate    The template description built by SmiEntryTemplateInit.
+  @param[in]   Values           The operands of the CPU.
+  @param[out]  Destination      Receives the TemplateSize bytes of the stub.
+**/
+VOID
+SmiEntryTemplateInstall (
+  IN  CONST SMI_ENTRY_TEMPLATE      *EntryTemplate,
+  IN  CONST SMI_ENTRY_FIXUP_VALUES  *Values,
+  OUT VOID                          *Destination
+  );
+
+#endif
@@ -20,8 +20,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/IhvSmmSaveStateSupervisionLib.h>
 
 #include "Relocate.h"
+#include "SmiEntryTemplate.h"
 #include "Services/MpService/MpService.h"
 #include "MmSupervisorCore.h"
+#include "Mem/Mem.h"
 
 typedef struct {
   UINT64    Signature;                                      // Offset 0x00
@@ -62,16 +64,11 @@ typedef struct {
   EFI_SMM_SAVE_STATE_IO_WIDTH    IoWidth;
 } CPU_SMM_SAVE_STATE_IO_WIDTH;
 
-typedef struct {
-  EFI_MM_CPU_PROTOCOL           *UserMmCpuProtocol;
-  EFI_MM_SAVE_STATE_REGISTER    Register;
-  UINTN                         CpuIndex;
-  UINTN                         Width;
-  VOID                          *Buffer;
-  UINTN                         CompletedSyscall;
-} USER_SAVE_STATE_ACCESS_STRUCT;
-
-USER_SAVE_STATE_ACCESS_STRUCT  UserSaveStateAccessHolder;
+//
+// Per-CPU holders of user save state access requests, indexed by the executing CPU so that
+// concurrent requests from different processors do not clobber each other.
+//
+USER_SAVE_STATE_ACCESS_STRUCT  *mUserSaveStateAccessHolder = NULL;
 
 ///
 /// Variables from SMI Handler
@@ -87,6 +84,12 @@ extern CONST UINT16       gcSmiHandlerSize;
 //
 IA32_DESCRIPTOR  gSmiHandlerIdtr;
 
+//
+// Fixup table of gcSmiHandlerTemplate, only used when mSmiEntryTemplateReady is TRUE.
+//
+STATIC SMI_ENTRY_TEMPLATE  mSmiEntryTemplate;
+STATIC BOOLEAN             mSmiEntryTemplateReady = FALSE;
+
 ///
 /// The mode of the CPU at the time an SMI occurs
 ///
@@ -186,6 +189,46 @@ GetSmiHandlerSize (
   return gcSmiHandlerSize;
 }
 
+/**
+  Build the fixup table used by InstallSmiHandler to write the SMI entry stub of every CPU.
+
+  Once the table is built, the per-CPU operands are written into each CPU's copy of the
+  template, and the shared template is no longer patched between copies. Without it, or when
+  PcdMmSupervisorSerialSmiEntryInstall is set, InstallSmiHandler patches the shared template
+  for every CPU as before.
+
+**/
+VOID
+InitializeSmiEntryTemplate (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       PatchLabels[SmiEntryFixupCount];
+
+  mSmiEntryTemplateReady = FALSE;
+  if (FeaturePcdGet (PcdMmSupervisorSerialSmiEntryInstall) || (SmmCpuFeaturesGetSmiHandlerSize () != 0)) {
+    return;
+  }
+
+  PatchLabels[SmiEntryFixupSmbase]   = (UINTN)gPatchSmbase;
+  PatchLabels[SmiEntryFixupSmiStack] = (UINTN)gPatchSmiStack;
+  PatchLabels[SmiEntryFixupCr3]      = (UINTN)gPatchSmiCr3;
+
+  Status = SmiEntryTemplateInit (
+             &mSmiEntryTemplate,
+             (CONST VOID *)gcSmiHandlerTemplate,
+             gcSmiHandlerSize,
+             PatchLabels
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to build the SMI entry fixup table - %r, patching the template per CPU\n", __func__, Status));
+    return;
+  }
+
+  mSmiEntryTemplateReady = TRUE;
+}
+
 /**
   Install the SMI handler for the CPU specified by CpuIndex.  This function
   is called by the CPU that was elected as monarch during System Management
@@ -226,6 +269,7 @@ InstallSmiHandler (
 {
   PROCESSOR_SMM_DESCRIPTOR  *Psd;
   UINT32                    CpuSmiStack;
+  SMI_ENTRY_FIXUP_VALUES    FixupValues;
 
   //
   // Initialize PROCESSOR_SMM_DESCRIPTOR
@@ -255,13 +299,7 @@ InstallSmiHandler (
 
   InitShadowStack (CpuIndex, (VOID *)((UINTN)SmiStack + StackSize));
 
-  //
-  // Initialize values in template before copy
-  //
-  CpuSmiStack = (UINT32)((UINTN)SmiStack + StackSize - sizeof (UINTN));
-  PatchInstructionX86 (gPatchSmiStack, CpuSmiStack, 4);
-  PatchInstructionX86 (gPatchSmiCr3, Cr3, 4);
-  PatchInstructionX86 (gPatchSmbase, SmBase, 4);
+  CpuSmiStack           = (UINT32)((UINTN)SmiStack + StackSize - sizeof (UINTN));
   gSmiHandlerIdtr.Base  = IdtBase;
   gSmiHandlerIdtr.Limit = (UINT16)(IdtSize - 1);
 
@@ -270,6 +308,24 @@ InstallSmiHandler (
   //
   *(UINTN *)(UINTN)CpuSmiStack = CpuIndex;
 
+  if (mSmiEntryTemplateReady) {
+    //
+    // Copy template to CPU specific SMI handler location and fix up the copy
+    //
+    FixupValues.Value[SmiEntryFixupSmbase]   = SmBase;
+    FixupValues.Value[SmiEntryFixupSmiStack] = CpuSmiStack;
+    FixupValues.Value[SmiEntryFixupCr3]      = Cr3;
+    SmiEntryTemplateInstall (&mSmiEntryTemplate, &FixupValues, (VOID *)((UINTN)SmBase + SMM_HANDLER_OFFSET));
+    return;
+  }
+
+  //
+  // Initialize values in template before copy
+  //
+  PatchInstructionX86 (gPatchSmiStack, CpuSmiStack, 4);
+  PatchInstructionX86 (gPatchSmiCr3, Cr3, 4);
+  PatchInstructionX86 (gPatchSmbase, SmBase, 4);
+
   //
   // Copy template to CPU specific SMI handler location
   //
@@ -310,32 +366,43 @@ ProcessUserSaveStateAccess (
   IN UINT64               Arg3
   )
 {
-  EFI_STATUS  Status = EFI_SUCCESS;
+  EFI_STATUS                     Status = EFI_SUCCESS;
+  UINTN                          ExecutingCpu;
+  USER_SAVE_STATE_ACCESS_STRUCT  *Holder;
+
+  Status = SmmWhoAmI (NULL, &ExecutingCpu);
+  if (EFI_ERROR (Status) || (mUserSaveStateAccessHolder == NULL)) {
+    Status = EFI_NOT_STARTED;
+    goto Exit;
+  }
+
+  Holder = &mUserSaveStateAccessHolder[ExecutingCpu];
 
   switch (SyscallIndex) {
     case SMM_SC_SVST_READ:
-      ZeroMem (&UserSaveStateAccessHolder, sizeof (UserSaveStateAccessHolder));
-      UserSaveStateAccessHolder.UserMmCpuProtocol = UserMmCpuProtocol;
-      UserSaveStateAccessHolder.Register          = (EFI_MM_SAVE_STATE_REGISTER)Arg2;
-      UserSaveStateAccessHolder.CpuIndex          = Arg3;
-      UserSaveStateAccessHolder.CompletedSyscall  = SyscallIndex;
+      Holder->UserMmCpuProtocol = UserMmCpuProtocol;
+      Holder->Register          = (EFI_MM_SAVE_STATE_REGISTER)Arg2;
+      Holder->CpuIndex          = Arg3;
+      Holder->Width             = 0;
+      Holder->Buffer            = NULL;
+      Holder->CompletedSyscall  = SyscallIndex;
       break;
     case SMM_SC_SVST_READ_2:
-      if ((UserSaveStateAccessHolder.CompletedSyscall != SMM_SC_SVST_READ) ||
-          (UserSaveStateAccessHolder.UserMmCpuProtocol != UserMmCpuProtocol))
+      if ((Holder->CompletedSyscall != SMM_SC_SVST_READ) ||
+          (Holder->UserMmCpuProtocol != UserMmCpuProtocol))
       {
         Status = EFI_NOT_STARTED;
         goto Exit;
       }
 
-      UserSaveStateAccessHolder.Width  = Arg2;
-      UserSaveStateAccessHolder.Buffer = (VOID *)Arg3;
+      Holder->Width  = Arg2;
+      Holder->Buffer = (VOID *)Arg3;
       // Evaluate the policy against request
       Status = IsIhvSmmSaveStateReadAllowed (
                  FirmwarePolicy,
-                 UserSaveStateAccessHolder.CpuIndex,
-                 UserSaveStateAccessHolder.Register,
-                 UserSaveStateAccessHolder.Width,
+                 Holder->CpuIndex,
+                 Holder->Register,
+                 Holder->Width,
                  NULL
                  );
       if (Status == EFI_NOT_FOUND) {
@@ -347,10 +414,10 @@ ProcessUserSaveStateAccess (
 
       Status = SmmReadSaveState (
                  NULL,
-                 UserSaveStateAccessHolder.Width,
-                 UserSaveStateAccessHolder.Register,
-                 UserSaveStateAccessHolder.CpuIndex,
-                 UserSaveStateAccessHolder.Buffer
+                 Holder->Width,
+                 Holder->Register,
+                 Holder->CpuIndex,
+                 Holder->Buffer
                  );
 
       break;
@@ -362,3 +429,76 @@ ProcessUserSaveStateAccess (
 Exit:
   return Status;
 }
+
+/**
+  This function is called by SyscallDispatcher to process a SMM_SC_SVST_READ_BATCH request,
+  which reads any number of save state registers in a single syscall.
+
+  The request array is copied into the holder of the executing CPU before it is validated,
+  so that user code cannot alter it while it is being processed. The result of every read
+  is written back to the Status field of the user request array.
+
+  @param UserEntries          User buffer holding the array of SMM_SAVE_STATE_READ_ENTRY.
+                              Caller should validate this buffer covers EntryCount entries
+                              before invoking this interface.
+  @param EntryCount           Number of requests in UserEntries.
+  @param UserBuffer           User buffer to hold the data of all requests, packed in request
+                              order.
+
+  @retval EFI_SUCCESS             The batch is processed, individual results are in the Status
+                                  field of each request.
+  @retval EFI_INVALID_PARAMETER   The batch is malformed.
+  @retval EFI_SECURITY_VIOLATION  UserBuffer is not owned by user.
+  @retval EFI_NOT_STARTED         The holder of the executing CPU is not available.
+**/
+EFI_STATUS
+ProcessUserSaveStateBatchRead (
+  IN UINT64  UserEntries,
+  IN UINT64  EntryCount,
+  IN UINT64  UserBuffer
+  )
+{
+  EFI_STATUS                     Status;
+  UINTN                          ExecutingCpu;
+  UINTN                          BufferSize;
+  BOOLEAN                        IsUserRange;
+  USER_SAVE_STATE_ACCESS_STRUCT  *Holder;
+
+  if ((EntryCount == 0) || (EntryCount > SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = SmmWhoAmI (NULL, &ExecutingCpu);
+  if (EFI_ERROR (Status) || (mUserSaveStateAccessHolder == NULL)) {
+    return EFI_NOT_STARTED;
+  }
+
+  Holder = &mUserSaveStateAccessHolder[ExecutingCpu];
+
+  // Any pending two step access of this CPU is superseded by the batch.
+  Holder->CompletedSyscall = SMM_SC_SVST_READ_BATCH;
+
+  CopyMem (Holder->Batch, (VOID *)(UINTN)UserEntries, (UINTN)EntryCount * sizeof (SMM_SAVE_STATE_READ_ENTRY));
+
+  Status = SmmSaveStateBatchValidate (Holder->Batch, (UINTN)EntryCount, gMmCoreMmst.NumberOfCpus, &BufferSize);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (EFI_ERROR (InspectTargetRangeOwnership (UserBuffer, BufferSize, &IsUserRange)) || !IsUserRange) {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  SmmSaveStateBatchRead (
+    FirmwarePolicy,
+    SmmReadSaveState,
+    &Holder->PolicyCache,
+    Holder->Batch,
+    (UINTN)EntryCount,
+    (UINT8 *)(UINTN)UserBuffer
+    );
+
+  CopyMem ((VOID *)(UINTN)UserEntries, Holder->Batch, (UINTN)EntryCount * sizeof (SMM_SAVE_STATE_READ_ENTRY));
+
+  return EFI_SUCCESS;
+}
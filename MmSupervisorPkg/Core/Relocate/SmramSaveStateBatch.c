@@ -0,0 +1,218 @@
+/** @file
+  Batched save state read used by the SMM_SC_SVST_READ_BATCH syscall.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+#include <SmmSecurePolicy.h>
+
+#include <Protocol/MmCpu.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SysCallLib.h>
+#include <Library/IhvSmmSaveStateSupervisionLib.h>
+
+#include "SmramSaveStateBatch.h"
+
+/**
+  Check whether the policy verdict of a register depends on the CPU it is read from.
+
+  The save state supervision policy evaluates RAX and the IO information against the
+  IO information recorded in the save state of the target CPU, so the same request can
+  be allowed on the CPU that trapped the IO and rejected on all others.
+
+  @param[in] Register  The save state register.
+
+  @retval TRUE   The verdict has to be evaluated for every CPU.
+  @retval FALSE  The verdict is the same for every CPU.
+
+**/
+STATIC
+BOOLEAN
+IsPolicyVerdictPerCpu (
+  IN EFI_MM_SAVE_STATE_REGISTER  Register
+  )
+{
+  return (BOOLEAN)((Register == EFI_MM_SAVE_STATE_REGISTER_RAX) || (Register == EFI_MM_SAVE_STATE_REGISTER_IO));
+}
+
+/**
+  Evaluate the security policy for a single request, reusing a verdict of the same batch
+  when one applies.
+
+  @param[in]      Policy    The security policy in force.
+  @param[in, out] Cache     Policy verdict cache of the batch.
+  @param[in]      CpuIndex  CPU index of the request.
+  @param[in]      Register  Register of the request.
+  @param[in]      Width     Width of the request.
+
+  @return The status returned by IsIhvSmmSaveStateReadAllowed for this request.
+
+**/
+STATIC
+EFI_STATUS
+EvaluateSaveStatePolicy (
+  IN     SMM_SUPV_SECURE_POLICY_DATA_V1_0  *Policy,
+  IN OUT SAVE_STATE_POLICY_CACHE           *Cache,
+  IN     UINTN                             CpuIndex,
+  IN     EFI_MM_SAVE_STATE_REGISTER        Register,
+  IN     UINTN                             Width
+  )
+{
+  UINTN                      Index;
+  UINTN                      CacheCpuIndex;
+  EFI_STATUS                 Verdict;
+  SAVE_STATE_POLICY_VERDICT  *Entry;
+
+  CacheCpuIndex = IsPolicyVerdictPerCpu (Register) ? CpuIndex : SAVE_STATE_POLICY_ANY_CPU;
+
+  for (Index = 0; Index < Cache->Count; Index++) {
+    Entry = &Cache->Verdicts[Index];
+    if ((Entry->Register == Register) && (Entry->Width == Width) && (Entry->CpuIndex == CacheCpuIndex)) {
+      return Entry->Verdict;
+    }
+  }
+
+  Verdict = IsIhvSmmSaveStateReadAllowed (Policy, CpuIndex, Register, Width, NULL);
+
+  if (Cache->Count < SAVE_STATE_POLICY_CACHE_SIZE) {
+    Entry           = &Cache->Verdicts[Cache->Count++];
+    Entry->Register = Register;
+    Entry->Width    = Width;
+    Entry->CpuIndex = CacheCpuIndex;
+    Entry->Verdict  = Verdict;
+  }
+
+  return Verdict;
+}
+
+/**
+  Validate a batch of save state read requests and compute the size of its output buffer.
+
+  The requests must already be copied out of user memory, so that they cannot change
+  between this validation and the reads.
+
+  @param[in]  Entries       The requests to validate.
+  @param[in]  EntryCount    Number of requests in Entries.
+  @param[in]  NumberOfCpus  Number of CPUs in the system.
+  @param[out] BufferSize    Size in bytes of the output buffer the batch needs.
+
+  @retval EFI_SUCCESS            The batch is well formed.
+  @retval EFI_INVALID_PARAMETER  EntryCount is 0 or exceeds SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES,
+                                 or a request has a bad CPU index, register or width.
+
+**/
+EFI_STATUS
+SmmSaveStateBatchValidate (
+  IN  CONST SMM_SAVE_STATE_READ_ENTRY  *Entries,
+  IN  UINTN                            EntryCount,
+  IN  UINTN                            NumberOfCpus,
+  OUT UINTN                            *BufferSize
+  )
+{
+  UINTN  Index;
+  UINTN  Size;
+
+  if ((Entries == NULL) || (BufferSize == NULL) ||
+      (EntryCount == 0) || (EntryCount > SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // The widest save state register is the IO information, so with the entry count capped
+  // the total size cannot overflow.
+  //
+  Size = 0;
+  for (Index = 0; Index < EntryCount; Index++) {
+    if ((Entries[Index].CpuIndex >= NumberOfCpus) ||
+        (Entries[Index].Register > EFI_MM_SAVE_STATE_REGISTER_PROCESSOR_ID) ||
+        (Entries[Index].Width == 0) ||
+        (Entries[Index].Width > sizeof (EFI_MM_SAVE_STATE_IO_INFO)))
+    {
+      DEBUG ((DEBUG_ERROR, "%a Malformed save state request %d\n", __func__, Index));
+      return EFI_INVALID_PARAMETER;
+    }
+
+    Size += Entries[Index].Width;
+  }
+
+  *BufferSize = Size;
+  return EFI_SUCCESS;
+}
+
+/**
+  Perform a validated batch of save state reads.
+
+  Every request is checked against the security policy before it is read, but each policy
+  verdict is evaluated only once per batch for the same register and width. Registers whose
+  verdict depends on the IO information of the target CPU are evaluated once per CPU instead.
+  The result of each request is written to its Status field; the data of the successful
+  requests is written to the output buffer at the offset of the request.
+
+  @param[in]      Policy         The security policy in force.
+  @param[in]      ReadSaveState  Routine reading a single register from the save state.
+  @param[in, out] Cache          Per-CPU policy verdict cache, reset on entry.
+  @param[in, out] Entries        The requests, validated by SmmSaveStateBatchValidate.
+  @param[in]      EntryCount     Number of requests in Entries.
+  @param[out]     Buffer         Output buffer of the size reported by SmmSaveStateBatchValidate.
+
+  @return The number of requests that were read successfully.
+
+**/
+UINTN
+SmmSaveStateBatchRead (
+  IN     SMM_SUPV_SECURE_POLICY_DATA_V1_0  *Policy,
+  IN     EFI_MM_READ_SAVE_STATE            ReadSaveState,
+  IN OUT SAVE_STATE_POLICY_CACHE           *Cache,
+  IN OUT SMM_SAVE_STATE_READ_ENTRY         *Entries,
+  IN     UINTN                             EntryCount,
+  OUT    UINT8                             *Buffer
+  )
+{
+  UINTN       Index;
+  UINTN       Offset;
+  UINTN       Completed;
+  EFI_STATUS  Status;
+
+  Cache->Count = 0;
+  Offset       = 0;
+  Completed    = 0;
+
+  for (Index = 0; Index < EntryCount; Index++) {
+    Status = EvaluateSaveStatePolicy (
+               Policy,
+               Cache,
+               Entries[Index].CpuIndex,
+               (EFI_MM_SAVE_STATE_REGISTER)Entries[Index].Register,
+               Entries[Index].Width
+               );
+    if (EFI_ERROR (Status)) {
+      // EFI_NOT_FOUND only means the CPU did not trap the IO, it is not a violation.
+      if (Status != EFI_NOT_FOUND) {
+        DEBUG ((DEBUG_ERROR, "%a SavestateRead %d Blocked by Policy - %r\n", __func__, Index, Status));
+      }
+    } else {
+      Status = ReadSaveState (
+                 NULL,
+                 Entries[Index].Width,
+                 (EFI_MM_SAVE_STATE_REGISTER)Entries[Index].Register,
+                 Entries[Index].CpuIndex,
+                 Buffer + Offset
+                 );
+    }
+
+    Entries[Index].Status = Status;
+    if (!EFI_ERROR (Status)) {
+      Completed++;
+    }
+
+    Offset += Entries[Index].Width;
+  }
+
+  return Completed;
+}
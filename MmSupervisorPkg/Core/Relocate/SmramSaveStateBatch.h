@@ -0,0 +1,91 @@
+/** @file
+  Definitions of the batched save state read used by the SMM_SC_SVST_READ_BATCH syscall.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef SMRAM_SAVE_STATE_BATCH_H_
+#define SMRAM_SAVE_STATE_BATCH_H_
+
+#include <SmmSecurePolicy.h>
+#include <Protocol/MmCpu.h>
+#include <Library/SysCallLib.h>
+
+//
+// Number of policy verdicts remembered while processing a single batch.
+//
+#define SAVE_STATE_POLICY_CACHE_SIZE  16
+
+//
+// CpuIndex of a cached verdict that applies to every CPU.
+//
+#define SAVE_STATE_POLICY_ANY_CPU  MAX_UINTN
+
+typedef struct {
+  EFI_MM_SAVE_STATE_REGISTER    Register;
+  UINTN                         Width;
+  UINTN                         CpuIndex;
+  EFI_STATUS                    Verdict;
+} SAVE_STATE_POLICY_VERDICT;
+
+typedef struct {
+  UINTN                        Count;
+  SAVE_STATE_POLICY_VERDICT    Verdicts[SAVE_STATE_POLICY_CACHE_SIZE];
+} SAVE_STATE_POLICY_CACHE;
+
+/**
+  Validate a batch of save state read requests and compute the size of its output buffer.
+
+  The requests must already be copied out of user memory, so that they cannot change
+  between this validation and the reads.
+
+  @param[in]  Entries       The requests to validate.
+  @param[in]  EntryCount    Number of requests in Entries.
+  @param[in]  NumberOfCpus  Number of CPUs in the system.
+  @param[out] BufferSize    Size in bytes of the output buffer the batch needs.
+
+  @retval EFI_SUCCESS            The batch is well formed.
+  @retval EFI_INVALID_PARAMETER  EntryCount is 0 or exceeds SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES,
+                                 or a request has a bad CPU index, register or width.
+
+**/
+EFI_STATUS
+SmmSaveStateBatchValidate (
+  IN  CONST SMM_SAVE_STATE_READ_ENTRY  *Entries,
+  IN  UINTN                            EntryCount,
+  IN  UINTN                            NumberOfCpus,
+  OUT UINTN                            *BufferSize
+  );
+
+/**
+  Perform a validated batch of save state reads.
+
+  Every request is checked against the security policy before it is read, but each policy
+  verdict is evaluated only once per batch for the same register and width. Registers whose
+  verdict depends on the IO information of the target CPU are evaluated once per CPU instead.
+  The result of each request is written to its Status field; the data of the successful
+  requests is written to the output buffer at the offset of the request.
+
+  @param[in]      Policy         The security policy in force.
+  @param[in]      ReadSaveState  Routine reading a single register from the save state.
+  @param[in, out] Cache          Per-CPU policy verdict cache, reset on entry.
+  @param[in, out] Entries        The requests, validated by SmmSaveStateBatchValidate.
+  @param[in]      EntryCount     Number of requests in Entries.
+  @param[out]     Buffer         Output buffer of the size reported by SmmSaveStateBatchValidate.
+
+  @return The number of requests that were read successfully.
+
+**/
+UINTN
+SmmSaveStateBatchRead (
+  IN     SMM_SUPV_SECURE_POLICY_DATA_V1_0  *Policy,
+  IN     EFI_MM_READ_SAVE_STATE            ReadSaveState,
+  IN OUT SAVE_STATE_POLICY_CACHE           *Cache,
+  IN OUT SMM_SAVE_STATE_READ_ENTRY         *Entries,
+  IN     UINTN                             EntryCount,
+  OUT    UINT8                             *Buffer
+  );
+
+#endif // SMRAM_SAVE_STATE_BATCH_H_
@@ -0,0 +1,287 @@
+/** @file
+  Unit tests of the SMI entry stubs built from the SMI handler template and its fixup table
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../SmiEntryTemplate.h"
+
+#define UNIT_TEST_APP_NAME     "MM Supervisor SMI Entry Template Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Number of CPUs of the simulated system.
+//
+#define TEST_NUMBER_OF_CPUS  64
+
+//
+// Size of the simulated SMI handler template, and the end of the instruction carrying every operand.
+// The SMBASE operand ends the template on purpose, to cover an operand right at the end.
+//
+#define TEST_TEMPLATE_SIZE       0x1A3
+#define TEST_LABEL_SMI_STACK     0x4D
+#define TEST_LABEL_CR3           0x96
+#define TEST_LABEL_SMBASE        TEST_TEMPLATE_SIZE
+
+//
+// Layout of the simulated SMRAM, one SMI entry stub per CPU.
+//
+#define TEST_STUB_STRIDE  0x200
+
+UINT8  mTemplate[TEST_TEMPLATE_SIZE];
+UINT8  mReferenceSmram[TEST_NUMBER_OF_CPUS * TEST_STUB_STRIDE];
+UINT8  mSmram[TEST_NUMBER_OF_CPUS * TEST_STUB_STRIDE];
+
+/**
+  Fill the simulated template with a recognizable pattern.
+**/
+VOID
+FillTemplate (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < sizeof (mTemplate); Index++) {
+    mTemplate[Index] = (UINT8)(Index * 7 + 3);
+  }
+}
+
+/**
+  Addresses of the patch labels of the simulated template.
+
+  @param[out]  PatchLabels   Receives the label address of every SMI_ENTRY_FIXUP_ID.
+**/
+VOID
+GetPatchLabels (
+  OUT UINTN  *PatchLabels
+  )
+{
+  PatchLabels[SmiEntryFixupSmbase]   = (UINTN)mTemplate + TEST_LABEL_SMBASE;
+  PatchLabels[SmiEntryFixupSmiStack] = (UINTN)mTemplate + TEST_LABEL_SMI_STACK;
+  PatchLabels[SmiEntryFixupCr3]      = (UINTN)mTemplate + TEST_LABEL_CR3;
+}
+
+/**
+  Operands of the simulated CPU.
+
+  @param[in]   CpuIndex   The CPU.
+  @param[out]  Values     Receives the operands of the CPU.
+**/
+VOID
+GetCpuValues (
+  IN  UINTN                   CpuIndex,
+  OUT SMI_ENTRY_FIXUP_VALUES  *Values
+  )
+{
+  Values->Value[SmiEntryFixupSmbase]   = (UINT32)(0x7F000000 + CpuIndex * 0x400);
+  Values->Value[SmiEntryFixupSmiStack] = (UINT32)(0x7E000000 + CpuIndex * 0x8000 - sizeof (UINTN));
+  Values->Value[SmiEntryFixupCr3]      = 0x7D001000;
+}
+
+/**
+  Install the stub of one CPU the serial way: patch the shared template, then copy it.
+
+  @param[in]  CpuIndex      The CPU.
+  @param[in]  Destination   Receives the stub.
+**/
+VOID
+ReferenceInstall (
+  IN UINTN  CpuIndex,
+  OUT VOID  *Destination
+  )
+{
+  SMI_ENTRY_FIXUP_VALUES  Values;
+
+  GetCpuValues (CpuIndex, &Values);
+  WriteUnaligned32 ((UINT32 *)(mTemplate + TEST_LABEL_SMI_STACK - 4), Values.Value[SmiEntryFixupSmiStack]);
+  WriteUnaligned32 ((UINT32 *)(mTemplate + TEST_LABEL_CR3 - 4), Values.Value[SmiEntryFixupCr3]);
+  WriteUnaligned32 ((UINT32 *)(mTemplate + TEST_LABEL_SMBASE - 4), Values.Value[SmiEntryFixupSmbase]);
+  CopyMem (Destination, mTemplate, sizeof (mTemplate));
+}
+
+/*
+  Unit test for SmiEntryTemplateInit () rejecting operands outside of the template or overlapping.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+InitRejectsBadLabels (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMI_ENTRY_TEMPLATE  EntryTemplate;
+  UINTN               PatchLabels[SmiEntryFixupCount];
+
+  GetPatchLabels (PatchLabels);
+  UT_ASSERT_STATUS_EQUAL (SmiEntryTemplateInit (NULL, mTemplate, sizeof (mTemplate), PatchLabels), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (SmiEntryTemplateInit (&EntryTemplate, NULL, sizeof (mTemplate), PatchLabels), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (SmiEntryTemplateInit (&EntryTemplate, mTemplate, sizeof (mTemplate), NULL), EFI_INVALID_PARAMETER);
+
+  //
+  // Operand past the end of the template.
+  //
+  PatchLabels[SmiEntryFixupSmbase] = (UINTN)mTemplate + sizeof (mTemplate) + 1;
+  UT_ASSERT_STATUS_EQUAL (SmiEntryTemplateInit (&EntryTemplate, mTemplate, sizeof (mTemplate), PatchLabels), EFI_INVALID_PARAMETER);
+
+  //
+  // Operand before the start of the template.
+  //
+  GetPatchLabels (PatchLabels);
+  PatchLabels[SmiEntryFixupCr3] = (UINTN)mTemplate + 3;
+  UT_ASSERT_STATUS_EQUAL (SmiEntryTemplateInit (&EntryTemplate, mTemplate, sizeof (mTemplate), PatchLabels), EFI_INVALID_PARAMETER);
+
+  //
+  // Overlapping operands.
+  //
+  GetPatchLabels (PatchLabels);
+  PatchLabels[SmiEntryFixupCr3] = PatchLabels[SmiEntryFixupSmiStack] + 3;
+  UT_ASSERT_STATUS_EQUAL (SmiEntryTemplateInit (&EntryTemplate, mTemplate, sizeof (mTemplate), PatchLabels), EFI_INVALID_PARAMETER);
+
+  //
+  // Adjacent operands, and an operand right at the start of the template.
+  //
+  PatchLabels[SmiEntryFixupCr3]      = PatchLabels[SmiEntryFixupSmiStack] + 4;
+  PatchLabels[SmiEntryFixupSmbase]   = (UINTN)mTemplate + 4;
+  UT_ASSERT_NOT_EFI_ERROR (SmiEntryTemplateInit (&EntryTemplate, mTemplate, sizeof (mTemplate), PatchLabels));
+  UT_ASSERT_EQUAL (EntryTemplate.Offset[SmiEntryFixupSmbase], 0);
+  UT_ASSERT_EQUAL (EntryTemplate.Offset[SmiEntryFixupCr3], TEST_LABEL_SMI_STACK);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for SmiEntryTemplateInstall () producing the same stubs as patching the shared template
+  before every copy, whatever the installation order, and leaving the template untouched.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+InstallMatchesSerialPatching (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMI_ENTRY_TEMPLATE      EntryTemplate;
+  SMI_ENTRY_FIXUP_VALUES  Values;
+  UINTN                   PatchLabels[SmiEntryFixupCount];
+  UINT8                   Pristine[TEST_TEMPLATE_SIZE];
+  UINTN                   Index;
+  UINTN                   CpuIndex;
+
+  FillTemplate ();
+  SetMem (mReferenceSmram, sizeof (mReferenceSmram), 0xCC);
+  SetMem (mSmram, sizeof (mSmram), 0xCC);
+
+  GetPatchLabels (PatchLabels);
+  UT_ASSERT_NOT_EFI_ERROR (SmiEntryTemplateInit (&EntryTemplate, mTemplate, sizeof (mTemplate), PatchLabels));
+  UT_ASSERT_EQUAL (EntryTemplate.TemplateSize, TEST_TEMPLATE_SIZE);
+
+  //
+  // Install every stub in a scrambled order.
+  //
+  CopyMem (Pristine, mTemplate, sizeof (mTemplate));
+  for (Index = 0; Index < TEST_NUMBER_OF_CPUS; Index++) {
+    CpuIndex = (Index * 37 + 11) % TEST_NUMBER_OF_CPUS;
+    GetCpuValues (CpuIndex, &Values);
+    SmiEntryTemplateInstall (&EntryTemplate, &Values, mSmram + CpuIndex * TEST_STUB_STRIDE);
+  }
+
+  UT_ASSERT_MEM_EQUAL (mTemplate, Pristine, sizeof (mTemplate));
+
+  for (CpuIndex = 0; CpuIndex < TEST_NUMBER_OF_CPUS; CpuIndex++) {
+    ReferenceInstall (CpuIndex, mReferenceSmram + CpuIndex * TEST_STUB_STRIDE);
+  }
+
+  //
+  // Bytes past every stub must not be touched either.
+  //
+  UT_ASSERT_MEM_EQUAL (mSmram, mReferenceSmram, sizeof (mSmram));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  SMI entry template and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      TemplateTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the SMI entry template Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&TemplateTests, Framework, "SMI Entry Template Tests", "MmSupervisorCore.SmiEntryTemplate", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for TemplateTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (TemplateTests, "Fixup table should reject operands outside of the template or overlapping", "Init", InitRejectsBadLabels, NULL, NULL, NULL);
+  AddTestCase (TemplateTests, "Fixed up stubs should match stubs of the patched shared template", "Install", InstallMatchesSerialPatching, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,558 @@
+/** @file
+  Unit tests of the batched save state read behind the SMM_SC_SVST_READ_BATCH syscall
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Pi/PiMmCis.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/IhvSmmSaveStateSupervisionLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../SmramSaveStateBatch.h"
+
+#define UNIT_TEST_APP_NAME     "MM Supervisor Save State Batch Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Number of CPUs of the simulated system, and the CPU that trapped the IO of the simulated SMI.
+//
+#define TEST_NUMBER_OF_CPUS  16
+#define TEST_TRAP_CPU        3
+
+//
+// Register the simulated policy rejects on every CPU.
+//
+#define TEST_DENIED_REGISTER  EFI_MM_SAVE_STATE_REGISTER_CR0
+
+//
+// Value written to output buffers before a batch, to detect writes to rejected requests.
+//
+#define TEST_POISON  0xA5
+
+//
+// Counters of the simulated supervisor services.
+//
+UINTN  mPolicyEvaluations;
+UINTN  mSaveStateReads;
+UINTN  mRingTransitions;
+
+SAVE_STATE_POLICY_CACHE    mPolicyCache;
+SMM_SAVE_STATE_READ_ENTRY  mSupervisorBatch[SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES];
+
+//
+// Staged request of the simulated two step SMM_SC_SVST_READ/SMM_SC_SVST_READ_2 pair.
+//
+EFI_MM_SAVE_STATE_REGISTER  mStagedRegister;
+UINTN                       mStagedCpuIndex;
+
+/**
+  Simulated save state supervision policy.
+
+  RAX and the IO information are only readable from the CPU that trapped the IO,
+  TEST_DENIED_REGISTER is never readable and everything else is always readable.
+**/
+EFI_STATUS
+EFIAPI
+IsIhvSmmSaveStateReadAllowed (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy,
+  IN UINTN                             CpuIndex,
+  IN EFI_MM_SAVE_STATE_REGISTER        Register,
+  IN UINTN                             Width,
+  IN GATELIB_CPU_SMM_DATA              *CpuSmmData
+  )
+{
+  mPolicyEvaluations++;
+
+  if ((Register == EFI_MM_SAVE_STATE_REGISTER_RAX) || (Register == EFI_MM_SAVE_STATE_REGISTER_IO)) {
+    return (CpuIndex == TEST_TRAP_CPU) ? EFI_SUCCESS : EFI_NOT_FOUND;
+  }
+
+  if (Register == TEST_DENIED_REGISTER) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Simulated save state read, filling the buffer with a value derived from the request.
+**/
+EFI_STATUS
+EFIAPI
+TestReadSaveState (
+  IN CONST EFI_MM_CPU_PROTOCOL   *This,
+  IN UINTN                       Width,
+  IN EFI_MM_SAVE_STATE_REGISTER  Register,
+  IN UINTN                       CpuIndex,
+  OUT VOID                       *Buffer
+  )
+{
+  UINT64  Value;
+
+  mSaveStateReads++;
+
+  Value = LShiftU64 (CpuIndex, 32) | Register;
+  SetMem (Buffer, Width, 0);
+  CopyMem (Buffer, &Value, MIN (Width, sizeof (Value)));
+  return EFI_SUCCESS;
+}
+
+/**
+  Simulated syscall entry, counting ring transitions and servicing the save state
+  syscalls the way the supervisor does.
+**/
+UINT64
+TestSysCall (
+  IN UINTN  CallIndex,
+  IN UINTN  Arg1,
+  IN UINTN  Arg2,
+  IN UINTN  Arg3
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       BufferSize;
+
+  mRingTransitions++;
+
+  switch (CallIndex) {
+    case SMM_SC_SVST_READ:
+      mStagedRegister = (EFI_MM_SAVE_STATE_REGISTER)Arg2;
+      mStagedCpuIndex = Arg3;
+      return EFI_SUCCESS;
+    case SMM_SC_SVST_READ_2:
+      Status = IsIhvSmmSaveStateReadAllowed (NULL, mStagedCpuIndex, mStagedRegister, Arg2, NULL);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      return TestReadSaveState (NULL, Arg2, mStagedRegister, mStagedCpuIndex, (VOID *)Arg3);
+    case SMM_SC_SVST_READ_BATCH:
+      CopyMem (mSupervisorBatch, (VOID *)Arg1, Arg2 * sizeof (SMM_SAVE_STATE_READ_ENTRY));
+      Status = SmmSaveStateBatchValidate (mSupervisorBatch, Arg2, TEST_NUMBER_OF_CPUS, &BufferSize);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      SmmSaveStateBatchRead (NULL, TestReadSaveState, &mPolicyCache, mSupervisorBatch, Arg2, (UINT8 *)Arg3);
+      CopyMem ((VOID *)Arg1, mSupervisorBatch, Arg2 * sizeof (SMM_SAVE_STATE_READ_ENTRY));
+      return EFI_SUCCESS;
+    default:
+      return EFI_INVALID_PARAMETER;
+  }
+}
+
+/*
+  Helper function to reset the counters of the simulated supervisor services.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+ResetCounters (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mPolicyEvaluations = 0;
+  mSaveStateReads    = 0;
+  mRingTransitions   = 0;
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Helper function to fill in a save state read request.
+*/
+VOID
+SetEntry (
+  OUT SMM_SAVE_STATE_READ_ENTRY   *Entry,
+  IN  UINTN                       CpuIndex,
+  IN  EFI_MM_SAVE_STATE_REGISTER  Register,
+  IN  UINTN                       Width
+  )
+{
+  Entry->CpuIndex = (UINT32)CpuIndex;
+  Entry->Register = (UINT32)Register;
+  Entry->Width    = (UINT32)Width;
+  Entry->Reserved = 0;
+  Entry->Status   = EFI_NOT_STARTED;
+}
+
+/*
+  Unit test for SmmSaveStateBatchValidate () rejecting malformed batches.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+BatchValidateRejectsMalformed (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SAVE_STATE_READ_ENTRY  Entries[SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES + 1];
+  UINTN                      BufferSize;
+  UINTN                      Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (Entries); Index++) {
+    SetEntry (&Entries[Index], 0, EFI_MM_SAVE_STATE_REGISTER_RBX, sizeof (UINT64));
+  }
+
+  UT_ASSERT_STATUS_EQUAL (SmmSaveStateBatchValidate (Entries, 0, TEST_NUMBER_OF_CPUS, &BufferSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (SmmSaveStateBatchValidate (Entries, ARRAY_SIZE (Entries), TEST_NUMBER_OF_CPUS, &BufferSize), EFI_INVALID_PARAMETER);
+
+  SetEntry (&Entries[1], TEST_NUMBER_OF_CPUS, EFI_MM_SAVE_STATE_REGISTER_RBX, sizeof (UINT64));
+  UT_ASSERT_STATUS_EQUAL (SmmSaveStateBatchValidate (Entries, 2, TEST_NUMBER_OF_CPUS, &BufferSize), EFI_INVALID_PARAMETER);
+
+  SetEntry (&Entries[1], 0, EFI_MM_SAVE_STATE_REGISTER_PROCESSOR_ID + 1, sizeof (UINT64));
+  UT_ASSERT_STATUS_EQUAL (SmmSaveStateBatchValidate (Entries, 2, TEST_NUMBER_OF_CPUS, &BufferSize), EFI_INVALID_PARAMETER);
+
+  SetEntry (&Entries[1], 0, EFI_MM_SAVE_STATE_REGISTER_RBX, 0);
+  UT_ASSERT_STATUS_EQUAL (SmmSaveStateBatchValidate (Entries, 2, TEST_NUMBER_OF_CPUS, &BufferSize), EFI_INVALID_PARAMETER);
+
+  SetEntry (&Entries[1], 0, EFI_MM_SAVE_STATE_REGISTER_IO, sizeof (EFI_MM_SAVE_STATE_IO_INFO) + 1);
+  UT_ASSERT_STATUS_EQUAL (SmmSaveStateBatchValidate (Entries, 2, TEST_NUMBER_OF_CPUS, &BufferSize), EFI_INVALID_PARAMETER);
+
+  SetEntry (&Entries[1], TEST_NUMBER_OF_CPUS - 1, EFI_MM_SAVE_STATE_REGISTER_IO, sizeof (EFI_MM_SAVE_STATE_IO_INFO));
+  UT_ASSERT_NOT_EFI_ERROR (SmmSaveStateBatchValidate (Entries, 2, TEST_NUMBER_OF_CPUS, &BufferSize));
+  UT_ASSERT_EQUAL (BufferSize, sizeof (UINT64) + sizeof (EFI_MM_SAVE_STATE_IO_INFO));
+
+  UT_ASSERT_NOT_EFI_ERROR (SmmSaveStateBatchValidate (Entries, SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES, TEST_NUMBER_OF_CPUS, &BufferSize));
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for SmmSaveStateBatchRead () packing the data of every request in request order.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+BatchReadPacksResults (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SAVE_STATE_READ_ENTRY  Entries[3];
+  UINT8                      Buffer[sizeof (UINT16) + sizeof (UINT64) + sizeof (UINT32)];
+  UINTN                      BufferSize;
+  UINT16                     Value16;
+  UINT64                     Value64;
+  UINT32                     Value32;
+
+  SetEntry (&Entries[0], 1, EFI_MM_SAVE_STATE_REGISTER_RBX, sizeof (UINT16));
+  SetEntry (&Entries[1], 2, EFI_MM_SAVE_STATE_REGISTER_RCX, sizeof (UINT64));
+  SetEntry (&Entries[2], 5, EFI_MM_SAVE_STATE_REGISTER_RDX, sizeof (UINT32));
+
+  UT_ASSERT_NOT_EFI_ERROR (SmmSaveStateBatchValidate (Entries, ARRAY_SIZE (Entries), TEST_NUMBER_OF_CPUS, &BufferSize));
+  UT_ASSERT_EQUAL (BufferSize, sizeof (Buffer));
+
+  SetMem (Buffer, sizeof (Buffer), TEST_POISON);
+  UT_ASSERT_EQUAL (SmmSaveStateBatchRead (NULL, TestReadSaveState, &mPolicyCache, Entries, ARRAY_SIZE (Entries), Buffer), 3);
+
+  UT_ASSERT_NOT_EFI_ERROR (Entries[0].Status);
+  UT_ASSERT_NOT_EFI_ERROR (Entries[1].Status);
+  UT_ASSERT_NOT_EFI_ERROR (Entries[2].Status);
+
+  CopyMem (&Value16, &Buffer[0], sizeof (Value16));
+  CopyMem (&Value64, &Buffer[sizeof (UINT16)], sizeof (Value64));
+  CopyMem (&Value32, &Buffer[sizeof (UINT16) + sizeof (UINT64)], sizeof (Value32));
+  UT_ASSERT_EQUAL (Value16, (UINT16)EFI_MM_SAVE_STATE_REGISTER_RBX);
+  UT_ASSERT_EQUAL (Value64, LShiftU64 (2, 32) | EFI_MM_SAVE_STATE_REGISTER_RCX);
+  UT_ASSERT_EQUAL (Value32, (UINT32)EFI_MM_SAVE_STATE_REGISTER_RDX);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for SmmSaveStateBatchRead () evaluating the policy once per register and width,
+  except for the registers whose verdict depends on the target CPU.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+BatchReadEvaluatesPolicyOncePerPair (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SAVE_STATE_READ_ENTRY  Entries[3 * TEST_NUMBER_OF_CPUS];
+  UINT64                     Buffer[ARRAY_SIZE (Entries)];
+  UINTN                      CpuIndex;
+
+  for (CpuIndex = 0; CpuIndex < TEST_NUMBER_OF_CPUS; CpuIndex++) {
+    SetEntry (&Entries[3 * CpuIndex], CpuIndex, EFI_MM_SAVE_STATE_REGISTER_RBX, sizeof (UINT64));
+    SetEntry (&Entries[3 * CpuIndex + 1], CpuIndex, EFI_MM_SAVE_STATE_REGISTER_RBX, sizeof (UINT32));
+    SetEntry (&Entries[3 * CpuIndex + 2], CpuIndex, EFI_MM_SAVE_STATE_REGISTER_RAX, sizeof (UINT64));
+  }
+
+  UT_ASSERT_EQUAL (
+    SmmSaveStateBatchRead (NULL, TestReadSaveState, &mPolicyCache, Entries, ARRAY_SIZE (Entries), (UINT8 *)Buffer),
+    2 * TEST_NUMBER_OF_CPUS + 1
+    );
+
+  //
+  // One verdict per RBX width, one RAX verdict per CPU.
+  //
+  UT_ASSERT_EQUAL (mPolicyEvaluations, 2 + TEST_NUMBER_OF_CPUS);
+  UT_ASSERT_EQUAL (mSaveStateReads, 2 * TEST_NUMBER_OF_CPUS + 1);
+
+  for (CpuIndex = 0; CpuIndex < TEST_NUMBER_OF_CPUS; CpuIndex++) {
+    UT_ASSERT_NOT_EFI_ERROR (Entries[3 * CpuIndex].Status);
+    UT_ASSERT_NOT_EFI_ERROR (Entries[3 * CpuIndex + 1].Status);
+    if (CpuIndex == TEST_TRAP_CPU) {
+      UT_ASSERT_NOT_EFI_ERROR (Entries[3 * CpuIndex + 2].Status);
+    } else {
+      UT_ASSERT_STATUS_EQUAL (Entries[3 * CpuIndex + 2].Status, EFI_NOT_FOUND);
+    }
+  }
+
+  //
+  // The cache only lives for one batch.
+  //
+  SmmSaveStateBatchRead (NULL, TestReadSaveState, &mPolicyCache, Entries, ARRAY_SIZE (Entries), (UINT8 *)Buffer);
+  UT_ASSERT_EQUAL (mPolicyEvaluations, 2 * (2 + TEST_NUMBER_OF_CPUS));
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for SmmSaveStateBatchRead () leaving the output of rejected requests untouched.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+BatchReadSkipsDeniedRequests (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SAVE_STATE_READ_ENTRY  Entries[2];
+  UINT8                      Buffer[2 * sizeof (UINT64)];
+  UINTN                      Index;
+
+  SetEntry (&Entries[0], 0, TEST_DENIED_REGISTER, sizeof (UINT64));
+  SetEntry (&Entries[1], 0, EFI_MM_SAVE_STATE_REGISTER_RSI, sizeof (UINT64));
+
+  SetMem (Buffer, sizeof (Buffer), TEST_POISON);
+  UT_ASSERT_EQUAL (SmmSaveStateBatchRead (NULL, TestReadSaveState, &mPolicyCache, Entries, ARRAY_SIZE (Entries), Buffer), 1);
+
+  UT_ASSERT_STATUS_EQUAL (Entries[0].Status, EFI_ACCESS_DENIED);
+  UT_ASSERT_NOT_EFI_ERROR (Entries[1].Status);
+  UT_ASSERT_EQUAL (mSaveStateReads, 1);
+
+  for (Index = 0; Index < sizeof (UINT64); Index++) {
+    UT_ASSERT_EQUAL (Buffer[Index], TEST_POISON);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Unit test for SmmSaveStateBatchRead () staying correct when a batch has more distinct
+  register and width pairs than the policy cache can hold.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+BatchReadHandlesCacheOverflow (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SAVE_STATE_READ_ENTRY  Entries[2 * (SAVE_STATE_POLICY_CACHE_SIZE + 4)];
+  UINT64                     Buffer[ARRAY_SIZE (Entries)];
+  UINTN                      Index;
+
+  //
+  // Every pair appears twice, the second occurrence of a pair that did not fit in the
+  // cache is evaluated again.
+  //
+  for (Index = 0; Index < ARRAY_SIZE (Entries) / 2; Index++) {
+    SetEntry (&Entries[Index], 0, EFI_MM_SAVE_STATE_REGISTER_GDTBASE + Index, sizeof (UINT64));
+    SetEntry (&Entries[Index + ARRAY_SIZE (Entries) / 2], 1, EFI_MM_SAVE_STATE_REGISTER_GDTBASE + Index, sizeof (UINT64));
+  }
+
+  UT_ASSERT_EQUAL (
+    SmmSaveStateBatchRead (NULL, TestReadSaveState, &mPolicyCache, Entries, ARRAY_SIZE (Entries), (UINT8 *)Buffer),
+    ARRAY_SIZE (Entries)
+    );
+  UT_ASSERT_EQUAL (mPolicyEvaluations, ARRAY_SIZE (Entries) / 2 + 4);
+
+  for (Index = 0; Index < ARRAY_SIZE (Entries); Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (Entries[Index].Status);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Microbenchmark counting the ring transitions and policy evaluations taken by a SW SMI
+  dispatcher reading RAX, RBX, RCX, RDX and RSI of every CPU, through the two step syscall
+  pair and through batched syscalls.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+BatchReducesRingTransitions (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST EFI_MM_SAVE_STATE_REGISTER  Registers[] = {
+    EFI_MM_SAVE_STATE_REGISTER_RAX,
+    EFI_MM_SAVE_STATE_REGISTER_RBX,
+    EFI_MM_SAVE_STATE_REGISTER_RCX,
+    EFI_MM_SAVE_STATE_REGISTER_RDX,
+    EFI_MM_SAVE_STATE_REGISTER_RSI
+  };
+  SMM_SAVE_STATE_READ_ENTRY  Entries[ARRAY_SIZE (Registers) * TEST_NUMBER_OF_CPUS];
+  UINT64                     LegacyValues[ARRAY_SIZE (Entries)];
+  UINT64                     BatchValues[ARRAY_SIZE (Entries)];
+  UINTN                      CpuIndex;
+  UINTN                      RegIndex;
+  UINTN                      Index;
+  UINTN                      Chunk;
+  UINTN                      LegacyTransitions;
+  UINTN                      LegacyEvaluations;
+  UINTN                      ExpectedBatches;
+
+  //
+  // Two step syscall pair, one request at a time.
+  //
+  SetMem (LegacyValues, sizeof (LegacyValues), 0);
+  Index = 0;
+  for (CpuIndex = 0; CpuIndex < TEST_NUMBER_OF_CPUS; CpuIndex++) {
+    for (RegIndex = 0; RegIndex < ARRAY_SIZE (Registers); RegIndex++) {
+      if (!EFI_ERROR (TestSysCall (SMM_SC_SVST_READ, 1, Registers[RegIndex], CpuIndex))) {
+        TestSysCall (SMM_SC_SVST_READ_2, 1, sizeof (UINT64), (UINTN)&LegacyValues[Index]);
+      }
+
+      Index++;
+    }
+  }
+
+  LegacyTransitions = mRingTransitions;
+  LegacyEvaluations = mPolicyEvaluations;
+
+  //
+  // The same requests, batched.
+  //
+  mRingTransitions   = 0;
+  mPolicyEvaluations = 0;
+  Index              = 0;
+  for (CpuIndex = 0; CpuIndex < TEST_NUMBER_OF_CPUS; CpuIndex++) {
+    for (RegIndex = 0; RegIndex < ARRAY_SIZE (Registers); RegIndex++) {
+      SetEntry (&Entries[Index++], CpuIndex, Registers[RegIndex], sizeof (UINT64));
+    }
+  }
+
+  SetMem (BatchValues, sizeof (BatchValues), 0);
+  for (Index = 0; Index < ARRAY_SIZE (Entries); Index += Chunk) {
+    Chunk = MIN (ARRAY_SIZE (Entries) - Index, SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES);
+    UT_ASSERT_NOT_EFI_ERROR (TestSysCall (SMM_SC_SVST_READ_BATCH, (UINTN)&Entries[Index], Chunk, (UINTN)&BatchValues[Index]));
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "%a %d reads: two step pair took %d transitions and %d policy evaluations, batch took %d transitions and %d policy evaluations\n",
+    __func__,
+    ARRAY_SIZE (Entries),
+    LegacyTransitions,
+    LegacyEvaluations,
+    mRingTransitions,
+    mPolicyEvaluations
+    ));
+
+  //
+  // Both paths read the same values.
+  //
+  UT_ASSERT_MEM_EQUAL (LegacyValues, BatchValues, sizeof (BatchValues));
+
+  ExpectedBatches = (ARRAY_SIZE (Entries) + SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES - 1) / SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES;
+  UT_ASSERT_EQUAL (LegacyTransitions, 2 * ARRAY_SIZE (Entries));
+  UT_ASSERT_EQUAL (LegacyEvaluations, ARRAY_SIZE (Entries));
+  UT_ASSERT_EQUAL (mRingTransitions, ExpectedBatches);
+
+  //
+  // RAX is evaluated per CPU, the other registers at most once per batch.
+  //
+  UT_ASSERT_TRUE (mPolicyEvaluations <= TEST_NUMBER_OF_CPUS + (ARRAY_SIZE (Registers) - 1) * ExpectedBatches);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  save state batch and run the save state batch unit test.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      BatchTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the save state batch Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&BatchTests, Framework, "Save State Batch Tests", "MmSupervisorCore.SaveStateBatch", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BatchTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (BatchTests, "Batch validation should reject malformed batches", "Validate", BatchValidateRejectsMalformed, NULL, NULL, NULL);
+  AddTestCase (BatchTests, "Batch read should pack results in request order", "Pack", BatchReadPacksResults, ResetCounters, NULL, NULL);
+  AddTestCase (BatchTests, "Batch read should evaluate policy once per register and width", "PolicyOnce", BatchReadEvaluatesPolicyOncePerPair, ResetCounters, NULL, NULL);
+  AddTestCase (BatchTests, "Batch read should skip requests denied by policy", "Denied", BatchReadSkipsDeniedRequests, ResetCounters, NULL, NULL);
+  AddTestCase (BatchTests, "Batch read should survive a policy cache overflow", "CacheOverflow", BatchReadHandlesCacheOverflow, ResetCounters, NULL, NULL);
+  AddTestCase (BatchTests, "Batch should take fewer ring transitions than the two step pair", "Transitions", BatchReducesRingTransitions, ResetCounters, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
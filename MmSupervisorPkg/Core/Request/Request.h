@@ -34,6 +34,28 @@ ProcessUnblockPages (
   IN MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS  *UnblockMemParams
   );
 
+/**
+  Routine used to validate and unblock a batch of requested regions. Each region goes through
+  the same checks as ProcessUnblockPages, in order, so a region is checked against the ones
+  unblocked earlier in the batch. The unblocked regions are published to ring 3 once the whole
+  batch is processed.
+
+  @param[in, out]  UnblockBatch   Input batch conveyed from non-MM environment. The status of
+                                  each entry is returned in its Result field.
+  @param[in]       BufferSize     Size of the buffer holding UnblockBatch and its entries.
+
+  @retval EFI_SUCCESS             All requested regions properly unblocked.
+  @retval EFI_INVALID_PARAMETER   UnblockBatch is null pointer.
+  @retval EFI_BUFFER_TOO_SMALL    BufferSize cannot hold the number of entries of the batch.
+  @retval Others                  The status of the first entry that failed to be unblocked.
+
+**/
+EFI_STATUS
+ProcessUnblockPagesBatch (
+  IN OUT MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_BUFFER  *UnblockBatch,
+  IN     UINTN                                      BufferSize
+  );
+
 /**
   Function that combines current memory policy and firmware secure policy for requestor.
   Calling this function will also block the supervisor memory pages from being updated.
@@ -21,6 +21,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "MmSupervisorCore.h"
 #include "Mem/Mem.h"
 #include "Request.h"
+#include "Misc/SmmMpPerf.h"
 
 /**
   Software MMI handler that is called when a supervisor service is requested.
@@ -148,6 +149,46 @@ MmSupvRequestHandler (
                                       );
       break;
 
+    case MM_SUPERVISOR_REQUEST_MP_PERF:
+      ExpectedSize += sizeof (MM_SUPERVISOR_MP_PERF_BUFFER);
+      if (*CommBufferSize < ExpectedSize) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - MP perf query has bad comm buffer size! %d < %d\n",
+          __func__,
+          *CommBufferSize,
+          ExpectedSize
+          ));
+        return EFI_INVALID_PARAMETER;
+      }
+
+      // Events are returned in the rest of the communication buffer
+      MmSupvRequestHeader->Result = ProcessMpPerfRequest (
+                                      (MM_SUPERVISOR_MP_PERF_BUFFER *)(MmSupvRequestHeader + 1),
+                                      *CommBufferSize - sizeof (MM_SUPERVISOR_REQUEST_HEADER)
+                                      );
+      break;
+
+    case MM_SUPERVISOR_REQUEST_UNBLOCK_MEM_BATCH:
+      ExpectedSize += sizeof (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_BUFFER);
+      if (*CommBufferSize < ExpectedSize) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - Unblock batch has bad comm buffer size! %d < %d\n",
+          __func__,
+          *CommBufferSize,
+          ExpectedSize
+          ));
+        return EFI_INVALID_PARAMETER;
+      }
+
+      // Entries are conveyed in the rest of the communication buffer
+      MmSupvRequestHeader->Result = ProcessUnblockPagesBatch (
+                                      (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_BUFFER *)(MmSupvRequestHeader + 1),
+                                      *CommBufferSize - sizeof (MM_SUPERVISOR_REQUEST_HEADER)
+                                      );
+      break;
+
     default:
       // Mark unknown requested command as EFI_UNSUPPORTED.
       DEBUG ((DEBUG_ERROR, "%a - Invalid command requested! %d\n", __func__, MmSupvRequestHeader->Request));
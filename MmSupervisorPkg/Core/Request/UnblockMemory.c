@@ -18,6 +18,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "MmSupervisorCore.h"
 #include "Mem/Mem.h"
+#include "UnblockedView.h"
 
 typedef struct {
   LIST_ENTRY                             Link;
@@ -26,6 +27,11 @@ typedef struct {
 
 LIST_ENTRY  mUnblockedMemoryList = INITIALIZE_LIST_HEAD_VARIABLE (mUnblockedMemoryList);
 
+//
+// Read only view of the unblocked regions for ring 3, see PublishUnblockedView.
+//
+SMM_UNBLOCKED_VIEW  *mUnblockedView = NULL;
+
 /**
   Helper function to check if range requested is within boundary of unblocked lists.
   This routine is simple and do not merge adjacent regions from two entries into one.
@@ -135,6 +141,121 @@ CollectUnblockedRegionsFromNthNode (
   return EFI_SUCCESS;
 }
 
+/**
+  Publish the MMRAM ranges and the user unblocked regions to the read only view of ring 3.
+
+  The view lives in a user page allocated once the core initialization completes, and it is
+  only writable while the supervisor updates it. Should the page fail to be protected, the view
+  is withdrawn and ring 3 keeps using the SMM_MM_UNBLOCKED syscall.
+
+**/
+VOID
+PublishUnblockedView (
+  VOID
+  )
+{
+  UNBLOCKED_MEM_LIST    *UnblockedListEntry;
+  LIST_ENTRY            *Node;
+  SMM_UNBLOCKED_VIEW    *View;
+  EFI_PHYSICAL_ADDRESS  Address;
+  EFI_STATUS            Status;
+
+  if (!mCoreInitializationComplete) {
+    return;
+  }
+
+  if (mUnblockedView == NULL) {
+    Status = MmAllocatePages (AllocateAnyPages, EfiRuntimeServicesData, 1, &Address);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a - Failed to allocate the unblocked region view - %r!\n", __func__, Status));
+      return;
+    }
+
+    View = (SMM_UNBLOCKED_VIEW *)(UINTN)Address;
+    ZeroMem (View, EFI_PAGE_SIZE);
+  } else {
+    View    = mUnblockedView;
+    Address = (EFI_PHYSICAL_ADDRESS)(UINTN)View;
+    Status  = SmmClearMemoryAttributes (Address, EFI_PAGE_SIZE, EFI_MEMORY_RO);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a - Failed to ClearMemAttr to update the unblocked region view %r!\n", __func__, Status));
+      ASSERT_EFI_ERROR (Status);
+      return;
+    }
+  }
+
+  UnblockedViewBeginUpdate (
+    View,
+    mMmramRanges,
+    mMmramRangeCount,
+    (EFI_PHYSICAL_ADDRESS)(UINTN)mInternalCommBufferCopy[MM_USER_BUFFER_T],
+    EFI_PAGES_TO_SIZE (mMmSupervisorAccessBuffer[MM_USER_BUFFER_T].NumberOfPages)
+    );
+
+  // Supervisor owned regions fail the user ownership check of SMM_MM_UNBLOCKED anyway.
+  BASE_LIST_FOR_EACH (Node, &mUnblockedMemoryList) {
+    UnblockedListEntry = BASE_CR (Node, UNBLOCKED_MEM_LIST, Link);
+    if ((UnblockedListEntry->UnblockMemData.MemoryDescriptor.Attribute & EFI_MEMORY_SP) == 0) {
+      UnblockedViewAddRegion (
+        View,
+        UnblockedListEntry->UnblockMemData.MemoryDescriptor.PhysicalStart,
+        UnblockedListEntry->UnblockMemData.MemoryDescriptor.NumberOfPages
+        );
+    }
+  }
+
+  UnblockedViewEndUpdate (View);
+
+  Status = SmmSetMemoryAttributes (Address, EFI_PAGE_SIZE, EFI_MEMORY_RO);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to SetMemAttr to protect the unblocked region view %r!\n", __func__, Status));
+    ASSERT_EFI_ERROR (Status);
+    if (mUnblockedView == NULL) {
+      MmFreePages (Address, 1);
+    } else {
+      // Ring 3 may already hold the view, have it fall back to the syscall for good.
+      View->Generation = 0;
+    }
+
+    return;
+  }
+
+  mUnblockedView = View;
+}
+
+/**
+  Get the read only view of the unblocked regions published to ring 3.
+
+  @return The address of the view, 0 if none is published.
+
+**/
+EFI_PHYSICAL_ADDRESS
+GetUnblockedViewAddress (
+  VOID
+  )
+{
+  return (EFI_PHYSICAL_ADDRESS)(UINTN)mUnblockedView;
+}
+
+/**
+  Check if pages overlap the read only view of the unblocked regions published to ring 3.
+
+  @param[in]  Address        Start of the pages.
+  @param[in]  NumberOfPages  Number of pages.
+
+  @retval TRUE   The pages overlap the view, ring 3 must not free them.
+  @retval FALSE  The pages do not overlap the view.
+
+**/
+BOOLEAN
+IsUnblockedViewRange (
+  IN EFI_PHYSICAL_ADDRESS  Address,
+  IN UINT64                NumberOfPages
+  )
+{
+  return UnblockedViewOverlapsPages ((EFI_PHYSICAL_ADDRESS)(UINTN)mUnblockedView, Address, NumberOfPages);
+}
+
 /**
   Check if requested memory region is already unblocked.
 
@@ -320,20 +441,19 @@ ProcessBlockPages (
   RemoveEntryList (Node);
   FreePool (UnblockedListEntry);
 
+  PublishUnblockedView ();
+
   return EFI_SUCCESS;
 }
 
 /**
-  Routine used to validate and unblock requested region to be accessible in MM
-  environment. Given this routine could received untrusted data, the requested
-  memory region has to be already mapped as "not present" prior to this request.
-  For requests that pass security checks, the region will be marked as R/W data
-  page, while the page ownership (supervisor vs. user) is determined by whether
-  EFI_MEMORY_SP bit of memory descriptor's attribute is set or not.
+  Validate and unblock one requested region, without publishing the updated unblocked
+  regions to ring 3.
 
   @param[in]  UnblockMemParams  Input unblock parameters conveyed from non-MM environment
 
   @retval EFI_SUCCESS             The requested region properly unblocked.
+  @retval EFI_ALREADY_STARTED     The identical region was already unblocked.
   @retval EFI_ACCESS_DENIED       The request was made post lock down event.
   @retval EFI_INVALID_PARAMETER   UnblockMemParams or its ID GUID is null pointer.
   @retval EFI_SECURITY_VIOLATION  The requested region has illegal page attributes.
@@ -342,9 +462,10 @@ ProcessBlockPages (
   @retval Others                  Page attribute setting/clearing routine has failed.
 
 **/
+STATIC
 EFI_STATUS
-ProcessUnblockPages (
-  IN MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS  *UnblockMemParams
+UnblockPagesWorker (
+  IN CONST MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS  *UnblockMemParams
   )
 {
   EFI_STATUS          Status = EFI_SUCCESS;
@@ -398,7 +519,7 @@ ProcessUnblockPages (
   Status = VerifyUnblockRequest (UnblockMemParams);
   if (Status == EFI_ALREADY_STARTED) {
     DEBUG ((DEBUG_WARN, "%a - Exact match detected, will not double unblock!\n", __func__));
-    return EFI_SUCCESS;
+    return Status;
   } else if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "%a - Unblock request verification failed - %r!\n", __func__, Status));
     ASSERT_EFI_ERROR (Status);
@@ -445,5 +566,108 @@ ProcessUnblockPages (
   CopyMem (&UnblockListEntry->UnblockMemData, UnblockMemParams, sizeof (*UnblockMemParams));
   InsertTailList (&mUnblockedMemoryList, &UnblockListEntry->Link);
 
+  return Status;
+}
+
+/**
+  Routine used to validate and unblock requested region to be accessible in MM
+  environment. Given this routine could received untrusted data, the requested
+  memory region has to be already mapped as "not present" prior to this request.
+  For requests that pass security checks, the region will be marked as R/W data
+  page, while the page ownership (supervisor vs. user) is determined by whether
+  EFI_MEMORY_SP bit of memory descriptor's attribute is set or not.
+
+  @param[in]  UnblockMemParams  Input unblock parameters conveyed from non-MM environment
+
+  @retval EFI_SUCCESS             The requested region properly unblocked.
+  @retval EFI_ACCESS_DENIED       The request was made post lock down event.
+  @retval EFI_INVALID_PARAMETER   UnblockMemParams or its ID GUID is null pointer.
+  @retval EFI_SECURITY_VIOLATION  The requested region has illegal page attributes.
+  @retval EFI_OUT_OF_RESOURCES    The unblocked database failed to log new entry after
+                                  processing this request.
+  @retval Others                  Page attribute setting/clearing routine has failed.
+
+**/
+EFI_STATUS
+ProcessUnblockPages (
+  IN MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS  *UnblockMemParams
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = UnblockPagesWorker (UnblockMemParams);
+  if (Status == EFI_ALREADY_STARTED) {
+    return EFI_SUCCESS;
+  } else if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  PublishUnblockedView ();
+
   return Status;
 } // ProcessUnblockPages()
+
+/**
+  Routine used to validate and unblock a batch of requested regions. Each region goes through
+  the same checks as ProcessUnblockPages, in order, so a region is checked against the ones
+  unblocked earlier in the batch. The unblocked regions are published to ring 3 once the whole
+  batch is processed.
+
+  @param[in, out]  UnblockBatch   Input batch conveyed from non-MM environment. The status of
+                                  each entry is returned in its Result field.
+  @param[in]       BufferSize     Size of the buffer holding UnblockBatch and its entries.
+
+  @retval EFI_SUCCESS             All requested regions properly unblocked.
+  @retval EFI_INVALID_PARAMETER   UnblockBatch is null pointer.
+  @retval EFI_BUFFER_TOO_SMALL    BufferSize cannot hold the number of entries of the batch.
+  @retval Others                  The status of the first entry that failed to be unblocked.
+
+**/
+EFI_STATUS
+ProcessUnblockPagesBatch (
+  IN OUT MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_BUFFER  *UnblockBatch,
+  IN     UINTN                                      BufferSize
+  )
+{
+  MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY  *Entries;
+  MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS       UnblockMemParams;
+  EFI_STATUS                                Status;
+  EFI_STATUS                                EntryStatus;
+  BOOLEAN                                   Updated;
+  UINT64                                    Count;
+  UINT64                                    Index;
+
+  if ((UnblockBatch == NULL) || (BufferSize < sizeof (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_BUFFER))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Fetch the count once, the buffer is shared with the non-MM environment.
+  Count = UnblockBatch->Count;
+  if (Count > (BufferSize - sizeof (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_BUFFER)) / sizeof (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY)) {
+    DEBUG ((DEBUG_ERROR, "%a - %ld entries do not fit in buffer of 0x%x bytes!\n", __func__, Count, BufferSize));
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  Entries = (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY *)(UnblockBatch + 1);
+  Status  = EFI_SUCCESS;
+  Updated = FALSE;
+  for (Index = 0; Index < Count; Index++) {
+    CopyMem (&UnblockMemParams, &Entries[Index].Params, sizeof (UnblockMemParams));
+    EntryStatus = UnblockPagesWorker (&UnblockMemParams);
+    if (EntryStatus == EFI_ALREADY_STARTED) {
+      EntryStatus = EFI_SUCCESS;
+    } else if (!EFI_ERROR (EntryStatus)) {
+      Updated = TRUE;
+    } else if (!EFI_ERROR (Status)) {
+      Status = EntryStatus;
+    }
+
+    Entries[Index].Result = EntryStatus;
+  }
+
+  if (Updated) {
+    PublishUnblockedView ();
+  }
+
+  return Status;
+} // ProcessUnblockPagesBatch()
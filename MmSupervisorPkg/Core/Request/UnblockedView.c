@@ -0,0 +1,213 @@
+/** @file
+  Maintenance of the read only view of the MMRAM ranges and the user unblocked regions,
+  consumed by ring 3 to check buffers without a syscall.
+
+  The view is guarded by its generation, which is odd during an update. Readers sample the
+  generation before and after they look a buffer up, and fall back to the syscall when the two
+  samples differ or are odd.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+
+#include "UnblockedView.h"
+
+/**
+  Compare two ranges of the view by start address.
+
+  @param[in]  Buffer1   The first SMM_UNBLOCKED_VIEW_RANGE.
+  @param[in]  Buffer2   The second SMM_UNBLOCKED_VIEW_RANGE.
+
+  @retval  1    Buffer1 starts above Buffer2.
+  @retval  0    Buffer1 and Buffer2 start at the same address.
+  @retval -1    Buffer1 starts below Buffer2.
+**/
+STATIC
+INTN
+EFIAPI
+UnblockedViewRangeCompare (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  CONST SMM_UNBLOCKED_VIEW_RANGE  *Range1;
+  CONST SMM_UNBLOCKED_VIEW_RANGE  *Range2;
+
+  Range1 = (CONST SMM_UNBLOCKED_VIEW_RANGE *)Buffer1;
+  Range2 = (CONST SMM_UNBLOCKED_VIEW_RANGE *)Buffer2;
+  if (Range1->Start > Range2->Start) {
+    return 1;
+  } else if (Range1->Start < Range2->Start) {
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+  Start an update of the view, and describe the MMRAM ranges and the communication buffer.
+
+  Readers fall back to the syscall until UnblockedViewEndUpdate is called. The unblocked
+  regions of the view are dropped and have to be added again.
+
+  @param[in, out]  View               The view to update.
+  @param[in]       MmramRanges        The MMRAM ranges, in any order.
+  @param[in]       MmramCount         The number of MMRAM ranges.
+  @param[in]       CommBufferStart    Start of the user communication buffer.
+  @param[in]       CommBufferSize     Size, in bytes, of the user communication buffer.
+**/
+VOID
+UnblockedViewBeginUpdate (
+  IN OUT SMM_UNBLOCKED_VIEW          *View,
+  IN     CONST EFI_MMRAM_DESCRIPTOR  *MmramRanges,
+  IN     UINTN                       MmramCount,
+  IN     EFI_PHYSICAL_ADDRESS        CommBufferStart,
+  IN     UINT64                      CommBufferSize
+  )
+{
+  SMM_UNBLOCKED_VIEW_RANGE  SortBuffer;
+  SMM_UNBLOCKED_VIEW_RANGE  *Range;
+  UINTN                     Index;
+  UINTN                     Count;
+
+  View->Generation++;
+  MemoryFence ();
+
+  View->Flags           = 0;
+  View->UnblockedCount  = 0;
+  View->CommBufferStart = CommBufferStart;
+  View->CommBufferEnd   = CommBufferStart + CommBufferSize;
+
+  if (MmramCount > SMM_UNBLOCKED_VIEW_MAX_RANGES) {
+    MmramCount   = SMM_UNBLOCKED_VIEW_MAX_RANGES;
+    View->Flags |= SMM_UNBLOCKED_VIEW_INCOMPLETE;
+  }
+
+  //
+  // An empty MMRAM range still rejects buffers containing its start, so it spans one byte.
+  //
+  Range = View->Range;
+  for (Index = 0; Index < MmramCount; Index++) {
+    Range[Index].Start = MmramRanges[Index].CpuStart;
+    Range[Index].End   = MmramRanges[Index].CpuStart + MAX (MmramRanges[Index].PhysicalSize, 1);
+    if (Range[Index].End < Range[Index].Start) {
+      Range[Index].End = MAX_UINT64;
+    }
+  }
+
+  if (MmramCount > 1) {
+    QuickSort (Range, MmramCount, sizeof (SMM_UNBLOCKED_VIEW_RANGE), UnblockedViewRangeCompare, &SortBuffer);
+  }
+
+  //
+  // A buffer overlaps MMRAM exactly when it overlaps the union of the ranges.
+  //
+  Count = 0;
+  for (Index = 0; Index < MmramCount; Index++) {
+    if ((Count != 0) && (Range[Index].Start <= Range[Count - 1].End)) {
+      Range[Count - 1].End = MAX (Range[Count - 1].End, Range[Index].End);
+    } else {
+      Range[Count++] = Range[Index];
+    }
+  }
+
+  View->MmramCount = (UINT32)Count;
+}
+
+/**
+  Add a user unblocked region to the view being updated.
+
+  @param[in, out]  View             The view being updated.
+  @param[in]       PhysicalStart    Start of the region.
+  @param[in]       NumberOfPages    Size of the region in pages.
+**/
+VOID
+UnblockedViewAddRegion (
+  IN OUT SMM_UNBLOCKED_VIEW    *View,
+  IN     EFI_PHYSICAL_ADDRESS  PhysicalStart,
+  IN     UINT64                NumberOfPages
+  )
+{
+  SMM_UNBLOCKED_VIEW_RANGE  *Range;
+
+  if (View->MmramCount + View->UnblockedCount >= SMM_UNBLOCKED_VIEW_MAX_RANGES) {
+    View->Flags |= SMM_UNBLOCKED_VIEW_INCOMPLETE;
+    return;
+  }
+
+  Range        = &View->Range[View->MmramCount + View->UnblockedCount];
+  Range->Start = PhysicalStart;
+  Range->End   = PhysicalStart + EFI_PAGES_TO_SIZE (NumberOfPages);
+  View->UnblockedCount++;
+}
+
+/**
+  Complete the update of the view, and publish it to the readers.
+
+  @param[in, out]  View     The view being updated.
+**/
+VOID
+UnblockedViewEndUpdate (
+  IN OUT SMM_UNBLOCKED_VIEW  *View
+  )
+{
+  SMM_UNBLOCKED_VIEW_RANGE  SortBuffer;
+  SMM_UNBLOCKED_VIEW_RANGE  *Range;
+  UINTN                     Index;
+
+  Range = &View->Range[View->MmramCount];
+  if (View->UnblockedCount > 1) {
+    QuickSort (Range, View->UnblockedCount, sizeof (SMM_UNBLOCKED_VIEW_RANGE), UnblockedViewRangeCompare, &SortBuffer);
+  }
+
+  //
+  // A buffer is only valid when a single region holds it. Overlapping regions would defeat
+  // the lookup of that region, so leave such a view to the syscall.
+  //
+  for (Index = 1; Index < View->UnblockedCount; Index++) {
+    if (Range[Index].Start < Range[Index - 1].End) {
+      View->Flags |= SMM_UNBLOCKED_VIEW_INCOMPLETE;
+      break;
+    }
+  }
+
+  MemoryFence ();
+  View->Generation++;
+}
+
+/**
+  Check if pages overlap the page of the view.
+
+  Ring 3 can see the view, so its pages pass the user ownership check of SMM_FREE_PAGE. Freeing
+  them would hand the view back to the user pool, writable, while the supervisor still updates it.
+
+  @param[in]  ViewAddress    Address of the view, 0 if none is published.
+  @param[in]  Address        Start of the pages.
+  @param[in]  NumberOfPages  Number of pages.
+
+  @retval TRUE   The pages overlap the view.
+  @retval FALSE  The pages do not overlap the view, or no view is published.
+**/
+BOOLEAN
+UnblockedViewOverlapsPages (
+  IN EFI_PHYSICAL_ADDRESS  ViewAddress,
+  IN EFI_PHYSICAL_ADDRESS  Address,
+  IN UINT64                NumberOfPages
+  )
+{
+  if ((ViewAddress == 0) || (NumberOfPages == 0)) {
+    return FALSE;
+  }
+
+  if (Address > ViewAddress) {
+    return (Address - ViewAddress) < EFI_PAGE_SIZE;
+  }
+
+  // Compared in pages, so that a huge NumberOfPages cannot overflow.
+  return RShiftU64 (ViewAddress - Address, EFI_PAGE_SHIFT) < NumberOfPages;
+}
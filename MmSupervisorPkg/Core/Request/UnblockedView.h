@@ -0,0 +1,77 @@
+/** @file
+  Maintenance of the read only view of the MMRAM ranges and the user unblocked regions,
+  consumed by ring 3 to check buffers without a syscall.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef UNBLOCKED_VIEW_H_
+#define UNBLOCKED_VIEW_H_
+
+#include <Library/SysCallLib.h>
+
+/**
+  Start an update of the view, and describe the MMRAM ranges and the communication buffer.
+
+  Readers fall back to the syscall until UnblockedViewEndUpdate is called. The unblocked
+  regions of the view are dropped and have to be added again.
+
+  @param[in, out]  View               The view to update.
+  @param[in]       MmramRanges        The MMRAM ranges, in any order.
+  @param[in]       MmramCount         The number of MMRAM ranges.
+  @param[in]       CommBufferStart    Start of the user communication buffer.
+  @param[in]       CommBufferSize     Size, in bytes, of the user communication buffer.
+**/
+VOID
+UnblockedViewBeginUpdate (
+  IN OUT SMM_UNBLOCKED_VIEW          *View,
+  IN     CONST EFI_MMRAM_DESCRIPTOR  *MmramRanges,
+  IN     UINTN                       MmramCount,
+  IN     EFI_PHYSICAL_ADDRESS        CommBufferStart,
+  IN     UINT64                      CommBufferSize
+  );
+
+/**
+  Add a user unblocked region to the view being updated.
+
+  @param[in, out]  View             The view being updated.
+  @param[in]       PhysicalStart    Start of the region.
+  @param[in]       NumberOfPages    Size of the region in pages.
+**/
+VOID
+UnblockedViewAddRegion (
+  IN OUT SMM_UNBLOCKED_VIEW    *View,
+  IN     EFI_PHYSICAL_ADDRESS  PhysicalStart,
+  IN     UINT64                NumberOfPages
+  );
+
+/**
+  Complete the update of the view, and publish it to the readers.
+
+  @param[in, out]  View     The view being updated.
+**/
+VOID
+UnblockedViewEndUpdate (
+  IN OUT SMM_UNBLOCKED_VIEW  *View
+  );
+
+/**
+  Check if pages overlap the page of the view.
+
+  @param[in]  ViewAddress    Address of the view, 0 if none is published.
+  @param[in]  Address        Start of the pages.
+  @param[in]  NumberOfPages  Number of pages.
+
+  @retval TRUE   The pages overlap the view.
+  @retval FALSE  The pages do not overlap the view, or no view is published.
+**/
+BOOLEAN
+UnblockedViewOverlapsPages (
+  IN EFI_PHYSICAL_ADDRESS  ViewAddress,
+  IN EFI_PHYSICAL_ADDRESS  Address,
+  IN UINT64                NumberOfPages
+  );
+
+#endif
@@ -0,0 +1,702 @@
+/** @file
+  Unit tests of the read only unblocked region view published to ring 3.
+
+  The view is built the way the supervisor publishes it and queried the way ring 3 does, on
+  random MMRAM ranges, unblocked regions and buffers. Every verdict the view settles must match
+  the one of the SMM_MM_UNBLOCKED and SMM_MM_IS_COMM_BUFF syscalls, modelled after the checks
+  the supervisor runs.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <PiMm.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+#include <UnitTest/UnitTestRandom.h>
+
+#include "../UnblockedView.h"
+#include "../../../Library/MmSupervisorMemLib/MmSupervisorUnblockedView.h"
+
+#define UNIT_TEST_APP_NAME     "MM Supervisor Unblocked Region View Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Simulated address space: every range lives in a window of TEST_WINDOW_PAGES pages.
+//
+#define TEST_MAXIMUM_SUPPORT_ADDRESS  0xFFFFFFFFFFFFull
+#define TEST_WINDOW_BASE              0x80000000ull
+#define TEST_WINDOW_PAGES             256
+
+#define TEST_MAX_MMRAM      4
+#define TEST_MAX_UNBLOCKED  48
+
+//
+// Number of random layouts, and number of random buffers checked against each layout.
+//
+#define TEST_ROUNDS   500
+#define TEST_BUFFERS  400
+
+typedef struct {
+  EFI_PHYSICAL_ADDRESS    PhysicalStart;
+  UINT64                  NumberOfPages;
+  BOOLEAN                 Supervisor;
+} TEST_UNBLOCKED_REGION;
+
+//
+// Current simulated layout.
+//
+EFI_MMRAM_DESCRIPTOR   mMmram[TEST_MAX_MMRAM];
+UINTN                  mMmramCount;
+TEST_UNBLOCKED_REGION  mUnblocked[TEST_MAX_UNBLOCKED];
+UINTN                  mUnblockedCount;
+EFI_PHYSICAL_ADDRESS   mCommBufferStart;
+UINT64                 mCommBufferSize;
+
+SMM_UNBLOCKED_VIEW  *mView;
+
+/**
+  Model of the SMM_MM_UNBLOCKED syscall: MmIsBufferOutsideMmValid of the supervisor, followed
+  by the user ownership check of the head of the buffer.
+
+  Pages of user unblocked regions are user pages, pages of supervisor unblocked regions are
+  supervisor pages, and any other page is not mapped.
+
+  @param[in] Buffer  The buffer start address to be checked.
+  @param[in] Length  The buffer length to be checked.
+
+  @return The verdict of the syscall.
+
+**/
+BOOLEAN
+ReferenceBufferValid (
+  IN EFI_PHYSICAL_ADDRESS  Buffer,
+  IN UINT64                Length
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Start;
+  EFI_PHYSICAL_ADDRESS  End;
+  EFI_PHYSICAL_ADDRESS  Page;
+  UINTN                 Index;
+  BOOLEAN               Found;
+
+  if ((Length > TEST_MAXIMUM_SUPPORT_ADDRESS) ||
+      (Buffer > TEST_MAXIMUM_SUPPORT_ADDRESS) ||
+      ((Length != 0) && (Buffer > (TEST_MAXIMUM_SUPPORT_ADDRESS - (Length - 1)))))
+  {
+    return FALSE;
+  }
+
+  for (Index = 0; Index < mMmramCount; Index++) {
+    if (((Buffer >= mMmram[Index].CpuStart) &&
+         (Buffer < mMmram[Index].CpuStart + mMmram[Index].PhysicalSize)) ||
+        ((mMmram[Index].CpuStart >= Buffer) &&
+         (mMmram[Index].CpuStart < Buffer + Length)))
+    {
+      return FALSE;
+    }
+  }
+
+  if (Length == 0) {
+    return FALSE;
+  }
+
+  Found = FALSE;
+  for (Index = 0; Index < mUnblockedCount; Index++) {
+    Start = mUnblocked[Index].PhysicalStart;
+    End   = Start + EFI_PAGES_TO_SIZE (mUnblocked[Index].NumberOfPages);
+    if ((Start <= Buffer) && (Buffer + Length <= End)) {
+      Found = TRUE;
+      break;
+    }
+  }
+
+  if (!Found || (Buffer < EFI_PAGE_SIZE)) {
+    return FALSE;
+  }
+
+  for (Page = Buffer & ~(UINT64)EFI_PAGE_MASK; Page < Buffer + sizeof (EFI_GUID); Page += EFI_PAGE_SIZE) {
+    Found = FALSE;
+    for (Index = 0; Index < mUnblockedCount; Index++) {
+      Start = mUnblocked[Index].PhysicalStart;
+      End   = Start + EFI_PAGES_TO_SIZE (mUnblocked[Index].NumberOfPages);
+      if ((Start <= Page) && (Page < End) && !mUnblocked[Index].Supervisor) {
+        Found = TRUE;
+        break;
+      }
+    }
+
+    if (!Found) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Model of the SMM_MM_IS_COMM_BUFF syscall.
+
+  @param[in] Buffer  The buffer start address to be checked.
+  @param[in] Length  The buffer length to be checked.
+
+  @return The verdict of the syscall.
+
+**/
+BOOLEAN
+ReferenceCommBufferValid (
+  IN EFI_PHYSICAL_ADDRESS  Buffer,
+  IN UINT64                Length
+  )
+{
+  if (Buffer + Length < Buffer) {
+    return FALSE;
+  }
+
+  return (Buffer >= mCommBufferStart) && (Buffer + Length <= mCommBufferStart + mCommBufferSize);
+}
+
+/**
+  Publish the current layout to the view, the way the supervisor does.
+**/
+VOID
+PublishLayout (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  UnblockedViewBeginUpdate (mView, mMmram, mMmramCount, mCommBufferStart, mCommBufferSize);
+  for (Index = 0; Index < mUnblockedCount; Index++) {
+    if (!mUnblocked[Index].Supervisor) {
+      UnblockedViewAddRegion (mView, mUnblocked[Index].PhysicalStart, mUnblocked[Index].NumberOfPages);
+    }
+  }
+
+  UnblockedViewEndUpdate (mView);
+}
+
+/**
+  Generate a random layout of MMRAM ranges, unblocked regions and communication buffer.
+
+  Unblocked regions never overlap but may be adjacent, and are listed in random order. MMRAM
+  ranges may be empty, overlap each other or overlap unblocked regions.
+**/
+VOID
+GenerateLayout (
+  VOID
+  )
+{
+  TEST_UNBLOCKED_REGION  Swap;
+  UINTN                  Page;
+  UINTN                  Index;
+  UINTN                  Other;
+
+  mMmramCount = 1 + RandomBelow (TEST_MAX_MMRAM);
+  for (Index = 0; Index < mMmramCount; Index++) {
+    mMmram[Index].CpuStart      = TEST_WINDOW_BASE + EFI_PAGES_TO_SIZE (RandomBelow (TEST_WINDOW_PAGES));
+    mMmram[Index].PhysicalStart = mMmram[Index].CpuStart;
+    mMmram[Index].PhysicalSize  = EFI_PAGES_TO_SIZE (RandomBelow (4));
+  }
+
+  mUnblockedCount = 0;
+  Page            = RandomBelow (4);
+  while ((mUnblockedCount < TEST_MAX_UNBLOCKED) && (Page < TEST_WINDOW_PAGES)) {
+    mUnblocked[mUnblockedCount].PhysicalStart = TEST_WINDOW_BASE + EFI_PAGES_TO_SIZE (Page);
+    mUnblocked[mUnblockedCount].NumberOfPages = 1 + RandomBelow (4);
+    mUnblocked[mUnblockedCount].Supervisor    = (RandomBelow (4) == 0);
+    Page                                     += (UINTN)mUnblocked[mUnblockedCount].NumberOfPages + RandomBelow (4);
+    mUnblockedCount++;
+  }
+
+  for (Index = mUnblockedCount; Index > 1; Index--) {
+    Other                 = RandomBelow (Index);
+    Swap                  = mUnblocked[Index - 1];
+    mUnblocked[Index - 1] = mUnblocked[Other];
+    mUnblocked[Other]     = Swap;
+  }
+
+  mCommBufferStart = TEST_WINDOW_BASE + EFI_PAGES_TO_SIZE (RandomBelow (TEST_WINDOW_PAGES));
+  mCommBufferSize  = EFI_PAGES_TO_SIZE (RandomBelow (4));
+}
+
+/**
+  Pick a random address close to one of the edges of the current layout.
+
+  @return A pseudo random address.
+**/
+EFI_PHYSICAL_ADDRESS
+RandomAddress (
+  VOID
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Anchor;
+  UINTN                 Index;
+
+  switch (RandomBelow (6)) {
+    case 0:
+      Index  = RandomBelow (mMmramCount);
+      Anchor = mMmram[Index].CpuStart + RandomBelow (2) * mMmram[Index].PhysicalSize;
+      break;
+    case 1:
+      Anchor = mCommBufferStart + RandomBelow (2) * mCommBufferSize;
+      break;
+    case 2:
+      Anchor = TEST_WINDOW_BASE + RandomBelow (EFI_PAGES_TO_SIZE (TEST_WINDOW_PAGES));
+      break;
+    case 3:
+      return RandomBelow (2) * (TEST_MAXIMUM_SUPPORT_ADDRESS - RandomBelow (EFI_PAGE_SIZE)) + RandomBelow (2 * EFI_PAGE_SIZE);
+    default:
+      Index  = RandomBelow (mUnblockedCount);
+      Anchor = mUnblocked[Index].PhysicalStart + RandomBelow (2) * EFI_PAGES_TO_SIZE (mUnblocked[Index].NumberOfPages);
+      break;
+  }
+
+  return Anchor + RandomBelow (128) - 64;
+}
+
+/**
+  Pick a random buffer length.
+
+  @return A pseudo random length.
+**/
+UINT64
+RandomLength (
+  VOID
+  )
+{
+  switch (RandomBelow (6)) {
+    case 0:
+      return 0;
+    case 1:
+      return 1 + RandomBelow (sizeof (EFI_GUID) * 2);
+    case 2:
+      return EFI_PAGES_TO_SIZE (1 + RandomBelow (3));
+    case 3:
+      return TEST_MAXIMUM_SUPPORT_ADDRESS - RandomBelow (EFI_PAGE_SIZE);
+    default:
+      return 1 + RandomBelow (EFI_PAGES_TO_SIZE (3));
+  }
+}
+
+/*
+  Helper function to allocate the view page.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+AllocateView (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mView = AllocateZeroPool (SIZE_4KB);
+  UT_ASSERT_NOT_NULL (mView);
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Helper function to free the view page.
+*/
+VOID
+EFIAPI
+FreeView (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mView != NULL) {
+    FreePool (mView);
+    mView = NULL;
+  }
+}
+
+/**
+  Random buffers should get the verdict of SMM_MM_UNBLOCKED, without the syscall for most of them.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RandomBuffersMatchSyscall (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Buffer;
+  UINT64                Length;
+  UINTN                 Round;
+  UINTN                 Index;
+  UINTN                 Accepted;
+  UINTN                 Fallbacks;
+  BOOLEAN               Valid;
+  BOOLEAN               Expected;
+
+  mRandomState = 0x5EED0042;
+  Accepted     = 0;
+  Fallbacks    = 0;
+
+  for (Round = 0; Round < TEST_ROUNDS; Round++) {
+    GenerateLayout ();
+    PublishLayout ();
+
+    for (Index = 0; Index < TEST_BUFFERS; Index++) {
+      Buffer   = RandomAddress ();
+      Length   = RandomLength ();
+      Expected = ReferenceBufferValid (Buffer, Length);
+      if (!UnblockedViewCheckBuffer (mView, TEST_MAXIMUM_SUPPORT_ADDRESS, Buffer, Length, &Valid)) {
+        Fallbacks++;
+        continue;
+      }
+
+      if (Valid != Expected) {
+        UT_LOG_ERROR ("Round %d: buffer 0x%lx length 0x%lx, view %d, syscall %d\n", Round, Buffer, Length, Valid, Expected);
+      }
+
+      UT_ASSERT_EQUAL (Valid, Expected);
+      Accepted += Valid ? 1 : 0;
+    }
+  }
+
+  //
+  // Both verdicts are well represented, and the syscall is only needed for buffers with a head
+  // running past the end of their region.
+  //
+  UT_ASSERT_TRUE (Accepted > TEST_ROUNDS * TEST_BUFFERS / 20);
+  UT_ASSERT_TRUE (Fallbacks < TEST_ROUNDS * TEST_BUFFERS / 20);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Random buffers should get the verdict of SMM_MM_IS_COMM_BUFF.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RandomCommBuffersMatchSyscall (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Buffer;
+  UINT64                Length;
+  UINTN                 Round;
+  UINTN                 Index;
+  BOOLEAN               Valid;
+
+  mRandomState = 0x5EED0043;
+
+  for (Round = 0; Round < TEST_ROUNDS; Round++) {
+    GenerateLayout ();
+    PublishLayout ();
+
+    for (Index = 0; Index < TEST_BUFFERS; Index++) {
+      Buffer = RandomAddress ();
+      Length = (RandomBelow (8) == 0) ? MAX_UINT64 - RandomBelow (EFI_PAGE_SIZE) : RandomLength ();
+      UT_ASSERT_TRUE (UnblockedViewCheckCommBuffer (mView, Buffer, Length, &Valid));
+      UT_ASSERT_EQUAL (Valid, ReferenceCommBufferValid (Buffer, Length));
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks should be left to the syscall before the view is published and while it is updated.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ViewDefersWhileUpdating (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Buffer;
+  BOOLEAN               Valid;
+
+  mMmramCount                 = 1;
+  mMmram[0].CpuStart          = TEST_WINDOW_BASE;
+  mMmram[0].PhysicalSize      = EFI_PAGE_SIZE;
+  mUnblockedCount             = 1;
+  mUnblocked[0].PhysicalStart = TEST_WINDOW_BASE + SIZE_64KB;
+  mUnblocked[0].NumberOfPages = 2;
+  mUnblocked[0].Supervisor    = FALSE;
+  mCommBufferStart            = TEST_WINDOW_BASE + SIZE_1MB;
+  mCommBufferSize             = EFI_PAGE_SIZE;
+  Buffer                      = mUnblocked[0].PhysicalStart + 0x10;
+
+  UT_ASSERT_FALSE (UnblockedViewCheckBuffer (mView, TEST_MAXIMUM_SUPPORT_ADDRESS, Buffer, 0x10, &Valid));
+  UT_ASSERT_FALSE (UnblockedViewCheckCommBuffer (mView, mCommBufferStart, 0x10, &Valid));
+
+  //
+  // Buffers beyond the supported addresses never need the view.
+  //
+  UT_ASSERT_TRUE (UnblockedViewCheckBuffer (mView, TEST_MAXIMUM_SUPPORT_ADDRESS, TEST_MAXIMUM_SUPPORT_ADDRESS, 2, &Valid));
+  UT_ASSERT_FALSE (Valid);
+
+  PublishLayout ();
+  UT_ASSERT_EQUAL (mView->Generation, 2);
+  UT_ASSERT_TRUE (UnblockedViewCheckBuffer (mView, TEST_MAXIMUM_SUPPORT_ADDRESS, Buffer, 0x10, &Valid));
+  UT_ASSERT_TRUE (Valid);
+  UT_ASSERT_TRUE (UnblockedViewCheckCommBuffer (mView, mCommBufferStart, 0x10, &Valid));
+  UT_ASSERT_TRUE (Valid);
+
+  UnblockedViewBeginUpdate (mView, mMmram, mMmramCount, mCommBufferStart, mCommBufferSize);
+  UT_ASSERT_FALSE (UnblockedViewCheckBuffer (mView, TEST_MAXIMUM_SUPPORT_ADDRESS, Buffer, 0x10, &Valid));
+  UT_ASSERT_FALSE (UnblockedViewCheckCommBuffer (mView, mCommBufferStart, 0x10, &Valid));
+
+  //
+  // The region is gone once the update completes.
+  //
+  UnblockedViewEndUpdate (mView);
+  UT_ASSERT_EQUAL (mView->Generation, 4);
+  UT_ASSERT_TRUE (UnblockedViewCheckBuffer (mView, TEST_MAXIMUM_SUPPORT_ADDRESS, Buffer, 0x10, &Valid));
+  UT_ASSERT_FALSE (Valid);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks should be left to the syscall when the view cannot describe all regions.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ViewDefersWhenIncomplete (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_MMRAM_DESCRIPTOR  Mmram;
+  UINTN                 Index;
+  BOOLEAN               Valid;
+
+  Mmram.CpuStart      = TEST_WINDOW_BASE;
+  Mmram.PhysicalStart = TEST_WINDOW_BASE;
+  Mmram.PhysicalSize  = EFI_PAGE_SIZE;
+
+  //
+  // Overlapping regions.
+  //
+  UnblockedViewBeginUpdate (mView, &Mmram, 1, 0, 0);
+  UnblockedViewAddRegion (mView, TEST_WINDOW_BASE + SIZE_64KB, 4);
+  UnblockedViewAddRegion (mView, TEST_WINDOW_BASE + SIZE_64KB + EFI_PAGE_SIZE, 1);
+  UnblockedViewEndUpdate (mView);
+  UT_ASSERT_TRUE ((mView->Flags & SMM_UNBLOCKED_VIEW_INCOMPLETE) != 0);
+  UT_ASSERT_FALSE (UnblockedViewCheckBuffer (mView, TEST_MAXIMUM_SUPPORT_ADDRESS, TEST_WINDOW_BASE + SIZE_64KB, 0x10, &Valid));
+
+  //
+  // More regions than the page holds.
+  //
+  UnblockedViewBeginUpdate (mView, &Mmram, 1, 0, 0);
+  for (Index = 0; Index < SMM_UNBLOCKED_VIEW_MAX_RANGES; Index++) {
+    UnblockedViewAddRegion (mView, TEST_WINDOW_BASE + SIZE_64KB + EFI_PAGES_TO_SIZE (Index * 2), 1);
+  }
+
+  UnblockedViewEndUpdate (mView);
+  UT_ASSERT_EQUAL (mView->MmramCount + mView->UnblockedCount, SMM_UNBLOCKED_VIEW_MAX_RANGES);
+  UT_ASSERT_TRUE ((mView->Flags & SMM_UNBLOCKED_VIEW_INCOMPLETE) != 0);
+  UT_ASSERT_FALSE (UnblockedViewCheckBuffer (mView, TEST_MAXIMUM_SUPPORT_ADDRESS, TEST_WINDOW_BASE + SIZE_64KB, 0x10, &Valid));
+
+  //
+  // Exactly as many regions as the page holds.
+  //
+  UnblockedViewBeginUpdate (mView, &Mmram, 1, 0, 0);
+  for (Index = 0; Index < SMM_UNBLOCKED_VIEW_MAX_RANGES - 1; Index++) {
+    UnblockedViewAddRegion (mView, TEST_WINDOW_BASE + SIZE_64KB + EFI_PAGES_TO_SIZE (Index * 2), 1);
+  }
+
+  UnblockedViewEndUpdate (mView);
+  UT_ASSERT_EQUAL (mView->Flags, 0);
+  UT_ASSERT_TRUE (UnblockedViewCheckBuffer (mView, TEST_MAXIMUM_SUPPORT_ADDRESS, TEST_WINDOW_BASE + SIZE_64KB, 0x10, &Valid));
+  UT_ASSERT_TRUE (Valid);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  MMRAM ranges should be sorted and coalesced, empty ones spanning a single byte.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MmramRangesCoalesced (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_MMRAM_DESCRIPTOR  Mmram[5];
+
+  ZeroMem (Mmram, sizeof (Mmram));
+  Mmram[0].CpuStart     = 0x9000;
+  Mmram[0].PhysicalSize = 0x1000;
+  Mmram[1].CpuStart     = 0x1000;
+  Mmram[1].PhysicalSize = 0x2000;
+  Mmram[2].CpuStart     = 0x3000;
+  Mmram[2].PhysicalSize = 0x1000;
+  Mmram[3].CpuStart     = 0x2000;
+  Mmram[3].PhysicalSize = 0x800;
+  Mmram[4].CpuStart     = 0x7000;
+  Mmram[4].PhysicalSize = 0;
+
+  UnblockedViewBeginUpdate (mView, Mmram, ARRAY_SIZE (Mmram), 0, 0);
+  UnblockedViewEndUpdate (mView);
+
+  UT_ASSERT_EQUAL (mView->MmramCount, 3);
+  UT_ASSERT_EQUAL (mView->Range[0].Start, 0x1000);
+  UT_ASSERT_EQUAL (mView->Range[0].End, 0x4000);
+  UT_ASSERT_EQUAL (mView->Range[1].Start, 0x7000);
+  UT_ASSERT_EQUAL (mView->Range[1].End, 0x7001);
+  UT_ASSERT_EQUAL (mView->Range[2].Start, 0x9000);
+  UT_ASSERT_EQUAL (mView->Range[2].End, 0xA000);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Ring 3 should not be able to free the page of the view through SMM_FREE_PAGE.
+
+  The view page is user readable, so it passes the user ownership check of the syscall. Freeing it
+  would hand it back to ring 3 as a writable allocation.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ViewPageCannotBeFreed (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_PHYSICAL_ADDRESS  ViewAddress;
+
+  ViewAddress = TEST_WINDOW_BASE + EFI_PAGES_TO_SIZE (16);
+
+  // The view page itself, or any range covering part of it
+  UT_ASSERT_TRUE (UnblockedViewOverlapsPages (ViewAddress, ViewAddress, 1));
+  UT_ASSERT_TRUE (UnblockedViewOverlapsPages (ViewAddress, ViewAddress - EFI_PAGES_TO_SIZE (2), 3));
+  UT_ASSERT_TRUE (UnblockedViewOverlapsPages (ViewAddress, ViewAddress - EFI_PAGES_TO_SIZE (2), 8));
+  UT_ASSERT_TRUE (UnblockedViewOverlapsPages (ViewAddress, ViewAddress + SIZE_2KB, 1));
+  UT_ASSERT_TRUE (UnblockedViewOverlapsPages (ViewAddress, ViewAddress - SIZE_2KB, 1));
+  UT_ASSERT_TRUE (UnblockedViewOverlapsPages (ViewAddress, EFI_PAGE_SIZE, EFI_SIZE_TO_PAGES ((UINTN)-1)));
+
+  // Neighbouring pages stay free-able
+  UT_ASSERT_FALSE (UnblockedViewOverlapsPages (ViewAddress, ViewAddress - EFI_PAGES_TO_SIZE (2), 2));
+  UT_ASSERT_FALSE (UnblockedViewOverlapsPages (ViewAddress, ViewAddress + EFI_PAGE_SIZE, 1));
+  UT_ASSERT_FALSE (UnblockedViewOverlapsPages (ViewAddress, ViewAddress + EFI_PAGE_SIZE, EFI_SIZE_TO_PAGES ((UINTN)-1)));
+  UT_ASSERT_FALSE (UnblockedViewOverlapsPages (ViewAddress, ViewAddress, 0));
+
+  // Nothing to protect before the view is published
+  UT_ASSERT_FALSE (UnblockedViewOverlapsPages (0, ViewAddress, 1));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  unblocked region view and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      ViewTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the unblocked region view Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&ViewTests, Framework, "Unblocked Region View Tests", "MmSupervisorCore.UnblockedView", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for ViewTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (ViewTests, "View should match SMM_MM_UNBLOCKED on random buffers", "RandomBuffers", RandomBuffersMatchSyscall, AllocateView, FreeView, NULL);
+  AddTestCase (ViewTests, "View should match SMM_MM_IS_COMM_BUFF on random buffers", "RandomCommBuffers", RandomCommBuffersMatchSyscall, AllocateView, FreeView, NULL);
+  AddTestCase (ViewTests, "View should defer to the syscall until published and while updated", "Updating", ViewDefersWhileUpdating, AllocateView, FreeView, NULL);
+  AddTestCase (ViewTests, "View should defer to the syscall when incomplete", "Incomplete", ViewDefersWhenIncomplete, AllocateView, FreeView, NULL);
+  AddTestCase (ViewTests, "MMRAM ranges should be sorted and coalesced", "MmramCoalesced", MmramRangesCoalesced, AllocateView, FreeView, NULL);
+  AddTestCase (ViewTests, "Ring 3 should not be able to free the view page", "FreeViewPage", ViewPageCannotBeFreed, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -2067,6 +2067,7 @@ InitializeMpServiceData (
   //
   // Install SMI handler for each CPU
   //
+  InitializeSmiEntryTemplate ();
   for (Index = 0; Index < mMaxNumberOfCpus; Index++) {
     InstallSmiHandler (
       Index,
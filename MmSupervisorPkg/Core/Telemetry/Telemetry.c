@@ -22,8 +22,17 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #define          MM_SUPV_RETRY_CNT  1
 
+//
+// Number of telemetry records that fit in the supervisor to user page after the common buffer.
+// Consecutive faults use consecutive records, so that the report of an earlier fault in the
+// same MMI is not overwritten before the user error reporter has consumed it.
+//
+#define MM_SUPV_TELEMETRY_RECORD_COUNT \
+  ((EFI_PAGES_TO_SIZE (DEFAULT_SUPV_TO_USER_BUFFER_PAGE) - sizeof (MM_SUPV_USER_COMMON_BUFFER)) / sizeof (MM_SUPV_TELEMETRY_DATA))
+
 SPIN_LOCK  *mCpuExceptionToken       = NULL;
 UINT8      *mCpuExceptionCountBuffer = NULL;
+UINTN      mTelemetryRecordIndex     = 0;
 
 /**
   Routine for error reporting inside supervisor exception handlers.
@@ -64,24 +73,23 @@ PrepareNReportError (
     goto Done;
   }
 
-  // First populate data in our playground
-  TelemtryData = (MM_SUPV_TELEMETRY_DATA *)(SupervisorToUserDataBuffer + 1);
-  ZeroMem (TelemtryData, sizeof (MM_SUPV_TELEMETRY_DATA));
-
-  TelemtryData->Signature     = MM_SUPV_TELEMETRY_SIGNATURE;
-  TelemtryData->TelemetrySize = sizeof (MM_SUPV_TELEMETRY_DATA);
-  if (EFI_SIZE_TO_PAGES (TelemtryData->TelemetrySize + sizeof (MM_SUPV_TELEMETRY_DATA)) >
-      DEFAULT_SUPV_TO_USER_BUFFER_PAGE)
-  {
+  if (MM_SUPV_TELEMETRY_RECORD_COUNT == 0) {
     // Cannot fit in the pages we allocated for supervisor to fill in data
     DEBUG ((DEBUG_INFO, "%a Cannot fit in supervisor allocated user pages:\n", __func__));
-    DEBUG ((DEBUG_INFO, "\t Common data size: %x\n", sizeof (MM_SUPV_TELEMETRY_DATA)));
-    DEBUG ((DEBUG_INFO, "\t Telemetry data size: %x\n", TelemtryData->TelemetrySize));
+    DEBUG ((DEBUG_INFO, "\t Common data size: %x\n", sizeof (MM_SUPV_USER_COMMON_BUFFER)));
+    DEBUG ((DEBUG_INFO, "\t Telemetry data size: %x\n", sizeof (MM_SUPV_TELEMETRY_DATA)));
     Status = EFI_OUT_OF_RESOURCES;
     goto Done;
-  } else {
   }
 
+  // First populate data in our playground, the next record in line since we are holding the exception token
+  TelemtryData = (MM_SUPV_TELEMETRY_DATA *)(SupervisorToUserDataBuffer + 1) + (mTelemetryRecordIndex % MM_SUPV_TELEMETRY_RECORD_COUNT);
+  mTelemetryRecordIndex++;
+  ZeroMem (TelemtryData, sizeof (MM_SUPV_TELEMETRY_DATA));
+
+  TelemtryData->Signature     = MM_SUPV_TELEMETRY_SIGNATURE;
+  TelemtryData->TelemetrySize = sizeof (MM_SUPV_TELEMETRY_DATA);
+
   TelemtryData->ExceptionType = InterruptType;
 
   // TODO: Check if there are errors placed from syscall dispatcher, use that rIP if so
@@ -89,11 +97,17 @@ PrepareNReportError (
   TelemtryData->ExceptionRIP = FaultRIP;
   if (IsBufferInsideMmram (FaultRIP & ~(EFI_PAGE_MASK), EFI_PAGE_SIZE)) {
     // Attempting to execute code outside of MMRAM, do not run driver look up routines
-    DriverAddr                      = PeCoffSearchImageBase (FaultRIP);
+    DriverAddr = 0;
+    Status     = FindLoadedImageByAddress (FaultRIP, &DriverAddr, &DriverGuid);
+    if (Status == EFI_NOT_READY) {
+      // Loaded image table is only available after ready to lock, scan for the image header instead
+      DriverAddr = PeCoffSearchImageBase (FaultRIP);
+      Status     = FindFileNameFromDiscoveredList (DriverAddr, &DriverGuid);
+    }
+
     TelemtryData->DriverLoadAddress = DriverAddr;
     DEBUG ((DEBUG_INFO, "%a Loaded image is calculated to be: %p from caller address: %p\n", __func__, DriverAddr, FaultRIP));
 
-    Status = FindFileNameFromDiscoveredList (DriverAddr, &DriverGuid);
     if (!EFI_ERROR (Status)) {
       CopyMem (&TelemtryData->DriverId, &DriverGuid, sizeof (EFI_GUID));
     } else {
@@ -115,7 +129,7 @@ PrepareNReportError (
   // Demote to CPL3 to report errors
   Status = InvokeDemotedErrorReport (
              CpuIndex,
-             SupervisorToUserDataBuffer + 1
+             TelemtryData
              );
   DEBUG ((DEBUG_INFO, "%a Error report returned... - %r\n", __func__, Status));
 
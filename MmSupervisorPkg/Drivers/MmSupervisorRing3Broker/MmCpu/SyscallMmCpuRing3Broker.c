@@ -36,16 +36,35 @@ SysCallMmReadSaveState (
   OUT VOID                       *Buffer
   )
 {
-  UINTN  Status;
+  UINTN                      Status;
+  SMM_SAVE_STATE_READ_ENTRY  Entry;
 
-  Status = SysCall (SMM_SC_SVST_READ, (UINTN)This, (UINTN)Register, CpuIndex);
+  //
+  // No save state register is wider than the IO information, the supervisor treats
+  // such a request as malformed.
+  //
+  if ((Buffer == NULL) || (Width == 0) || (Width > sizeof (EFI_MM_SAVE_STATE_IO_INFO)) || (CpuIndex > MAX_UINT32)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // A single entry batch costs one ring transition instead of the two taken by the
+  // SMM_SC_SVST_READ and SMM_SC_SVST_READ_2 pair.
+  //
+  Entry.CpuIndex = (UINT32)CpuIndex;
+  Entry.Register = (UINT32)Register;
+  Entry.Width    = (UINT32)Width;
+  Entry.Reserved = 0;
+  Entry.Status   = EFI_NOT_STARTED;
+
+  Status = SysCall (SMM_SC_SVST_READ_BATCH, (UINTN)&Entry, 1, (UINTN)Buffer);
   if (EFI_ERROR (Status)) {
-    DEBUG ((DEBUG_ERROR, "%a First syscall has failed - %r\n", __func__, Status));
+    DEBUG ((DEBUG_ERROR, "%a Save state read syscall has failed - %r\n", __func__, Status));
     ASSERT (FALSE);
     goto Done;
   }
 
-  Status = SysCall (SMM_SC_SVST_READ_2, (UINTN)This, Width, (UINTN)Buffer);
+  Status = Entry.Status;
 
 Done:
   return Status;
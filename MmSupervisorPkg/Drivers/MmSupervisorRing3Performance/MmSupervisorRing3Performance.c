@@ -4,6 +4,8 @@
   This driver is expected to be linked against a PerformanceLib instance that implements the
   code typically in a MM Core for user mode performance data. This includes installing the
   performance protocol and registering a MMI to return performance data to the MMI caller.
+  MmSupervisorRing3PerformanceLib is the instance provided by this package; all of its work is
+  done in the library constructor.
 
   Copyright (c) Microsoft Corporation.
   SPDX-License-Identifier: BSD-2-Clause-Patent
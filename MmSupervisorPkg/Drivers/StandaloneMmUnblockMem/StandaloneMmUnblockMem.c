@@ -24,6 +24,15 @@
 #include <Library/UefiLib.h>
 #include <Library/PerformanceLib.h>
 
+//
+// Memory map sorted by physical start address, evaluated once for a whole batch of regions.
+//
+typedef struct {
+  EFI_MEMORY_DESCRIPTOR    *Map;
+  UINTN                    Count;
+  UINTN                    DescriptorSize;
+} MEMORY_MAP_SNAPSHOT;
+
 BOOLEAN                               mReadyToLockOccurred    = FALSE;
 MM_SUPERVISOR_COMMUNICATION_PROTOCOL  *mMmCommunicateProtocol = NULL;
 
@@ -35,28 +44,65 @@ MmIplRequestUnblockPages (
   IN CONST EFI_GUID        *IdentifierGuid
   );
 
+EFI_STATUS
+EFIAPI
+MmIplRequestUnblockPagesBatch (
+  IN OUT MM_SUPERVISOR_UNBLOCK_REGION  *Regions,
+  IN     UINTN                         RegionCount,
+  IN     CONST EFI_GUID                *IdentifierGuid
+  );
+
 MM_SUPERVISOR_UNBLOCK_MEMORY_PROTOCOL  mMmUnblockMemProtocol = {
-  .Version             = MM_UNBLOCK_REQUEST_PROTOCOL_VERSION,
-  .RequestUnblockPages = MmIplRequestUnblockPages
+  .Version                  = MM_UNBLOCK_REQUEST_PROTOCOL_VERSION,
+  .RequestUnblockPages      = MmIplRequestUnblockPages,
+  .RequestUnblockPagesBatch = MmIplRequestUnblockPagesBatch
 };
 
 /**
-  This interface provides a way to requested data pages to be legit to access inside MM environment.
+  Compare two memory descriptors by physical start address.
 
-  @param  UnblockAddress          The address of buffer caller requests to unblock, the address
-                                  has to be page aligned.
-  @param  NumberOfPages           The number of pages requested to be unblocked from MM
-                                  environment.
+  @param[in]  Buffer1   The first EFI_MEMORY_DESCRIPTOR.
+  @param[in]  Buffer2   The second EFI_MEMORY_DESCRIPTOR.
 
-  @return EFI_SUCCESS             The request passes evaluation successfully.
-  @return EFI_NO_MAPPING          The requested address region is not found from memory map.
-  @return EFI_ACCESS_DENIED       The request is rejected due to memory type incorrect.
+  @retval  1    Buffer1 starts above Buffer2.
+  @retval  0    Buffer1 and Buffer2 start at the same address.
+  @retval -1    Buffer1 starts below Buffer2.
+**/
+STATIC
+INTN
+EFIAPI
+CompareMemoryDescriptor (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  CONST EFI_MEMORY_DESCRIPTOR  *Descriptor1;
+  CONST EFI_MEMORY_DESCRIPTOR  *Descriptor2;
+
+  Descriptor1 = (CONST EFI_MEMORY_DESCRIPTOR *)Buffer1;
+  Descriptor2 = (CONST EFI_MEMORY_DESCRIPTOR *)Buffer2;
+  if (Descriptor1->PhysicalStart > Descriptor2->PhysicalStart) {
+    return 1;
+  } else if (Descriptor1->PhysicalStart < Descriptor2->PhysicalStart) {
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+  Take a snapshot of the EFI memory map, sorted by physical start address.
+
+  @param[out]  Snapshot           The snapshot, to be released with FreeMemoryMapSnapshot.
+
+  @return EFI_SUCCESS             The snapshot is taken.
+  @return EFI_OUT_OF_RESOURCES    Cannot allocate memory for the snapshot.
+  @return Others                  The memory map cannot be retrieved.
  */
 STATIC
 EFI_STATUS
-EvaluateRequestedRegion (
-  IN EFI_PHYSICAL_ADDRESS  UnblockAddress,
-  IN UINT64                NumberOfPages
+TakeMemoryMapSnapshot (
+  OUT MEMORY_MAP_SNAPSHOT  *Snapshot
   )
 {
   EFI_STATUS             Status;
@@ -65,25 +111,9 @@ EvaluateRequestedRegion (
   UINTN                  EfiDescriptorSize;
   UINT32                 EfiDescriptorVersion;
   EFI_MEMORY_DESCRIPTOR  *EfiMemoryMap;
-  EFI_MEMORY_DESCRIPTOR  *EfiMemoryMapEnd;
-  EFI_MEMORY_DESCRIPTOR  *EfiMemNext;
-  EFI_PHYSICAL_ADDRESS   TestAddress;
-  UINT64                 TestRange;
+  VOID                   *SortBuffer;
 
-  PERF_FUNCTION_BEGIN ();
-
-  DEBUG_CODE_BEGIN ();
-
-  DEBUG ((
-    DEBUG_INFO,
-    "%a Checking against address 0x%p - 0x%p %d\n",
-    __func__,
-    UnblockAddress,
-    UnblockAddress + EFI_PAGES_TO_SIZE (NumberOfPages),
-    NumberOfPages
-    ));
-
-  DEBUG_CODE_END ();
+  ZeroMem (Snapshot, sizeof (*Snapshot));
 
   //
   // Get the EFI memory map.
@@ -100,9 +130,13 @@ EvaluateRequestedRegion (
   //
   // Loop to allocate space for the memory map and then copy it in.
   //
-  do {
+  while (Status == EFI_BUFFER_TOO_SMALL) {
     EfiMemoryMap = (EFI_MEMORY_DESCRIPTOR *)AllocateZeroPool (EfiMemoryMapSize);
     ASSERT (EfiMemoryMap != NULL);
+    if (EfiMemoryMap == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
     Status = gBS->GetMemoryMap (
                     &EfiMemoryMapSize,
                     EfiMemoryMap,
@@ -112,58 +146,199 @@ EvaluateRequestedRegion (
                     );
     if (EFI_ERROR (Status)) {
       FreePool (EfiMemoryMap);
+      EfiMemoryMap = NULL;
     }
-  } while (Status == EFI_BUFFER_TOO_SMALL);
+  }
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a Failed to get the memory map - %r\n", __func__, Status));
+    return Status;
+  }
+
+  Snapshot->Map            = EfiMemoryMap;
+  Snapshot->DescriptorSize = EfiDescriptorSize;
+  Snapshot->Count          = EfiMemoryMapSize / EfiDescriptorSize;
+
+  if (Snapshot->Count > 1) {
+    SortBuffer = AllocatePool (EfiDescriptorSize);
+    if (SortBuffer == NULL) {
+      FreePool (EfiMemoryMap);
+      ZeroMem (Snapshot, sizeof (*Snapshot));
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    QuickSort (EfiMemoryMap, Snapshot->Count, EfiDescriptorSize, CompareMemoryDescriptor, SortBuffer);
+    FreePool (SortBuffer);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Release a memory map snapshot.
+
+  @param[in, out]  Snapshot     The snapshot taken by TakeMemoryMapSnapshot.
+ */
+STATIC
+VOID
+FreeMemoryMapSnapshot (
+  IN OUT MEMORY_MAP_SNAPSHOT  *Snapshot
+  )
+{
+  if (Snapshot->Map != NULL) {
+    FreePool (Snapshot->Map);
+  }
+
+  ZeroMem (Snapshot, sizeof (*Snapshot));
+}
+
+/**
+  Get a descriptor of a memory map snapshot.
+
+  @param[in]  Snapshot      The snapshot.
+  @param[in]  Index         The index of the descriptor, below the count of the snapshot.
+
+  @return The descriptor.
+ */
+STATIC
+EFI_MEMORY_DESCRIPTOR *
+SnapshotDescriptor (
+  IN CONST MEMORY_MAP_SNAPSHOT  *Snapshot,
+  IN UINTN                      Index
+  )
+{
+  return (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)Snapshot->Map + Index * Snapshot->DescriptorSize);
+}
+
+/**
+  This interface provides a way to requested data pages to be legit to access inside MM environment.
 
-  EfiMemoryMapEnd = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)EfiMemoryMap + EfiMemoryMapSize);
-  EfiMemNext      = EfiMemoryMap;
+  @param  Snapshot                The sorted snapshot of the memory map to check against.
+  @param  UnblockAddress          The address of buffer caller requests to unblock, the address
+                                  has to be page aligned.
+  @param  NumberOfPages           The number of pages requested to be unblocked from MM
+                                  environment.
 
+  @return EFI_SUCCESS             The request passes evaluation successfully.
+  @return EFI_NO_MAPPING          The requested address region is not found from memory map.
+  @return EFI_ACCESS_DENIED       The request is rejected due to memory type incorrect.
+ */
+STATIC
+EFI_STATUS
+EvaluateRequestedRegion (
+  IN CONST MEMORY_MAP_SNAPSHOT  *Snapshot,
+  IN EFI_PHYSICAL_ADDRESS       UnblockAddress,
+  IN UINT64                     NumberOfPages
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *EfiMemNext;
+  EFI_PHYSICAL_ADDRESS   TestAddress;
+  EFI_PHYSICAL_ADDRESS   EndAddress;
+  UINT64                 TestRange;
+  UINT64                 AvailablePages;
+  UINTN                  Low;
+  UINTN                  High;
+  UINTN                  Middle;
+
+  PERF_FUNCTION_BEGIN ();
+
+  DEBUG_CODE_BEGIN ();
+
+  DEBUG ((
+    DEBUG_INFO,
+    "%a Checking against address 0x%p - 0x%p %d\n",
+    __func__,
+    UnblockAddress,
+    UnblockAddress + EFI_PAGES_TO_SIZE (NumberOfPages),
+    NumberOfPages
+    ));
+
+  DEBUG_CODE_END ();
+
+  //
+  // Find the last descriptor starting at or below the requested address.
+  //
+  Low  = 0;
+  High = Snapshot->Count;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (SnapshotDescriptor (Snapshot, Middle)->PhysicalStart <= UnblockAddress) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  //
+  // Walk the descriptors the region spans, they have to be contiguous.
+  //
   TestAddress = UnblockAddress;
   TestRange   = NumberOfPages;
-  Status      = EFI_NO_MAPPING;
-  while (EfiMemNext < EfiMemoryMapEnd && TestRange > 0) {
-    if ((EfiMemNext->PhysicalStart <= TestAddress) &&
-        (TestAddress < (EfiMemNext->PhysicalStart + EFI_PAGES_TO_SIZE (EfiMemNext->NumberOfPages))))
+  while ((Low > 0) && (Low <= Snapshot->Count) && (TestRange > 0)) {
+    EfiMemNext = SnapshotDescriptor (Snapshot, Low - 1);
+    EndAddress = EfiMemNext->PhysicalStart + EFI_PAGES_TO_SIZE (EfiMemNext->NumberOfPages);
+    if ((EfiMemNext->PhysicalStart > TestAddress) || (TestAddress >= EndAddress)) {
+      break;
+    }
+
+    if ((EfiMemNext->Type != EfiReservedMemoryType) &&
+        (EfiMemNext->Type != EfiRuntimeServicesCode) &&
+        (EfiMemNext->Type != EfiRuntimeServicesData) &&
+        (EfiMemNext->Type != EfiACPIMemoryNVS))
     {
-      if ((EfiMemNext->Type != EfiReservedMemoryType) &&
-          (EfiMemNext->Type != EfiRuntimeServicesCode) &&
-          (EfiMemNext->Type != EfiRuntimeServicesData) &&
-          (EfiMemNext->Type != EfiACPIMemoryNVS))
-      {
-        DEBUG ((DEBUG_INFO, "%a Evaluation failed due to memory type is unexpected %x\n", __func__, EfiMemNext->Type));
-        Status = EFI_ACCESS_DENIED;
-        break;
-      } else if (((EfiMemNext->Type == EfiRuntimeServicesCode) || (EfiMemNext->Type == EfiRuntimeServicesData)) &&
-                 ((EfiMemNext->Attribute & EFI_MEMORY_RO) != 0))
-      {
-        DEBUG ((DEBUG_INFO, "%a Evaluation failed due to runtime memory region is marked as read only\n", __func__));
-        Status = EFI_ACCESS_DENIED;
-        break;
-      } else {
-        if (TestRange > (EfiMemNext->PhysicalStart + EFI_PAGES_TO_SIZE (EfiMemNext->NumberOfPages) - TestAddress)) {
-          TestAddress = EfiMemNext->PhysicalStart + EFI_PAGES_TO_SIZE (EfiMemNext->NumberOfPages);
-          TestRange  -= EFI_SIZE_TO_PAGES (EfiMemNext->PhysicalStart + EFI_PAGES_TO_SIZE (EfiMemNext->NumberOfPages) - TestAddress);
-        } else {
-          // Mark the validate range to be 0 and it should bail on the next iteration
-          TestRange = 0;
-        }
-      }
+      DEBUG ((DEBUG_INFO, "%a Evaluation failed due to memory type is unexpected %x\n", __func__, EfiMemNext->Type));
+      PERF_FUNCTION_END ();
+      return EFI_ACCESS_DENIED;
+    } else if (((EfiMemNext->Type == EfiRuntimeServicesCode) || (EfiMemNext->Type == EfiRuntimeServicesData)) &&
+               ((EfiMemNext->Attribute & EFI_MEMORY_RO) != 0))
+    {
+      DEBUG ((DEBUG_INFO, "%a Evaluation failed due to runtime memory region is marked as read only\n", __func__));
+      PERF_FUNCTION_END ();
+      return EFI_ACCESS_DENIED;
     }
 
-    EfiMemNext = NEXT_MEMORY_DESCRIPTOR (EfiMemNext, EfiDescriptorSize);
+    AvailablePages = EFI_SIZE_TO_PAGES (EndAddress - TestAddress);
+    if (TestRange <= AvailablePages) {
+      TestRange = 0;
+    } else {
+      TestRange  -= AvailablePages;
+      TestAddress = EndAddress;
+      Low++;
+    }
   }
 
-  if (TestRange == 0) {
-    Status = EFI_SUCCESS;
-  }
+  PERF_FUNCTION_END ();
+
+  return (TestRange == 0) ? EFI_SUCCESS : EFI_NO_MAPPING;
+}
+
+/**
+  Check the arguments of a single region to unblock.
 
-  if (EfiMemoryMap) {
-    FreePool (EfiMemoryMap);
+  @param  UnblockAddress          The address of buffer caller requests to unblock.
+  @param  NumberOfPages           The number of pages requested to be unblocked.
+
+  @return EFI_SUCCESS             The region can be evaluated.
+  @return EFI_INVALID_PARAMETER   The address is NULL or not page aligned.
+ */
+STATIC
+EFI_STATUS
+CheckRequestedRegion (
+  IN EFI_PHYSICAL_ADDRESS  UnblockAddress,
+  IN UINT64                NumberOfPages
+  )
+{
+  if ((UnblockAddress == 0) || (UnblockAddress & (EFI_PAGE_SIZE - 1))) {
+    DEBUG ((DEBUG_ERROR, "%a Input argument of address %p is invalid!\n", __func__, UnblockAddress));
+    return EFI_INVALID_PARAMETER;
   }
 
-  PERF_FUNCTION_END ();
+  if (NumberOfPages > RShiftU64 (MAX_UINT64 - UnblockAddress, EFI_PAGE_SHIFT)) {
+    DEBUG ((DEBUG_ERROR, "%a Requested %ld pages at %p overflow!\n", __func__, NumberOfPages, UnblockAddress));
+    return EFI_INVALID_PARAMETER;
+  }
 
-  return Status;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -203,22 +378,19 @@ MmIplRequestUnblockPages (
   MM_SUPERVISOR_REQUEST_HEADER         *RequestBuffer;
   MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS  *UnblockBuffer;
   UINTN                                CommBufferSize;
+  MEMORY_MAP_SNAPSHOT                  Snapshot;
 
   // Step 1: Basic sanity check
-  if ((IdentifierGuid == NULL) ||
-      (UnblockAddress == 0) ||
-      UnblockAddress & (EFI_PAGE_SIZE - 1))
-  {
-    DEBUG ((
-      DEBUG_ERROR,
-      "%a Input argument of address %p or identifier GUID %p is invalid!\n",
-      __func__,
-      UnblockAddress,
-      IdentifierGuid
-      ));
+  if (IdentifierGuid == NULL) {
+    DEBUG ((DEBUG_ERROR, "%a Input identifier GUID is NULL!\n", __func__));
     return EFI_INVALID_PARAMETER;
   }
 
+  Status = CheckRequestedRegion (UnblockAddress, NumberOfPages);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   if (NumberOfPages == 0) {
     // This is dumb...
     DEBUG ((DEBUG_WARN, "%a Requesting to unblock 0 pages, return here!\n", __func__));
@@ -236,7 +408,13 @@ MmIplRequestUnblockPages (
     return EFI_NOT_READY;
   }
 
-  Status = EvaluateRequestedRegion (UnblockAddress, NumberOfPages);
+  Status = TakeMemoryMapSnapshot (&Snapshot);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = EvaluateRequestedRegion (&Snapshot, UnblockAddress, NumberOfPages);
+  FreeMemoryMapSnapshot (&Snapshot);
   if (EFI_ERROR (Status)) {
     // Someone must have done something terrible...
     DEBUG ((DEBUG_ERROR, "%a Requested address did not pass evaluation %r\n", __func__, Status));
@@ -291,6 +469,247 @@ MmIplRequestUnblockPages (
   return RequestBuffer->Result;
 }
 
+/**
+  Convey a batch of regions to MM supervisor, split into as many requests as the supervisor
+  communicate buffer requires.
+
+  @param[in, out]  Entries          The regions to unblock. The status of each region is returned
+                                    in its Result field.
+  @param[in]       EntryCount       The number of regions, not 0.
+
+  @return EFI_SUCCESS             The batch was conveyed, the entries hold their status.
+  @return EFI_OUT_OF_RESOURCES    Cannot prepare enough memory resource for communication.
+  @return Others                  The communication failed, entries not conveyed hold
+                                  EFI_NOT_STARTED.
+
+**/
+STATIC
+EFI_STATUS
+SendUnblockBatch (
+  IN OUT MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY  *Entries,
+  IN     UINTN                                     EntryCount
+  )
+{
+  EFI_STATUS                                 Status;
+  EFI_MM_COMMUNICATE_HEADER                  *CommHeader;
+  MM_SUPERVISOR_REQUEST_HEADER               *RequestBuffer;
+  MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_BUFFER  *BatchBuffer;
+  MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY   *BatchEntries;
+  UINTN                                      HeaderSize;
+  UINTN                                      CommBufferSize;
+  UINTN                                      Capacity;
+  UINTN                                      Sent;
+  UINTN                                      Chunk;
+  UINTN                                      Index;
+
+  HeaderSize = OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data) +
+               sizeof (MM_SUPERVISOR_REQUEST_HEADER) +
+               sizeof (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_BUFFER);
+  CommHeader = (EFI_MM_COMMUNICATE_HEADER *)AllocatePool (HeaderSize + EntryCount * sizeof (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY));
+  ASSERT (CommHeader != NULL);
+  if (CommHeader == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  RequestBuffer = (MM_SUPERVISOR_REQUEST_HEADER *)(CommHeader->Data);
+  BatchBuffer   = (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_BUFFER *)(RequestBuffer + 1);
+  BatchEntries  = (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY *)(BatchBuffer + 1);
+
+  Status   = EFI_SUCCESS;
+  Capacity = EntryCount;
+  Sent     = 0;
+  while (Sent < EntryCount) {
+    Chunk          = MIN (Capacity, EntryCount - Sent);
+    CommBufferSize = HeaderSize + Chunk * sizeof (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY);
+
+    // Step 1: MM Communication common header
+    CopyGuid (&CommHeader->HeaderGuid, &gMmSupervisorRequestHandlerGuid);
+    CommHeader->MessageLength = CommBufferSize - OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data);
+
+    // Step 2: MM_SUPERVISOR_REQUEST_HEADER and batch content
+    RequestBuffer->Signature = MM_SUPERVISOR_REQUEST_SIG;
+    RequestBuffer->Revision  = MM_SUPERVISOR_REQUEST_REVISION;
+    RequestBuffer->Request   = MM_SUPERVISOR_REQUEST_UNBLOCK_MEM_BATCH;
+    RequestBuffer->Reserved  = 0;
+    RequestBuffer->Result    = EFI_SUCCESS;
+    BatchBuffer->Count       = Chunk;
+    CopyMem (BatchEntries, &Entries[Sent], Chunk * sizeof (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY));
+
+    // Step 3: Ready to signal Mmi.
+    Status = mMmCommunicateProtocol->Communicate (mMmCommunicateProtocol, CommHeader, &CommBufferSize);
+    if (Status == EFI_BAD_BUFFER_SIZE) {
+      // The supervisor buffer is smaller than the batch, CommBufferSize reports its size.
+      Capacity = (CommBufferSize > HeaderSize) ?
+                 (CommBufferSize - HeaderSize) / sizeof (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY) : 0;
+      if ((Capacity > 0) && (Capacity < Chunk)) {
+        continue;
+      }
+    }
+
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a - Failed from MmCommunication protocol - %r\n", __func__, Status));
+      break;
+    }
+
+    // Step 4: Collect the status of each entry, a supervisor rejecting the whole request leaves them untouched
+    for (Index = 0; Index < Chunk; Index++) {
+      if (BatchEntries[Index].Result == EFI_NOT_STARTED) {
+        Entries[Sent + Index].Result = RequestBuffer->Result;
+      } else {
+        Entries[Sent + Index].Result = BatchEntries[Index].Result;
+      }
+    }
+
+    Sent += Chunk;
+  }
+
+  FreePool (CommHeader);
+
+  return Status;
+}
+
+/**
+  This API provides a way to unblock several regions of data pages with a single request.
+
+  Every region is subject to the same requirements as with MmIplRequestUnblockPages. The
+  regions are evaluated against a single snapshot of the memory map and conveyed to MM
+  supervisor together, which processes them in order. The status of each region is reported
+  in its Status field, and a failing region does not prevent the others from being unblocked.
+
+  @param  Regions                 The regions to unblock, along with their returned status.
+  @param  RegionCount             The number of regions.
+  @param  IdentifierGuid          The unique caller ID from requester.
+
+  @return EFI_SUCCESS             All regions are unblocked successfully.
+  @return EFI_INVALID_PARAMETER   Regions or caller ID is NULL pointer.
+  @return EFI_ACCESS_DENIED       The request is rejected by MM supervisor due to memory map is
+                                  locked down.
+  @return EFI_NOT_READY           The request cannot be processed due to the MM communicate
+                                  foundation is not ready.
+  @return EFI_OUT_OF_RESOURCES    Cannot prepare enough memory resource for communication.
+  @return Others                  The status of the first region that failed to be unblocked.
+
+**/
+EFI_STATUS
+EFIAPI
+MmIplRequestUnblockPagesBatch (
+  IN OUT MM_SUPERVISOR_UNBLOCK_REGION  *Regions,
+  IN     UINTN                         RegionCount,
+  IN     CONST EFI_GUID                *IdentifierGuid
+  )
+{
+  EFI_STATUS                                Status;
+  EFI_STATUS                                FirstFailure;
+  MEMORY_MAP_SNAPSHOT                       Snapshot;
+  MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY  *Entries;
+  UINTN                                     *EntryRegion;
+  UINTN                                     EntryCount;
+  UINTN                                     Index;
+
+  // Step 1: Basic sanity check
+  if (((Regions == NULL) && (RegionCount != 0)) || (IdentifierGuid == NULL)) {
+    DEBUG ((DEBUG_ERROR, "%a Input regions %p or identifier GUID %p is invalid!\n", __func__, Regions, IdentifierGuid));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (RegionCount == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Entries     = NULL;
+  EntryRegion = NULL;
+  ZeroMem (&Snapshot, sizeof (Snapshot));
+  for (Index = 0; Index < RegionCount; Index++) {
+    Regions[Index].Status = EFI_NOT_STARTED;
+  }
+
+  if (mReadyToLockOccurred) {
+    // Someone must have done something terrible...
+    DEBUG ((DEBUG_ERROR, "%a Request is blocked after exit boot services, how did you get here?\n", __func__));
+    Status = EFI_ACCESS_DENIED;
+    goto Done;
+  }
+
+  if (mMmCommunicateProtocol == NULL) {
+    DEBUG ((DEBUG_ERROR, "%a Communicate protocol is not in place, cannot process the request\n", __func__));
+    Status = EFI_NOT_READY;
+    goto Done;
+  }
+
+  Entries     = AllocateZeroPool (RegionCount * sizeof (MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY));
+  EntryRegion = AllocatePool (RegionCount * sizeof (UINTN));
+  if ((Entries == NULL) || (EntryRegion == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  Status = TakeMemoryMapSnapshot (&Snapshot);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  // Step 2: Evaluate all regions against the same snapshot, only convey the ones that pass
+  EntryCount = 0;
+  for (Index = 0; Index < RegionCount; Index++) {
+    Regions[Index].Status = CheckRequestedRegion (Regions[Index].UnblockAddress, Regions[Index].NumberOfPages);
+    if (EFI_ERROR (Regions[Index].Status) || (Regions[Index].NumberOfPages == 0)) {
+      continue;
+    }
+
+    if (EFI_ERROR (EvaluateRequestedRegion (&Snapshot, Regions[Index].UnblockAddress, Regions[Index].NumberOfPages))) {
+      DEBUG ((DEBUG_ERROR, "%a Requested address %p did not pass evaluation\n", __func__, Regions[Index].UnblockAddress));
+      Regions[Index].Status = EFI_ACCESS_DENIED;
+      continue;
+    }
+
+    CopyGuid (&Entries[EntryCount].Params.IdentifierGuid, IdentifierGuid);
+    Entries[EntryCount].Params.MemoryDescriptor.Type          = EfiRuntimeServicesData;
+    Entries[EntryCount].Params.MemoryDescriptor.PhysicalStart = Regions[Index].UnblockAddress;
+    Entries[EntryCount].Params.MemoryDescriptor.VirtualStart  = 0;
+    Entries[EntryCount].Params.MemoryDescriptor.NumberOfPages = Regions[Index].NumberOfPages;
+    Entries[EntryCount].Params.MemoryDescriptor.Attribute     = 0;
+    Entries[EntryCount].Result                                = EFI_NOT_STARTED;
+    EntryRegion[EntryCount]                                   = Index;
+    EntryCount++;
+  }
+
+  // Step 3: Convey the remaining regions in as few MMIs as possible
+  if (EntryCount > 0) {
+    Status = SendUnblockBatch (Entries, EntryCount);
+    for (Index = 0; Index < EntryCount; Index++) {
+      Regions[EntryRegion[Index]].Status = (EFI_STATUS)Entries[Index].Result;
+      if (Regions[EntryRegion[Index]].Status == EFI_NOT_STARTED) {
+        Regions[EntryRegion[Index]].Status = EFI_ERROR (Status) ? Status : EFI_ABORTED;
+      }
+    }
+  }
+
+Done:
+  // Step 4: Regions left unprocessed share the failure of the whole request, report the first failure
+  FirstFailure = EFI_SUCCESS;
+  for (Index = 0; Index < RegionCount; Index++) {
+    if (Regions[Index].Status == EFI_NOT_STARTED) {
+      Regions[Index].Status = Status;
+    }
+
+    if (EFI_ERROR (Regions[Index].Status) && !EFI_ERROR (FirstFailure)) {
+      DEBUG ((DEBUG_ERROR, "%a - Region %p failed to be unblocked - %r\n", __func__, Regions[Index].UnblockAddress, Regions[Index].Status));
+      FirstFailure = Regions[Index].Status;
+    }
+  }
+
+  FreeMemoryMapSnapshot (&Snapshot);
+  if (EntryRegion != NULL) {
+    FreePool (EntryRegion);
+  }
+
+  if (Entries != NULL) {
+    FreePool (Entries);
+  }
+
+  return FirstFailure;
+}
+
 /**
 Callback of exit boot event. This will unregister RSC handler in this module.
 
@@ -41,6 +41,26 @@ typedef struct _UNBLOCK_MEMORY_DATA_BUFFER {
   EFI_GUID                 IdentifierGuid;
 } MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS;
 
+/**
+  One region of a batched unblock request, along with the result of unblocking it.
+
+**/
+typedef struct _UNBLOCK_MEMORY_BATCH_ENTRY {
+  MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS    Params;
+  UINT64                                 Result;  // Cast to EFI_STATUS before usage
+} MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY;
+
+/**
+  This structure is used to unblock several regions with a single request. Count entries of
+  MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_ENTRY follow this structure. The supervisor processes
+  them in order, exactly as separate MM_SUPERVISOR_REQUEST_UNBLOCK_MEM requests, and reports
+  the status of each one in its Result field.
+
+**/
+typedef struct _UNBLOCK_MEMORY_BATCH_BUFFER {
+  UINT64    Count;
+} MM_SUPERVISOR_UNBLOCK_MEMORY_BATCH_BUFFER;
+
 /**
   This structure is used to communicate supervisor version number, patch level, and
   maximal communication level supported.
@@ -62,6 +82,71 @@ typedef struct _COMM_UPDATE_BUFFER {
   MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS    NewCommBuffers[MM_OPEN_BUFFER_CNT];
 } MM_SUPERVISOR_COMM_UPDATE_BUFFER;
 
+/**
+  One MP procedure run logged by a processor during a MMI. Timestamps are in
+  performance counter ticks.
+
+**/
+typedef struct _MP_PERF_EVENT {
+  UINT64    SmiSequence;
+  UINT64    Begin;
+  UINT64    End;
+  UINT32    CpuIndex;
+  UINT32    ProcedureId;
+} MM_SUPERVISOR_MP_PERF_EVENT;
+
+/**
+  This structure summarizes the MP procedure timeline of one MMI across all
+  processors that logged events during it.
+
+  The arrival of a processor is the beginning of its first event in the MMI, and
+  its departure is the end of its last event.
+
+**/
+typedef struct _MP_PERF_SUMMARY {
+  UINT64    SmiSequence;
+  UINT32    CpuCount;             // Processors that logged events in this MMI
+  UINT32    StragglerCpu;         // Processor that arrived last
+  UINT32    CriticalCpu;          // Processor that departed last
+  UINT32    CriticalProcedureId;  // Longest procedure of CriticalCpu
+  UINT64    FirstArrival;
+  UINT64    LastArrival;
+  UINT64    LastDeparture;
+  UINT64    CriticalPath;         // LastDeparture - FirstArrival
+  UINT64    ArrivalSkew;          // LastArrival - FirstArrival
+  UINT64    RendezvousWait;       // Sum over processors of LastArrival - arrival
+} MM_SUPERVISOR_MP_PERF_SUMMARY;
+
+/**
+  This structure is used to query the MP procedure timeline kept by the supervisor.
+
+  For MM_SUPERVISOR_MP_PERF_GET_SUMMARY, SmiSequence selects the MMI to summarize, or
+  MM_SUPERVISOR_MP_PERF_LAST_SMI for the last completed one.
+  For MM_SUPERVISOR_MP_PERF_GET_EVENTS, retained events starting at EventOffset are
+  copied right after this structure, for as many as the communication buffer holds.
+
+**/
+typedef struct _MP_PERF_BUFFER {
+  UINT32                           Command;
+  UINT32                           Reserved;
+  UINT64                           SmiSequence;  // IN: MMI to summarize, OUT: MMI summarized
+  MM_SUPERVISOR_MP_PERF_SUMMARY    Summary;      // OUT
+  UINT64                           EventOffset;  // IN: first event, OUT: next event to request
+  UINT64                           EventCount;   // OUT: events copied
+  UINT64                           TotalEvents;  // OUT: events retained
+} MM_SUPERVISOR_MP_PERF_BUFFER;
+
+#define   MM_SUPERVISOR_MP_PERF_GET_SUMMARY  0x0001
+#define   MM_SUPERVISOR_MP_PERF_GET_EVENTS   0x0002
+
+#define   MM_SUPERVISOR_MP_PERF_LAST_SMI  MAX_UINT64
+
+//
+// SmiSequence of the events logged outside of any MMI, such as while SMM is initialized.
+// They are reported as events but are never part of a MMI summary.
+//
+#define   MM_SUPERVISOR_MP_PERF_NO_SMI  (MAX_UINT64 - 1)
+
 #pragma pack(pop)
 
 /**
@@ -96,12 +181,27 @@ typedef struct _COMM_UPDATE_BUFFER {
  **/
 #define   MM_SUPERVISOR_REQUEST_COMM_UPDATE  0x0004
 
+/**
+  @retval EFI_INVALID_PARAMETER      If the MP perf command is unknown
+  @retval EFI_NOT_READY              If MP perf logging is not enabled
+  @retval EFI_NOT_FOUND              If no events are retained for the requested MMI
+ **/
+#define   MM_SUPERVISOR_REQUEST_MP_PERF  0x0005
+
+/**
+  The status of each region is reported in the Result of its batch entry.
+
+  @retval EFI_BUFFER_TOO_SMALL       If the communication buffer cannot hold Count entries
+  @retval Others                     The Result of the first entry that failed to be unblocked
+ **/
+#define   MM_SUPERVISOR_REQUEST_UNBLOCK_MEM_BATCH  0x0006
+
 /**
   Maximal request index supported by supervisor. When supported, the value of this definition
   will be populated in the MaxSupervisorRequestLevel of VERSION_INFO_BUFFER upon a successful query
   to supervisor.
 
  **/
-#define   MM_SUPERVISOR_REQUEST_MAX_SUPPORTED  MM_SUPERVISOR_REQUEST_COMM_UPDATE
+#define   MM_SUPERVISOR_REQUEST_MAX_SUPPORTED  MM_SUPERVISOR_REQUEST_UNBLOCK_MEM_BATCH
 
 #endif // _MM_SUPV_REQUEST_DATA_H_
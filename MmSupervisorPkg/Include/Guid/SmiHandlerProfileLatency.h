@@ -0,0 +1,64 @@
+/** @file
+  Data structures used to retrieve per-handler invocation counts and latency
+  histograms through the SMI handler profile communication channel.
+
+  The command shares gSmiHandlerProfileGuid and SMI_HANDLER_PROFILE_PARAMETER_HEADER
+  with the commands defined in Guid/SmiHandlerProfile.h.
+
+Copyright (c), Microsoft Corporation.
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _SMI_HANDLER_PROFILE_LATENCY_H_
+#define _SMI_HANDLER_PROFILE_LATENCY_H_
+
+#include <Guid/SmiHandlerProfile.h>
+
+#define SMI_HANDLER_PROFILE_COMMAND_GET_LATENCY_BY_OFFSET  0x80000001
+
+//
+// Bucket N of the histogram counts invocations that took [2^N, 2^(N+1)) TSC ticks.
+// Bucket 0 also counts invocations of 0 ticks, the last bucket absorbs everything above.
+//
+#define SMI_HANDLER_LATENCY_BUCKET_COUNT  32
+
+#pragma pack(push, 1)
+
+typedef struct {
+  EFI_GUID    HandlerType;      // Zero GUID for root MMI handlers
+  UINT64      Handler;
+  UINT64      CallerAddress;
+  UINT32      IsSupervisor;
+  UINT32      Reserved;
+  UINT64      InvocationCount;
+  UINT64      TotalTicks;
+  UINT64      MaxTicks;
+  UINT64      Histogram[SMI_HANDLER_LATENCY_BUCKET_COUNT];
+} SMI_HANDLER_LATENCY_RECORD;
+
+typedef struct {
+  SMI_HANDLER_PROFILE_PARAMETER_HEADER    Header;
+  //
+  // On output, the number of handler records available.
+  //
+  UINT64                                  RecordCount;
+  //
+  // On input, data buffer address outside of MMRAM to hold SMI_HANDLER_LATENCY_RECORDs.
+  //
+  PHYSICAL_ADDRESS                        DataBuffer;
+  //
+  // On input, data buffer size in bytes.
+  // On output, size in bytes of the records copied.
+  //
+  UINT64                                  DataSize;
+  //
+  // On input, index of the first record to copy.
+  // On output, index of the first record to copy in the next request.
+  //
+  UINT64                                  RecordOffset;
+} SMI_HANDLER_PROFILE_PARAMETER_GET_LATENCY_BY_OFFSET;
+
+#pragma pack(pop)
+
+#endif // _SMI_HANDLER_PROFILE_LATENCY_H_
@@ -18,6 +18,23 @@ typedef struct {
   UINT64    *SmBase;            // Pointer to SmBase array with number specified by NumberOfCpus
 } GATELIB_CPU_SMM_DATA;
 
+/**
+  @brief Prepare the save state supervision for a newly applied policy.
+
+  The save state descriptors of the policy are indexed by MapField, so that every later
+  access check looks its descriptor up directly.
+
+  @param SmmSecurityPolicy  - The address of applied SMM secure policy.
+
+  @retval EFI_SUCCESS           The policy is indexed.
+  @retval EFI_INVALID_PARAMETER SmmSecurityPolicy is NULL.
+**/
+EFI_STATUS
+EFIAPI
+IhvSmmSaveStatePolicyApplied (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy
+  );
+
 /**
   @brief Given Smm save state address and access width, determine if it is
   allowed to access by parsing the policy
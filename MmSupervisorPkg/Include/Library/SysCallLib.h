@@ -35,28 +35,103 @@ typedef enum {
   SMM_SC_LEGACY_MAX = 0xFFFF,
   // Below is for new supervisor interfaces only,
   // legacy supervisor should not write below this line
-  SMM_REG_HDL_JMP     = 0x10000,
-  SMM_INST_CONF_T     = 0x10001,
-  SMM_ALOC_POOL       = 0x10002,
-  SMM_FREE_POOL       = 0x10003,
-  SMM_ALOC_PAGE       = 0x10004,
-  SMM_FREE_PAGE       = 0x10005,
-  SMM_START_AP_PROC   = 0x10006,
-  SMM_REG_HNDL        = 0x10007,
-  SMM_UNREG_HNDL      = 0x10018,
-  SMM_SET_CPL3_TBL    = 0x10019,
-  SMM_INST_PROT       = 0x1001A,
-  SMM_QRY_HOB         = 0x1001B,
-  SMM_ERR_RPT_JMP     = 0x1001C,
-  SMM_MM_HDL_REG_1    = 0x1001D,
-  SMM_MM_HDL_REG_2    = 0x1001E,
-  SMM_MM_HDL_UNREG_1  = 0x1001F,
-  SMM_MM_HDL_UNREG_2  = 0x10020,
-  SMM_SC_SVST_READ_2  = 0x10021,
-  SMM_MM_UNBLOCKED    = 0x10022,
-  SMM_MM_IS_COMM_BUFF = 0x10023,
+  SMM_REG_HDL_JMP        = 0x10000,
+  SMM_INST_CONF_T        = 0x10001,
+  SMM_ALOC_POOL          = 0x10002,
+  SMM_FREE_POOL          = 0x10003,
+  SMM_ALOC_PAGE          = 0x10004,
+  SMM_FREE_PAGE          = 0x10005,
+  SMM_START_AP_PROC      = 0x10006,
+  SMM_REG_HNDL           = 0x10007,
+  SMM_UNREG_HNDL         = 0x10018,
+  SMM_SET_CPL3_TBL       = 0x10019,
+  SMM_INST_PROT          = 0x1001A,
+  SMM_QRY_HOB            = 0x1001B,
+  SMM_ERR_RPT_JMP        = 0x1001C,
+  SMM_MM_HDL_REG_1       = 0x1001D,
+  SMM_MM_HDL_REG_2       = 0x1001E,
+  SMM_MM_HDL_UNREG_1     = 0x1001F,
+  SMM_MM_HDL_UNREG_2     = 0x10020,
+  SMM_SC_SVST_READ_2     = 0x10021,
+  SMM_MM_UNBLOCKED       = 0x10022,
+  SMM_MM_IS_COMM_BUFF    = 0x10023,
+  SMM_SC_SVST_READ_BATCH = 0x10024,
+  SMM_SC_IO_READ_FIFO    = 0x10025,
+  SMM_SC_IO_WRITE_FIFO   = 0x10026,
+  SMM_MM_UNBLOCKED_VIEW  = 0x10027,
 } SMM_SYS_CALL;
 
+///
+/// Maximal number of requests a single SMM_SC_SVST_READ_BATCH syscall can carry.
+///
+#define SMM_SAVE_STATE_READ_BATCH_MAX_ENTRIES  64
+
+///
+/// One save state read request of a SMM_SC_SVST_READ_BATCH syscall.
+///
+/// The syscall takes the request array in Arg1, the number of requests in Arg2 and the
+/// output buffer in Arg3. The output buffer holds the data of all requests packed in
+/// request order, each request occupying Width bytes. The supervisor writes the result
+/// of each individual read back to Status.
+///
+typedef struct {
+  UINT32    CpuIndex;
+  UINT32    Register;
+  UINT32    Width;
+  UINT32    Reserved;
+  UINT64    Status;
+} SMM_SAVE_STATE_READ_ENTRY;
+
+///
+/// Maximal number of port accesses a single SMM_SC_IO_READ_FIFO or SMM_SC_IO_WRITE_FIFO syscall can carry.
+///
+#define SMM_IO_FIFO_MAX_COUNT  SIZE_4KB
+
+///
+/// Second argument of the SMM_SC_IO_READ_FIFO and SMM_SC_IO_WRITE_FIFO syscalls.
+///
+/// The syscalls take the port in Arg1, the EFI_MM_IO_WIDTH and the number of accesses packed
+/// in Arg2, and the buffer holding Count elements of the access width in Arg3. The port is
+/// checked against the policy once for the whole transfer. They return the EFI_STATUS of the
+/// transfer.
+///
+#define SMM_IO_FIFO_ARG(Width, Count)  (((UINTN)(Count) << 8) | ((UINTN)(Width) & 0xFF))
+#define SMM_IO_FIFO_ARG_WIDTH(Arg)     ((UINTN)(Arg) & 0xFF)
+#define SMM_IO_FIFO_ARG_COUNT(Arg)     ((UINTN)(Arg) >> 8)
+
+///
+/// One range of the unblocked region view, covering [Start, End).
+///
+typedef struct {
+  UINT64    Start;
+  UINT64    End;
+} SMM_UNBLOCKED_VIEW_RANGE;
+
+///
+/// Read only view of the buffers ring 3 may use, published by the supervisor in a single page
+/// whose address SMM_MM_UNBLOCKED_VIEW returns.
+///
+/// Generation is 0 until the view is first published, and odd while the supervisor updates it.
+/// Range holds MmramCount MMRAM ranges followed by UnblockedCount user unblocked regions, each
+/// part sorted by Start. MMRAM ranges are coalesced, unblocked regions are kept as requested and
+/// never overlap. When SMM_UNBLOCKED_VIEW_INCOMPLETE is set, the regions could not all be
+/// described and buffers have to be checked through SMM_MM_UNBLOCKED.
+///
+typedef struct {
+  volatile UINT64             Generation;
+  UINT64                      CommBufferStart;
+  UINT64                      CommBufferEnd;
+  UINT32                      Flags;
+  UINT32                      MmramCount;
+  UINT32                      UnblockedCount;
+  UINT32                      Reserved;
+  SMM_UNBLOCKED_VIEW_RANGE    Range[1];
+} SMM_UNBLOCKED_VIEW;
+
+#define SMM_UNBLOCKED_VIEW_INCOMPLETE  BIT0
+
+#define SMM_UNBLOCKED_VIEW_MAX_RANGES  ((SIZE_4KB - OFFSET_OF (SMM_UNBLOCKED_VIEW, Range)) / sizeof (SMM_UNBLOCKED_VIEW_RANGE))
+
 UINT64
 EFIAPI
 SysCall (
@@ -17,7 +17,10 @@
     0x10b5eea9, 0xbe0d, 0x4f11, { 0x86, 0x36, 0x1c, 0xb7, 0xa, 0xa3, 0xba, 0x6d } \
   }
 
-#define MM_UNBLOCK_REQUEST_PROTOCOL_VERSION  1
+//
+// Version 2 adds RequestUnblockPagesBatch.
+//
+#define MM_UNBLOCK_REQUEST_PROTOCOL_VERSION  2
 
 typedef struct _MM_SUPERVISOR_UNBLOCK_MEMORY_PROTOCOL MM_SUPERVISOR_UNBLOCK_MEMORY_PROTOCOL;
 
@@ -53,10 +56,51 @@ EFI_STATUS
   IN CONST EFI_GUID         *IdentifierGuid
   );
 
+/**
+  One region of a batched unblock request.
+
+**/
+typedef struct {
+  EFI_PHYSICAL_ADDRESS    UnblockAddress;   // IN: page aligned address of the region
+  UINT64                  NumberOfPages;    // IN: size of the region in pages
+  EFI_STATUS              Status;           // OUT: status of unblocking this region
+} MM_SUPERVISOR_UNBLOCK_REGION;
+
+/**
+  This API provides a way to unblock several regions of data pages with a single request.
+
+  Every region is subject to the same requirements as with RequestUnblockPages. The regions
+  are evaluated against a single snapshot of the memory map and conveyed to MM supervisor
+  together, which processes them in order. The status of each region is reported in its
+  Status field, and a failing region does not prevent the others from being unblocked.
+
+  @param  Regions                 The regions to unblock, along with their returned status.
+  @param  RegionCount             The number of regions.
+  @param  IdentifierGuid          The unique caller ID from requester.
+
+  @return EFI_SUCCESS             All regions are unblocked successfully.
+  @return EFI_INVALID_PARAMETER   Regions or caller ID is NULL pointer.
+  @return EFI_ACCESS_DENIED       The request is rejected by MM supervisor due to memory map is
+                                  locked down.
+  @return EFI_NOT_READY           The request cannot be processed due to the MM communicate
+                                  foundation is not ready.
+  @return EFI_OUT_OF_RESOURCES    Cannot prepare enough memory resource for communication.
+  @return Others                  The status of the first region that failed to be unblocked.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *REQUEST_UNBLOCK_PAGES_BATCH)(
+  IN OUT MM_SUPERVISOR_UNBLOCK_REGION   *Regions,
+  IN     UINTN                          RegionCount,
+  IN     CONST EFI_GUID                 *IdentifierGuid
+  );
+
 #pragma pack (1)
 struct _MM_SUPERVISOR_UNBLOCK_MEMORY_PROTOCOL {
-  UINTN                   Version;
-  REQUEST_UNBLOCK_PAGE    RequestUnblockPages;
+  UINTN                          Version;
+  REQUEST_UNBLOCK_PAGE           RequestUnblockPages;
+  REQUEST_UNBLOCK_PAGES_BATCH    RequestUnblockPagesBatch;   // Version 2 and above
 };
 
 #pragma pack ()
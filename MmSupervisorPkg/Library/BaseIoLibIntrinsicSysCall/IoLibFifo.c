@@ -2,12 +2,66 @@
   IoFifo read/write routines.
 
   Copyright (c) 2021 - 2023, Intel Corporation. All rights reserved.<BR>
+  Copyright (C) Microsoft Corporation.<BR>
   SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
 
 #include "BaseIoLibIntrinsicInternal.h"
 #include <Uefi/UefiBaseType.h>
+#include <Library/SysCallLib.h>
+#include <Protocol/MmCpuIo.h>
+
+/**
+  Transfer a block of memory from or to an I/O port fifo through the supervisor.
+
+  The transfer is split in syscalls of at most SMM_IO_FIFO_MAX_COUNT port accesses, and the
+  supervisor checks the port against the policy once per syscall. A denied syscall leaves its
+  part of the buffer untouched, and stops the transfer.
+
+  @param  CallIndex    SMM_SC_IO_READ_FIFO or SMM_SC_IO_WRITE_FIFO.
+  @param  Port         The I/O port.
+  @param  Width        The width of each port access.
+  @param  ElementSize  The size, in bytes, of each port access.
+  @param  Count        The number of times to access the I/O port.
+  @param  Buffer       The buffer to store the read data into or retrieve the write data from.
+
+**/
+STATIC
+VOID
+IoFifoSysCall (
+  IN      UINTN            CallIndex,
+  IN      UINTN            Port,
+  IN      EFI_MM_IO_WIDTH  Width,
+  IN      UINTN            ElementSize,
+  IN      UINTN            Count,
+  IN OUT  VOID             *Buffer
+  )
+{
+  UINTN       Chunk;
+  EFI_STATUS  Status;
+
+  while (Count > 0) {
+    Chunk  = MIN (Count, SMM_IO_FIFO_MAX_COUNT);
+    Status = (EFI_STATUS)SysCall (CallIndex, Port, SMM_IO_FIFO_ARG (Width, Chunk), (UINTN)Buffer);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((
+        DEBUG_ERROR,
+        "%a IO FIFO %a of port 0x%x with width type %d denied - %r\n",
+        __func__,
+        (CallIndex == SMM_SC_IO_WRITE_FIFO) ? "write" : "read",
+        Port,
+        Width,
+        Status
+        ));
+      ASSERT_EFI_ERROR (Status);
+      return;
+    }
+
+    Buffer = (UINT8 *)Buffer + Chunk * ElementSize;
+    Count -= Chunk;
+  }
+}
 
 /**
   Reads an 8-bit I/O port fifo into a block of memory.
@@ -21,7 +75,8 @@
 
   If 8-bit I/O port operations are not supported, then ASSERT().
 
-  In TDX a serial of TdIoRead8 is invoked to read the I/O port fifo.
+  In ring 3 the port is read by the supervisor, in syscalls of at most
+  SMM_IO_FIFO_MAX_COUNT reads.
 
   @param  Port    The I/O port to read.
   @param  Count   The number of times to read I/O port.
@@ -36,12 +91,7 @@ IoReadFifo8 (
   OUT     VOID   *Buffer
   )
 {
-  UINT8  *Buffer8;
-
-  Buffer8 = (UINT8 *)Buffer;
-  while (Count-- > 0) {
-    *Buffer8++ = IoRead8 (Port);
-  }
+  IoFifoSysCall (SMM_SC_IO_READ_FIFO, Port, MM_IO_UINT8, sizeof (UINT8), Count, Buffer);
 }
 
 /**
@@ -56,7 +106,8 @@ IoReadFifo8 (
 
   If 8-bit I/O port operations are not supported, then ASSERT().
 
-  In TDX a serial of TdIoWrite8 is invoked to write data to the I/O port.
+  In ring 3 the port is written by the supervisor, in syscalls of at most
+  SMM_IO_FIFO_MAX_COUNT writes.
 
   @param  Port    The I/O port to write.
   @param  Count   The number of times to write I/O port.
@@ -71,12 +122,7 @@ IoWriteFifo8 (
   IN      VOID   *Buffer
   )
 {
-  UINT8  *Buffer8;
-
-  Buffer8 = (UINT8 *)Buffer;
-  while (Count-- > 0) {
-    IoWrite8 (Port, *Buffer8++);
-  }
+  IoFifoSysCall (SMM_SC_IO_WRITE_FIFO, Port, MM_IO_UINT8, sizeof (UINT8), Count, Buffer);
 }
 
 /**
@@ -91,7 +137,8 @@ IoWriteFifo8 (
 
   If 16-bit I/O port operations are not supported, then ASSERT().
 
-  In TDX a serial of TdIoRead16 is invoked to read data from the I/O port.
+  In ring 3 the port is read by the supervisor, in syscalls of at most
+  SMM_IO_FIFO_MAX_COUNT reads.
 
   @param  Port    The I/O port to read.
   @param  Count   The number of times to read I/O port.
@@ -106,12 +153,7 @@ IoReadFifo16 (
   OUT     VOID   *Buffer
   )
 {
-  UINT16  *Buffer16;
-
-  Buffer16 = (UINT16 *)Buffer;
-  while (Count-- > 0) {
-    *Buffer16++ = IoRead16 (Port);
-  }
+  IoFifoSysCall (SMM_SC_IO_READ_FIFO, Port, MM_IO_UINT16, sizeof (UINT16), Count, Buffer);
 }
 
 /**
@@ -126,7 +168,8 @@ IoReadFifo16 (
 
   If 16-bit I/O port operations are not supported, then ASSERT().
 
-  In TDX a serial of TdIoWrite16 is invoked to write data to the I/O port.
+  In ring 3 the port is written by the supervisor, in syscalls of at most
+  SMM_IO_FIFO_MAX_COUNT writes.
 
   @param  Port    The I/O port to write.
   @param  Count   The number of times to write I/O port.
@@ -141,12 +184,7 @@ IoWriteFifo16 (
   IN      VOID   *Buffer
   )
 {
-  UINT16  *Buffer16;
-
-  Buffer16 = (UINT16 *)Buffer;
-  while (Count-- > 0) {
-    IoWrite16 (Port, *Buffer16++);
-  }
+  IoFifoSysCall (SMM_SC_IO_WRITE_FIFO, Port, MM_IO_UINT16, sizeof (UINT16), Count, Buffer);
 }
 
 /**
@@ -161,7 +199,8 @@ IoWriteFifo16 (
 
   If 32-bit I/O port operations are not supported, then ASSERT().
 
-  In TDX a serial of TdIoRead32 is invoked to read data from the I/O port.
+  In ring 3 the port is read by the supervisor, in syscalls of at most
+  SMM_IO_FIFO_MAX_COUNT reads.
 
   @param  Port    The I/O port to read.
   @param  Count   The number of times to read I/O port.
@@ -176,12 +215,7 @@ IoReadFifo32 (
   OUT     VOID   *Buffer
   )
 {
-  UINT32  *Buffer32;
-
-  Buffer32 = (UINT32 *)Buffer;
-  while (Count-- > 0) {
-    *Buffer32++ = IoRead32 (Port);
-  }
+  IoFifoSysCall (SMM_SC_IO_READ_FIFO, Port, MM_IO_UINT32, sizeof (UINT32), Count, Buffer);
 }
 
 /**
@@ -196,7 +230,8 @@ IoReadFifo32 (
 
   If 32-bit I/O port operations are not supported, then ASSERT().
 
-  In TDX a serial of TdIoWrite32 is invoked to write data to the I/O port.
+  In ring 3 the port is written by the supervisor, in syscalls of at most
+  SMM_IO_FIFO_MAX_COUNT writes.
 
   @param  Port    The I/O port to write.
   @param  Count   The number of times to write I/O port.
@@ -211,10 +246,5 @@ IoWriteFifo32 (
   IN      VOID   *Buffer
   )
 {
-  UINT32  *Buffer32;
-
-  Buffer32 = (UINT32 *)Buffer;
-  while (Count-- > 0) {
-    IoWrite32 (Port, *Buffer32++);
-  }
+  IoFifoSysCall (SMM_SC_IO_WRITE_FIFO, Port, MM_IO_UINT32, sizeof (UINT32), Count, Buffer);
 }
@@ -553,6 +553,98 @@ InternalAsciiHexCharToUintn (
   IN      CHAR8  Char
   );
 
+//
+// CRC functions
+//
+
+//
+// Processor features reported by InternalCrcGetHwSupport ().
+//
+#define CRC_HW_SUPPORT_SSE42   BIT0
+#define CRC_HW_SUPPORT_PCLMUL  BIT1
+
+//
+// Implementations of the CRC routines in CheckSum.c.
+//
+typedef enum {
+  CrcPathBytewise,
+  CrcPathSliceBy8,
+  CrcPathHardware
+} CRC_PATH;
+
+/**
+  Returns the processor features that accelerate the CRC routines.
+
+  CPUID is only queried on the first call, later calls return the cached result.
+
+  @return A bit mask of CRC_HW_SUPPORT_SSE42 and CRC_HW_SUPPORT_PCLMUL.
+
+**/
+UINT32
+InternalCrcGetHwSupport (
+  VOID
+  );
+
+/**
+  Updates a raw CRC32 (ITU-T V.42) value with the bytes of a buffer.
+
+  @param[in]  Crc          The running CRC value, without the final inversion.
+  @param[in]  Buffer       A pointer to the bytes to add to the CRC.
+  @param[in]  Length       The number of bytes in Buffer.
+  @param[in]  Path         The implementation used to compute the CRC. CrcPathHardware
+                           requires CRC_HW_SUPPORT_PCLMUL.
+
+  @return The updated CRC value.
+
+**/
+UINT32
+InternalCrc32Update (
+  IN UINT32      Crc,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length,
+  IN CRC_PATH    Path
+  );
+
+/**
+  Updates a raw CRC32c value with the bytes of a buffer.
+
+  @param[in]  Crc          The running CRC value, without the final inversion.
+  @param[in]  Buffer       A pointer to the bytes to add to the CRC.
+  @param[in]  Length       The number of bytes in Buffer.
+  @param[in]  Path         The implementation used to compute the CRC. CrcPathHardware
+                           requires CRC_HW_SUPPORT_SSE42.
+
+  @return The updated CRC value.
+
+**/
+UINT32
+InternalCrc32cUpdate (
+  IN UINT32      Crc,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length,
+  IN CRC_PATH    Path
+  );
+
+/**
+  Updates a CRC16-ANSI value with the bytes of a buffer.
+
+  @param[in]  Crc          The running CRC value.
+  @param[in]  Buffer       A pointer to the bytes to add to the CRC.
+  @param[in]  Length       The number of bytes in Buffer.
+  @param[in]  Path         The implementation used to compute the CRC. There is no
+                           hardware implementation, CrcPathHardware selects the tables.
+
+  @return The updated CRC value.
+
+**/
+UINT16
+InternalCrc16AnsiUpdate (
+  IN UINT16      Crc,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length,
+  IN CRC_PATH    Path
+  );
+
 //
 // Ia32 and x64 specific functions
 //
@@ -850,6 +942,47 @@ InternalX86RdRand64  (
   OUT     UINT64  *Rand
   );
 
+/**
+  Updates a raw CRC32c value with the bytes of a buffer through the SSE4.2 CRC32
+  instruction. This function is only available on x64.
+
+  @param[in]  Crc          The running CRC value, without the final inversion.
+  @param[in]  Buffer       A pointer to the bytes to add to the CRC.
+  @param[in]  Length       The number of bytes in Buffer.
+
+  @return The updated CRC value.
+
+**/
+UINT32
+EFIAPI
+InternalCrc32cSse42 (
+  IN      UINT32      Crc,
+  IN      CONST VOID  *Buffer,
+  IN      UINTN       Length
+  );
+
+/**
+  Updates a raw CRC32 value with the bytes of a buffer by folding it with the
+  PCLMULQDQ instruction. This function is only available on x64.
+
+  Buffer must be 16 byte aligned and Length must be a multiple of 16 that is at
+  least 64.
+
+  @param[in]  Crc          The running CRC value, without the final inversion.
+  @param[in]  Buffer       A pointer to the bytes to add to the CRC.
+  @param[in]  Length       The number of bytes in Buffer.
+
+  @return The updated CRC value.
+
+**/
+UINT32
+EFIAPI
+InternalCrc32Pclmul (
+  IN      UINT32      Crc,
+  IN      CONST VOID  *Buffer,
+  IN      UINTN       Length
+  );
+
 #else
 
 #endif
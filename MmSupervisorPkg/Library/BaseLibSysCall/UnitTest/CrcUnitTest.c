@@ -0,0 +1,532 @@
+/** @file
+  Unit tests of the CRC routines in the MmSupervisorPkg instance of BaseLib
+
+  Every implementation of CRC32, CRC32c and CRC16-ANSI is checked against a
+  bit-serial reference over random lengths and buffer alignments, and the
+  throughput of each implementation is reported.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../BaseLibInternals.h"
+
+#define UNIT_TEST_APP_NAME     "BaseLibSysCall CRC Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Reflected polynomials of the CRCs under test.
+//
+#define CRC32_POLYNOMIAL       0xEDB88320
+#define CRC32C_POLYNOMIAL      0x82F63B78
+#define CRC16_ANSI_POLYNOMIAL  0xA001
+
+//
+// Random buffers are taken from a pool of this size at offsets below TEST_MAX_OFFSET.
+//
+#define TEST_POOL_SIZE         (SIZE_64KB + TEST_MAX_OFFSET)
+#define TEST_MAX_OFFSET        64
+#define TEST_ITERATIONS        2000
+#define TEST_LONG_BUFFER_RATE  8
+
+//
+// The benchmark checksums TEST_BENCHMARK_SIZE bytes TEST_BENCHMARK_ROUNDS times per implementation.
+//
+#define TEST_BENCHMARK_SIZE    SIZE_64KB
+#define TEST_BENCHMARK_ROUNDS  256
+
+typedef struct {
+  CRC_PATH       Path;
+  CONST CHAR8    *Name;
+  UINT32         RequiredSupport;
+} TEST_CRC_PATH;
+
+STATIC CONST TEST_CRC_PATH  mCrc32Paths[] = {
+  { CrcPathBytewise, "Bytewise", 0                     },
+  { CrcPathSliceBy8, "SliceBy8", 0                     },
+  { CrcPathHardware, "Pclmul",   CRC_HW_SUPPORT_PCLMUL }
+};
+
+STATIC CONST TEST_CRC_PATH  mCrc32cPaths[] = {
+  { CrcPathBytewise, "Bytewise", 0                    },
+  { CrcPathSliceBy8, "SliceBy8", 0                    },
+  { CrcPathHardware, "Sse42",    CRC_HW_SUPPORT_SSE42 }
+};
+
+STATIC CONST TEST_CRC_PATH  mCrc16Paths[] = {
+  { CrcPathBytewise, "Bytewise", 0 },
+  { CrcPathSliceBy8, "SliceBy8", 0 }
+};
+
+typedef struct {
+  UINT8    *Pool;
+} TEST_CONTEXT_CRC;
+
+/**
+  Bit-serial reference implementation of a reflected CRC of up to 32 bits.
+
+  @param[in]  Polynomial   The reflected polynomial of the CRC.
+  @param[in]  Crc          The running CRC value.
+  @param[in]  Buffer       A pointer to the bytes to add to the CRC.
+  @param[in]  Length       The number of bytes in Buffer.
+
+  @return The updated CRC value.
+
+**/
+STATIC
+UINT32
+ReferenceCrc (
+  IN UINT32       Polynomial,
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  UINTN  Bit;
+
+  while (Length-- != 0) {
+    Crc ^= *(Buffer++);
+    for (Bit = 0; Bit < 8; Bit++) {
+      Crc = ((Crc & 1) != 0) ? ((Crc >> 1) ^ Polynomial) : (Crc >> 1);
+    }
+  }
+
+  return Crc;
+}
+
+/**
+  Returns TRUE if the processor running the test supports a CRC implementation.
+
+  @param[in]  Path    The implementation to check.
+
+**/
+STATIC
+BOOLEAN
+IsPathSupported (
+  IN CONST TEST_CRC_PATH  *Path
+  )
+{
+  return (BOOLEAN)((InternalCrcGetHwSupport () & Path->RequiredSupport) == Path->RequiredSupport);
+}
+
+/**
+  Returns a random buffer length. Every TEST_LONG_BUFFER_RATE lengths one is long enough to
+  exercise the bulk loops, the others exercise the head and tail handling.
+
+  @param[in]  Iteration   The test iteration.
+
+**/
+STATIC
+UINTN
+RandomLength (
+  IN UINTN  Iteration
+  )
+{
+  if ((Iteration % TEST_LONG_BUFFER_RATE) == 0) {
+    return (UINTN)rand () % SIZE_64KB;
+  }
+
+  return (UINTN)rand () % 300;
+}
+
+/*
+  Helper function to allocate a pool of random bytes.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+CreateRandomPool (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_CRC  *CrcCntx;
+  UINTN             Index;
+
+  CrcCntx       = (TEST_CONTEXT_CRC *)Context;
+  CrcCntx->Pool = AllocatePool (TEST_POOL_SIZE);
+  UT_ASSERT_NOT_NULL (CrcCntx->Pool);
+
+  srand (0x5EED);
+  for (Index = 0; Index < TEST_POOL_SIZE; Index++) {
+    CrcCntx->Pool[Index] = (UINT8)rand ();
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Helper function to free the pool of random bytes.
+*/
+VOID
+EFIAPI
+FreeRandomPool (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_CRC  *CrcCntx;
+
+  CrcCntx = (TEST_CONTEXT_CRC *)Context;
+  if (CrcCntx->Pool != NULL) {
+    FreePool (CrcCntx->Pool);
+    CrcCntx->Pool = NULL;
+  }
+}
+
+/**
+  Unit test for the public CRC routines against well known check values.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CrcCheckValues (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CHAR8  Check[] = "123456789";
+
+  UT_ASSERT_EQUAL (CalculateCrc32 (Check, 9), 0xCBF43926);
+  UT_ASSERT_EQUAL (CalculateCrc32c (Check, 9, 0), 0xE3069283);
+  UT_ASSERT_EQUAL (CalculateCrc16Ansi (Check, 9, 0), 0xBB3D);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for every CRC32 implementation against the reference.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Crc32PathsMatchReference (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_CRC  *CrcCntx;
+  UINTN             Iteration;
+  UINTN             PathIndex;
+  UINT8             *Buffer;
+  UINTN             Length;
+  UINT32            Seed;
+  UINT32            Expected;
+
+  CrcCntx = (TEST_CONTEXT_CRC *)Context;
+
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    Buffer   = CrcCntx->Pool + (UINTN)rand () % TEST_MAX_OFFSET;
+    Length   = RandomLength (Iteration);
+    Seed     = (UINT32)rand ();
+    Expected = ReferenceCrc (CRC32_POLYNOMIAL, Seed, Buffer, Length);
+    for (PathIndex = 0; PathIndex < ARRAY_SIZE (mCrc32Paths); PathIndex++) {
+      if (!IsPathSupported (&mCrc32Paths[PathIndex])) {
+        continue;
+      }
+
+      UT_ASSERT_EQUAL (InternalCrc32Update (Seed, Buffer, Length, mCrc32Paths[PathIndex].Path), Expected);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for every CRC32c implementation against the reference.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Crc32cPathsMatchReference (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_CRC  *CrcCntx;
+  UINTN             Iteration;
+  UINTN             PathIndex;
+  UINT8             *Buffer;
+  UINTN             Length;
+  UINT32            Seed;
+  UINT32            Expected;
+
+  CrcCntx = (TEST_CONTEXT_CRC *)Context;
+
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    Buffer   = CrcCntx->Pool + (UINTN)rand () % TEST_MAX_OFFSET;
+    Length   = RandomLength (Iteration);
+    Seed     = (UINT32)rand ();
+    Expected = ReferenceCrc (CRC32C_POLYNOMIAL, Seed, Buffer, Length);
+    for (PathIndex = 0; PathIndex < ARRAY_SIZE (mCrc32cPaths); PathIndex++) {
+      if (!IsPathSupported (&mCrc32cPaths[PathIndex])) {
+        continue;
+      }
+
+      UT_ASSERT_EQUAL (InternalCrc32cUpdate (Seed, Buffer, Length, mCrc32cPaths[PathIndex].Path), Expected);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for every CRC16-ANSI implementation against the reference.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Crc16AnsiPathsMatchReference (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_CRC  *CrcCntx;
+  UINTN             Iteration;
+  UINTN             PathIndex;
+  UINT8             *Buffer;
+  UINTN             Length;
+  UINT16            Seed;
+  UINT16            Expected;
+
+  CrcCntx = (TEST_CONTEXT_CRC *)Context;
+
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    Buffer   = CrcCntx->Pool + (UINTN)rand () % TEST_MAX_OFFSET;
+    Length   = RandomLength (Iteration);
+    Seed     = (UINT16)rand ();
+    Expected = (UINT16)ReferenceCrc (CRC16_ANSI_POLYNOMIAL, Seed, Buffer, Length);
+    for (PathIndex = 0; PathIndex < ARRAY_SIZE (mCrc16Paths); PathIndex++) {
+      UT_ASSERT_EQUAL (InternalCrc16AnsiUpdate (Seed, Buffer, Length, mCrc16Paths[PathIndex].Path), Expected);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Returns the throughput of a CRC implementation in MB/s.
+
+  @param[in]  Buffer      The buffer to checksum.
+  @param[in]  Is32c       TRUE to measure CRC32c, FALSE to measure CRC32.
+  @param[in]  Path        The implementation to measure.
+
+**/
+STATIC
+UINT64
+MeasureThroughput (
+  IN CONST UINT8  *Buffer,
+  IN BOOLEAN      Is32c,
+  IN CRC_PATH     Path
+  )
+{
+  struct timespec  Start;
+  struct timespec  End;
+  UINT64           ElapsedNs;
+  UINTN            Round;
+  volatile UINT32  Sink;
+
+  Sink = 0;
+  timespec_get (&Start, TIME_UTC);
+  for (Round = 0; Round < TEST_BENCHMARK_ROUNDS; Round++) {
+    if (Is32c) {
+      Sink ^= InternalCrc32cUpdate ((UINT32)Round, Buffer, TEST_BENCHMARK_SIZE, Path);
+    } else {
+      Sink ^= InternalCrc32Update ((UINT32)Round, Buffer, TEST_BENCHMARK_SIZE, Path);
+    }
+  }
+
+  timespec_get (&End, TIME_UTC);
+
+  ElapsedNs = (UINT64)(End.tv_sec - Start.tv_sec) * 1000000000ULL + (UINT64)End.tv_nsec - (UINT64)Start.tv_nsec;
+  if (ElapsedNs == 0) {
+    ElapsedNs = 1;
+  }
+
+  //
+  // Bytes per nanosecond times 1000 is MB/s.
+  //
+  return ((UINT64)TEST_BENCHMARK_SIZE * TEST_BENCHMARK_ROUNDS * 1000) / ElapsedNs;
+}
+
+/**
+  Throughput benchmark of the CRC32 and CRC32c implementations.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CrcThroughputBenchmark (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_CRC  *CrcCntx;
+  UINTN             PathIndex;
+
+  CrcCntx = (TEST_CONTEXT_CRC *)Context;
+
+  for (PathIndex = 0; PathIndex < ARRAY_SIZE (mCrc32Paths); PathIndex++) {
+    if (IsPathSupported (&mCrc32Paths[PathIndex])) {
+      UT_LOG_INFO (
+        "CRC32 %a: %ld MB/s\n",
+        mCrc32Paths[PathIndex].Name,
+        MeasureThroughput (CrcCntx->Pool, FALSE, mCrc32Paths[PathIndex].Path)
+        );
+    }
+  }
+
+  for (PathIndex = 0; PathIndex < ARRAY_SIZE (mCrc32cPaths); PathIndex++) {
+    if (IsPathSupported (&mCrc32cPaths[PathIndex])) {
+      UT_LOG_INFO (
+        "CRC32c %a: %ld MB/s\n",
+        mCrc32cPaths[PathIndex].Name,
+        MeasureThroughput (CrcCntx->Pool, TRUE, mCrc32cPaths[PathIndex].Path)
+        );
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  CRC routines and run the CRC unit test.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      CrcTests;
+  TEST_CONTEXT_CRC            CrcContext;
+
+  Framework       = NULL;
+  CrcContext.Pool = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the CRC Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&CrcTests, Framework, "BaseLibSysCall CRC Tests", "BaseLibSysCall.Crc", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for CrcTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (CrcTests, "CRC routines should produce the standard check values", "CheckValues", CrcCheckValues, NULL, NULL, NULL);
+  AddTestCase (CrcTests, "Every CRC32 implementation should match the reference", "Crc32", Crc32PathsMatchReference, CreateRandomPool, FreeRandomPool, &CrcContext);
+  AddTestCase (CrcTests, "Every CRC32c implementation should match the reference", "Crc32c", Crc32cPathsMatchReference, CreateRandomPool, FreeRandomPool, &CrcContext);
+  AddTestCase (CrcTests, "Every CRC16-ANSI implementation should match the reference", "Crc16Ansi", Crc16AnsiPathsMatchReference, CreateRandomPool, FreeRandomPool, &CrcContext);
+  AddTestCase (CrcTests, "Report the throughput of every CRC implementation", "Benchmark", CrcThroughputBenchmark, CreateRandomPool, FreeRandomPool, &CrcContext);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
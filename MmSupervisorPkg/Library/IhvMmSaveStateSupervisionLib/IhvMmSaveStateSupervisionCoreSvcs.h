@@ -33,4 +33,15 @@ SmmReadSaveState (
   OUT VOID                       *Buffer
   );
 
+/**
+  Get the sequence number of the current MMI.
+
+  @return The number of MMIs entered so far, 0 before the first MMI.
+
+**/
+UINT64
+MmGetSmiSequence (
+  VOID
+  );
+
 #endif // IHV_MM_SAVE_STATE_CORE_SVCS_H_
@@ -13,12 +13,148 @@
 
 #include <Protocol/MmCpu.h>
 
+#include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/PcdLib.h>
 #include <Library/IhvSmmSaveStateSupervisionLib.h>
 
 #include "IhvMmSaveStateSupervisionCoreSvcs.h"
 
+//
+// IO information of one CPU, decoded during the MMI whose sequence number is SmiSequence.
+//
+typedef struct {
+  UINT64                       SmiSequence;
+  EFI_STATUS                   Status;
+  EFI_MM_SAVE_STATE_IO_INFO    IoInfo;
+} IHV_SAVE_STATE_IO_SNAPSHOT;
+
+//
+// Save state descriptors of a policy, indexed by MapField. DescriptorIndex is the position of
+// the first descriptor of every MapField in the policy, or the descriptor count without one.
+//
+typedef struct {
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0                     *Policy;
+  SMM_SUPV_POLICY_ROOT_V1                              *PolicyRoot;
+  SMM_SUPV_SECURE_POLICY_SAVE_STATE_DESCRIPTOR_V1_0    *Descriptor[SECURE_POLICY_SVST_COUNT];
+  UINT32                                               DescriptorIndex[SECURE_POLICY_SVST_COUNT];
+} IHV_SAVE_STATE_POLICY_TABLE;
+
+IHV_SAVE_STATE_IO_SNAPSHOT   mIoSnapshot[FixedPcdGet32 (PcdCpuMaxLogicalProcessorNumber)];
+IHV_SAVE_STATE_POLICY_TABLE  mPolicyTable;
+
+/**
+  Index the save state descriptors of a policy by MapField.
+
+  @param SmmSecurityPolicy  - The address of the policy to index.
+**/
+STATIC
+VOID
+BuildPolicyTable (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy
+  )
+{
+  SMM_SUPV_SECURE_POLICY_SAVE_STATE_DESCRIPTOR_V1_0  *SvstDescriptor;
+  SMM_SUPV_POLICY_ROOT_V1                            *PolicyRoot;
+  UINT32                                             i;
+
+  ZeroMem (&mPolicyTable, sizeof (mPolicyTable));
+
+  PolicyRoot = (SMM_SUPV_POLICY_ROOT_V1 *)((UINTN)SmmSecurityPolicy + SmmSecurityPolicy->PolicyRootOffset);
+  for (i = 0; i < SmmSecurityPolicy->PolicyRootCount; i++) {
+    if (PolicyRoot[i].Type == SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_SAVE_STATE) {
+      mPolicyTable.PolicyRoot = &PolicyRoot[i];
+      break;
+    }
+  }
+
+  if (mPolicyTable.PolicyRoot != NULL) {
+    mPolicyTable.DescriptorIndex[SECURE_POLICY_SVST_RAX]     = mPolicyTable.PolicyRoot->Count;
+    mPolicyTable.DescriptorIndex[SECURE_POLICY_SVST_IO_TRAP] = mPolicyTable.PolicyRoot->Count;
+
+    SvstDescriptor = (SMM_SUPV_SECURE_POLICY_SAVE_STATE_DESCRIPTOR_V1_0 *)((UINTN)SmmSecurityPolicy + mPolicyTable.PolicyRoot->Offset);
+    for (i = 0; i < mPolicyTable.PolicyRoot->Count; i++) {
+      //
+      // Only the first descriptor of a MapField is ever evaluated.
+      //
+      if ((SvstDescriptor[i].MapField < SECURE_POLICY_SVST_COUNT) &&
+          (mPolicyTable.Descriptor[SvstDescriptor[i].MapField] == NULL))
+      {
+        mPolicyTable.Descriptor[SvstDescriptor[i].MapField]      = &SvstDescriptor[i];
+        mPolicyTable.DescriptorIndex[SvstDescriptor[i].MapField] = i;
+      }
+    }
+  }
+
+  mPolicyTable.Policy = SmmSecurityPolicy;
+}
+
+/**
+  @brief Prepare the save state supervision for a newly applied policy.
+
+  The save state descriptors of the policy are indexed by MapField, so that every later
+  access check looks its descriptor up directly.
+
+  @param SmmSecurityPolicy  - The address of applied SMM secure policy.
+
+  @retval EFI_SUCCESS           The policy is indexed.
+  @retval EFI_INVALID_PARAMETER SmmSecurityPolicy is NULL.
+**/
+EFI_STATUS
+EFIAPI
+IhvSmmSaveStatePolicyApplied (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy
+  )
+{
+  if (SmmSecurityPolicy == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  BuildPolicyTable (SmmSecurityPolicy);
+  return EFI_SUCCESS;
+}
+
+/**
+  @brief Read the IO information of a CPU, decoding its save state at most once per MMI.
+
+  @param CpuIndex           - Cpu index requested.
+  @param IoInfo             - Pointer to the IoInfo of the CPU.
+
+  @retval EFI_SUCCESS   The IoInfo is returned.
+  @retval Others        The save state read of the IoInfo failed.
+**/
+STATIC
+EFI_STATUS
+GetIoInfo (
+  IN  UINTN                      CpuIndex,
+  OUT EFI_MM_SAVE_STATE_IO_INFO  *IoInfo
+  )
+{
+  IHV_SAVE_STATE_IO_SNAPSHOT  *Snapshot;
+  UINT64                      SmiSequence;
+  EFI_STATUS                  Status;
+
+  //
+  // Nothing is cached outside of MMIs.
+  //
+  SmiSequence = MmGetSmiSequence ();
+  if ((SmiSequence == 0) || (CpuIndex >= ARRAY_SIZE (mIoSnapshot))) {
+    return SmmReadSaveState (NULL, sizeof (*IoInfo), EFI_MM_SAVE_STATE_REGISTER_IO, CpuIndex, IoInfo);
+  }
+
+  Snapshot = &mIoSnapshot[CpuIndex];
+  if (Snapshot->SmiSequence != SmiSequence) {
+    Status = SmmReadSaveState (NULL, sizeof (Snapshot->IoInfo), EFI_MM_SAVE_STATE_REGISTER_IO, CpuIndex, &Snapshot->IoInfo);
+    Snapshot->Status = Status;
+    MemoryFence ();
+    Snapshot->SmiSequence = SmiSequence;
+  }
+
+  CopyMem (IoInfo, &Snapshot->IoInfo, sizeof (*IoInfo));
+  return Snapshot->Status;
+}
+
 /**
   @brief Determine if access condition given policy matches current MMI scenario.
 
@@ -52,7 +188,7 @@ InspectReadCondition (
 
   // Grab IoInfo for this CpuIndex, we will need it to determine access later
   // But we are executing on supervisor stack, no need to worry about info leakage
-  Status = SmmReadSaveState (NULL, sizeof (*IoInfo), EFI_MM_SAVE_STATE_REGISTER_IO, CpuIndex, IoInfo);
+  Status = GetIoInfo (CpuIndex, IoInfo);
   if (EFI_ERROR (Status)) {
     // Cannot get IoInfo, possible due to this CpuIndex has incorrect type, or invalid SMI flag
     return Status;
@@ -151,15 +287,12 @@ IsIhvSmmSaveStateReadAllowed (
     goto Exit;
   }
 
-  PolicyRoot = (SMM_SUPV_POLICY_ROOT_V1 *)((UINTN)SmmSecurityPolicy + SmmSecurityPolicy->PolicyRootOffset);
-  for (i = 0; i < SmmSecurityPolicy->PolicyRootCount; i++) {
-    if (PolicyRoot[i].Type == SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_SAVE_STATE) {
-      PolicyRoot = &PolicyRoot[i];
-      break;
-    }
+  if (mPolicyTable.Policy != SmmSecurityPolicy) {
+    BuildPolicyTable (SmmSecurityPolicy);
   }
 
-  if (i >= SmmSecurityPolicy->PolicyRootCount) {
+  PolicyRoot = mPolicyTable.PolicyRoot;
+  if (PolicyRoot == NULL) {
     DEBUG ((DEBUG_WARN, "%a No policy root found for save state, this is level 20 policy. Allow all read access!\n", __func__));
     return EFI_SUCCESS;
   }
@@ -177,63 +310,55 @@ IsIhvSmmSaveStateReadAllowed (
       return EFI_SUCCESS;
     // MU_CHANGE Ends.
     default:
+      i = PolicyRoot->Count;
       goto Exit;
       break;
   }
 
   ZeroMem (&IoInfo, sizeof (IoInfo));
-  SvstDescriptor = (SMM_SUPV_SECURE_POLICY_SAVE_STATE_DESCRIPTOR_V1_0 *)((UINTN)SmmSecurityPolicy + PolicyRoot->Offset);
-  for (i = 0; i < PolicyRoot->Count; i++) {
+  SvstDescriptor = mPolicyTable.Descriptor[TargetMapField];
+  i              = mPolicyTable.DescriptorIndex[TargetMapField];
+  if (SvstDescriptor != NULL) {
     //
-    // See if this request is in the current descriptor
+    // We found a policy potentially applicable for the register in request.
     //
-    if (TargetMapField == (SECURE_POLICY_SVST)SvstDescriptor[i].MapField) {
+    if ((SvstDescriptor->Attributes & SECURE_POLICY_RESOURCE_ATTR_COND_READ) ||
+        (SvstDescriptor->Attributes & SECURE_POLICY_RESOURCE_ATTR_READ))
+    {
+      DEBUG ((DEBUG_VERBOSE, "%a Located a potentially matching policy.\n", __func__));
       //
-      // We found a policy potentially applicable for the register in request.
+      // Find the current condition to see if it matches.
       //
-      if ((SvstDescriptor[i].Attributes & SECURE_POLICY_RESOURCE_ATTR_COND_READ) ||
-          (SvstDescriptor[i].Attributes & SECURE_POLICY_RESOURCE_ATTR_READ))
-      {
-        DEBUG ((DEBUG_VERBOSE, "%a Located a potentially matching policy.\n", __func__));
-        //
-        // Find the current condition to see if it matches.
-        //
-        Status = InspectReadCondition (&SvstDescriptor[i], CpuIndex, &AllowedWidth, &IoInfo);
-        if (Status == EFI_UNSUPPORTED) {
-          // This is just a mismatched condition. Do not treat as error. Proceed with access attribute evaluation.
-          DEBUG ((DEBUG_WARN, "%a Mismatched condition detected, potential policy violation.\n", __func__));
-          Status = EFI_SUCCESS;
-          goto Exit;
-        } else if (EFI_ERROR (Status)) {
-          // Other real errors, bail here to propagate the error code to caller.
-          goto Exit;
-        } else if (Width > AllowedWidth) {
-          DEBUG ((DEBUG_ERROR, "%a Attempting to access save state region (0x%x) larger than allowed (0x%x)\n", __func__, Width, AllowedWidth));
-          Status = EFI_ACCESS_DENIED;
-          goto Exit;
-        } else {
-          DEBUG ((DEBUG_VERBOSE, "%a Access matches an entry of the Security Policy - Field: 0x%x on CPU 0x%x\n", __func__, TargetMapField, CpuIndex));
-          FoundMatch = TRUE;
-        }
+      Status = InspectReadCondition (SvstDescriptor, CpuIndex, &AllowedWidth, &IoInfo);
+      if (Status == EFI_UNSUPPORTED) {
+        // This is just a mismatched condition. Do not treat as error. Proceed with access attribute evaluation.
+        DEBUG ((DEBUG_WARN, "%a Mismatched condition detected, potential policy violation.\n", __func__));
+        Status = EFI_SUCCESS;
+        goto Exit;
+      } else if (EFI_ERROR (Status)) {
+        // Other real errors, bail here to propagate the error code to caller.
+        goto Exit;
+      } else if (Width > AllowedWidth) {
+        DEBUG ((DEBUG_ERROR, "%a Attempting to access save state region (0x%x) larger than allowed (0x%x)\n", __func__, Width, AllowedWidth));
+        Status = EFI_ACCESS_DENIED;
+        goto Exit;
+      } else {
+        DEBUG ((DEBUG_VERBOSE, "%a Access matches an entry of the Security Policy - Field: 0x%x on CPU 0x%x\n", __func__, TargetMapField, CpuIndex));
+        FoundMatch = TRUE;
       }
+    }
 
-      if (FoundMatch) {
-        if (TargetMapField == SECURE_POLICY_SVST_IO_TRAP) {
-          // EFI_MM_SAVE_STATE_REGISTER_IO includes IO data, which is essentially RAX access
-          // Recurse call to validate RAX access here
-          // Note: The save state read routine for RAX needs to be consistent with this IoInfo.IoWidth derivation!!
-          Status = IsIhvSmmSaveStateReadAllowed (SmmSecurityPolicy, CpuIndex, EFI_MM_SAVE_STATE_REGISTER_RAX, IoInfo.IoWidth, CpuSmmData);
-          if (EFI_ERROR (Status)) {
-            DEBUG ((DEBUG_ERROR, "%a Accessing IO type/port/width is granted but IO data access is rejected %r\n", __func__, Status));
-            goto Exit;
-          }
+    if (FoundMatch) {
+      if (TargetMapField == SECURE_POLICY_SVST_IO_TRAP) {
+        // EFI_MM_SAVE_STATE_REGISTER_IO includes IO data, which is essentially RAX access
+        // Recurse call to validate RAX access here
+        // Note: The save state read routine for RAX needs to be consistent with this IoInfo.IoWidth derivation!!
+        Status = IsIhvSmmSaveStateReadAllowed (SmmSecurityPolicy, CpuIndex, EFI_MM_SAVE_STATE_REGISTER_RAX, IoInfo.IoWidth, CpuSmmData);
+        if (EFI_ERROR (Status)) {
+          DEBUG ((DEBUG_ERROR, "%a Accessing IO type/port/width is granted but IO data access is rejected %r\n", __func__, Status));
+          goto Exit;
         }
       }
-
-      //
-      // We are finished.
-      //
-      break;
     }
   }
 
@@ -0,0 +1,516 @@
+/** @file
+  Unit tests of the save state supervision in MmSupervisorPkg, with the per-MMI IO information
+  snapshot and the MapField indexed policy table.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <PiMm.h>
+#include <SmmSecurePolicy.h>
+#include <Protocol/MmCpu.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+#include <Library/IhvSmmSaveStateSupervisionLib.h>
+
+#define UNIT_TEST_APP_NAME     "IhvSmmSaveStateSupervisionLib Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// CPU that triggered the simulated IO trap MMI, every other CPU has no IO information.
+//
+#define TEST_TRAP_CPU   1
+#define TEST_OTHER_CPU  0
+#define TEST_IO_PORT    0xB2
+
+typedef struct {
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0    *Policy;
+} TEST_CONTEXT_POLICY;
+
+SMM_SUPV_SECURE_POLICY_DATA_V1_0  mTestPolicyTemplate = {
+  .VersionMinor     = 0x0000,
+  .VersionMajor     = 0x0001,
+  .PolicyRootOffset = sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0),
+};
+
+SMM_SUPV_POLICY_ROOT_V1  mTestPolicyRootTemplate = {
+  .Version        = 1,
+  .PolicyRootSize = sizeof (SMM_SUPV_POLICY_ROOT_V1),
+};
+
+//
+// Save state descriptors of the simulated policies. The second RAX descriptor is never
+// evaluated, only the first descriptor of a MapField counts.
+//
+SMM_SUPV_SECURE_POLICY_SAVE_STATE_DESCRIPTOR_V1_0  mTestSaveStateDescriptors[] = {
+  { SECURE_POLICY_SVST_IO_TRAP, SECURE_POLICY_RESOURCE_ATTR_READ,      SECURE_POLICY_SVST_UNCONDITIONAL,   0 },
+  { SECURE_POLICY_SVST_RAX,     SECURE_POLICY_RESOURCE_ATTR_COND_READ, SECURE_POLICY_SVST_CONDITION_IO_WR, 0 },
+  { SECURE_POLICY_SVST_RAX,     SECURE_POLICY_RESOURCE_ATTR_READ,      SECURE_POLICY_SVST_UNCONDITIONAL,   0 },
+};
+
+TEST_CONTEXT_POLICY  mAllowListContext;
+TEST_CONTEXT_POLICY  mDenyListContext;
+
+//
+// State of the simulated supervisor services.
+//
+UINT64                     mSmiSequence;
+UINTN                      mSaveStateReads;
+EFI_MM_SAVE_STATE_IO_INFO  mTrapIoInfo;
+
+/**
+  Simulated MMI sequence number of the supervisor core.
+**/
+UINT64
+MmGetSmiSequence (
+  VOID
+  )
+{
+  return mSmiSequence;
+}
+
+/**
+  Simulated save state read, only the trap CPU has IO information.
+**/
+EFI_STATUS
+EFIAPI
+SmmReadSaveState (
+  IN CONST EFI_MM_CPU_PROTOCOL   *This,
+  IN UINTN                       Width,
+  IN EFI_MM_SAVE_STATE_REGISTER  Register,
+  IN UINTN                       CpuIndex,
+  OUT VOID                       *Buffer
+  )
+{
+  mSaveStateReads++;
+
+  if ((Register != EFI_MM_SAVE_STATE_REGISTER_IO) || (Width != sizeof (EFI_MM_SAVE_STATE_IO_INFO))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (CpuIndex != TEST_TRAP_CPU) {
+    return EFI_NOT_FOUND;
+  }
+
+  CopyMem (Buffer, &mTrapIoInfo, sizeof (mTrapIoInfo));
+  return EFI_SUCCESS;
+}
+
+/*
+  Helper function to create a test policy with the save state descriptors above, and apply it
+  the way the supervisor core does.
+*/
+STATIC
+UNIT_TEST_STATUS
+CreateSaveStatePolicy (
+  IN UNIT_TEST_CONTEXT  Context,
+  IN UINT8              AccessAttr
+  )
+{
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0  *TestPolicy;
+  SMM_SUPV_POLICY_ROOT_V1           *TestPolicyRoot;
+  UINT32                            PolicySize;
+
+  PolicySize = sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0) +
+               sizeof (SMM_SUPV_POLICY_ROOT_V1) +
+               sizeof (mTestSaveStateDescriptors);
+
+  TestPolicy = AllocatePool (PolicySize);
+  UT_ASSERT_NOT_NULL (TestPolicy);
+  CopyMem (TestPolicy, &mTestPolicyTemplate, sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0));
+  TestPolicy->PolicyRootCount = 1;
+  TestPolicy->Size            = PolicySize;
+
+  TestPolicyRoot = (SMM_SUPV_POLICY_ROOT_V1 *)(TestPolicy + 1);
+  CopyMem (TestPolicyRoot, &mTestPolicyRootTemplate, sizeof (SMM_SUPV_POLICY_ROOT_V1));
+  TestPolicyRoot->AccessAttr = AccessAttr;
+  TestPolicyRoot->Count      = ARRAY_SIZE (mTestSaveStateDescriptors);
+  TestPolicyRoot->Type       = SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_SAVE_STATE;
+  TestPolicyRoot->Offset     = sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0) + sizeof (SMM_SUPV_POLICY_ROOT_V1);
+
+  CopyMem (TestPolicyRoot + 1, mTestSaveStateDescriptors, sizeof (mTestSaveStateDescriptors));
+
+  UT_ASSERT_NOT_EFI_ERROR (IhvSmmSaveStatePolicyApplied (TestPolicy));
+
+  ((TEST_CONTEXT_POLICY *)Context)->Policy = TestPolicy;
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Helper function to create an allow list save state policy.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+CreateAllowListPolicy (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mSaveStateReads = 0;
+  return CreateSaveStatePolicy (Context, SMM_SUPV_ACCESS_ATTR_ALLOW);
+}
+
+/*
+  Helper function to create an allow list and a deny list save state policy.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+CreateBothPolicies (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  Status;
+
+  mSaveStateReads = 0;
+  Status          = CreateSaveStatePolicy (&mAllowListContext, SMM_SUPV_ACCESS_ATTR_ALLOW);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  return CreateSaveStatePolicy (&mDenyListContext, SMM_SUPV_ACCESS_ATTR_DENY);
+}
+
+/*
+  Helper function to free the created test policy.
+*/
+VOID
+EFIAPI
+ClearTestPolicy (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_POLICY  *PolicyCntx;
+
+  PolicyCntx = (TEST_CONTEXT_POLICY *)Context;
+  if ((PolicyCntx != NULL) && (PolicyCntx->Policy != NULL)) {
+    FreePool (PolicyCntx->Policy);
+    PolicyCntx->Policy = NULL;
+  }
+}
+
+/*
+  Helper function to free both test policies.
+*/
+VOID
+EFIAPI
+ClearBothPolicies (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ClearTestPolicy (&mAllowListContext);
+  ClearTestPolicy (&mDenyListContext);
+}
+
+/*
+  Helper function to simulate an IO trap MMI of the trap CPU.
+*/
+STATIC
+VOID
+StartIoTrapMmi (
+  IN UINT64                     SmiSequence,
+  IN EFI_MM_SAVE_STATE_IO_TYPE  IoType,
+  IN UINT64                     IoData
+  )
+{
+  mSmiSequence        = SmiSequence;
+  mTrapIoInfo.IoData  = IoData;
+  mTrapIoInfo.IoPort  = TEST_IO_PORT;
+  mTrapIoInfo.IoWidth = EFI_MM_SAVE_STATE_IO_WIDTH_UINT16;
+  mTrapIoInfo.IoType  = IoType;
+}
+
+/**
+  Unit test for IsIhvSmmSaveStateReadAllowed () API against an allow list.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SaveStateAllowListVerdicts (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0  *Policy;
+
+  Policy = ((TEST_CONTEXT_POLICY *)Context)->Policy;
+
+  //
+  // IO write: IO information and its data are both readable, within the IO width.
+  //
+  StartIoTrapMmi (0x100, EFI_MM_SAVE_STATE_IO_TYPE_OUTPUT, 0x55);
+  UT_ASSERT_NOT_EFI_ERROR (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_IO, sizeof (EFI_MM_SAVE_STATE_IO_INFO), NULL));
+  UT_ASSERT_NOT_EFI_ERROR (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16, NULL));
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_IO, sizeof (EFI_MM_SAVE_STATE_IO_INFO) + 1, NULL), EFI_ACCESS_DENIED);
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16 + 1, NULL), EFI_ACCESS_DENIED);
+
+  //
+  // Registers outside of the policy, and processor IDs which are never enforced.
+  //
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RBX, sizeof (UINT64), NULL), EFI_ACCESS_DENIED);
+  UT_ASSERT_NOT_EFI_ERROR (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_PROCESSOR_ID, sizeof (UINT64), NULL));
+
+  //
+  // CPUs that did not trap have no IO information to validate against.
+  //
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (Policy, TEST_OTHER_CPU, EFI_MM_SAVE_STATE_REGISTER_IO, sizeof (EFI_MM_SAVE_STATE_IO_INFO), NULL), EFI_NOT_FOUND);
+
+  //
+  // IO read: the data is only readable on IO writes per the first RAX descriptor, and
+  // since the IO information includes the data, neither of them is readable.
+  //
+  StartIoTrapMmi (0x101, EFI_MM_SAVE_STATE_IO_TYPE_INPUT, 0xAA);
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16, NULL), EFI_ACCESS_DENIED);
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_IO, sizeof (EFI_MM_SAVE_STATE_IO_INFO), NULL), EFI_ACCESS_DENIED);
+
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (NULL, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, sizeof (UINT64), NULL), EFI_INVALID_PARAMETER);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for the IO information of a CPU being read once per MMI.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SaveStateIoInfoReadOncePerMmi (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0  *Policy;
+  UINTN                             Index;
+
+  Policy = ((TEST_CONTEXT_POLICY *)Context)->Policy;
+
+  //
+  // Every check of the trap CPU during the MMI shares a single save state read, including
+  // the nested RAX check of IO information reads.
+  //
+  StartIoTrapMmi (0x200, EFI_MM_SAVE_STATE_IO_TYPE_OUTPUT, 0x55);
+  for (Index = 0; Index < 4; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_IO, sizeof (EFI_MM_SAVE_STATE_IO_INFO), NULL));
+    UT_ASSERT_NOT_EFI_ERROR (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16, NULL));
+  }
+
+  UT_ASSERT_EQUAL (mSaveStateReads, 1);
+
+  //
+  // Failed reads are remembered as well.
+  //
+  for (Index = 0; Index < 4; Index++) {
+    UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (Policy, TEST_OTHER_CPU, EFI_MM_SAVE_STATE_REGISTER_IO, sizeof (EFI_MM_SAVE_STATE_IO_INFO), NULL), EFI_NOT_FOUND);
+  }
+
+  UT_ASSERT_EQUAL (mSaveStateReads, 2);
+
+  //
+  // The save state of the same MMI does not change, the next MMI reads it again.
+  //
+  mTrapIoInfo.IoType = EFI_MM_SAVE_STATE_IO_TYPE_INPUT;
+  UT_ASSERT_NOT_EFI_ERROR (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16, NULL));
+  UT_ASSERT_EQUAL (mSaveStateReads, 2);
+
+  mSmiSequence++;
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16, NULL), EFI_ACCESS_DENIED);
+  UT_ASSERT_EQUAL (mSaveStateReads, 3);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for the IO information not being cached outside of MMIs.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SaveStateIoInfoNotCachedOutsideMmi (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0  *Policy;
+
+  Policy = ((TEST_CONTEXT_POLICY *)Context)->Policy;
+
+  StartIoTrapMmi (0, EFI_MM_SAVE_STATE_IO_TYPE_OUTPUT, 0x55);
+  UT_ASSERT_NOT_EFI_ERROR (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16, NULL));
+  UT_ASSERT_EQUAL (mSaveStateReads, 1);
+
+  mTrapIoInfo.IoType = EFI_MM_SAVE_STATE_IO_TYPE_INPUT;
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (Policy, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16, NULL), EFI_ACCESS_DENIED);
+  UT_ASSERT_EQUAL (mSaveStateReads, 2);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for the policy table following the policy checked against.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SaveStatePolicyTableFollowsPolicy (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0  *AllowList;
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0  *DenyList;
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0  *NoSaveStateRoot;
+  SMM_SUPV_POLICY_ROOT_V1           *PolicyRoot;
+
+  AllowList = mAllowListContext.Policy;
+  DenyList  = mDenyListContext.Policy;
+
+  UT_ASSERT_STATUS_EQUAL (IhvSmmSaveStatePolicyApplied (NULL), EFI_INVALID_PARAMETER);
+
+  //
+  // The deny list was applied last, checks against either list use the right descriptors.
+  //
+  StartIoTrapMmi (0x300, EFI_MM_SAVE_STATE_IO_TYPE_OUTPUT, 0x55);
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (DenyList, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16, NULL), EFI_ACCESS_DENIED);
+  UT_ASSERT_NOT_EFI_ERROR (IsIhvSmmSaveStateReadAllowed (DenyList, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RBX, sizeof (UINT64), NULL));
+  UT_ASSERT_NOT_EFI_ERROR (IsIhvSmmSaveStateReadAllowed (AllowList, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16, NULL));
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (AllowList, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RBX, sizeof (UINT64), NULL), EFI_ACCESS_DENIED);
+  UT_ASSERT_STATUS_EQUAL (IsIhvSmmSaveStateReadAllowed (DenyList, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RAX, EFI_MM_SAVE_STATE_IO_WIDTH_UINT16, NULL), EFI_ACCESS_DENIED);
+
+  //
+  // Without a save state policy root, this is a level 20 policy allowing everything.
+  //
+  NoSaveStateRoot = AllocateCopyPool (AllowList->Size, AllowList);
+  UT_ASSERT_NOT_NULL (NoSaveStateRoot);
+  PolicyRoot       = (SMM_SUPV_POLICY_ROOT_V1 *)((UINTN)NoSaveStateRoot + NoSaveStateRoot->PolicyRootOffset);
+  PolicyRoot->Type = SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_IO;
+  UT_ASSERT_NOT_EFI_ERROR (IsIhvSmmSaveStateReadAllowed (NoSaveStateRoot, TEST_TRAP_CPU, EFI_MM_SAVE_STATE_REGISTER_RBX, sizeof (UINT64), NULL));
+  FreePool (NoSaveStateRoot);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  save state supervision and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SaveStateTests;
+  TEST_CONTEXT_POLICY         PolicyContext;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the save state supervision Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&SaveStateTests, Framework, "Save State Supervision Tests", "IhvSmmSaveStateSupervisionLib.SaveState", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SaveStateTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (SaveStateTests, "Save state reads should follow an allow list", "AllowList", SaveStateAllowListVerdicts, CreateAllowListPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (SaveStateTests, "IO information should be read once per CPU and MMI", "ReadOncePerMmi", SaveStateIoInfoReadOncePerMmi, CreateAllowListPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (SaveStateTests, "IO information should not be cached outside of MMIs", "NoCacheOutsideMmi", SaveStateIoInfoNotCachedOutsideMmi, CreateAllowListPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (SaveStateTests, "Policy table should follow the policy checked against", "PolicyTable", SaveStatePolicyTableFollowsPolicy, CreateBothPolicies, ClearBothPolicies, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -20,6 +20,39 @@
 #include <Library/DebugLib.h>
 #include <Library/SysCallLib.h>
 
+#include "MmSupervisorUnblockedView.h"
+
+//
+// Maximum support address used to check input buffer
+//
+extern EFI_PHYSICAL_ADDRESS  mMmMemLibInternalMaximumSupportAddress;
+
+//
+// Read only view of the unblocked regions published by the supervisor, NULL until it is published.
+//
+CONST SMM_UNBLOCKED_VIEW  *mUnblockedView = NULL;
+
+/**
+  Locate the unblocked region view published by the supervisor.
+
+  The supervisor only publishes the view once its initialization completes, so the view is
+  queried again on every call until it is found.
+
+  @return The view, or NULL if the supervisor does not publish one yet.
+**/
+STATIC
+CONST SMM_UNBLOCKED_VIEW *
+GetUnblockedView (
+  VOID
+  )
+{
+  if (mUnblockedView == NULL) {
+    mUnblockedView = (CONST SMM_UNBLOCKED_VIEW *)(UINTN)SysCall (SMM_MM_UNBLOCKED_VIEW, 0, 0, 0);
+  }
+
+  return mUnblockedView;
+}
+
 /**
   This function check if the buffer is valid per processor architecture and not overlap with MMRAM.
 
@@ -36,7 +69,14 @@ MmIsBufferOutsideMmValid (
   IN UINT64                Length
   )
 {
-  UINT64  Ret;
+  CONST SMM_UNBLOCKED_VIEW  *View;
+  BOOLEAN                   Valid;
+  UINT64                    Ret;
+
+  View = GetUnblockedView ();
+  if ((View != NULL) && UnblockedViewCheckBuffer (View, mMmMemLibInternalMaximumSupportAddress, Buffer, Length, &Valid)) {
+    return Valid;
+  }
 
   Ret = SysCall (SMM_MM_UNBLOCKED, Buffer, Length, 0);
 
@@ -59,7 +99,14 @@ MmCommBufferValid (
   IN UINT64                Length
   )
 {
-  EFI_STATUS  Ret;
+  CONST SMM_UNBLOCKED_VIEW  *View;
+  BOOLEAN                   Valid;
+  EFI_STATUS                Ret;
+
+  View = GetUnblockedView ();
+  if ((View != NULL) && UnblockedViewCheckCommBuffer (View, Buffer, Length, &Valid)) {
+    return Valid;
+  }
 
   Ret = (EFI_STATUS)SysCall (SMM_MM_IS_COMM_BUFF, Buffer, Length, 0);
 
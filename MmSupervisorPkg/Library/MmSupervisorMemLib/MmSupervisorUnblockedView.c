@@ -0,0 +1,204 @@
+/** @file
+  Buffer checks of ring 3 against the read only unblocked region view of the supervisor.
+
+  The verdicts match the ones of the SMM_MM_UNBLOCKED and SMM_MM_IS_COMM_BUFF syscalls. Any
+  case the view cannot settle, including an update of the view racing with the check, is left
+  to the syscall.
+
+Copyright (C) Microsoft Corporation.
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+
+#include "MmSupervisorUnblockedView.h"
+
+/**
+  Look a buffer up in the ranges of the view.
+
+  @param[in]   Range            The MMRAM ranges followed by the user unblocked regions.
+  @param[in]   MmramCount       The number of MMRAM ranges.
+  @param[in]   UnblockedCount   The number of user unblocked regions.
+  @param[in]   Buffer           The buffer start address to be checked.
+  @param[in]   Length           The buffer length to be checked, not overflowing Buffer.
+  @param[out]  Valid            The verdict.
+
+  @retval TRUE    Valid holds the verdict.
+  @retval FALSE   The ranges cannot decide.
+**/
+STATIC
+BOOLEAN
+UnblockedViewLookUp (
+  IN  CONST SMM_UNBLOCKED_VIEW_RANGE  *Range,
+  IN  UINTN                           MmramCount,
+  IN  UINTN                           UnblockedCount,
+  IN  EFI_PHYSICAL_ADDRESS            Buffer,
+  IN  UINT64                          Length,
+  OUT BOOLEAN                         *Valid
+  )
+{
+  EFI_PHYSICAL_ADDRESS  End;
+  UINTN                 Low;
+  UINTN                 High;
+  UINTN                 Middle;
+
+  *Valid = FALSE;
+
+  //
+  // Empty buffers are never within an unblocked region, and the supervisor does not inspect
+  // the ownership of the first page.
+  //
+  if ((Length == 0) || (Buffer < EFI_PAGE_SIZE)) {
+    return TRUE;
+  }
+
+  End = Buffer + Length;
+
+  //
+  // The MMRAM ranges are coalesced, so the only one that may overlap the buffer is the first
+  // one ending above it.
+  //
+  Low  = 0;
+  High = MmramCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Range[Middle].End > Buffer) {
+      High = Middle;
+    } else {
+      Low = Middle + 1;
+    }
+  }
+
+  if ((Low < MmramCount) && (Range[Low].Start < End)) {
+    return TRUE;
+  }
+
+  //
+  // The unblocked regions do not overlap, so the only one that may hold the buffer is the last
+  // one starting at or below it.
+  //
+  Range += MmramCount;
+  Low    = 0;
+  High   = UnblockedCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Range[Middle].Start <= Buffer) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  if ((Low == 0) || (End > Range[Low - 1].End)) {
+    return TRUE;
+  }
+
+  //
+  // The supervisor also requires the GUID sized head of the buffer to sit in user pages. The
+  // pages of the region are, but whatever follows the region is not described here.
+  //
+  if (Buffer + sizeof (EFI_GUID) > Range[Low - 1].End) {
+    return FALSE;
+  }
+
+  *Valid = TRUE;
+  return TRUE;
+}
+
+/**
+  Check a buffer the way SMM_MM_UNBLOCKED does, from the unblocked region view.
+
+  @param[in]   View                   The view published by the supervisor.
+  @param[in]   MaximumSupportAddress  The maximum address supported by the processor.
+  @param[in]   Buffer                 The buffer start address to be checked.
+  @param[in]   Length                 The buffer length to be checked.
+  @param[out]  Valid                  TRUE when the buffer is valid per processor architecture, does
+                                      not overlap with MMRAM and lies in a user unblocked region.
+
+  @retval TRUE    Valid holds the verdict.
+  @retval FALSE   The view cannot decide, the buffer has to be checked through SMM_MM_UNBLOCKED.
+**/
+BOOLEAN
+UnblockedViewCheckBuffer (
+  IN  CONST SMM_UNBLOCKED_VIEW  *View,
+  IN  EFI_PHYSICAL_ADDRESS      MaximumSupportAddress,
+  IN  EFI_PHYSICAL_ADDRESS      Buffer,
+  IN  UINT64                    Length,
+  OUT BOOLEAN                   *Valid
+  )
+{
+  UINT64   Generation;
+  UINTN    MmramCount;
+  UINTN    UnblockedCount;
+  BOOLEAN  Decided;
+
+  //
+  // NOTE: (B:0->L:4G) is invalid for IA32, but (B:1->L:4G-1)/(B:4G-1->L:1) is valid.
+  //
+  if ((Length > MaximumSupportAddress) ||
+      (Buffer > MaximumSupportAddress) ||
+      ((Length != 0) && (Buffer > (MaximumSupportAddress - (Length - 1)))))
+  {
+    *Valid = FALSE;
+    return TRUE;
+  }
+
+  Generation = View->Generation;
+  if ((Generation == 0) || ((Generation & 1) != 0)) {
+    return FALSE;
+  }
+
+  MemoryFence ();
+
+  MmramCount     = View->MmramCount;
+  UnblockedCount = View->UnblockedCount;
+  if (((View->Flags & SMM_UNBLOCKED_VIEW_INCOMPLETE) != 0) ||
+      (MmramCount + UnblockedCount > SMM_UNBLOCKED_VIEW_MAX_RANGES))
+  {
+    return FALSE;
+  }
+
+  Decided = UnblockedViewLookUp (View->Range, MmramCount, UnblockedCount, Buffer, Length, Valid);
+
+  MemoryFence ();
+  return Decided && (View->Generation == Generation);
+}
+
+/**
+  Check a buffer the way SMM_MM_IS_COMM_BUFF does, from the unblocked region view.
+
+  @param[in]   View       The view published by the supervisor.
+  @param[in]   Buffer     The buffer start address to be checked.
+  @param[in]   Length     The buffer length to be checked.
+  @param[out]  Valid      TRUE when the buffer lies in the user communication buffer.
+
+  @retval TRUE    Valid holds the verdict.
+  @retval FALSE   The view cannot decide, the buffer has to be checked through SMM_MM_IS_COMM_BUFF.
+**/
+BOOLEAN
+UnblockedViewCheckCommBuffer (
+  IN  CONST SMM_UNBLOCKED_VIEW  *View,
+  IN  EFI_PHYSICAL_ADDRESS      Buffer,
+  IN  UINT64                    Length,
+  OUT BOOLEAN                   *Valid
+  )
+{
+  UINT64  Generation;
+
+  Generation = View->Generation;
+  if ((Generation == 0) || ((Generation & 1) != 0)) {
+    return FALSE;
+  }
+
+  MemoryFence ();
+
+  *Valid = (Buffer + Length >= Buffer) &&
+           (Buffer >= View->CommBufferStart) &&
+           (Buffer + Length <= View->CommBufferEnd);
+
+  MemoryFence ();
+  return View->Generation == Generation;
+}
@@ -0,0 +1,55 @@
+/** @file
+  Buffer checks of ring 3 against the read only unblocked region view of the supervisor.
+
+Copyright (C) Microsoft Corporation.
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef MM_SUPV_UNBLOCKED_VIEW_H_
+#define MM_SUPV_UNBLOCKED_VIEW_H_
+
+#include <Library/SysCallLib.h>
+
+/**
+  Check a buffer the way SMM_MM_UNBLOCKED does, from the unblocked region view.
+
+  @param[in]   View                   The view published by the supervisor.
+  @param[in]   MaximumSupportAddress  The maximum address supported by the processor.
+  @param[in]   Buffer                 The buffer start address to be checked.
+  @param[in]   Length                 The buffer length to be checked.
+  @param[out]  Valid                  TRUE when the buffer is valid per processor architecture, does
+                                      not overlap with MMRAM and lies in a user unblocked region.
+
+  @retval TRUE    Valid holds the verdict.
+  @retval FALSE   The view cannot decide, the buffer has to be checked through SMM_MM_UNBLOCKED.
+**/
+BOOLEAN
+UnblockedViewCheckBuffer (
+  IN  CONST SMM_UNBLOCKED_VIEW  *View,
+  IN  EFI_PHYSICAL_ADDRESS      MaximumSupportAddress,
+  IN  EFI_PHYSICAL_ADDRESS      Buffer,
+  IN  UINT64                    Length,
+  OUT BOOLEAN                   *Valid
+  );
+
+/**
+  Check a buffer the way SMM_MM_IS_COMM_BUFF does, from the unblocked region view.
+
+  @param[in]   View       The view published by the supervisor.
+  @param[in]   Buffer     The buffer start address to be checked.
+  @param[in]   Length     The buffer length to be checked.
+  @param[out]  Valid      TRUE when the buffer lies in the user communication buffer.
+
+  @retval TRUE    Valid holds the verdict.
+  @retval FALSE   The view cannot decide, the buffer has to be checked through SMM_MM_IS_COMM_BUFF.
+**/
+BOOLEAN
+UnblockedViewCheckCommBuffer (
+  IN  CONST SMM_UNBLOCKED_VIEW  *View,
+  IN  EFI_PHYSICAL_ADDRESS      Buffer,
+  IN  UINT64                    Length,
+  OUT BOOLEAN                   *Valid
+  );
+
+#endif // MM_SUPV_UNBLOCKED_VIEW_H_
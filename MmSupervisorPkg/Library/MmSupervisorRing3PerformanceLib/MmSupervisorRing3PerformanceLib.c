@@ -0,0 +1,716 @@
+/** @file
+  Performance library instance that hosts the user mode performance database in an MM Supervisor
+  environment.
+
+  This library is linked against the MmSupervisorRing3Performance driver. It keeps performance
+  records logged by demoted MM drivers in a lock-free record ring allocated from user pool, installs
+  the MM performance measurement protocol so the PerformanceLib instances of other MM drivers have
+  a sink, and registers a MMI handler that serializes the ring into FPDT dynamic string event records
+  for the non-MM FPDT consumer.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Guid/FirmwarePerformance.h>
+#include <Guid/PerformanceMeasurement.h>
+#include <Protocol/LoadedImage.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DevicePathLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MmServicesTableLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PerformanceLib.h>
+#include <Library/StandaloneMmMemLib.h>
+#include <Library/TimerLib.h>
+
+#include "PerformanceRecordRing.h"
+
+//
+// Every ring entry is reported as a fixed size dynamic string event record.
+//
+#define RING3_PERF_BOOT_RECORD_SIZE  (sizeof (FPDT_DYNAMIC_STRING_EVENT_RECORD) + FPDT_STRING_EVENT_RECORD_NAME_LENGTH)
+
+STATIC PERF_RECORD_RING  mPerformanceRing;
+STATIC BOOLEAN           mPerformanceRingReady = FALSE;
+
+//
+// Serialized copy of the ring taken when the FPDT consumer queries the boot record size, so the
+// offsets of the following data requests refer to a stable image of the records.
+//
+STATIC UINT8  *mBootRecordSnapshot     = NULL;
+STATIC UINTN  mBootRecordSnapshotSize  = 0;
+STATIC UINTN  mBootRecordSnapshotAlloc = 0;
+
+/**
+  Create performance record with event description and a timestamp.
+
+  @param CallerIdentifier  - Image handle or pointer to caller ID GUID.
+  @param Guid              - Pointer to a GUID.
+  @param String            - Pointer to a string describing the measurement.
+  @param TimeStamp         - 64-bit time stamp.
+  @param Address           - Pointer to a location in memory relevant to the measurement.
+  @param Identifier        - Performance identifier describing the type of measurement.
+  @param Attribute         - The attribute of the measurement. According to attribute can create a start
+                             record for PERF_START/PERF_START_EX, or a end record for PERF_END/PERF_END_EX,
+                             or a general record for other Perf macros.
+
+  @retval EFI_SUCCESS           - Successfully created performance record.
+  @retval EFI_OUT_OF_RESOURCES  - Ran out of space to store the records.
+  @retval EFI_INVALID_PARAMETER - Invalid parameter passed to function - NULL
+                                  pointer or invalid PerfId.
+
+**/
+EFI_STATUS
+EFIAPI
+CreatePerformanceMeasurement (
+  IN CONST VOID                  *CallerIdentifier  OPTIONAL,
+  IN CONST VOID                  *Guid              OPTIONAL,
+  IN CONST CHAR8                 *String            OPTIONAL,
+  IN UINT64                      TimeStamp          OPTIONAL,
+  IN UINT64                      Address            OPTIONAL,
+  IN UINT32                      Identifier,
+  IN PERF_MEASUREMENT_ATTRIBUTE  Attribute
+  )
+{
+  if (!mPerformanceRingReady) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Identifier == 0) {
+    if (Attribute == PerfStartEntry) {
+      Identifier = PERF_INMODULE_START_ID;
+    } else if (Attribute == PerfEndEntry) {
+      Identifier = PERF_INMODULE_END_ID;
+    } else {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  if (Identifier > MAX_UINT16) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (TimeStamp == 0) {
+    TimeStamp = GetPerformanceCounter ();
+  }
+
+  PerfRecordRingWrite (
+    &mPerformanceRing,
+    CallerIdentifier,
+    (CONST EFI_GUID *)Guid,
+    String,
+    TimeStamp,
+    (UINT16)Identifier
+    );
+
+  return EFI_SUCCESS;
+}
+
+STATIC EDKII_PERFORMANCE_MEASUREMENT_PROTOCOL  mPerformanceMeasurementInterface = {
+  CreatePerformanceMeasurement,
+};
+
+/**
+  Resolve the FILE_GUID of the module that logged a record.
+
+  The caller identifier is either the image handle of the module or a pointer to its caller ID GUID.
+
+  @param[in]  CallerIdentifier  The caller identifier of the record.
+  @param[out] ModuleGuid        Receives the module GUID, or zero if it cannot be resolved.
+
+**/
+STATIC
+VOID
+GetModuleGuidFromCallerIdentifier (
+  IN  CONST VOID  *CallerIdentifier,
+  OUT EFI_GUID    *ModuleGuid
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage;
+  CONST EFI_GUID             *FileGuid;
+
+  ZeroMem (ModuleGuid, sizeof (*ModuleGuid));
+  if (CallerIdentifier == NULL) {
+    return;
+  }
+
+  Status = gMmst->MmHandleProtocol (
+                    (EFI_HANDLE)CallerIdentifier,
+                    &gEfiLoadedImageProtocolGuid,
+                    (VOID **)&LoadedImage
+                    );
+  if (EFI_ERROR (Status)) {
+    CopyGuid (ModuleGuid, (CONST EFI_GUID *)CallerIdentifier);
+    return;
+  }
+
+  if (LoadedImage->FilePath != NULL) {
+    FileGuid = EfiGetNameGuidFromFwVolDevicePathNode ((CONST MEDIA_FW_VOL_FILEPATH_DEVICE_PATH *)LoadedImage->FilePath);
+    if (FileGuid != NULL) {
+      CopyGuid (ModuleGuid, FileGuid);
+    }
+  }
+}
+
+/**
+  Serialize the records retained by the ring into FPDT dynamic string event records.
+
+  The previous snapshot, if any, is replaced. Records that are overwritten while the snapshot is
+  taken are skipped.
+
+  @retval EFI_SUCCESS           The snapshot was taken.
+  @retval EFI_OUT_OF_RESOURCES  The snapshot buffer could not be allocated.
+
+**/
+STATIC
+EFI_STATUS
+TakeBootRecordSnapshot (
+  VOID
+  )
+{
+  UINT64                            First;
+  UINT32                            Count;
+  UINT64                            Index;
+  UINTN                             Needed;
+  PERF_RECORD_RING_ENTRY            Entry;
+  FPDT_DYNAMIC_STRING_EVENT_RECORD  *Record;
+
+  PerfRecordRingGetRange (&mPerformanceRing, &First, &Count);
+
+  Needed = (UINTN)Count * RING3_PERF_BOOT_RECORD_SIZE;
+  if (Needed > mBootRecordSnapshotAlloc) {
+    if (mBootRecordSnapshot != NULL) {
+      FreePool (mBootRecordSnapshot);
+    }
+
+    mBootRecordSnapshotSize  = 0;
+    mBootRecordSnapshotAlloc = 0;
+    mBootRecordSnapshot      = AllocatePool (Needed);
+    if (mBootRecordSnapshot == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    mBootRecordSnapshotAlloc = Needed;
+  }
+
+  mBootRecordSnapshotSize = 0;
+  for (Index = First; Index != First + Count; Index++) {
+    if (!PerfRecordRingRead (&mPerformanceRing, Index, &Entry)) {
+      continue;
+    }
+
+    Record                  = (FPDT_DYNAMIC_STRING_EVENT_RECORD *)(mBootRecordSnapshot + mBootRecordSnapshotSize);
+    Record->Header.Type     = FPDT_DYNAMIC_STRING_EVENT_TYPE;
+    Record->Header.Length   = (UINT8)RING3_PERF_BOOT_RECORD_SIZE;
+    Record->Header.Revision = FPDT_RECORD_REVISION_1;
+    Record->ProgressID      = Entry.ProgressId;
+    //
+    // Ring 3 has no inexpensive way to identify the executing processor.
+    //
+    Record->ApicID    = 0;
+    Record->Timestamp = GetTimeInNanoSecond (Entry.Timestamp);
+    if (!IsZeroGuid (&Entry.Guid)) {
+      CopyGuid (&Record->Guid, &Entry.Guid);
+    } else {
+      GetModuleGuidFromCallerIdentifier (Entry.CallerIdentifier, &Record->Guid);
+    }
+
+    CopyMem (Record + 1, Entry.String, FPDT_STRING_EVENT_RECORD_NAME_LENGTH);
+    mBootRecordSnapshotSize += RING3_PERF_BOOT_RECORD_SIZE;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Communication service MMI Handler entry.
+
+  This MMI handler provides services for the performance wrapper driver.
+
+  Caution: This function may receive untrusted input.
+  Communicate buffer and buffer size are external input, so this function will do basic validation.
+
+  @param[in]     DispatchHandle  The unique handle assigned to this handler by MmiHandlerRegister().
+  @param[in]     RegisterContext Points to an optional handler context which was specified when the
+                                 handler was registered.
+  @param[in, out] CommBuffer     A pointer to a collection of data in memory that will
+                                 be conveyed from a non-MM environment into an MM environment.
+  @param[in, out] CommBufferSize The size of the CommBuffer.
+
+  @retval EFI_SUCCESS                         The interrupt was handled and quiesced. No other handlers
+                                              should still be called.
+  @retval EFI_WARN_INTERRUPT_SOURCE_QUIESCED  The interrupt has been quiesced but other handlers should
+                                              still be called.
+  @retval EFI_WARN_INTERRUPT_SOURCE_PENDING   The interrupt is still pending and other handlers should still
+                                              be called.
+  @retval EFI_INTERRUPT_PENDING               The interrupt could not be quiesced.
+
+**/
+EFI_STATUS
+EFIAPI
+FpdtSmiHandler (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *RegisterContext,
+  IN OUT VOID        *CommBuffer,
+  IN OUT UINTN       *CommBufferSize
+  )
+{
+  EFI_STATUS                   Status;
+  SMM_BOOT_RECORD_COMMUNICATE  *SmmCommData;
+  UINTN                        BootRecordOffset;
+  UINTN                        BootRecordSize;
+  VOID                         *BootRecordData;
+
+  //
+  // If input is invalid, stop processing this MMI
+  //
+  if ((CommBuffer == NULL) || (CommBufferSize == NULL)) {
+    return EFI_SUCCESS;
+  }
+
+  if (*CommBufferSize < sizeof (SMM_BOOT_RECORD_COMMUNICATE)) {
+    DEBUG ((DEBUG_ERROR, "%a Communication buffer size is too small\n", __func__));
+    return EFI_SUCCESS;
+  }
+
+  SmmCommData = (SMM_BOOT_RECORD_COMMUNICATE *)CommBuffer;
+
+  Status = EFI_SUCCESS;
+
+  switch (SmmCommData->Function) {
+    case SMM_FPDT_FUNCTION_GET_BOOT_RECORD_SIZE:
+      Status = TakeBootRecordSnapshot ();
+      if (!EFI_ERROR (Status)) {
+        SmmCommData->BootRecordSize = mBootRecordSnapshotSize;
+      }
+
+      break;
+
+    case SMM_FPDT_FUNCTION_GET_BOOT_RECORD_DATA:
+      Status = EFI_UNSUPPORTED;
+      break;
+
+    case SMM_FPDT_FUNCTION_GET_BOOT_RECORD_DATA_BY_OFFSET:
+      BootRecordOffset = SmmCommData->BootRecordOffset;
+      BootRecordData   = SmmCommData->BootRecordData;
+      BootRecordSize   = SmmCommData->BootRecordSize;
+      if ((BootRecordData == NULL) || (BootRecordOffset >= mBootRecordSnapshotSize)) {
+        Status = EFI_INVALID_PARAMETER;
+        break;
+      }
+
+      //
+      // Sanity check
+      //
+      if (BootRecordSize > mBootRecordSnapshotSize - BootRecordOffset) {
+        BootRecordSize = mBootRecordSnapshotSize - BootRecordOffset;
+      }
+
+      if (!MmIsBufferOutsideMmValid ((UINTN)BootRecordData, BootRecordSize)) {
+        DEBUG ((DEBUG_ERROR, "%a Boot record data buffer is invalid\n", __func__));
+        Status = EFI_ACCESS_DENIED;
+        break;
+      }
+
+      CopyMem (BootRecordData, mBootRecordSnapshot + BootRecordOffset, BootRecordSize);
+      SmmCommData->BootRecordSize = BootRecordSize;
+      break;
+
+    default:
+      Status = EFI_UNSUPPORTED;
+  }
+
+  SmmCommData->ReturnStatus = Status;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  The constructor function allocates the performance record ring from user pool, installs the
+  MM performance measurement protocol and registers the FPDT MMI handler.
+
+  @param  ImageHandle   The firmware allocated handle for the EFI image.
+  @param  MmSystemTable A pointer to the MM System Table.
+
+  @retval EFI_SUCCESS   The constructor always returns EFI_SUCCESS.
+
+**/
+EFI_STATUS
+EFIAPI
+MmSupervisorRing3PerformanceLibConstructor (
+  IN EFI_HANDLE           ImageHandle,
+  IN EFI_MM_SYSTEM_TABLE  *MmSystemTable
+  )
+{
+  EFI_STATUS  Status;
+  EFI_HANDLE  Handle;
+  UINTN       RingSize;
+  VOID        *RingBuffer;
+
+  if (!PerformanceMeasurementEnabled ()) {
+    //
+    // Do not initialize performance infrastructure if not required.
+    //
+    return EFI_SUCCESS;
+  }
+
+  RingSize   = (UINTN)PcdGet32 (PcdMmSupervisorRing3PerformanceRecordCount) * sizeof (PERF_RECORD_RING_ENTRY);
+  RingBuffer = AllocatePool (RingSize);
+  if (RingBuffer == NULL) {
+    DEBUG ((DEBUG_ERROR, "%a Failed to allocate the performance record ring\n", __func__));
+    return EFI_SUCCESS;
+  }
+
+  Status = PerfRecordRingInitialize (&mPerformanceRing, RingBuffer, RingSize);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a Failed to initialize the performance record ring - %r\n", __func__, Status));
+    FreePool (RingBuffer);
+    return EFI_SUCCESS;
+  }
+
+  mPerformanceRingReady = TRUE;
+
+  Handle = NULL;
+  Status = gMmst->MmInstallProtocolInterface (
+                    &Handle,
+                    &gEdkiiSmmPerformanceMeasurementProtocolGuid,
+                    EFI_NATIVE_INTERFACE,
+                    &mPerformanceMeasurementInterface
+                    );
+  ASSERT_EFI_ERROR (Status);
+
+  Handle = NULL;
+  Status = gMmst->MmiHandlerRegister (FpdtSmiHandler, &gEfiFirmwarePerformanceGuid, &Handle);
+  ASSERT_EFI_ERROR (Status);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Adds a record at the end of the performance measurement log
+  that records the start time of a performance measurement.
+
+  The added record contains the Handle, Token, Module and Identifier.
+  The end time of the new record must be set to zero.
+  If TimeStamp is not zero, then TimeStamp is used to fill in the start time in the record.
+  If TimeStamp is zero, the start time in the record is filled in with the value
+  read from the current time stamp.
+
+  @param  Handle                  Pointer to environment specific context used
+                                  to identify the component being measured.
+  @param  Token                   Pointer to a Null-terminated ASCII string
+                                  that identifies the component being measured.
+  @param  Module                  Pointer to a Null-terminated ASCII string
+                                  that identifies the module being measured.
+  @param  TimeStamp               64-bit time stamp.
+  @param  Identifier              32-bit identifier. If the value is 0, the created record
+                                  is same as the one created by StartPerformanceMeasurement.
+
+  @retval RETURN_SUCCESS          The start of the measurement was recorded.
+  @retval RETURN_OUT_OF_RESOURCES There are not enough resources to record the measurement.
+
+**/
+RETURN_STATUS
+EFIAPI
+StartPerformanceMeasurementEx (
+  IN CONST VOID   *Handle   OPTIONAL,
+  IN CONST CHAR8  *Token    OPTIONAL,
+  IN CONST CHAR8  *Module   OPTIONAL,
+  IN UINT64       TimeStamp,
+  IN UINT32       Identifier
+  )
+{
+  CONST CHAR8  *String;
+
+  if (Token != NULL) {
+    String = Token;
+  } else {
+    String = Module;
+  }
+
+  return (RETURN_STATUS)CreatePerformanceMeasurement (Handle, NULL, String, TimeStamp, 0, Identifier, PerfStartEntry);
+}
+
+/**
+  Searches the performance measurement log from the beginning of the log
+  for the first matching record that contains a zero end time and fills in a valid end time.
+
+  Searches the performance measurement log from the beginning of the log
+  for the first record that matches Handle, Token, Module and Identifier and has an end time value of zero.
+  If the record can not be found then return RETURN_NOT_FOUND.
+  If the record is found and TimeStamp is not zero,
+  then the end time in the record is filled in with the value specified by TimeStamp.
+  If the record is found and TimeStamp is zero, then the end time in the matching record
+  is filled in with the current time stamp value.
+
+  @param  Handle                  Pointer to environment specific context used
+                                  to identify the component being measured.
+  @param  Token                   Pointer to a Null-terminated ASCII string
+                                  that identifies the component being measured.
+  @param  Module                  Pointer to a Null-terminated ASCII string
+                                  that identifies the module being measured.
+  @param  TimeStamp               64-bit time stamp.
+  @param  Identifier              32-bit identifier. If the value is 0, the found record
+                                  is same as the one found by EndPerformanceMeasurement.
+
+  @retval RETURN_SUCCESS          The end of  the measurement was recorded.
+  @retval RETURN_NOT_FOUND        The specified measurement record could not be found.
+
+**/
+RETURN_STATUS
+EFIAPI
+EndPerformanceMeasurementEx (
+  IN CONST VOID   *Handle   OPTIONAL,
+  IN CONST CHAR8  *Token    OPTIONAL,
+  IN CONST CHAR8  *Module   OPTIONAL,
+  IN UINT64       TimeStamp,
+  IN UINT32       Identifier
+  )
+{
+  CONST CHAR8  *String;
+
+  if (Token != NULL) {
+    String = Token;
+  } else {
+    String = Module;
+  }
+
+  return (RETURN_STATUS)CreatePerformanceMeasurement (Handle, NULL, String, TimeStamp, 0, Identifier, PerfEndEntry);
+}
+
+/**
+  Attempts to retrieve a performance measurement log entry from the performance measurement log.
+  It can also retrieve the log created by StartPerformanceMeasurement and EndPerformanceMeasurement,
+  and then assign the Identifier with 0.
+
+  !!! Not Support!!!
+
+  Records are reported through the FPDT boot record MMI rather than enumerated in MM.
+
+  @param  LogEntryKey             On entry, the key of the performance measurement log entry to retrieve.
+                                  0, then the first performance measurement log entry is retrieved.
+                                  On exit, the key of the next performance log entry.
+  @param  Handle                  Pointer to environment specific context used to identify the component
+                                  being measured.
+  @param  Token                   Pointer to a Null-terminated ASCII string that identifies the component
+                                  being measured.
+  @param  Module                  Pointer to a Null-terminated ASCII string that identifies the module
+                                  being measured.
+  @param  StartTimeStamp          Pointer to the 64-bit time stamp that was recorded when the measurement
+                                  was started.
+  @param  EndTimeStamp            Pointer to the 64-bit time stamp that was recorded when the measurement
+                                  was ended.
+  @param  Identifier              Pointer to the 32-bit identifier that was recorded.
+
+  @return The key for the next performance log entry (in general case).
+
+**/
+UINTN
+EFIAPI
+GetPerformanceMeasurementEx (
+  IN  UINTN        LogEntryKey,
+  OUT CONST VOID   **Handle,
+  OUT CONST CHAR8  **Token,
+  OUT CONST CHAR8  **Module,
+  OUT UINT64       *StartTimeStamp,
+  OUT UINT64       *EndTimeStamp,
+  OUT UINT32       *Identifier
+  )
+{
+  return 0;
+}
+
+/**
+  Adds a record at the end of the performance measurement log
+  that records the start time of a performance measurement.
+
+  The added record contains the Handle, Token, and Module.
+  The end time of the new record must be set to zero.
+  If TimeStamp is not zero, then TimeStamp is used to fill in the start time in the record.
+  If TimeStamp is zero, the start time in the record is filled in with the value
+  read from the current time stamp.
+
+  @param  Handle                  Pointer to environment specific context used
+                                  to identify the component being measured.
+  @param  Token                   Pointer to a Null-terminated ASCII string
+                                  that identifies the component being measured.
+  @param  Module                  Pointer to a Null-terminated ASCII string
+                                  that identifies the module being measured.
+  @param  TimeStamp               64-bit time stamp.
+
+  @retval RETURN_SUCCESS          The start of the measurement was recorded.
+  @retval RETURN_OUT_OF_RESOURCES There are not enough resources to record the measurement.
+
+**/
+RETURN_STATUS
+EFIAPI
+StartPerformanceMeasurement (
+  IN CONST VOID   *Handle   OPTIONAL,
+  IN CONST CHAR8  *Token    OPTIONAL,
+  IN CONST CHAR8  *Module   OPTIONAL,
+  IN UINT64       TimeStamp
+  )
+{
+  return StartPerformanceMeasurementEx (Handle, Token, Module, TimeStamp, 0);
+}
+
+/**
+  Searches the performance measurement log from the beginning of the log
+  for the first matching record that contains a zero end time and fills in a valid end time.
+
+  Searches the performance measurement log from the beginning of the log
+  for the first record that matches Handle, Token, and Module and has an end time value of zero.
+  If the record can not be found then return RETURN_NOT_FOUND.
+  If the record is found and TimeStamp is not zero,
+  then the end time in the record is filled in with the value specified by TimeStamp.
+  If the record is found and TimeStamp is zero, then the end time in the matching record
+  is filled in with the current time stamp value.
+
+  @param  Handle                  Pointer to environment specific context used
+                                  to identify the component being measured.
+  @param  Token                   Pointer to a Null-terminated ASCII string
+                                  that identifies the component being measured.
+  @param  Module                  Pointer to a Null-terminated ASCII string
+                                  that identifies the module being measured.
+  @param  TimeStamp               64-bit time stamp.
+
+  @retval RETURN_SUCCESS          The end of  the measurement was recorded.
+  @retval RETURN_NOT_FOUND        The specified measurement record could not be found.
+
+**/
+RETURN_STATUS
+EFIAPI
+EndPerformanceMeasurement (
+  IN CONST VOID   *Handle   OPTIONAL,
+  IN CONST CHAR8  *Token    OPTIONAL,
+  IN CONST CHAR8  *Module   OPTIONAL,
+  IN UINT64       TimeStamp
+  )
+{
+  return EndPerformanceMeasurementEx (Handle, Token, Module, TimeStamp, 0);
+}
+
+/**
+  Attempts to retrieve a performance measurement log entry from the performance measurement log.
+  It can also retrieve the log created by StartPerformanceMeasurementEx and EndPerformanceMeasurementEx,
+  and then eliminate the Identifier.
+
+  !!! Not Support!!!
+
+  Records are reported through the FPDT boot record MMI rather than enumerated in MM.
+
+  @param  LogEntryKey             On entry, the key of the performance measurement log entry to retrieve.
+                                  0, then the first performance measurement log entry is retrieved.
+                                  On exit, the key of the next performance log entry.
+  @param  Handle                  Pointer to environment specific context used to identify the component
+                                  being measured.
+  @param  Token                   Pointer to a Null-terminated ASCII string that identifies the component
+                                  being measured.
+  @param  Module                  Pointer to a Null-terminated ASCII string that identifies the module
+                                  being measured.
+  @param  StartTimeStamp          Pointer to the 64-bit time stamp that was recorded when the measurement
+                                  was started.
+  @param  EndTimeStamp            Pointer to the 64-bit time stamp that was recorded when the measurement
+                                  was ended.
+
+  @return The key for the next performance log entry (in general case).
+
+**/
+UINTN
+EFIAPI
+GetPerformanceMeasurement (
+  IN  UINTN        LogEntryKey,
+  OUT CONST VOID   **Handle,
+  OUT CONST CHAR8  **Token,
+  OUT CONST CHAR8  **Module,
+  OUT UINT64       *StartTimeStamp,
+  OUT UINT64       *EndTimeStamp
+  )
+{
+  return 0;
+}
+
+/**
+  Returns TRUE if the performance measurement macros are enabled.
+
+  This function returns TRUE if the PERFORMANCE_LIBRARY_PROPERTY_MEASUREMENT_ENABLED bit of
+  PcdPerformanceLibraryPropertyMask is set.  Otherwise FALSE is returned.
+
+  @retval TRUE                    The PERFORMANCE_LIBRARY_PROPERTY_MEASUREMENT_ENABLED bit of
+                                  PcdPerformanceLibraryPropertyMask is set.
+  @retval FALSE                   The PERFORMANCE_LIBRARY_PROPERTY_MEASUREMENT_ENABLED bit of
+                                  PcdPerformanceLibraryPropertyMask is clear.
+
+**/
+BOOLEAN
+EFIAPI
+PerformanceMeasurementEnabled (
+  VOID
+  )
+{
+  return (BOOLEAN)((PcdGet8 (PcdPerformanceLibraryPropertyMask) & PERFORMANCE_LIBRARY_PROPERTY_MEASUREMENT_ENABLED) != 0);
+}
+
+/**
+  Create performance record with event description and a timestamp.
+
+  @param CallerIdentifier  - Image handle or pointer to caller ID GUID
+  @param Guid              - Pointer to a GUID
+  @param String            - Pointer to a string describing the measurement
+  @param Address           - Pointer to a location in memory relevant to the measurement
+  @param Identifier        - Performance identifier describing the type of measurement
+
+  @retval RETURN_SUCCESS           - Successfully created performance record
+  @retval RETURN_OUT_OF_RESOURCES  - Ran out of space to store the records
+  @retval RETURN_INVALID_PARAMETER - Invalid parameter passed to function - NULL
+                                     pointer or invalid PerfId
+
+**/
+RETURN_STATUS
+EFIAPI
+LogPerformanceMeasurement (
+  IN CONST VOID   *CallerIdentifier,
+  IN CONST VOID   *Guid     OPTIONAL,
+  IN CONST CHAR8  *String   OPTIONAL,
+  IN UINT64       Address   OPTIONAL,
+  IN UINT32       Identifier
+  )
+{
+  return (RETURN_STATUS)CreatePerformanceMeasurement (CallerIdentifier, Guid, String, 0, Address, Identifier, PerfEntry);
+}
+
+/**
+  Check whether the specified performance measurement can be logged.
+
+  This function returns TRUE when the PERFORMANCE_LIBRARY_PROPERTY_MEASUREMENT_ENABLED bit of PcdPerformanceLibraryPropertyMask is set
+  and the Type disable bit in PcdPerformanceLibraryPropertyMask is not set.
+
+  @param Type        - Type of the performance measurement entry.
+
+  @retval TRUE         The performance measurement can be logged.
+  @retval FALSE        The performance measurement can NOT be logged.
+
+**/
+BOOLEAN
+EFIAPI
+LogPerformanceMeasurementEnabled (
+  IN  CONST UINTN  Type
+  )
+{
+  //
+  // When Performance measurement is enabled and the type is not filtered, the performance can be logged.
+  //
+  if (PerformanceMeasurementEnabled () && ((PcdGet8 (PcdPerformanceLibraryPropertyMask) & Type) == 0)) {
+    return TRUE;
+  }
+
+  return FALSE;
+}
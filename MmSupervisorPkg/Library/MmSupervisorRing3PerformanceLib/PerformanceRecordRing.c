@@ -0,0 +1,192 @@
+/** @file
+  Lock-free record ring backing the MM Supervisor ring 3 performance library.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "PerformanceRecordRing.h"
+
+/**
+  Initialize a record ring over a caller supplied buffer.
+
+  The ring uses the largest power-of-two number of entries that fits in the buffer.
+
+  @param[out] Ring        The ring to initialize.
+  @param[in]  Buffer      Storage for the ring entries.
+  @param[in]  BufferSize  Size of Buffer in bytes.
+
+  @retval EFI_SUCCESS            The ring was initialized.
+  @retval EFI_INVALID_PARAMETER  Ring or Buffer is NULL.
+  @retval EFI_BUFFER_TOO_SMALL   Buffer cannot hold a single entry.
+
+**/
+EFI_STATUS
+PerfRecordRingInitialize (
+  OUT PERF_RECORD_RING  *Ring,
+  IN  VOID              *Buffer,
+  IN  UINTN             BufferSize
+  )
+{
+  UINTN  EntryCount;
+
+  if ((Ring == NULL) || (Buffer == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  EntryCount = BufferSize / sizeof (PERF_RECORD_RING_ENTRY);
+  if (EntryCount == 0) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  if (EntryCount > BIT31) {
+    EntryCount = BIT31;
+  }
+
+  EntryCount = GetPowerOfTwo32 ((UINT32)EntryCount);
+
+  ZeroMem (Buffer, EntryCount * sizeof (PERF_RECORD_RING_ENTRY));
+  Ring->Head    = 0;
+  Ring->Mask    = (UINT32)EntryCount - 1;
+  Ring->Entries = Buffer;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Append a record to the ring, overwriting the oldest record if the ring is full.
+
+  This routine is safe to call concurrently from multiple processors. The record is dropped if its
+  slot is still being written by, or already holds the record of, a writer a full lap away.
+
+  @param[in] Ring              The ring to append to.
+  @param[in] CallerIdentifier  Image handle or GUID identifying the caller.
+  @param[in] Guid              Optional GUID of the record.
+  @param[in] String            Optional ASCII string of the record, truncated to fit the entry.
+  @param[in] Timestamp         Timestamp of the record in performance counter ticks.
+  @param[in] ProgressId        FPDT progress identifier of the record.
+
+**/
+VOID
+PerfRecordRingWrite (
+  IN PERF_RECORD_RING  *Ring,
+  IN CONST VOID        *CallerIdentifier,
+  IN CONST EFI_GUID    *Guid OPTIONAL,
+  IN CONST CHAR8       *String OPTIONAL,
+  IN UINT64            Timestamp,
+  IN UINT16            ProgressId
+  )
+{
+  UINT64                  Index;
+  UINT64                  Sequence;
+  UINTN                   Length;
+  PERF_RECORD_RING_ENTRY  *Entry;
+
+  do {
+    Index = Ring->Head;
+  } while (InterlockedCompareExchange64 (&Ring->Head, Index, Index + 1) != Index);
+
+  Entry = &Ring->Entries[(UINTN)(Index & Ring->Mask)];
+
+  //
+  // Mark the slot busy before touching the payload so a concurrent reader cannot accept a half
+  // written record under the sequence number of the record it replaces, and a writer a full lap
+  // away cannot copy its payload over this one. A busy slot, or one already holding a newer
+  // record, belongs to such a writer and this record is dropped.
+  //
+  Sequence = Entry->Sequence;
+  if (((Sequence & 1) != 0) ||
+      (Sequence > PERF_RECORD_SEQUENCE_BUSY (Index)) ||
+      (InterlockedCompareExchange64 (&Entry->Sequence, Sequence, PERF_RECORD_SEQUENCE_BUSY (Index)) != Sequence))
+  {
+    return;
+  }
+
+  Entry->ProgressId       = ProgressId;
+  Entry->Timestamp        = Timestamp;
+  Entry->CallerIdentifier = CallerIdentifier;
+  if (Guid != NULL) {
+    CopyGuid (&Entry->Guid, Guid);
+  } else {
+    ZeroMem (&Entry->Guid, sizeof (Entry->Guid));
+  }
+
+  Length = 0;
+  if (String != NULL) {
+    while ((Length < FPDT_STRING_EVENT_RECORD_NAME_LENGTH - 1) && (String[Length] != '\0')) {
+      Entry->String[Length] = String[Length];
+      Length++;
+    }
+  }
+
+  Entry->String[Length] = '\0';
+
+  MemoryFence ();
+  Entry->Sequence = PERF_RECORD_SEQUENCE_PUBLISHED (Index);
+}
+
+/**
+  Get the absolute indices of the records currently retained by the ring.
+
+  @param[in]  Ring   The ring to inspect.
+  @param[out] First  Absolute index of the oldest retained record.
+  @param[out] Count  Number of retained records starting at First.
+
+**/
+VOID
+PerfRecordRingGetRange (
+  IN  PERF_RECORD_RING  *Ring,
+  OUT UINT64            *First,
+  OUT UINT32            *Count
+  )
+{
+  UINT64  Head;
+
+  Head = Ring->Head;
+  if (Head > Ring->Mask) {
+    *Count = Ring->Mask + 1;
+  } else {
+    *Count = (UINT32)Head;
+  }
+
+  *First = Head - *Count;
+}
+
+/**
+  Copy a record out of the ring.
+
+  @param[in]  Ring   The ring to read from.
+  @param[in]  Index  Absolute index of the record.
+  @param[out] Entry  Receives a consistent copy of the record.
+
+  @retval TRUE   Entry holds the record at Index.
+  @retval FALSE  The record is still being written or has been overwritten.
+
+**/
+BOOLEAN
+PerfRecordRingRead (
+  IN  PERF_RECORD_RING        *Ring,
+  IN  UINT64                  Index,
+  OUT PERF_RECORD_RING_ENTRY  *Entry
+  )
+{
+  PERF_RECORD_RING_ENTRY  *Slot;
+
+  Slot = &Ring->Entries[(UINTN)(Index & Ring->Mask)];
+  if (Slot->Sequence != PERF_RECORD_SEQUENCE_PUBLISHED (Index)) {
+    return FALSE;
+  }
+
+  MemoryFence ();
+  CopyMem (Entry, Slot, sizeof (*Entry));
+  MemoryFence ();
+
+  return (BOOLEAN)(Slot->Sequence == PERF_RECORD_SEQUENCE_PUBLISHED (Index));
+}
@@ -0,0 +1,136 @@
+/** @file
+  Definitions of the lock-free record ring backing the MM Supervisor ring 3 performance library.
+
+  The ring is a fixed-size, power-of-two array of records. Producers claim an index with an
+  interlocked update of the head, mark the slot busy with a compare-exchange of its sequence
+  number and publish the record by writing its sequence number last, so recording never takes a
+  lock and never calls into the supervisor. When the ring is full the oldest records are
+  overwritten. A producer that finds its slot busy or already holding a newer record, which only
+  happens when writers a full lap apart race, drops its record instead of tearing the other one.
+  Readers validate each slot against its sequence number before and after copying it out, and
+  drop records that were overwritten while being read.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef PERFORMANCE_RECORD_RING_H_
+#define PERFORMANCE_RECORD_RING_H_
+
+#include <Guid/ExtendedFirmwarePerformance.h>
+
+//
+// Sequence number of a slot that was never written.
+//
+#define PERF_RECORD_SEQUENCE_INVALID  0
+
+//
+// Sequence numbers of the record at an absolute index. The odd value marks the slot busy while
+// the record is being written and the even value publishes it. Neither is ever
+// PERF_RECORD_SEQUENCE_INVALID, and 64 bits do not wrap in practice.
+//
+#define PERF_RECORD_SEQUENCE_BUSY(Index)       (LShiftU64 ((Index), 1) + 1)
+#define PERF_RECORD_SEQUENCE_PUBLISHED(Index)  (LShiftU64 ((Index), 1) + 2)
+
+typedef struct {
+  //
+  // PERF_RECORD_SEQUENCE_BUSY or PERF_RECORD_SEQUENCE_PUBLISHED of the record in the slot.
+  //
+  volatile UINT64    Sequence;
+  UINT16             ProgressId;
+  UINT16             Reserved[3];
+  UINT64             Timestamp;
+  CONST VOID         *CallerIdentifier;
+  EFI_GUID           Guid;
+  CHAR8              String[FPDT_STRING_EVENT_RECORD_NAME_LENGTH];
+} PERF_RECORD_RING_ENTRY;
+
+typedef struct {
+  //
+  // Total number of records ever claimed. The slot of a record is its index masked by Mask.
+  //
+  volatile UINT64           Head;
+  UINT32                    Mask;
+  PERF_RECORD_RING_ENTRY    *Entries;
+} PERF_RECORD_RING;
+
+/**
+  Initialize a record ring over a caller supplied buffer.
+
+  The ring uses the largest power-of-two number of entries that fits in the buffer.
+
+  @param[out] Ring        The ring to initialize.
+  @param[in]  Buffer      Storage for the ring entries.
+  @param[in]  BufferSize  Size of Buffer in bytes.
+
+  @retval EFI_SUCCESS            The ring was initialized.
+  @retval EFI_INVALID_PARAMETER  Ring or Buffer is NULL.
+  @retval EFI_BUFFER_TOO_SMALL   Buffer cannot hold a single entry.
+
+**/
+EFI_STATUS
+PerfRecordRingInitialize (
+  OUT PERF_RECORD_RING  *Ring,
+  IN  VOID              *Buffer,
+  IN  UINTN             BufferSize
+  );
+
+/**
+  Append a record to the ring, overwriting the oldest record if the ring is full.
+
+  This routine is safe to call concurrently from multiple processors. The record is dropped if its
+  slot is still being written by, or already holds the record of, a writer a full lap away.
+
+  @param[in] Ring              The ring to append to.
+  @param[in] CallerIdentifier  Image handle or GUID identifying the caller.
+  @param[in] Guid              Optional GUID of the record.
+  @param[in] String            Optional ASCII string of the record, truncated to fit the entry.
+  @param[in] Timestamp         Timestamp of the record in performance counter ticks.
+  @param[in] ProgressId        FPDT progress identifier of the record.
+
+**/
+VOID
+PerfRecordRingWrite (
+  IN PERF_RECORD_RING  *Ring,
+  IN CONST VOID        *CallerIdentifier,
+  IN CONST EFI_GUID    *Guid OPTIONAL,
+  IN CONST CHAR8       *String OPTIONAL,
+  IN UINT64            Timestamp,
+  IN UINT16            ProgressId
+  );
+
+/**
+  Get the absolute indices of the records currently retained by the ring.
+
+  @param[in]  Ring   The ring to inspect.
+  @param[out] First  Absolute index of the oldest retained record.
+  @param[out] Count  Number of retained records starting at First.
+
+**/
+VOID
+PerfRecordRingGetRange (
+  IN  PERF_RECORD_RING  *Ring,
+  OUT UINT64            *First,
+  OUT UINT32            *Count
+  );
+
+/**
+  Copy a record out of the ring.
+
+  @param[in]  Ring   The ring to read from.
+  @param[in]  Index  Absolute index of the record.
+  @param[out] Entry  Receives a consistent copy of the record.
+
+  @retval TRUE   Entry holds the record at Index.
+  @retval FALSE  The record is still being written or has been overwritten.
+
+**/
+BOOLEAN
+PerfRecordRingRead (
+  IN  PERF_RECORD_RING        *Ring,
+  IN  UINT64                  Index,
+  OUT PERF_RECORD_RING_ENTRY  *Entry
+  );
+
+#endif // PERFORMANCE_RECORD_RING_H_
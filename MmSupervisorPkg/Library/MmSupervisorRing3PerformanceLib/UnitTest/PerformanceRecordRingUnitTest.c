@@ -0,0 +1,489 @@
+/** @file
+  Unit tests of the lock-free record ring in MmSupervisorRing3PerformanceLib
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../PerformanceRecordRing.h"
+
+#define UNIT_TEST_APP_NAME     "MmSupervisorRing3PerformanceLib Record Ring Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Number of entries the test rings are created with.
+//
+#define TEST_RING_ENTRY_COUNT  64
+
+//
+// Number of records written by the recording benchmark.
+//
+#define TEST_BENCHMARK_RECORD_COUNT  (1024 * 1024)
+
+typedef struct {
+  PERF_RECORD_RING    Ring;
+  VOID                *Buffer;
+} TEST_CONTEXT_RING;
+
+EFI_GUID  mTestCallerGuid = {
+  0x5e9c0d9b, 0x4a43, 0x4b7e, { 0x9b, 0x8e, 0x3d, 0x2f, 0x6a, 0x11, 0x47, 0xc0 }
+};
+
+/*
+  Helper function to create a record ring with TEST_RING_ENTRY_COUNT entries.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+CreateTestRing (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_RING  *RingCntx;
+  UINTN              BufferSize;
+
+  RingCntx   = (TEST_CONTEXT_RING *)Context;
+  BufferSize = TEST_RING_ENTRY_COUNT * sizeof (PERF_RECORD_RING_ENTRY);
+
+  RingCntx->Buffer = AllocatePool (BufferSize);
+  UT_ASSERT_NOT_NULL (RingCntx->Buffer);
+  UT_ASSERT_NOT_EFI_ERROR (PerfRecordRingInitialize (&RingCntx->Ring, RingCntx->Buffer, BufferSize));
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Helper function to free the test record ring.
+*/
+VOID
+EFIAPI
+FreeTestRing (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_RING  *RingCntx;
+
+  RingCntx = (TEST_CONTEXT_RING *)Context;
+  if (RingCntx->Buffer != NULL) {
+    FreePool (RingCntx->Buffer);
+    RingCntx->Buffer = NULL;
+  }
+}
+
+/**
+  Unit test for PerfRecordRingInitialize () sizing of the ring.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RingInitializeRoundsDownToPowerOfTwo (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PERF_RECORD_RING        Ring;
+  PERF_RECORD_RING_ENTRY  Buffer[5];
+
+  // Buffer too small for a single entry
+  UT_ASSERT_STATUS_EQUAL (PerfRecordRingInitialize (&Ring, Buffer, sizeof (Buffer[0]) - 1), EFI_BUFFER_TOO_SMALL);
+  UT_ASSERT_STATUS_EQUAL (PerfRecordRingInitialize (&Ring, NULL, sizeof (Buffer)), EFI_INVALID_PARAMETER);
+
+  // Five entries worth of storage should produce a ring of four
+  UT_ASSERT_NOT_EFI_ERROR (PerfRecordRingInitialize (&Ring, Buffer, sizeof (Buffer)));
+  UT_ASSERT_EQUAL (Ring.Mask, 3);
+  UT_ASSERT_EQUAL (Ring.Head, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for PerfRecordRingWrite () and PerfRecordRingRead () on a ring that has not wrapped.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RingWriteThenReadBack (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_RING       *RingCntx;
+  PERF_RECORD_RING_ENTRY  Entry;
+  UINT64                  First;
+  UINT32                  Count;
+
+  RingCntx = (TEST_CONTEXT_RING *)Context;
+
+  // Empty ring reports nothing
+  PerfRecordRingGetRange (&RingCntx->Ring, &First, &Count);
+  UT_ASSERT_EQUAL (First, 0);
+  UT_ASSERT_EQUAL (Count, 0);
+  UT_ASSERT_FALSE (PerfRecordRingRead (&RingCntx->Ring, 0, &Entry));
+
+  PerfRecordRingWrite (&RingCntx->Ring, &mTestCallerGuid, NULL, "Start", 100, 0x40);
+  PerfRecordRingWrite (&RingCntx->Ring, &mTestCallerGuid, &mTestCallerGuid, "End", 200, 0x41);
+
+  PerfRecordRingGetRange (&RingCntx->Ring, &First, &Count);
+  UT_ASSERT_EQUAL (First, 0);
+  UT_ASSERT_EQUAL (Count, 2);
+
+  UT_ASSERT_TRUE (PerfRecordRingRead (&RingCntx->Ring, 0, &Entry));
+  UT_ASSERT_EQUAL (Entry.ProgressId, 0x40);
+  UT_ASSERT_EQUAL (Entry.Timestamp, 100);
+  UT_ASSERT_EQUAL ((UINTN)Entry.CallerIdentifier, (UINTN)&mTestCallerGuid);
+  UT_ASSERT_TRUE (IsZeroGuid (&Entry.Guid));
+  UT_ASSERT_EQUAL (AsciiStrCmp (Entry.String, "Start"), 0);
+
+  UT_ASSERT_TRUE (PerfRecordRingRead (&RingCntx->Ring, 1, &Entry));
+  UT_ASSERT_EQUAL (Entry.ProgressId, 0x41);
+  UT_ASSERT_EQUAL (Entry.Timestamp, 200);
+  UT_ASSERT_TRUE (CompareGuid (&Entry.Guid, &mTestCallerGuid));
+  UT_ASSERT_EQUAL (AsciiStrCmp (Entry.String, "End"), 0);
+
+  // Records past the head have not been written
+  UT_ASSERT_FALSE (PerfRecordRingRead (&RingCntx->Ring, 2, &Entry));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for PerfRecordRingWrite () truncation of long strings.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RingWriteTruncatesString (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_RING       *RingCntx;
+  PERF_RECORD_RING_ENTRY  Entry;
+
+  RingCntx = (TEST_CONTEXT_RING *)Context;
+
+  PerfRecordRingWrite (&RingCntx->Ring, NULL, NULL, "ThisMeasurementNameIsLongerThanTheRecord", 1, 0x40);
+  PerfRecordRingWrite (&RingCntx->Ring, NULL, NULL, NULL, 2, 0x41);
+
+  UT_ASSERT_TRUE (PerfRecordRingRead (&RingCntx->Ring, 0, &Entry));
+  UT_ASSERT_EQUAL (AsciiStrLen (Entry.String), FPDT_STRING_EVENT_RECORD_NAME_LENGTH - 1);
+  UT_ASSERT_MEM_EQUAL (Entry.String, "ThisMeasurementNameIsLongerThanTheRecord", FPDT_STRING_EVENT_RECORD_NAME_LENGTH - 1);
+
+  UT_ASSERT_TRUE (PerfRecordRingRead (&RingCntx->Ring, 1, &Entry));
+  UT_ASSERT_EQUAL (Entry.String[0], '\0');
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for overwriting the oldest records once the ring wraps.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RingWrapKeepsNewestRecords (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_RING       *RingCntx;
+  PERF_RECORD_RING_ENTRY  Entry;
+  UINT64                  First;
+  UINT32                  Count;
+  UINT64                  Index;
+
+  RingCntx = (TEST_CONTEXT_RING *)Context;
+
+  for (Index = 0; Index < TEST_RING_ENTRY_COUNT + 10; Index++) {
+    PerfRecordRingWrite (&RingCntx->Ring, NULL, NULL, "Wrap", Index, 0x40);
+  }
+
+  PerfRecordRingGetRange (&RingCntx->Ring, &First, &Count);
+  UT_ASSERT_EQUAL (First, 10);
+  UT_ASSERT_EQUAL (Count, TEST_RING_ENTRY_COUNT);
+
+  // The overwritten records must not be readable under their old index
+  for (Index = 0; Index < First; Index++) {
+    UT_ASSERT_FALSE (PerfRecordRingRead (&RingCntx->Ring, Index, &Entry));
+  }
+
+  for (Index = First; Index < First + Count; Index++) {
+    UT_ASSERT_TRUE (PerfRecordRingRead (&RingCntx->Ring, Index, &Entry));
+    UT_ASSERT_EQUAL (Entry.Timestamp, Index);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for rejecting a record whose slot is being rewritten.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RingReadRejectsSlotInFlight (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_RING       *RingCntx;
+  PERF_RECORD_RING_ENTRY  Entry;
+
+  RingCntx = (TEST_CONTEXT_RING *)Context;
+
+  PerfRecordRingWrite (&RingCntx->Ring, NULL, NULL, "InFlight", 1, 0x40);
+  UT_ASSERT_TRUE (PerfRecordRingRead (&RingCntx->Ring, 0, &Entry));
+
+  // Emulate a producer that claimed the slot but has not published it yet
+  RingCntx->Ring.Entries[0].Sequence = PERF_RECORD_SEQUENCE_BUSY (0);
+  UT_ASSERT_FALSE (PerfRecordRingRead (&RingCntx->Ring, 0, &Entry));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unit test for writers a full lap apart racing for the same slot.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RingWriteSkipsSlotOwnedByLappedWriter (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_RING       *RingCntx;
+  PERF_RECORD_RING_ENTRY  Entry;
+  UINT64                  Index;
+
+  RingCntx = (TEST_CONTEXT_RING *)Context;
+
+  for (Index = 0; Index < TEST_RING_ENTRY_COUNT; Index++) {
+    PerfRecordRingWrite (&RingCntx->Ring, NULL, NULL, "First", Index, 0x40);
+  }
+
+  // Emulate the writer of record 0 still copying its payload when the ring wraps onto its slot
+  RingCntx->Ring.Entries[0].Sequence = PERF_RECORD_SEQUENCE_BUSY (0);
+  PerfRecordRingWrite (&RingCntx->Ring, NULL, NULL, "Second", TEST_RING_ENTRY_COUNT, 0x41);
+  UT_ASSERT_EQUAL (RingCntx->Ring.Entries[0].Sequence, PERF_RECORD_SEQUENCE_BUSY (0));
+  UT_ASSERT_EQUAL (RingCntx->Ring.Entries[0].Timestamp, 0);
+  UT_ASSERT_FALSE (PerfRecordRingRead (&RingCntx->Ring, TEST_RING_ENTRY_COUNT, &Entry));
+
+  // Once the first writer publishes, its record is the one the slot holds
+  RingCntx->Ring.Entries[0].Sequence = PERF_RECORD_SEQUENCE_PUBLISHED (0);
+  UT_ASSERT_TRUE (PerfRecordRingRead (&RingCntx->Ring, 0, &Entry));
+  UT_ASSERT_EQUAL (AsciiStrCmp (Entry.String, "First"), 0);
+
+  // A writer a lap behind a record that is already published must not replace it
+  RingCntx->Ring.Entries[1].Sequence = PERF_RECORD_SEQUENCE_PUBLISHED (TEST_RING_ENTRY_COUNT * 2 + 1);
+  PerfRecordRingWrite (&RingCntx->Ring, NULL, NULL, "Third", TEST_RING_ENTRY_COUNT + 1, 0x42);
+  UT_ASSERT_EQUAL (RingCntx->Ring.Entries[1].Sequence, PERF_RECORD_SEQUENCE_PUBLISHED (TEST_RING_ENTRY_COUNT * 2 + 1));
+  UT_ASSERT_EQUAL (RingCntx->Ring.Entries[1].Timestamp, 1);
+
+  // Writers that find their slot free of other writers publish as usual
+  PerfRecordRingWrite (&RingCntx->Ring, NULL, NULL, "Fourth", TEST_RING_ENTRY_COUNT + 2, 0x43);
+  UT_ASSERT_TRUE (PerfRecordRingRead (&RingCntx->Ring, TEST_RING_ENTRY_COUNT + 2, &Entry));
+  UT_ASSERT_EQUAL (Entry.Timestamp, TEST_RING_ENTRY_COUNT + 2);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Benchmark of PerfRecordRingWrite (), logging the time taken to record one event.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RingWriteBenchmark (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_RING  *RingCntx;
+  struct timespec    Start;
+  struct timespec    End;
+  UINT64             ElapsedNs;
+  UINT64             NsPerEvent;
+  UINT32             Index;
+
+  RingCntx = (TEST_CONTEXT_RING *)Context;
+
+  UT_ASSERT_EQUAL (timespec_get (&Start, TIME_UTC), TIME_UTC);
+  for (Index = 0; Index < TEST_BENCHMARK_RECORD_COUNT; Index++) {
+    PerfRecordRingWrite (&RingCntx->Ring, &mTestCallerGuid, NULL, "Benchmark", Index, 0x40);
+  }
+
+  UT_ASSERT_EQUAL (timespec_get (&End, TIME_UTC), TIME_UTC);
+
+  ElapsedNs  = (UINT64)(End.tv_sec - Start.tv_sec) * 1000000000ULL + (UINT64)End.tv_nsec - (UINT64)Start.tv_nsec;
+  NsPerEvent = ElapsedNs / TEST_BENCHMARK_RECORD_COUNT;
+  UT_LOG_INFO ("Recorded %d events in %ld ns, %ld ns per event\n", TEST_BENCHMARK_RECORD_COUNT, ElapsedNs, NsPerEvent);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  record ring and run the record ring unit test.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      RingTests;
+  TEST_CONTEXT_RING           RingContext;
+
+  Framework          = NULL;
+  RingContext.Buffer = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the record ring Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&RingTests, Framework, "Performance Record Ring Tests", "MmSupervisorRing3PerformanceLib.Ring", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for RingTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (RingTests, "Ring should round its capacity down to a power of two", "Initialize", RingInitializeRoundsDownToPowerOfTwo, NULL, NULL, NULL);
+  AddTestCase (RingTests, "Ring should return the records written to it", "WriteRead", RingWriteThenReadBack, CreateTestRing, FreeTestRing, &RingContext);
+  AddTestCase (RingTests, "Ring should truncate long record strings", "Truncate", RingWriteTruncatesString, CreateTestRing, FreeTestRing, &RingContext);
+  AddTestCase (RingTests, "Ring should keep the newest records once it wraps", "Wrap", RingWrapKeepsNewestRecords, CreateTestRing, FreeTestRing, &RingContext);
+  AddTestCase (RingTests, "Ring should reject records that are being written", "InFlight", RingReadRejectsSlotInFlight, CreateTestRing, FreeTestRing, &RingContext);
+  AddTestCase (RingTests, "Ring should not tear a record owned by a lapped writer", "Lapped", RingWriteSkipsSlotOwnedByLappedWriter, CreateTestRing, FreeTestRing, &RingContext);
+  AddTestCase (RingTests, "Ring should report the time taken to record an event", "Benchmark", RingWriteBenchmark, CreateTestRing, FreeTestRing, &RingContext);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
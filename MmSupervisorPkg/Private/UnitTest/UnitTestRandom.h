@@ -0,0 +1,57 @@
+/** @file
+  Deterministic pseudo random numbers shared by the host based unit tests of the package.
+
+  Each test seeds mRandomState before generating its inputs, so that a failure reproduces with
+  the same inputs on every run.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef UNIT_TEST_RANDOM_H_
+#define UNIT_TEST_RANDOM_H_
+
+//
+// State of the xorshift sequence, must not be 0.
+//
+STATIC UINT64  mRandomState;
+
+/**
+  Get the next number of the deterministic random sequence of the tests.
+
+  @return A pseudo random number.
+
+**/
+STATIC
+INLINE
+UINT64
+NextRandom (
+  VOID
+  )
+{
+  mRandomState ^= mRandomState << 13;
+  mRandomState ^= mRandomState >> 7;
+  mRandomState ^= mRandomState << 17;
+  return mRandomState;
+}
+
+/**
+  Get a pseudo random number below a limit.
+
+  @param[in]  Limit  The exclusive upper bound, must not be 0.
+
+  @return A pseudo random number below Limit.
+
+**/
+STATIC
+INLINE
+UINTN
+RandomBelow (
+  IN UINTN  Limit
+  )
+{
+  return (UINTN)(NextRandom () % Limit);
+}
+
+#endif
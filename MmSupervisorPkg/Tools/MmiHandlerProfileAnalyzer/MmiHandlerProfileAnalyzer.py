@@ -0,0 +1,125 @@
+# @file
+# CLI tool to analyze SMI handler profile databases offline.
+#  summary     Per handler and per image tables of a database
+#  flamegraph  Folded stacks of a database, for flamegraph.pl or speedscope, optionally
+#              weighted by a handler latency dump
+#  diff        Handlers and images added, removed or resized between two databases
+#
+# Copyright (c) Microsoft Corporation
+#
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+##
+
+import logging
+import os
+import sys
+from argparse import ArgumentParser
+from contextlib import nullcontext
+
+#get script path
+sp = os.path.dirname(os.path.realpath(__file__))
+
+#setup python path for build modules
+sys.path.append(sp)
+
+from mmi_handler_profile import *
+from pdb_symbols import PdbSearchPath
+
+
+def LoadAndResolve(path: str, pdb_search: PdbSearchPath):
+    ''' Parse a database file and resolve every handler in it '''
+    logging.debug(f"Parsing {path}")
+    db = ProfileDatabase.from_file(path)
+    rows = resolve_handlers(db, AddressResolver(db, pdb_search))
+    logging.debug(f"{len(db.images)} images, {len(rows)} handlers")
+    return (db, rows)
+
+
+def OpenOutput(path: str):
+    ''' Open path for writing, or stdout when no path is given '''
+    if path is None:
+        return nullcontext(sys.stdout)
+    return open(path, "w", newline="")
+
+
+def main(argv=None) -> int:
+    parser = ArgumentParser(description="Analyze SMI handler profile databases")
+    parser.add_argument("-p", "--PdbPath", dest="PdbPath", action="append", default=[],
+                        help="Directory searched for the PDBs named in the database.  Can be given more than once.")
+    parser.add_argument("--debug", action="store_true", dest="debug", help="Turn on debug logging", default=False)
+    sub = parser.add_subparsers(dest="Command", required=True)
+
+    summary = sub.add_parser("summary", help="Per handler and per image tables")
+    summary.add_argument("Database", help="Binary SMI handler profile database")
+    summary.add_argument("-o", "--Output", dest="Output", help="Output file (default is stdout)", default=None)
+    summary.add_argument("--csv", action="store_true", dest="Csv", help="Write the handler table as CSV", default=False)
+
+    flamegraph = sub.add_parser("flamegraph", help="Folded stacks weighted by handler registrations or latency")
+    flamegraph.add_argument("Database", help="Binary SMI handler profile database")
+    flamegraph.add_argument("-o", "--Output", dest="Output", help="Output file (default is stdout)", default=None)
+    flamegraph.add_argument("-l", "--Latency", dest="Latency", default=None,
+                            help="Binary handler latency dump.  Weights the stacks by handler ticks.")
+    flamegraph.add_argument("--invocations", action="store_true", dest="Invocations", default=False,
+                            help="Weight the stacks by handler invocations instead of ticks, with --Latency")
+
+    diff = sub.add_parser("diff", help="Differences between two databases.  Returns 1 when they differ.")
+    diff.add_argument("Old", help="Baseline binary SMI handler profile database")
+    diff.add_argument("New", help="Binary SMI handler profile database compared to the baseline")
+    diff.add_argument("-o", "--Output", dest="Output", help="Output file (default is stdout)", default=None)
+
+    args = parser.parse_args(argv)
+    if args.debug:
+        for handler in logging.getLogger('').handlers:
+            handler.setLevel(logging.DEBUG)
+
+    for path in args.PdbPath:
+        if not os.path.isdir(path):
+            logging.critical(f"Invalid PDB path {path}")
+            return -1
+    pdb_search = PdbSearchPath(args.PdbPath)
+
+    try:
+        if args.Command == "diff":
+            (old_db, old_rows) = LoadAndResolve(args.Old, pdb_search)
+            (new_db, new_rows) = LoadAndResolve(args.New, pdb_search)
+            with OpenOutput(args.Output) as out:
+                return 1 if write_diff(old_db, old_rows, new_db, new_rows, out) else 0
+
+        (db, rows) = LoadAndResolve(args.Database, pdb_search)
+        latency = None
+        if getattr(args, "Latency", None) is not None:
+            latency = load_latency_file(args.Latency)
+            missing = unmatched_latency(rows, latency)
+            if missing:
+                logging.warning(f"{len(missing)} handlers of {args.Latency} are not in {args.Database}")
+
+        with OpenOutput(args.Output) as out:
+            if args.Command == "flamegraph":
+                weight = "invocation_count" if args.Invocations else "total_ticks"
+                write_folded(folded_stacks(rows, latency, weight), out)
+            elif args.Csv:
+                write_handler_csv(rows, out)
+            else:
+                write_handler_table(rows, out)
+                out.write("\n")
+                write_image_table(rows, out)
+    except (OSError, ProfileFormatError) as e:
+        logging.critical(str(e))
+        return -1
+
+    return 0
+
+
+if __name__ == "__main__":
+    # setup main console as logger
+    logger = logging.getLogger('')
+    logger.setLevel(logging.NOTSET)
+    console = logging.StreamHandler()
+    formatter = logging.Formatter("%(levelname)s - %(message)s")
+    console.setFormatter(formatter)
+    console.setLevel(logging.WARNING)
+    logger.addHandler(console)
+    # call main worker function
+    retcode = main()
+    logging.shutdown()
+    sys.exit(retcode)
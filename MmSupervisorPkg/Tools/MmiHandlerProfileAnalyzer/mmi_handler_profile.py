@@ -0,0 +1,543 @@
+# @file
+# Library to parse and report on an SMI handler profile database.
+#
+# The database is the buffer returned by SMI_HANDLER_PROFILE_COMMAND_GET_DATA, the
+# same data MmiHandlerProfileInfo prints: a sequence of image records and SMI
+# entry records as defined in MdeModulePkg/Include/Guid/SmiHandlerProfile.h.
+#
+# The optional latency dump is the array of SMI_HANDLER_LATENCY_RECORDs returned by
+# SMI_HANDLER_PROFILE_COMMAND_GET_LATENCY_BY_OFFSET, as defined in
+# MmSupervisorPkg/Include/Guid/SmiHandlerProfileLatency.h.
+#
+# Copyright (c) Microsoft Corporation
+#
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+##
+
+import bisect
+import csv
+import struct
+import uuid
+from collections import Counter
+from dataclasses import dataclass, field, replace
+from enum import IntEnum
+from typing import IO
+
+from pdb_symbols import PdbSearchPath
+
+# SIGNATURE_32 ('S','C','I','D') and SIGNATURE_32 ('S','C','S','D')
+SMM_CORE_IMAGE_DATABASE_SIGNATURE = b"SCID"
+SMM_CORE_SMI_DATABASE_SIGNATURE = b"SCSD"
+
+# SMM_CORE_DATABASE_COMMON_HEADER
+#   UINT32 Signature; UINT32 Length; UINT32 Revision;
+COMMON_HEADER = struct.Struct("<4sII")
+
+# SMM_CORE_IMAGE_DATABASE_STRUCTURE
+#   SMM_CORE_DATABASE_COMMON_HEADER Header; EFI_GUID FileGuid; PHYSICAL_ADDRESS EntryPoint;
+#   PHYSICAL_ADDRESS ImageBase; UINT64 ImageSize; UINT32 ImageRef; UINT16 PdbStringOffset;
+#   UINT8 Reserved[2]; CHAR8 PdbString[];
+IMAGE_RECORD = struct.Struct("<4sII16s4xQQQIH2x")
+
+# SMM_CORE_SMI_DATABASE_STRUCTURE
+#   SMM_CORE_DATABASE_COMMON_HEADER Header; EFI_GUID HandlerType; UINT32 HandlerCategory;
+#   UINT32 HandlerCount; SMM_CORE_SMI_HANDLER_STRUCTURE Handler[HandlerCount];
+SMI_RECORD = struct.Struct("<4sII16sII")
+
+# SMM_CORE_SMI_HANDLER_STRUCTURE
+#   UINT32 Length; UINT32 ImageRef; PHYSICAL_ADDRESS CallerAddr; PHYSICAL_ADDRESS Handler;
+#   UINT16 ContextBufferOffset; UINT8 Reserved[2]; UINT32 ContextBufferSize; UINT8 ContextBuffer[];
+HANDLER_RECORD = struct.Struct("<IIQQH2xI")
+
+# SMI_HANDLER_LATENCY_RECORD
+#   EFI_GUID HandlerType; UINT64 Handler; UINT64 CallerAddress; UINT32 IsSupervisor; UINT32 Reserved;
+#   UINT64 InvocationCount; UINT64 TotalTicks; UINT64 MaxTicks; UINT64 Histogram[SMI_HANDLER_LATENCY_BUCKET_COUNT];
+SMI_HANDLER_LATENCY_BUCKET_COUNT = 32
+LATENCY_RECORD = struct.Struct(f"<16sQQI4xQQQ{SMI_HANDLER_LATENCY_BUCKET_COUNT}Q")
+
+PROFILE_NAME_STRING_LENGTH = 64
+
+
+class ProfileFormatError(ValueError):
+    ''' The SMI handler profile database is malformed '''
+    pass
+
+
+class SmiHandlerCategory(IntEnum):
+    ''' SMM_CORE_SMI_HANDLER_CATEGORY '''
+    RootSmi = 0
+    GuidSmi = 1
+    HardwareSmi = 2
+
+
+CATEGORY_NAMES = [c.name for c in SmiHandlerCategory]
+
+
+def _enum_string(names: list, value: int) -> str:
+    return names[value] if 0 <= value < len(names) else f"0x{value:x}"
+
+
+SX_TYPE = ["SxS0", "SxS1", "SxS2", "SxS3", "SxS4", "SxS5"]
+SX_PHASE = ["SxEntry", "SxExit"]
+POWER_BUTTON_PHASE = ["PowerButtonEntry", "PowerButtonExit"]
+STANDBY_BUTTON_PHASE = ["StandbyButtonEntry", "StandbyButtonExit"]
+IO_TRAP_TYPE = ["WriteTrap", "ReadTrap", "ReadWriteTrap"]
+USB_TYPE = ["UsbLegacy", "UsbWake"]
+
+
+def _sw_context(c: bytes) -> str:
+    (value,) = struct.unpack_from("<Q", c)
+    return f"SwSmi=0x{value:x}"
+
+
+def _sx_context(c: bytes) -> str:
+    (sx_type, phase) = struct.unpack_from("<II", c)
+    return f"SxType={_enum_string(SX_TYPE, sx_type)} SxPhase={_enum_string(SX_PHASE, phase)}"
+
+
+def _power_button_context(c: bytes) -> str:
+    (phase,) = struct.unpack_from("<I", c)
+    return f"PowerButtonPhase={_enum_string(POWER_BUTTON_PHASE, phase)}"
+
+
+def _standby_button_context(c: bytes) -> str:
+    (phase,) = struct.unpack_from("<I", c)
+    return f"StandbyButtonPhase={_enum_string(STANDBY_BUTTON_PHASE, phase)}"
+
+
+def _periodic_timer_context(c: bytes) -> str:
+    (period, interval) = struct.unpack_from("<QQ", c)
+    return f"PeriodicTimerPeriod={period} PeriodicTimerSmiTickInterval={interval}"
+
+
+def _gpi_context(c: bytes) -> str:
+    (gpi,) = struct.unpack_from("<Q", c)
+    return f"GpiNum=0x{gpi:x}"
+
+
+def _io_trap_context(c: bytes) -> str:
+    (address, length, trap_type) = struct.unpack_from("<HHI", c)
+    return f"IoTrapAddress=0x{address:x} IoTrapLength=0x{length:x} IoTrapType={_enum_string(IO_TRAP_TYPE, trap_type)}"
+
+
+def _usb_context(c: bytes) -> str:
+    # SMI_HANDLER_PROFILE_USB_REGISTER_CONTEXT, followed by DevicePathSize bytes of device path
+    (usb_type, path_size) = struct.unpack_from("<II", c)
+    return f"UsbType={_enum_string(USB_TYPE, usb_type)} UsbDevicePath={c[8:8 + path_size].hex()}"
+
+
+# HandlerType GUID -> (name, context decoder)
+HANDLER_TYPES = {
+    uuid.UUID("18a3c6dc-5eea-48c8-a1c1-b53389f98999"): ("SwDispatch2", _sw_context),
+    uuid.UUID("456d2859-a84b-4e47-a2ee-3276d886997d"): ("SxDispatch2", _sx_context),
+    uuid.UUID("1b1183fa-1823-46a7-8872-9c578755409d"): ("PowerButtonDispatch2", _power_button_context),
+    uuid.UUID("7300c4a1-43f2-4017-a51b-c81a7f40585b"): ("StandbyButtonDispatch2", _standby_button_context),
+    uuid.UUID("4cec368e-8e8e-4d71-8be1-958c45fc8a53"): ("PeriodicTimerDispatch2", _periodic_timer_context),
+    uuid.UUID("25566b03-b577-4cbf-958c-ed663ea24380"): ("GpiDispatch2", _gpi_context),
+    uuid.UUID("58dc368d-7bfa-4e77-abbc-0e29418df930"): ("IoTrapDispatch2", _io_trap_context),
+    uuid.UUID("ee9b8d90-c5a6-40a2-bde2-52558d33ccdb"): ("UsbDispatch2", _usb_context),
+}
+
+
+def handler_type_name(handler_type: uuid.UUID) -> str:
+    ''' Friendly name of a HandlerType GUID, empty for root handlers '''
+    if handler_type.int == 0:
+        return ""
+    if handler_type in HANDLER_TYPES:
+        return HANDLER_TYPES[handler_type][0]
+    return str(handler_type)
+
+
+def decode_context(handler_type: uuid.UUID, context: bytes) -> str:
+    ''' Decode a handler context the way MmiHandlerProfileInfo does, falling back to hex '''
+    if not context:
+        return ""
+    if handler_type in HANDLER_TYPES:
+        try:
+            return HANDLER_TYPES[handler_type][1](context)
+        except struct.error:
+            pass
+    return f"Context={context.hex()}"
+
+
+def short_pdb_name(pdb_path: str) -> str:
+    ''' File name of the PDB without its extension, as GetShortPdbFileName computes it '''
+    name = pdb_path.replace("\\", "/").rsplit("/", 1)[-1]
+    if "." in name:
+        name = name[:name.rindex(".")]
+    return name[:PROFILE_NAME_STRING_LENGTH]
+
+
+@dataclass
+class ImageRecord(object):
+    ''' One SMM_CORE_IMAGE_DATABASE_STRUCTURE '''
+    file_guid: uuid.UUID
+    entry_point: int
+    image_base: int
+    image_size: int
+    image_ref: int
+    pdb_path: str
+
+    @property
+    def name(self) -> str:
+        if self.pdb_path:
+            return short_pdb_name(self.pdb_path)
+        return str(self.file_guid)
+
+
+@dataclass
+class HandlerRecord(object):
+    ''' One SMM_CORE_SMI_HANDLER_STRUCTURE '''
+    image_ref: int
+    caller_addr: int
+    handler: int
+    context: bytes
+
+
+@dataclass
+class SmiEntry(object):
+    ''' One SMM_CORE_SMI_DATABASE_STRUCTURE with its handlers '''
+    handler_type: uuid.UUID
+    category: int
+    handlers: list
+
+
+@dataclass
+class LatencyRecord(object):
+    ''' One SMI_HANDLER_LATENCY_RECORD '''
+    handler_type: uuid.UUID
+    handler: int
+    caller_addr: int
+    is_supervisor: bool
+    invocation_count: int
+    total_ticks: int
+    max_ticks: int
+    histogram: tuple
+
+
+def _read_exact(stream: IO[bytes], size: int, offset: int) -> bytes:
+    data = stream.read(size)
+    if len(data) != size:
+        raise ProfileFormatError(f"Record at 0x{offset:x} is truncated")
+    return data
+
+
+def _parse_image(record: bytes, offset: int) -> ImageRecord:
+    if len(record) < IMAGE_RECORD.size:
+        raise ProfileFormatError(f"Image record at 0x{offset:x} is too short")
+    (_, _, _, file_guid, entry_point, image_base, image_size, image_ref, pdb_offset) = \
+        IMAGE_RECORD.unpack_from(record)
+
+    pdb_path = ""
+    if pdb_offset != 0:
+        if pdb_offset >= len(record):
+            raise ProfileFormatError(f"Image record at 0x{offset:x} has its PDB string outside the record")
+        end = record.find(b"\0", pdb_offset)
+        pdb_path = record[pdb_offset:end if end >= 0 else len(record)].decode("ascii", "replace")
+
+    return ImageRecord(uuid.UUID(bytes_le=file_guid), entry_point, image_base, image_size, image_ref, pdb_path)
+
+
+def _parse_smi(record: bytes, offset: int) -> SmiEntry:
+    if len(record) < SMI_RECORD.size:
+        raise ProfileFormatError(f"SMI record at 0x{offset:x} is too short")
+    (_, _, _, handler_type, category, count) = SMI_RECORD.unpack_from(record)
+
+    handlers = []
+    pos = SMI_RECORD.size
+    for _ in range(count):
+        if pos + HANDLER_RECORD.size > len(record):
+            raise ProfileFormatError(f"SMI record at 0x{offset:x} has more handlers than fit in it")
+        (length, image_ref, caller, handler, context_offset, context_size) = HANDLER_RECORD.unpack_from(record, pos)
+        if length < HANDLER_RECORD.size or pos + length > len(record):
+            raise ProfileFormatError(f"Handler at 0x{offset + pos:x} has an invalid length")
+
+        context = b""
+        if context_size != 0:
+            if context_offset + context_size > length:
+                raise ProfileFormatError(f"Handler at 0x{offset + pos:x} has its context outside the record")
+            context = record[pos + context_offset:pos + context_offset + context_size]
+
+        handlers.append(HandlerRecord(image_ref, caller, handler, context))
+        pos += length
+
+    return SmiEntry(uuid.UUID(bytes_le=handler_type), category, handlers)
+
+
+def iter_records(stream: IO[bytes]):
+    ''' Yield an ImageRecord or SmiEntry for each record of the database in stream.
+
+        Records are read one at a time, so memory is bounded by the largest record rather
+        than the database.  Records with an unknown signature are skipped by their length.
+    '''
+    offset = 0
+    while True:
+        header = stream.read(COMMON_HEADER.size)
+        if not header:
+            return
+        if len(header) < COMMON_HEADER.size:
+            raise ProfileFormatError(f"Record header at 0x{offset:x} is truncated")
+
+        (signature, length, _) = COMMON_HEADER.unpack(header)
+        if length < COMMON_HEADER.size:
+            raise ProfileFormatError(f"Record at 0x{offset:x} has an invalid length 0x{length:x}")
+        record = header + _read_exact(stream, length - COMMON_HEADER.size, offset)
+
+        if signature == SMM_CORE_IMAGE_DATABASE_SIGNATURE:
+            yield _parse_image(record, offset)
+        elif signature == SMM_CORE_SMI_DATABASE_SIGNATURE:
+            yield _parse_smi(record, offset)
+        offset += length
+
+
+def iter_latency_records(stream: IO[bytes]):
+    ''' Yield a LatencyRecord for each record of the latency dump in stream '''
+    offset = 0
+    while True:
+        record = stream.read(LATENCY_RECORD.size)
+        if not record:
+            return
+        if len(record) < LATENCY_RECORD.size:
+            raise ProfileFormatError(f"Latency record at 0x{offset:x} is truncated")
+
+        fields = LATENCY_RECORD.unpack(record)
+        (handler_type, handler, caller, is_supervisor, count, total, maximum) = fields[:7]
+        yield LatencyRecord(uuid.UUID(bytes_le=handler_type), handler, caller, is_supervisor != 0, count, total,
+                            maximum, fields[7:])
+        offset += LATENCY_RECORD.size
+
+
+def load_latency(stream: IO[bytes]) -> dict:
+    ''' Return the LatencyRecord of every handler in a latency dump, keyed like HandlerRow.key.
+
+        Handlers registered more than once with the same key are summed into one record.
+    '''
+    latency = {}
+    for record in iter_latency_records(stream):
+        key = (record.handler_type, record.handler, record.caller_addr)
+        if key in latency:
+            other = latency[key]
+            record = replace(record,
+                             invocation_count=other.invocation_count + record.invocation_count,
+                             total_ticks=other.total_ticks + record.total_ticks,
+                             max_ticks=max(other.max_ticks, record.max_ticks),
+                             histogram=tuple(a + b for (a, b) in zip(other.histogram, record.histogram)))
+        latency[key] = record
+    return latency
+
+
+def load_latency_file(path: str) -> dict:
+    with open(path, "rb") as f:
+        return load_latency(f)
+
+
+class ProfileDatabase(object):
+    ''' The images and SMI entries of one SMI handler profile database '''
+
+    def __init__(self):
+        self.images = {}
+        self.entries = []
+
+    @classmethod
+    def load(cls, stream: IO[bytes]):
+        db = cls()
+        for record in iter_records(stream):
+            if isinstance(record, ImageRecord):
+                db.images[record.image_ref] = record
+            else:
+                db.entries.append(record)
+        return db
+
+    @classmethod
+    def from_file(cls, path: str):
+        with open(path, "rb") as f:
+            return cls.load(f)
+
+    def handlers(self):
+        ''' Yield (SmiEntry, HandlerRecord) for every handler '''
+        for entry in self.entries:
+            for handler in entry.handlers:
+                yield (entry, handler)
+
+
+class AddressResolver(object):
+    ''' Turn addresses into image names and symbols.
+
+        Symbols come from the PDB each image records, located through pdb_search.  Without a
+        PDB the image relative address is reported instead.
+    '''
+
+    def __init__(self, db: ProfileDatabase, pdb_search: PdbSearchPath = None):
+        self._db = db
+        self._pdb_search = pdb_search
+        self._images = sorted(db.images.values(), key=lambda i: i.image_base)
+        self._bases = [i.image_base for i in self._images]
+
+    def image_at(self, address: int, image_ref: int = None):
+        ''' Image containing address, preferring the image with image_ref '''
+        image = self._db.images.get(image_ref)
+        if image is not None and image.image_base <= address < image.image_base + image.image_size:
+            return image
+        i = bisect.bisect_right(self._bases, address) - 1
+        if i >= 0 and address < self._images[i].image_base + self._images[i].image_size:
+            return self._images[i]
+        return image
+
+    def symbol(self, address: int, image_ref: int = None) -> tuple:
+        ''' Return (image name, symbol) for address '''
+        image = self.image_at(address, image_ref)
+        if image is None:
+            return ("", f"0x{address:x}")
+
+        rva = address - image.image_base
+        if self._pdb_search is not None and 0 <= rva < image.image_size:
+            symbols = self._pdb_search.find(image.pdb_path)
+            found = symbols.lookup(rva) if symbols is not None else None
+            if found is not None:
+                (name, displacement) = found
+                return (image.name, f"{name}+0x{displacement:x}" if displacement else name)
+        return (image.name, f"0x{rva:x}")
+
+
+@dataclass(frozen=True)
+class HandlerRow(object):
+    ''' One handler with every address resolved, independent of where the images loaded '''
+    category: str
+    handler_type: str
+    context: str
+    image: str
+    handler: str
+    caller: str
+    # (handler type, handler, caller) as recorded, to look the handler up in a latency dump
+    key: tuple = field(default=None, compare=False)
+
+
+def resolve_handlers(db: ProfileDatabase, resolver: AddressResolver) -> list:
+    ''' Return a HandlerRow for every handler in db, in database order '''
+    rows = []
+    for (entry, handler) in db.handlers():
+        (image, handler_symbol) = resolver.symbol(handler.handler, handler.image_ref)
+        (_, caller_symbol) = resolver.symbol(handler.caller_addr, handler.image_ref)
+        rows.append(HandlerRow(
+            _enum_string(CATEGORY_NAMES, entry.category),
+            handler_type_name(entry.handler_type),
+            decode_context(entry.handler_type, handler.context),
+            image,
+            handler_symbol,
+            caller_symbol,
+            (entry.handler_type, handler.handler, handler.caller_addr)))
+    return rows
+
+
+HANDLER_COLUMNS = ["Category", "HandlerType", "Context", "Image", "Handler", "Caller"]
+
+
+def _write_table(out: IO[str], header: list, rows: list):
+    widths = [len(h) for h in header]
+    for row in rows:
+        widths = [max(w, len(str(c))) for (w, c) in zip(widths, row)]
+    for row in [header, ["-" * w for w in widths]] + rows:
+        out.write("  ".join(str(c).ljust(w) for (c, w) in zip(row, widths)).rstrip() + "\n")
+
+
+def write_handler_table(rows: list, out: IO[str]):
+    ''' One line per handler '''
+    _write_table(out, HANDLER_COLUMNS,
+                 [[r.category, r.handler_type, r.context, r.image, r.handler, r.caller] for r in rows])
+
+
+def write_handler_csv(rows: list, out: IO[str]):
+    writer = csv.writer(out, lineterminator="\n")
+    writer.writerow(HANDLER_COLUMNS)
+    for r in rows:
+        writer.writerow([r.category, r.handler_type, r.context, r.image, r.handler, r.caller])
+
+
+def write_image_table(rows: list, out: IO[str]):
+    ''' Handler count of every image per category, busiest image first '''
+    counts = {}
+    for r in rows:
+        counts.setdefault(r.image, Counter())[r.category] += 1
+    table = [[image or "???"] + [c[k] for k in CATEGORY_NAMES] + [sum(c.values())]
+             for (image, c) in counts.items()]
+    table.sort(key=lambda t: (-t[-1], t[0]))
+    _write_table(out, ["Image"] + CATEGORY_NAMES + ["Total"], table)
+
+
+def _frame(name: str) -> str:
+    # ';' separates frames in the folded format, and the count ends the line.
+    return name.replace(";", ":").replace("\n", " ") or "???"
+
+
+def folded_stacks(rows: list, latency: dict = None, weight: str = "total_ticks") -> Counter:
+    ''' Folded stacks of category, handler type, image and handler.
+
+        Stacks are weighted by registrations, or with a latency dump by the weight field
+        (total_ticks or invocation_count) of each handler.  Handlers without latency are left out.
+    '''
+    stacks = Counter()
+    weighted = set()
+    for r in rows:
+        frames = [r.category] + ([r.handler_type] if r.handler_type else []) + [r.image, r.handler]
+        stack = ";".join(_frame(f) for f in frames)
+        if latency is None:
+            stacks[stack] += 1
+        elif r.key in latency and r.key not in weighted:
+            # The dump already sums handlers registered more than once with the same key.
+            weighted.add(r.key)
+            if getattr(latency[r.key], weight):
+                stacks[stack] += getattr(latency[r.key], weight)
+    return stacks
+
+
+def unmatched_latency(rows: list, latency: dict) -> list:
+    ''' LatencyRecords of handlers that are not in the database '''
+    keys = {r.key for r in rows}
+    return [record for (key, record) in latency.items() if key not in keys]
+
+
+def write_folded(stacks: Counter, out: IO[str]):
+    ''' Write stacks in the input format of flamegraph.pl, speedscope and inferno '''
+    for stack in sorted(stacks):
+        out.write(f"{stack} {stacks[stack]}\n")
+
+
+def _handler_key(r: HandlerRow) -> tuple:
+    # The caller is left out so rebuilds that only move the registration call do not show up.
+    return (r.category, r.handler_type, r.context, r.image, r.handler)
+
+
+def diff_handlers(old_rows: list, new_rows: list) -> tuple:
+    ''' Return (added, removed) Counters of handler keys between two dumps '''
+    old = Counter(_handler_key(r) for r in old_rows)
+    new = Counter(_handler_key(r) for r in new_rows)
+    return (new - old, old - new)
+
+
+def diff_images(old_db: ProfileDatabase, new_db: ProfileDatabase) -> tuple:
+    ''' Return (added, removed, resized) image names, resized as (name, old size, new size) '''
+    old = {i.name: i.image_size for i in old_db.images.values()}
+    new = {i.name: i.image_size for i in new_db.images.values()}
+    added = sorted(set(new) - set(old))
+    removed = sorted(set(old) - set(new))
+    resized = sorted((n, old[n], new[n]) for n in set(old) & set(new) if old[n] != new[n])
+    return (added, removed, resized)
+
+
+def write_diff(old_db: ProfileDatabase, old_rows: list, new_db: ProfileDatabase, new_rows: list, out: IO[str]) -> bool:
+    ''' Write the differences between two dumps, returning True when there are any '''
+    (images_added, images_removed, images_resized) = diff_images(old_db, new_db)
+    (added, removed) = diff_handlers(old_rows, new_rows)
+
+    for name in images_added:
+        out.write(f"+ Image {name}\n")
+    for name in images_removed:
+        out.write(f"- Image {name}\n")
+    for (name, old_size, new_size) in images_resized:
+        out.write(f"~ Image {name} 0x{old_size:x} -> 0x{new_size:x}\n")
+    for (sign, keys) in (("+", added), ("-", removed)):
+        for key in sorted(keys):
+            line = " ".join(k for k in key if k)
+            out.write(f"{sign} Handler {line}" + (f" (x{keys[key]})\n" if keys[key] > 1 else "\n"))
+
+    return bool(images_added or images_removed or images_resized or added or removed)
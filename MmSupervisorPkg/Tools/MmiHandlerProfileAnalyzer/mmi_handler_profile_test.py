@@ -0,0 +1,447 @@
+# @file
+# unit tests for mmi_handler_profile and the MmiHandlerProfileAnalyzer CLI
+#
+# Copyright (c) Microsoft Corporation
+#
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+##
+
+from mmi_handler_profile import *
+from pdb_symbols_test import write_pdb
+import io
+import os
+import struct
+import tempfile
+import unittest
+import uuid
+
+import MmiHandlerProfileAnalyzer
+
+SW_GUID = uuid.UUID("18a3c6dc-5eea-48c8-a1c1-b53389f98999")
+SX_GUID = uuid.UUID("456d2859-a84b-4e47-a2ee-3276d886997d")
+POWER_BUTTON_GUID = uuid.UUID("1b1183fa-1823-46a7-8872-9c578755409d")
+STANDBY_BUTTON_GUID = uuid.UUID("7300c4a1-43f2-4017-a51b-c81a7f40585b")
+PERIODIC_TIMER_GUID = uuid.UUID("4cec368e-8e8e-4d71-8be1-958c45fc8a53")
+GPI_GUID = uuid.UUID("25566b03-b577-4cbf-958c-ed663ea24380")
+IO_TRAP_GUID = uuid.UUID("58dc368d-7bfa-4e77-abbc-0e29418df930")
+USB_GUID = uuid.UUID("ee9b8d90-c5a6-40a2-bde2-52558d33ccdb")
+VARIABLE_GUID = uuid.UUID("ed32d533-99e6-4209-9cc0-2d72cdd998a7")
+ZERO_GUID = uuid.UUID(int=0)
+DRIVER_FILE_GUID = uuid.UUID("12345678-1234-5678-9abc-def012345678")
+
+
+def _pad8(data: bytes) -> bytes:
+    return data + b"\0" * (-len(data) % 8)
+
+
+def image_record(ref: int, base: int, size: int, pdb: str = None, guid: uuid.UUID = DRIVER_FILE_GUID) -> bytes:
+    pdb_bytes = _pad8(pdb.encode() + b"\0") if pdb else b""
+    return IMAGE_RECORD.pack(SMM_CORE_IMAGE_DATABASE_SIGNATURE, IMAGE_RECORD.size + len(pdb_bytes), 1,
+                             guid.bytes_le, base, base, size, ref,
+                             IMAGE_RECORD.size if pdb else 0) + pdb_bytes
+
+
+def handler_record(ref: int, caller: int, handler: int, context: bytes = b"") -> bytes:
+    body = _pad8(context)
+    return HANDLER_RECORD.pack(HANDLER_RECORD.size + len(body), ref, caller, handler,
+                               HANDLER_RECORD.size if context else 0, len(context)) + body
+
+
+def smi_record(category: int, handler_type: uuid.UUID, handlers: list) -> bytes:
+    body = b"".join(handlers)
+    return SMI_RECORD.pack(SMM_CORE_SMI_DATABASE_SIGNATURE, SMI_RECORD.size + len(body), 1,
+                           handler_type.bytes_le, category, len(handlers)) + body
+
+
+def sample_database() -> bytes:
+    ''' Two drivers with root, GUID and hardware handlers '''
+    return b"".join([
+        image_record(1, 0x7F000000, 0x4000, "c:\\build\\X64\\Core\\DEBUG\\PiSmmCore.pdb"),
+        image_record(2, 0x7F100000, 0x2000, "/build/X64/Variable/DEBUG/VariableSmm.pdb"),
+        image_record(3, 0x7F200000, 0x1000),
+        smi_record(SmiHandlerCategory.RootSmi, ZERO_GUID, [
+            handler_record(1, 0x7F000100, 0x7F001010)]),
+        smi_record(SmiHandlerCategory.GuidSmi, VARIABLE_GUID, [
+            handler_record(2, 0x7F100200, 0x7F101000),
+            handler_record(2, 0x7F100200, 0x7F101000)]),
+        smi_record(SmiHandlerCategory.HardwareSmi, SW_GUID, [
+            handler_record(2, 0x7F100300, 0x7F101100, struct.pack("<Q", 0xEF)),
+            handler_record(3, 0x7F200010, 0x7F200020, struct.pack("<Q", 0x42))]),
+    ])
+
+
+def latency_record(handler_type: uuid.UUID, handler: int, caller: int, count: int, total: int,
+                   maximum: int = 0, supervisor: int = 0) -> bytes:
+    histogram = [0] * SMI_HANDLER_LATENCY_BUCKET_COUNT
+    histogram[max(total // max(count, 1), 1).bit_length() - 1] = count
+    return LATENCY_RECORD.pack(handler_type.bytes_le, handler, caller, supervisor, count, total, maximum, *histogram)
+
+
+def sample_latency() -> bytes:
+    ''' Latency of the root and GUID handlers of sample_database, the GUID handler registered twice '''
+    return b"".join([
+        latency_record(ZERO_GUID, 0x7F001010, 0x7F000100, 10, 5000, 900, 1),
+        latency_record(VARIABLE_GUID, 0x7F101000, 0x7F100200, 3, 30000, 20000),
+        latency_record(VARIABLE_GUID, 0x7F101000, 0x7F100200, 1, 40000, 40000),
+    ])
+
+
+def load(data: bytes) -> ProfileDatabase:
+    return ProfileDatabase.load(io.BytesIO(data))
+
+
+def rows_of(data: bytes, pdb_search=None) -> list:
+    db = load(data)
+    return resolve_handlers(db, AddressResolver(db, pdb_search))
+
+
+class TestParse(unittest.TestCase):
+
+    def test_images_and_handlers(self):
+        db = load(sample_database())
+        self.assertEqual(sorted(db.images), [1, 2, 3])
+        self.assertEqual(db.images[1].name, "PiSmmCore")
+        self.assertEqual(db.images[2].name, "VariableSmm")
+        self.assertEqual(db.images[2].pdb_path, "/build/X64/Variable/DEBUG/VariableSmm.pdb")
+        self.assertEqual(db.images[3].name, str(DRIVER_FILE_GUID))
+        self.assertEqual((db.images[2].image_base, db.images[2].image_size), (0x7F100000, 0x2000))
+
+        self.assertEqual([e.category for e in db.entries], [0, 1, 2])
+        self.assertEqual(db.entries[1].handler_type, VARIABLE_GUID)
+        self.assertEqual(len(list(db.handlers())), 5)
+        (entry, handler) = list(db.handlers())[3]
+        self.assertEqual(entry.handler_type, SW_GUID)
+        self.assertEqual((handler.image_ref, handler.caller_addr, handler.handler), (2, 0x7F100300, 0x7F101100))
+        self.assertEqual(handler.context, struct.pack("<Q", 0xEF))
+
+    def test_empty(self):
+        db = load(b"")
+        self.assertEqual((db.images, db.entries), ({}, []))
+
+    def test_images_after_handlers(self):
+        data = smi_record(SmiHandlerCategory.RootSmi, ZERO_GUID, [handler_record(9, 0x1010, 0x1020)]) + \
+            image_record(9, 0x1000, 0x1000, "Late.pdb")
+        self.assertEqual(rows_of(data)[0].image, "Late")
+        self.assertEqual(rows_of(data)[0].handler, "0x20")
+
+    def test_unknown_record_is_skipped(self):
+        unknown = COMMON_HEADER.pack(b"XXXX", COMMON_HEADER.size + 4, 1) + b"\xFF" * 4
+        db = load(unknown + sample_database())
+        self.assertEqual(len(db.images), 3)
+        self.assertEqual(len(list(db.handlers())), 5)
+
+    def test_short_pdb_name(self):
+        self.assertEqual(short_pdb_name("c:\\a.b\\Driver.dll.pdb"), "Driver.dll")
+        self.assertEqual(short_pdb_name("NoExtension"), "NoExtension")
+        self.assertEqual(short_pdb_name("x" * 100 + ".pdb"), "x" * PROFILE_NAME_STRING_LENGTH)
+
+    def test_truncated_header(self):
+        with self.assertRaises(ProfileFormatError):
+            load(sample_database() + b"SCID")
+
+    def test_truncated_record(self):
+        with self.assertRaises(ProfileFormatError):
+            load(sample_database()[:-1])
+
+    def test_invalid_record_length(self):
+        with self.assertRaises(ProfileFormatError):
+            load(COMMON_HEADER.pack(SMM_CORE_SMI_DATABASE_SIGNATURE, 0, 1))
+
+    def test_short_image_record(self):
+        with self.assertRaises(ProfileFormatError):
+            load(COMMON_HEADER.pack(SMM_CORE_IMAGE_DATABASE_SIGNATURE, COMMON_HEADER.size, 1))
+
+    def test_pdb_string_outside_record(self):
+        record = bytearray(image_record(1, 0x1000, 0x1000))
+        struct.pack_into("<H", record, 60, IMAGE_RECORD.size)
+        with self.assertRaises(ProfileFormatError):
+            load(bytes(record))
+
+    def test_handler_count_too_large(self):
+        record = bytearray(smi_record(SmiHandlerCategory.RootSmi, ZERO_GUID, [handler_record(1, 0, 0)]))
+        struct.pack_into("<I", record, 32, 2)
+        with self.assertRaises(ProfileFormatError):
+            load(bytes(record))
+
+    def test_handler_length_too_short(self):
+        record = bytearray(smi_record(SmiHandlerCategory.RootSmi, ZERO_GUID, [handler_record(1, 0, 0)]))
+        struct.pack_into("<I", record, SMI_RECORD.size, HANDLER_RECORD.size - 1)
+        with self.assertRaises(ProfileFormatError):
+            load(bytes(record))
+
+    def test_context_outside_handler(self):
+        record = bytearray(smi_record(SmiHandlerCategory.HardwareSmi, SW_GUID,
+                                      [handler_record(1, 0, 0, struct.pack("<Q", 1))]))
+        struct.pack_into("<I", record, SMI_RECORD.size + 28, 9)
+        with self.assertRaises(ProfileFormatError):
+            load(bytes(record))
+
+    def test_streaming(self):
+        ''' A large database is parsed with reads no bigger than its largest record '''
+        class CountingReader(io.BytesIO):
+            largest = 0
+
+            def read(self, size=-1):
+                self.largest = max(self.largest, size)
+                return super().read(size)
+
+        handlers = [handler_record(1, 0x1000, 0x1000 + i % 0x800, struct.pack("<Q", i)) for i in range(100)]
+        records = [image_record(1, 0x1000, 0x1000, "Big.pdb")]
+        records += [smi_record(SmiHandlerCategory.HardwareSmi, SW_GUID, handlers)] * 1000
+        stream = CountingReader(b"".join(records))
+        db = ProfileDatabase.load(stream)
+        self.assertEqual(len(list(db.handlers())), 100000)
+        self.assertGreater(stream.largest, 0)
+        self.assertLessEqual(stream.largest, max(len(r) for r in records))
+
+
+class TestLatency(unittest.TestCase):
+
+    def test_records(self):
+        records = list(iter_latency_records(io.BytesIO(sample_latency())))
+        self.assertEqual(len(records), 3)
+        self.assertEqual(records[0].handler_type, ZERO_GUID)
+        self.assertEqual((records[0].handler, records[0].caller_addr), (0x7F001010, 0x7F000100))
+        self.assertTrue(records[0].is_supervisor)
+        self.assertEqual((records[0].invocation_count, records[0].total_ticks, records[0].max_ticks), (10, 5000, 900))
+        self.assertEqual(records[0].histogram[8], 10)
+        self.assertFalse(records[1].is_supervisor)
+
+    def test_same_handler_is_summed(self):
+        latency = load_latency(io.BytesIO(sample_latency()))
+        self.assertEqual(len(latency), 2)
+        record = latency[(VARIABLE_GUID, 0x7F101000, 0x7F100200)]
+        self.assertEqual((record.invocation_count, record.total_ticks, record.max_ticks), (4, 70000, 40000))
+        self.assertEqual(record.histogram[13], 3)
+        self.assertEqual(record.histogram[15], 1)
+        self.assertEqual(sum(record.histogram), 4)
+
+    def test_empty(self):
+        self.assertEqual(load_latency(io.BytesIO(b"")), {})
+
+    def test_truncated(self):
+        with self.assertRaises(ProfileFormatError):
+            load_latency(io.BytesIO(sample_latency()[:-1]))
+
+    def test_unmatched(self):
+        data = sample_latency() + latency_record(ZERO_GUID, 0x7F001010, 0x7F000180, 1, 1)
+        missing = unmatched_latency(rows_of(sample_database()), load_latency(io.BytesIO(data)))
+        self.assertEqual([r.caller_addr for r in missing], [0x7F000180])
+
+
+class TestContext(unittest.TestCase):
+
+    def test_known_contexts(self):
+        cases = [
+            (SW_GUID, struct.pack("<Q", 0xEF), "SwSmi=0xef"),
+            (SX_GUID, struct.pack("<II", 3, 0), "SxType=SxS3 SxPhase=SxEntry"),
+            (SX_GUID, struct.pack("<II", 9, 1), "SxType=0x9 SxPhase=SxExit"),
+            (POWER_BUTTON_GUID, struct.pack("<I", 1), "PowerButtonPhase=PowerButtonExit"),
+            (STANDBY_BUTTON_GUID, struct.pack("<I", 0), "StandbyButtonPhase=StandbyButtonEntry"),
+            (PERIODIC_TIMER_GUID, struct.pack("<QQ", 160000, 10000),
+             "PeriodicTimerPeriod=160000 PeriodicTimerSmiTickInterval=10000"),
+            (GPI_GUID, struct.pack("<Q", 0x1F), "GpiNum=0x1f"),
+            (IO_TRAP_GUID, struct.pack("<HHI", 0x800, 4, 2),
+             "IoTrapAddress=0x800 IoTrapLength=0x4 IoTrapType=ReadWriteTrap"),
+            (USB_GUID, struct.pack("<II", 1, 4) + b"\x7f\xff\x04\x00",
+             "UsbType=UsbWake UsbDevicePath=7fff0400"),
+        ]
+        for (handler_type, context, expected) in cases:
+            self.assertEqual(decode_context(handler_type, context), expected)
+
+    def test_unknown_and_short_contexts(self):
+        self.assertEqual(decode_context(VARIABLE_GUID, b"\x01\x02"), "Context=0102")
+        self.assertEqual(decode_context(SW_GUID, b"\x01\x02"), "Context=0102")
+        self.assertEqual(decode_context(SW_GUID, b""), "")
+
+    def test_handler_type_names(self):
+        self.assertEqual(handler_type_name(ZERO_GUID), "")
+        self.assertEqual(handler_type_name(IO_TRAP_GUID), "IoTrapDispatch2")
+        self.assertEqual(handler_type_name(VARIABLE_GUID), str(VARIABLE_GUID))
+
+
+class TestResolve(unittest.TestCase):
+
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+        write_pdb(self.dir.name, "VariableSmm.pdb", [0x1000],
+                  [(1, 0x0, "SmmVariableHandler"), (1, 0x100, "SmmVariableSwHandler"), (1, 0x180, "Other")])
+        write_pdb(self.dir.name, "PiSmmCore.pdb", [0x1000], [(1, 0x0, "SmmEntryPoint")])
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def test_symbols_from_pdbs(self):
+        rows = rows_of(sample_database(), PdbSearchPath([self.dir.name]))
+        self.assertEqual([r.handler for r in rows],
+                         ["SmmEntryPoint+0x10", "SmmVariableHandler", "SmmVariableHandler",
+                          "SmmVariableSwHandler", "0x20"])
+        # Callers ahead of the first public resolve to their image relative address
+        self.assertEqual(rows[0].caller, "0x100")
+        self.assertEqual(rows[4].image, str(DRIVER_FILE_GUID))
+
+    def test_without_pdbs(self):
+        rows = rows_of(sample_database())
+        self.assertEqual(rows[0], HandlerRow("RootSmi", "", "", "PiSmmCore", "0x1010", "0x100"))
+        self.assertEqual(rows[3], HandlerRow("HardwareSmi", "SwDispatch2", "SwSmi=0xef", "VariableSmm", "0x1100", "0x300"))
+
+    def test_handler_outside_registering_image(self):
+        data = sample_database() + smi_record(SmiHandlerCategory.RootSmi, ZERO_GUID,
+                                              [handler_record(2, 0x7F100010, 0x7F000020),
+                                               handler_record(7, 0x10, 0x20)])
+        rows = rows_of(data)
+        self.assertEqual((rows[5].image, rows[5].handler, rows[5].caller), ("PiSmmCore", "0x20", "0x10"))
+        self.assertEqual((rows[6].image, rows[6].handler, rows[6].caller), ("", "0x20", "0x10"))
+
+
+class TestReports(unittest.TestCase):
+
+    def test_handler_table(self):
+        out = io.StringIO()
+        write_handler_table(rows_of(sample_database()), out)
+        lines = out.getvalue().splitlines()
+        self.assertEqual(lines[0].split(), HANDLER_COLUMNS)
+        self.assertEqual(len(lines), 7)
+        self.assertEqual(lines[5].split(), ["HardwareSmi", "SwDispatch2", "SwSmi=0xef", "VariableSmm", "0x1100", "0x300"])
+
+    def test_handler_csv(self):
+        out = io.StringIO()
+        write_handler_csv(rows_of(sample_database()), out)
+        lines = out.getvalue().splitlines()
+        self.assertEqual(lines[0], ",".join(HANDLER_COLUMNS))
+        self.assertEqual(lines[1], "RootSmi,,,PiSmmCore,0x1010,0x100")
+
+    def test_image_table(self):
+        out = io.StringIO()
+        write_image_table(rows_of(sample_database()), out)
+        lines = out.getvalue().splitlines()
+        self.assertEqual(lines[0].split(), ["Image", "RootSmi", "GuidSmi", "HardwareSmi", "Total"])
+        self.assertEqual(lines[2].split(), ["VariableSmm", "0", "2", "1", "3"])
+        self.assertEqual(lines[3].split(), [str(DRIVER_FILE_GUID), "0", "0", "1", "1"])
+        self.assertEqual(lines[4].split(), ["PiSmmCore", "1", "0", "0", "1"])
+
+    def test_folded_stacks(self):
+        out = io.StringIO()
+        write_folded(folded_stacks(rows_of(sample_database())), out)
+        self.assertEqual(out.getvalue().splitlines(), [
+            f"GuidSmi;{VARIABLE_GUID};VariableSmm;0x1000 2",
+            f"HardwareSmi;SwDispatch2;{DRIVER_FILE_GUID};0x20 1",
+            "HardwareSmi;SwDispatch2;VariableSmm;0x1100 1",
+            "RootSmi;PiSmmCore;0x1010 1",
+        ])
+
+    def test_folded_stacks_by_latency(self):
+        rows = rows_of(sample_database())
+        latency = load_latency(io.BytesIO(sample_latency()))
+        self.assertEqual(folded_stacks(rows, latency), {
+            f"GuidSmi;{VARIABLE_GUID};VariableSmm;0x1000": 70000,
+            "RootSmi;PiSmmCore;0x1010": 5000,
+        })
+        self.assertEqual(folded_stacks(rows, latency, "invocation_count"), {
+            f"GuidSmi;{VARIABLE_GUID};VariableSmm;0x1000": 4,
+            "RootSmi;PiSmmCore;0x1010": 10,
+        })
+
+    def test_folded_stacks_skip_idle_handlers(self):
+        latency = load_latency(io.BytesIO(latency_record(ZERO_GUID, 0x7F001010, 0x7F000100, 0, 0)))
+        self.assertEqual(folded_stacks(rows_of(sample_database()), latency), {})
+
+    def test_folded_frames_are_escaped(self):
+        rows = [HandlerRow("RootSmi", "", "", "", "a;b", "0x0")]
+        self.assertEqual(list(folded_stacks(rows)), ["RootSmi;???;a:b"])
+
+    def test_diff(self):
+        old = sample_database()
+        new = b"".join([
+            image_record(1, 0x7E000000, 0x4000, "c:\\build\\X64\\Core\\DEBUG\\PiSmmCore.pdb"),
+            image_record(2, 0x7E100000, 0x3000, "/build/X64/Variable/DEBUG/VariableSmm.pdb"),
+            image_record(4, 0x7E300000, 0x1000, "Tpm.pdb"),
+            smi_record(SmiHandlerCategory.RootSmi, ZERO_GUID, [handler_record(1, 0x7E000180, 0x7E001010)]),
+            smi_record(SmiHandlerCategory.GuidSmi, VARIABLE_GUID, [handler_record(2, 0x7E100200, 0x7E101000)]),
+            smi_record(SmiHandlerCategory.HardwareSmi, SW_GUID, [
+                handler_record(2, 0x7E100300, 0x7E101100, struct.pack("<Q", 0xEF)),
+                handler_record(4, 0x7E300010, 0x7E300020, struct.pack("<Q", 0x42))]),
+        ])
+        out = io.StringIO()
+        self.assertTrue(write_diff(load(old), rows_of(old), load(new), rows_of(new), out))
+        self.assertEqual(out.getvalue().splitlines(), [
+            "+ Image Tpm",
+            f"- Image {DRIVER_FILE_GUID}",
+            "~ Image VariableSmm 0x2000 -> 0x3000",
+            "+ Handler HardwareSmi SwDispatch2 SwSmi=0x42 Tpm 0x20",
+            f"- Handler GuidSmi {VARIABLE_GUID} VariableSmm 0x1000",
+            f"- Handler HardwareSmi SwDispatch2 SwSmi=0x42 {DRIVER_FILE_GUID} 0x20",
+        ])
+
+    def test_diff_identical(self):
+        data = sample_database()
+        out = io.StringIO()
+        self.assertFalse(write_diff(load(data), rows_of(data), load(data), rows_of(data), out))
+        self.assertEqual(out.getvalue(), "")
+
+
+class TestCli(unittest.TestCase):
+
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+        self.db = os.path.join(self.dir.name, "profile.bin")
+        with open(self.db, "wb") as f:
+            f.write(sample_database())
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def _read(self, name: str) -> str:
+        with open(os.path.join(self.dir.name, name)) as f:
+            return f.read()
+
+    def test_summary(self):
+        out = os.path.join(self.dir.name, "summary.txt")
+        self.assertEqual(MmiHandlerProfileAnalyzer.main(["summary", self.db, "-o", out]), 0)
+        self.assertIn("SwSmi=0xef", self._read("summary.txt"))
+        self.assertIn("Total", self._read("summary.txt"))
+
+    def test_flamegraph_with_pdbs(self):
+        write_pdb(self.dir.name, "PiSmmCore.pdb", [0x1000], [(1, 0x0, "SmmEntryPoint")])
+        out = os.path.join(self.dir.name, "out.folded")
+        self.assertEqual(MmiHandlerProfileAnalyzer.main(["-p", self.dir.name, "flamegraph", self.db, "-o", out]), 0)
+        self.assertIn("RootSmi;PiSmmCore;SmmEntryPoint+0x10 1\n", self._read("out.folded"))
+
+    def test_flamegraph_with_latency(self):
+        latency = os.path.join(self.dir.name, "latency.bin")
+        with open(latency, "wb") as f:
+            f.write(sample_latency())
+        out = os.path.join(self.dir.name, "out.folded")
+        self.assertEqual(MmiHandlerProfileAnalyzer.main(["flamegraph", self.db, "-l", latency, "-o", out]), 0)
+        self.assertEqual(self._read("out.folded").splitlines(), [
+            f"GuidSmi;{VARIABLE_GUID};VariableSmm;0x1000 70000",
+            "RootSmi;PiSmmCore;0x1010 5000",
+        ])
+        self.assertEqual(MmiHandlerProfileAnalyzer.main(
+            ["flamegraph", self.db, "--Latency", latency, "--invocations", "-o", out]), 0)
+        self.assertIn("RootSmi;PiSmmCore;0x1010 10\n", self._read("out.folded"))
+
+        with open(latency, "ab") as f:
+            f.write(b"\0")
+        self.assertEqual(MmiHandlerProfileAnalyzer.main(["flamegraph", self.db, "-l", latency]), -1)
+
+    def test_diff(self):
+        out = os.path.join(self.dir.name, "diff.txt")
+        self.assertEqual(MmiHandlerProfileAnalyzer.main(["diff", self.db, self.db, "-o", out]), 0)
+        other = os.path.join(self.dir.name, "other.bin")
+        with open(other, "wb") as f:
+            f.write(image_record(1, 0x1000, 0x1000, "Only.pdb"))
+        self.assertEqual(MmiHandlerProfileAnalyzer.main(["diff", self.db, other, "-o", out]), 1)
+        self.assertIn("+ Image Only", self._read("diff.txt"))
+
+    def test_errors(self):
+        bad = os.path.join(self.dir.name, "bad.bin")
+        with open(bad, "wb") as f:
+            f.write(sample_database()[:-3])
+        self.assertEqual(MmiHandlerProfileAnalyzer.main(["summary", bad]), -1)
+        self.assertEqual(MmiHandlerProfileAnalyzer.main(["summary", os.path.join(self.dir.name, "missing.bin")]), -1)
+        self.assertEqual(MmiHandlerProfileAnalyzer.main(["-p", os.path.join(self.dir.name, "nope"), "summary", self.db]), -1)
+
+
+if __name__ == '__main__':
+    unittest.main()
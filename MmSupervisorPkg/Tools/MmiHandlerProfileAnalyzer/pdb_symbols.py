@@ -0,0 +1,192 @@
+# @file
+# Minimal reader for the public symbols of an MSF 7.0 program database (PDB).
+#
+# Only the pieces needed to turn an image relative address into a symbol name
+# are decoded: the stream directory, the DBI stream header, the section header
+# stream and the S_PUB32 records of the symbol record stream.
+#
+# Copyright (c) Microsoft Corporation
+#
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+##
+
+import bisect
+import os
+import struct
+
+MSF_MAGIC = b"Microsoft C/C++ MSF 7.00\r\n\x1aDS\x00\x00\x00"
+
+DBI_STREAM = 3
+DBI_DBG_HEADER_SECTION_HDR = 5
+NIL_STREAM = 0xFFFF
+NIL_STREAM_SIZE = 0xFFFFFFFF
+
+S_PUB32 = 0x110E
+
+# struct SuperBlock
+MSF_SUPER_BLOCK = struct.Struct("<32sIIIIII")
+# struct DbiStreamHeader
+DBI_STREAM_HEADER = struct.Struct("<iIIHHHHHHiiiiiIiiHHI")
+# EFI_IMAGE_SECTION_HEADER, up to and including VirtualAddress
+SECTION_HEADER = struct.Struct("<8sII")
+SECTION_HEADER_SIZE = 40
+# PUBSYM32, after the record length and kind
+PUB_SYM32 = struct.Struct("<IIH")
+
+
+class PdbFormatError(ValueError):
+    ''' The file is not a PDB this reader understands '''
+    pass
+
+
+class PdbPublicSymbols(object):
+    ''' Public symbols of one PDB, sorted by image relative address '''
+
+    def __init__(self, path: str):
+        with open(path, "rb") as f:
+            self._data = f.read()
+
+        (magic, self._block_size, _, num_blocks, dir_bytes, _, block_map_addr) = \
+            self._unpack(MSF_SUPER_BLOCK, 0)
+        if magic != MSF_MAGIC:
+            raise PdbFormatError(f"{path} is not an MSF 7.0 PDB")
+        if self._block_size == 0 or num_blocks * self._block_size > len(self._data):
+            raise PdbFormatError(f"{path} has an invalid block layout")
+
+        dir_blocks = self._unpack(struct.Struct(f"<{self._blocks(dir_bytes)}I"), block_map_addr * self._block_size)
+        directory = self._read_blocks(dir_blocks, dir_bytes)
+
+        (num_streams,) = struct.unpack_from("<I", directory, 0)
+        sizes = struct.unpack_from(f"<{num_streams}I", directory, 4)
+        offset = 4 + 4 * num_streams
+        self._streams = []
+        for size in sizes:
+            if size == NIL_STREAM_SIZE:
+                self._streams.append(((), 0))
+                continue
+            count = self._blocks(size)
+            self._streams.append((struct.unpack_from(f"<{count}I", directory, offset), size))
+            offset += 4 * count
+
+        rvas = []
+        names = []
+        dbi = self.stream(DBI_STREAM)
+        header = self._unpack(DBI_STREAM_HEADER, 0, dbi)
+        sym_record_stream = header[7]
+        # Substreams follow the header in this order, the optional debug header last.
+        dbg_offset = DBI_STREAM_HEADER.size + sum(header[9:14]) + header[16]
+        dbg_size = header[15]
+        if dbg_size >= 2 * (DBI_DBG_HEADER_SECTION_HDR + 1):
+            (section_stream,) = struct.unpack_from("<H", dbi, dbg_offset + 2 * DBI_DBG_HEADER_SECTION_HDR)
+        else:
+            section_stream = NIL_STREAM
+
+        if section_stream != NIL_STREAM and sym_record_stream != NIL_STREAM:
+            raw = self.stream(section_stream)
+            sections = [SECTION_HEADER.unpack_from(raw, o)[2]
+                        for o in range(0, len(raw) - SECTION_HEADER_SIZE + 1, SECTION_HEADER_SIZE)]
+
+            records = self.stream(sym_record_stream)
+            pos = 0
+            while pos + 4 <= len(records):
+                (length, kind) = struct.unpack_from("<HH", records, pos)
+                if length < 2 or pos + 2 + length > len(records):
+                    raise PdbFormatError(f"{path} has a truncated symbol record at 0x{pos:x}")
+                if kind == S_PUB32 and length >= 2 + PUB_SYM32.size:
+                    (_, sym_offset, segment) = PUB_SYM32.unpack_from(records, pos + 4)
+                    if 1 <= segment <= len(sections):
+                        name_start = pos + 4 + PUB_SYM32.size
+                        name_end = records.find(b"\0", name_start, pos + 2 + length)
+                        if name_end < 0:
+                            name_end = pos + 2 + length
+                        rvas.append(sections[segment - 1] + sym_offset)
+                        names.append(records[name_start:name_end].decode("utf-8", "replace"))
+                pos += 2 + length
+
+        order = sorted(range(len(rvas)), key=rvas.__getitem__)
+        self._rvas = [rvas[i] for i in order]
+        self._names = [names[i] for i in order]
+        self._data = None
+
+    def __len__(self):
+        return len(self._rvas)
+
+    def _blocks(self, size: int) -> int:
+        return (size + self._block_size - 1) // self._block_size
+
+    def _unpack(self, fmt: struct.Struct, offset: int, buffer=None):
+        buffer = self._data if buffer is None else buffer
+        if offset + fmt.size > len(buffer):
+            raise PdbFormatError("PDB structure extends past the end of its stream")
+        return fmt.unpack_from(buffer, offset)
+
+    def _read_blocks(self, blocks, size: int) -> bytes:
+        out = bytearray()
+        for block in blocks:
+            start = block * self._block_size
+            end = start + min(self._block_size, size - len(out))
+            if end > len(self._data):
+                raise PdbFormatError(f"PDB block {block} is past the end of the file")
+            out += self._data[start:end]
+        return bytes(out)
+
+    def stream(self, index: int) -> bytes:
+        ''' Return the contents of a stream, empty for a nil stream '''
+        if index >= len(self._streams):
+            raise PdbFormatError(f"PDB has no stream {index}")
+        (blocks, size) = self._streams[index]
+        return self._read_blocks(blocks, size)
+
+    def lookup(self, rva: int):
+        ''' Return (name, displacement) of the closest public at or below rva, or None '''
+        i = bisect.bisect_right(self._rvas, rva) - 1
+        if i < 0:
+            return None
+        return (self._names[i], rva - self._rvas[i])
+
+
+class PdbSearchPath(object):
+    ''' Locate and cache PDBs by the path recorded in the image.
+
+        The recorded path is tried as is first, then by file name (case insensitive) under
+        each search directory.  The directories are walked once, on first use.
+    '''
+
+    def __init__(self, directories=()):
+        self._directories = list(directories)
+        self._index = None
+        self._cache = {}
+
+    def _build_index(self):
+        self._index = {}
+        for directory in self._directories:
+            for root, _, files in os.walk(directory):
+                for name in files:
+                    if name.lower().endswith(".pdb"):
+                        self._index.setdefault(name.lower(), os.path.join(root, name))
+
+    def find(self, recorded_path: str):
+        ''' Return the PdbPublicSymbols for recorded_path, or None when it can not be loaded '''
+        if not recorded_path:
+            return None
+        if recorded_path in self._cache:
+            return self._cache[recorded_path]
+
+        candidates = [recorded_path]
+        if self._directories:
+            if self._index is None:
+                self._build_index()
+            name = recorded_path.replace("\\", "/").rsplit("/", 1)[-1].lower()
+            if name in self._index:
+                candidates.append(self._index[name])
+
+        symbols = None
+        for candidate in candidates:
+            if os.path.isfile(candidate):
+                try:
+                    symbols = PdbPublicSymbols(candidate)
+                    break
+                except (PdbFormatError, struct.error):
+                    continue
+        self._cache[recorded_path] = symbols
+        return symbols
@@ -0,0 +1,184 @@
+# @file
+# unit tests for pdb_symbols
+#
+# Copyright (c) Microsoft Corporation
+#
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+##
+
+from pdb_symbols import *
+import os
+import struct
+import tempfile
+import unittest
+
+BLOCK_SIZE = 512
+SECTION_STREAM = 5
+SYM_RECORD_STREAM = 6
+S_PROCREF = 0x1125
+
+
+def _pad(data: bytes, align: int) -> bytes:
+    return data + b"\0" * (-len(data) % align)
+
+
+def build_sym_records(publics: list) -> bytes:
+    ''' S_PUB32 records for (segment, offset, name), with an S_PROCREF between each to skip '''
+    out = b""
+    for (segment, offset, name) in publics:
+        for kind, payload in ((S_PUB32, struct.pack("<IIH", 2, offset, segment) + name.encode() + b"\0"),
+                              (S_PROCREF, b"\0" * 10 + name.encode() + b"\0")):
+            body = _pad(struct.pack("<HH", 0, kind) + payload, 4)
+            out += struct.pack("<H", len(body) - 2) + body[2:]
+    return out
+
+
+def build_dbi(sym_record_stream: int, section_stream: int) -> bytes:
+    ''' DBI stream with non empty module info and EC substreams ahead of the debug header '''
+    mod_info = b"\xAA" * 24
+    ec = b"\xBB" * 8
+    dbg = [NIL_STREAM] * 11
+    dbg[DBI_DBG_HEADER_SECTION_HDR] = section_stream
+    dbg = struct.pack("<11H", *dbg)
+    header = DBI_STREAM_HEADER.pack(-1, 19990903, 1, NIL_STREAM, 0, NIL_STREAM, 0, sym_record_stream, 0,
+                                    len(mod_info), 0, 0, 0, 0, 0, len(dbg), len(ec), 0, 0x8664, 0)
+    return header + mod_info + ec + dbg
+
+
+def build_section_headers(addresses: list) -> bytes:
+    return b"".join(struct.pack("<8sII24x", f".s{i}".encode(), 0x1000, va) for (i, va) in enumerate(addresses))
+
+
+def build_msf(streams: list) -> bytes:
+    ''' MSF 7.0 file holding streams, each stream's blocks allocated in descending order '''
+    next_block = 3
+    block_lists = []
+    for data in streams:
+        count = (len(data) + BLOCK_SIZE - 1) // BLOCK_SIZE
+        block_lists.append(list(reversed(range(next_block, next_block + count))))
+        next_block += count
+
+    directory = struct.pack("<I", len(streams)) + struct.pack(f"<{len(streams)}I", *[len(s) for s in streams])
+    for blocks in block_lists:
+        directory += struct.pack(f"<{len(blocks)}I", *blocks)
+    dir_count = (len(directory) + BLOCK_SIZE - 1) // BLOCK_SIZE
+    dir_blocks = list(range(next_block, next_block + dir_count))
+    block_map = next_block + dir_count
+    num_blocks = block_map + 1
+
+    image = bytearray(num_blocks * BLOCK_SIZE)
+    image[0:MSF_SUPER_BLOCK.size] = MSF_SUPER_BLOCK.pack(MSF_MAGIC, BLOCK_SIZE, 1, num_blocks, len(directory), 0, block_map)
+    for (data, blocks) in zip(streams + [directory], block_lists + [dir_blocks]):
+        for (i, block) in enumerate(blocks):
+            chunk = data[i * BLOCK_SIZE:(i + 1) * BLOCK_SIZE]
+            image[block * BLOCK_SIZE:block * BLOCK_SIZE + len(chunk)] = chunk
+    struct.pack_into(f"<{dir_count}I", image, block_map * BLOCK_SIZE, *dir_blocks)
+    return bytes(image)
+
+
+def build_pdb(sections: list, publics: list) -> bytes:
+    ''' PDB with sections at the given virtual addresses and (segment, offset, name) publics '''
+    streams = [b"", b"\0" * 28, b"", build_dbi(SYM_RECORD_STREAM, SECTION_STREAM), b"",
+               build_section_headers(sections), build_sym_records(publics)]
+    return build_msf(streams)
+
+
+def write_pdb(directory: str, name: str, sections: list, publics: list) -> str:
+    path = os.path.join(directory, name)
+    with open(path, "wb") as f:
+        f.write(build_pdb(sections, publics))
+    return path
+
+
+class TestPdbPublicSymbols(unittest.TestCase):
+
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def test_lookup(self):
+        path = write_pdb(self.dir.name, "a.pdb", [0x1000, 0x3000],
+                         [(1, 0x40, "Second"), (1, 0x0, "_ModuleEntryPoint"), (2, 0x10, "mData")])
+        symbols = PdbPublicSymbols(path)
+        self.assertEqual(len(symbols), 3)
+        self.assertIsNone(symbols.lookup(0xFFF))
+        self.assertEqual(symbols.lookup(0x1000), ("_ModuleEntryPoint", 0))
+        self.assertEqual(symbols.lookup(0x103F), ("_ModuleEntryPoint", 0x3F))
+        self.assertEqual(symbols.lookup(0x1040), ("Second", 0))
+        self.assertEqual(symbols.lookup(0x3018), ("mData", 8))
+
+    def test_multi_block_streams(self):
+        publics = [(1, i * 0x20, f"Function{i:04}") for i in range(300)]
+        path = write_pdb(self.dir.name, "big.pdb", [0x400], publics)
+        symbols = PdbPublicSymbols(path)
+        self.assertEqual(len(symbols), 300)
+        for i in range(300):
+            self.assertEqual(symbols.lookup(0x400 + i * 0x20 + 4), (f"Function{i:04}", 4))
+
+    def test_segment_out_of_range_is_ignored(self):
+        path = write_pdb(self.dir.name, "a.pdb", [0x1000], [(2, 0x0, "Bad"), (0, 0x0, "Abs"), (1, 0x0, "Good")])
+        symbols = PdbPublicSymbols(path)
+        self.assertEqual(len(symbols), 1)
+        self.assertEqual(symbols.lookup(0x1000), ("Good", 0))
+
+    def test_not_a_pdb(self):
+        path = os.path.join(self.dir.name, "a.pdb")
+        with open(path, "wb") as f:
+            f.write(b"\0" * 4096)
+        with self.assertRaises(PdbFormatError):
+            PdbPublicSymbols(path)
+
+    def test_truncated_file(self):
+        data = build_pdb([0x1000], [(1, 0, "Entry")])
+        path = os.path.join(self.dir.name, "a.pdb")
+        with open(path, "wb") as f:
+            f.write(data[:len(data) - BLOCK_SIZE])
+        with self.assertRaises(PdbFormatError):
+            PdbPublicSymbols(path)
+
+    def test_truncated_symbol_record(self):
+        records = build_sym_records([(1, 0, "Entry")])
+        streams = [b"", b"\0" * 28, b"", build_dbi(SYM_RECORD_STREAM, SECTION_STREAM), b"",
+                   build_section_headers([0x1000]), records[:-8]]
+        path = os.path.join(self.dir.name, "a.pdb")
+        with open(path, "wb") as f:
+            f.write(build_msf(streams))
+        with self.assertRaises(PdbFormatError):
+            PdbPublicSymbols(path)
+
+
+class TestPdbSearchPath(unittest.TestCase):
+
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+        os.makedirs(os.path.join(self.dir.name, "X64", "Driver", "DEBUG"))
+        self.path = write_pdb(os.path.join(self.dir.name, "X64", "Driver", "DEBUG"), "Driver.pdb",
+                              [0x1000], [(1, 0, "Entry")])
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def test_recorded_path(self):
+        self.assertIsNotNone(PdbSearchPath().find(self.path))
+
+    def test_found_by_name(self):
+        search = PdbSearchPath([self.dir.name])
+        symbols = search.find("c:\\build\\X64\\Driver\\DEBUG\\DRIVER.PDB")
+        self.assertEqual(symbols.lookup(0x1000), ("Entry", 0))
+        self.assertIs(search.find("c:\\build\\X64\\Driver\\DEBUG\\DRIVER.PDB"), symbols)
+
+    def test_missing(self):
+        search = PdbSearchPath([self.dir.name])
+        self.assertIsNone(search.find("/build/Other.pdb"))
+        self.assertIsNone(search.find(""))
+
+    def test_unreadable_pdb(self):
+        with open(self.path, "wb") as f:
+            f.write(b"not a pdb")
+        self.assertIsNone(PdbSearchPath([self.dir.name]).find("Driver.pdb"))
+
+
+if __name__ == '__main__':
+    unittest.main()
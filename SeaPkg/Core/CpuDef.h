@@ -101,6 +101,8 @@
 #define IA32_PG_PMNT    BIT62
 #define IA32_PG_NX      BIT63
 
+#define IA32_PF_EC_P  BIT0
+
 #define RFLAGS_CF    1u
 #define RFLAGS_ZF    (1u << 6)
 #define RFLAGS_TF    (1u << 8)
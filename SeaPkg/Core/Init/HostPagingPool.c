@@ -0,0 +1,278 @@
+/** @file
+  Lazily populated STM host paging above 4GB.
+
+  Host entries are serialized, and every VM exit flushes the cached translations of the host
+  since VPID is not enabled. Reloading CR3 on the processor that reclaims a table is hence
+  enough to drop any translation through it.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include "../CpuDef.h"
+#include "HostPagingPool.h"
+
+#define HOST_PAGING_ADDRESS_MASK_64  0x000FFFFFFFFFF000ull
+#define HOST_PAGING_INDEX_MASK       0x1FF
+#define HOST_PAGING_TABLE_ENTRIES    (SIZE_4KB / sizeof (UINT64))
+
+//
+// Only 4-level paging is set up by the loader.
+//
+#define HOST_PAGING_MAX_ADDRESS_BITS  48
+
+/**
+  Get the pool index of a page table.
+
+  @param[in] Pool   The pool backing the host mapping.
+  @param[in] Table  The page table.
+
+  @return The index of Table in the pool, MAX_UINTN when Table is not pooled.
+
+**/
+STATIC
+UINTN
+HostPagingPoolIndexOf (
+  IN CONST HOST_PAGING_POOL  *Pool,
+  IN CONST UINT64            *Table
+  )
+{
+  UINTN  Index;
+
+  if ((Pool->Count == 0) || ((UINTN)Table < (UINTN)Pool->Entry[0].Table)) {
+    return MAX_UINTN;
+  }
+
+  Index = ((UINTN)Table - (UINTN)Pool->Entry[0].Table) / SIZE_4KB;
+  return (Index < Pool->Count) ? Index : MAX_UINTN;
+}
+
+/**
+  Take a page table from the pool, reclaiming the least recently used one when none is free.
+
+  The Accessed flag of the entry referencing a table gives it a second chance: it is cleared
+  and the table stamped as just used. Only the walk of the host sets that flag again, and the
+  walk does not go above 4GB while a table is taken, so each table gets at most one second
+  chance and the search ends.
+
+  @param[in, out] Pool     The pool backing the host mapping.
+  @param[in]      Exclude  The index of a table that must not be reclaimed, MAX_UINTN for none.
+
+  @return The index of the zeroed table, MAX_UINTN when every table is in use and may not be
+          reclaimed.
+
+**/
+STATIC
+UINTN
+HostPagingPoolAllocate (
+  IN OUT HOST_PAGING_POOL  *Pool,
+  IN     UINTN             Exclude
+  )
+{
+  HOST_PAGING_POOL_ENTRY  *Entry;
+  UINTN                   Index;
+  UINTN                   Victim;
+
+  Entry = Pool->Entry;
+  for (Index = 0; Index < Pool->Count; Index++) {
+    if (Entry[Index].ParentEntry == NULL) {
+      ZeroMem (Entry[Index].Table, SIZE_4KB);
+      return Index;
+    }
+  }
+
+  do {
+    //
+    // Tables still referencing pooled tables cannot go before them.
+    //
+    Victim = MAX_UINTN;
+    for (Index = 0; Index < Pool->Count; Index++) {
+      if ((Index != Exclude) && (Entry[Index].ChildCount == 0) &&
+          ((Victim == MAX_UINTN) || (Entry[Index].LastUse < Entry[Victim].LastUse)))
+      {
+        Victim = Index;
+      }
+    }
+
+    if (Victim == MAX_UINTN) {
+      return MAX_UINTN;
+    }
+
+    if ((*Entry[Victim].ParentEntry & IA32_PG_A) == 0) {
+      break;
+    }
+
+    *Entry[Victim].ParentEntry &= ~(UINT64)IA32_PG_A;
+    Entry[Victim].LastUse       = ++Pool->Clock;
+  } while (TRUE);
+
+  *Entry[Victim].ParentEntry = 0;
+  if (Entry[Victim].Parent != MAX_UINTN) {
+    Entry[Entry[Victim].Parent].ChildCount--;
+  }
+
+  Entry[Victim].ParentEntry = NULL;
+  Entry[Victim].Parent      = MAX_UINTN;
+  Pool->Reclaimed++;
+
+  AsmWriteCr3 (AsmReadCr3 ());
+
+  ZeroMem (Entry[Victim].Table, SIZE_4KB);
+  return Victim;
+}
+
+/**
+  Link a table taken from the pool to the entry referencing it.
+
+  @param[in, out] Pool         The pool backing the host mapping.
+  @param[in]      Index        The index of the table.
+  @param[in, out] ParentEntry  The entry to reference the table from.
+  @param[in]      Parent       The pool index of the table holding ParentEntry, MAX_UINTN if not
+                               pooled.
+
+**/
+STATIC
+VOID
+HostPagingPoolLink (
+  IN OUT HOST_PAGING_POOL  *Pool,
+  IN     UINTN             Index,
+  IN OUT UINT64            *ParentEntry,
+  IN     UINTN             Parent
+  )
+{
+  HOST_PAGING_POOL_ENTRY  *Entry;
+
+  Entry              = &Pool->Entry[Index];
+  Entry->ParentEntry = ParentEntry;
+  Entry->Parent      = Parent;
+  Entry->ChildCount  = 0;
+  Entry->LastUse     = ++Pool->Clock;
+  if (Parent != MAX_UINTN) {
+    Pool->Entry[Parent].ChildCount++;
+  }
+
+  *ParentEntry = (UINT64)(UINTN)Entry->Table | IA32_PG_RW | IA32_PG_P;
+}
+
+/**
+  Initialize the pool backing the host mapping above 4GB.
+
+  The mapping below 4GB, set up by the loader, is left untouched, and so is any table it
+  already references.
+
+  @param[out] Pool                 The pool to initialize.
+  @param[in]  Pml4                 The PML4 table of the host.
+  @param[in]  Entry                The bookkeeping of the pool, one per page of Pages.
+  @param[in]  Pages                The page table pages of the pool.
+  @param[in]  PageCount            The number of page table pages of the pool.
+  @param[in]  PhysicalAddressBits  The physical address width to map.
+  @param[in]  Use1GPages           Whether 1GB pages are supported.
+
+**/
+VOID
+HostPagingPoolInit (
+  OUT HOST_PAGING_POOL        *Pool,
+  IN  UINT64                  *Pml4,
+  IN  HOST_PAGING_POOL_ENTRY  *Entry,
+  IN  VOID                    *Pages,
+  IN  UINTN                   PageCount,
+  IN  UINT8                   PhysicalAddressBits,
+  IN  BOOLEAN                 Use1GPages
+  )
+{
+  UINTN  Index;
+
+  Pool->Pml4       = Pml4;
+  Pool->MaxAddress = LShiftU64 (1, MIN (PhysicalAddressBits, HOST_PAGING_MAX_ADDRESS_BITS));
+  Pool->Use1GPages = Use1GPages;
+  Pool->Count      = PageCount;
+  Pool->Clock      = 0;
+  Pool->Reclaimed  = 0;
+  Pool->Entry      = Entry;
+
+  for (Index = 0; Index < PageCount; Index++) {
+    Entry[Index].Table       = (UINT64 *)((UINTN)Pages + Index * SIZE_4KB);
+    Entry[Index].ParentEntry = NULL;
+    Entry[Index].Parent      = MAX_UINTN;
+    Entry[Index].ChildCount  = 0;
+    Entry[Index].LastUse     = 0;
+  }
+}
+
+/**
+  Map the 1GB region holding an address, as 1GB or 2MB pages.
+
+  @param[in, out] Pool     The pool backing the host mapping.
+  @param[in]      Address  The address to map.
+
+  @retval TRUE   The region is now mapped.
+  @retval FALSE  The address is outside the range managed by the pool, already mapped, or the
+                 pool is too small to map it.
+
+**/
+BOOLEAN
+HostPagingPoolMap (
+  IN OUT HOST_PAGING_POOL  *Pool,
+  IN     UINT64            Address
+  )
+{
+  UINTN   Pml4Index;
+  UINTN   PdptIndex;
+  UINTN   PdptPoolIndex;
+  UINTN   Index;
+  UINTN   SubIndex;
+  UINT64  *Pdpt;
+  UINT64  *Pd;
+  UINT64  BaseAddress;
+
+  if ((Address < BASE_4GB) || (Address >= Pool->MaxAddress)) {
+    return FALSE;
+  }
+
+  Pml4Index = (UINTN)RShiftU64 (Address, 39) & HOST_PAGING_INDEX_MASK;
+  PdptIndex = (UINTN)RShiftU64 (Address, 30) & HOST_PAGING_INDEX_MASK;
+
+  if ((Pool->Pml4[Pml4Index] & IA32_PG_P) == 0) {
+    Index = HostPagingPoolAllocate (Pool, MAX_UINTN);
+    if (Index == MAX_UINTN) {
+      return FALSE;
+    }
+
+    HostPagingPoolLink (Pool, Index, &Pool->Pml4[Pml4Index], MAX_UINTN);
+  }
+
+  Pdpt          = (UINT64 *)(UINTN)(Pool->Pml4[Pml4Index] & HOST_PAGING_ADDRESS_MASK_64);
+  PdptPoolIndex = HostPagingPoolIndexOf (Pool, Pdpt);
+  if (PdptPoolIndex != MAX_UINTN) {
+    Pool->Entry[PdptPoolIndex].LastUse = ++Pool->Clock;
+  }
+
+  if ((Pdpt[PdptIndex] & IA32_PG_P) != 0) {
+    return FALSE;
+  }
+
+  BaseAddress = Address & ~(UINT64)(SIZE_1GB - 1);
+  if (Pool->Use1GPages) {
+    Pdpt[PdptIndex] = BaseAddress | IA32_PG_PS | IA32_PG_RW | IA32_PG_P;
+    return TRUE;
+  }
+
+  Index = HostPagingPoolAllocate (Pool, PdptPoolIndex);
+  if (Index == MAX_UINTN) {
+    return FALSE;
+  }
+
+  Pd = Pool->Entry[Index].Table;
+  for (SubIndex = 0; SubIndex < HOST_PAGING_TABLE_ENTRIES; SubIndex++) {
+    Pd[SubIndex] = BaseAddress | IA32_PG_PS | IA32_PG_RW | IA32_PG_P;
+    BaseAddress += SIZE_2MB;
+  }
+
+  HostPagingPoolLink (Pool, Index, &Pdpt[PdptIndex], PdptPoolIndex);
+  return TRUE;
+}
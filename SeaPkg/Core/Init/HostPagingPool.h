@@ -0,0 +1,83 @@
+/** @file
+  Lazily populated STM host paging above 4GB.
+
+  The page tables mapping the physical address space above 4GB are taken from a bounded pool
+  and filled when the host first touches an address, with the largest page size supported.
+  When the pool runs dry, the least recently used table is reclaimed.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _HOST_PAGING_POOL_H_
+#define _HOST_PAGING_POOL_H_
+
+///
+/// A page table page of the pool.
+///
+typedef struct {
+  UINT64    *Table;
+  UINT64    *ParentEntry;   // Entry referencing Table, NULL when Table is free
+  UINTN     Parent;         // Pool index of the table holding ParentEntry, MAX_UINTN if not pooled
+  UINTN     ChildCount;     // Pooled tables referenced by Table
+  UINT64    LastUse;        // Stamp of the last access through Table
+} HOST_PAGING_POOL_ENTRY;
+
+///
+/// The pool backing the host mapping above 4GB.
+///
+typedef struct {
+  UINT64                    *Pml4;
+  UINT64                    MaxAddress;
+  BOOLEAN                   Use1GPages;
+  UINTN                     Count;
+  UINT64                    Clock;
+  UINTN                     Reclaimed;
+  HOST_PAGING_POOL_ENTRY    *Entry;
+} HOST_PAGING_POOL;
+
+/**
+  Initialize the pool backing the host mapping above 4GB.
+
+  The mapping below 4GB, set up by the loader, is left untouched, and so is any table it
+  already references.
+
+  @param[out] Pool                 The pool to initialize.
+  @param[in]  Pml4                 The PML4 table of the host.
+  @param[in]  Entry                The bookkeeping of the pool, one per page of Pages.
+  @param[in]  Pages                The page table pages of the pool.
+  @param[in]  PageCount            The number of page table pages of the pool.
+  @param[in]  PhysicalAddressBits  The physical address width to map.
+  @param[in]  Use1GPages           Whether 1GB pages are supported.
+
+**/
+VOID
+HostPagingPoolInit (
+  OUT HOST_PAGING_POOL        *Pool,
+  IN  UINT64                  *Pml4,
+  IN  HOST_PAGING_POOL_ENTRY  *Entry,
+  IN  VOID                    *Pages,
+  IN  UINTN                   PageCount,
+  IN  UINT8                   PhysicalAddressBits,
+  IN  BOOLEAN                 Use1GPages
+  );
+
+/**
+  Map the 1GB region holding an address, as 1GB or 2MB pages.
+
+  @param[in, out] Pool     The pool backing the host mapping.
+  @param[in]      Address  The address to map.
+
+  @retval TRUE   The region is now mapped.
+  @retval FALSE  The address is outside the range managed by the pool, already mapped, or the
+                 pool is too small to map it.
+
+**/
+BOOLEAN
+HostPagingPoolMap (
+  IN OUT HOST_PAGING_POOL  *Pool,
+  IN     UINT64            Address
+  );
+
+#endif
@@ -46,6 +46,9 @@ AllocatePages (
 
   Address                    = mHostContextCommon.HeapTop - STM_PAGES_TO_SIZE (Pages);
   mHostContextCommon.HeapTop = Address;
+  if (Address < mHostContextCommon.HeapLowWaterMark) {
+    mHostContextCommon.HeapLowWaterMark = Address;
+  }
 
   ZeroMem ((VOID *)(UINTN)Address, STM_PAGES_TO_SIZE (Pages));
   SAFE_DEBUG ((DEBUG_INFO, "[%a] - Buffer at 0x%lx. Pages = 0x%x.\n", __func__, (UINTN)Address, Pages));
@@ -12,9 +12,14 @@
 
 **/
 
-#include "StmInit.h"
+#include <IndustryStandard/Tpm20.h>
+#include <Library/PcdLib.h>
 #include <Library/SafeIntLib.h>
 
+#include "StmInit.h"
+#include "HostPagingPool.h"
+#include "Runtime/StmRuntimeUtil.h"
+
 #define PAGE_PROGATE_BITS  (BIT0 | BIT1 | BIT2 | BIT3 | BIT4 | BIT5)
 
 #define PAGING_4K_MASK  0xFFF
@@ -72,11 +77,21 @@ Is1GPageSupport (
   return FALSE;
 }
 
+//
+// Page table pool backing the host mapping above 4GB.
+//
+STATIC HOST_PAGING_POOL  mHostPagingPool;
+STATIC SPIN_LOCK         mHostPagingLock;
+
 /**
 
   This function create page table for STM host.
   The SINIT/StmLoader should already configured 4G paging, so here
-  we just create >4G paging for X64 mode.
+  we just prepare >4G paging for X64 mode.
+
+  Eagerly mapping the whole physical address space above 4GB takes a page table page per GB
+  without 1GB pages, so the mapping is instead populated on page faults, from a pool of
+  PcdHostPagingPoolPages pages. Only the MMRAM above 4GB is mapped up front.
 
 **/
 VOID
@@ -84,59 +99,61 @@ CreateHostPaging (
   VOID
   )
 {
-  UINTN   PageTable;
-  UINTN   Index;
-  UINTN   SubIndex;
-  UINTN   Pml4Index;
-  UINT64  *Pde;
-  UINT64  *Pte;
-  UINT64  *Pml4;
-  UINT64  BaseAddress;
-  UINTN   NumberOfPml4EntriesNeeded;
-  UINTN   NumberOfPdpEntriesNeeded;
+  UINTN                  PoolPages;
+  CONST SEA_MMRAM_RANGE  *Ranges;
+  UINTN                  RangeCount;
+  UINTN                  Index;
+  UINT64                 Address;
 
   if (sizeof (UINTN) == sizeof (UINT64)) {
-    PageTable = AsmReadCr3 ();
-    Pml4      = (UINT64 *)PageTable;
-
-    if (mHostContextCommon.PhysicalAddressBits <= 39) {
-      NumberOfPml4EntriesNeeded = 1;
-      NumberOfPdpEntriesNeeded  = (UINTN)LShiftU64 (1, mHostContextCommon.PhysicalAddressBits - 30);
-    } else {
-      NumberOfPml4EntriesNeeded = (UINTN)LShiftU64 (1, mHostContextCommon.PhysicalAddressBits - 39);
-      NumberOfPdpEntriesNeeded  = 512;
+    PoolPages = FixedPcdGet32 (PcdHostPagingPoolPages);
+
+    InitializeSpinLock (&mHostPagingLock);
+    HostPagingPoolInit (
+      &mHostPagingPool,
+      (UINT64 *)(UINTN)(AsmReadCr3 () & PAGING_4K_ADDRESS_MASK_64),
+      AllocatePages (STM_SIZE_TO_PAGES (sizeof (HOST_PAGING_POOL_ENTRY) * PoolPages)),
+      AllocatePages (PoolPages),
+      PoolPages,
+      mHostContextCommon.PhysicalAddressBits,
+      Is1GPageSupport ()
+      );
+
+    Ranges = GetMmramRanges (&RangeCount);
+    for (Index = 0; Index < RangeCount; Index++) {
+      Address = MAX (Ranges[Index].Base, BASE_4GB) & ~(UINT64)PAGING_1G_MASK;
+      for ( ; Address < Ranges[Index].End; Address += SIZE_1GB) {
+        HostPagingPoolMap (&mHostPagingPool, Address);
+      }
     }
+  }
+}
 
-    BaseAddress = BASE_4GB;
-    for (Pml4Index = 0; Pml4Index < NumberOfPml4EntriesNeeded; Pml4Index++) {
-      if (Pml4Index > 0) {
-        Pde             = (UINT64 *)(UINTN)AllocatePages (1);
-        Pml4[Pml4Index] = (UINT64)(UINTN)Pde | IA32_PG_P;
-        Index           = 0;
-      } else {
-        // Start from 4G - Pml4[0] already allocated.
-        Pde   = (UINT64 *)(UINTN)(Pml4[0] & 0xFFFFF000);
-        Index = 4;
-      }
+/**
+  Map the host page missing for an address above 4GB.
 
-      if (Is1GPageSupport ()) {
-        for ( ; Index < NumberOfPdpEntriesNeeded; Index++) {
-          Pde[Index]   = (UINT64)(UINTN)BaseAddress | IA32_PG_PS | IA32_PG_RW | IA32_PG_P;
-          BaseAddress += SIZE_1GB;
-        }
-      } else {
-        for ( ; Index < NumberOfPdpEntriesNeeded; Index++) {
-          Pte        = (UINT64 *)AllocatePages (1);
-          Pde[Index] = (UINT64)(UINTN)Pte | IA32_PG_P;
-
-          for (SubIndex = 0; SubIndex < SIZE_4KB / sizeof (*Pte); SubIndex++) {
-            Pte[SubIndex] = BaseAddress | IA32_PG_PS | IA32_PG_RW | IA32_PG_P;
-            BaseAddress  += SIZE_2MB;
-          }
-        }
-      }
-    }
+  @param[in] FaultAddress  The linear address that caused the page fault.
+
+  @retval TRUE   The address is now mapped, the faulting instruction can be restarted.
+  @retval FALSE  The fault is not caused by the lazy host mapping.
+
+**/
+BOOLEAN
+HostPagingHandlePageFault (
+  IN UINT64  FaultAddress
+  )
+{
+  BOOLEAN  Mapped;
+
+  if ((sizeof (UINTN) != sizeof (UINT64)) || (mHostPagingPool.Count == 0)) {
+    return FALSE;
   }
+
+  AcquireSpinLock (&mHostPagingLock);
+  Mapped = HostPagingPoolMap (&mHostPagingPool, FaultAddress);
+  ReleaseSpinLock (&mHostPagingLock);
+
+  return Mapped;
 }
 
 /**
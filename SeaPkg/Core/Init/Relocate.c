@@ -14,6 +14,14 @@
 
 #include "StmInit.h"
 #include <IndustryStandard/PeImage.h>
+#include <SeaAuxiliary.h>
+#include <Library/PeCoffLib.h>
+#include <Library/PeCoffLibNegative.h>
+
+//
+// Fixups of this STM image, indexed on first entry at the bottom of the heap.
+//
+PE_COFF_FIXUP_INDEX  mStmFixupIndex;
 
 /**
 
@@ -33,158 +41,34 @@ PeCoffRelocateImageOnTheSpot (
   IN  BOOLEAN  IsTeardown
   )
 {
-  EFI_IMAGE_DOS_HEADER                 *DosHdr;
-  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
-  UINT32                               NumberOfRvaAndSizes;
-  EFI_IMAGE_DATA_DIRECTORY             *DataDirectory;
-  EFI_IMAGE_DATA_DIRECTORY             *RelocDir;
-  EFI_IMAGE_BASE_RELOCATION            *RelocBase;
-  EFI_IMAGE_BASE_RELOCATION            *RelocBaseEnd;
-  UINT16                               *Reloc;
-  UINT16                               *RelocEnd;
-  CHAR8                                *Fixup;
-  CHAR8                                *FixupBase;
-  UINT16                               *Fixup16;
-  UINT32                               *Fixup32;
-  UINT64                               *Fixup64;
-  UINTN                                Adjust;
-  UINT16                               Magic;
-
-  if (!IsTeardown) {
-    Adjust = ImageBase - PeImageBase;
-  } else {
-    Adjust = PeImageBase - ImageBase;
-  }
-
-  //
-  // Find the image's relocate dir info
-  //
-  DosHdr = (EFI_IMAGE_DOS_HEADER *)ImageBase;
-  if (DosHdr->e_magic == EFI_IMAGE_DOS_SIGNATURE) {
-    //
-    // Valid DOS header so get address of PE header
-    //
-    Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(((CHAR8 *)DosHdr) + DosHdr->e_lfanew);
-  } else {
-    //
-    // No Dos header so assume image starts with PE header.
-    //
-    Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)ImageBase;
-  }
-
-  if (Hdr.Pe32->Signature != EFI_IMAGE_NT_SIGNATURE) {
-    //
-    // Not a valid PE image so Exit
-    //
-    return;
-  }
-
-  Magic = Hdr.Pe32->OptionalHeader.Magic;
-
-  if (Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-    //
-    // Use PE32 offset
-    //
-    NumberOfRvaAndSizes = Hdr.Pe32->OptionalHeader.NumberOfRvaAndSizes;
-    DataDirectory       = (EFI_IMAGE_DATA_DIRECTORY *)&(Hdr.Pe32->OptionalHeader.DataDirectory[0]);
-  } else {
-    //
-    // Use PE32+ offset
-    //
-    NumberOfRvaAndSizes = Hdr.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
-    DataDirectory       = (EFI_IMAGE_DATA_DIRECTORY *)&(Hdr.Pe32Plus->OptionalHeader.DataDirectory[0]);
-  }
-
-  //
-  // Find the relocation block
-  //
-  // Per the PE/COFF spec, you can't assume that a given data directory
-  // is present in the image. You have to check the NumberOfRvaAndSizes in
-  // the optional header to verify a desired directory entry is there.
-  //
-  if (NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC) {
-    RelocDir     = DataDirectory + EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC;
-    RelocBase    = (EFI_IMAGE_BASE_RELOCATION *)(UINTN)(ImageBase + RelocDir->VirtualAddress);
-    RelocBaseEnd = (EFI_IMAGE_BASE_RELOCATION *)(UINTN)(ImageBase + RelocDir->VirtualAddress + RelocDir->Size);
-  } else {
-    //
-    // Cannot find relocations, good just return.
-    //
-    return;
-  }
-
-  //
-  // ASSERT for the invalid image when RelocBase and RelocBaseEnd are both NULL.
-  //
-  ASSERT (RelocBase != NULL && RelocBaseEnd != NULL);
-
-  //
-  // Run the whole relocation block. And re-fixup data that has not been
-  // modified. The FixupData is used to see if the image has been modified
-  // since it was relocated. This is so data sections that have been updated
-  // by code will not be fixed up, since that would set them back to
-  // defaults.
   //
-  while (RelocBase < RelocBaseEnd) {
-    Reloc     = (UINT16 *)((UINT8 *)RelocBase + sizeof (EFI_IMAGE_BASE_RELOCATION));
-    RelocEnd  = (UINT16 *)((UINT8 *)RelocBase + RelocBase->SizeOfBlock);
-    FixupBase = (CHAR8 *)((UINTN)ImageBase) + RelocBase->VirtualAddress;
-
-    //
-    // Run this relocation record
-    //
-    while (Reloc < RelocEnd) {
-      Fixup = FixupBase + (*Reloc & 0xFFF);
-      switch ((*Reloc) >> 12) {
-        case EFI_IMAGE_REL_BASED_ABSOLUTE:
-          break;
-
-        case EFI_IMAGE_REL_BASED_HIGH:
-          Fixup16  = (UINT16 *)Fixup;
-          *Fixup16 = (UINT16)(*Fixup16 + ((UINT16)((UINT32)Adjust >> 16)));
-          break;
-
-        case EFI_IMAGE_REL_BASED_LOW:
-          Fixup16  = (UINT16 *)Fixup;
-          *Fixup16 = (UINT16)(*Fixup16 + ((UINT16)Adjust & 0xffff));
-          break;
-
-        case EFI_IMAGE_REL_BASED_HIGHLOW:
-          Fixup32  = (UINT32 *)Fixup;
-          *Fixup32 = *Fixup32 + (UINT32)Adjust;
-          break;
-
-        case EFI_IMAGE_REL_BASED_DIR64:
-          Fixup64  = (UINT64 *)Fixup;
-          *Fixup64 = *Fixup64 + (UINT64)Adjust;
-          break;
+  // For teardown, ImageBase is where the image was relocated to, and PeImageBase is 0.
+  //
+  PeCoffFixupIndexApply (
+    &mStmFixupIndex,
+    0,
+    (VOID *)ImageBase,
+    0,
+    mStmFixupIndex.SizeOfImage,
+    (UINT64)(ImageBase - PeImageBase),
+    IsTeardown
+    );
+}
 
-        case EFI_IMAGE_REL_BASED_HIGHADJ:
-          //
-          // Not valid Relocation type for UEFI image, ASSERT
-          //
-          ASSERT (FALSE);
-          break;
+/**
 
-        default:
-          //
-          // Only Itanium requires ConvertPeImage_Ex
-          //
-          ASSERT (FALSE);
-          break;
-      }
+  This function returns the size of the fixup index of this STM image, which occupies the
+  bottom of the heap.
 
-      //
-      // Next relocation record
-      //
-      Reloc += 1;
-    }
+  @return The size in bytes of the fixup index, 0 before the image is relocated.
 
-    //
-    // next reloc block
-    //
-    RelocBase = (EFI_IMAGE_BASE_RELOCATION *)RelocEnd;
-  }
+**/
+UINTN
+GetStmFixupIndexSize (
+  VOID
+  )
+{
+  return mStmFixupIndex.Count * sizeof (PE_COFF_FIXUP);
 }
 
 /**
@@ -204,9 +88,12 @@ RelocateStmImage (
   UINTN                                StmImage;
   UINTN                                ImageBase;
   UINTN                                PeImageBase;
+  UINT32                               SizeOfImage;
   EFI_IMAGE_DOS_HEADER                 *DosHdr;
   EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
   UINT16                               Magic;
+  UINTN                                FixupCount;
+  RETURN_STATUS                        Status;
 
   StmImage = (UINTN)((UINT32)AsmReadMsr64 (IA32_SMM_MONITOR_CTL_MSR_INDEX) & 0xFFFFF000);
 
@@ -242,11 +129,13 @@ RelocateStmImage (
     // Use PE32 offset
     //
     PeImageBase = (UINTN)Hdr.Pe32->OptionalHeader.ImageBase;
+    SizeOfImage = Hdr.Pe32->OptionalHeader.SizeOfImage;
   } else {
     //
     // Use PE32+ offset
     //
     PeImageBase = (UINTN)Hdr.Pe32Plus->OptionalHeader.ImageBase;
+    SizeOfImage = Hdr.Pe32Plus->OptionalHeader.SizeOfImage;
   }
 
   //
@@ -267,6 +156,22 @@ RelocateStmImage (
       //
       CpuDeadLoop ();
     }
+
+    //
+    // Index the fixups once, at the bottom of the heap, so that both relocations are a single
+    // sweep. Nothing can be allocated yet, and InitHeap() starts the heap above the index.
+    //
+    FixupCount = (UINTN)(STM_HEAP_TOP ((STM_HEADER *)StmImage) - STM_HEAP_BOTTOM ((STM_HEADER *)StmImage)) / sizeof (PE_COFF_FIXUP);
+    Status     = PeCoffFixupIndexBuild (
+                   (VOID *)ImageBase,
+                   SizeOfImage,
+                   (PE_COFF_FIXUP *)(UINTN)STM_HEAP_BOTTOM ((STM_HEADER *)StmImage),
+                   &FixupCount,
+                   &mStmFixupIndex
+                   );
+    if (RETURN_ERROR (Status)) {
+      CpuDeadLoop ();
+    }
   } else {
     if (PeImageBase == 0) {
       //
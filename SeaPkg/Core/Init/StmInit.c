@@ -229,12 +229,11 @@ InitHeap (
   IN STM_HEADER  *StmHeader
   )
 {
-  mHostContextCommon.HeapBottom = (UINT64)((UINTN)StmHeader +
-                                           StmHeader->HwStmHdr.Cr3Offset +
-                                           STM_PAGES_TO_SIZE (6)); // reserve 6 page for page table
-  mHostContextCommon.HeapTop = (UINT64)((UINTN)StmHeader +
-                                        STM_PAGES_TO_SIZE (STM_SIZE_TO_PAGES (StmHeader->SwStmHdr.StaticImageSize)) +
-                                        StmHeader->SwStmHdr.AdditionalDynamicMemorySize);
+  //
+  // The fixup index of this image was put at the bottom of the heap by RelocateStmImage().
+  //
+  mHostContextCommon.HeapBottom = STM_HEAP_BOTTOM (StmHeader) + STM_PAGES_TO_SIZE (STM_SIZE_TO_PAGES (GetStmFixupIndexSize ()));
+  mHostContextCommon.HeapTop    = STM_HEAP_TOP (StmHeader);
 }
 
 /**
@@ -495,6 +494,11 @@ BspInit (
     mGuestContextCommonNormal.GuestContextPerCpu[SubIndex].GuestMsrEntryAddress = mGuestContextCommonNormal.GuestContextPerCpu[0].GuestMsrEntryAddress + sizeof (VM_EXIT_MSR_ENTRY) * mGuestContextCommonNormal.GuestContextPerCpu[0].GuestMsrEntryCount * SubIndex;
   }
 
+  //
+  // Cache the MMRAM ranges used to check the buffers supplied by the normal world.
+  //
+  InitializeMmramRanges ();
+
   //
   // Add more paging for Host CR3.
   //
@@ -942,11 +946,11 @@ GetCapabilities (
   }
 
   // Check the buffer supplied is not in the MSEG or TSEG.
-  if (IsBufferInsideMmram (BufferBase, BufferSize)) {
+  if (IsBufferOverlapMmram (BufferBase, BufferSize)) {
     StmStatus = ERROR_STM_PAGE_NOT_FOUND;
     WriteUnaligned32 ((UINT32 *)&Register->Rax, StmStatus);
     Status = EFI_SECURITY_VIOLATION;
-    SAFE_DEBUG ((DEBUG_ERROR, "%a Incoming buffer is inside MMRAM: Base: 0x%x, Size: 0x%x !\n", __func__, BufferBase, BufferSize));
+    SAFE_DEBUG ((DEBUG_ERROR, "%a Incoming buffer overlaps with MMRAM: Base: 0x%x, Size: 0x%x !\n", __func__, BufferBase, BufferSize));
     goto Done;
   }
 
@@ -1024,11 +1028,11 @@ GetResources (
   }
 
   // Check the buffer supplied is not in the MSEG or TSEG.
-  if ((BufferBase != 0) && IsBufferInsideMmram (BufferBase, BufferSize)) {
+  if ((BufferBase != 0) && IsBufferOverlapMmram (BufferBase, BufferSize)) {
     StmStatus = ERROR_STM_PAGE_NOT_FOUND;
     WriteUnaligned32 ((UINT32 *)&Register->Rax, StmStatus);
     Status = EFI_SECURITY_VIOLATION;
-    SAFE_DEBUG ((DEBUG_ERROR, "%a Incoming buffer is inside MMRAM: Base: 0x%x, Size: 0x%x !\n", __func__, BufferBase, BufferSize));
+    SAFE_DEBUG ((DEBUG_ERROR, "%a Incoming buffer overlaps with MMRAM: Base: 0x%x, Size: 0x%x !\n", __func__, BufferBase, BufferSize));
     goto Done;
   }
 
@@ -1045,7 +1049,7 @@ GetResources (
   CopyMem (DigestList[MM_SUPV_DIGEST_INDEX].digests[0].digest.sha256, PcdGetPtr (PcdMmSupervisorCoreHash), SHA256_DIGEST_SIZE);
 
   CpuIndex = GetIndexFromStack (Register, TRUE);
-  AcquireSpinLock (&mHostContextCommon.ResponderLock);
+  AcquireMcsLock (&mHostContextCommon.ResponderLock, &mHostContextCommon.HostContextPerCpu[CpuIndex].ResponderLockNode);
   Status = SeaResponderReport (
              CpuIndex,
              (EFI_PHYSICAL_ADDRESS)(UINTN)PcdGetPtr (PcdAuxBinFile),
@@ -1075,7 +1079,7 @@ GetResources (
   }
 
   WriteUnaligned32 ((UINT32 *)&Register->Rax, StmStatus);
-  ReleaseSpinLock (&mHostContextCommon.ResponderLock);
+  ReleaseMcsLock (&mHostContextCommon.ResponderLock, &mHostContextCommon.HostContextPerCpu[CpuIndex].ResponderLockNode);
 
 Done:
   return Status;
@@ -1125,80 +1129,25 @@ DumpMtrrsInStm (
 
 /**
 
-  This function handles VMCalls into SEA module in C code.
+  This function dumps the host and guest context, the guest-state VMCS fields, the VMX fixed
+  MSRs and the MTRRs on entry. Every field is a VMREAD/RDMSR plus a serial port round trip,
+  so this is only done when PcdSeaEntryDiagnosticsEnable is set.
 
-  @param Register X86 register context
+  @param Register                X86 register context
+  @param CpuIndex                Index of the current CPU
+  @param IsFirstEntryOnThisCore  TRUE if this is the first entry on this core
+  @param IsFirstEntryOnBsp       TRUE if this is the first entry on the BSP
 
 **/
+STATIC
 VOID
-SeaVmcallDispatcher (
-  IN X86_REGISTER  *Register
+DumpEntryDiagnostics (
+  IN X86_REGISTER  *Register,
+  IN UINT32        CpuIndex,
+  IN BOOLEAN       IsFirstEntryOnThisCore,
+  IN BOOLEAN       IsFirstEntryOnBsp
   )
 {
-  EFI_STATUS  Status;
-  BOOLEAN     IsFirstEntryOnBsp;
-  BOOLEAN     IsFirstEntryOnThisCore;
-  UINT32      CpuIndex;
-  UINT32      ServiceId;
-  STM_HEADER  *StmHeader;
-
-  if (Register == NULL) {
-    ASSERT (Register != NULL);
-    return;
-  }
-
-  IsFirstEntryOnBsp = (IsBsp () && mHostContextCommon.StmHeader == NULL);
-  if (IsFirstEntryOnBsp) {
-    // The build process should make sure "virtual address" is same as "file pointer to raw data",
-    // in final PE/COFF image, so that we can let StmLoad load binary to memory directly.
-    // If no, GenStm tool will "load image". So here, we just need "relocate image".
-    RelocateStmImage (FALSE);
-
-    // Initialize debug lock on first entry (assume GetCapabilities() is called once and first entry)
-    InitializeSpinLock (&mHostContextCommon.DebugLock);
-    InitializeSpinLock (&mHostContextCommon.MemoryLock);
-    InitializeSpinLock (&mHostContextCommon.ResponderLock);
-
-    StmHeader = (STM_HEADER *)(UINTN)((UINT32)AsmReadMsr64 (IA32_SMM_MONITOR_CTL_MSR_INDEX) & 0xFFFFF000);
-    // We have to know CpuNum, or we do not know where VMCS will be.
-    if (IsSentryEnabled ()) {
-      mHostContextCommon.CpuNum = GetCpuNumFromTxt ();
-      SAFE_DEBUG ((EFI_D_INFO, "CpuNumber from TXT Region - %d\n", (UINTN)mHostContextCommon.CpuNum));
-    } else {
-      SAFE_DEBUG ((DEBUG_ERROR, "SENTER must be enabled for before SEA execution.\n"));
-      CpuDeadLoop ();
-    }
-
-    // Note: After this mHostContextCommon can be used.
-    InitHeap (StmHeader);
-    InitBasicContext ();
-
-    ProcessLibraryConstructorList ();
-
-    SAFE_DEBUG ((DEBUG_INFO, "[%a] - (CpuNum = %d) mHostContextCommon.HostContextPerCpu = 0x%p.\n", __func__, mHostContextCommon.CpuNum, mHostContextCommon.HostContextPerCpu));
-    SAFE_DEBUG ((DEBUG_INFO, "[%a] - (CpuNum = %d) mGuestContextCommonNormal.GuestContextPerCpu = 0x%p.\n", __func__, mHostContextCommon.CpuNum, mGuestContextCommonNormal.GuestContextPerCpu));
-
-    SAFE_DEBUG ((DEBUG_INFO, "[%a][L%d] - Performing BSP init.\n", __func__, __LINE__));
-    BspInit (Register);
-    SAFE_DEBUG ((DEBUG_INFO, "[%a][L%d] - Done with first entry on BSP init.\n", __func__, __LINE__));
-
-    // The heap area below the context allocations will be "reused" across entries.
-    // This assumes all entries are serialized.
-    mHostContextCommon.HeapReusableBase = mHostContextCommon.HeapTop;
-  } else {
-    mHostContextCommon.HeapTop = mHostContextCommon.HeapReusableBase;
-    ZeroMem (
-      (VOID *)(UINTN)mHostContextCommon.HeapBottom,
-      (UINTN)(mHostContextCommon.HeapReusableBase - mHostContextCommon.HeapBottom)
-      );
-    SAFE_DEBUG ((DEBUG_INFO, "[%a] - Heap area set to 0x%p.\n", __func__, mHostContextCommon.HeapReusableBase));
-  }
-
-  CpuIndex               = GetIndexFromStack (Register, TRUE);
-  IsFirstEntryOnThisCore = mHostContextCommon.HostContextPerCpu[CpuIndex].Stack == 0;
-
-  SAFE_DEBUG ((DEBUG_ERROR, "[%a] - Enter\n", __func__));
-
   SAFE_DEBUG ((DEBUG_ERROR, "[%a] - mHostContextCommon at Entry (0x%lx [0x%lx]):\n", __func__, (UINTN)&mHostContextCommon, sizeof (mHostContextCommon)));
   DUMP_HEX (DEBUG_INFO, 0, (VOID *)&mHostContextCommon, sizeof (mHostContextCommon), "");
 
@@ -1206,7 +1155,6 @@ SeaVmcallDispatcher (
   DUMP_HEX (DEBUG_INFO, 0, (VOID *)&mGuestContextCommonNormal, sizeof (mGuestContextCommonNormal), "");
 
   SAFE_DEBUG ((DEBUG_ERROR, "[%a][L%d] - Register at 0x%p.\n", __func__, __LINE__, Register));
-  SAFE_DEBUG ((DEBUG_ERROR, "[%a][L%d] - ServiceId (local stack var) at 0x%p.\n", __func__, __LINE__, &ServiceId));
 
   SAFE_DEBUG ((DEBUG_ERROR, "[%a][L%d] - CpuIndex = 0x%x.\n", __func__, __LINE__, CpuIndex));
   SAFE_DEBUG ((DEBUG_ERROR, "[%a][L%d] - First entry on this core = %a.\n", __func__, __LINE__, IsFirstEntryOnThisCore ? "True" : "False"));
@@ -1287,6 +1235,92 @@ SeaVmcallDispatcher (
   DumpMtrrsInStm ();
 
   SAFE_DEBUG ((DEBUG_ERROR, "[%a][L%d] - LocalApicId (From ReadLocalApicId) = 0x%x\n", __func__, __LINE__, ReadLocalApicId ()));
+}
+
+/**
+
+  This function handles VMCalls into SEA module in C code.
+
+  @param Register X86 register context
+
+**/
+VOID
+SeaVmcallDispatcher (
+  IN X86_REGISTER  *Register
+  )
+{
+  EFI_STATUS  Status;
+  BOOLEAN     IsFirstEntryOnBsp;
+  BOOLEAN     IsFirstEntryOnThisCore;
+  UINT32      CpuIndex;
+  UINT32      ServiceId;
+  STM_HEADER  *StmHeader;
+
+  if (Register == NULL) {
+    ASSERT (Register != NULL);
+    return;
+  }
+
+  IsFirstEntryOnBsp = (IsBsp () && mHostContextCommon.StmHeader == NULL);
+  if (IsFirstEntryOnBsp) {
+    // The build process should make sure "virtual address" is same as "file pointer to raw data",
+    // in final PE/COFF image, so that we can let StmLoad load binary to memory directly.
+    // If no, GenStm tool will "load image". So here, we just need "relocate image".
+    RelocateStmImage (FALSE);
+
+    // Initialize debug lock on first entry (assume GetCapabilities() is called once and first entry)
+    InitializeTicketLock (&mHostContextCommon.DebugLock);
+    InitializeSpinLock (&mHostContextCommon.MemoryLock);
+    InitializeMcsLock (&mHostContextCommon.ResponderLock);
+
+    StmHeader = (STM_HEADER *)(UINTN)((UINT32)AsmReadMsr64 (IA32_SMM_MONITOR_CTL_MSR_INDEX) & 0xFFFFF000);
+    // We have to know CpuNum, or we do not know where VMCS will be.
+    if (IsSentryEnabled ()) {
+      mHostContextCommon.CpuNum = GetCpuNumFromTxt ();
+      SAFE_DEBUG ((EFI_D_INFO, "CpuNumber from TXT Region - %d\n", (UINTN)mHostContextCommon.CpuNum));
+    } else {
+      SAFE_DEBUG ((DEBUG_ERROR, "SENTER must be enabled for before SEA execution.\n"));
+      CpuDeadLoop ();
+    }
+
+    // Note: After this mHostContextCommon can be used.
+    InitHeap (StmHeader);
+    InitBasicContext ();
+
+    ProcessLibraryConstructorList ();
+
+    SAFE_DEBUG ((DEBUG_INFO, "[%a] - (CpuNum = %d) mHostContextCommon.HostContextPerCpu = 0x%p.\n", __func__, mHostContextCommon.CpuNum, mHostContextCommon.HostContextPerCpu));
+    SAFE_DEBUG ((DEBUG_INFO, "[%a] - (CpuNum = %d) mGuestContextCommonNormal.GuestContextPerCpu = 0x%p.\n", __func__, mHostContextCommon.CpuNum, mGuestContextCommonNormal.GuestContextPerCpu));
+
+    SAFE_DEBUG ((DEBUG_INFO, "[%a][L%d] - Performing BSP init.\n", __func__, __LINE__));
+    BspInit (Register);
+    SAFE_DEBUG ((DEBUG_INFO, "[%a][L%d] - Done with first entry on BSP init.\n", __func__, __LINE__));
+
+    // The heap area below the context allocations will be "reused" across entries.
+    // This assumes all entries are serialized.
+    mHostContextCommon.HeapReusableBase = mHostContextCommon.HeapTop;
+    mHostContextCommon.HeapLowWaterMark = mHostContextCommon.HeapTop;
+  } else {
+    // Only the part of the reusable area that the previous entry allocated from needs to be
+    // scrubbed. Everything below the low water mark is untouched, and AllocatePages zeroes
+    // pages again as they are handed out.
+    mHostContextCommon.HeapTop = mHostContextCommon.HeapReusableBase;
+    ZeroMem (
+      (VOID *)(UINTN)mHostContextCommon.HeapLowWaterMark,
+      (UINTN)(mHostContextCommon.HeapReusableBase - mHostContextCommon.HeapLowWaterMark)
+      );
+    mHostContextCommon.HeapLowWaterMark = mHostContextCommon.HeapReusableBase;
+    SAFE_DEBUG ((DEBUG_INFO, "[%a] - Heap area set to 0x%p.\n", __func__, mHostContextCommon.HeapReusableBase));
+  }
+
+  CpuIndex               = GetIndexFromStack (Register, TRUE);
+  IsFirstEntryOnThisCore = mHostContextCommon.HostContextPerCpu[CpuIndex].Stack == 0;
+
+  SAFE_DEBUG ((DEBUG_ERROR, "[%a] - Enter\n", __func__));
+
+  if (FeaturePcdGet (PcdSeaEntryDiagnosticsEnable)) {
+    DumpEntryDiagnostics (Register, CpuIndex, IsFirstEntryOnThisCore, IsFirstEntryOnBsp);
+  }
 
   ServiceId = ReadUnaligned32 ((UINT32 *)&Register->Rax);
   SAFE_DEBUG ((DEBUG_ERROR, "[%a][L%d] - ServiceId = 0x%x\n", __func__, __LINE__, ServiceId));
@@ -19,6 +19,17 @@
 
 extern SEA_HOST_CONTEXT_COMMON  mHostContextCommon;
 
+//
+// The heap spans MSEG from above the 6 pages of page table at Cr3Offset to the end of the
+// dynamic memory.
+//
+#define STM_HEAP_BOTTOM(StmHeader)  ((UINT64)((UINTN)(StmHeader) +\
+                                              (StmHeader)->HwStmHdr.Cr3Offset +\
+                                              STM_PAGES_TO_SIZE (6)))
+#define STM_HEAP_TOP(StmHeader)     ((UINT64)((UINTN)(StmHeader) +\
+                                              STM_PAGES_TO_SIZE (STM_SIZE_TO_PAGES ((StmHeader)->SwStmHdr.StaticImageSize)) +\
+                                              (StmHeader)->SwStmHdr.AdditionalDynamicMemorySize))
+
 /**
   Macro that calls DebugPrint().
 
@@ -35,9 +46,9 @@ extern SEA_HOST_CONTEXT_COMMON  mHostContextCommon;
 #define SAFE_DEBUG(Expression)        \
     do {                           \
       if (DebugPrintEnabled ()) {  \
-        AcquireSpinLock (&mHostContextCommon.DebugLock); \
+        AcquireTicketLock (&mHostContextCommon.DebugLock); \
         _DEBUGLIB_DEBUG (Expression);       \
-        ReleaseSpinLock (&mHostContextCommon.DebugLock); \
+        ReleaseTicketLock (&mHostContextCommon.DebugLock); \
       }                            \
     } while (FALSE)
 #else
@@ -48,7 +59,7 @@ extern SEA_HOST_CONTEXT_COMMON  mHostContextCommon;
 
   This function create page table for STM host.
   The SINIT/StmLoader should already configured 4G paging, so here
-  we just create >4G paging for X64 mode.
+  we just prepare >4G paging for X64 mode, populated on page faults.
 
 **/
 VOID
@@ -0,0 +1,641 @@
+/** @file
+  Unit tests of the lazily populated STM host paging above 4GB.
+
+  The host page tables are simulated in host memory, with the mapping below 4GB set up the way
+  the loader does. Accesses are translated by walking the tables, setting the Accessed flags
+  the way the processor does, and missing translations are handed to the mapper the way the
+  page fault handler does.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestHostBaseLib.h>
+#include <UnitTest/UnitTestRandom.h>
+
+#include "../../CpuDef.h"
+#include "../HostPagingPool.h"
+
+#define UNIT_TEST_APP_NAME     "SEA Core Host Paging Pool Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_ADDRESS_MASK_64  0x000FFFFFFFFFF000ull
+#define TEST_TABLE_ENTRIES    512
+#define TEST_MAX_POOL_PAGES   16
+
+//
+// Number of random accesses of the random test, per configuration.
+//
+#define TEST_ACCESSES  3000
+
+typedef struct {
+  UINTN      PoolPages;
+  UINT8      PhysicalAddressBits;
+  BOOLEAN    Use1GPages;
+} TEST_POOL_CONFIG;
+
+//
+// Pools tested.
+//
+TEST_POOL_CONFIG  mPool4Of2M  = { 4, 40, FALSE };
+TEST_POOL_CONFIG  mPool2Of2M  = { 2, 46, FALSE };
+TEST_POOL_CONFIG  mPool1Of2M  = { 1, 46, FALSE };
+TEST_POOL_CONFIG  mPool5Of2M  = { 5, 46, FALSE };
+TEST_POOL_CONFIG  mPool2Of1G  = { 2, 46, TRUE };
+TEST_POOL_CONFIG  mPool16Of2M = { 16, 52, FALSE };
+
+//
+// Simulated host paging.
+//
+UINT64                  *mPml4;
+UINT64                  *mLoaderPdpt;
+VOID                    *mPoolPages;
+HOST_PAGING_POOL_ENTRY  mPoolEntry[TEST_MAX_POOL_PAGES];
+HOST_PAGING_POOL        mPool;
+
+UINTN  mCr3Writes;
+
+UNIT_TEST_HOST_BASE_LIB_ASM_READ_CR3   mOriginalAsmReadCr3;
+UNIT_TEST_HOST_BASE_LIB_ASM_WRITE_CR3  mOriginalAsmWriteCr3;
+
+/**
+  Fake of AsmReadCr3 returning the simulated PML4.
+
+  @return The address of the simulated PML4.
+
+**/
+UINTN
+EFIAPI
+FakeAsmReadCr3 (
+  VOID
+  )
+{
+  return (UINTN)mPml4;
+}
+
+/**
+  Fake of AsmWriteCr3 counting the flushes of the translations.
+
+  @param[in] Cr3  The value to write to CR3.
+
+  @return Cr3.
+
+**/
+UINTN
+EFIAPI
+FakeAsmWriteCr3 (
+  IN UINTN  Cr3
+  )
+{
+  mCr3Writes++;
+  return Cr3;
+}
+
+/**
+  Translate an address through the simulated tables, setting the Accessed flags of the entries
+  walked through the way the processor does.
+
+  @param[in]   Address   The address to translate.
+  @param[out]  PageSize  The size of the page mapping Address.
+
+  @return The translated address, MAX_UINT64 when Address is not mapped.
+
+**/
+UINT64
+Translate (
+  IN  UINT64  Address,
+  OUT UINT64  *PageSize
+  )
+{
+  UINT64  *Entry;
+  UINT64  *Table;
+
+  Entry = &mPml4[(Address >> 39) & 0x1FF];
+  if ((*Entry & IA32_PG_P) == 0) {
+    return MAX_UINT64;
+  }
+
+  *Entry |= IA32_PG_A;
+  Table   = (UINT64 *)(UINTN)(*Entry & TEST_ADDRESS_MASK_64);
+  Entry   = &Table[(Address >> 30) & 0x1FF];
+  if ((*Entry & IA32_PG_P) == 0) {
+    return MAX_UINT64;
+  }
+
+  *Entry |= IA32_PG_A;
+  if ((*Entry & IA32_PG_PS) != 0) {
+    *PageSize = SIZE_1GB;
+    return (*Entry & 0x000FFFFFC0000000ull) + (Address & (SIZE_1GB - 1));
+  }
+
+  Table = (UINT64 *)(UINTN)(*Entry & TEST_ADDRESS_MASK_64);
+  Entry = &Table[(Address >> 21) & 0x1FF];
+  if (((*Entry & IA32_PG_P) == 0) || ((*Entry & IA32_PG_PS) == 0)) {
+    return MAX_UINT64;
+  }
+
+  *Entry   |= IA32_PG_A;
+  *PageSize = SIZE_2MB;
+  return (*Entry & 0x000FFFFFFFE00000ull) + (Address & (SIZE_2MB - 1));
+}
+
+/**
+  Check if an address is mapped, without touching the Accessed flags.
+
+  @param[in] Address  The address to check.
+
+  @retval TRUE   Address is mapped.
+  @retval FALSE  Address is not mapped.
+
+**/
+BOOLEAN
+IsMapped (
+  IN UINT64  Address
+  )
+{
+  UINT64  *Table;
+  UINT64  Entry;
+
+  Entry = mPml4[(Address >> 39) & 0x1FF];
+  if ((Entry & IA32_PG_P) == 0) {
+    return FALSE;
+  }
+
+  Table = (UINT64 *)(UINTN)(Entry & TEST_ADDRESS_MASK_64);
+  return (Table[(Address >> 30) & 0x1FF] & IA32_PG_P) != 0;
+}
+
+/**
+  Access an address the way the host does: on a missing translation, the page fault handler
+  maps it, and the access is restarted.
+
+  @param[in] Address  The address to access.
+
+  @retval TRUE   The access went through an identity mapping of the expected page size.
+  @retval FALSE  The access failed.
+
+**/
+BOOLEAN
+Access (
+  IN UINT64  Address
+  )
+{
+  UINT64  Translated;
+  UINT64  PageSize;
+
+  PageSize   = 0;
+  Translated = Translate (Address, &PageSize);
+  if (Translated == MAX_UINT64) {
+    if (!HostPagingPoolMap (&mPool, Address)) {
+      return FALSE;
+    }
+
+    Translated = Translate (Address, &PageSize);
+  }
+
+  if (Address < BASE_4GB) {
+    return Translated == Address;
+  }
+
+  return (Translated == Address) && (PageSize == (mPool.Use1GPages ? SIZE_1GB : SIZE_2MB));
+}
+
+/**
+  Check the bookkeeping of the pool against the simulated tables: every table referenced above
+  4GB is pooled and referenced once, from the entry recorded for it, and the loader mapping below
+  4GB is untouched.
+
+  @retval TRUE   The pool and the tables are consistent.
+  @retval FALSE  The pool and the tables are not consistent.
+
+**/
+BOOLEAN
+PoolIsConsistent (
+  VOID
+  )
+{
+  UINTN   References[TEST_MAX_POOL_PAGES];
+  UINTN   Children[TEST_MAX_POOL_PAGES];
+  UINTN   Index;
+  UINTN   Pml4Index;
+  UINTN   PdptIndex;
+  UINTN   Parent;
+  UINT64  *Pdpt;
+  UINT64  *Table;
+
+  ZeroMem (References, sizeof (References));
+  ZeroMem (Children, sizeof (Children));
+
+  for (Index = 0; Index < 4; Index++) {
+    if ((mLoaderPdpt[Index] & ~(UINT64)IA32_PG_A) != ((Index * SIZE_1GB) | IA32_PG_PS | IA32_PG_RW | IA32_PG_P)) {
+      return FALSE;
+    }
+  }
+
+  for (Pml4Index = 0; Pml4Index < TEST_TABLE_ENTRIES; Pml4Index++) {
+    if ((mPml4[Pml4Index] & IA32_PG_P) == 0) {
+      continue;
+    }
+
+    Pdpt   = (UINT64 *)(UINTN)(mPml4[Pml4Index] & TEST_ADDRESS_MASK_64);
+    Parent = MAX_UINTN;
+    if (Pml4Index == 0) {
+      if (Pdpt != mLoaderPdpt) {
+        return FALSE;
+      }
+    } else {
+      for (Parent = 0; (Parent < mPool.Count) && (mPoolEntry[Parent].Table != Pdpt); Parent++) {
+      }
+
+      if ((Parent == mPool.Count) ||
+          (mPoolEntry[Parent].ParentEntry != &mPml4[Pml4Index]) ||
+          (mPoolEntry[Parent].Parent != MAX_UINTN))
+      {
+        return FALSE;
+      }
+
+      References[Parent]++;
+    }
+
+    for (PdptIndex = (Pml4Index == 0) ? 4 : 0; PdptIndex < TEST_TABLE_ENTRIES; PdptIndex++) {
+      if (((Pdpt[PdptIndex] & IA32_PG_P) == 0) || ((Pdpt[PdptIndex] & IA32_PG_PS) != 0)) {
+        continue;
+      }
+
+      Table = (UINT64 *)(UINTN)(Pdpt[PdptIndex] & TEST_ADDRESS_MASK_64);
+      for (Index = 0; (Index < mPool.Count) && (mPoolEntry[Index].Table != Table); Index++) {
+      }
+
+      if ((Index == mPool.Count) ||
+          (mPoolEntry[Index].ParentEntry != &Pdpt[PdptIndex]) ||
+          (mPoolEntry[Index].Parent != Parent))
+      {
+        return FALSE;
+      }
+
+      References[Index]++;
+      if (Parent != MAX_UINTN) {
+        Children[Parent]++;
+      }
+    }
+  }
+
+  for (Index = 0; Index < mPool.Count; Index++) {
+    if ((References[Index] != ((mPoolEntry[Index].ParentEntry != NULL) ? 1 : 0)) ||
+        (Children[Index] != mPoolEntry[Index].ChildCount))
+    {
+      return FALSE;
+    }
+  }
+
+  return mCr3Writes == mPool.Reclaimed;
+}
+
+/**
+  Set up the simulated loader mapping below 4GB and a pool over it.
+
+  @param[in]  Context  The TEST_POOL_CONFIG of the pool.
+
+  @retval UNIT_TEST_PASSED                    The simulated tables are ready.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of memory.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SetUpPaging (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_POOL_CONFIG  *Config;
+  UINTN             Index;
+
+  Config = (TEST_POOL_CONFIG *)Context;
+
+  mPml4       = AllocatePages (1);
+  mLoaderPdpt = AllocatePages (1);
+  mPoolPages  = AllocatePages (TEST_MAX_POOL_PAGES);
+  if ((mPml4 == NULL) || (mLoaderPdpt == NULL) || (mPoolPages == NULL)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  ZeroMem (mPml4, SIZE_4KB);
+  ZeroMem (mLoaderPdpt, SIZE_4KB);
+  for (Index = 0; Index < 4; Index++) {
+    mLoaderPdpt[Index] = (Index * SIZE_1GB) | IA32_PG_PS | IA32_PG_RW | IA32_PG_P;
+  }
+
+  mPml4[0] = (UINT64)(UINTN)mLoaderPdpt | IA32_PG_RW | IA32_PG_P;
+
+  mOriginalAsmReadCr3  = gUnitTestHostBaseLib.X86->AsmReadCr3;
+  mOriginalAsmWriteCr3 = gUnitTestHostBaseLib.X86->AsmWriteCr3;
+
+  gUnitTestHostBaseLib.X86->AsmReadCr3  = FakeAsmReadCr3;
+  gUnitTestHostBaseLib.X86->AsmWriteCr3 = FakeAsmWriteCr3;
+  mCr3Writes                            = 0;
+
+  HostPagingPoolInit (&mPool, mPml4, mPoolEntry, mPoolPages, Config->PoolPages, Config->PhysicalAddressBits, Config->Use1GPages);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the simulated tables.
+
+  @param[in]  Context  Unused.
+
+**/
+VOID
+EFIAPI
+TearDownPaging (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  gUnitTestHostBaseLib.X86->AsmReadCr3  = mOriginalAsmReadCr3;
+  gUnitTestHostBaseLib.X86->AsmWriteCr3 = mOriginalAsmWriteCr3;
+
+  FreePages (mPml4, 1);
+  FreePages (mLoaderPdpt, 1);
+  FreePages (mPoolPages, TEST_MAX_POOL_PAGES);
+}
+
+/**
+  Addresses outside the range managed by the pool, or already mapped, should be left alone.
+
+  @param[in]  Context  The TEST_POOL_CONFIG of the pool.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+OutOfRangeIgnored (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_FALSE (HostPagingPoolMap (&mPool, 0));
+  UT_ASSERT_FALSE (HostPagingPoolMap (&mPool, BASE_4GB - 1));
+  UT_ASSERT_FALSE (HostPagingPoolMap (&mPool, LShiftU64 (1, 40)));
+  UT_ASSERT_FALSE (HostPagingPoolMap (&mPool, MAX_UINT64));
+
+  UT_ASSERT_TRUE (HostPagingPoolMap (&mPool, LShiftU64 (1, 40) - 1));
+  UT_ASSERT_FALSE (HostPagingPoolMap (&mPool, LShiftU64 (1, 40) - SIZE_1GB));
+  UT_ASSERT_TRUE (Access (LShiftU64 (1, 40) - SIZE_2MB));
+  UT_ASSERT_TRUE (Access (BASE_4GB - 1));
+
+  UT_ASSERT_TRUE (PoolIsConsistent ());
+  UT_ASSERT_EQUAL (mPool.Reclaimed, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The least recently used table should be reclaimed first, with a second chance for tables
+  accessed since they were last considered.
+
+  @param[in]  Context  The TEST_POOL_CONFIG of the pool, of 4 pages without 1GB pages.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LeastRecentlyUsedReclaimed (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64  Gb;
+
+  for (Gb = 4; Gb < 8; Gb++) {
+    UT_ASSERT_TRUE (HostPagingPoolMap (&mPool, Gb * SIZE_1GB));
+  }
+
+  UT_ASSERT_EQUAL (mPool.Reclaimed, 0);
+
+  UT_ASSERT_TRUE (Access (4 * SIZE_1GB + SIZE_2MB));
+  UT_ASSERT_TRUE (Access (8 * SIZE_1GB));
+
+  UT_ASSERT_EQUAL (mPool.Reclaimed, 1);
+  UT_ASSERT_TRUE (IsMapped (4 * SIZE_1GB));
+  UT_ASSERT_FALSE (IsMapped (5 * SIZE_1GB));
+  UT_ASSERT_TRUE (IsMapped (6 * SIZE_1GB));
+  UT_ASSERT_TRUE (IsMapped (7 * SIZE_1GB));
+  UT_ASSERT_TRUE (IsMapped (8 * SIZE_1GB));
+
+  UT_ASSERT_TRUE (HostPagingPoolMap (&mPool, 9 * SIZE_1GB));
+  UT_ASSERT_FALSE (IsMapped (6 * SIZE_1GB));
+  UT_ASSERT_TRUE (PoolIsConsistent ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A PDPT taken from the pool should stay while its PDs are in use, and never be reclaimed to
+  map one of its own PDs.
+
+  @param[in]  Context  The TEST_POOL_CONFIG of the pool, of 2 pages without 1GB pages.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PdptKeptWhileInUse (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_TRUE (Access (600 * SIZE_1GB));
+  UT_ASSERT_TRUE (Access (601 * SIZE_1GB));
+  UT_ASSERT_FALSE (IsMapped (600 * SIZE_1GB));
+  UT_ASSERT_TRUE (PoolIsConsistent ());
+
+  UT_ASSERT_TRUE (Access (4 * SIZE_1GB));
+  UT_ASSERT_FALSE (IsMapped (601 * SIZE_1GB));
+  UT_ASSERT_TRUE (PoolIsConsistent ());
+
+  UT_ASSERT_TRUE (Access (601 * SIZE_1GB));
+  UT_ASSERT_FALSE (IsMapped (4 * SIZE_1GB));
+  UT_ASSERT_TRUE (PoolIsConsistent ());
+
+  //
+  // Mapping under another PDPT reclaims the PD of the first PDPT, and then the first PDPT.
+  //
+  UT_ASSERT_TRUE (Access (1100 * SIZE_1GB));
+  UT_ASSERT_TRUE (PoolIsConsistent ());
+  UT_ASSERT_TRUE (Access (601 * SIZE_1GB));
+  UT_ASSERT_TRUE (PoolIsConsistent ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A pool too small to hold a PDPT and a PD should fail the mapping and stay consistent.
+
+  @param[in]  Context  The TEST_POOL_CONFIG of the pool, of 1 page without 1GB pages.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PoolTooSmallFails (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_FALSE (Access (600 * SIZE_1GB));
+  UT_ASSERT_TRUE (PoolIsConsistent ());
+
+  UT_ASSERT_TRUE (Access (4 * SIZE_1GB));
+  UT_ASSERT_TRUE (Access (5 * SIZE_1GB));
+  UT_ASSERT_FALSE (IsMapped (4 * SIZE_1GB));
+  UT_ASSERT_TRUE (PoolIsConsistent ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Random accesses over the physical address space should always go through an identity
+  mapping, with a consistent pool.
+
+  @param[in]  Context  The TEST_POOL_CONFIG of the pool.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RandomAccessesIdentityMapped (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_POOL_CONFIG  *Config;
+  UINTN             Index;
+  UINT64            Address;
+  UINT64            Recent[4];
+
+  Config       = (TEST_POOL_CONFIG *)Context;
+  mRandomState = 0xC0FFEE5EA9A61ull + Config->PoolPages;
+  ZeroMem (Recent, sizeof (Recent));
+
+  for (Index = 0; Index < TEST_ACCESSES; Index++) {
+    //
+    // Mix accesses to a small working set with accesses anywhere.
+    //
+    if ((NextRandom () % 3) == 0) {
+      Address = NextRandom () & (LShiftU64 (1, Config->PhysicalAddressBits) - 1);
+    } else {
+      Address = Recent[NextRandom () % ARRAY_SIZE (Recent)] + (NextRandom () & (SIZE_1GB - 1));
+    }
+
+    if (Address >= mPool.MaxAddress) {
+      UT_ASSERT_FALSE (Access (Address));
+    } else if (!Access (Address)) {
+      UT_LOG_ERROR ("Access 0x%lx failed after %ld accesses\n", Address, Index);
+      UT_ASSERT_TRUE (Access (Address));
+    }
+
+    if ((NextRandom () % 8) == 0) {
+      Recent[NextRandom () % ARRAY_SIZE (Recent)] = Address & ~(UINT64)(SIZE_1GB - 1);
+    }
+
+    UT_ASSERT_TRUE (PoolIsConsistent ());
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  host paging pool and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      PagingTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the host paging Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&PagingTests, Framework, "Host Paging Pool Tests", "SeaCore.HostPaging", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PagingTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (PagingTests, "Addresses outside the pool range should be ignored", "OutOfRange", OutOfRangeIgnored, SetUpPaging, TearDownPaging, &mPool4Of2M);
+  AddTestCase (PagingTests, "Least recently used table should be reclaimed", "Lru", LeastRecentlyUsedReclaimed, SetUpPaging, TearDownPaging, &mPool4Of2M);
+  AddTestCase (PagingTests, "PDPT should stay while its PDs are in use", "PdptKept", PdptKeptWhileInUse, SetUpPaging, TearDownPaging, &mPool2Of2M);
+  AddTestCase (PagingTests, "Pool too small should fail the mapping", "TooSmall", PoolTooSmallFails, SetUpPaging, TearDownPaging, &mPool1Of2M);
+  AddTestCase (PagingTests, "Random accesses should be identity mapped with 2MB pages", "Random2M", RandomAccessesIdentityMapped, SetUpPaging, TearDownPaging, &mPool5Of2M);
+  AddTestCase (PagingTests, "Random accesses should be identity mapped with 1GB pages", "Random1G", RandomAccessesIdentityMapped, SetUpPaging, TearDownPaging, &mPool2Of1G);
+  AddTestCase (PagingTests, "Random accesses should be identity mapped up to 4-level paging limit", "Random52", RandomAccessesIdentityMapped, SetUpPaging, TearDownPaging, &mPool16Of2M);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -140,10 +140,15 @@ VerifyAndHashImage (
   VOID                          *NewBuffer;
   UINTN                         NewBufferSize;
   PE_COFF_LOADER_IMAGE_CONTEXT  ImageContext;
+  PE_COFF_FIXUP_INDEX           FixupIndex;
+  PE_COFF_FIXUP                 *Fixups;
+  UINTN                         FixupCount;
 
   InternalCopy = NULL;
   Buffer       = NULL;
   NewBuffer    = NULL;
+  Fixups       = NULL;
+  FixupCount   = 0;
 
   // First need to make sure if this image is inside the MMRAM region
   if (!IsBufferInsideMmram (ImageBase, ImageSize)) {
@@ -184,8 +189,28 @@ VerifyAndHashImage (
     goto Exit;
   }
 
+  //
+  // Index the fixups of the private copy once, so that reverting them is a single sweep. The
+  // index must come from the very bytes that get hashed, not from the live image.
+  //
+  Status = PeCoffFixupIndexBuild (Buffer, (UINTN)ImageSize, NULL, &FixupCount, &FixupIndex);
+  if (Status == RETURN_BUFFER_TOO_SMALL) {
+    Fixups = AllocatePages (EFI_SIZE_TO_PAGES (FixupCount * sizeof (PE_COFF_FIXUP)));
+    if (Fixups == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Exit;
+    }
+
+    Status = PeCoffFixupIndexBuild (Buffer, (UINTN)ImageSize, Fixups, &FixupCount, &FixupIndex);
+  }
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: PeCoffFixupIndexBuild failed - %r\n", __func__, Status));
+    goto Exit;
+  }
+
   ImageContext.DestinationAddress = (EFI_PHYSICAL_ADDRESS)(VOID *)Buffer;
-  Status                          = PeCoffLoaderRevertRelocateImage (&ImageContext);
+  Status                          = PeCoffLoaderRevertRelocateImage (&ImageContext, &FixupIndex);
   if (EFI_ERROR (Status)) {
     goto Exit;
   }
@@ -236,6 +261,10 @@ Exit:
     FreePages (NewBuffer, EFI_SIZE_TO_PAGES (NewBufferSize));
   }
 
+  if (Fixups != NULL) {
+    FreePages (Fixups, EFI_SIZE_TO_PAGES (FixupCount * sizeof (PE_COFF_FIXUP)));
+  }
+
   return Status;
 }
 
@@ -17,6 +17,7 @@
 #include <Library/BaseLib.h>
 #include <Library/SafeIntLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/PcdLib.h>
 
 #include "StmRuntimeUtil.h"
 
@@ -80,31 +81,49 @@ Done:
   return Status;
 }
 
+//
+// SMRR base and mask MSR pairs describing MMRAM. The first pair is always honored, the others
+// only when the platform provides them and their valid bit is set.
+//
+STATIC CONST UINT32  mSmrrMsrPairs[][2] = {
+  { MSR_IA32_SMRR_PHYSBASE,                   MSR_IA32_SMRR_PHYSMASK                   },
+  { FixedPcdGet32 (PcdSmrr2PhysBaseMsrIndex), FixedPcdGet32 (PcdSmrr2PhysMaskMsrIndex) },
+};
+
+#define SEA_MAX_MMRAM_RANGES  ARRAY_SIZE (mSmrrMsrPairs)
+
+//
+// MMRAM ranges, sorted by base and coalesced. Written once by InitializeMmramRanges and only
+// read afterwards.
+//
+STATIC SEA_MMRAM_RANGE  mMmramRanges[SEA_MAX_MMRAM_RANGES];
+STATIC UINTN            mMmramRangeCount        = 0;
+STATIC BOOLEAN          mMmramRangesInitialized = FALSE;
+
 /**
-  This function check if the buffer is fully inside MMRAM.
+  Compute the MMRAM ranges from the SMRR MSRs.
 
-  @param Buffer  The buffer start address to be checked.
-  @param Length  The buffer length in bytes to be checked.
+  CPUID and RDMSR are serializing, and costly under the STM, so this is done once at STM
+  initialization. The MMRAM queries below only look the resulting table up.
 
-  @retval TRUE  This buffer is not part of MMRAM.
-  @retval FALSE This buffer is from MMRAM.
 **/
-BOOLEAN
+VOID
 EFIAPI
-IsBufferInsideMmram (
-  IN EFI_PHYSICAL_ADDRESS  Buffer,
-  IN UINT64                Length
+InitializeMmramRanges (
+  VOID
   )
 {
-  UINT64                          MmRamBase;
-  UINT64                          MmRamLength;
-  UINT64                          MmrrMask;
   UINT32                          MaxExtendedFunction;
   CPUID_VIR_PHY_ADDRESS_SIZE_EAX  VirPhyAddressSize;
   UINT64                          MtrrValidBitsMask;
   UINT64                          MtrrValidAddressMask;
-  BOOLEAN                         IsInside;
-  EFI_STATUS                      Status;
+  UINT64                          MmRamBase;
+  UINT64                          MmRamEnd;
+  UINT64                          MmrrMask;
+  SEA_MMRAM_RANGE                 Range;
+  UINTN                           Index;
+  UINTN                           Count;
+  UINTN                           Slot;
 
   AsmCpuid (CPUID_EXTENDED_FUNCTION, &MaxExtendedFunction, NULL, NULL, NULL);
 
@@ -117,16 +136,168 @@ IsBufferInsideMmram (
   MtrrValidBitsMask    = LShiftU64 (1, VirPhyAddressSize.Bits.PhysicalAddressBits) - 1;
   MtrrValidAddressMask = MtrrValidBitsMask & 0xfffffffffffff000ULL;
 
-  MmRamBase = AsmReadMsr64 (MSR_IA32_SMRR_PHYSBASE);
-  MmrrMask  = AsmReadMsr64 (MSR_IA32_SMRR_PHYSMASK);
-  // Extend the mask to account for the reserved bits.
-  MmrrMask   |= 0xffffffff00000000ULL;
-  MmRamLength = ((~(MmrrMask & MtrrValidAddressMask)) & MtrrValidBitsMask) + 1;
+  Count = 0;
+  for (Index = 0; Index < ARRAY_SIZE (mSmrrMsrPairs); Index++) {
+    if ((Index != 0) && (mSmrrMsrPairs[Index][0] == 0)) {
+      continue;
+    }
 
-  Status = Range1InsideRange2 (Buffer, Length, MmRamBase, MmRamLength, &IsInside);
-  if (EFI_ERROR (Status)) {
-    IsInside = FALSE;
+    MmrrMask = AsmReadMsr64 (mSmrrMsrPairs[Index][1]);
+    if ((Index != 0) && ((MmrrMask & BIT11) == 0)) {
+      continue;
+    }
+
+    // The low bits of the base hold the memory type.
+    MmRamBase = AsmReadMsr64 (mSmrrMsrPairs[Index][0]) & MtrrValidAddressMask;
+    // Extend the mask to account for the reserved bits.
+    MmrrMask |= 0xffffffff00000000ULL;
+    MmRamEnd  = MmRamBase + ((~(MmrrMask & MtrrValidAddressMask)) & MtrrValidBitsMask) + 1;
+    if (MmRamEnd <= MmRamBase) {
+      MmRamEnd = MAX_UINT64;
+    }
+
+    //
+    // Insert the range in order of base.
+    //
+    Range.Base = MmRamBase;
+    Range.End  = MmRamEnd;
+    for (Slot = Count; (Slot > 0) && (mMmramRanges[Slot - 1].Base > Range.Base); Slot--) {
+      mMmramRanges[Slot] = mMmramRanges[Slot - 1];
+    }
+
+    mMmramRanges[Slot] = Range;
+    Count++;
+  }
+
+  //
+  // Merge overlapping and adjacent ranges, so that a buffer is inside MMRAM exactly when it is
+  // inside a single range.
+  //
+  mMmramRangeCount = 0;
+  for (Index = 0; Index < Count; Index++) {
+    if ((mMmramRangeCount != 0) && (mMmramRanges[Index].Base <= mMmramRanges[mMmramRangeCount - 1].End)) {
+      mMmramRanges[mMmramRangeCount - 1].End = MAX (mMmramRanges[mMmramRangeCount - 1].End, mMmramRanges[Index].End);
+    } else {
+      mMmramRanges[mMmramRangeCount++] = mMmramRanges[Index];
+    }
+  }
+
+  mMmramRangesInitialized = TRUE;
+}
+
+/**
+  Get the MMRAM ranges computed by InitializeMmramRanges.
+
+  @param[out] RangeCount  The number of ranges.
+
+  @return The ranges, sorted by base and coalesced.
+**/
+CONST SEA_MMRAM_RANGE *
+EFIAPI
+GetMmramRanges (
+  OUT UINTN  *RangeCount
+  )
+{
+  if (!mMmramRangesInitialized) {
+    InitializeMmramRanges ();
+  }
+
+  *RangeCount = mMmramRangeCount;
+  return mMmramRanges;
+}
+
+/**
+  Find the last MMRAM range starting at or below an address.
+
+  @param Address  The address to look up.
+
+  @return The index of the range plus one, 0 if all ranges start above Address.
+**/
+STATIC
+UINTN
+FindMmramRange (
+  IN EFI_PHYSICAL_ADDRESS  Address
+  )
+{
+  UINTN  Low;
+  UINTN  High;
+  UINTN  Middle;
+
+  if (!mMmramRangesInitialized) {
+    InitializeMmramRanges ();
+  }
+
+  Low  = 0;
+  High = mMmramRangeCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (mMmramRanges[Middle].Base <= Address) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  return Low;
+}
+
+/**
+  This function check if the buffer is fully inside MMRAM.
+
+  @param Buffer  The buffer start address to be checked.
+  @param Length  The buffer length in bytes to be checked.
+
+  @retval TRUE  This buffer is fully inside MMRAM.
+  @retval FALSE This buffer is not fully inside MMRAM.
+**/
+BOOLEAN
+EFIAPI
+IsBufferInsideMmram (
+  IN EFI_PHYSICAL_ADDRESS  Buffer,
+  IN UINT64                Length
+  )
+{
+  UINT64  End;
+  UINTN   Index;
+
+  if (EFI_ERROR (SafeUint64Add (Buffer, Length, &End))) {
+    return FALSE;
+  }
+
+  Index = FindMmramRange (Buffer);
+  return (Index != 0) && (End <= mMmramRanges[Index - 1].End);
+}
+
+/**
+  This function check if the buffer overlaps with MMRAM.
+
+  @param Buffer  The buffer start address to be checked.
+  @param Length  The buffer length in bytes to be checked.
+
+  @retval TRUE  Part of this buffer is inside MMRAM, or the buffer overflows.
+  @retval FALSE This buffer is entirely outside of MMRAM.
+**/
+BOOLEAN
+EFIAPI
+IsBufferOverlapMmram (
+  IN EFI_PHYSICAL_ADDRESS  Buffer,
+  IN UINT64                Length
+  )
+{
+  UINT64  End;
+  UINTN   Index;
+
+  if (EFI_ERROR (SafeUint64Add (Buffer, Length, &End))) {
+    return TRUE;
+  }
+
+  if (Length == 0) {
+    return FALSE;
   }
 
-  return IsInside;
+  //
+  // Only the last range starting below the end of the buffer may overlap it.
+  //
+  Index = FindMmramRange (End - 1);
+  return (Index != 0) && (Buffer < mMmramRanges[Index - 1].End);
 }
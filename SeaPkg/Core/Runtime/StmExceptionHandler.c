@@ -284,6 +284,17 @@ HostExceptionHandler (
   IN EFI_SYSTEM_CONTEXT  SystemContext
   )
 {
+  //
+  // The host mapping above 4GB is populated on demand.
+  //
+  if ((sizeof (UINTN) == sizeof (UINT64)) &&
+      (InterruptType == EXCEPT_IA32_PAGE_FAULT) &&
+      ((SystemContext.SystemContextX64->ExceptionData & IA32_PF_EC_P) == 0) &&
+      HostPagingHandlePageFault (SystemContext.SystemContextX64->Cr2))
+  {
+    return;
+  }
+
   if (sizeof (UINTN) == sizeof (UINT64)) {
     DumpExceptionX64 (InterruptType, SystemContext);
   } else {
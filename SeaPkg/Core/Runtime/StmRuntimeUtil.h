@@ -61,14 +61,48 @@ Range1InsideRange2 (
   OUT BOOLEAN  *IsInside
   );
 
+///
+/// One MMRAM range described by the SMRR MSRs, spanning [Base, End).
+///
+typedef struct {
+  UINT64    Base;
+  UINT64    End;
+} SEA_MMRAM_RANGE;
+
+/**
+  Compute the MMRAM ranges from the SMRR MSRs.
+
+  CPUID and RDMSR are serializing, and costly under the STM, so this is done once at STM
+  initialization. The MMRAM queries below only look the resulting table up.
+
+**/
+VOID
+EFIAPI
+InitializeMmramRanges (
+  VOID
+  );
+
+/**
+  Get the MMRAM ranges computed by InitializeMmramRanges.
+
+  @param[out] RangeCount  The number of ranges.
+
+  @return The ranges, sorted by base and coalesced.
+**/
+CONST SEA_MMRAM_RANGE *
+EFIAPI
+GetMmramRanges (
+  OUT UINTN  *RangeCount
+  );
+
 /**
   This function check if the buffer is fully inside MMRAM.
 
   @param Buffer  The buffer start address to be checked.
   @param Length  The buffer length in bytes to be checked.
 
-  @retval TRUE  This buffer is not part of MMRAM.
-  @retval FALSE This buffer is from MMRAM.
+  @retval TRUE  This buffer is fully inside MMRAM.
+  @retval FALSE This buffer is not fully inside MMRAM.
 **/
 BOOLEAN
 EFIAPI
@@ -77,6 +111,22 @@ IsBufferInsideMmram (
   IN UINT64                Length
   );
 
+/**
+  This function check if the buffer overlaps with MMRAM.
+
+  @param Buffer  The buffer start address to be checked.
+  @param Length  The buffer length in bytes to be checked.
+
+  @retval TRUE  Part of this buffer is inside MMRAM, or the buffer overflows.
+  @retval FALSE This buffer is entirely outside of MMRAM.
+**/
+BOOLEAN
+EFIAPI
+IsBufferOverlapMmram (
+  IN EFI_PHYSICAL_ADDRESS  Buffer,
+  IN UINT64                Length
+  );
+
 /**
   The main validation routine for the SEA Core. This routine will validate the input
   to make sure the MMI entry data section is populated with legit values, then hash
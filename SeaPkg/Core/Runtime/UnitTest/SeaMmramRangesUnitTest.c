@@ -0,0 +1,610 @@
+/** @file
+  Unit tests of the MMRAM range table the SEA core checks buffers against.
+
+  The SMRR MSRs and the physical address size reported by CPUID are faked, so that the table
+  can be built from arbitrary geometries. Every verdict on random buffers must match the one of
+  a page by page model of the SMRR ranges.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <PiMm.h>
+#include <SeaResponder.h>
+#include <IndustryStandard/Tpm20.h>
+#include <Register/Msr.h>
+#include <Register/Cpuid.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PcdLib.h>
+
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestHostBaseLib.h>
+#include <UnitTest/UnitTestRandom.h>
+
+#include "../StmRuntimeUtil.h"
+
+#define UNIT_TEST_APP_NAME     "SEA Core MMRAM Range Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Memory type of the faked SMRR bases, which must not leak into the ranges.
+//
+#define TEST_SMRR_TYPE_WB  0x06
+
+#define TEST_SMRR_VALID  BIT11
+
+//
+// Simulated address space: the random SMRR ranges live in a window of TEST_WINDOW_PAGES pages,
+// and the random buffers are picked around it.
+//
+#define TEST_WINDOW_BASE   0x80000000ull
+#define TEST_WINDOW_PAGES  64
+#define TEST_MAX_SIZE_LOG  5
+
+//
+// Number of random geometries, and number of random buffers checked against each geometry.
+//
+#define TEST_ROUNDS   300
+#define TEST_BUFFERS  400
+
+//
+// Faked processor state.
+//
+UINT64  mSmrrPhysBase;
+UINT64  mSmrrPhysMask;
+UINT64  mSmrr2PhysBase;
+UINT64  mSmrr2PhysMask;
+UINT32  mMaxExtendedFunction;
+UINT8   mPhysicalAddressBits;
+
+UINTN  mMsrReads;
+UINTN  mUnknownMsrReads;
+UINTN  mCpuidCalls;
+
+UNIT_TEST_HOST_BASE_LIB_ASM_READ_MSR64  mOriginalAsmReadMsr64;
+UNIT_TEST_HOST_BASE_LIB_ASM_CPUID       mOriginalAsmCpuid;
+
+/**
+  Fake of AsmReadMsr64 returning the faked SMRR MSRs.
+
+  @param[in] Index  The MSR index to read.
+
+  @return The faked value of the MSR, 0 for MSRs that are not faked.
+
+**/
+UINT64
+EFIAPI
+FakeAsmReadMsr64 (
+  IN UINT32  Index
+  )
+{
+  mMsrReads++;
+
+  if (Index == MSR_IA32_SMRR_PHYSBASE) {
+    return mSmrrPhysBase;
+  } else if (Index == MSR_IA32_SMRR_PHYSMASK) {
+    return mSmrrPhysMask;
+  } else if (Index == FixedPcdGet32 (PcdSmrr2PhysBaseMsrIndex)) {
+    return mSmrr2PhysBase;
+  } else if (Index == FixedPcdGet32 (PcdSmrr2PhysMaskMsrIndex)) {
+    return mSmrr2PhysMask;
+  }
+
+  mUnknownMsrReads++;
+  return 0;
+}
+
+/**
+  Fake of AsmCpuid reporting the faked physical address size.
+
+  @param[in]   Index  The 32-bit value to load into EAX prior to invoking the CPUID instruction.
+  @param[out]  Eax    The pointer to the value returned in EAX.
+  @param[out]  Ebx    The pointer to the value returned in EBX.
+  @param[out]  Ecx    The pointer to the value returned in ECX.
+  @param[out]  Edx    The pointer to the value returned in EDX.
+
+  @return Index.
+
+**/
+UINT32
+EFIAPI
+FakeAsmCpuid (
+  IN      UINT32  Index,
+  OUT     UINT32  *Eax   OPTIONAL,
+  OUT     UINT32  *Ebx   OPTIONAL,
+  OUT     UINT32  *Ecx   OPTIONAL,
+  OUT     UINT32  *Edx   OPTIONAL
+  )
+{
+  UINT32  Value;
+
+  mCpuidCalls++;
+
+  Value = 0;
+  if (Index == CPUID_EXTENDED_FUNCTION) {
+    Value = mMaxExtendedFunction;
+  } else if (Index == CPUID_VIR_PHY_ADDRESS_SIZE) {
+    Value = mPhysicalAddressBits;
+  }
+
+  if (Eax != NULL) {
+    *Eax = Value;
+  }
+
+  if (Ebx != NULL) {
+    *Ebx = 0;
+  }
+
+  if (Ecx != NULL) {
+    *Ecx = 0;
+  }
+
+  if (Edx != NULL) {
+    *Edx = 0;
+  }
+
+  return Index;
+}
+
+/**
+  Get the SMRR mask MSR value describing a naturally aligned range.
+
+  @param[in] Size   The size of the range, a power of two of at least a page.
+  @param[in] Valid  Whether the valid bit is set.
+
+  @return The mask MSR value.
+
+**/
+UINT64
+SmrrMask (
+  IN UINT64   Size,
+  IN BOOLEAN  Valid
+  )
+{
+  return ((~(Size - 1)) & 0xFFFFF000ull) | (Valid ? TEST_SMRR_VALID : 0);
+}
+
+/**
+  Check if a page is described by one of the valid SMRR pairs faked in the MSRs.
+
+  @param[in] Page  The address of the page.
+
+  @retval TRUE   The page is MMRAM.
+  @retval FALSE  The page is not MMRAM.
+
+**/
+BOOLEAN
+ReferencePageInMmram (
+  IN EFI_PHYSICAL_ADDRESS  Page
+  )
+{
+  UINT64  Mask;
+
+  Mask = mSmrrPhysMask & 0xFFFFF000ull;
+  if ((Page & Mask) == (mSmrrPhysBase & Mask)) {
+    return TRUE;
+  }
+
+  Mask = mSmrr2PhysMask & 0xFFFFF000ull;
+  if (((mSmrr2PhysMask & TEST_SMRR_VALID) != 0) && ((Page & Mask) == (mSmrr2PhysBase & Mask))) {
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/**
+  Model of the MMRAM checks: walk the pages covered by a buffer and check each of them against
+  the SMRR pairs.
+
+  @param[in]   Buffer   The buffer start address, below 4GB.
+  @param[in]   Length   The buffer length, not 0.
+  @param[out]  Inside   TRUE when every page of the buffer is MMRAM.
+  @param[out]  Overlap  TRUE when any page of the buffer is MMRAM.
+
+**/
+VOID
+ReferenceCheckBuffer (
+  IN  EFI_PHYSICAL_ADDRESS  Buffer,
+  IN  UINT64                Length,
+  OUT BOOLEAN               *Inside,
+  OUT BOOLEAN               *Overlap
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Page;
+
+  *Inside  = TRUE;
+  *Overlap = FALSE;
+  for (Page = Buffer & ~(UINT64)EFI_PAGE_MASK; Page < Buffer + Length; Page += EFI_PAGE_SIZE) {
+    if (ReferencePageInMmram (Page)) {
+      *Overlap = TRUE;
+    } else {
+      *Inside = FALSE;
+    }
+  }
+}
+
+/**
+  Fake a random, naturally aligned, SMRR range within the window.
+
+  @param[out] PhysBase  The base MSR value.
+  @param[out] PhysMask  The mask MSR value.
+
+**/
+VOID
+GenerateSmrr (
+  OUT UINT64  *PhysBase,
+  OUT UINT64  *PhysMask
+  )
+{
+  UINT64  Pages;
+
+  Pages     = LShiftU64 (1, RandomBelow (TEST_MAX_SIZE_LOG + 1));
+  *PhysBase = TEST_WINDOW_BASE + EFI_PAGES_TO_SIZE (RandomBelow (TEST_WINDOW_PAGES / Pages) * Pages) + TEST_SMRR_TYPE_WB;
+  *PhysMask = SmrrMask (EFI_PAGES_TO_SIZE (Pages), TRUE);
+}
+
+/**
+  Install the fakes of the processor and reset the faked state.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The fakes are installed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+InstallFakes (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mOriginalAsmReadMsr64 = gUnitTestHostBaseLib.X86->AsmReadMsr64;
+  mOriginalAsmCpuid     = gUnitTestHostBaseLib.X86->AsmCpuid;
+
+  gUnitTestHostBaseLib.X86->AsmReadMsr64 = FakeAsmReadMsr64;
+  gUnitTestHostBaseLib.X86->AsmCpuid     = FakeAsmCpuid;
+
+  mSmrrPhysBase        = 0x7F000000ull + TEST_SMRR_TYPE_WB;
+  mSmrrPhysMask        = SmrrMask (SIZE_16MB, TRUE);
+  mSmrr2PhysBase       = 0;
+  mSmrr2PhysMask       = 0;
+  mMaxExtendedFunction = CPUID_VIR_PHY_ADDRESS_SIZE;
+  mPhysicalAddressBits = 39;
+  mMsrReads            = 0;
+  mUnknownMsrReads     = 0;
+  mCpuidCalls          = 0;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Restore the processor services replaced by InstallFakes.
+
+  @param[in]  Context  Unused.
+
+**/
+VOID
+EFIAPI
+RemoveFakes (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  gUnitTestHostBaseLib.X86->AsmReadMsr64 = mOriginalAsmReadMsr64;
+  gUnitTestHostBaseLib.X86->AsmCpuid     = mOriginalAsmCpuid;
+}
+
+/**
+  The SMRR range should be read once, without its memory type, and its edges should be exact
+  for both queries.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SingleRangeEdges (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST SEA_MMRAM_RANGE  *Ranges;
+  UINTN                  Count;
+  UINTN                  MsrReads;
+  UINTN                  CpuidCalls;
+  UINTN                  Index;
+
+  InitializeMmramRanges ();
+
+  Ranges = GetMmramRanges (&Count);
+  UT_ASSERT_EQUAL (Count, 1);
+  UT_ASSERT_EQUAL (Ranges[0].Base, 0x7F000000);
+  UT_ASSERT_EQUAL (Ranges[0].End, 0x80000000);
+  UT_ASSERT_EQUAL (mUnknownMsrReads, 0);
+
+  UT_ASSERT_TRUE (IsBufferInsideMmram (0x7F000000, SIZE_16MB));
+  UT_ASSERT_TRUE (IsBufferInsideMmram (0x7FFFFFFF, 1));
+  UT_ASSERT_FALSE (IsBufferInsideMmram (0x7EFFFFFF, 2));
+  UT_ASSERT_FALSE (IsBufferInsideMmram (0x7FFFFFFF, 2));
+  UT_ASSERT_FALSE (IsBufferInsideMmram (0x80000000, 1));
+  UT_ASSERT_FALSE (IsBufferInsideMmram (MAX_UINT64, 2));
+
+  UT_ASSERT_TRUE (IsBufferOverlapMmram (0x7EFFFFFF, 2));
+  UT_ASSERT_TRUE (IsBufferOverlapMmram (0x7FFFFFFF, 2));
+  UT_ASSERT_TRUE (IsBufferOverlapMmram (0, MAX_UINT64));
+  UT_ASSERT_FALSE (IsBufferOverlapMmram (0x7EFFFFFF, 1));
+  UT_ASSERT_FALSE (IsBufferOverlapMmram (0x80000000, SIZE_4GB));
+  UT_ASSERT_FALSE (IsBufferOverlapMmram (0x7F000000, 0));
+  UT_ASSERT_TRUE (IsBufferOverlapMmram (MAX_UINT64, 2));
+
+  //
+  // The queries only look the table up.
+  //
+  MsrReads   = mMsrReads;
+  CpuidCalls = mCpuidCalls;
+  for (Index = 0; Index < 1000; Index++) {
+    IsBufferInsideMmram (0x7F000000 + Index, EFI_PAGE_SIZE);
+    IsBufferOverlapMmram (0x7F000000 - Index, EFI_PAGE_SIZE);
+  }
+
+  UT_ASSERT_EQUAL (mMsrReads, MsrReads);
+  UT_ASSERT_EQUAL (mCpuidCalls, CpuidCalls);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The second SMRR pair should only count when valid, and be sorted and coalesced with the
+  first one.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SecondRangeSortedAndCoalesced (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST SEA_MMRAM_RANGE  *Ranges;
+  UINTN                  Count;
+
+  //
+  // Disjoint and below the first range.
+  //
+  mSmrr2PhysBase = 0x10000000ull + TEST_SMRR_TYPE_WB;
+  mSmrr2PhysMask = SmrrMask (SIZE_1MB, TRUE);
+  InitializeMmramRanges ();
+
+  Ranges = GetMmramRanges (&Count);
+  UT_ASSERT_EQUAL (Count, 2);
+  UT_ASSERT_EQUAL (Ranges[0].Base, 0x10000000);
+  UT_ASSERT_EQUAL (Ranges[0].End, 0x10100000);
+  UT_ASSERT_EQUAL (Ranges[1].Base, 0x7F000000);
+  UT_ASSERT_EQUAL (Ranges[1].End, 0x80000000);
+
+  UT_ASSERT_TRUE (IsBufferInsideMmram (0x10000000, SIZE_1MB));
+  UT_ASSERT_FALSE (IsBufferInsideMmram (0x10000000, SIZE_1MB + 1));
+  UT_ASSERT_FALSE (IsBufferOverlapMmram (0x10100000, 0x7F000000 - 0x10100000));
+  UT_ASSERT_TRUE (IsBufferOverlapMmram (0x10100000, 0x7F000000 - 0x10100000 + 1));
+
+  //
+  // Adjacent to the end of the first range.
+  //
+  mSmrr2PhysBase = 0x80000000ull;
+  InitializeMmramRanges ();
+
+  Ranges = GetMmramRanges (&Count);
+  UT_ASSERT_EQUAL (Count, 1);
+  UT_ASSERT_EQUAL (Ranges[0].Base, 0x7F000000);
+  UT_ASSERT_EQUAL (Ranges[0].End, 0x80100000);
+  UT_ASSERT_TRUE (IsBufferInsideMmram (0x7FFFF000, 2 * EFI_PAGE_SIZE));
+
+  //
+  // Not valid.
+  //
+  mSmrr2PhysMask = SmrrMask (SIZE_1MB, FALSE);
+  InitializeMmramRanges ();
+
+  Ranges = GetMmramRanges (&Count);
+  UT_ASSERT_EQUAL (Count, 1);
+  UT_ASSERT_EQUAL (Ranges[0].End, 0x80000000);
+  UT_ASSERT_FALSE (IsBufferOverlapMmram (0x80000000, SIZE_1MB));
+  UT_ASSERT_EQUAL (mUnknownMsrReads, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The physical address size should default to 36 bits when CPUID does not report it, and
+  bound the SMRR base.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PhysicalAddressSizeBoundsBase (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST SEA_MMRAM_RANGE  *Ranges;
+  UINTN                  Count;
+
+  mSmrrPhysBase       |= LShiftU64 (1, 40);
+  mMaxExtendedFunction = CPUID_EXTENDED_FUNCTION;
+  InitializeMmramRanges ();
+
+  Ranges = GetMmramRanges (&Count);
+  UT_ASSERT_EQUAL (Count, 1);
+  UT_ASSERT_EQUAL (Ranges[0].Base, 0x7F000000);
+  UT_ASSERT_EQUAL (Ranges[0].End, 0x80000000);
+
+  mMaxExtendedFunction = CPUID_VIR_PHY_ADDRESS_SIZE;
+  mPhysicalAddressBits = 46;
+  InitializeMmramRanges ();
+
+  Ranges = GetMmramRanges (&Count);
+  UT_ASSERT_EQUAL (Count, 1);
+  UT_ASSERT_EQUAL (Ranges[0].Base, LShiftU64 (1, 40) + 0x7F000000);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Both queries should match the page by page model on random geometries and buffers.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RandomBuffersMatchReference (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN                 Round;
+  UINTN                 Index;
+  EFI_PHYSICAL_ADDRESS  Buffer;
+  UINT64                Length;
+  BOOLEAN               Inside;
+  BOOLEAN               Overlap;
+
+  mRandomState = 0x5EA0A11CE5EEDull;
+
+  for (Round = 0; Round < TEST_ROUNDS; Round++) {
+    GenerateSmrr (&mSmrrPhysBase, &mSmrrPhysMask);
+    GenerateSmrr (&mSmrr2PhysBase, &mSmrr2PhysMask);
+    if (RandomBelow (4) == 0) {
+      mSmrr2PhysMask &= ~TEST_SMRR_VALID;
+    }
+
+    InitializeMmramRanges ();
+
+    for (Index = 0; Index < TEST_BUFFERS; Index++) {
+      Buffer = TEST_WINDOW_BASE - 2 * EFI_PAGE_SIZE + RandomBelow (EFI_PAGES_TO_SIZE (TEST_WINDOW_PAGES + 4));
+      if (RandomBelow (2) == 0) {
+        Buffer &= ~(UINT64)EFI_PAGE_MASK;
+      }
+
+      Length = 1 + RandomBelow (EFI_PAGES_TO_SIZE (8));
+      if (RandomBelow (2) == 0) {
+        Length = ALIGN_VALUE (Length, EFI_PAGE_SIZE);
+      }
+
+      ReferenceCheckBuffer (Buffer, Length, &Inside, &Overlap);
+      if ((IsBufferInsideMmram (Buffer, Length) != Inside) ||
+          (IsBufferOverlapMmram (Buffer, Length) != Overlap))
+      {
+        UT_LOG_ERROR (
+          "Buffer 0x%lx + 0x%lx, SMRR 0x%lx/0x%lx, SMRR2 0x%lx/0x%lx\n",
+          Buffer,
+          Length,
+          mSmrrPhysBase,
+          mSmrrPhysMask,
+          mSmrr2PhysBase,
+          mSmrr2PhysMask
+          );
+        UT_ASSERT_EQUAL (IsBufferInsideMmram (Buffer, Length), Inside);
+        UT_ASSERT_EQUAL (IsBufferOverlapMmram (Buffer, Length), Overlap);
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  MMRAM range table and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      MmramTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the MMRAM range Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&MmramTests, Framework, "MMRAM Range Tests", "SeaCore.MmramRanges", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for MmramTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (MmramTests, "SMRR range should be cached without its memory type", "SingleRange", SingleRangeEdges, InstallFakes, RemoveFakes, NULL);
+  AddTestCase (MmramTests, "Second SMRR range should be sorted and coalesced when valid", "SecondRange", SecondRangeSortedAndCoalesced, InstallFakes, RemoveFakes, NULL);
+  AddTestCase (MmramTests, "Physical address size should bound the SMRR base", "PhysicalAddressSize", PhysicalAddressSizeBoundsBase, InstallFakes, RemoveFakes, NULL);
+  AddTestCase (MmramTests, "Queries should match the SMRR pages on random buffers", "RandomBuffers", RandomBuffersMatchReference, InstallFakes, RemoveFakes, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
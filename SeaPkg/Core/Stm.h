@@ -20,6 +20,7 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/IoLib.h>
 #include <Library/SynchronizationLib.h>
+#include <Library/SeaSynchronizationLib.h>
 #include <Library/DebugLib.h>
 #include <Library/StmPlatformLib.h>
 #include <Library/StmLib.h>
@@ -143,6 +144,19 @@ RelocateStmImage (
   IN BOOLEAN  IsTeardown
   );
 
+/**
+
+  This function returns the size of the fixup index of this STM image, which occupies the
+  bottom of the heap.
+
+  @return The size in bytes of the fixup index, 0 before the image is relocated.
+
+**/
+UINTN
+GetStmFixupIndexSize (
+  VOID
+  );
+
 /**
 
   This function return local APIC ID.
@@ -212,6 +226,20 @@ SmmGetMemoryAttributes (
   OUT UINT64                *Attributes
   );
 
+/**
+  Map the host page missing for an address above 4GB.
+
+  @param[in] FaultAddress  The linear address that caused the page fault.
+
+  @retval TRUE   The address is now mapped, the faulting instruction can be restarted.
+  @retval FALSE  The fault is not caused by the lazy host mapping.
+
+**/
+BOOLEAN
+HostPagingHandlePageFault (
+  IN UINT64  FaultAddress
+  );
+
 /**
 
   Initialize external vector table pointer.
@@ -446,12 +474,14 @@ typedef struct _SEA_HOST_CONTEXT_PER_CPU {
   // Note: JumpBuffer is currently not used. Reserved for potential use in Setup/TearDown.
   BOOLEAN                         JumpBufferValid;
   BASE_LIBRARY_JUMP_BUFFER        JumpBuffer;
+
+  MCS_LOCK_NODE                   ResponderLockNode;
 } SEA_HOST_CONTEXT_PER_CPU;
 
 typedef struct _SEA_HOST_CONTEXT_COMMON {
-  SPIN_LOCK                   DebugLock;
+  TICKET_LOCK                 DebugLock;
   SPIN_LOCK                   MemoryLock;
-  SPIN_LOCK                   ResponderLock;
+  MCS_LOCK                    ResponderLock;
   UINT32                      CpuNum;
   UINT32                      JoinedCpuNum;
   UINTN                       PageTable;
@@ -460,6 +490,7 @@ typedef struct _SEA_HOST_CONTEXT_COMMON {
   UINT64                      HeapBottom;
   UINT64                      HeapTop;
   UINT64                      HeapReusableBase;
+  UINT64                      HeapLowWaterMark; // Lowest HeapTop since the reusable area was last scrubbed.
   UINT8                       PhysicalAddressBits;
   STM_HEADER                  *StmHeader;
   UINT64                      TsegBase;
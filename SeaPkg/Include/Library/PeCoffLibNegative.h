@@ -27,6 +27,93 @@
 #ifndef BASE_PECOFF_LIB_NEGATIVE_H_
 #define BASE_PECOFF_LIB_NEGATIVE_H_
 
+///
+/// A base relocation of a loaded PE/COFF image: the RVA of the patched field in the upper 28
+/// bits, and its EFI_IMAGE_REL_BASED_* type in the lower 4 bits, so that fixups sort by RVA.
+///
+typedef UINT32 PE_COFF_FIXUP;
+
+#define PE_COFF_FIXUP_MAX_RVA          0x0FFFFFFF
+#define PE_COFF_FIXUP_MAKE(Rva, Type)  ((PE_COFF_FIXUP)(((Rva) << 4) | ((Type) & 0xF)))
+#define PE_COFF_FIXUP_RVA(Fixup)       ((Fixup) >> 4)
+#define PE_COFF_FIXUP_TYPE(Fixup)      ((Fixup) & 0xF)
+
+///
+/// The base relocations of a loaded PE/COFF image, validated and sorted by RVA.
+///
+typedef struct {
+  PE_COFF_FIXUP    *Fixups;
+  UINTN            Count;
+  UINT32           SizeOfImage;
+} PE_COFF_FIXUP_INDEX;
+
+/**
+  Build the sorted fixup index of a PE/COFF image loaded in memory.
+
+  The image is read at its section alignment, as it is after being loaded, and only its
+  headers and base relocation directory are read.
+
+  @param  Image       The pointer to the loaded PE32 or PE32+ image.
+  @param  ImageSize   The size of the buffer holding the image.
+  @param  Fixups      The buffer receiving the fixups, may be NULL if FixupCount is 0.
+  @param  FixupCount  On input, the number of fixups Fixups can hold. On output, the number of
+                      fixups of the image.
+  @param  Index       The index describing the fixups stored in Fixups.
+
+  @retval RETURN_SUCCESS           Index describes the fixups of the image.
+  @retval RETURN_BUFFER_TOO_SMALL  Fixups is too small to hold FixupCount fixups.
+  @retval RETURN_INVALID_PARAMETER Image, FixupCount or Index is NULL.
+  @retval RETURN_LOAD_ERROR        The headers or the base relocation directory are malformed.
+  @retval RETURN_UNSUPPORTED       A base relocation type is not supported, or the image is
+                                   larger than PE_COFF_FIXUP_MAX_RVA.
+
+**/
+RETURN_STATUS
+EFIAPI
+PeCoffFixupIndexBuild (
+  IN     CONST VOID           *Image,
+  IN     UINTN                ImageSize,
+  OUT    PE_COFF_FIXUP        *Fixups OPTIONAL,
+  IN OUT UINTN                *FixupCount,
+  OUT    PE_COFF_FIXUP_INDEX  *Index
+  );
+
+/**
+  Apply or revert the fixups of an index to a window of a loaded PE/COFF image.
+
+  The fixups are applied in index order from Cursor on, up to the first one that does not fit
+  entirely below End. Relocating or reverting a whole image is a single call with Cursor 0,
+  Start 0 and End set to the SizeOfImage of the index. A caller streaming the image through a
+  smaller buffer calls again with the returned cursor, keeping the bytes from the RVA of that
+  fixup on in the next window.
+
+  If Index or Image is NULL, then ASSERT().
+  If Start is larger than End, or End is larger than the SizeOfImage of the index, then ASSERT().
+  If the fixup at Cursor starts below Start, then ASSERT().
+
+  @param  Index   The fixup index of the image.
+  @param  Cursor  The position in the index of the first fixup to apply.
+  @param  Image   The pointer to the byte at RVA Start of the image.
+  @param  Start   The RVA of the first byte of the window.
+  @param  End     The RVA following the last byte of the window.
+  @param  Adjust  The difference between the new and the old base address of the image.
+  @param  Revert  TRUE to undo a relocation by Adjust, FALSE to apply it.
+
+  @return The position in the index of the first fixup not applied, Count when all of them are.
+
+**/
+UINTN
+EFIAPI
+PeCoffFixupIndexApply (
+  IN     CONST PE_COFF_FIXUP_INDEX  *Index,
+  IN     UINTN                      Cursor,
+  IN OUT VOID                       *Image,
+  IN     UINTN                      Start,
+  IN     UINTN                      End,
+  IN     UINT64                     Adjust,
+  IN     BOOLEAN                    Revert
+  );
+
 /**
   Applies relocation fixups to a PE/COFF image that was loaded with PeCoffLoaderLoadImage().
 
@@ -46,21 +133,24 @@
   cache(s) in hardware, then the caller is responsible for performing cache maintenance operations
   prior to transferring control to a PE/COFF image that is loaded using this library.
 
+  The fixups are reverted from FixupIndex, built with PeCoffFixupIndexBuild() from the image at
+  DestinationAddress, in a single sweep. The fixup log is written in the order of the index.
+
   @param  ImageContext        The pointer to the image context structure that describes the PE/COFF
                               image that is being relocated.
+  @param  FixupIndex          The fixup index of the image at DestinationAddress.
 
   @retval RETURN_SUCCESS      The PE/COFF image was relocated.
                               Extended status information is in the ImageError field of ImageContext.
   @retval RETURN_LOAD_ERROR   The image in not a valid PE/COFF image.
                               Extended status information is in the ImageError field of ImageContext.
-  @retval RETURN_UNSUPPORTED  A relocation record type is not supported.
-                              Extended status information is in the ImageError field of ImageContext.
 
 **/
 RETURN_STATUS
 EFIAPI
 PeCoffLoaderRevertRelocateImage (
-  IN OUT PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext
+  IN OUT PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext,
+  IN     CONST PE_COFF_FIXUP_INDEX     *FixupIndex
   );
 
 /**
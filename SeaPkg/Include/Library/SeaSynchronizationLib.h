@@ -0,0 +1,208 @@
+/** @file
+  Fair and contention friendly locks, complementing the spin locks of SynchronizationLib.
+
+  A SPIN_LOCK is taken by whichever CPU wins its compare exchange, so under contention every
+  waiter keeps pulling the same cache line, and nothing prevents one CPU from being starved.
+
+  A TICKET_LOCK is granted in arrival order. Waiters still spin on a shared line, but only read
+  it, and back off in proportion to their position in the queue.
+
+  An MCS_LOCK is granted in arrival order too, and each waiter spins on its own MCS_LOCK_NODE,
+  so a release only touches the line of the next waiter. A node is owned by one CPU, and may
+  only be queued on one lock at a time.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef SEA_SYNCHRONIZATION_LIB_H_
+#define SEA_SYNCHRONIZATION_LIB_H_
+
+#include <Library/SynchronizationLib.h>
+
+///
+/// A lock granted in the order it is requested.
+///
+typedef struct {
+  volatile UINT32    Next;      // Ticket handed to the next requester
+  volatile UINT32    Serving;   // Ticket of the holder
+} TICKET_LOCK;
+
+///
+/// A waiter queued on an MCS_LOCK. Pad it to a cache line to keep waiters apart.
+///
+typedef struct _MCS_LOCK_NODE {
+  struct _MCS_LOCK_NODE *volatile    Next;
+  volatile UINT32                    Waiting;
+  UINT8                              Reserved[64 - sizeof (VOID *) - sizeof (UINT32)];
+} MCS_LOCK_NODE;
+
+///
+/// A lock granted in the order it is requested, each waiter spinning on its own node.
+///
+typedef struct {
+  MCS_LOCK_NODE *volatile    Tail;  // Last queued node, NULL when the lock is free
+} MCS_LOCK;
+
+/**
+  Initializes a ticket lock to the released state.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to initialize.
+
+  @return TicketLock in the released state.
+
+**/
+TICKET_LOCK *
+EFIAPI
+InitializeTicketLock (
+  OUT TICKET_LOCK  *TicketLock
+  );
+
+/**
+  Waits until all earlier requesters released a ticket lock, then places it in the acquired
+  state.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to acquire.
+
+  @return TicketLock in the acquired state.
+
+**/
+TICKET_LOCK *
+EFIAPI
+AcquireTicketLock (
+  IN OUT TICKET_LOCK  *TicketLock
+  );
+
+/**
+  Attempts to place a ticket lock in the acquired state, failing if it is held or requested.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to acquire.
+
+  @retval TRUE   TicketLock was placed in the acquired state.
+  @retval FALSE  TicketLock could not be acquired.
+
+**/
+BOOLEAN
+EFIAPI
+AcquireTicketLockOrFail (
+  IN OUT TICKET_LOCK  *TicketLock
+  );
+
+/**
+  Releases a ticket lock, granting it to the next requester if any.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to release.
+
+  @return TicketLock released.
+
+**/
+TICKET_LOCK *
+EFIAPI
+ReleaseTicketLock (
+  IN OUT TICKET_LOCK  *TicketLock
+  );
+
+/**
+  Initializes an MCS lock to the released state.
+
+  If McsLock is NULL, then ASSERT().
+
+  @param  McsLock  A pointer to the MCS lock to initialize.
+
+  @return McsLock in the released state.
+
+**/
+MCS_LOCK *
+EFIAPI
+InitializeMcsLock (
+  OUT MCS_LOCK  *McsLock
+  );
+
+/**
+  Queues a node on an MCS lock, and waits until all earlier nodes released it.
+
+  If McsLock or Node is NULL, then ASSERT().
+
+  @param  McsLock  A pointer to the MCS lock to acquire.
+  @param  Node     The node of the executing CPU, not queued on any lock.
+
+  @return McsLock in the acquired state.
+
+**/
+MCS_LOCK *
+EFIAPI
+AcquireMcsLock (
+  IN OUT MCS_LOCK       *McsLock,
+  IN OUT MCS_LOCK_NODE  *Node
+  );
+
+/**
+  Attempts to place an MCS lock in the acquired state, failing if it is held.
+
+  If McsLock or Node is NULL, then ASSERT().
+
+  @param  McsLock  A pointer to the MCS lock to acquire.
+  @param  Node     The node of the executing CPU, not queued on any lock.
+
+  @retval TRUE   McsLock was placed in the acquired state, and Node must be passed to
+                 ReleaseMcsLock().
+  @retval FALSE  McsLock could not be acquired.
+
+**/
+BOOLEAN
+EFIAPI
+AcquireMcsLockOrFail (
+  IN OUT MCS_LOCK       *McsLock,
+  IN OUT MCS_LOCK_NODE  *Node
+  );
+
+/**
+  Releases an MCS lock, granting it to the next queued node if any.
+
+  If McsLock or Node is NULL, then ASSERT().
+
+  @param  McsLock  A pointer to the MCS lock to release.
+  @param  Node     The node the lock was acquired with.
+
+  @return McsLock released.
+
+**/
+MCS_LOCK *
+EFIAPI
+ReleaseMcsLock (
+  IN OUT MCS_LOCK       *McsLock,
+  IN OUT MCS_LOCK_NODE  *Node
+  );
+
+/**
+  Attempts to place a spin lock in the acquired state, retrying with an exponential backoff.
+
+  Each attempt first reads the lock, and only tries to take it when it is released, so that
+  waiters do not steal its cache line from the holder.
+
+  If SpinLock is NULL, then ASSERT().
+
+  @param  SpinLock     A pointer to the spin lock to place in the acquired state.
+  @param  MaxAttempts  The number of attempts before giving up, 0 to wait indefinitely.
+
+  @retval TRUE   SpinLock was placed in the acquired state.
+  @retval FALSE  SpinLock could not be acquired in MaxAttempts attempts.
+
+**/
+BOOLEAN
+EFIAPI
+AcquireSpinLockOrTimeout (
+  IN OUT SPIN_LOCK  *SpinLock,
+  IN     UINTN      MaxAttempts
+  );
+
+#endif
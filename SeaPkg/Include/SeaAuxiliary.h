@@ -20,6 +20,12 @@
 #define IMAGE_VALIDATION_DATA_SIGNATURE   SIGNATURE_32 ('V', 'A', 'L', 'D')
 #define IMAGE_VALIDATION_ENTRY_SIGNATURE  SIGNATURE_32 ('E', 'N', 'T', 'R')
 
+//
+// Entries are sorted by Offset, do not overlap, and adjacent NONE entries have been
+// coalesced. Allows the image to be restored in a single sequential sweep.
+//
+#define IMAGE_VALIDATION_DATA_FLAG_SORTED  BIT0
+
 #pragma pack(1)
 
 typedef struct {
@@ -35,6 +41,7 @@ typedef struct {
   UINT32    OffsetToFirstDefault;
   UINT32    KeySymbolCount;
   UINT32    OffsetToFirstKeySymbol;
+  UINT32    Flags;              // IMAGE_VALIDATION_DATA_FLAG_*. Absent in auxiliary files with a 28 byte header.
 } IMAGE_VALIDATION_DATA_HEADER;
 
 typedef struct {
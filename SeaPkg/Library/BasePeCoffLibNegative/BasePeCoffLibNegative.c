@@ -104,42 +104,35 @@ PeCoffLoaderCopiedImageAddress (
   cache(s) in hardware, then the caller is responsible for performing cache maintenance operations
   prior to transferring control to a PE/COFF image that is loaded using this library.
 
+  The fixups are reverted from FixupIndex, built with PeCoffFixupIndexBuild() from the image at
+  DestinationAddress, in a single sweep. The fixup log is written in the order of the index.
+
   @param  ImageContext        The pointer to the image context structure that describes the PE/COFF
                               image that is being relocated.
+  @param  FixupIndex          The fixup index of the image at DestinationAddress.
 
   @retval RETURN_SUCCESS      The PE/COFF image was relocated.
                               Extended status information is in the ImageError field of ImageContext.
   @retval RETURN_LOAD_ERROR   The image in not a valid PE/COFF image.
                               Extended status information is in the ImageError field of ImageContext.
-  @retval RETURN_UNSUPPORTED  A relocation record type is not supported.
-                              Extended status information is in the ImageError field of ImageContext.
 
 **/
 RETURN_STATUS
 EFIAPI
 PeCoffLoaderRevertRelocateImage (
-  IN OUT PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext
+  IN OUT PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext,
+  IN     CONST PE_COFF_FIXUP_INDEX     *FixupIndex
   )
 {
-  RETURN_STATUS                        Status;
   EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
-  EFI_IMAGE_DATA_DIRECTORY             *RelocDir;
   UINT64                               Adjust;
-  EFI_IMAGE_BASE_RELOCATION            *RelocBaseOrg;
-  EFI_IMAGE_BASE_RELOCATION            *RelocBase;
-  EFI_IMAGE_BASE_RELOCATION            *RelocBaseEnd;
-  UINT16                               *Reloc;
-  UINT16                               *RelocEnd;
-  CHAR8                                *Fixup;
-  CHAR8                                *FixupBase;
-  UINT16                               *Fixup16;
-  UINT32                               *Fixup32;
-  UINT64                               *Fixup64;
+  UINTN                                Index;
+  PE_COFF_FIXUP                        Fixup;
+  CHAR8                                *Field;
   CHAR8                                *FixupData;
-  UINT32                               NumberOfRvaAndSizes;
-  UINT32                               TeStrippedOffset;
 
   ASSERT (ImageContext != NULL);
+  ASSERT (FixupIndex != NULL);
 
   //
   // Assume success
@@ -163,8 +156,7 @@ PeCoffLoaderRevertRelocateImage (
   }
 
   // Grab the PE32+ header from the copied image
-  Hdr.Pe32         = (EFI_IMAGE_NT_HEADERS32 *)((UINTN)ImageContext->DestinationAddress + ImageContext->PeCoffHeaderOffset);
-  TeStrippedOffset = 0;
+  Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)((UINTN)ImageContext->DestinationAddress + ImageContext->PeCoffHeaderOffset);
 
   //
   // Use PE32+ offset
@@ -175,153 +167,61 @@ PeCoffLoaderRevertRelocateImage (
     return RETURN_LOAD_ERROR;
   }
 
+  //
+  // The index was validated against its own SizeOfImage, which must fit in the copied image.
+  //
+  if (FixupIndex->SizeOfImage > ImageContext->ImageSize) {
+    ImageContext->ImageError = IMAGE_ERROR_FAILED_RELOCATION;
+    return RETURN_LOAD_ERROR;
+  }
+
   // Revert 1: Revert the image base to 0.
   Hdr.Pe32Plus->OptionalHeader.ImageBase = 0;
   Adjust                                 = (UINT64)ImageContext->ImageAddress;
 
-  NumberOfRvaAndSizes = Hdr.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
-  RelocDir            = &Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
-
   //
-  // Find the relocation block
-  // Per the PE/COFF spec, you can't assume that a given data directory
-  // is present in the image. You have to check the NumberOfRvaAndSizes in
-  // the optional header to verify a desired directory entry is there.
+  // Revert 2: Revert all fixups in one sweep over the index.
   //
-  if ((NumberOfRvaAndSizes < EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC)) {
-    RelocDir = NULL;
-  }
-
-  if ((RelocDir != NULL) && (RelocDir->Size > 0)) {
-    RelocBase    = (EFI_IMAGE_BASE_RELOCATION *)PeCoffLoaderCopiedImageAddress (ImageContext, RelocDir->VirtualAddress, TeStrippedOffset);
-    RelocBaseEnd = (EFI_IMAGE_BASE_RELOCATION *)PeCoffLoaderCopiedImageAddress (
-                                                  ImageContext,
-                                                  RelocDir->VirtualAddress + RelocDir->Size - 1,
-                                                  TeStrippedOffset
-                                                  );
-    if ((RelocBase == NULL) || (RelocBaseEnd == NULL) || ((UINTN)RelocBaseEnd < (UINTN)RelocBase)) {
-      ImageContext->ImageError = IMAGE_ERROR_FAILED_RELOCATION;
-      return RETURN_LOAD_ERROR;
-    }
-  } else {
-    //
-    // Set base and end to bypass processing below.
-    //
-    RelocBase = RelocBaseEnd = NULL;
-  }
-
-  RelocBaseOrg = RelocBase;
+  PeCoffFixupIndexApply (
+    FixupIndex,
+    0,
+    (VOID *)(UINTN)ImageContext->DestinationAddress,
+    0,
+    FixupIndex->SizeOfImage,
+    Adjust,
+    TRUE
+    );
 
   //
-  // Run the reverse relocation information and apply the fixup reversions
+  // Log the reverted fields, in the same layout as the loader does.
   //
   FixupData = ImageContext->FixupData;
-  while ((UINTN)RelocBase < (UINTN)RelocBaseEnd) {
-    Reloc = (UINT16 *)((CHAR8 *)RelocBase + sizeof (EFI_IMAGE_BASE_RELOCATION));
-    //
-    // Add check for RelocBase->SizeOfBlock field.
-    //
-    if (RelocBase->SizeOfBlock == 0) {
-      ImageContext->ImageError = IMAGE_ERROR_FAILED_RELOCATION;
-      return RETURN_LOAD_ERROR;
-    }
-
-    if ((UINTN)RelocBase > MAX_ADDRESS - RelocBase->SizeOfBlock) {
-      ImageContext->ImageError = IMAGE_ERROR_FAILED_RELOCATION;
-      return RETURN_LOAD_ERROR;
-    }
-
-    RelocEnd = (UINT16 *)((CHAR8 *)RelocBase + RelocBase->SizeOfBlock);
-    if ((UINTN)RelocEnd > (UINTN)RelocBaseOrg + RelocDir->Size) {
-      ImageContext->ImageError = IMAGE_ERROR_FAILED_RELOCATION;
-      return RETURN_LOAD_ERROR;
-    }
-
-    FixupBase = PeCoffLoaderCopiedImageAddress (ImageContext, RelocBase->VirtualAddress, TeStrippedOffset);
-    if (FixupBase == NULL) {
-      ImageContext->ImageError = IMAGE_ERROR_FAILED_RELOCATION;
-      return RETURN_LOAD_ERROR;
-    }
-
-    //
-    // Run this relocation record
-    //
-    while ((UINTN)Reloc < (UINTN)RelocEnd) {
-      Fixup = PeCoffLoaderCopiedImageAddress (ImageContext, RelocBase->VirtualAddress + (*Reloc & 0xFFF), TeStrippedOffset);
-      if (Fixup == NULL) {
-        ImageContext->ImageError = IMAGE_ERROR_FAILED_RELOCATION;
-        return RETURN_LOAD_ERROR;
-      }
-
-      switch ((*Reloc) >> 12) {
-        case EFI_IMAGE_REL_BASED_ABSOLUTE:
-          break;
-
-        case EFI_IMAGE_REL_BASED_HIGH:
-          Fixup16  = (UINT16 *)Fixup;
-          *Fixup16 = (UINT16)(*Fixup16 - ((UINT16)((UINT32)Adjust >> 16)));
-          if (FixupData != NULL) {
-            *(UINT16 *)FixupData = *Fixup16;
-            FixupData            = FixupData + sizeof (UINT16);
-          }
-
-          break;
-
-        case EFI_IMAGE_REL_BASED_LOW:
-          Fixup16  = (UINT16 *)Fixup;
-          *Fixup16 = (UINT16)(*Fixup16 - (UINT16)Adjust);
-          if (FixupData != NULL) {
-            *(UINT16 *)FixupData = *Fixup16;
-            FixupData            = FixupData + sizeof (UINT16);
-          }
-
-          break;
-
-        case EFI_IMAGE_REL_BASED_HIGHLOW:
-          Fixup32  = (UINT32 *)Fixup;
-          *Fixup32 = *Fixup32 - (UINT32)Adjust;
-          if (FixupData != NULL) {
-            FixupData            = ALIGN_POINTER (FixupData, sizeof (UINT32));
-            *(UINT32 *)FixupData = *Fixup32;
-            FixupData            = FixupData + sizeof (UINT32);
-          }
-
-          break;
-
-        case EFI_IMAGE_REL_BASED_DIR64:
-          Fixup64  = (UINT64 *)Fixup;
-          *Fixup64 = *Fixup64 - (UINT64)Adjust;
-          if (FixupData != NULL) {
-            FixupData              = ALIGN_POINTER (FixupData, sizeof (UINT64));
-            *(UINT64 *)(FixupData) = *Fixup64;
-            FixupData              = FixupData + sizeof (UINT64);
-          }
+  if (FixupData == NULL) {
+    return RETURN_SUCCESS;
+  }
 
-          break;
+  for (Index = 0; Index < FixupIndex->Count; Index++) {
+    Fixup = FixupIndex->Fixups[Index];
+    Field = (CHAR8 *)(UINTN)ImageContext->DestinationAddress + PE_COFF_FIXUP_RVA (Fixup);
+    switch (PE_COFF_FIXUP_TYPE (Fixup)) {
+      case EFI_IMAGE_REL_BASED_HIGH:
+      case EFI_IMAGE_REL_BASED_LOW:
+        *(UINT16 *)FixupData = ReadUnaligned16 ((UINT16 *)Field);
+        FixupData            = FixupData + sizeof (UINT16);
+        break;
 
-        default:
-          //
-          // The common code does not handle some of the stranger IPF relocations
-          // PeCoffLoaderRelocateImageEx () adds support for these complex fixups
-          // on IPF and is a No-Op on other architectures.
-          //
-          Status = RETURN_UNSUPPORTED;
-          if (RETURN_ERROR (Status)) {
-            ImageContext->ImageError = IMAGE_ERROR_FAILED_RELOCATION;
-            return Status;
-          }
-      }
+      case EFI_IMAGE_REL_BASED_HIGHLOW:
+        FixupData            = ALIGN_POINTER (FixupData, sizeof (UINT32));
+        *(UINT32 *)FixupData = ReadUnaligned32 ((UINT32 *)Field);
+        FixupData            = FixupData + sizeof (UINT32);
+        break;
 
-      //
-      // Next relocation record
-      //
-      Reloc += 1;
+      case EFI_IMAGE_REL_BASED_DIR64:
+        FixupData              = ALIGN_POINTER (FixupData, sizeof (UINT64));
+        *(UINT64 *)(FixupData) = ReadUnaligned64 ((UINT64 *)Field);
+        FixupData              = FixupData + sizeof (UINT64);
+        break;
     }
-
-    //
-    // Next reloc block
-    //
-    RelocBase = (EFI_IMAGE_BASE_RELOCATION *)RelocEnd;
   }
 
   ASSERT ((UINTN)FixupData <= (UINTN)ImageContext->FixupData + ImageContext->FixupDataSize);
@@ -785,6 +685,65 @@ Done:
   return Status;
 }
 
+/**
+  Determines if the auxiliary file entries may be processed in a single sequential sweep.
+
+  Auxiliary files generated before the Flags field was added have a 28 byte header, in
+  which case the first key symbol or entry starts where Flags would be.
+
+  @param[in] ImageValidationHdr  The pointer to the auxiliary file data buffer.
+
+  @retval TRUE   The header has Flags and the entries are sorted by offset.
+  @retval FALSE  The entries must be processed in file order.
+**/
+STATIC
+BOOLEAN
+IsImageValidationDataSorted (
+  IN CONST IMAGE_VALIDATION_DATA_HEADER  *ImageValidationHdr
+  )
+{
+  if ((ImageValidationHdr->Size < sizeof (IMAGE_VALIDATION_DATA_HEADER)) ||
+      (ImageValidationHdr->OffsetToFirstEntry < sizeof (IMAGE_VALIDATION_DATA_HEADER)))
+  {
+    return FALSE;
+  }
+
+  if ((ImageValidationHdr->KeySymbolCount != 0) &&
+      (ImageValidationHdr->OffsetToFirstKeySymbol < sizeof (IMAGE_VALIDATION_DATA_HEADER)))
+  {
+    return FALSE;
+  }
+
+  return (ImageValidationHdr->Flags & IMAGE_VALIDATION_DATA_FLAG_SORTED) != 0;
+}
+
+/**
+  Restores a run of the target image from its default value, or zeroes it if there is no
+  default value.
+
+  @param[in] Target  The start of the run in the target image.
+  @param[in] Source  The default value of the run, or NULL to zero the run.
+  @param[in] Size    The size of the run in bytes.
+**/
+STATIC
+VOID
+RestoreImageRun (
+  IN UINT8        *Target,
+  IN CONST UINT8  *Source OPTIONAL,
+  IN UINTN        Size
+  )
+{
+  if (Size == 0) {
+    return;
+  }
+
+  if (Source == NULL) {
+    ZeroMem (Target, Size);
+  } else {
+    CopyMem (Target, Source, Size);
+  }
+}
+
 /**
   Revert fixups and global data changes to an executed PE/COFF image that was loaded
   with PeCoffLoaderLoadImage() and relocated with PeCoffLoaderRelocateImage().
@@ -819,6 +778,13 @@ PeCoffImageDiffValidation (
   EFI_PHYSICAL_ADDRESS           MsegBase;
   UINTN                          MsegSize;
   IMAGE_VALIDATION_MEM_ATTR      MsegMemAttr;
+  BOOLEAN                        Sorted;
+  UINT32                         PreviousEnd;
+  UINT8                          *Target;
+  CONST UINT8                    *Source;
+  UINT8                          *RunTarget;
+  CONST UINT8                    *RunSource;
+  UINTN                          RunSize;
 
   if ((TargetImage == NULL) || (ImageValidationHdr == NULL)) {
     DEBUG ((DEBUG_ERROR, "%a: Invalid input pointers 0x%p and 0x%p\n", __func__, TargetImage, ImageValidationHdr));
@@ -860,18 +826,30 @@ PeCoffImageDiffValidation (
     return Status;
   }
 
+  //
+  // When the entries are sorted, contiguous restores are accumulated into a single run so the
+  // target image and the default values are both walked front to back exactly once.
+  //
+  Sorted      = IsImageValidationDataSorted (ImageValidationHdr);
+  PreviousEnd = 0;
+  RunTarget   = NULL;
+  RunSource   = NULL;
+  RunSize     = 0;
+
   ImageValidationEntryHdr  = (IMAGE_VALIDATION_ENTRY_HEADER *)((UINTN)ImageValidationHdr + ImageValidationHdr->OffsetToFirstEntry);
   OriginalImageLoadAddress = (EFI_PHYSICAL_ADDRESS)(UINTN)(UINT8 *)OriginalImageBaseAddress;
   for (Index = 0; Index < ImageValidationHdr->EntryCount; Index++) {
     // TODO: Safe integer arithmetic
     if ((UINT8 *)(ImageValidationEntryHdr) >= ((UINT8 *)ImageValidationHdr + ImageValidationHdr->Size)) {
       DEBUG ((DEBUG_ERROR, "%a: Current header 0x%p exceeds the reference data limit 0x%x\n", __func__, ImageValidationEntryHdr, (UINT8 *)ImageValidationHdr + ImageValidationHdr->Size));
-      return EFI_COMPROMISED_DATA;
+      Status = EFI_COMPROMISED_DATA;
+      break;
     }
 
     if (ImageValidationEntryHdr->Offset + ImageValidationEntryHdr->Size > TargetImageSize) {
       DEBUG ((DEBUG_ERROR, "%a: Current entry range 0x%x exceeds target image limit 0x%x\n", __func__, ImageValidationEntryHdr->Offset + ImageValidationEntryHdr->Size, TargetImageSize));
-      return EFI_INVALID_PARAMETER;
+      Status = EFI_INVALID_PARAMETER;
+      break;
     }
 
     // Ensure this entry's default value does not overflow the Auxiliary file buffer.
@@ -884,7 +862,18 @@ PeCoffImageDiffValidation (
         ImageValidationEntryHdr->OffsetToDefault + ImageValidationEntryHdr->Size,
         ImageValidationHdr->Size
         ));
-      return EFI_COMPROMISED_DATA;
+      Status = EFI_COMPROMISED_DATA;
+      break;
+    }
+
+    if (Sorted) {
+      if (ImageValidationEntryHdr->Offset < PreviousEnd) {
+        DEBUG ((DEBUG_ERROR, "%a: Current entry offset 0x%x overlaps the previous entry ending at 0x%x\n", __func__, ImageValidationEntryHdr->Offset, PreviousEnd));
+        Status = EFI_COMPROMISED_DATA;
+        break;
+      }
+
+      PreviousEnd = ImageValidationEntryHdr->Offset + ImageValidationEntryHdr->Size;
     }
 
     DEBUG ((
@@ -946,15 +935,36 @@ PeCoffImageDiffValidation (
     }
 
     // We should not do this when the above validation fails
-    if (ImageValidationEntryHdr->OffsetToDefault == MAX_UINT32) {
-      // If OffsetToDefault is MAX_UINT32, then zero the memory rather that copy
-      ZeroMem ((UINT8 *)TargetImage + ImageValidationEntryHdr->Offset, ImageValidationEntryHdr->Size);
+    // If OffsetToDefault is MAX_UINT32, then zero the memory rather that copy
+    Target = (UINT8 *)TargetImage + ImageValidationEntryHdr->Offset;
+    Source = NULL;
+    if (ImageValidationEntryHdr->OffsetToDefault != MAX_UINT32) {
+      Source = (CONST UINT8 *)ImageValidationHdr + ImageValidationEntryHdr->OffsetToDefault;
+    }
+
+    if (!Sorted) {
+      RestoreImageRun (Target, Source, ImageValidationEntryHdr->Size);
+    } else if ((RunSize != 0) &&
+               (Target == RunTarget + RunSize) &&
+               (((Source == NULL) && (RunSource == NULL)) ||
+                ((Source != NULL) && (RunSource != NULL) && (Source == RunSource + RunSize))))
+    {
+      RunSize += ImageValidationEntryHdr->Size;
     } else {
-      CopyMem ((UINT8 *)TargetImage + ImageValidationEntryHdr->Offset, (UINT8 *)ImageValidationHdr + ImageValidationEntryHdr->OffsetToDefault, ImageValidationEntryHdr->Size);
+      RestoreImageRun (RunTarget, RunSource, RunSize);
+      RunTarget = Target;
+      RunSource = Source;
+      RunSize   = ImageValidationEntryHdr->Size;
     }
 
     ImageValidationEntryHdr = NextImageValidationEntryHdr;
   }
 
+  //
+  // Restore whatever run is still pending, including the entries that passed validation
+  // before a failing or malformed one.
+  //
+  RestoreImageRun (RunTarget, RunSource, RunSize);
+
   return Status;
 }
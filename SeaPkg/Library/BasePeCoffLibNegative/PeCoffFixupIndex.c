@@ -0,0 +1,382 @@
+/** @file
+  Sorted index of the base relocations of a loaded PE/COFF image.
+
+  The base relocation directory is parsed and validated once, after which relocating an image,
+  reverting its relocations, or both, is a single forward sweep over a flat array, with no
+  header parsing and no per fixup bounds check.
+
+  Caution: This file requires additional review when modified.
+  This library will have external input - PE/COFF image.
+  This external input must be validated carefully to avoid security issue like
+  buffer overflow, integer overflow.
+
+  Building the index does not print, allocate or use global data, so that the STM can index its
+  own image before it is relocated.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Base.h>
+#include <SeaAuxiliary.h>
+#include <Library/BaseLib.h>
+#include <Library/PeCoffLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PeCoffLibNegative.h>
+#include <IndustryStandard/PeImage.h>
+
+/**
+  Get the width of the field patched by a base relocation.
+
+  @param  Type  The EFI_IMAGE_REL_BASED_* type of the base relocation.
+
+  @return The width in bytes of the patched field, 0 if Type is not supported.
+
+**/
+STATIC
+UINT32
+PeCoffFixupWidth (
+  IN UINT32  Type
+  )
+{
+  switch (Type) {
+    case EFI_IMAGE_REL_BASED_HIGH:
+    case EFI_IMAGE_REL_BASED_LOW:
+      return sizeof (UINT16);
+
+    case EFI_IMAGE_REL_BASED_HIGHLOW:
+      return sizeof (UINT32);
+
+    case EFI_IMAGE_REL_BASED_DIR64:
+      return sizeof (UINT64);
+
+    default:
+      return 0;
+  }
+}
+
+/**
+  Compare two fixups by RVA, then by type.
+
+  @param  Buffer1  The pointer to the first PE_COFF_FIXUP.
+  @param  Buffer2  The pointer to the second PE_COFF_FIXUP.
+
+  @retval <0  Buffer1 sorts before Buffer2.
+  @retval 0   Buffer1 and Buffer2 are identical.
+  @retval >0  Buffer1 sorts after Buffer2.
+
+**/
+STATIC
+INTN
+EFIAPI
+PeCoffFixupCompare (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  PE_COFF_FIXUP  Fixup1;
+  PE_COFF_FIXUP  Fixup2;
+
+  Fixup1 = *(CONST PE_COFF_FIXUP *)Buffer1;
+  Fixup2 = *(CONST PE_COFF_FIXUP *)Buffer2;
+
+  return (Fixup1 < Fixup2) ? -1 : (Fixup1 > Fixup2) ? 1 : 0;
+}
+
+/**
+  Build the sorted fixup index of a PE/COFF image loaded in memory.
+
+  The image is read at its section alignment, as it is after being loaded, and only its
+  headers and base relocation directory are read.
+
+  @param  Image       The pointer to the loaded PE32 or PE32+ image.
+  @param  ImageSize   The size of the buffer holding the image.
+  @param  Fixups      The buffer receiving the fixups, may be NULL if FixupCount is 0.
+  @param  FixupCount  On input, the number of fixups Fixups can hold. On output, the number of
+                      fixups of the image.
+  @param  Index       The index describing the fixups stored in Fixups.
+
+  @retval RETURN_SUCCESS           Index describes the fixups of the image.
+  @retval RETURN_BUFFER_TOO_SMALL  Fixups is too small to hold FixupCount fixups.
+  @retval RETURN_INVALID_PARAMETER Image, FixupCount or Index is NULL.
+  @retval RETURN_LOAD_ERROR        The headers or the base relocation directory are malformed.
+  @retval RETURN_UNSUPPORTED       A base relocation type is not supported, or the image is
+                                   larger than PE_COFF_FIXUP_MAX_RVA.
+
+**/
+RETURN_STATUS
+EFIAPI
+PeCoffFixupIndexBuild (
+  IN     CONST VOID           *Image,
+  IN     UINTN                ImageSize,
+  OUT    PE_COFF_FIXUP        *Fixups OPTIONAL,
+  IN OUT UINTN                *FixupCount,
+  OUT    PE_COFF_FIXUP_INDEX  *Index
+  )
+{
+  CONST EFI_IMAGE_DOS_HEADER             *DosHdr;
+  CONST EFI_IMAGE_OPTIONAL_HEADER_UNION  *Hdr;
+  CONST EFI_IMAGE_DATA_DIRECTORY         *DataDirectory;
+  UINTN                                  PeOffset;
+  UINTN                                  HeaderEnd;
+  UINT32                                 NumberOfRvaAndSizes;
+  UINT32                                 SizeOfImage;
+  UINT32                                 RelocOffset;
+  UINT32                                 RelocEnd;
+  CONST EFI_IMAGE_BASE_RELOCATION        *RelocBase;
+  CONST UINT16                           *Reloc;
+  UINT32                                 RelocIndex;
+  UINT32                                 RelocCount;
+  UINT32                                 Type;
+  UINT32                                 Width;
+  UINT32                                 Rva;
+  UINTN                                  Capacity;
+  UINTN                                  Count;
+  BOOLEAN                                Sorted;
+  PE_COFF_FIXUP                          Fixup;
+  PE_COFF_FIXUP                          Swap;
+
+  if ((Image == NULL) || (FixupCount == NULL) || (Index == NULL)) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  Capacity = (Fixups == NULL) ? 0 : *FixupCount;
+
+  //
+  // Locate the PE header, behind an optional DOS header.
+  //
+  PeOffset = 0;
+  if (ImageSize < sizeof (EFI_IMAGE_DOS_HEADER)) {
+    return RETURN_LOAD_ERROR;
+  }
+
+  DosHdr = (CONST EFI_IMAGE_DOS_HEADER *)Image;
+  if (DosHdr->e_magic == EFI_IMAGE_DOS_SIGNATURE) {
+    PeOffset = DosHdr->e_lfanew;
+  }
+
+  if (PeOffset > ImageSize - OFFSET_OF (EFI_IMAGE_NT_HEADERS32, OptionalHeader.MajorLinkerVersion)) {
+    return RETURN_LOAD_ERROR;
+  }
+
+  Hdr = (CONST EFI_IMAGE_OPTIONAL_HEADER_UNION *)((UINTN)Image + PeOffset);
+  if (Hdr->Pe32.Signature != EFI_IMAGE_NT_SIGNATURE) {
+    return RETURN_LOAD_ERROR;
+  }
+
+  if (Hdr->Pe32.OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    HeaderEnd = PeOffset + OFFSET_OF (EFI_IMAGE_NT_HEADERS32, OptionalHeader.DataDirectory);
+    if (HeaderEnd > ImageSize) {
+      return RETURN_LOAD_ERROR;
+    }
+
+    NumberOfRvaAndSizes = Hdr->Pe32.OptionalHeader.NumberOfRvaAndSizes;
+    SizeOfImage         = Hdr->Pe32.OptionalHeader.SizeOfImage;
+    DataDirectory       = Hdr->Pe32.OptionalHeader.DataDirectory;
+  } else if (Hdr->Pe32Plus.OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+    HeaderEnd = PeOffset + OFFSET_OF (EFI_IMAGE_NT_HEADERS64, OptionalHeader.DataDirectory);
+    if (HeaderEnd > ImageSize) {
+      return RETURN_LOAD_ERROR;
+    }
+
+    NumberOfRvaAndSizes = Hdr->Pe32Plus.OptionalHeader.NumberOfRvaAndSizes;
+    SizeOfImage         = Hdr->Pe32Plus.OptionalHeader.SizeOfImage;
+    DataDirectory       = Hdr->Pe32Plus.OptionalHeader.DataDirectory;
+  } else {
+    return RETURN_LOAD_ERROR;
+  }
+
+  if (SizeOfImage > ImageSize) {
+    return RETURN_LOAD_ERROR;
+  }
+
+  if (SizeOfImage > PE_COFF_FIXUP_MAX_RVA) {
+    return RETURN_UNSUPPORTED;
+  }
+
+  Index->Fixups      = Fixups;
+  Index->Count       = 0;
+  Index->SizeOfImage = SizeOfImage;
+
+  //
+  // Per the PE/COFF spec, you can't assume that a given data directory is present in the
+  // image. An image without base relocations has an empty index.
+  //
+  if (NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC) {
+    *FixupCount = 0;
+    return RETURN_SUCCESS;
+  }
+
+  if (HeaderEnd + (EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC + 1) * sizeof (EFI_IMAGE_DATA_DIRECTORY) > ImageSize) {
+    return RETURN_LOAD_ERROR;
+  }
+
+  RelocOffset = DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress;
+  RelocEnd    = RelocOffset + DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC].Size;
+  if ((RelocOffset > SizeOfImage) || (RelocEnd < RelocOffset) || (RelocEnd > SizeOfImage)) {
+    return RETURN_LOAD_ERROR;
+  }
+
+  //
+  // Collect the fixups of all blocks, dropping the padding entries, and validate them all
+  // even if Fixups is too small, so that a second call cannot fail for another reason.
+  //
+  Count  = 0;
+  Sorted = TRUE;
+  Fixup  = 0;
+  while (RelocOffset < RelocEnd) {
+    if (RelocEnd - RelocOffset < sizeof (EFI_IMAGE_BASE_RELOCATION)) {
+      return RETURN_LOAD_ERROR;
+    }
+
+    RelocBase = (CONST EFI_IMAGE_BASE_RELOCATION *)((UINTN)Image + RelocOffset);
+    if ((RelocBase->SizeOfBlock < sizeof (EFI_IMAGE_BASE_RELOCATION)) ||
+        (RelocBase->SizeOfBlock > RelocEnd - RelocOffset) ||
+        (RelocBase->VirtualAddress >= SizeOfImage))
+    {
+      return RETURN_LOAD_ERROR;
+    }
+
+    Reloc      = (CONST UINT16 *)(RelocBase + 1);
+    RelocCount = (RelocBase->SizeOfBlock - sizeof (EFI_IMAGE_BASE_RELOCATION)) / sizeof (UINT16);
+    for (RelocIndex = 0; RelocIndex < RelocCount; RelocIndex++) {
+      Type = Reloc[RelocIndex] >> 12;
+      if (Type == EFI_IMAGE_REL_BASED_ABSOLUTE) {
+        continue;
+      }
+
+      Width = PeCoffFixupWidth (Type);
+      if (Width == 0) {
+        return RETURN_UNSUPPORTED;
+      }
+
+      //
+      // VirtualAddress is below SizeOfImage, itself below 2^28, so this cannot overflow.
+      //
+      Rva = RelocBase->VirtualAddress + (Reloc[RelocIndex] & 0xFFF);
+      if (Rva + Width > SizeOfImage) {
+        return RETURN_LOAD_ERROR;
+      }
+
+      Sorted = (BOOLEAN)(Sorted && (PE_COFF_FIXUP_MAKE (Rva, Type) >= Fixup));
+      Fixup  = PE_COFF_FIXUP_MAKE (Rva, Type);
+      if (Count < Capacity) {
+        Fixups[Count] = Fixup;
+      }
+
+      Count++;
+    }
+
+    RelocOffset += RelocBase->SizeOfBlock;
+  }
+
+  *FixupCount = Count;
+  if (Count > Capacity) {
+    return RETURN_BUFFER_TOO_SMALL;
+  }
+
+  //
+  // Linkers emit the blocks in page order, so the fixups usually are sorted already.
+  //
+  if (!Sorted) {
+    QuickSort (Fixups, Count, sizeof (PE_COFF_FIXUP), PeCoffFixupCompare, &Swap);
+  }
+
+  Index->Count = Count;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Apply or revert the fixups of an index to a window of a loaded PE/COFF image.
+
+  The fixups are applied in index order from Cursor on, up to the first one that does not fit
+  entirely below End. Relocating or reverting a whole image is a single call with Cursor 0,
+  Start 0 and End set to the SizeOfImage of the index. A caller streaming the image through a
+  smaller buffer calls again with the returned cursor, keeping the bytes from the RVA of that
+  fixup on in the next window.
+
+  If Index or Image is NULL, then ASSERT().
+  If Start is larger than End, or End is larger than the SizeOfImage of the index, then ASSERT().
+  If the fixup at Cursor starts below Start, then ASSERT().
+
+  @param  Index   The fixup index of the image.
+  @param  Cursor  The position in the index of the first fixup to apply.
+  @param  Image   The pointer to the byte at RVA Start of the image.
+  @param  Start   The RVA of the first byte of the window.
+  @param  End     The RVA following the last byte of the window.
+  @param  Adjust  The difference between the new and the old base address of the image.
+  @param  Revert  TRUE to undo a relocation by Adjust, FALSE to apply it.
+
+  @return The position in the index of the first fixup not applied, Count when all of them are.
+
+**/
+UINTN
+EFIAPI
+PeCoffFixupIndexApply (
+  IN     CONST PE_COFF_FIXUP_INDEX  *Index,
+  IN     UINTN                      Cursor,
+  IN OUT VOID                       *Image,
+  IN     UINTN                      Start,
+  IN     UINTN                      End,
+  IN     UINT64                     Adjust,
+  IN     BOOLEAN                    Revert
+  )
+{
+  PE_COFF_FIXUP  Fixup;
+  UINTN          Rva;
+  UINT8          *Field;
+  UINT64         Delta64;
+  UINT16         DeltaHigh;
+
+  ASSERT (Index != NULL);
+  ASSERT (Image != NULL);
+  ASSERT (Start <= End);
+  ASSERT (End <= Index->SizeOfImage);
+  ASSERT (Cursor >= Index->Count || PE_COFF_FIXUP_RVA (Index->Fixups[Cursor]) >= Start);
+
+  //
+  // The high half of the adjustment carries from the low half, so it is negated on its own.
+  //
+  Delta64   = Revert ? 0 - Adjust : Adjust;
+  DeltaHigh = (UINT16)((UINT32)Adjust >> 16);
+  DeltaHigh = Revert ? (UINT16)(0 - DeltaHigh) : DeltaHigh;
+
+  for ( ; Cursor < Index->Count; Cursor++) {
+    Fixup = Index->Fixups[Cursor];
+    Rva   = PE_COFF_FIXUP_RVA (Fixup);
+    if (Rva + PeCoffFixupWidth (PE_COFF_FIXUP_TYPE (Fixup)) > End) {
+      break;
+    }
+
+    Field = (UINT8 *)Image + (Rva - Start);
+
+    switch (PE_COFF_FIXUP_TYPE (Fixup)) {
+      case EFI_IMAGE_REL_BASED_HIGH:
+        WriteUnaligned16 ((UINT16 *)Field, (UINT16)(ReadUnaligned16 ((UINT16 *)Field) + DeltaHigh));
+        break;
+
+      case EFI_IMAGE_REL_BASED_LOW:
+        WriteUnaligned16 ((UINT16 *)Field, (UINT16)(ReadUnaligned16 ((UINT16 *)Field) + (UINT16)Delta64));
+        break;
+
+      case EFI_IMAGE_REL_BASED_HIGHLOW:
+        WriteUnaligned32 ((UINT32 *)Field, ReadUnaligned32 ((UINT32 *)Field) + (UINT32)Delta64);
+        break;
+
+      case EFI_IMAGE_REL_BASED_DIR64:
+        WriteUnaligned64 ((UINT64 *)Field, ReadUnaligned64 ((UINT64 *)Field) + Delta64);
+        break;
+
+      default:
+        //
+        // PeCoffFixupIndexBuild() only indexes the types above.
+        //
+        ASSERT (FALSE);
+        break;
+    }
+  }
+
+  return Cursor;
+}
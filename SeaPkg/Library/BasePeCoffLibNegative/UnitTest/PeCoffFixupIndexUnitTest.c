@@ -0,0 +1,759 @@
+/** @file
+  Unit tests of the PE/COFF fixup index of BasePeCoffLibNegative.
+
+  Sample PE32 and PE32+ images are synthesized with every supported base relocation type, in
+  sorted and unsorted directories, including fields straddling pages. Relocating them through
+  the index must match a plain walk of the relocation blocks, reverting them must restore the
+  original image, and streaming the reversion through a page sized window must match reverting
+  the whole image.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <SeaAuxiliary.h>
+#include <IndustryStandard/PeImage.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PeCoffLib.h>
+#include <Library/PeCoffLibNegative.h>
+
+#include <Library/UnitTestLib.h>
+#include <UnitTest/UnitTestRandom.h>
+
+#define UNIT_TEST_APP_NAME     "BasePeCoffLibNegative Fixup Index Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Layout of the sample images: headers in the first page, relocated data in the next ones,
+// a page of plain data that the last fixup straddles into, and the base relocation directory
+// in the last page.
+//
+#define TEST_PAGE_SIZE         0x1000
+#define TEST_IMAGE_PAGES       8
+#define TEST_IMAGE_SIZE        (TEST_IMAGE_PAGES * TEST_PAGE_SIZE)
+#define TEST_PE_OFFSET         0x80
+#define TEST_FIRST_DATA_PAGE   1
+#define TEST_LAST_DATA_PAGE    (TEST_IMAGE_PAGES - 3)
+#define TEST_RELOC_RVA         ((TEST_IMAGE_PAGES - 1) * TEST_PAGE_SIZE)
+#define TEST_FIXUPS_PER_PAGE   95
+#define TEST_RANDOM_RUNS       16
+
+//
+// Each fixup owns an 8 byte slot, starting 4 bytes into the page so that the last one
+// straddles into the next page and 64-bit fields are unaligned.
+//
+#define TEST_SLOT_SIZE         8
+#define TEST_SLOT_OFFSET       4
+#define TEST_SLOTS_PER_PAGE    (TEST_PAGE_SIZE / TEST_SLOT_SIZE)
+
+typedef struct {
+  CONST CHAR8    *Name;
+  BOOLEAN        Pe32Plus;
+  BOOLEAN        Unsorted;
+  BOOLEAN        WithoutRelocations;
+} TEST_IMAGE_SHAPE;
+
+STATIC TEST_IMAGE_SHAPE  mPe32PlusImage         = { "PE32+", TRUE, FALSE, FALSE };
+STATIC TEST_IMAGE_SHAPE  mPe32PlusUnsortedImage = { "unsorted PE32+", TRUE, TRUE, FALSE };
+STATIC TEST_IMAGE_SHAPE  mPe32Image             = { "PE32", FALSE, FALSE, FALSE };
+STATIC TEST_IMAGE_SHAPE  mPe32UnsortedImage     = { "unsorted PE32", FALSE, TRUE, FALSE };
+STATIC TEST_IMAGE_SHAPE  mNoRelocationImage     = { "PE32+ without relocations", TRUE, FALSE, TRUE };
+
+/**
+  Pick the type of a random fixup of an image.
+
+  @param  Pe32Plus  TRUE for a PE32+ image.
+
+  @return An EFI_IMAGE_REL_BASED_* type.
+
+**/
+STATIC
+UINT16
+RandomFixupType (
+  IN BOOLEAN  Pe32Plus
+  )
+{
+  UINT64  Pick;
+
+  Pick = NextRandom () % 8;
+  if (Pick == 0) {
+    return EFI_IMAGE_REL_BASED_HIGH;
+  } else if (Pick == 1) {
+    return EFI_IMAGE_REL_BASED_LOW;
+  } else if (!Pe32Plus || (Pick < 4)) {
+    return EFI_IMAGE_REL_BASED_HIGHLOW;
+  }
+
+  return EFI_IMAGE_REL_BASED_DIR64;
+}
+
+/**
+  Synthesize a sample image with random data and fixups.
+
+  Fixups never overlap. Each data page gets one block, padded with an absolute entry to a
+  multiple of 4 bytes; an unsorted image has its blocks and entries in reverse order.
+
+  @param  Shape     The kind of image to build.
+  @param  Image     The TEST_IMAGE_SIZE bytes buffer receiving the image.
+  @param  Expected  Receives the fixups of the image in block order.
+
+  @return The number of fixups of the image, not counting absolute entries.
+
+**/
+STATIC
+UINTN
+BuildTestImage (
+  IN  CONST TEST_IMAGE_SHAPE  *Shape,
+  OUT UINT8                   *Image,
+  OUT PE_COFF_FIXUP           *Expected
+  )
+{
+  EFI_IMAGE_DOS_HEADER       *DosHdr;
+  EFI_IMAGE_NT_HEADERS32     *Pe32;
+  EFI_IMAGE_NT_HEADERS64     *Pe32Plus;
+  EFI_IMAGE_DATA_DIRECTORY   *RelocDir;
+  EFI_IMAGE_BASE_RELOCATION  *Block;
+  UINT16                     *Entries;
+  UINT16                     Slots[TEST_SLOTS_PER_PAGE];
+  UINT16                     Type;
+  UINTN                      Page;
+  UINTN                      PageIndex;
+  UINTN                      Entry;
+  UINTN                      EntryCount;
+  UINTN                      Swap;
+  UINTN                      Count;
+  UINT16                     Temp;
+  UINT32                     RelocOffset;
+  UINT64                     *Random;
+
+  for (Random = (UINT64 *)Image; Random < (UINT64 *)(Image + TEST_IMAGE_SIZE); Random++) {
+    *Random = NextRandom ();
+  }
+
+  ZeroMem (Image, TEST_PAGE_SIZE);
+  ZeroMem (Image + TEST_RELOC_RVA, TEST_PAGE_SIZE);
+
+  DosHdr           = (EFI_IMAGE_DOS_HEADER *)Image;
+  DosHdr->e_magic  = EFI_IMAGE_DOS_SIGNATURE;
+  DosHdr->e_lfanew = TEST_PE_OFFSET;
+
+  if (Shape->Pe32Plus) {
+    Pe32Plus                                   = (EFI_IMAGE_NT_HEADERS64 *)(Image + TEST_PE_OFFSET);
+    Pe32Plus->Signature                        = EFI_IMAGE_NT_SIGNATURE;
+    Pe32Plus->FileHeader.Machine               = IMAGE_FILE_MACHINE_X64;
+    Pe32Plus->FileHeader.SizeOfOptionalHeader  = sizeof (EFI_IMAGE_OPTIONAL_HEADER64);
+    Pe32Plus->OptionalHeader.Magic             = EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+    Pe32Plus->OptionalHeader.SectionAlignment  = TEST_PAGE_SIZE;
+    Pe32Plus->OptionalHeader.SizeOfImage       = TEST_IMAGE_SIZE;
+    Pe32Plus->OptionalHeader.SizeOfHeaders     = TEST_PAGE_SIZE;
+    Pe32Plus->OptionalHeader.NumberOfRvaAndSizes = EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES;
+    RelocDir                                   = &Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+  } else {
+    Pe32                                   = (EFI_IMAGE_NT_HEADERS32 *)(Image + TEST_PE_OFFSET);
+    Pe32->Signature                        = EFI_IMAGE_NT_SIGNATURE;
+    Pe32->FileHeader.Machine               = IMAGE_FILE_MACHINE_I386;
+    Pe32->FileHeader.SizeOfOptionalHeader  = sizeof (EFI_IMAGE_OPTIONAL_HEADER32);
+    Pe32->OptionalHeader.Magic             = EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC;
+    Pe32->OptionalHeader.SectionAlignment  = TEST_PAGE_SIZE;
+    Pe32->OptionalHeader.SizeOfImage       = TEST_IMAGE_SIZE;
+    Pe32->OptionalHeader.SizeOfHeaders     = TEST_PAGE_SIZE;
+    Pe32->OptionalHeader.NumberOfRvaAndSizes = EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES;
+    RelocDir                               = &Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+  }
+
+  if (Shape->WithoutRelocations) {
+    return 0;
+  }
+
+  Count       = 0;
+  RelocOffset = TEST_RELOC_RVA;
+  for (PageIndex = TEST_FIRST_DATA_PAGE; PageIndex <= TEST_LAST_DATA_PAGE; PageIndex++) {
+    Page = Shape->Unsorted ? TEST_LAST_DATA_PAGE + TEST_FIRST_DATA_PAGE - PageIndex : PageIndex;
+
+    //
+    // Pick distinct slots, always including the one straddling into the next page.
+    //
+    for (Entry = 0; Entry < TEST_SLOTS_PER_PAGE; Entry++) {
+      Slots[Entry] = (UINT16)Entry;
+    }
+
+    for (Entry = 1; Entry < TEST_FIXUPS_PER_PAGE; Entry++) {
+      Swap                              = Entry + (UINTN)(NextRandom () % (TEST_SLOTS_PER_PAGE - 1 - Entry));
+      Temp                              = Slots[Entry];
+      Slots[Entry]                      = Slots[Swap];
+      Slots[Swap]                       = Temp;
+    }
+
+    Slots[0] = TEST_SLOTS_PER_PAGE - 1;
+
+    //
+    // Emit the slots in increasing or decreasing order.
+    //
+    for (Entry = 1; Entry < TEST_FIXUPS_PER_PAGE; Entry++) {
+      for (Swap = Entry; (Swap > 0) && ((Slots[Swap - 1] > Slots[Swap]) != Shape->Unsorted); Swap--) {
+        Temp            = Slots[Swap - 1];
+        Slots[Swap - 1] = Slots[Swap];
+        Slots[Swap]     = Temp;
+      }
+    }
+
+    EntryCount            = TEST_FIXUPS_PER_PAGE + (TEST_FIXUPS_PER_PAGE % 2);
+    Block                 = (EFI_IMAGE_BASE_RELOCATION *)(Image + RelocOffset);
+    Block->VirtualAddress = (UINT32)(Page * TEST_PAGE_SIZE);
+    Block->SizeOfBlock    = (UINT32)(sizeof (EFI_IMAGE_BASE_RELOCATION) + EntryCount * sizeof (UINT16));
+    Entries               = (UINT16 *)(Block + 1);
+    for (Entry = 0; Entry < TEST_FIXUPS_PER_PAGE; Entry++) {
+      Type             = RandomFixupType (Shape->Pe32Plus);
+      Entries[Entry]   = (UINT16)((Type << 12) | (Slots[Entry] * TEST_SLOT_SIZE + TEST_SLOT_OFFSET));
+      Expected[Count++] = PE_COFF_FIXUP_MAKE (Block->VirtualAddress + (Entries[Entry] & 0xFFF), Type);
+    }
+
+    for ( ; Entry < EntryCount; Entry++) {
+      Entries[Entry] = EFI_IMAGE_REL_BASED_ABSOLUTE << 12;
+    }
+
+    RelocOffset += Block->SizeOfBlock;
+  }
+
+  RelocDir->VirtualAddress = TEST_RELOC_RVA;
+  RelocDir->Size           = RelocOffset - TEST_RELOC_RVA;
+  return Count;
+}
+
+/**
+  Relocate an image by walking its relocation blocks, the way images were relocated before
+  the fixup index.
+
+  @param  Image   The image to relocate.
+  @param  Adjust  The difference between the new and the old base address of the image.
+
+**/
+STATIC
+VOID
+RelocateByBlockWalk (
+  IN OUT UINT8   *Image,
+  IN     UINT64  Adjust
+  )
+{
+  EFI_IMAGE_NT_HEADERS32     *Pe32;
+  EFI_IMAGE_DATA_DIRECTORY   *RelocDir;
+  EFI_IMAGE_BASE_RELOCATION  *RelocBase;
+  EFI_IMAGE_BASE_RELOCATION  *RelocBaseEnd;
+  UINT16                     *Reloc;
+  UINT16                     *RelocEnd;
+  UINT8                      *Fixup;
+
+  Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(Image + ((EFI_IMAGE_DOS_HEADER *)Image)->e_lfanew);
+  if (Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    RelocDir = &Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+  } else {
+    RelocDir = &((EFI_IMAGE_NT_HEADERS64 *)Pe32)->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+  }
+
+  RelocBase    = (EFI_IMAGE_BASE_RELOCATION *)(Image + RelocDir->VirtualAddress);
+  RelocBaseEnd = (EFI_IMAGE_BASE_RELOCATION *)(Image + RelocDir->VirtualAddress + RelocDir->Size);
+  while (RelocBase < RelocBaseEnd) {
+    Reloc    = (UINT16 *)(RelocBase + 1);
+    RelocEnd = (UINT16 *)((UINT8 *)RelocBase + RelocBase->SizeOfBlock);
+    for ( ; Reloc < RelocEnd; Reloc++) {
+      Fixup = Image + RelocBase->VirtualAddress + (*Reloc & 0xFFF);
+      switch (*Reloc >> 12) {
+        case EFI_IMAGE_REL_BASED_HIGH:
+          WriteUnaligned16 ((UINT16 *)Fixup, (UINT16)(ReadUnaligned16 ((UINT16 *)Fixup) + (UINT16)((UINT32)Adjust >> 16)));
+          break;
+
+        case EFI_IMAGE_REL_BASED_LOW:
+          WriteUnaligned16 ((UINT16 *)Fixup, (UINT16)(ReadUnaligned16 ((UINT16 *)Fixup) + (UINT16)Adjust));
+          break;
+
+        case EFI_IMAGE_REL_BASED_HIGHLOW:
+          WriteUnaligned32 ((UINT32 *)Fixup, ReadUnaligned32 ((UINT32 *)Fixup) + (UINT32)Adjust);
+          break;
+
+        case EFI_IMAGE_REL_BASED_DIR64:
+          WriteUnaligned64 ((UINT64 *)Fixup, ReadUnaligned64 ((UINT64 *)Fixup) + Adjust);
+          break;
+      }
+    }
+
+    RelocBase = (EFI_IMAGE_BASE_RELOCATION *)RelocEnd;
+  }
+}
+
+/**
+  Pick a random relocation adjustment, with a low half large enough to carry into the high
+  half of HIGH fixups.
+
+  @return A page aligned adjustment.
+
+**/
+STATIC
+UINT64
+RandomAdjust (
+  VOID
+  )
+{
+  return (NextRandom () | 0x8000) & ~(UINT64)(TEST_PAGE_SIZE - 1);
+}
+
+/**
+  The index of an image should hold every fixup of its directory, sorted.
+
+  @param[in]  Context  The TEST_IMAGE_SHAPE to build.
+
+  @retval UNIT_TEST_PASSED             The index matched the directory.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The index did not match.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexMatchesDirectory (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                *Image;
+  PE_COFF_FIXUP        *Expected;
+  PE_COFF_FIXUP        *Fixups;
+  PE_COFF_FIXUP        Temp;
+  PE_COFF_FIXUP_INDEX  Index;
+  UINTN                ExpectedCount;
+  UINTN                FixupCount;
+  UINTN                Entry;
+  UINTN                Swap;
+  RETURN_STATUS        Status;
+
+  mRandomState = 0x243F6A8885A308D3ull;
+  Image        = AllocatePool (TEST_IMAGE_SIZE);
+  Expected     = AllocatePool (TEST_IMAGE_PAGES * TEST_FIXUPS_PER_PAGE * sizeof (PE_COFF_FIXUP));
+  UT_ASSERT_NOT_NULL (Image);
+  UT_ASSERT_NOT_NULL (Expected);
+
+  ExpectedCount = BuildTestImage ((TEST_IMAGE_SHAPE *)Context, Image, Expected);
+
+  //
+  // Without a buffer, the build only reports the number of fixups.
+  //
+  FixupCount = 0;
+  Status     = PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, NULL, &FixupCount, &Index);
+  if (ExpectedCount == 0) {
+    UT_ASSERT_STATUS_EQUAL (Status, RETURN_SUCCESS);
+  } else {
+    UT_ASSERT_STATUS_EQUAL (Status, RETURN_BUFFER_TOO_SMALL);
+  }
+
+  UT_ASSERT_EQUAL (FixupCount, ExpectedCount);
+
+  Fixups = AllocatePool ((FixupCount + 1) * sizeof (PE_COFF_FIXUP));
+  UT_ASSERT_NOT_NULL (Fixups);
+  Status = PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Index.Count, ExpectedCount);
+  UT_ASSERT_EQUAL (Index.SizeOfImage, TEST_IMAGE_SIZE);
+  UT_ASSERT_TRUE (Index.Fixups == Fixups);
+
+  for (Entry = 1; Entry < ExpectedCount; Entry++) {
+    for (Swap = Entry; (Swap > 0) && (Expected[Swap - 1] > Expected[Swap]); Swap--) {
+      Temp               = Expected[Swap - 1];
+      Expected[Swap - 1] = Expected[Swap];
+      Expected[Swap]     = Temp;
+    }
+  }
+
+  UT_ASSERT_MEM_EQUAL (Index.Fixups, Expected, ExpectedCount * sizeof (PE_COFF_FIXUP));
+
+  FreePool (Fixups);
+  FreePool (Expected);
+  FreePool (Image);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Build the index of a freshly synthesized sample image.
+
+  @param  Shape   The kind of image to build.
+  @param  Image   Receives the TEST_IMAGE_SIZE bytes image, to be freed with FreePool().
+  @param  Index   Receives the index of the image, whose fixups are to be freed with FreePool().
+
+  @retval TRUE   The image and its index were built.
+  @retval FALSE  Out of memory, or the index could not be built.
+
+**/
+STATIC
+BOOLEAN
+BuildIndexedTestImage (
+  IN  CONST TEST_IMAGE_SHAPE  *Shape,
+  OUT UINT8                   **Image,
+  OUT PE_COFF_FIXUP_INDEX     *Index
+  )
+{
+  PE_COFF_FIXUP  *Fixups;
+  UINTN          FixupCount;
+
+  *Image = AllocatePool (TEST_IMAGE_SIZE);
+  Fixups = AllocatePool (TEST_IMAGE_PAGES * TEST_FIXUPS_PER_PAGE * sizeof (PE_COFF_FIXUP));
+  if ((*Image == NULL) || (Fixups == NULL)) {
+    return FALSE;
+  }
+
+  BuildTestImage (Shape, *Image, Fixups);
+
+  FixupCount = TEST_IMAGE_PAGES * TEST_FIXUPS_PER_PAGE;
+  return (BOOLEAN)!RETURN_ERROR (PeCoffFixupIndexBuild (*Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, Index));
+}
+
+/**
+  Relocating through the index should match walking the relocation blocks, and reverting the
+  relocation should restore the original image.
+
+  @param[in]  Context  The TEST_IMAGE_SHAPE to build.
+
+  @retval UNIT_TEST_PASSED             Every relocation matched, and reverted to the original.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A relocation or reversion differed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RoundTrip (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                *Image;
+  UINT8                *Relocated;
+  UINT8                *Walked;
+  PE_COFF_FIXUP_INDEX  Index;
+  UINTN                Run;
+  UINTN                Cursor;
+  UINT64               Adjust;
+
+  mRandomState = 0x13198A2E03707344ull;
+  UT_ASSERT_TRUE (BuildIndexedTestImage ((TEST_IMAGE_SHAPE *)Context, &Image, &Index));
+
+  Relocated = AllocatePool (TEST_IMAGE_SIZE);
+  Walked    = AllocatePool (TEST_IMAGE_SIZE);
+  UT_ASSERT_NOT_NULL (Relocated);
+  UT_ASSERT_NOT_NULL (Walked);
+
+  for (Run = 0; Run < TEST_RANDOM_RUNS; Run++) {
+    Adjust = RandomAdjust ();
+
+    CopyMem (Relocated, Image, TEST_IMAGE_SIZE);
+    Cursor = PeCoffFixupIndexApply (&Index, 0, Relocated, 0, Index.SizeOfImage, Adjust, FALSE);
+    UT_ASSERT_EQUAL (Cursor, Index.Count);
+
+    CopyMem (Walked, Image, TEST_IMAGE_SIZE);
+    RelocateByBlockWalk (Walked, Adjust);
+    UT_ASSERT_MEM_EQUAL (Relocated, Walked, TEST_IMAGE_SIZE);
+
+    Cursor = PeCoffFixupIndexApply (&Index, 0, Relocated, 0, Index.SizeOfImage, Adjust, TRUE);
+    UT_ASSERT_EQUAL (Cursor, Index.Count);
+    UT_ASSERT_MEM_EQUAL (Relocated, Image, TEST_IMAGE_SIZE);
+  }
+
+  FreePool (Walked);
+  FreePool (Relocated);
+  FreePool (Index.Fixups);
+  FreePool (Image);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Reverting a relocated image through a page sized window, as when hashing it page by page,
+  should produce the same bytes as reverting the whole image.
+
+  Fixups straddling the end of a window are carried over to the next one, together with the
+  bytes from their RVA on.
+
+  @param[in]  Context  The TEST_IMAGE_SHAPE to build.
+
+  @retval UNIT_TEST_PASSED             The streamed reversion matched.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The streamed reversion differed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+StreamingMatchesWholeImage (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                *Image;
+  UINT8                *Relocated;
+  UINT8                *Streamed;
+  UINT8                Window[TEST_PAGE_SIZE + sizeof (UINT64)];
+  PE_COFF_FIXUP_INDEX  Index;
+  UINTN                Run;
+  UINTN                Cursor;
+  UINTN                PageRva;
+  UINTN                WindowStart;
+  UINTN                Pending;
+  UINTN                Final;
+  UINT64               Adjust;
+
+  mRandomState = 0xA4093822299F31D0ull;
+  UT_ASSERT_TRUE (BuildIndexedTestImage ((TEST_IMAGE_SHAPE *)Context, &Image, &Index));
+
+  Relocated = AllocatePool (TEST_IMAGE_SIZE);
+  Streamed  = AllocatePool (TEST_IMAGE_SIZE);
+  UT_ASSERT_NOT_NULL (Relocated);
+  UT_ASSERT_NOT_NULL (Streamed);
+
+  for (Run = 0; Run < TEST_RANDOM_RUNS; Run++) {
+    Adjust = RandomAdjust ();
+    CopyMem (Relocated, Image, TEST_IMAGE_SIZE);
+    PeCoffFixupIndexApply (&Index, 0, Relocated, 0, Index.SizeOfImage, Adjust, FALSE);
+    SetMem (Streamed, TEST_IMAGE_SIZE, 0xAA);
+
+    Cursor      = 0;
+    WindowStart = 0;
+    Pending     = 0;
+    for (PageRva = 0; PageRva < Index.SizeOfImage; PageRva += TEST_PAGE_SIZE) {
+      CopyMem (Window + Pending, Relocated + PageRva, TEST_PAGE_SIZE);
+      Cursor = PeCoffFixupIndexApply (&Index, Cursor, Window, WindowStart, PageRva + TEST_PAGE_SIZE, Adjust, TRUE);
+
+      //
+      // Everything below the next fixup is final, and goes to the sink.
+      //
+      Final = PageRva + TEST_PAGE_SIZE;
+      if ((Cursor < Index.Count) && (PE_COFF_FIXUP_RVA (Index.Fixups[Cursor]) < Final)) {
+        Final = PE_COFF_FIXUP_RVA (Index.Fixups[Cursor]);
+      }
+
+      CopyMem (Streamed + WindowStart, Window, Final - WindowStart);
+      Pending = PageRva + TEST_PAGE_SIZE - Final;
+      UT_ASSERT_TRUE (Pending < sizeof (UINT64));
+      CopyMem (Window, Window + (Final - WindowStart), Pending);
+      WindowStart = Final;
+    }
+
+    UT_ASSERT_EQUAL (Cursor, Index.Count);
+    UT_ASSERT_EQUAL (Pending, 0);
+    UT_ASSERT_MEM_EQUAL (Streamed, Image, TEST_IMAGE_SIZE);
+  }
+
+  FreePool (Streamed);
+  FreePool (Relocated);
+  FreePool (Index.Fixups);
+  FreePool (Image);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Building the index of an image with malformed headers or relocation directory should fail.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             Every malformed image was rejected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A malformed image was accepted.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MalformedImagesAreRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                      *Image;
+  UINT8                      *Original;
+  PE_COFF_FIXUP              *Fixups;
+  PE_COFF_FIXUP_INDEX        Index;
+  EFI_IMAGE_NT_HEADERS64     *Hdr;
+  EFI_IMAGE_DATA_DIRECTORY   *RelocDir;
+  EFI_IMAGE_BASE_RELOCATION  *Block;
+  UINTN                      FixupCount;
+  UINTN                      Capacity;
+
+  mRandomState = 0x082EFA98EC4E6C89ull;
+  Capacity     = TEST_IMAGE_PAGES * TEST_FIXUPS_PER_PAGE;
+  Image        = AllocatePool (TEST_IMAGE_SIZE);
+  Original     = AllocatePool (TEST_IMAGE_SIZE);
+  Fixups       = AllocatePool (Capacity * sizeof (PE_COFF_FIXUP));
+  UT_ASSERT_NOT_NULL (Image);
+  UT_ASSERT_NOT_NULL (Original);
+  UT_ASSERT_NOT_NULL (Fixups);
+
+  BuildTestImage (&mPe32PlusImage, Original, Fixups);
+  Hdr      = (EFI_IMAGE_NT_HEADERS64 *)(Image + TEST_PE_OFFSET);
+  RelocDir = &Hdr->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+  Block    = (EFI_IMAGE_BASE_RELOCATION *)(Image + TEST_RELOC_RVA);
+
+  //
+  // The unmodified image, in a buffer too small for all its fixups.
+  //
+  CopyMem (Image, Original, TEST_IMAGE_SIZE);
+  FixupCount = 1;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_BUFFER_TOO_SMALL);
+  UT_ASSERT_EQUAL (FixupCount, (TEST_LAST_DATA_PAGE - TEST_FIRST_DATA_PAGE + 1) * TEST_FIXUPS_PER_PAGE);
+
+  //
+  // The image does not fit in its buffer.
+  //
+  FixupCount = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE - 1, Fixups, &FixupCount, &Index), RETURN_LOAD_ERROR);
+
+  //
+  // Bad PE signature.
+  //
+  CopyMem (Image, Original, TEST_IMAGE_SIZE);
+  Hdr->Signature = 0;
+  FixupCount     = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_LOAD_ERROR);
+
+  //
+  // PE header beyond the image.
+  //
+  CopyMem (Image, Original, TEST_IMAGE_SIZE);
+  ((EFI_IMAGE_DOS_HEADER *)Image)->e_lfanew = TEST_IMAGE_SIZE - 8;
+  FixupCount                                = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_LOAD_ERROR);
+
+  //
+  // Relocation directory beyond the image, or wrapping around.
+  //
+  CopyMem (Image, Original, TEST_IMAGE_SIZE);
+  RelocDir->Size = TEST_PAGE_SIZE + 1;
+  FixupCount     = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_LOAD_ERROR);
+
+  RelocDir->Size = MAX_UINT32;
+  FixupCount     = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_LOAD_ERROR);
+
+  //
+  // Empty block, block larger than the directory, and truncated block header.
+  //
+  CopyMem (Image, Original, TEST_IMAGE_SIZE);
+  Block->SizeOfBlock = 0;
+  FixupCount         = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_LOAD_ERROR);
+
+  CopyMem (Image, Original, TEST_IMAGE_SIZE);
+  Block->SizeOfBlock = RelocDir->Size + sizeof (UINT16);
+  FixupCount         = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_LOAD_ERROR);
+
+  CopyMem (Image, Original, TEST_IMAGE_SIZE);
+  RelocDir->Size += sizeof (UINT32);
+  FixupCount      = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_LOAD_ERROR);
+
+  //
+  // Block page beyond the image, and field running past the end of the image.
+  //
+  CopyMem (Image, Original, TEST_IMAGE_SIZE);
+  Block->VirtualAddress = TEST_IMAGE_SIZE;
+  FixupCount            = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_LOAD_ERROR);
+
+  CopyMem (Image, Original, TEST_IMAGE_SIZE);
+  Block->VirtualAddress          = TEST_IMAGE_SIZE - TEST_PAGE_SIZE;
+  *(UINT16 *)(Block + 1)         = (EFI_IMAGE_REL_BASED_DIR64 << 12) | (TEST_PAGE_SIZE - sizeof (UINT32));
+  FixupCount                     = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_LOAD_ERROR);
+
+  //
+  // Unsupported relocation type.
+  //
+  CopyMem (Image, Original, TEST_IMAGE_SIZE);
+  *(UINT16 *)(Block + 1) = (EFI_IMAGE_REL_BASED_HIGHADJ << 12) | TEST_SLOT_OFFSET;
+  FixupCount             = Capacity;
+  UT_ASSERT_STATUS_EQUAL (PeCoffFixupIndexBuild (Image, TEST_IMAGE_SIZE, Fixups, &FixupCount, &Index), RETURN_UNSUPPORTED);
+
+  FreePool (Fixups);
+  FreePool (Original);
+  FreePool (Image);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the fixup index and run the
+  unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      FixupIndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the Fixup Index Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&FixupIndexTests, Framework, "PE/COFF Fixup Index Tests", "BasePeCoffLibNegative.FixupIndex", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for FixupIndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (FixupIndexTests, "PE32+ index should hold the sorted fixups", "IndexPe32Plus", IndexMatchesDirectory, NULL, NULL, &mPe32PlusImage);
+  AddTestCase (FixupIndexTests, "Unsorted PE32+ index should hold the sorted fixups", "IndexPe32PlusUnsorted", IndexMatchesDirectory, NULL, NULL, &mPe32PlusUnsortedImage);
+  AddTestCase (FixupIndexTests, "PE32 index should hold the sorted fixups", "IndexPe32", IndexMatchesDirectory, NULL, NULL, &mPe32Image);
+  AddTestCase (FixupIndexTests, "Unsorted PE32 index should hold the sorted fixups", "IndexPe32Unsorted", IndexMatchesDirectory, NULL, NULL, &mPe32UnsortedImage);
+  AddTestCase (FixupIndexTests, "Index of an image without relocations should be empty", "IndexNoRelocations", IndexMatchesDirectory, NULL, NULL, &mNoRelocationImage);
+  AddTestCase (FixupIndexTests, "PE32+ relocation should round trip", "RoundTripPe32Plus", RoundTrip, NULL, NULL, &mPe32PlusImage);
+  AddTestCase (FixupIndexTests, "Unsorted PE32+ relocation should round trip", "RoundTripPe32PlusUnsorted", RoundTrip, NULL, NULL, &mPe32PlusUnsortedImage);
+  AddTestCase (FixupIndexTests, "PE32 relocation should round trip", "RoundTripPe32", RoundTrip, NULL, NULL, &mPe32Image);
+  AddTestCase (FixupIndexTests, "Unsorted PE32 relocation should round trip", "RoundTripPe32Unsorted", RoundTrip, NULL, NULL, &mPe32UnsortedImage);
+  AddTestCase (FixupIndexTests, "Relocation without fixups should round trip", "RoundTripNoRelocations", RoundTrip, NULL, NULL, &mNoRelocationImage);
+  AddTestCase (FixupIndexTests, "Streamed PE32+ reversion should match the whole image", "StreamingPe32Plus", StreamingMatchesWholeImage, NULL, NULL, &mPe32PlusImage);
+  AddTestCase (FixupIndexTests, "Streamed unsorted PE32 reversion should match the whole image", "StreamingPe32Unsorted", StreamingMatchesWholeImage, NULL, NULL, &mPe32UnsortedImage);
+  AddTestCase (FixupIndexTests, "Malformed images should be rejected", "MalformedImages", MalformedImagesAreRejected, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -442,7 +442,11 @@
 // #define MBEDTLS_MD5_PROCESS_ALT
 // #define MBEDTLS_RIPEMD160_PROCESS_ALT
 // #define MBEDTLS_SHA1_PROCESS_ALT
-// #define MBEDTLS_SHA256_PROCESS_ALT
+//
+// Sha256ProcessAlt.c compresses SHA-256 blocks, with the SHA extensions when the processor
+// supports them.
+//
+#define MBEDTLS_SHA256_PROCESS_ALT
 // #define MBEDTLS_SHA512_PROCESS_ALT
 // #define MBEDTLS_DES_SETKEY_ALT
 // #define MBEDTLS_DES_CRYPT_ECB_ALT
@@ -0,0 +1,192 @@
+/** @file
+  SHA-256 compression functions backing mbedtls_internal_sha256_process().
+
+  The C implementation is the reference, and serves processors without the SHA extensions.
+  On X64, the SHA extensions are used whenever CPUID reports them.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Register/Intel/Cpuid.h>
+
+#include "Sha256Compress.h"
+
+#define SHA256_ROTR(x, n)    (((x) >> (n)) | ((x) << (32 - (n))))
+#define SHA256_CH(x, y, z)   (((x) & (y)) ^ (~(x) & (z)))
+#define SHA256_MAJ(x, y, z)  (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define SHA256_BSIG0(x)      (SHA256_ROTR (x, 2) ^ SHA256_ROTR (x, 13) ^ SHA256_ROTR (x, 22))
+#define SHA256_BSIG1(x)      (SHA256_ROTR (x, 6) ^ SHA256_ROTR (x, 11) ^ SHA256_ROTR (x, 25))
+#define SHA256_SSIG0(x)      (SHA256_ROTR (x, 7) ^ SHA256_ROTR (x, 18) ^ ((x) >> 3))
+#define SHA256_SSIG1(x)      (SHA256_ROTR (x, 17) ^ SHA256_ROTR (x, 19) ^ ((x) >> 10))
+
+typedef enum {
+  Sha256ShaNiUnknown,
+  Sha256ShaNiAbsent,
+  Sha256ShaNiPresent
+} SHA256_SHA_NI_STATE;
+
+STATIC CONST UINT32  mSha256K[64] = {
+  0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+  0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+  0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+  0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+  0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+  0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+  0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+  0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+//
+// CPUID is not cheap, and may even exit to a hypervisor, so it is only asked once. CPUs racing
+// on the first call all store the same answer.
+//
+STATIC volatile SHA256_SHA_NI_STATE  mSha256ShaNi = Sha256ShaNiUnknown;
+
+/**
+  Compresses message blocks into a SHA-256 state, in portable C.
+
+  @param[in, out] State       The eight words of the SHA-256 state, A first.
+  @param[in]      Data        The message blocks, of SHA256_BLOCK_SIZE bytes each.
+  @param[in]      BlockCount  The number of blocks at Data.
+
+**/
+VOID
+EFIAPI
+InternalSha256ProcessBlocksC (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  )
+{
+  UINT32  W[16];
+  UINT32  A, B, C, D, E, F, G, H;
+  UINT32  T1;
+  UINT32  T2;
+  UINTN   Round;
+
+  for ( ; BlockCount > 0; BlockCount--, Data += SHA256_BLOCK_SIZE) {
+    A = State[0];
+    B = State[1];
+    C = State[2];
+    D = State[3];
+    E = State[4];
+    F = State[5];
+    G = State[6];
+    H = State[7];
+
+    //
+    // The message schedule only ever looks 16 words back, so it is kept in a ring.
+    //
+    for (Round = 0; Round < 64; Round++) {
+      if (Round < 16) {
+        W[Round] = SwapBytes32 (ReadUnaligned32 ((CONST UINT32 *)(Data + Round * sizeof (UINT32))));
+      } else {
+        W[Round & 15] += SHA256_SSIG1 (W[(Round - 2) & 15]) + W[(Round - 7) & 15] +
+                         SHA256_SSIG0 (W[(Round - 15) & 15]);
+      }
+
+      T1 = H + SHA256_BSIG1 (E) + SHA256_CH (E, F, G) + mSha256K[Round] + W[Round & 15];
+      T2 = SHA256_BSIG0 (A) + SHA256_MAJ (A, B, C);
+      H  = G;
+      G  = F;
+      F  = E;
+      E  = D + T1;
+      D  = C;
+      C  = B;
+      B  = A;
+      A  = T1 + T2;
+    }
+
+    State[0] += A;
+    State[1] += B;
+    State[2] += C;
+    State[3] += D;
+    State[4] += E;
+    State[5] += F;
+    State[6] += G;
+    State[7] += H;
+  }
+
+  //
+  // The schedule is derived from the message, which may be a key.
+  //
+  ZeroMem (W, sizeof (W));
+}
+
+/**
+  Reports whether the processor supports the instructions InternalSha256ProcessBlocksShaNi()
+  uses: the SHA extensions, SSSE3 and SSE4.1.
+
+  @retval TRUE   InternalSha256ProcessBlocksShaNi() can be used.
+  @retval FALSE  Only InternalSha256ProcessBlocksC() can be used.
+
+**/
+BOOLEAN
+InternalSha256ShaNiSupported (
+  VOID
+  )
+{
+ #if defined (MDE_CPU_X64)
+  UINT32                                       MaxLeaf;
+  CPUID_VERSION_INFO_ECX                       VersionEcx;
+  CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_EBX  ExtendedEbx;
+
+  if (mSha256ShaNi == Sha256ShaNiUnknown) {
+    AsmCpuid (CPUID_SIGNATURE, &MaxLeaf, NULL, NULL, NULL);
+    ExtendedEbx.Uint32 = 0;
+    if (MaxLeaf >= CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS) {
+      AsmCpuidEx (
+        CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS,
+        CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_SUB_LEAF_INFO,
+        NULL,
+        &ExtendedEbx.Uint32,
+        NULL,
+        NULL
+        );
+    }
+
+    AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, &VersionEcx.Uint32, NULL);
+    if ((ExtendedEbx.Bits.SHA == 1) && (VersionEcx.Bits.SSSE3 == 1) && (VersionEcx.Bits.SSE4_1 == 1)) {
+      mSha256ShaNi = Sha256ShaNiPresent;
+    } else {
+      mSha256ShaNi = Sha256ShaNiAbsent;
+    }
+  }
+
+  return (BOOLEAN)(mSha256ShaNi == Sha256ShaNiPresent);
+ #else
+  return FALSE;
+ #endif
+}
+
+/**
+  Compresses message blocks into a SHA-256 state, with the fastest implementation the
+  processor supports.
+
+  @param[in, out] State       The eight words of the SHA-256 state, A first.
+  @param[in]      Data        The message blocks, of SHA256_BLOCK_SIZE bytes each.
+  @param[in]      BlockCount  The number of blocks at Data.
+
+**/
+VOID
+InternalSha256ProcessBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  )
+{
+ #if defined (MDE_CPU_X64)
+  if (InternalSha256ShaNiSupported ()) {
+    InternalSha256ProcessBlocksShaNi (State, Data, BlockCount);
+    return;
+  }
+
+ #endif
+
+  InternalSha256ProcessBlocksC (State, Data, BlockCount);
+}
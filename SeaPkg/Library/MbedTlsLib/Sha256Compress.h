@@ -0,0 +1,77 @@
+/** @file
+  SHA-256 compression functions backing mbedtls_internal_sha256_process().
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef SHA256_COMPRESS_H_
+#define SHA256_COMPRESS_H_
+
+#define SHA256_BLOCK_SIZE  64
+
+/**
+  Compresses message blocks into a SHA-256 state, in portable C.
+
+  @param[in, out] State       The eight words of the SHA-256 state, A first.
+  @param[in]      Data        The message blocks, of SHA256_BLOCK_SIZE bytes each.
+  @param[in]      BlockCount  The number of blocks at Data.
+
+**/
+VOID
+EFIAPI
+InternalSha256ProcessBlocksC (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+/**
+  Compresses message blocks into a SHA-256 state, with the SHA extensions.
+
+  Only call it when InternalSha256ShaNiSupported() returns TRUE.
+
+  @param[in, out] State       The eight words of the SHA-256 state, A first.
+  @param[in]      Data        The message blocks, of SHA256_BLOCK_SIZE bytes each.
+  @param[in]      BlockCount  The number of blocks at Data.
+
+**/
+VOID
+EFIAPI
+InternalSha256ProcessBlocksShaNi (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+/**
+  Reports whether the processor supports the instructions InternalSha256ProcessBlocksShaNi()
+  uses: the SHA extensions, SSSE3 and SSE4.1.
+
+  @retval TRUE   InternalSha256ProcessBlocksShaNi() can be used.
+  @retval FALSE  Only InternalSha256ProcessBlocksC() can be used.
+
+**/
+BOOLEAN
+InternalSha256ShaNiSupported (
+  VOID
+  );
+
+/**
+  Compresses message blocks into a SHA-256 state, with the fastest implementation the
+  processor supports.
+
+  @param[in, out] State       The eight words of the SHA-256 state, A first.
+  @param[in]      Data        The message blocks, of SHA256_BLOCK_SIZE bytes each.
+  @param[in]      BlockCount  The number of blocks at Data.
+
+**/
+VOID
+InternalSha256ProcessBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+#endif
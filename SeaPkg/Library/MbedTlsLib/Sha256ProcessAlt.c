@@ -0,0 +1,31 @@
+/** @file
+  SHA-256 block function of mbedtls, provided through MBEDTLS_SHA256_PROCESS_ALT.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+#include <mbedtls/sha256.h>
+
+#include "Sha256Compress.h"
+
+#if defined (MBEDTLS_SHA256_PROCESS_ALT)
+
+/*
+ * SHA-256 process data block (internal use only)
+ */
+int
+mbedtls_internal_sha256_process (
+  mbedtls_sha256_context  *ctx,
+  const unsigned char     data[SHA256_BLOCK_SIZE]
+  )
+{
+  InternalSha256ProcessBlocks (ctx->state, data, 1);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,589 @@
+/** @file
+  Unit tests of the SHA-256 compression functions backing mbedtls_internal_sha256_process().
+
+  Every implementation is checked against the NIST example vectors, and the SHA extensions one
+  against the C one on random states and messages. The throughput of each implementation is
+  logged across buffer sizes, as a rough benchmark.
+
+  The host BaseLib neither executes CPUID nor reads the time stamp counter, so the tests
+  substitute the real instructions.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#if defined (_MSC_VER)
+  #include <intrin.h>
+#else
+  #include <cpuid.h>
+  #include <x86intrin.h>
+#endif
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestHostBaseLib.h>
+#include <UnitTest/UnitTestRandom.h>
+
+#include "../Sha256Compress.h"
+
+#define UNIT_TEST_APP_NAME     "MbedTlsLib SHA-256 Compression Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_SHA256_DIGEST_SIZE  32
+
+//
+// Block counts of the random comparisons range from 0 to this, each tried this many times.
+//
+#define TEST_MAX_BLOCKS        17
+#define TEST_RANDOM_RUNS       64
+#define TEST_BENCHMARK_BYTES   (16 * 1024 * 1024)
+#define TEST_BENCHMARK_BUFFER  (64 * 1024)
+
+typedef
+VOID
+(EFIAPI *TEST_SHA256_PROCESS_BLOCKS)(
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+typedef struct {
+  TEST_SHA256_PROCESS_BLOCKS    ProcessBlocks;
+  CONST CHAR8                   *Name;
+  BOOLEAN                       NeedsShaNi;
+} TEST_SHA256_IMPLEMENTATION;
+
+typedef struct {
+  CONST CHAR8    *Message;
+  UINTN          Repeat;
+  UINT8          Digest[TEST_SHA256_DIGEST_SIZE];
+} TEST_SHA256_VECTOR;
+
+VOID
+EFIAPI
+TestSha256ProcessBlocksDispatch (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+TEST_SHA256_IMPLEMENTATION  mSha256C        = { InternalSha256ProcessBlocksC, "C", FALSE };
+TEST_SHA256_IMPLEMENTATION  mSha256ShaNi    = { InternalSha256ProcessBlocksShaNi, "SHA-NI", TRUE };
+TEST_SHA256_IMPLEMENTATION  mSha256Dispatch = { TestSha256ProcessBlocksDispatch, "Dispatch", FALSE };
+
+TEST_SHA256_IMPLEMENTATION  *mSha256Implementations[] = { &mSha256C, &mSha256ShaNi };
+
+CONST UINT32  mSha256InitialState[8] = {
+  0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+//
+// Examples of FIPS 180-2, and the empty message.
+//
+TEST_SHA256_VECTOR  mSha256Vectors[] = {
+  {
+    "",
+    1,
+    { 0xE3, 0xB0, 0xC4, 0x42, 0x98, 0xFC, 0x1C, 0x14, 0x9A, 0xFB, 0xF4, 0xC8, 0x99, 0x6F, 0xB9, 0x24,
+      0x27, 0xAE, 0x41, 0xE4, 0x64, 0x9B, 0x93, 0x4C, 0xA4, 0x95, 0x99, 0x1B, 0x78, 0x52, 0xB8, 0x55 }
+  },
+  {
+    "abc",
+    1,
+    { 0xBA, 0x78, 0x16, 0xBF, 0x8F, 0x01, 0xCF, 0xEA, 0x41, 0x41, 0x40, 0xDE, 0x5D, 0xAE, 0x22, 0x23,
+      0xB0, 0x03, 0x61, 0xA3, 0x96, 0x17, 0x7A, 0x9C, 0xB4, 0x10, 0xFF, 0x61, 0xF2, 0x00, 0x15, 0xAD }
+  },
+  {
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+    1,
+    { 0x24, 0x8D, 0x6A, 0x61, 0xD2, 0x06, 0x38, 0xB8, 0xE5, 0xC0, 0x26, 0x93, 0x0C, 0x3E, 0x60, 0x39,
+      0xA3, 0x3C, 0xE4, 0x59, 0x64, 0xFF, 0x21, 0x67, 0xF6, 0xEC, 0xED, 0xD4, 0x19, 0xDB, 0x06, 0xC1 }
+  },
+  {
+    "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+    1,
+    { 0xCF, 0x5B, 0x16, 0xA7, 0x78, 0xAF, 0x83, 0x80, 0x03, 0x6C, 0xE5, 0x9E, 0x7B, 0x04, 0x92, 0x37,
+      0x0B, 0x24, 0x9B, 0x11, 0xE8, 0xF0, 0x7A, 0x51, 0xAF, 0xAC, 0x45, 0x03, 0x7A, 0xFE, 0xE9, 0xD1 }
+  },
+  {
+    "a",
+    1000000,
+    { 0xCD, 0xC7, 0x6E, 0x5C, 0x99, 0x14, 0xFB, 0x92, 0x81, 0xA1, 0xC7, 0xE2, 0x84, 0xD7, 0x3E, 0x67,
+      0xF1, 0x80, 0x9A, 0x48, 0xA4, 0x97, 0x20, 0x0E, 0x04, 0x6D, 0x39, 0xCC, 0xC7, 0x11, 0x2C, 0xD0 }
+  }
+};
+
+UNIT_TEST_HOST_BASE_LIB_ASM_CPUID     mOriginalAsmCpuid;
+UNIT_TEST_HOST_BASE_LIB_ASM_CPUID_EX  mOriginalAsmCpuidEx;
+
+/**
+  Substitute of AsmCpuidEx executing CPUID.
+
+  @param[in]  Index     The 32-bit value to load into EAX prior to invoking the CPUID instruction.
+  @param[in]  SubIndex  The 32-bit value to load into ECX prior to invoking the CPUID instruction.
+  @param[out] Eax       The pointer to the 32-bit EAX value returned by the CPUID instruction.
+  @param[out] Ebx       The pointer to the 32-bit EBX value returned by the CPUID instruction.
+  @param[out] Ecx       The pointer to the 32-bit ECX value returned by the CPUID instruction.
+  @param[out] Edx       The pointer to the 32-bit EDX value returned by the CPUID instruction.
+
+  @return Index.
+
+**/
+UINT32
+EFIAPI
+HostAsmCpuidEx (
+  IN  UINT32  Index,
+  IN  UINT32  SubIndex,
+  OUT UINT32  *Eax   OPTIONAL,
+  OUT UINT32  *Ebx   OPTIONAL,
+  OUT UINT32  *Ecx   OPTIONAL,
+  OUT UINT32  *Edx   OPTIONAL
+  )
+{
+  UINT32  Registers[4];
+
+ #if defined (_MSC_VER)
+  __cpuidex ((int *)Registers, (int)Index, (int)SubIndex);
+ #else
+  __cpuid_count (Index, SubIndex, Registers[0], Registers[1], Registers[2], Registers[3]);
+ #endif
+
+  if (Eax != NULL) {
+    *Eax = Registers[0];
+  }
+
+  if (Ebx != NULL) {
+    *Ebx = Registers[1];
+  }
+
+  if (Ecx != NULL) {
+    *Ecx = Registers[2];
+  }
+
+  if (Edx != NULL) {
+    *Edx = Registers[3];
+  }
+
+  return Index;
+}
+
+/**
+  Substitute of AsmCpuid executing CPUID.
+
+  @param[in]  Index  The 32-bit value to load into EAX prior to invoking the CPUID instruction.
+  @param[out] Eax    The pointer to the 32-bit EAX value returned by the CPUID instruction.
+  @param[out] Ebx    The pointer to the 32-bit EBX value returned by the CPUID instruction.
+  @param[out] Ecx    The pointer to the 32-bit ECX value returned by the CPUID instruction.
+  @param[out] Edx    The pointer to the 32-bit EDX value returned by the CPUID instruction.
+
+  @return Index.
+
+**/
+UINT32
+EFIAPI
+HostAsmCpuid (
+  IN  UINT32  Index,
+  OUT UINT32  *Eax   OPTIONAL,
+  OUT UINT32  *Ebx   OPTIONAL,
+  OUT UINT32  *Ecx   OPTIONAL,
+  OUT UINT32  *Edx   OPTIONAL
+  )
+{
+  return HostAsmCpuidEx (Index, 0, Eax, Ebx, Ecx, Edx);
+}
+
+/**
+  Read the time stamp counter of the processor.
+
+  @return The current time stamp counter.
+
+**/
+UINT64
+HostReadTsc (
+  VOID
+  )
+{
+  return __rdtsc ();
+}
+
+/**
+  Adapt InternalSha256ProcessBlocks() to TEST_SHA256_PROCESS_BLOCKS.
+
+  @param[in, out] State       The eight words of the SHA-256 state, A first.
+  @param[in]      Data        The message blocks, of SHA256_BLOCK_SIZE bytes each.
+  @param[in]      BlockCount  The number of blocks at Data.
+
+**/
+VOID
+EFIAPI
+TestSha256ProcessBlocksDispatch (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  )
+{
+  InternalSha256ProcessBlocks (State, Data, BlockCount);
+}
+
+/**
+  Fill a buffer with random bytes.
+
+  @param[out] Buffer  The buffer to fill.
+  @param[in]  Length  The size of Buffer in bytes.
+
+**/
+VOID
+FillRandom (
+  OUT UINT8  *Buffer,
+  IN  UINTN  Length
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Length; Index++) {
+    Buffer[Index] = (UINT8)NextRandom ();
+  }
+}
+
+/**
+  Hash a message the way mbedtls does around its block function: whole blocks straight from
+  the message, then the padded tail.
+
+  @param[in]  Implementation  The block function to use.
+  @param[in]  Message         The message to hash.
+  @param[in]  Length          The size of Message in bytes.
+  @param[out] Digest          The SHA-256 digest of Message.
+
+**/
+VOID
+TestSha256Digest (
+  IN  TEST_SHA256_IMPLEMENTATION  *Implementation,
+  IN  CONST UINT8                 *Message,
+  IN  UINTN                       Length,
+  OUT UINT8                       *Digest
+  )
+{
+  UINT32  State[8];
+  UINT8   Tail[2 * SHA256_BLOCK_SIZE];
+  UINTN   Blocks;
+  UINTN   Remainder;
+  UINTN   TailLength;
+  UINTN   Index;
+
+  CopyMem (State, mSha256InitialState, sizeof (State));
+
+  Blocks = Length / SHA256_BLOCK_SIZE;
+  Implementation->ProcessBlocks (State, Message, Blocks);
+
+  //
+  // 0x80, zeros, then the length in bits, big endian, ending a block.
+  //
+  Remainder = Length % SHA256_BLOCK_SIZE;
+  ZeroMem (Tail, sizeof (Tail));
+  CopyMem (Tail, Message + Blocks * SHA256_BLOCK_SIZE, Remainder);
+  Tail[Remainder] = 0x80;
+  TailLength      = (Remainder < SHA256_BLOCK_SIZE - sizeof (UINT64)) ? SHA256_BLOCK_SIZE : 2 * SHA256_BLOCK_SIZE;
+  WriteUnaligned64 ((UINT64 *)(Tail + TailLength - sizeof (UINT64)), SwapBytes64 (MultU64x32 (Length, 8)));
+  Implementation->ProcessBlocks (State, Tail, TailLength / SHA256_BLOCK_SIZE);
+
+  for (Index = 0; Index < ARRAY_SIZE (State); Index++) {
+    WriteUnaligned32 ((UINT32 *)(Digest + Index * sizeof (UINT32)), SwapBytes32 (State[Index]));
+  }
+}
+
+/**
+  Install the substitutes of CPUID.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The substitutes are installed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SetUpHostCpu (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mOriginalAsmCpuid   = gUnitTestHostBaseLib.X86->AsmCpuid;
+  mOriginalAsmCpuidEx = gUnitTestHostBaseLib.X86->AsmCpuidEx;
+
+  gUnitTestHostBaseLib.X86->AsmCpuid   = HostAsmCpuid;
+  gUnitTestHostBaseLib.X86->AsmCpuidEx = HostAsmCpuidEx;
+
+  mRandomState = 0x5348413235360001ull;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Restore the host BaseLib CPUID.
+
+  @param[in]  Context  Unused.
+
+**/
+VOID
+EFIAPI
+TearDownHostCpu (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  gUnitTestHostBaseLib.X86->AsmCpuid   = mOriginalAsmCpuid;
+  gUnitTestHostBaseLib.X86->AsmCpuidEx = mOriginalAsmCpuidEx;
+}
+
+/**
+  An implementation must produce the digests of the NIST example vectors.
+
+  @param[in]  Context  The TEST_SHA256_IMPLEMENTATION under test.
+
+  @retval UNIT_TEST_PASSED             The unit test has completed and the test
+                                       case was successful.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+  @retval UNIT_TEST_SKIPPED            The processor does not support the implementation.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+KnownAnswers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_SHA256_IMPLEMENTATION  *Implementation;
+  UINT8                       *Message;
+  UINTN                       Length;
+  UINTN                       Vector;
+  UINTN                       Index;
+  UINT8                       Digest[TEST_SHA256_DIGEST_SIZE];
+
+  Implementation = (TEST_SHA256_IMPLEMENTATION *)Context;
+  if (Implementation->NeedsShaNi && !InternalSha256ShaNiSupported ()) {
+    UT_LOG_WARNING ("The processor does not support the SHA extensions\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  for (Vector = 0; Vector < ARRAY_SIZE (mSha256Vectors); Vector++) {
+    Length  = AsciiStrLen (mSha256Vectors[Vector].Message) * mSha256Vectors[Vector].Repeat;
+    Message = AllocatePool (Length + 1);
+    UT_ASSERT_NOT_NULL (Message);
+
+    for (Index = 0; Index < mSha256Vectors[Vector].Repeat; Index++) {
+      CopyMem (
+        Message + Index * AsciiStrLen (mSha256Vectors[Vector].Message),
+        mSha256Vectors[Vector].Message,
+        AsciiStrLen (mSha256Vectors[Vector].Message)
+        );
+    }
+
+    TestSha256Digest (Implementation, Message, Length, Digest);
+    FreePool (Message);
+
+    UT_ASSERT_MEM_EQUAL (Digest, mSha256Vectors[Vector].Digest, sizeof (Digest));
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  An implementation must compress any number of blocks, aligned or not, exactly like the C one.
+
+  @param[in]  Context  The TEST_SHA256_IMPLEMENTATION under test.
+
+  @retval UNIT_TEST_PASSED             The unit test has completed and the test
+                                       case was successful.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+  @retval UNIT_TEST_SKIPPED            The processor does not support the implementation.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MatchesC (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_SHA256_IMPLEMENTATION  *Implementation;
+  UINT8                       *Buffer;
+  UINT8                       *Data;
+  UINTN                       Blocks;
+  UINTN                       Run;
+  UINT32                      Expected[8];
+  UINT32                      State[8];
+
+  Implementation = (TEST_SHA256_IMPLEMENTATION *)Context;
+  if (Implementation->NeedsShaNi && !InternalSha256ShaNiSupported ()) {
+    UT_LOG_WARNING ("The processor does not support the SHA extensions\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  Buffer = AllocatePool (TEST_MAX_BLOCKS * SHA256_BLOCK_SIZE + 1);
+  UT_ASSERT_NOT_NULL (Buffer);
+
+  for (Blocks = 0; Blocks <= TEST_MAX_BLOCKS; Blocks++) {
+    for (Run = 0; Run < TEST_RANDOM_RUNS; Run++) {
+      Data = Buffer + (Run & 1);
+      FillRandom (Data, Blocks * SHA256_BLOCK_SIZE);
+      FillRandom ((UINT8 *)Expected, sizeof (Expected));
+      CopyMem (State, Expected, sizeof (State));
+
+      InternalSha256ProcessBlocksC (Expected, Data, Blocks);
+      Implementation->ProcessBlocks (State, Data, Blocks);
+
+      if (CompareMem (State, Expected, sizeof (State)) != 0) {
+        UT_LOG_ERROR ("%a differs from C on %ld blocks, run %ld\n", Implementation->Name, Blocks, Run);
+        FreePool (Buffer);
+        UT_ASSERT_MEM_EQUAL (State, Expected, sizeof (State));
+      }
+    }
+  }
+
+  FreePool (Buffer);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Log the throughput of each implementation supported by the processor, across buffer sizes.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The unit test has completed and the test
+                                       case was successful.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Throughput (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINTN          Sizes[] = { 64, 256, 1024, 4096, 16384, TEST_BENCHMARK_BUFFER };
+  TEST_SHA256_IMPLEMENTATION  *Implementation;
+  UINT8                       *Buffer;
+  UINT8                       Digest[TEST_SHA256_DIGEST_SIZE];
+  UINTN                       Size;
+  UINTN                       Iteration;
+  UINTN                       Iterations;
+  UINTN                       Index;
+  UINT64                      Start;
+  UINT64                      Cycles;
+
+  Buffer = AllocatePool (TEST_BENCHMARK_BUFFER);
+  UT_ASSERT_NOT_NULL (Buffer);
+  FillRandom (Buffer, TEST_BENCHMARK_BUFFER);
+
+  for (Index = 0; Index < ARRAY_SIZE (mSha256Implementations); Index++) {
+    Implementation = mSha256Implementations[Index];
+    if (Implementation->NeedsShaNi && !InternalSha256ShaNiSupported ()) {
+      UT_LOG_INFO ("%a: not supported by the processor\n", Implementation->Name);
+      continue;
+    }
+
+    for (Size = 0; Size < ARRAY_SIZE (Sizes); Size++) {
+      Iterations = TEST_BENCHMARK_BYTES / Sizes[Size];
+      Start      = HostReadTsc ();
+      for (Iteration = 0; Iteration < Iterations; Iteration++) {
+        TestSha256Digest (Implementation, Buffer, Sizes[Size], Digest);
+      }
+
+      Cycles = HostReadTsc () - Start;
+
+      //
+      // In hundredths of a cycle, padding included, since callers pay for it too.
+      //
+      UT_LOG_INFO (
+        "%a: %ld byte messages, %ld.%02ld cycles per byte\n",
+        Implementation->Name,
+        Sizes[Size],
+        Cycles / (Iterations * Sizes[Size]),
+        (Cycles * 100 / (Iterations * Sizes[Size])) % 100
+        );
+    }
+  }
+
+  FreePool (Buffer);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  SHA-256 compression functions and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      Sha256Tests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the SHA-256 Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&Sha256Tests, Framework, "SHA-256 Compression Tests", "MbedTlsLib.Sha256", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for Sha256Tests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (Sha256Tests, "C compression should produce the NIST digests", "KatC", KnownAnswers, SetUpHostCpu, TearDownHostCpu, &mSha256C);
+  AddTestCase (Sha256Tests, "SHA-NI compression should produce the NIST digests", "KatShaNi", KnownAnswers, SetUpHostCpu, TearDownHostCpu, &mSha256ShaNi);
+  AddTestCase (Sha256Tests, "Dispatched compression should produce the NIST digests", "KatDispatch", KnownAnswers, SetUpHostCpu, TearDownHostCpu, &mSha256Dispatch);
+  AddTestCase (Sha256Tests, "SHA-NI compression should match C on random blocks", "ShaNiMatchesC", MatchesC, SetUpHostCpu, TearDownHostCpu, &mSha256ShaNi);
+  AddTestCase (Sha256Tests, "Dispatched compression should match C on random blocks", "DispatchMatchesC", MatchesC, SetUpHostCpu, TearDownHostCpu, &mSha256Dispatch);
+  AddTestCase (Sha256Tests, "Compression throughput across buffer sizes", "Throughput", Throughput, SetUpHostCpu, TearDownHostCpu, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -28,7 +28,7 @@
 #define MAX_DEBUG_MESSAGE_LENGTH  0x100
 
 //
-// Internal spin lock for debug
+// Internal spin lock for debug, held around every message written to the serial port
 //
 
 #define SPIN_LOCK_RELEASED  ((UINTN) 1)
@@ -36,6 +36,315 @@
 
 SPIN_LOCK  mInternalDebugLock = SPIN_LOCK_RELEASED; // TBD: need call InitializeSpinLock
 
+//
+// Per CPU log rings.
+//
+// Each ring has a single producer, the CPU owning it, and is consumed by whichever CPU drains
+// the rings under mDebugLogDrainLock. Producers never wait for the serial port: the rings are
+// drained by the CPU owning the first ring, and by any CPU whose ring passes the high water
+// mark, only when no other CPU is already draining. Error messages are not buffered, a CPU
+// reporting an error may never log again, so they drain the rings and are written synchronously.
+//
+#define DEBUG_LOG_RING_COUNT       FixedPcdGet32 (PcdMpSafeDebugLogRingCount)
+#define DEBUG_LOG_RING_SIZE        FixedPcdGet32 (PcdMpSafeDebugLogRingSize)
+#define DEBUG_LOG_RING_HIGH_WATER  (DEBUG_LOG_RING_SIZE / 4 * 3)
+
+STATIC_ASSERT ((DEBUG_LOG_RING_SIZE & (DEBUG_LOG_RING_SIZE - 1)) == 0, "PcdMpSafeDebugLogRingSize must be a power of 2");
+STATIC_ASSERT (DEBUG_LOG_RING_SIZE >= 4 * MAX_DEBUG_MESSAGE_LENGTH, "PcdMpSafeDebugLogRingSize is too small");
+
+typedef struct {
+  UINT64    Timestamp;
+  UINT32    ApicId;
+  UINT32    Length;               // Bytes of message following the record
+} DEBUG_LOG_RECORD;
+
+typedef struct {
+  volatile UINT32    Owner;       // APIC ID of the owning CPU plus one, 0 when unclaimed
+  volatile UINT32    Busy;        // Set while the owner produces, to catch nested messages
+  volatile UINT32    Head;        // Bytes produced, only advanced by the owner
+  volatile UINT32    Tail;        // Bytes consumed, only advanced under mDebugLogDrainLock
+  volatile UINT32    Dropped;     // Messages dropped because the ring was full
+  UINT32             DroppedReported;
+  UINT8              Data[DEBUG_LOG_RING_SIZE];
+} DEBUG_LOG_RING;
+
+DEBUG_LOG_RING  mDebugLogRing[DEBUG_LOG_RING_COUNT];
+SPIN_LOCK       mDebugLogDrainLock = SPIN_LOCK_RELEASED;
+
+/**
+  Get the APIC ID of the executing CPU.
+
+  @return The x2APIC ID when reported, the initial APIC ID otherwise.
+
+**/
+STATIC
+UINT32
+DebugLogGetApicId (
+  VOID
+  )
+{
+  UINT32  MaxLeaf;
+  UINT32  RegEbx;
+  UINT32  RegEdx;
+
+  AsmCpuid (0, &MaxLeaf, NULL, NULL, NULL);
+  if (MaxLeaf >= 0xB) {
+    AsmCpuidEx (0xB, 0, NULL, &RegEbx, NULL, &RegEdx);
+    if ((RegEbx & 0xFFFF) != 0) {
+      return RegEdx;
+    }
+  }
+
+  AsmCpuid (1, NULL, &RegEbx, NULL, NULL);
+  return RegEbx >> 24;
+}
+
+/**
+  Get the ring of a CPU, claiming one if the CPU does not have one yet.
+
+  @param[in]  ApicId  The APIC ID of the CPU.
+
+  @return The ring of the CPU, NULL when all rings are claimed by other CPUs.
+
+**/
+STATIC
+DEBUG_LOG_RING *
+DebugLogGetRing (
+  IN UINT32  ApicId
+  )
+{
+  UINTN   Index;
+  UINT32  Owner;
+
+  for (Index = 0; Index < DEBUG_LOG_RING_COUNT; Index++) {
+    Owner = mDebugLogRing[Index].Owner;
+    if (Owner == 0) {
+      Owner = InterlockedCompareExchange32 ((UINT32 *)&mDebugLogRing[Index].Owner, 0, ApicId + 1);
+      if (Owner == 0) {
+        return &mDebugLogRing[Index];
+      }
+    }
+
+    if (Owner == ApicId + 1) {
+      return &mDebugLogRing[Index];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Copy bytes into a ring, wrapping around its end.
+
+  @param[in, out] Ring    The ring.
+  @param[in]      Offset  The free running offset to copy to.
+  @param[in]      Source  The bytes to copy.
+  @param[in]      Length  The number of bytes to copy.
+
+**/
+STATIC
+VOID
+DebugLogRingWrite (
+  IN OUT DEBUG_LOG_RING  *Ring,
+  IN     UINT32          Offset,
+  IN     CONST VOID      *Source,
+  IN     UINT32          Length
+  )
+{
+  UINT32  Start;
+  UINT32  Chunk;
+
+  Start = Offset & (DEBUG_LOG_RING_SIZE - 1);
+  Chunk = MIN (Length, DEBUG_LOG_RING_SIZE - Start);
+  CopyMem (&Ring->Data[Start], Source, Chunk);
+  CopyMem (Ring->Data, (CONST UINT8 *)Source + Chunk, Length - Chunk);
+}
+
+/**
+  Copy bytes out of a ring, wrapping around its end.
+
+  @param[in]  Ring         The ring.
+  @param[in]  Offset       The free running offset to copy from.
+  @param[out] Destination  The buffer receiving the bytes.
+  @param[in]  Length       The number of bytes to copy.
+
+**/
+STATIC
+VOID
+DebugLogRingRead (
+  IN  CONST DEBUG_LOG_RING  *Ring,
+  IN  UINT32                Offset,
+  OUT VOID                  *Destination,
+  IN  UINT32                Length
+  )
+{
+  UINT32  Start;
+  UINT32  Chunk;
+
+  Start = Offset & (DEBUG_LOG_RING_SIZE - 1);
+  Chunk = MIN (Length, DEBUG_LOG_RING_SIZE - Start);
+  CopyMem (Destination, &Ring->Data[Start], Chunk);
+  CopyMem ((UINT8 *)Destination + Chunk, Ring->Data, Length - Chunk);
+}
+
+/**
+  Write the messages logged in the rings to the serial port, oldest first across all rings.
+
+  Only the messages logged before the drain starts are written, so that CPUs logging during
+  the drain cannot hold the draining CPU forever. The caller must hold mDebugLogDrainLock.
+  Each message is written under mInternalDebugLock, so its bytes are not interleaved with a
+  message a CPU without a ring writes synchronously.
+
+**/
+STATIC
+VOID
+DebugLogDrain (
+  VOID
+  )
+{
+  UINT32            Limit[DEBUG_LOG_RING_COUNT];
+  DEBUG_LOG_RING    *Ring;
+  DEBUG_LOG_RECORD  Record;
+  DEBUG_LOG_RECORD  Oldest;
+  UINTN             Index;
+  UINTN             OldestIndex;
+  UINT32            Dropped;
+  CHAR8             Prefix[48];
+  CHAR8             Buffer[MAX_DEBUG_MESSAGE_LENGTH];
+
+  for (Index = 0; Index < DEBUG_LOG_RING_COUNT; Index++) {
+    Ring         = &mDebugLogRing[Index];
+    Limit[Index] = Ring->Head;
+
+    Dropped = Ring->Dropped;
+    if (Dropped != Ring->DroppedReported) {
+      AsciiSPrint (Buffer, sizeof (Buffer), "(STM) [%d] %d messages dropped\n", Ring->Owner - 1, Dropped - Ring->DroppedReported);
+      AcquireSpinLock (&mInternalDebugLock);
+      SerialPortWrite ((UINT8 *)Buffer, AsciiStrLen (Buffer));
+      ReleaseSpinLock (&mInternalDebugLock);
+      Ring->DroppedReported = Dropped;
+    }
+  }
+
+  ZeroMem (&Oldest, sizeof (Oldest));
+
+  //
+  // Make sure the records are read after the heads they are covered by.
+  //
+  MemoryFence ();
+
+  while (TRUE) {
+    OldestIndex = DEBUG_LOG_RING_COUNT;
+    for (Index = 0; Index < DEBUG_LOG_RING_COUNT; Index++) {
+      Ring = &mDebugLogRing[Index];
+      if (Ring->Tail == Limit[Index]) {
+        continue;
+      }
+
+      DebugLogRingRead (Ring, Ring->Tail, &Record, sizeof (Record));
+      if ((OldestIndex == DEBUG_LOG_RING_COUNT) || (Record.Timestamp < Oldest.Timestamp)) {
+        OldestIndex = Index;
+        Oldest      = Record;
+      }
+    }
+
+    if (OldestIndex == DEBUG_LOG_RING_COUNT) {
+      break;
+    }
+
+    Ring = &mDebugLogRing[OldestIndex];
+    DebugLogRingRead (Ring, Ring->Tail + sizeof (Oldest), Buffer, Oldest.Length);
+
+    AsciiSPrint (Prefix, sizeof (Prefix), "(STM) [%d:%016lx] ", Oldest.ApicId, Oldest.Timestamp);
+    AcquireSpinLock (&mInternalDebugLock);
+    SerialPortWrite ((UINT8 *)Prefix, AsciiStrLen (Prefix));
+    SerialPortWrite ((UINT8 *)Buffer, Oldest.Length);
+    ReleaseSpinLock (&mInternalDebugLock);
+
+    //
+    // Hand the space back to the producer only once the record is consumed.
+    //
+    MemoryFence ();
+    Ring->Tail += (UINT32)ALIGN_VALUE (sizeof (Oldest) + Oldest.Length, sizeof (UINT64));
+  }
+}
+
+/**
+  Write the messages logged in the rings to the serial port, unless another CPU is draining them.
+
+  The lock is not waited for, so that an ASSERT() or error raised while draining, on the
+  draining CPU itself, does not deadlock.
+
+**/
+STATIC
+VOID
+DebugLogFlush (
+  VOID
+  )
+{
+  if (AcquireSpinLockOrFail (&mDebugLogDrainLock)) {
+    DebugLogDrain ();
+    ReleaseSpinLock (&mDebugLogDrainLock);
+  }
+}
+
+/**
+  Log a message in the ring of the executing CPU.
+
+  @param[in]  Buffer  The NULL terminated message.
+
+  @retval TRUE   The message is logged, or dropped because the ring is full.
+  @retval FALSE  The executing CPU has no ring, or is already logging a message, the message
+                 has to be written synchronously.
+
+**/
+STATIC
+BOOLEAN
+DebugLogBuffered (
+  IN CONST CHAR8  *Buffer
+  )
+{
+  DEBUG_LOG_RING    *Ring;
+  DEBUG_LOG_RECORD  Record;
+  UINT32            Head;
+  UINT32            RecordSize;
+  BOOLEAN           Drain;
+
+  Record.ApicId = DebugLogGetApicId ();
+  Ring          = DebugLogGetRing (Record.ApicId);
+  if ((Ring == NULL) || (Ring->Busy != 0)) {
+    return FALSE;
+  }
+
+  Ring->Busy       = 1;
+  Record.Timestamp = AsmReadTsc ();
+  Record.Length    = (UINT32)AsciiStrLen (Buffer);
+  RecordSize       = (UINT32)ALIGN_VALUE (sizeof (Record) + Record.Length, sizeof (UINT64));
+
+  Head = Ring->Head;
+  if (Head - Ring->Tail > DEBUG_LOG_RING_SIZE - RecordSize) {
+    Ring->Dropped++;
+  } else {
+    DebugLogRingWrite (Ring, Head, &Record, sizeof (Record));
+    DebugLogRingWrite (Ring, Head + sizeof (Record), Buffer, Record.Length);
+
+    //
+    // Publish the record only once it is complete.
+    //
+    MemoryFence ();
+    Ring->Head = Head + RecordSize;
+  }
+
+  Drain      = (Ring == &mDebugLogRing[0]) || (Ring->Head - Ring->Tail >= DEBUG_LOG_RING_HIGH_WATER);
+  Ring->Busy = 0;
+
+  if (Drain) {
+    DebugLogFlush ();
+  }
+
+  return TRUE;
+}
+
 /**
   Prints a debug message to the debug output device if the specified error level is enabled.
 
@@ -81,6 +390,14 @@ DebugPrint (
   AsciiVSPrint (Buffer, sizeof (Buffer), Format, Marker);
   VA_END (Marker);
 
+  if (FeaturePcdGet (PcdMpSafeDebugLogBufferEnable)) {
+    if ((ErrorLevel & DEBUG_ERROR) != 0) {
+      DebugLogFlush ();
+    } else if (DebugLogBuffered (Buffer)) {
+      return;
+    }
+  }
+
   //
   // Send the print string to a Serial Port
   //
@@ -126,6 +443,13 @@ DebugAssert (
   //
   AsciiSPrint (Buffer, sizeof (Buffer), "ASSERT %a(%d): %a\n", FileName, LineNumber, Description);
 
+  //
+  // The CPU may not come back, write out what was logged before the assert.
+  //
+  if (FeaturePcdGet (PcdMpSafeDebugLogBufferEnable)) {
+    DebugLogFlush ();
+  }
+
   //
   // Send the print string to the Console Output device
   //
@@ -17,6 +17,7 @@
 
 #include <Base.h>
 #include <Library/SynchronizationLib.h>
+#include <Library/SeaSynchronizationLib.h>
 #include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/PcdLib.h>
@@ -108,4 +109,44 @@ InternalSyncCompareExchange64 (
   IN      UINT64           ExchangeValue
   );
 
+/**
+  Performs an atomic addition to a 32-bit unsigned integer.
+
+  Performs an atomic addition of Addend to the 32-bit unsigned integer specified by Value and
+  returns the value before the addition. The addition must be performed using MP safe
+  mechanisms.
+
+  @param  Value   A pointer to the 32-bit value to add to.
+  @param  Addend  The 32-bit value to add.
+
+  @return The original *Value before the addition.
+
+**/
+UINT32
+EFIAPI
+InternalSyncExchangeAdd32 (
+  IN      volatile UINT32  *Value,
+  IN      UINT32           Addend
+  );
+
+/**
+  Performs an atomic exchange operation on a 64-bit unsigned integer.
+
+  Performs an atomic exchange operation on the 64-bit unsigned integer specified by Value,
+  setting it to ExchangeValue and returning its original value. The exchange operation must be
+  performed using MP safe mechanisms.
+
+  @param  Value          A pointer to the 64-bit value for the exchange operation.
+  @param  ExchangeValue  64-bit value used in exchange operation.
+
+  @return The original *Value before exchange.
+
+**/
+UINT64
+EFIAPI
+InternalSyncExchange64 (
+  IN      volatile UINT64  *Value,
+  IN      UINT64           ExchangeValue
+  );
+
 #endif
@@ -0,0 +1,297 @@
+/** @file
+  Implementation of the ticket and MCS locks.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseSynchronizationLibInternals.h"
+
+//
+// Upper bound of the pauses a ticket lock waiter makes between two reads of the lock, so that
+// waiters far back in the queue do not overshoot their turn by much.
+//
+#define TICKET_LOCK_MAX_BACKOFF  64
+
+/**
+  Initializes a ticket lock to the released state.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to initialize.
+
+  @return TicketLock in the released state.
+
+**/
+TICKET_LOCK *
+EFIAPI
+InitializeTicketLock (
+  OUT TICKET_LOCK  *TicketLock
+  )
+{
+  ASSERT (TicketLock != NULL);
+
+  TicketLock->Next    = 0;
+  TicketLock->Serving = 0;
+  MemoryFence ();
+
+  return TicketLock;
+}
+
+/**
+  Waits until all earlier requesters released a ticket lock, then places it in the acquired
+  state.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to acquire.
+
+  @return TicketLock in the acquired state.
+
+**/
+TICKET_LOCK *
+EFIAPI
+AcquireTicketLock (
+  IN OUT TICKET_LOCK  *TicketLock
+  )
+{
+  UINT32  Ticket;
+  UINT32  Ahead;
+  UINT32  Pause;
+
+  ASSERT (TicketLock != NULL);
+
+  Ticket = InternalSyncExchangeAdd32 (&TicketLock->Next, 1);
+  while (TRUE) {
+    Ahead = Ticket - TicketLock->Serving;
+    if (Ahead == 0) {
+      break;
+    }
+
+    //
+    // Each holder ahead needs a while to be done, no point in reading the line before.
+    //
+    for (Pause = MIN (Ahead, TICKET_LOCK_MAX_BACKOFF); Pause > 0; Pause--) {
+      CpuPause ();
+    }
+  }
+
+  MemoryFence ();
+  return TicketLock;
+}
+
+/**
+  Attempts to place a ticket lock in the acquired state, failing if it is held or requested.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to acquire.
+
+  @retval TRUE   TicketLock was placed in the acquired state.
+  @retval FALSE  TicketLock could not be acquired.
+
+**/
+BOOLEAN
+EFIAPI
+AcquireTicketLockOrFail (
+  IN OUT TICKET_LOCK  *TicketLock
+  )
+{
+  UINT32  Serving;
+
+  ASSERT (TicketLock != NULL);
+
+  //
+  // The next ticket is the one being served only when nobody holds or waits for the lock.
+  //
+  Serving = TicketLock->Serving;
+  if (TicketLock->Next != Serving) {
+    return FALSE;
+  }
+
+  return (BOOLEAN)(InternalSyncCompareExchange32 (&TicketLock->Next, Serving, Serving + 1) == Serving);
+}
+
+/**
+  Releases a ticket lock, granting it to the next requester if any.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to release.
+
+  @return TicketLock released.
+
+**/
+TICKET_LOCK *
+EFIAPI
+ReleaseTicketLock (
+  IN OUT TICKET_LOCK  *TicketLock
+  )
+{
+  ASSERT (TicketLock != NULL);
+  ASSERT (TicketLock->Next != TicketLock->Serving);
+
+  //
+  // Only the holder writes Serving, no need for an atomic increment.
+  //
+  MemoryFence ();
+  TicketLock->Serving = TicketLock->Serving + 1;
+  MemoryFence ();
+
+  return TicketLock;
+}
+
+/**
+  Initializes an MCS lock to the released state.
+
+  If McsLock is NULL, then ASSERT().
+
+  @param  McsLock  A pointer to the MCS lock to initialize.
+
+  @return McsLock in the released state.
+
+**/
+MCS_LOCK *
+EFIAPI
+InitializeMcsLock (
+  OUT MCS_LOCK  *McsLock
+  )
+{
+  ASSERT (McsLock != NULL);
+
+  McsLock->Tail = NULL;
+  MemoryFence ();
+
+  return McsLock;
+}
+
+/**
+  Queues a node on an MCS lock, and waits until all earlier nodes released it.
+
+  If McsLock or Node is NULL, then ASSERT().
+
+  @param  McsLock  A pointer to the MCS lock to acquire.
+  @param  Node     The node of the executing CPU, not queued on any lock.
+
+  @return McsLock in the acquired state.
+
+**/
+MCS_LOCK *
+EFIAPI
+AcquireMcsLock (
+  IN OUT MCS_LOCK       *McsLock,
+  IN OUT MCS_LOCK_NODE  *Node
+  )
+{
+  MCS_LOCK_NODE  *Previous;
+
+  ASSERT (McsLock != NULL);
+  ASSERT (Node != NULL);
+
+  Node->Next    = NULL;
+  Node->Waiting = 1;
+  MemoryFence ();
+
+  Previous = (MCS_LOCK_NODE *)(UINTN)InternalSyncExchange64 (
+                                       (volatile UINT64 *)&McsLock->Tail,
+                                       (UINT64)(UINTN)Node
+                                       );
+  if (Previous != NULL) {
+    //
+    // The previous node hands the lock over by clearing Waiting, once it sees this node.
+    //
+    Previous->Next = Node;
+    while (Node->Waiting != 0) {
+      CpuPause ();
+    }
+  }
+
+  MemoryFence ();
+  return McsLock;
+}
+
+/**
+  Attempts to place an MCS lock in the acquired state, failing if it is held.
+
+  If McsLock or Node is NULL, then ASSERT().
+
+  @param  McsLock  A pointer to the MCS lock to acquire.
+  @param  Node     The node of the executing CPU, not queued on any lock.
+
+  @retval TRUE   McsLock was placed in the acquired state, and Node must be passed to
+                 ReleaseMcsLock().
+  @retval FALSE  McsLock could not be acquired.
+
+**/
+BOOLEAN
+EFIAPI
+AcquireMcsLockOrFail (
+  IN OUT MCS_LOCK       *McsLock,
+  IN OUT MCS_LOCK_NODE  *Node
+  )
+{
+  ASSERT (McsLock != NULL);
+  ASSERT (Node != NULL);
+
+  if (McsLock->Tail != NULL) {
+    return FALSE;
+  }
+
+  Node->Next    = NULL;
+  Node->Waiting = 0;
+  MemoryFence ();
+
+  return (BOOLEAN)(InternalSyncCompareExchange64 (
+                     (volatile UINT64 *)&McsLock->Tail,
+                     0,
+                     (UINT64)(UINTN)Node
+                     ) == 0);
+}
+
+/**
+  Releases an MCS lock, granting it to the next queued node if any.
+
+  If McsLock or Node is NULL, then ASSERT().
+
+  @param  McsLock  A pointer to the MCS lock to release.
+  @param  Node     The node the lock was acquired with.
+
+  @return McsLock released.
+
+**/
+MCS_LOCK *
+EFIAPI
+ReleaseMcsLock (
+  IN OUT MCS_LOCK       *McsLock,
+  IN OUT MCS_LOCK_NODE  *Node
+  )
+{
+  ASSERT (McsLock != NULL);
+  ASSERT (Node != NULL);
+  ASSERT (McsLock->Tail != NULL);
+
+  MemoryFence ();
+  if (Node->Next == NULL) {
+    if (InternalSyncCompareExchange64 (
+          (volatile UINT64 *)&McsLock->Tail,
+          (UINT64)(UINTN)Node,
+          0
+          ) == (UINT64)(UINTN)Node)
+    {
+      return McsLock;
+    }
+
+    //
+    // A node got queued behind this one, wait until it links itself.
+    //
+    while (Node->Next == NULL) {
+      CpuPause ();
+    }
+  }
+
+  Node->Next->Waiting = 0;
+  MemoryFence ();
+
+  return McsLock;
+}
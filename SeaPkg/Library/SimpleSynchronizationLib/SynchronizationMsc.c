@@ -28,6 +28,11 @@ _ReadWriteBarrier (
 #define SPIN_LOCK_RELEASED  ((UINTN) 1)
 #define SPIN_LOCK_ACQUIRED  ((UINTN) 2)
 
+//
+// Upper bound of the pauses between two attempts of AcquireSpinLockOrTimeout().
+//
+#define SPIN_LOCK_MAX_BACKOFF  1024
+
 /**
   Retrieves the architecture specific spin lock alignment requirements for
   optimal spin lock performance.
@@ -111,7 +116,12 @@ AcquireSpinLock (
   )
 {
   while (!AcquireSpinLockOrFail (SpinLock)) {
-    CpuPause ();
+    //
+    // Only read the lock until it is released, not to steal its cache line from the holder.
+    //
+    do {
+      CpuPause ();
+    } while (*SpinLock == SPIN_LOCK_ACQUIRED);
   }
 
   return SpinLock;
@@ -159,6 +169,52 @@ AcquireSpinLockOrFail (
   return (BOOLEAN)(Result == (VOID *)SPIN_LOCK_RELEASED);
 }
 
+/**
+  Attempts to place a spin lock in the acquired state, retrying with an exponential backoff.
+
+  Each attempt first reads the lock, and only tries to take it when it is released, so that
+  waiters do not steal its cache line from the holder.
+
+  If SpinLock is NULL, then ASSERT().
+
+  @param  SpinLock     A pointer to the spin lock to place in the acquired state.
+  @param  MaxAttempts  The number of attempts before giving up, 0 to wait indefinitely.
+
+  @retval TRUE   SpinLock was placed in the acquired state.
+  @retval FALSE  SpinLock could not be acquired in MaxAttempts attempts.
+
+**/
+BOOLEAN
+EFIAPI
+AcquireSpinLockOrTimeout (
+  IN OUT  SPIN_LOCK  *SpinLock,
+  IN      UINTN      MaxAttempts
+  )
+{
+  UINTN  Attempt;
+  UINTN  Backoff;
+  UINTN  Pause;
+
+  ASSERT (SpinLock != NULL);
+
+  Backoff = 1;
+  for (Attempt = 1; ; Attempt++) {
+    if ((*SpinLock == SPIN_LOCK_RELEASED) && AcquireSpinLockOrFail (SpinLock)) {
+      return TRUE;
+    }
+
+    if (Attempt == MaxAttempts) {
+      return FALSE;
+    }
+
+    for (Pause = 0; Pause < Backoff; Pause++) {
+      CpuPause ();
+    }
+
+    Backoff = MIN (Backoff * 2, SPIN_LOCK_MAX_BACKOFF);
+  }
+}
+
 /**
   Releases a spin lock.
 
@@ -0,0 +1,631 @@
+/** @file
+  Unit tests of the spin, ticket and MCS locks of SimpleSynchronizationLib.
+
+  Host threads hammer each lock with non-atomic updates of a shared counter, which must neither
+  lose an update nor see two holders at once. The same runs measure the time spent waiting for
+  each kind of lock, as a rough contention benchmark.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/SeaSynchronizationLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "TestThread.h"
+
+#define UNIT_TEST_APP_NAME     "SEA Synchronization Lib Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// At most this many threads contend for a lock. Fair locks hand the lock over to waiters that
+// may not be running when the threads outnumber the processors, so the iterations are cut down
+// in that case not to wait for the scheduler most of the time.
+//
+#define TEST_MAX_THREADS                8
+#define TEST_ITERATIONS                 20000
+#define TEST_ITERATIONS_OVERSUBSCRIBED  500
+
+//
+// Attempts of AcquireSpinLockOrTimeout() under contention, small enough for some to time out.
+//
+#define TEST_TIMEOUT_ATTEMPTS  16
+
+typedef enum {
+  TestLockSpin,
+  TestLockSpinTimeout,
+  TestLockTicket,
+  TestLockMcs,
+  TestLockTypeMax
+} TEST_LOCK_TYPE;
+
+typedef struct {
+  TEST_LOCK_TYPE    Type;
+  CONST CHAR8       *Name;
+} TEST_LOCK_CONTEXT;
+
+typedef struct {
+  MCS_LOCK_NODE     Node;
+  TEST_LOCK_TYPE    Type;
+  UINTN             Iterations;
+  UINTN             Index;
+  UINT64            WaitCycles;
+  UINT64            MaxWaitCycles;
+  UINTN             Timeouts;
+} TEST_WORKER;
+
+TEST_LOCK_CONTEXT  mSpinContext        = { TestLockSpin, "SpinLock" };
+TEST_LOCK_CONTEXT  mSpinTimeoutContext = { TestLockSpinTimeout, "SpinLockOrTimeout" };
+TEST_LOCK_CONTEXT  mTicketContext      = { TestLockTicket, "TicketLock" };
+TEST_LOCK_CONTEXT  mMcsContext         = { TestLockMcs, "McsLock" };
+
+SPIN_LOCK    mSpinLock;
+TICKET_LOCK  mTicketLock;
+MCS_LOCK     mMcsLock;
+
+//
+// State shared by the workers, only updated while holding the lock under test.
+//
+volatile UINT64   mCounter;
+volatile UINT32   mHolders;
+volatile BOOLEAN  mOverlap;
+volatile UINTN    mOrder[TEST_MAX_THREADS];
+volatile UINTN    mOrderCount;
+
+//
+// Released once every worker is started, so that they all contend from the first iteration.
+//
+volatile BOOLEAN  mStart;
+
+/**
+  Place the lock under test in the acquired state.
+
+  @param[in, out] Worker  The worker acquiring the lock.
+
+**/
+VOID
+TestAcquire (
+  IN OUT TEST_WORKER  *Worker
+  )
+{
+  switch (Worker->Type) {
+    case TestLockSpin:
+      AcquireSpinLock (&mSpinLock);
+      break;
+    case TestLockSpinTimeout:
+      while (!AcquireSpinLockOrTimeout (&mSpinLock, TEST_TIMEOUT_ATTEMPTS)) {
+        Worker->Timeouts++;
+      }
+
+      break;
+    case TestLockTicket:
+      AcquireTicketLock (&mTicketLock);
+      break;
+    case TestLockMcs:
+      AcquireMcsLock (&mMcsLock, &Worker->Node);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+  Release the lock under test.
+
+  @param[in, out] Worker  The worker holding the lock.
+
+**/
+VOID
+TestRelease (
+  IN OUT TEST_WORKER  *Worker
+  )
+{
+  switch (Worker->Type) {
+    case TestLockSpin:
+    case TestLockSpinTimeout:
+      ReleaseSpinLock (&mSpinLock);
+      break;
+    case TestLockTicket:
+      ReleaseTicketLock (&mTicketLock);
+      break;
+    case TestLockMcs:
+      ReleaseMcsLock (&mMcsLock, &Worker->Node);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+  Reset the locks and the state shared by the workers.
+
+**/
+VOID
+TestResetLocks (
+  VOID
+  )
+{
+  InitializeSpinLock (&mSpinLock);
+  InitializeTicketLock (&mTicketLock);
+  InitializeMcsLock (&mMcsLock);
+
+  mCounter    = 0;
+  mHolders    = 0;
+  mOverlap    = FALSE;
+  mOrderCount = 0;
+  mStart      = FALSE;
+}
+
+/**
+  Thread entry updating the shared counter under the lock under test.
+
+  The counter is read and written back separately, so that an update made by another holder in
+  between is lost and shows in the final count.
+
+  @param[in] Context  The TEST_WORKER of the thread.
+
+**/
+VOID
+TestWorker (
+  IN VOID  *Context
+  )
+{
+  TEST_WORKER  *Worker;
+  UINTN        Iteration;
+  UINT64       Start;
+  UINT64       Wait;
+  UINT64       Counter;
+
+  Worker = (TEST_WORKER *)Context;
+  while (!mStart) {
+    CpuPause ();
+  }
+
+  for (Iteration = 0; Iteration < Worker->Iterations; Iteration++) {
+    Start = TestThreadReadTsc ();
+    TestAcquire (Worker);
+    Wait = TestThreadReadTsc () - Start;
+
+    if (mHolders++ != 0) {
+      mOverlap = TRUE;
+    }
+
+    Counter = mCounter;
+    CpuPause ();
+    mCounter = Counter + 1;
+
+    if (mOrderCount < TEST_MAX_THREADS) {
+      mOrder[mOrderCount++] = Worker->Index;
+    }
+
+    mHolders--;
+    TestRelease (Worker);
+
+    Worker->WaitCycles   += Wait;
+    Worker->MaxWaitCycles = MAX (Worker->MaxWaitCycles, Wait);
+  }
+}
+
+/**
+  Run workers contending for the lock under test.
+
+  @param[in]  Type        The lock under test.
+  @param[in]  Threads     The number of workers.
+  @param[in]  Iterations  The number of acquisitions of each worker.
+  @param[out] Workers     The workers, holding their measurements once they are done.
+
+  @retval TRUE   All workers ran.
+  @retval FALSE  A thread could not be started.
+
+**/
+BOOLEAN
+TestRunWorkers (
+  IN  TEST_LOCK_TYPE  Type,
+  IN  UINTN           Threads,
+  IN  UINTN           Iterations,
+  OUT TEST_WORKER     *Workers
+  )
+{
+  VOID     *Thread[TEST_MAX_THREADS];
+  UINTN    Index;
+  BOOLEAN  Started;
+
+  TestResetLocks ();
+  ZeroMem (Workers, sizeof (*Workers) * Threads);
+
+  Started = TRUE;
+  for (Index = 0; Index < Threads; Index++) {
+    Workers[Index].Type       = Type;
+    Workers[Index].Iterations = Iterations;
+    Workers[Index].Index      = Index;
+    Thread[Index]             = TestThreadStart (TestWorker, &Workers[Index]);
+    if (Thread[Index] == NULL) {
+      Started = FALSE;
+      break;
+    }
+  }
+
+  mStart = TRUE;
+  while (Index > 0) {
+    TestThreadJoin (Thread[--Index]);
+  }
+
+  return Started;
+}
+
+/**
+  Get the number of workers and iterations of the contention runs.
+
+  @param[out] Threads     The number of workers.
+  @param[out] Iterations  The number of acquisitions of each worker.
+
+**/
+VOID
+TestGetContention (
+  OUT UINTN  *Threads,
+  OUT UINTN  *Iterations
+  )
+{
+  UINTN  Processors;
+
+  Processors  = TestThreadProcessorCount ();
+  *Threads    = MIN (MAX (Processors, 2), TEST_MAX_THREADS);
+  *Iterations = (Processors >= *Threads) ? TEST_ITERATIONS : TEST_ITERATIONS_OVERSUBSCRIBED;
+}
+
+/**
+  Contending threads must never hold the lock together, nor lose an update made under it.
+
+  @param[in]  Context  The TEST_LOCK_CONTEXT of the lock under test.
+
+  @retval UNIT_TEST_PASSED             The unit test has completed and the test
+                                       case was successful.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ContendedLockIsExclusive (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_LOCK_CONTEXT  *LockContext;
+  TEST_WORKER        *Workers;
+  UINTN              Threads;
+  UINTN              Iterations;
+  UINTN              Index;
+  UINT64             WaitCycles;
+  UINT64             MaxWaitCycles;
+  UINTN              Timeouts;
+  BOOLEAN            Started;
+
+  LockContext = (TEST_LOCK_CONTEXT *)Context;
+  TestGetContention (&Threads, &Iterations);
+
+  Workers = AllocateZeroPool (sizeof (*Workers) * TEST_MAX_THREADS);
+  UT_ASSERT_NOT_NULL (Workers);
+
+  Started = TestRunWorkers (LockContext->Type, Threads, Iterations, Workers);
+  if (!Started) {
+    FreePool (Workers);
+    UT_ASSERT_TRUE (Started);
+  }
+
+  WaitCycles    = 0;
+  MaxWaitCycles = 0;
+  Timeouts      = 0;
+  for (Index = 0; Index < Threads; Index++) {
+    WaitCycles   += Workers[Index].WaitCycles;
+    MaxWaitCycles = MAX (MaxWaitCycles, Workers[Index].MaxWaitCycles);
+    Timeouts     += Workers[Index].Timeouts;
+  }
+
+  FreePool (Workers);
+
+  UT_LOG_INFO (
+    "%a: %ld threads x %ld acquisitions, average wait %ld cycles, max wait %ld cycles, %ld timeouts\n",
+    LockContext->Name,
+    Threads,
+    Iterations,
+    WaitCycles / (Threads * Iterations),
+    MaxWaitCycles,
+    Timeouts
+    );
+
+  UT_ASSERT_FALSE (mOverlap);
+  UT_ASSERT_EQUAL (mCounter, Threads * Iterations);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A fair lock must be granted in the order it is requested.
+
+  The test thread holds the lock while the workers queue one after the other, then releases it
+  and checks the order the workers got it in.
+
+  @param[in]  Context  The TEST_LOCK_CONTEXT of the lock under test.
+
+  @retval UNIT_TEST_PASSED             The unit test has completed and the test
+                                       case was successful.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FairLockGrantedInOrder (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_LOCK_CONTEXT  *LockContext;
+  TEST_WORKER        *Workers;
+  TEST_WORKER        Holder;
+  VOID               *Thread[TEST_MAX_THREADS];
+  UINTN              Index;
+  UINTN              Started;
+
+  LockContext = (TEST_LOCK_CONTEXT *)Context;
+
+  Workers = AllocateZeroPool (sizeof (*Workers) * TEST_MAX_THREADS);
+  UT_ASSERT_NOT_NULL (Workers);
+
+  TestResetLocks ();
+  ZeroMem (&Holder, sizeof (Holder));
+  Holder.Type = LockContext->Type;
+  TestAcquire (&Holder);
+
+  mStart = TRUE;
+  for (Started = 0; Started < TEST_MAX_THREADS; Started++) {
+    Workers[Started].Type       = LockContext->Type;
+    Workers[Started].Iterations = 1;
+    Workers[Started].Index      = Started;
+    Thread[Started]             = TestThreadStart (TestWorker, &Workers[Started]);
+    if (Thread[Started] == NULL) {
+      break;
+    }
+
+    //
+    // Wait for the worker to be queued before starting the next one.
+    //
+    if (LockContext->Type == TestLockTicket) {
+      while (mTicketLock.Next != Started + 2) {
+        CpuPause ();
+      }
+    } else {
+      while (mMcsLock.Tail != &Workers[Started].Node) {
+        CpuPause ();
+      }
+    }
+  }
+
+  TestRelease (&Holder);
+  for (Index = Started; Index > 0; Index--) {
+    TestThreadJoin (Thread[Index - 1]);
+  }
+
+  FreePool (Workers);
+
+  UT_ASSERT_EQUAL (Started, TEST_MAX_THREADS);
+  UT_ASSERT_EQUAL (mOrderCount, TEST_MAX_THREADS);
+  for (Index = 0; Index < TEST_MAX_THREADS; Index++) {
+    UT_ASSERT_EQUAL (mOrder[Index], Index);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  AcquireTicketLockOrFail must only succeed on a lock nobody holds, across counter wraps.
+
+  @param[in]  Context  [Optional] An optional parameter that enables:
+                       1) test-case reuse with varied parameters and
+                       2) test-case re-entry for Target tests that need a
+                       reboot.  This parameter is a VOID* and it is the
+                       responsibility of the test author to ensure that the
+                       contents are well understood by all test cases that may
+                       consume it.
+
+  @retval UNIT_TEST_PASSED             The unit test has completed and the test
+                                       case was successful.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TicketLockOrFail (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Round;
+
+  InitializeTicketLock (&mTicketLock);
+
+  //
+  // Start right before the tickets wrap around.
+  //
+  mTicketLock.Next    = MAX_UINT32 - 1;
+  mTicketLock.Serving = MAX_UINT32 - 1;
+
+  for (Round = 0; Round < 4; Round++) {
+    UT_ASSERT_TRUE (AcquireTicketLockOrFail (&mTicketLock));
+    UT_ASSERT_FALSE (AcquireTicketLockOrFail (&mTicketLock));
+    ReleaseTicketLock (&mTicketLock);
+
+    AcquireTicketLock (&mTicketLock);
+    UT_ASSERT_FALSE (AcquireTicketLockOrFail (&mTicketLock));
+    ReleaseTicketLock (&mTicketLock);
+  }
+
+  UT_ASSERT_EQUAL (mTicketLock.Next, mTicketLock.Serving);
+  UT_ASSERT_EQUAL (mTicketLock.Serving, 6);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  AcquireMcsLockOrFail must only succeed on a lock nobody holds, and release must free it.
+
+  @param[in]  Context  [Optional] An optional parameter that enables:
+                       1) test-case reuse with varied parameters and
+                       2) test-case re-entry for Target tests that need a
+                       reboot.  This parameter is a VOID* and it is the
+                       responsibility of the test author to ensure that the
+                       contents are well understood by all test cases that may
+                       consume it.
+
+  @retval UNIT_TEST_PASSED             The unit test has completed and the test
+                                       case was successful.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+McsLockOrFail (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MCS_LOCK_NODE  First;
+  MCS_LOCK_NODE  Second;
+
+  InitializeMcsLock (&mMcsLock);
+
+  UT_ASSERT_TRUE (AcquireMcsLockOrFail (&mMcsLock, &First));
+  UT_ASSERT_FALSE (AcquireMcsLockOrFail (&mMcsLock, &Second));
+  ReleaseMcsLock (&mMcsLock, &First);
+  UT_ASSERT_TRUE (mMcsLock.Tail == NULL);
+
+  AcquireMcsLock (&mMcsLock, &Second);
+  UT_ASSERT_FALSE (AcquireMcsLockOrFail (&mMcsLock, &First));
+  ReleaseMcsLock (&mMcsLock, &Second);
+  UT_ASSERT_TRUE (mMcsLock.Tail == NULL);
+
+  UT_ASSERT_TRUE (AcquireMcsLockOrFail (&mMcsLock, &Second));
+  ReleaseMcsLock (&mMcsLock, &Second);
+  UT_ASSERT_TRUE (mMcsLock.Tail == NULL);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  AcquireSpinLockOrTimeout must give up on a held lock, and take a released one.
+
+  @param[in]  Context  [Optional] An optional parameter that enables:
+                       1) test-case reuse with varied parameters and
+                       2) test-case re-entry for Target tests that need a
+                       reboot.  This parameter is a VOID* and it is the
+                       responsibility of the test author to ensure that the
+                       contents are well understood by all test cases that may
+                       consume it.
+
+  @retval UNIT_TEST_PASSED             The unit test has completed and the test
+                                       case was successful.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SpinLockTimeout (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  InitializeSpinLock (&mSpinLock);
+
+  UT_ASSERT_TRUE (AcquireSpinLockOrTimeout (&mSpinLock, 1));
+  UT_ASSERT_FALSE (AcquireSpinLockOrTimeout (&mSpinLock, 1));
+  UT_ASSERT_FALSE (AcquireSpinLockOrTimeout (&mSpinLock, 64));
+  ReleaseSpinLock (&mSpinLock);
+
+  UT_ASSERT_TRUE (AcquireSpinLockOrTimeout (&mSpinLock, 0));
+  ReleaseSpinLock (&mSpinLock);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  synchronization library and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      LockTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the lock Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&LockTests, Framework, "Lock Tests", "SeaSynchronizationLib.Lock", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for LockTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (LockTests, "Ticket lock try should only take a free lock", "TicketOrFail", TicketLockOrFail, NULL, NULL, NULL);
+  AddTestCase (LockTests, "MCS lock try should only take a free lock", "McsOrFail", McsLockOrFail, NULL, NULL, NULL);
+  AddTestCase (LockTests, "Spin lock acquire should time out on a held lock", "SpinTimeout", SpinLockTimeout, NULL, NULL, NULL);
+  AddTestCase (LockTests, "Ticket lock should be granted in order", "TicketOrder", FairLockGrantedInOrder, NULL, NULL, &mTicketContext);
+  AddTestCase (LockTests, "MCS lock should be granted in order", "McsOrder", FairLockGrantedInOrder, NULL, NULL, &mMcsContext);
+  AddTestCase (LockTests, "Contended spin lock should be exclusive", "SpinStress", ContendedLockIsExclusive, NULL, NULL, &mSpinContext);
+  AddTestCase (LockTests, "Contended spin lock with timeout should be exclusive", "SpinTimeoutStress", ContendedLockIsExclusive, NULL, NULL, &mSpinTimeoutContext);
+  AddTestCase (LockTests, "Contended ticket lock should be exclusive", "TicketStress", ContendedLockIsExclusive, NULL, NULL, &mTicketContext);
+  AddTestCase (LockTests, "Contended MCS lock should be exclusive", "McsStress", ContendedLockIsExclusive, NULL, NULL, &mMcsContext);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,69 @@
+/** @file
+  Minimal host threads for the multithreaded unit tests of SimpleSynchronizationLib.
+
+  The implementations live in their own files, since the host thread headers do not mix with
+  the UEFI ones.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef TEST_THREAD_H_
+#define TEST_THREAD_H_
+
+typedef void (*TEST_THREAD_ENTRY)(
+  void  *Context
+  );
+
+/**
+  Get the number of processors available to the test.
+
+  @return The number of online processors, at least 1.
+
+**/
+unsigned int
+TestThreadProcessorCount (
+  void
+  );
+
+/**
+  Read the time stamp counter of the processor.
+
+  The host BaseLib does not read the real counter, so the waits are timed with this instead.
+
+  @return The current time stamp counter.
+
+**/
+unsigned long long
+TestThreadReadTsc (
+  void
+  );
+
+/**
+  Start a thread.
+
+  @param[in] Entry    The function the thread runs.
+  @param[in] Context  The argument of Entry.
+
+  @return The thread, NULL when it could not be started.
+
+**/
+void *
+TestThreadStart (
+  TEST_THREAD_ENTRY  Entry,
+  void               *Context
+  );
+
+/**
+  Wait for a thread to return, and release it.
+
+  @param[in] Thread  The thread returned by TestThreadStart.
+
+**/
+void
+TestThreadJoin (
+  void  *Thread
+  );
+
+#endif
@@ -0,0 +1,115 @@
+/** @file
+  Minimal host threads for the multithreaded unit tests of SimpleSynchronizationLib, on POSIX.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#include "TestThread.h"
+
+typedef struct {
+  pthread_t            Handle;
+  TEST_THREAD_ENTRY    Entry;
+  void                 *Context;
+} TEST_THREAD;
+
+/**
+  Get the number of processors available to the test.
+
+  @return The number of online processors, at least 1.
+
+**/
+unsigned int
+TestThreadProcessorCount (
+  void
+  )
+{
+  long  Count;
+
+  Count = sysconf (_SC_NPROCESSORS_ONLN);
+  return (Count > 0) ? (unsigned int)Count : 1;
+}
+
+/**
+  Read the time stamp counter of the processor.
+
+  @return The current time stamp counter.
+
+**/
+unsigned long long
+TestThreadReadTsc (
+  void
+  )
+{
+  return __rdtsc ();
+}
+
+/**
+  Adapt a TEST_THREAD_ENTRY to the pthread entry prototype.
+
+  @param[in] Thread  The TEST_THREAD being started.
+
+  @return NULL.
+
+**/
+static void *
+TestThreadRun (
+  void  *Thread
+  )
+{
+  ((TEST_THREAD *)Thread)->Entry (((TEST_THREAD *)Thread)->Context);
+  return NULL;
+}
+
+/**
+  Start a thread.
+
+  @param[in] Entry    The function the thread runs.
+  @param[in] Context  The argument of Entry.
+
+  @return The thread, NULL when it could not be started.
+
+**/
+void *
+TestThreadStart (
+  TEST_THREAD_ENTRY  Entry,
+  void               *Context
+  )
+{
+  TEST_THREAD  *Thread;
+
+  Thread = malloc (sizeof (*Thread));
+  if (Thread == NULL) {
+    return NULL;
+  }
+
+  Thread->Entry   = Entry;
+  Thread->Context = Context;
+  if (pthread_create (&Thread->Handle, NULL, TestThreadRun, Thread) != 0) {
+    free (Thread);
+    return NULL;
+  }
+
+  return Thread;
+}
+
+/**
+  Wait for a thread to return, and release it.
+
+  @param[in] Thread  The thread returned by TestThreadStart.
+
+**/
+void
+TestThreadJoin (
+  void  *Thread
+  )
+{
+  pthread_join (((TEST_THREAD *)Thread)->Handle, NULL);
+  free (Thread);
+}
@@ -0,0 +1,116 @@
+/** @file
+  Minimal host threads for the multithreaded unit tests of SimpleSynchronizationLib, on Windows.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <windows.h>
+#include <stdlib.h>
+#include <intrin.h>
+
+#include "TestThread.h"
+
+typedef struct {
+  HANDLE               Handle;
+  TEST_THREAD_ENTRY    Entry;
+  void                 *Context;
+} TEST_THREAD;
+
+/**
+  Get the number of processors available to the test.
+
+  @return The number of online processors, at least 1.
+
+**/
+unsigned int
+TestThreadProcessorCount (
+  void
+  )
+{
+  SYSTEM_INFO  Info;
+
+  GetSystemInfo (&Info);
+  return (Info.dwNumberOfProcessors > 0) ? Info.dwNumberOfProcessors : 1;
+}
+
+/**
+  Read the time stamp counter of the processor.
+
+  @return The current time stamp counter.
+
+**/
+unsigned long long
+TestThreadReadTsc (
+  void
+  )
+{
+  return __rdtsc ();
+}
+
+/**
+  Adapt a TEST_THREAD_ENTRY to the Windows thread entry prototype.
+
+  @param[in] Thread  The TEST_THREAD being started.
+
+  @return 0.
+
+**/
+static DWORD WINAPI
+TestThreadRun (
+  LPVOID  Thread
+  )
+{
+  ((TEST_THREAD *)Thread)->Entry (((TEST_THREAD *)Thread)->Context);
+  return 0;
+}
+
+/**
+  Start a thread.
+
+  @param[in] Entry    The function the thread runs.
+  @param[in] Context  The argument of Entry.
+
+  @return The thread, NULL when it could not be started.
+
+**/
+void *
+TestThreadStart (
+  TEST_THREAD_ENTRY  Entry,
+  void               *Context
+  )
+{
+  TEST_THREAD  *Thread;
+
+  Thread = malloc (sizeof (*Thread));
+  if (Thread == NULL) {
+    return NULL;
+  }
+
+  Thread->Entry   = Entry;
+  Thread->Context = Context;
+  Thread->Handle  = CreateThread (NULL, 0, TestThreadRun, Thread, 0, NULL);
+  if (Thread->Handle == NULL) {
+    free (Thread);
+    return NULL;
+  }
+
+  return Thread;
+}
+
+/**
+  Wait for a thread to return, and release it.
+
+  @param[in] Thread  The thread returned by TestThreadStart.
+
+**/
+void
+TestThreadJoin (
+  void  *Thread
+  )
+{
+  WaitForSingleObject (((TEST_THREAD *)Thread)->Handle, INFINITE);
+  CloseHandle (((TEST_THREAD *)Thread)->Handle);
+  free (Thread);
+}
@@ -163,3 +163,72 @@ InternalSyncCompareExchange64 (
 
   return CompareValue;
 }
+
+/**
+  Performs an atomic addition to a 32-bit unsigned integer.
+
+  Performs an atomic addition of Addend to the 32-bit unsigned integer specified by Value and
+  returns the value before the addition. The addition must be performed using MP safe
+  mechanisms.
+
+  @param  Value   A pointer to the 32-bit value to add to.
+  @param  Addend  The 32-bit value to add.
+
+  @return The original *Value before the addition.
+
+**/
+UINT32
+EFIAPI
+InternalSyncExchangeAdd32 (
+  IN OUT volatile  UINT32  *Value,
+  IN      UINT32           Addend
+  )
+{
+  __asm__ __volatile__ (
+    "lock                 \n\t"
+    "xaddl       %0, %1       "
+    : "=r" (Addend),          // %0
+      "=m" (*Value)           // %1
+    : "0"  (Addend),          // %2
+      "m"  (*Value)
+    : "memory",
+      "cc"
+  );
+
+  return Addend;
+}
+
+/**
+  Performs an atomic exchange operation on a 64-bit unsigned integer.
+
+  Performs an atomic exchange operation on the 64-bit unsigned integer specified by Value,
+  setting it to ExchangeValue and returning its original value. The exchange operation must be
+  performed using MP safe mechanisms.
+
+  @param  Value          A pointer to the 64-bit value for the exchange operation.
+  @param  ExchangeValue  64-bit value used in exchange operation.
+
+  @return The original *Value before exchange.
+
+**/
+UINT64
+EFIAPI
+InternalSyncExchange64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           ExchangeValue
+  )
+{
+  //
+  // XCHG with a memory operand is implicitly locked.
+  //
+  __asm__ __volatile__ (
+    "xchgq       %0, %1       "
+    : "=r" (ExchangeValue),   // %0
+      "=m" (*Value)           // %1
+    : "0"  (ExchangeValue),   // %2
+      "m"  (*Value)
+    : "memory"
+  );
+
+  return ExchangeValue;
+}
@@ -0,0 +1,42 @@
+/** @file
+  InterlockedExchange64 function
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+/**
+  Microsoft Visual Studio 7.1 Function Prototypes for I/O Intrinsics.
+**/
+
+__int64
+_InterlockedExchange64 (
+  __int64 volatile  *Target,
+  __int64           Value
+  );
+
+#pragma intrinsic(_InterlockedExchange64)
+
+/**
+  Performs an atomic exchange operation on a 64-bit unsigned integer.
+
+  Performs an atomic exchange operation on the 64-bit unsigned integer specified by Value,
+  setting it to ExchangeValue and returning its original value. The exchange operation must be
+  performed using MP safe mechanisms.
+
+  @param  Value          A pointer to the 64-bit value for the exchange operation.
+  @param  ExchangeValue  64-bit value used in exchange operation.
+
+  @return The original *Value before exchange.
+
+**/
+UINT64
+EFIAPI
+InternalSyncExchange64 (
+  IN      UINT64  *Value,
+  IN      UINT64  ExchangeValue
+  )
+{
+  return _InterlockedExchange64 (Value, ExchangeValue);
+}
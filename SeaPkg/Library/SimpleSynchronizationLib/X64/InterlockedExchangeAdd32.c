@@ -0,0 +1,42 @@
+/** @file
+  InterlockedExchangeAdd32 function
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+/**
+  Microsoft Visual Studio 7.1 Function Prototypes for I/O Intrinsics.
+**/
+
+long
+_InterlockedExchangeAdd (
+  long volatile  *Addend,
+  long           Value
+  );
+
+#pragma intrinsic(_InterlockedExchangeAdd)
+
+/**
+  Performs an atomic addition to a 32-bit unsigned integer.
+
+  Performs an atomic addition of Addend to the 32-bit unsigned integer specified by Value and
+  returns the value before the addition. The addition must be performed using MP safe
+  mechanisms.
+
+  @param  Value   A pointer to the 32-bit value to add to.
+  @param  Addend  The 32-bit value to add.
+
+  @return The original *Value before the addition.
+
+**/
+UINT32
+EFIAPI
+InternalSyncExchangeAdd32 (
+  IN      UINT32  *Value,
+  IN      UINT32  Addend
+  )
+{
+  return (UINT32)_InterlockedExchangeAdd ((long *)Value, (long)Addend);
+}
@@ -0,0 +1,37 @@
+//! Benchmarks for the symbol lookups performed by [PdbMetadata] when building the coverage report.
+//!
+//! ## License
+//!
+//! Copyright (c) Microsoft Corporation.
+//!
+//! SPDX-License-Identifier: BSD-2-Clause-Patent
+
+use auxfile::prelude::*;
+use criterion::{black_box, criterion_group, criterion_main, Criterion};
+
+const PDB: &[u8] = include_bytes!("../resources/test/example.pdb");
+const EFI: &[u8] = include_bytes!("../resources/test/example.efi");
+
+fn bench_metadata(c: &mut Criterion) {
+    c.bench_function("PdbMetadata::new", |b| {
+        b.iter(|| PdbMetadata::new(black_box(PDB), black_box(EFI)).unwrap())
+    });
+
+    let mut metadata = PdbMetadata::new(PDB, EFI).unwrap();
+    let image_size = metadata.image_size() as u32;
+
+    c.bench_function("symbol_from_address (every byte)", |b| {
+        b.iter(|| {
+            (0..image_size)
+                .filter(|address| metadata.symbol_from_address(black_box(address)).is_some())
+                .count()
+        })
+    });
+
+    c.bench_function("Coverage::build (empty aux file)", |b| {
+        b.iter(|| Coverage::build(&AuxFile::default(), &mut metadata).unwrap())
+    });
+}
+
+criterion_group!(benches, bench_metadata);
+criterion_main!(benches);
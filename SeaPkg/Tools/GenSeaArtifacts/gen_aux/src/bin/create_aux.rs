@@ -1,35 +1,83 @@
-use std::{fs::File, path::PathBuf};
+use std::{
+    fs::File,
+    path::{Path, PathBuf},
+};
 
 use anyhow::Result;
 use clap::Parser;
+use rayon::prelude::*;
+use serde::Deserialize;
 
 use auxfile::prelude::*;
 
 #[derive(Parser, Debug)]
 struct Args {
     /// Path to the PDB file to parse.
-    #[arg(short, long)]
-    pdb: PathBuf,
+    #[arg(short, long, required_unless_present = "batch")]
+    pdb: Option<PathBuf>,
     /// Path to the efi file to parse.
-    #[arg(short, long)]
-    efi: PathBuf,
+    #[arg(short, long, required_unless_present = "batch")]
+    efi: Option<PathBuf>,
     /// Path to the output auxiliary file.
     #[arg(short, long)]
     output: Option<PathBuf>,
     /// Path to the config file to read (or write to if generating a config).
-    #[arg(short, long)]
-    config: PathBuf,
+    #[arg(short, long, required_unless_present = "batch")]
+    config: Option<PathBuf>,
     /// A list of scopes to include in the auxiliary file. Rules without scopes
     /// are always applied. Rules with scopes are only applied if the scope is
     /// also provided via this argument.
     #[arg(short, long = "scope")]
     scopes: Vec<String>,
+    /// Path to a batch file listing multiple images to generate auxiliary files
+    /// for in parallel. Cannot be combined with the single image arguments.
+    #[arg(short, long, conflicts_with_all = ["pdb", "efi", "output", "config", "scopes"])]
+    batch: Option<PathBuf>,
     /// Verbosity level. Can be used multiple times for increased verbosity.
     /// 0 = error, 1 = info, 2 = debug, 3 = trace.
     #[arg(short, long, action = clap::ArgAction::Count)]
     verbose: u8,
 }
 
+/// A batch file listing the images to generate auxiliary files for.
+#[derive(Deserialize, Debug)]
+#[serde(deny_unknown_fields)]
+struct BatchFile {
+    #[serde(rename = "image")]
+    images: Vec<Image>,
+}
+
+impl BatchFile {
+    /// Reads a batch file. Relative paths in the batch file are relative to the batch file itself.
+    fn from_file(path: &Path) -> Result<Self> {
+        let contents = std::fs::read_to_string(path)?;
+        let mut batch: BatchFile = toml::from_str(contents.as_str())?;
+
+        let base = path.parent().unwrap_or(Path::new(""));
+        for image in batch.images.iter_mut() {
+            image.pdb = base.join(&image.pdb);
+            image.efi = base.join(&image.efi);
+            image.config = base.join(&image.config);
+            image.output = image.output.as_ref().map(|output| base.join(output));
+        }
+
+        Ok(batch)
+    }
+}
+
+/// The inputs and output used to generate a single auxiliary file.
+#[derive(Deserialize, Debug)]
+#[serde(deny_unknown_fields)]
+struct Image {
+    pdb: PathBuf,
+    efi: PathBuf,
+    #[serde(default)]
+    output: Option<PathBuf>,
+    config: PathBuf,
+    #[serde(default, rename = "scope")]
+    scopes: Vec<String>,
+}
+
 fn main() -> Result<()> {
     let args = Args::parse();
 
@@ -42,10 +90,46 @@ fn main() -> Result<()> {
 
     simple_logger::init_with_level(level)?;
 
-    let mut metadata = PdbMetadata::<File>::new(args.pdb, args.efi.clone())?;
+    let Some(batch) = args.batch else {
+        return generate(&Image {
+            pdb: args.pdb.unwrap(),
+            efi: args.efi.unwrap(),
+            output: args.output,
+            config: args.config.unwrap(),
+            scopes: args.scopes,
+        });
+    };
+
+    // Each image is independent, so they are generated in parallel. Failures are reported in the order the images
+    // are listed in the batch file.
+    let images = BatchFile::from_file(&batch)?.images;
+    let results = images.par_iter().map(generate).collect::<Vec<_>>();
+
+    let mut failed = 0;
+    for (image, result) in images.iter().zip(results) {
+        if let Err(err) = result {
+            log::error!("{}: {:#}", image.efi.display(), err);
+            failed += 1;
+        }
+    }
+
+    if failed != 0 {
+        return Err(anyhow::anyhow!(
+            "Failed to generate {} of {} auxiliary files. See the log for details.",
+            failed,
+            images.len()
+        ));
+    }
+
+    Ok(())
+}
 
-    let mut config: ConfigFile = ConfigFile::from_file(args.config)?;
-    config.filter_by_scopes(&args.scopes)?;
+/// Generates the auxiliary file and coverage report for a single image.
+fn generate(image: &Image) -> Result<()> {
+    let mut metadata = PdbMetadata::<File>::new(image.pdb.clone(), image.efi.clone())?;
+
+    let mut config: ConfigFile = ConfigFile::from_file(&image.config)?;
+    config.filter_by_scopes(&image.scopes)?;
 
     let mut aux = AuxFile::default();
 
@@ -54,10 +138,8 @@ fn main() -> Result<()> {
         aux.add_key_symbol(key_symbol);
     }
 
-    for rule in config.rules.iter() {
-        for (entry, default) in metadata.build_entries(rule)? {
-            aux.add_entry(entry, &default);
-        }
+    for (entry, default) in metadata.build_entries_for_rules(&config.rules)? {
+        aux.add_entry(entry, &default);
     }
 
     aux.finalize();
@@ -83,7 +165,10 @@ fn main() -> Result<()> {
         }
     }
 
-    let output = args.output.unwrap_or(args.efi.with_extension("aux"));
+    let output = image
+        .output
+        .clone()
+        .unwrap_or(image.efi.with_extension("aux"));
     aux.to_file(&output)?;
     report.to_file(PathBuf::from(&output.with_extension("json")))?;
     Ok(())
@@ -17,10 +17,18 @@ pub struct AuxFile {
     /// a list of KEY_SYMBOL C structs to be written to the aux file.
     pub key_symbols: Vec<KeySymbol>,
     /// A list of IMAGE_VALIDATION_ENTRY_HEADER's or derivations of it based on
-    /// the validation_type field.
+    /// the validation_type field. Sorted by offset once the file is finalized.
     pub entries: Vec<ImageValidationEntryHeader>,
-    /// The raw data containing the default values of symbols that have rules.
+    /// The entries as they are written to the aux file. This is [Self::entries]
+    /// sorted by offset, with adjacent [ValidationType::None] entries coalesced
+    /// into a single entry. Populated by [Self::finalize].
+    pub runs: Vec<ImageValidationEntryHeader>,
+    /// The raw data containing the default values of the entries in [Self::runs].
+    /// Populated by [Self::finalize].
     pub raw_data: Vec<u8>,
+    /// The default value of each entry in [Self::entries], or None if the memory
+    /// range should be zeroed instead.
+    defaults: Vec<Option<Vec<u8>>>,
 }
 
 impl AuxFile {
@@ -37,11 +45,12 @@ impl AuxFile {
         if raw_data.iter().all(|&b| b == 0) {
             entry.offset_to_default = u32::MAX; // Indicate that we want to zero the memory.
             self.entries.push(entry);
+            self.defaults.push(None);
             return;
         }
 
         self.entries.push(entry);
-        self.raw_data.extend_from_slice(raw_data);
+        self.defaults.push(Some(raw_data.to_vec()));
     }
 
     /// Adds a key symbol to the aux file.
@@ -50,6 +59,12 @@ impl AuxFile {
     }
 
     /// Finalizes the aux file by calculating and setting valid offsets and sizes throughout the file.
+    ///
+    /// Entries are sorted by offset and adjacent [ValidationType::None] entries that either both
+    /// zero their memory range or both copy a default value are coalesced into a single run. When
+    /// no two entries overlap, the header is marked with [IMAGE_VALIDATION_DATA_FLAG_SORTED] so the
+    /// firmware can restore the image in a single sequential sweep. Overlapping entries are left
+    /// unmarked, as the firmware rejects an overlap in a sorted file.
     pub fn finalize(&mut self) {
         // Reset values if we want to reuse the aux file.
         self.header = ImageValidationDataHeader::default();
@@ -64,36 +79,82 @@ impl AuxFile {
             self.header.offset_to_first_key_symbol = size_of::<ImageValidationDataHeader>() as u32;
         }
 
-        let mut offset_to_default = size_of::<ImageValidationDataHeader>() as u32
+        // A stable sort keeps entries that share an offset in the order they were added.
+        let mut pairs = std::mem::take(&mut self.entries)
+            .into_iter()
+            .zip(std::mem::take(&mut self.defaults))
+            .collect::<Vec<_>>();
+        pairs.sort_by_key(|(entry, _)| entry.offset);
+
+        let disjoint = pairs
+            .windows(2)
+            .all(|w| w[0].0.offset as u64 + w[0].0.size as u64 <= w[1].0.offset as u64);
+        if disjoint {
+            self.header.flags |= IMAGE_VALIDATION_DATA_FLAG_SORTED;
+        } else {
+            log::warn!("Validation entries overlap, the aux file will not be marked as sorted.");
+        }
+
+        // Coalesce adjacent entries into the runs that are written to the aux file, tracking which
+        // run each entry ended up in so the entry's offset_to_default can be updated below.
+        let mut runs: Vec<(ImageValidationEntryHeader, Option<Vec<u8>>)> = Vec::new();
+        let mut run_index = Vec::with_capacity(pairs.len());
+        for (entry, default) in pairs.iter() {
+            if let Some((run, run_default)) = runs.last_mut() {
+                if run.can_coalesce(entry) && run_default.is_some() == default.is_some() {
+                    run.size += entry.size;
+                    if let (Some(run_default), Some(default)) = (run_default, default) {
+                        run_default.extend_from_slice(default);
+                    }
+                    run_index.push(runs.len() - 1);
+                    continue;
+                }
+            }
+
+            let run = ImageValidationEntryHeader {
+                signature: entry.signature,
+                offset: entry.offset,
+                size: entry.size,
+                validation_type: entry.validation_type.clone(),
+                offset_to_default: entry.offset_to_default,
+            };
+            runs.push((run, default.clone()));
+            run_index.push(runs.len() - 1);
+        }
+
+        let offset_to_first_default = size_of::<ImageValidationDataHeader>() as u32
             + self.key_symbols.len() as u32 * 8
-            + self
-                .entries
-                .iter()
-                .fold(0, |acc, entry| acc + entry.header_size());
+            + runs.iter().fold(0, |acc, (run, _)| acc + run.header_size());
 
-        for entry in self.entries.iter_mut() {
-            self.header.size += entry.header_size();
+        let mut offset_to_default = offset_to_first_default;
+        self.raw_data.clear();
+        for (run, default) in runs.iter_mut() {
+            self.header.size += run.header_size();
             self.header.entry_count += 1;
 
-            // If the offset_to_default is u32::MAX, it means we are zeroing the memory instead of
-            // copying it from the aux file, so we leave it as u32::MAX. The u32::MAX value is set when
-            // the rule is added to this struct [Self::add_entry].
-            if entry.offset_to_default != u32::MAX {
-                entry.offset_to_default = offset_to_default;
-                offset_to_default += entry.size;
-                self.header.size += entry.size;
+            // If there is no default, we are zeroing the memory instead of copying it from the aux
+            // file, so offset_to_default is u32::MAX. See [Self::add_entry].
+            match default {
+                Some(default) => {
+                    run.offset_to_default = offset_to_default;
+                    offset_to_default += run.size;
+                    self.header.size += run.size;
+                    self.raw_data.extend_from_slice(default);
+                }
+                None => run.offset_to_default = u32::MAX,
             }
         }
 
-        // Now that all entries have been added, we can calculate the offset to
-        // the raw data, and update the offset_to_default field in each entry.
-        let offset_to_first_default = size_of::<ImageValidationDataHeader>() as u32
-            + self
-                .entries
-                .iter()
-                .fold(0, |acc, entry| acc + entry.header_size())
-            + self.key_symbols.len() as u32 * 8;
+        // Point each entry at its default value inside of the run it was coalesced into.
+        for ((entry, default), index) in pairs.iter_mut().zip(run_index) {
+            let run = &runs[index].0;
+            if default.is_some() {
+                entry.offset_to_default = run.offset_to_default + (entry.offset - run.offset);
+            }
+        }
 
+        (self.entries, self.defaults) = pairs.into_iter().unzip();
+        self.runs = runs.into_iter().map(|(run, _)| run).collect();
         self.header.offset_to_first_default = offset_to_first_default;
     }
 
@@ -124,8 +185,8 @@ impl TryIntoCtx<Endian> for &AuxFile {
             this.gwrite_with(key_symbol, &mut offset, ctx)?;
         }
 
-        for entry in &self.entries {
-            this.gwrite_with(entry, &mut offset, ctx)?;
+        for run in &self.runs {
+            this.gwrite_with(run, &mut offset, ctx)?;
         }
 
         this.gwrite_with(self.raw_data.as_slice(), &mut offset, ())?;
@@ -134,6 +195,10 @@ impl TryIntoCtx<Endian> for &AuxFile {
     }
 }
 
+/// Set in [ImageValidationDataHeader] flags when the entries are sorted by offset and do not
+/// overlap, allowing the firmware to restore the image in a single sequential sweep.
+pub const IMAGE_VALIDATION_DATA_FLAG_SORTED: u32 = 0x00000001;
+
 /// A struct representing the header of the aux file.
 #[derive(Debug, Pwrite)]
 pub struct ImageValidationDataHeader {
@@ -152,18 +217,21 @@ pub struct ImageValidationDataHeader {
     key_symbol_count: u32,
     /// The offset to the first key_sybol in the aux file.
     offset_to_first_key_symbol: u32,
+    /// IMAGE_VALIDATION_DATA_FLAG_* values describing the layout of the aux file.
+    flags: u32,
 }
 
 impl Default for ImageValidationDataHeader {
     fn default() -> Self {
         ImageValidationDataHeader {
             signature: 0x444C4156,
-            size: 28,
+            size: size_of::<Self>() as u32,
             entry_count: 0,
             offset_to_first_entry: size_of::<Self>() as u32,
             offset_to_first_default: 0,
             key_symbol_count: 0,
             offset_to_first_key_symbol: 0,
+            flags: 0,
         }
     }
 }
@@ -225,6 +293,16 @@ impl ImageValidationEntryHeader {
             ValidationType::Pointer { .. } => 4,
         }
     }
+
+    /// Returns true if `next` starts where this entry ends and both entries can be merged into a
+    /// single entry without changing what the firmware validates. Only [ValidationType::None]
+    /// entries are merged, as every other validation type checks the exact range of its symbol.
+    fn can_coalesce(&self, next: &ImageValidationEntryHeader) -> bool {
+        self.validation_type == ValidationType::None
+            && next.validation_type == ValidationType::None
+            && self.signature == next.signature
+            && self.offset.checked_add(self.size) == Some(next.offset)
+    }
 }
 
 impl Debug for ImageValidationEntryHeader {
@@ -276,7 +354,7 @@ impl TryIntoCtx<Endian> for &ImageValidationEntryHeader {
 /// Ref - IMAGE_VALIDATION_SELF_REF
 /// Pointer - IMAGE_VALIDATION_ENTRY_HEADER
 ///
-#[derive(Debug, Default, PartialEq)]
+#[derive(Debug, Default, Clone, PartialEq)]
 #[non_exhaustive]
 #[allow(non_camel_case_types)]
 #[repr(u32)]
@@ -654,16 +732,16 @@ mod tests {
             size_of::<ImageValidationDataHeader>() as u32
         );
         assert_eq!(aux_file.header.entry_count, 1);
-        assert_eq!(aux_file.header.offset_to_first_entry, 0x24);
-        assert_eq!(aux_file.entries[0].offset_to_default, 0x38);
+        assert_eq!(aux_file.header.offset_to_first_entry, 0x28);
+        assert_eq!(aux_file.entries[0].offset_to_default, 0x3C);
 
         // Add a new key symbol to ensure we calculate the offsets correctly
         let new_key_symbol = KeySymbol::new(['E', 'F', 'G', 'H'], 0x2000);
         aux_file.add_key_symbol(new_key_symbol);
         aux_file.finalize();
 
-        assert_eq!(aux_file.header.offset_to_first_entry, 0x2C);
-        assert_eq!(aux_file.header.offset_to_first_default, 0x40);
+        assert_eq!(aux_file.header.offset_to_first_entry, 0x30);
+        assert_eq!(aux_file.header.offset_to_first_default, 0x44);
 
         // Add a new entry to ensure we calculate the offsets correctly
         let entry = ImageValidationEntryHeader {
@@ -677,11 +755,93 @@ mod tests {
         aux_file.add_entry(entry, &[0x01; 32]);
         aux_file.finalize();
 
-        assert_eq!(aux_file.header.offset_to_first_entry, 0x2C);
-        assert_eq!(aux_file.header.offset_to_first_default, 0x54);
+        assert_eq!(aux_file.header.offset_to_first_entry, 0x30);
+        assert_eq!(aux_file.header.offset_to_first_default, 0x58);
+
+        assert_eq!(aux_file.entries[0].offset_to_default, 0x58);
+        assert_eq!(aux_file.entries[1].offset_to_default, 0x78);
+    }
+
+    #[test]
+    fn test_aux_file_finalize_sorts_and_coalesces() {
+        let mut aux_file = AuxFile::default();
+        let entry = |offset, size, validation_type| ImageValidationEntryHeader {
+            offset,
+            size,
+            validation_type,
+            ..Default::default()
+        };
+
+        // Added out of order to verify the entries are sorted by offset.
+        aux_file.add_entry(entry(0x1008, 4, ValidationType::None), &[0x03; 4]);
+        aux_file.add_entry(entry(0x1000, 4, ValidationType::None), &[0x01; 4]);
+        aux_file.add_entry(entry(0x1004, 4, ValidationType::None), &[0x02; 4]);
+        aux_file.add_entry(entry(0x100C, 4, ValidationType::None), &[0x00; 4]);
+        aux_file.add_entry(entry(0x1010, 4, ValidationType::None), &[0x00; 4]);
+        aux_file.add_entry(entry(0x1014, 4, ValidationType::NonZero), &[0x04; 4]);
+        aux_file.add_entry(entry(0x1018, 4, ValidationType::None), &[0x05; 4]);
+        aux_file.finalize();
+
+        assert_eq!(aux_file.header.flags, IMAGE_VALIDATION_DATA_FLAG_SORTED);
+        assert_eq!(aux_file.entries.len(), 7);
+        assert!(aux_file
+            .entries
+            .windows(2)
+            .all(|w| w[0].offset < w[1].offset));
+
+        // [0x1000, 0x100C) copy, [0x100C, 0x1014) zero, NonZero and the trailing None entry
+        // remain separate.
+        assert_eq!(aux_file.header.entry_count, 4);
+        assert_eq!(aux_file.runs[0].offset, 0x1000);
+        assert_eq!(aux_file.runs[0].size, 0xC);
+        assert_eq!(aux_file.runs[1].offset, 0x100C);
+        assert_eq!(aux_file.runs[1].size, 0x8);
+        assert_eq!(aux_file.runs[1].offset_to_default, u32::MAX);
+        assert_eq!(aux_file.runs[2].validation_type, ValidationType::NonZero);
+        assert_eq!(aux_file.runs[3].offset, 0x1018);
+
+        let first_default = aux_file.header.offset_to_first_default;
+        assert_eq!(aux_file.runs[0].offset_to_default, first_default);
+        assert_eq!(aux_file.runs[2].offset_to_default, first_default + 0xC);
+        assert_eq!(aux_file.runs[3].offset_to_default, first_default + 0x10);
+        assert_eq!(
+            aux_file.raw_data,
+            [[0x01; 4], [0x02; 4], [0x03; 4], [0x04; 4], [0x05; 4]].concat()
+        );
+
+        // Each entry points at its own default value inside of the run it was coalesced into.
+        assert_eq!(aux_file.entries[1].offset_to_default, first_default + 4);
+        assert_eq!(aux_file.entries[2].offset_to_default, first_default + 8);
+        assert_eq!(aux_file.entries[4].offset_to_default, u32::MAX);
+
+        let bytes = aux_file
+            .to_bytes()
+            .expect("Failed to convert aux file to bytes");
+        assert_eq!(bytes.len(), aux_file.header.size as usize);
+        let start = first_default as usize;
+        assert_eq!(&bytes[start..], aux_file.raw_data.as_slice());
+    }
+
+    #[test]
+    fn test_aux_file_finalize_overlap_is_not_sorted() {
+        let mut aux_file = AuxFile::default();
+        let entry = |offset, size| ImageValidationEntryHeader {
+            offset,
+            size,
+            validation_type: ValidationType::NonZero,
+            ..Default::default()
+        };
+
+        aux_file.add_entry(entry(0x1000, 8), &[0x01; 8]);
+        aux_file.add_entry(entry(0x1008, 4), &[0x02; 4]);
+        aux_file.finalize();
+        assert_eq!(aux_file.header.flags, IMAGE_VALIDATION_DATA_FLAG_SORTED);
 
-        assert_eq!(aux_file.entries[0].offset_to_default, 0x54);
-        assert_eq!(aux_file.entries[1].offset_to_default, 0x74);
+        // [0x1004, 0x1008) is validated by two entries, which the sorted sweep can not restore.
+        aux_file.add_entry(entry(0x1004, 4), &[0x03; 4]);
+        aux_file.finalize();
+        assert_eq!(aux_file.header.flags & IMAGE_VALIDATION_DATA_FLAG_SORTED, 0);
+        assert_eq!(aux_file.header.entry_count, 3);
     }
 
     #[test]
@@ -707,12 +867,13 @@ mod tests {
             .expect("Failed to convert aux file to bytes");
         let expected = vec![
             0x56, 0x41, 0x4C, 0x44, // signature
-            0x3C, 0x00, 0x00, 0x00, // size
+            0x40, 0x00, 0x00, 0x00, // size
             0x01, 0x00, 0x00, 0x00, // entry_count
-            0x24, 0x00, 0x00, 0x00, // offset_to_first_entry
-            0x38, 0x00, 0x00, 0x00, // offset_to_first_default
+            0x28, 0x00, 0x00, 0x00, // offset_to_first_entry
+            0x3C, 0x00, 0x00, 0x00, // offset_to_first_default
             0x01, 0x00, 0x00, 0x00, // key_symbol_count
-            0x1C, 0x00, 0x00, 0x00, // offset_to_first_key_symbol
+            0x20, 0x00, 0x00, 0x00, // offset_to_first_key_symbol
+            0x01, 0x00, 0x00, 0x00, // flags (sorted)
             // KeySymbol data
             0x41, 0x42, 0x43, 0x44, // KeySymbol signature (ABCD)
             0x00, 0x10, 0x00, 0x00, // KeySymbol offset
@@ -721,7 +882,7 @@ mod tests {
             0x00, 0x10, 0x00, 0x00, // offset
             0x04, 0x00, 0x00, 0x00, // size
             0x01, 0x00, 0x00, 0x00, // validation_type (NonZero)
-            0x38, 0x00, 0x00, 0x00, // offset_to_default
+            0x3C, 0x00, 0x00, 0x00, // offset_to_default
             // Default value data
             0xff, 0xff, 0xff, 0xff,
         ];
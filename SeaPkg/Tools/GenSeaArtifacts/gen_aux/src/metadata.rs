@@ -8,13 +8,21 @@
 //! Copyright (c) Microsoft Corporation.
 //!
 //! SPDX-License-Identifier: BSD-2-Clause-Patent
-use std::{collections::HashMap, fmt::Formatter, fs::File, io::Cursor, ops::Range, path::PathBuf};
+use std::{
+    collections::{hash_map::Entry, BTreeSet, HashMap},
+    fmt::Formatter,
+    fs::File,
+    io::Cursor,
+    ops::Range,
+    path::PathBuf,
+};
 
 use anyhow::{anyhow, Result};
 use pdb::{
-    AddressMap, DataSymbol, FallibleIterator, Item, PrimitiveKind, Source, TypeData, TypeIndex,
-    TypeInformation, PDB,
+    AddressMap, DataSymbol, FallibleIterator, Item, PrimitiveKind, Source, TypeData, TypeFinder,
+    TypeIndex, TypeInformation, PDB,
 };
+use rayon::prelude::*;
 
 use crate::{config, file, report};
 
@@ -43,6 +51,7 @@ impl Context {
 pub struct PdbMetadata<'a, S: Source<'a>> {
     pdb: PDB<'a, S>,
     sections: Vec<Section>,
+    symbol_index: SymbolIndex,
     context_map: HashMap<u32, Context>,
     unloaded_image: Vec<u8>,
     loaded_image: Vec<u8>,
@@ -61,12 +70,14 @@ impl PdbMetadata<'_, File> {
         let mut metadata = PdbMetadata {
             pdb,
             sections,
+            symbol_index: SymbolIndex::default(),
             context_map,
             unloaded_image,
             loaded_image,
         };
 
         metadata.fill_sections()?;
+        metadata.symbol_index = SymbolIndex::new(&metadata.sections);
 
         Ok(metadata)
     }
@@ -85,12 +96,14 @@ impl<'a> PdbMetadata<'a, Cursor<&'a [u8]>> {
         let mut metadata = PdbMetadata {
             pdb,
             sections,
+            symbol_index: SymbolIndex::default(),
             context_map,
             unloaded_image,
             loaded_image,
         };
 
         metadata.fill_sections()?;
+        metadata.symbol_index = SymbolIndex::new(&metadata.sections);
 
         Ok(metadata)
     }
@@ -102,80 +115,31 @@ impl<'a, S: Source<'a> + 'a> PdbMetadata<'a, S> {
         &mut self,
         rule: &config::Rule,
     ) -> Result<Vec<(file::ImageValidationEntryHeader, Vec<u8>)>> {
-        let symbol = self.find_symbol(&rule.symbol).clone();
-        self.validate_rule(&symbol, rule)?;
-
-        let mut ret = Vec::new();
-
-        let type_information = &mut self.pdb.type_information()?;
-        let element_count = symbol.type_info.element_count();
-
-        for i in 0..element_count {
-            if !rule
-                .array
-                .as_ref()
-                .and_then(|arr| arr.index.clone())
-                .unwrap_or(i..=i)
-                .contains(&i)
-            {
-                continue;
-            }
-
-            let mut offset = 0;
-            let mut size = symbol.type_info.element_size();
-
-            if let Some(field) = &rule.field {
-                let (field_offset, total_size) = Symbol::find_field_offset_and_size(
-                    type_information,
-                    &symbol.type_info.type_id().unwrap(),
-                    field,
-                    symbol.name(),
-                )?;
-                offset += field_offset;
-                size = total_size;
-            }
-
-            let validation_type = if rule
-                .array
-                .as_ref()
-                .is_some_and(|a| a.sentinel && i == element_count - 1)
-            {
-                file::ValidationType::Content {
-                    content: vec![0; size as usize],
-                }
-            } else {
-                self.build_validation_type(&rule.validation)?
-            };
-
-            let entry = file::ImageValidationEntryHeader {
-                offset: symbol.address(i) + offset,
-                size,
-                validation_type,
-                ..Default::default()
-            };
+        self.build_entries_for_rules(std::slice::from_ref(rule))
+    }
 
-            let default = self.loaded_image
-                [entry.offset as usize..(entry.offset + entry.size) as usize]
-                .to_vec();
+    /// Creates the ImageValidationEntryHeaders for all of the given rules.
+    ///
+    /// The type stream is indexed once and shared by all rules, which are evaluated in parallel. The entries are
+    /// returned in rule order, so the result is the same as calling [Self::build_entries] for each rule in turn.
+    pub fn build_entries_for_rules(
+        &mut self,
+        rules: &[config::Rule],
+    ) -> Result<Vec<(file::ImageValidationEntryHeader, Vec<u8>)>> {
+        let info = self.pdb.type_information()?;
+        let types = TypeTable::new(&info)?;
+        let builder = self.rule_builder(&types);
+        let built = rules
+            .par_iter()
+            .map(|rule| builder.build_entries(rule))
+            .collect::<Vec<_>>();
 
-            let mut name = rule.symbol.clone();
-            if element_count > 1 {
-                name += format!("[{}]", i).as_str();
-            }
-            if let Some(field) = &rule.field {
-                name += format!(".{}", field).as_str();
+        let mut ret = Vec::new();
+        for entries in built {
+            for (entry, default, context) in entries? {
+                self.context_map.insert(entry.offset, context);
+                ret.push((entry, default));
             }
-            self.context_map.insert(
-                entry.offset,
-                Context::new(
-                    name,
-                    rule.reviewers.clone(),
-                    rule.last_reviewed.clone(),
-                    rule.remarks.clone(),
-                ),
-            );
-
-            ret.push((entry, default));
         }
 
         Ok(ret)
@@ -214,13 +178,17 @@ impl<'a, S: Source<'a> + 'a> PdbMetadata<'a, S> {
     }
 
     /// Provides the general symbol information for the symbol containing the given address.
+    ///
+    /// If multiple symbols contain the address, the first symbol in section order is returned.
     pub fn symbol_from_address(&self, address: &u32) -> Option<&Symbol> {
-        self.sections
-            .iter()
-            .flat_map(|section| section.symbols.iter())
-            .find(|symbol| {
-                (symbol.address..symbol.address + symbol.type_info.total_size()).contains(address)
-            })
+        self.symbol_index
+            .symbol_at(*address)
+            .map(|location| self.symbol(location))
+    }
+
+    /// Returns the first address at or after the given address that is contained by a symbol.
+    pub fn next_symbol_address(&self, address: &u32) -> Option<u32> {
+        self.symbol_index.next_covered_address(*address)
     }
 
     /// Returns the context associated with the given address, if any.
@@ -230,8 +198,14 @@ impl<'a, S: Source<'a> + 'a> PdbMetadata<'a, S> {
 
     pub fn symbol_fields(&mut self, symbol: &str) -> Option<Vec<String>> {
         let info = self.pdb.type_information().ok()?;
+        let types = TypeTable::new(&info).ok()?;
+        self.class_fields(&types, symbol)
+    }
+
+    /// Returns the names of the fields of the given symbol, if it is a class.
+    fn class_fields(&self, types: &TypeTable, symbol: &str) -> Option<Vec<String>> {
         let symbol = self.find_symbol(symbol);
-        let data = TypeInfo::find_type(&info, symbol.type_info.type_id()?).ok()?;
+        let data = types.find(symbol.type_info.type_id()?).ok()?;
 
         // Get the class, return None if it is not a class.
         let Some(pdb::TypeData::Class(class)) = data.parse().ok() else {
@@ -239,7 +213,7 @@ impl<'a, S: Source<'a> + 'a> PdbMetadata<'a, S> {
         };
 
         // Get the fields of the class, return None if there are no fields.
-        let fields = TypeInfo::find_type(&info, class.fields?).ok()?;
+        let fields = types.find(class.fields?).ok()?;
         let Some(pdb::TypeData::FieldList(data)) = fields.parse().ok() else {
             return None;
         };
@@ -263,106 +237,24 @@ impl<'a, S: Source<'a> + 'a> PdbMetadata<'a, S> {
         Some((offset / symbol.type_info.element_size()) as usize)
     }
 
-    fn validate_rule(&mut self, symbol: &Symbol, rule: &crate::config::Rule) -> Result<()> {
-        // If the rule is a content rule, make sure that the content size matches the symbol size.
-        if let config::Validation::Content { content } = &rule.validation {
-            let size = match &rule.field {
-                Some(field) => {
-                    let (_, size) = Symbol::find_field_offset_and_size(
-                        &self.pdb.type_information()?,
-                        &symbol.type_info.type_id().unwrap(),
-                        field,
-                        symbol.name(),
-                    )?;
-                    size
-                }
-                None => symbol.type_info.element_size(),
-            };
-
-            if content.len() != size as usize {
-                let name = if let Some(field) = &rule.field {
-                    format!("{}.{}", symbol.name(), field)
-                } else {
-                    symbol.name().to_string()
-                };
-                return Err(anyhow::anyhow!(
-                    "Invalid Rule Configuration: Symbol {}: Content size {} does not match symbol size {}.",
-                    name,
-                    content.len(),
-                    size
-                ));
-            }
-        }
-
-        let element_count = symbol.type_info.element_count();
-
-        if element_count == 1 && rule.array.is_some() {
-            return Err(anyhow!(
-                "Symbol {} is not an array, but array configuration was provided.",
-                symbol.name()
-            ));
-        }
-
-        if let Some(array) = &rule.array {
-            if array.index.is_some() && array.sentinel {
-                return Err(
-                    anyhow::anyhow!("Invalid Rule Configuration: Symbol {}: Array configuration `sentinel` and `index` cannot be combined.", symbol.name)
-                );
-            }
-
-            if let Some(index) = &array.index {
-                if index.end() >= &element_count {
-                    return Err(
-                        anyhow::anyhow!("Invalid Rule Configuration: Symbol {}: Array index {:#?} is out of bounds.", symbol.name, index)
-                    );
-                }
-            }
-        }
-
-        Ok(())
+    /// Returns the symbol with the given name from the PDB file.
+    fn find_symbol(&self, symbol: &str) -> &Symbol {
+        self.symbol_index.find(&self.sections, symbol)
     }
 
-    fn build_validation_type(
-        &self,
-        validation: &crate::config::Validation,
-    ) -> Result<file::ValidationType> {
-        use config::Validation;
-        use file::ValidationType;
-        match validation {
-            Validation::None => Ok(ValidationType::None),
-            Validation::NonZero => Ok(ValidationType::NonZero),
-            Validation::Content { content } => Ok(ValidationType::Content {
-                content: content.clone(),
-            }),
-            Validation::MemAttr {
-                memory_size,
-                must_have,
-                must_not_have,
-            } => Ok(ValidationType::MemAttr {
-                memory_size: *memory_size,
-                must_have: *must_have,
-                must_not_have: *must_not_have,
-            }),
-            Validation::Ref { reference } => Ok(ValidationType::Ref {
-                address: self.find_symbol(reference).address,
-            }),
-            Validation::Pointer { in_mseg } => Ok(ValidationType::Pointer { in_mseg: *in_mseg }),
-            Validation::Guid { guid } => Ok(ValidationType::Content {
-                content: guid.as_bytes().to_vec(),
-            }),
+    /// Returns a [RuleBuilder] over this metadata and the given type table.
+    fn rule_builder<'m>(&'m self, types: &'m TypeTable<'m>) -> RuleBuilder<'m> {
+        RuleBuilder {
+            sections: &self.sections,
+            symbol_index: &self.symbol_index,
+            loaded_image: &self.loaded_image,
+            types,
         }
     }
 
-    /// Returns the symbol with the given name from the PDB file.
-    fn find_symbol(&self, symbol: &str) -> &Symbol {
-        self.sections
-            .iter()
-            .flat_map(|section| section.symbols.iter())
-            .filter(|s| s.name == symbol)
-            // We may find multiple symbols; typically the actual symbol and a label. This filters to return the
-            // actual symbol if we happen to have found both.
-            .max_by_key(|s| s.type_info.element_type.unwrap_or(TypeIndex(0)).0)
-            .unwrap_or_else(|| panic!("Symbol {} not found in PDB file.", symbol))
+    /// Returns the symbol at the given location in [Self::sections].
+    fn symbol(&self, (section, index): SymbolLocation) -> &Symbol {
+        &self.sections[section].symbols[index]
     }
 
     /// Returns the sections in the PDB file in the custom format.
@@ -388,6 +280,7 @@ impl<'a, S: Source<'a> + 'a> PdbMetadata<'a, S> {
     fn fill_sections(&mut self) -> Result<()> {
         let address_map = self.pdb.address_map()?;
         let type_information = self.pdb.type_information()?;
+        let types = TypeTable::new(&type_information)?;
 
         let symbol_table = self.pdb.global_symbols()?;
         let mut symbols = symbol_table.iter();
@@ -395,33 +288,28 @@ impl<'a, S: Source<'a> + 'a> PdbMetadata<'a, S> {
         let debug_information = self.pdb.debug_information()?;
         let mut modules = debug_information.modules()?;
 
+        // Sections do not overlap, so sorting them by start address allows a binary search for
+        // the section containing each symbol.
+        let mut by_start = (0..self.sections.len()).collect::<Vec<_>>();
+        by_start.sort_by_key(|&i| self.sections[i].range.start);
+
         while let Some(module) = modules.next()? {
             let module_info = self.pdb.module_info(&module)?.unwrap();
             let mut symbols = module_info.symbols()?;
             while let Some(symbol) = symbols.next()? {
-                if let Some(symbol) =
-                    Symbol::from_pdb_symbol(symbol, &address_map, &type_information)?
-                {
-                    if let Some(section) = self
-                        .sections
-                        .iter_mut()
-                        .find(|section| section.range.contains(&symbol.address))
+                if let Some(symbol) = Symbol::from_pdb_symbol(symbol, &address_map, &types)? {
+                    if let Some(i) = Self::section_index(&self.sections, &by_start, symbol.address)
                     {
-                        section.symbols.push(symbol);
+                        self.sections[i].symbols.push(symbol);
                     }
                 }
             }
         }
 
         while let Some(symbol) = symbols.next()? {
-            if let Some(symbol) = Symbol::from_pdb_symbol(symbol, &address_map, &type_information)?
-            {
-                if let Some(section) = self
-                    .sections
-                    .iter_mut()
-                    .find(|section| section.range.contains(&symbol.address))
-                {
-                    section.symbols.push(symbol);
+            if let Some(symbol) = Symbol::from_pdb_symbol(symbol, &address_map, &types)? {
+                if let Some(i) = Self::section_index(&self.sections, &by_start, symbol.address) {
+                    self.sections[i].symbols.push(symbol);
                 }
             }
         }
@@ -429,6 +317,16 @@ impl<'a, S: Source<'a> + 'a> PdbMetadata<'a, S> {
         Ok(())
     }
 
+    /// Returns the index of the section containing the given address, using `by_start`, the section indices
+    /// sorted by start address.
+    fn section_index(sections: &[Section], by_start: &[usize], address: u32) -> Option<usize> {
+        let i = by_start.partition_point(|&i| sections[i].range.end <= address);
+        by_start
+            .get(i)
+            .copied()
+            .filter(|&i| sections[i].range.contains(&address))
+    }
+
     fn load_image(image: &[u8]) -> Result<Vec<u8>> {
         let pe = goblin::pe::PE::parse(image)?;
         let optional_header = pe
@@ -502,11 +400,13 @@ impl<'a, S: Source<'a> + 'a> PdbMetadata<'a, S> {
     ) -> Result<Vec<(file::ImageValidationEntryHeader, Vec<u8>)>> {
         let mut ret = Vec::new();
         let symbols = report.segments(|s| !s.covered() && !s.symbol().is_empty());
+        let info = self.pdb.type_information()?;
+        let types = TypeTable::new(&info)?;
 
         // For each symbol that is not covered, if that symbol is a class and all fields are covered, then the missing
         // segment must be padding between fields, so we can add an entry for it.
         for uncovered in symbols {
-            if let Some(fields) = self.symbol_fields(uncovered.symbol()) {
+            if let Some(fields) = self.class_fields(&types, uncovered.symbol()) {
                 // We must also consider that the symbol is an array where the elements are the underlying class. In
                 // This case, we need to check all fields for the specific index are covered before we can properly add
                 // any padding.
@@ -539,12 +439,321 @@ impl<'a, S: Source<'a> + 'a> PdbMetadata<'a, S> {
     }
 }
 
+/// An entry built from a rule, with its default value and the context of the rule.
+type BuiltEntry = (file::ImageValidationEntryHeader, Vec<u8>, Context);
+
+/// Converts rules into aux entries.
+///
+/// Only holds shared references to data that does not change once [PdbMetadata] is built, so rules can be
+/// evaluated from multiple threads.
+struct RuleBuilder<'m> {
+    sections: &'m [Section],
+    symbol_index: &'m SymbolIndex,
+    loaded_image: &'m [u8],
+    types: &'m TypeTable<'m>,
+}
+
+impl RuleBuilder<'_> {
+    /// Creates the entries for the given rule, along with their default values and context.
+    fn build_entries(&self, rule: &config::Rule) -> Result<Vec<BuiltEntry>> {
+        let symbol = self.find_symbol(&rule.symbol);
+        self.validate_rule(symbol, rule)?;
+
+        let mut ret = Vec::new();
+
+        let element_count = symbol.type_info.element_count();
+
+        for i in 0..element_count {
+            if !rule
+                .array
+                .as_ref()
+                .and_then(|arr| arr.index.clone())
+                .unwrap_or(i..=i)
+                .contains(&i)
+            {
+                continue;
+            }
+
+            let mut offset = 0;
+            let mut size = symbol.type_info.element_size();
+
+            if let Some(field) = &rule.field {
+                let (field_offset, total_size) = Symbol::find_field_offset_and_size(
+                    self.types,
+                    &symbol.type_info.type_id().unwrap(),
+                    field,
+                    symbol.name(),
+                )?;
+                offset += field_offset;
+                size = total_size;
+            }
+
+            let validation_type = if rule
+                .array
+                .as_ref()
+                .is_some_and(|a| a.sentinel && i == element_count - 1)
+            {
+                file::ValidationType::Content {
+                    content: vec![0; size as usize],
+                }
+            } else {
+                self.build_validation_type(&rule.validation)?
+            };
+
+            let entry = file::ImageValidationEntryHeader {
+                offset: symbol.address(i) + offset,
+                size,
+                validation_type,
+                ..Default::default()
+            };
+
+            let default = self.loaded_image
+                [entry.offset as usize..(entry.offset + entry.size) as usize]
+                .to_vec();
+
+            let mut name = rule.symbol.clone();
+            if element_count > 1 {
+                name += format!("[{}]", i).as_str();
+            }
+            if let Some(field) = &rule.field {
+                name += format!(".{}", field).as_str();
+            }
+            let context = Context::new(
+                name,
+                rule.reviewers.clone(),
+                rule.last_reviewed.clone(),
+                rule.remarks.clone(),
+            );
+
+            ret.push((entry, default, context));
+        }
+
+        Ok(ret)
+    }
+
+    /// Returns the symbol with the given name from the PDB file.
+    fn find_symbol(&self, symbol: &str) -> &Symbol {
+        self.symbol_index.find(self.sections, symbol)
+    }
+
+    fn validate_rule(&self, symbol: &Symbol, rule: &crate::config::Rule) -> Result<()> {
+        // If the rule is a content rule, make sure that the content size matches the symbol size.
+        if let config::Validation::Content { content } = &rule.validation {
+            let size = match &rule.field {
+                Some(field) => {
+                    let (_, size) = Symbol::find_field_offset_and_size(
+                        self.types,
+                        &symbol.type_info.type_id().unwrap(),
+                        field,
+                        symbol.name(),
+                    )?;
+                    size
+                }
+                None => symbol.type_info.element_size(),
+            };
+
+            if content.len() != size as usize {
+                let name = if let Some(field) = &rule.field {
+                    format!("{}.{}", symbol.name(), field)
+                } else {
+                    symbol.name().to_string()
+                };
+                return Err(anyhow::anyhow!(
+                    "Invalid Rule Configuration: Symbol {}: Content size {} does not match symbol size {}.",
+                    name,
+                    content.len(),
+                    size
+                ));
+            }
+        }
+
+        let element_count = symbol.type_info.element_count();
+
+        if element_count == 1 && rule.array.is_some() {
+            return Err(anyhow!(
+                "Symbol {} is not an array, but array configuration was provided.",
+                symbol.name()
+            ));
+        }
+
+        if let Some(array) = &rule.array {
+            if array.index.is_some() && array.sentinel {
+                return Err(
+                    anyhow::anyhow!("Invalid Rule Configuration: Symbol {}: Array configuration `sentinel` and `index` cannot be combined.", symbol.name)
+                );
+            }
+
+            if let Some(index) = &array.index {
+                if index.end() >= &element_count {
+                    return Err(
+                        anyhow::anyhow!("Invalid Rule Configuration: Symbol {}: Array index {:#?} is out of bounds.", symbol.name, index)
+                    );
+                }
+            }
+        }
+
+        Ok(())
+    }
+
+    fn build_validation_type(
+        &self,
+        validation: &crate::config::Validation,
+    ) -> Result<file::ValidationType> {
+        use config::Validation;
+        use file::ValidationType;
+        match validation {
+            Validation::None => Ok(ValidationType::None),
+            Validation::NonZero => Ok(ValidationType::NonZero),
+            Validation::Content { content } => Ok(ValidationType::Content {
+                content: content.clone(),
+            }),
+            Validation::MemAttr {
+                memory_size,
+                must_have,
+                must_not_have,
+            } => Ok(ValidationType::MemAttr {
+                memory_size: *memory_size,
+                must_have: *must_have,
+                must_not_have: *must_not_have,
+            }),
+            Validation::Ref { reference } => Ok(ValidationType::Ref {
+                address: self.find_symbol(reference).address,
+            }),
+            Validation::Pointer { in_mseg } => Ok(ValidationType::Pointer { in_mseg: *in_mseg }),
+            Validation::Guid { guid } => Ok(ValidationType::Content {
+                content: guid.as_bytes().to_vec(),
+            }),
+        }
+    }
+}
+
 pub struct Section {
     pub name: String,
     range: Range<u32>,
     pub symbols: Vec<Symbol>,
 }
 
+/// The location of a symbol as (section index, symbol index) in [PdbMetadata::sections].
+type SymbolLocation = (usize, usize);
+
+/// Lookup tables over the symbols of all sections, built once after the sections are filled.
+#[derive(Default)]
+struct SymbolIndex {
+    /// Symbol name to the symbol returned for that name.
+    by_name: HashMap<String, SymbolLocation>,
+    /// Disjoint address ranges sorted by start address. Each range is owned by the first symbol, in section
+    /// order, that contains it.
+    by_address: Vec<(Range<u32>, SymbolLocation)>,
+}
+
+impl SymbolIndex {
+    fn new(sections: &[Section]) -> Self {
+        let mut by_name = HashMap::<String, SymbolLocation>::new();
+        let mut locations = Vec::new();
+        let mut events = Vec::new();
+
+        for (s, section) in sections.iter().enumerate() {
+            for (i, symbol) in section.symbols.iter().enumerate() {
+                // We may find multiple symbols with the same name; typically the actual symbol and a label. Prefer
+                // the actual symbol, and the last one found if there is still a tie.
+                match by_name.entry(symbol.name.clone()) {
+                    Entry::Occupied(mut entry) => {
+                        let (cs, ci) = *entry.get();
+                        if Self::name_priority(symbol)
+                            >= Self::name_priority(&sections[cs].symbols[ci])
+                        {
+                            entry.insert((s, i));
+                        }
+                    }
+                    Entry::Vacant(entry) => {
+                        entry.insert((s, i));
+                    }
+                }
+
+                let end = symbol.address.saturating_add(symbol.size());
+                if end > symbol.address {
+                    let order = locations.len();
+                    locations.push((s, i));
+                    events.push((symbol.address, true, order));
+                    events.push((end, false, order));
+                }
+            }
+        }
+
+        // Sweep over the start and end addresses, tracking the symbols that contain the current address. The
+        // symbol that comes first in section order owns the range until the next event.
+        events.sort_unstable_by_key(|&(address, _, _)| address);
+        let mut by_address: Vec<(Range<u32>, SymbolLocation)> = Vec::new();
+        let mut active = BTreeSet::new();
+        let mut idx = 0;
+        while idx < events.len() {
+            let address = events[idx].0;
+            while idx < events.len() && events[idx].0 == address {
+                let (_, start, order) = events[idx];
+                if start {
+                    active.insert(order);
+                } else {
+                    active.remove(&order);
+                }
+                idx += 1;
+            }
+
+            let (Some(&owner), Some(&(next, _, _))) = (active.first(), events.get(idx)) else {
+                continue;
+            };
+            let location = locations[owner];
+            match by_address.last_mut() {
+                Some((range, last)) if range.end == address && *last == location => {
+                    range.end = next
+                }
+                _ => by_address.push((address..next, location)),
+            }
+        }
+
+        SymbolIndex {
+            by_name,
+            by_address,
+        }
+    }
+
+    fn name_priority(symbol: &Symbol) -> u32 {
+        symbol.type_info.element_type.unwrap_or(TypeIndex(0)).0
+    }
+
+    /// Returns the location of the symbol with the given name.
+    fn symbol_named(&self, name: &str) -> Option<SymbolLocation> {
+        self.by_name.get(name).copied()
+    }
+
+    /// Returns the symbol with the given name from the given sections.
+    fn find<'s>(&self, sections: &'s [Section], name: &str) -> &'s Symbol {
+        self.symbol_named(name)
+            .map(|(section, index)| &sections[section].symbols[index])
+            .unwrap_or_else(|| panic!("Symbol {} not found in PDB file.", name))
+    }
+
+    /// Returns the location of the symbol that contains the given address.
+    fn symbol_at(&self, address: u32) -> Option<SymbolLocation> {
+        let i = self
+            .by_address
+            .partition_point(|(range, _)| range.end <= address);
+        self.by_address
+            .get(i)
+            .filter(|(range, _)| range.contains(&address))
+            .map(|(_, location)| *location)
+    }
+
+    /// Returns the first address at or after the given address that is contained by a symbol.
+    fn next_covered_address(&self, address: u32) -> Option<u32> {
+        let i = self
+            .by_address
+            .partition_point(|(range, _)| range.end <= address);
+        self.by_address
+            .get(i)
+            .map(|(range, _)| range.start.max(address))
+    }
+}
+
 #[derive(Debug, Clone)]
 pub struct Symbol {
     pub address: u32,
@@ -564,7 +773,7 @@ impl Symbol {
     fn from_pdb_symbol(
         symbol: pdb::Symbol<'_>,
         address_map: &AddressMap<'_>,
-        type_information: &TypeInformation<'_>,
+        type_information: &TypeTable,
     ) -> Result<Option<Self>> {
         // let address_map = pdb.address_map()?;
         // let type_information = pdb.type_information()?;
@@ -600,7 +809,7 @@ impl Symbol {
     fn from_data(
         symbol: DataSymbol<'_>,
         address_map: &AddressMap<'_>,
-        type_info: &TypeInformation,
+        type_info: &TypeTable,
     ) -> Result<Self> {
         let address = symbol.offset.to_rva(address_map).unwrap_or_default().0;
         let type_info = TypeInfo::from_type_index(type_info, symbol.type_index)?;
@@ -639,7 +848,7 @@ impl Symbol {
 
     /// Returns the offset and size of a field in a class.
     fn find_field_offset_and_size(
-        info: &TypeInformation,
+        info: &TypeTable,
         id: &TypeIndex,
         attribute: &str,
         symbol: &str,
@@ -647,12 +856,10 @@ impl Symbol {
         let mut parts = attribute.splitn(2, '.');
         let attribute = parts.next().unwrap_or("");
         let remaining = parts.next().unwrap_or("");
-        match TypeInfo::find_type(info, *id)?.parse()? {
+        match info.find(*id)?.parse()? {
             TypeData::Class(class) => {
                 if let Some(fields) = class.fields {
-                    if let pdb::TypeData::FieldList(fields) =
-                        TypeInfo::find_type(info, fields)?.parse()?
-                    {
+                    if let pdb::TypeData::FieldList(fields) = info.find(fields)?.parse()? {
                         for field in fields.fields {
                             if let TypeData::Member(member) = field {
                                 if member.name.to_string() == attribute {
@@ -698,6 +905,64 @@ impl Symbol {
     }
 }
 
+/// An index over the type stream of the PDB file, built once so that type lookups do not rescan the stream.
+///
+/// The table only borrows the type stream, so it can be shared by threads evaluating rules.
+pub struct TypeTable<'t> {
+    finder: TypeFinder<'t>,
+    /// The first class with a non-zero size for each class name.
+    complete_classes: HashMap<String, TypeIndex>,
+}
+
+impl<'t> TypeTable<'t> {
+    /// Indexes every type in the given type stream.
+    pub fn new(info: &'t TypeInformation<'_>) -> Result<Self> {
+        let mut iter = info.iter();
+        let mut finder = info.finder();
+        let mut complete_classes = HashMap::new();
+
+        while let Some(item) = iter.next()? {
+            finder.update(&iter);
+            if let Ok(TypeData::Class(class)) = item.parse() {
+                if class.size != 0 {
+                    complete_classes
+                        .entry(class.name.to_string().to_string())
+                        .or_insert(item.index());
+                }
+            }
+        }
+
+        Ok(TypeTable {
+            finder,
+            complete_classes,
+        })
+    }
+
+    /// Returns a type using the type index. If the type is a class with size 0, it will
+    /// return the shadow class with the real information instead.
+    pub fn find(&self, index: TypeIndex) -> Result<Item<'t, TypeIndex>> {
+        let data = self.finder.find(index)?;
+
+        // Return the item if it is anything other than class, and only
+        // if the class size is not zero.
+        match data.parse()? {
+            TypeData::Class(class) if class.size == 0 => {
+                let class_name = class.name.to_string().to_string();
+                match self.complete_classes.get(&class_name) {
+                    Some(index) => Ok(self.finder.find(*index)?),
+                    None => Err(anyhow!("Symbol {} was found, but size was 0", class_name)),
+                }
+            }
+            _ => Ok(data),
+        }
+    }
+
+    /// Returns the highest type index in the table.
+    pub fn max_index(&self) -> TypeIndex {
+        self.finder.max_index()
+    }
+}
+
 #[derive(Default, Clone, Copy)]
 /// A struct that represents the type information of a symbol.
 pub struct TypeInfo {
@@ -764,16 +1029,12 @@ impl TypeInfo {
     }
 
     /// Creates a new TypeInfo from the given type index.
-    pub fn from_type_index(info: &TypeInformation, index: TypeIndex) -> Result<Self> {
-        Self::from_type_data(info, Self::find_type(info, index)?.parse()?, index)
+    pub fn from_type_index(info: &TypeTable, index: TypeIndex) -> Result<Self> {
+        Self::from_type_data(info, info.find(index)?.parse()?, index)
     }
 
     /// Creates a new TypeInfo from the given type data.
-    pub fn from_type_data(
-        info: &TypeInformation,
-        data: TypeData,
-        index: TypeIndex,
-    ) -> Result<Self> {
+    pub fn from_type_data(info: &TypeTable, data: TypeData, index: TypeIndex) -> Result<Self> {
         Ok(match data {
             TypeData::Primitive(prim) => {
                 if prim.indirection.is_some() {
@@ -836,53 +1097,6 @@ impl TypeInfo {
         })
     }
 
-    /// Returns a type using the type index. If the type is a class with size 0, it will
-    /// check for a shadow class with the real information, returning that instead.
-    fn find_type<'a>(info: &'a TypeInformation, index: TypeIndex) -> Result<Item<'a, TypeIndex>> {
-        let mut iter = info.iter();
-        let mut finder = info.finder();
-
-        while (iter.next()?).is_some() {
-            finder.update(&iter)
-        }
-
-        let data = finder.find(index)?;
-        let item = data.parse()?;
-
-        // Return the item if it is anything other than class, and only
-        // if the class size is not zero.
-        let class_name;
-        if let TypeData::Class(d) = item {
-            if d.size != 0 {
-                return Ok(data);
-            }
-            class_name = d.name.to_string().to_string();
-        } else {
-            return Ok(data);
-        }
-
-        // The type was a class and size 0, so it should have a shadow class
-        // with the real information.
-        let mut iter = info.iter();
-        let item = iter.find(|item| {
-            let item = item.parse()?;
-            if let Some(name) = item.name() {
-                if name.to_string() == class_name {
-                    if let TypeData::Class(data) = item {
-                        if data.size != 0 {
-                            return Ok(true);
-                        }
-                    }
-                }
-            }
-            Ok(false)
-        });
-        if let Ok(Some(item)) = item {
-            return Ok(item);
-        }
-        Err(anyhow!("Symbol {} was found, but size was 0", class_name))
-    }
-
     /// Returns the size of a primitive type in bytes.
     fn get_size_from_primitive(primitive: pdb::PrimitiveKind) -> u32 {
         match primitive {
@@ -1233,10 +1447,13 @@ mod test {
             ..Default::default()
         };
 
-        let symbol = metadata.find_symbol("mSmmCpuService").clone();
+        let info = metadata.pdb.type_information().unwrap();
+        let types = TypeTable::new(&info).unwrap();
+        let builder = metadata.rule_builder(&types);
+        let symbol = builder.find_symbol("mSmmCpuService");
 
-        metadata
-            .validate_rule(&symbol, &rule)
+        builder
+            .validate_rule(symbol, &rule)
             .unwrap_or_else(|e| panic!("Failed to validate rule: [{}]", e));
     }
 
@@ -1252,9 +1469,12 @@ mod test {
             ..Default::default()
         };
 
-        let symbol = metadata.find_symbol("mSmmCpuService").clone();
+        let info = metadata.pdb.type_information().unwrap();
+        let types = TypeTable::new(&info).unwrap();
+        let builder = metadata.rule_builder(&types);
+        let symbol = builder.find_symbol("mSmmCpuService");
 
-        match metadata.validate_rule(&symbol, &rule) {
+        match builder.validate_rule(symbol, &rule) {
             Ok(_) => panic!("Expected validation to fail"),
             Err(e) => {
                 assert!(e.to_string().contains("does not match symbol size"));
@@ -1275,10 +1495,13 @@ mod test {
             ..Default::default()
         };
 
-        let symbol = metadata.find_symbol("mUnblockedMemoryList").clone();
+        let info = metadata.pdb.type_information().unwrap();
+        let types = TypeTable::new(&info).unwrap();
+        let builder = metadata.rule_builder(&types);
+        let symbol = builder.find_symbol("mUnblockedMemoryList");
 
-        metadata
-            .validate_rule(&symbol, &rule)
+        builder
+            .validate_rule(symbol, &rule)
             .unwrap_or_else(|e| panic!("Failed to validate rule: [{}]", e));
     }
 
@@ -1295,9 +1518,12 @@ mod test {
             ..Default::default()
         };
 
-        let symbol = metadata.find_symbol("mUnblockedMemoryList").clone();
+        let info = metadata.pdb.type_information().unwrap();
+        let types = TypeTable::new(&info).unwrap();
+        let builder = metadata.rule_builder(&types);
+        let symbol = builder.find_symbol("mUnblockedMemoryList");
 
-        assert!(metadata.validate_rule(&symbol, &rule).is_err());
+        assert!(builder.validate_rule(symbol, &rule).is_err());
     }
 
     #[test]
@@ -1316,9 +1542,12 @@ mod test {
             ..Default::default()
         };
 
-        let symbol = metadata.find_symbol("mUnblockedMemoryList").clone();
+        let info = metadata.pdb.type_information().unwrap();
+        let types = TypeTable::new(&info).unwrap();
+        let builder = metadata.rule_builder(&types);
+        let symbol = builder.find_symbol("mUnblockedMemoryList");
 
-        match metadata.validate_rule(&symbol, &rule) {
+        match builder.validate_rule(symbol, &rule) {
             Ok(_) => panic!("Expected validation to fail"),
             Err(e) => {
                 assert!(e.to_string().contains("is not an array"));
@@ -1342,9 +1571,12 @@ mod test {
             ..Default::default()
         };
 
-        let symbol = metadata.find_symbol("mReservedVectorsData").clone();
+        let info = metadata.pdb.type_information().unwrap();
+        let types = TypeTable::new(&info).unwrap();
+        let builder = metadata.rule_builder(&types);
+        let symbol = builder.find_symbol("mReservedVectorsData");
 
-        match metadata.validate_rule(&symbol, &rule) {
+        match builder.validate_rule(symbol, &rule) {
             Ok(_) => panic!("Expected validation to fail"),
             Err(e) => {
                 assert!(e.to_string().contains("cannot be combined"));
@@ -1368,9 +1600,12 @@ mod test {
             ..Default::default()
         };
 
-        let symbol = metadata.find_symbol("mMmSupvPoolLists").clone();
+        let info = metadata.pdb.type_information().unwrap();
+        let types = TypeTable::new(&info).unwrap();
+        let builder = metadata.rule_builder(&types);
+        let symbol = builder.find_symbol("mMmSupvPoolLists");
 
-        match metadata.validate_rule(&symbol, &rule) {
+        match builder.validate_rule(symbol, &rule) {
             Ok(_) => panic!("Expected validation to fail"),
             Err(e) => {
                 assert!(e.to_string().contains("is out of bounds"));
@@ -1380,14 +1615,17 @@ mod test {
 
     #[test]
     fn test_build_validation_type() {
-        let metadata = build_metadata();
+        let mut metadata = build_metadata();
+        let info = metadata.pdb.type_information().unwrap();
+        let types = TypeTable::new(&info).unwrap();
+        let builder = metadata.rule_builder(&types);
 
-        let v = metadata
+        let v = builder
             .build_validation_type(&Validation::None)
             .unwrap_or_else(|e| panic!("Failed to build validation type: [{}]", e));
         assert_eq!(v, file::ValidationType::None);
 
-        let v = metadata
+        let v = builder
             .build_validation_type(&Validation::Content {
                 content: vec![0x0; 8],
             })
@@ -1399,12 +1637,12 @@ mod test {
             }
         );
 
-        let v = metadata
+        let v = builder
             .build_validation_type(&Validation::NonZero)
             .unwrap_or_else(|e| panic!("Failed to build validation type: [{}]", e));
         assert_eq!(v, file::ValidationType::NonZero);
 
-        let v = metadata
+        let v = builder
             .build_validation_type(&Validation::Guid {
                 guid: Guid::from_fields(0xffffffff, 0, 0, 0, 0, &[0, 0, 0, 0, 0, 0]),
             })
@@ -1419,7 +1657,7 @@ mod test {
             }
         );
 
-        let v = metadata
+        let v = builder
             .build_validation_type(&Validation::MemAttr {
                 memory_size: 0x1,
                 must_have: 0x2,
@@ -1435,12 +1673,12 @@ mod test {
             }
         );
 
-        let v = metadata
+        let v = builder
             .build_validation_type(&Validation::Pointer { in_mseg: true })
             .unwrap_or_else(|e| panic!("Failed to build validation type: [{}]", e));
         assert_eq!(v, file::ValidationType::Pointer { in_mseg: true });
 
-        let v = metadata
+        let v = builder
             .build_validation_type(&Validation::Ref {
                 reference: "mUnblockedMemoryList".to_string(),
             })
@@ -1519,7 +1757,8 @@ mod test {
     fn test_type_info_from_type_data_primitives() {
         // Test the TypeInfo::from_type_data method with basic primitive types
         let mut metadata = build_metadata();
-        let type_info = &metadata.pdb.type_information().unwrap();
+        let info = metadata.pdb.type_information().unwrap();
+        let type_info = &TypeTable::new(&info).unwrap();
         let index = TypeIndex(1);
 
         // Test with a primitive type (I32)
@@ -1591,10 +1830,11 @@ mod test {
     fn test_type_info_from_type_data_bitfield() {
         // Test the TypeInfo::from_type_data method with a class type
         let mut metadata = build_metadata();
-        let type_info = &metadata.pdb.type_information().unwrap();
+        let info = metadata.pdb.type_information().unwrap();
+        let type_info = &TypeTable::new(&info).unwrap();
 
         // Grab an idx we know exists, that we can use later.
-        let idx = type_info.finder().max_index();
+        let idx = type_info.max_index();
         let size = TypeInfo::from_type_index(type_info, idx)
             .unwrap()
             .total_size();
@@ -1614,10 +1854,11 @@ mod test {
     fn test_type_info_from_type_data_fieldlist() {
         // Test the TypeInfo::from_type_data method with a field list type
         let mut metadata = build_metadata();
-        let type_info = &metadata.pdb.type_information().unwrap();
+        let info = metadata.pdb.type_information().unwrap();
+        let type_info = &TypeTable::new(&info).unwrap();
 
         // Grab an idx we know exists, that we can use later.
-        let idx = type_info.finder().max_index();
+        let idx = type_info.max_index();
         let size = TypeInfo::from_type_index(type_info, idx)
             .unwrap()
             .total_size();
@@ -1645,10 +1886,11 @@ mod test {
     fn test_type_info_from_type_data_argument_list() {
         // Test the TypeInfo::from_type_data method with an argument list type
         let mut metadata = build_metadata();
-        let type_info = &metadata.pdb.type_information().unwrap();
+        let info = metadata.pdb.type_information().unwrap();
+        let type_info = &TypeTable::new(&info).unwrap();
 
         // Grab an idx we know exists, that we can use later.
-        let idx = type_info.finder().max_index();
+        let idx = type_info.max_index();
         let size = TypeInfo::from_type_index(type_info, idx)
             .unwrap()
             .total_size();
@@ -1671,7 +1913,8 @@ mod test {
             name: "".into(),
         });
         let mut metadata = build_metadata();
-        let type_info = &metadata.pdb.type_information().unwrap();
+        let info = metadata.pdb.type_information().unwrap();
+        let type_info = &TypeTable::new(&info).unwrap();
 
         let result = TypeInfo::from_type_data(type_info, data, index);
         assert!(result.is_err_and(|err| err
@@ -1696,7 +1939,8 @@ mod test {
     #[test]
     fn test_symbol_find_field_offset_and_size_simple() {
         let mut metadata = build_metadata();
-        let type_info = &metadata.pdb.type_information().unwrap();
+        let info = metadata.pdb.type_information().unwrap();
+        let type_info = &TypeTable::new(&info).unwrap();
 
         let symbol = "mRootMmiEntry";
         let field = "AllEntries";
@@ -1721,7 +1965,8 @@ mod test {
     #[test]
     fn test_symbol_find_field_offset_and_size_recurse() {
         let mut metadata = build_metadata();
-        let type_info = &metadata.pdb.type_information().unwrap();
+        let info = metadata.pdb.type_information().unwrap();
+        let type_info = &TypeTable::new(&info).unwrap();
 
         let symbol = "mRootMmiEntry";
         let field = "AllEntries.BackLink";
@@ -1748,7 +1993,8 @@ mod test {
     #[test]
     fn test_symbol_find_field_offset_and_size_not_attribute() {
         let mut metadata = build_metadata();
-        let type_info = &metadata.pdb.type_information().unwrap();
+        let info = metadata.pdb.type_information().unwrap();
+        let type_info = &TypeTable::new(&info).unwrap();
 
         let symbol = "mRootMmiEntry";
         let field = "NonExistentField";
@@ -1767,7 +2013,8 @@ mod test {
     #[test]
     fn test_symbol_find_field_offset_and_size_not_class() {
         let mut metadata = build_metadata();
-        let type_info = &metadata.pdb.type_information().unwrap();
+        let info = metadata.pdb.type_information().unwrap();
+        let type_info = &TypeTable::new(&info).unwrap();
 
         let symbol = "mMapDepth";
         let field = "AllEntries";
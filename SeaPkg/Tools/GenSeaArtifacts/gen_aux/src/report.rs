@@ -10,9 +10,10 @@ use anyhow::{anyhow, Result};
 use pdb::Source;
 use serde::Serialize;
 
-use std::cmp::Ordering;
+use std::collections::BTreeMap;
 use std::fmt::Debug;
 use std::io::Write;
+use std::ops::Bound::Excluded;
 
 use crate::file::{AuxFile, ImageValidationEntryHeader};
 use crate::metadata::PdbMetadata;
@@ -159,24 +160,29 @@ impl SectionList {
     }
 }
 
-/// A wrapper around a list of segments that allows for inserting new segments into the list.
+/// An ordered map of segments that allows for inserting new segments into the list.
+///
+/// The segments always tile the image. They are keyed by `(start, end)` so that a zero sized segment sorts before
+/// the segment that starts at the same address.
 struct SegmentList {
     size_of_image: u32,
-    segments: Vec<Segment>,
+    segments: BTreeMap<(u32, u32), Segment>,
 }
 
 impl SegmentList {
     /// Creates a new segment list with a single segment that spans the entire image.
     fn new(size: u32) -> Self {
-        SegmentList {
+        let mut list = SegmentList {
             size_of_image: size,
-            segments: vec![Segment::new(0, size, false, "".to_string())],
-        }
+            segments: BTreeMap::new(),
+        };
+        list.push(Segment::new(0, size, false, "".to_string()));
+        list
     }
 
     /// Consumes the list and returns the inner vector of segments.
     pub fn into_inner(self) -> Vec<Segment> {
-        self.segments
+        self.segments.into_values().collect()
     }
 
     fn get_size_by_reason(&self, reason: &str) -> u32 {
@@ -185,7 +191,7 @@ impl SegmentList {
 
     fn get_size(&self, filter: impl Fn(&&Segment) -> bool) -> u32 {
         self.segments
-            .iter()
+            .values()
             .filter(filter)
             .map(|seg| seg._end - seg._start)
             .sum()
@@ -311,79 +317,107 @@ impl SegmentList {
     }
 
     /// Adds a list of image validation entries as covered segments.
+    ///
+    /// Entries that overlap an entry already added are reported with a warning, and the range they share is
+    /// attributed to the later entry.
     pub fn add_segments_from_aux_entries<'a, S: Source<'a> + 'a>(
         &mut self,
         entries: &[ImageValidationEntryHeader],
         metadata: &mut PdbMetadata<'a, S>,
     ) -> Result<()> {
         for entry in entries.iter() {
-            self.insert(Segment::from_entry(entry, metadata))?;
+            let new = Segment::from_entry(entry, metadata);
+            for seg in self
+                .overlapped(new._start, new._end)
+                .into_iter()
+                .map(|key| &self.segments[&key])
+                .filter(|seg| seg.reason.starts_with("Validation Rule"))
+            {
+                log::warn!(
+                    "Validation entry {:?} overlaps validation entry {:?}.",
+                    new,
+                    seg
+                );
+            }
+            self.insert(new)?;
         }
         Ok(())
     }
 
-    /// Inserts a new segment into the list, splitting any existing segments as necessary.
+    /// Inserts a new segment into the list, splitting or replacing any existing segments it overlaps.
     fn insert(&mut self, new: Segment) -> Result<()> {
-        for i in 0..self.segments.len() {
-            let seg = self.segments[i].clone();
-            match (new._start.cmp(&seg._start), new._end.cmp(&seg._end)) {
-                // The segments are exactly the same
-                (Ordering::Equal, Ordering::Equal) => {
-                    self.segments[i] = new;
-                    return Ok(());
-                }
-                // The new segment is entirely contained within the old segment
-                (Ordering::Greater, Ordering::Less) => {
-                    let left =
-                        Segment::new(seg._start, new._start, seg.covered, seg.reason.clone());
-                    let right = Segment::new(new._end, seg._end, seg.covered, seg.reason.clone());
-                    self.segments[i] = left;
-                    self.segments.insert(i + 1, new);
-                    self.segments.insert(i + 2, right);
-                    return Ok(());
-                }
-                // The new and old segments start at the same address, but the new segment ends before the old segment
-                (Ordering::Equal, Ordering::Less) => {
-                    let right = Segment::new(new._end, seg._end, seg.covered, seg.reason.clone());
-                    self.segments[i] = new;
-                    self.segments.insert(i + 1, right);
-                    return Ok(());
-                }
-                // The new segment starts before the old segment, but ends at the same address
-                (Ordering::Greater, Ordering::Equal) => {
-                    let left =
-                        Segment::new(seg._start, new._start, seg.covered, seg.reason.clone());
-                    self.segments[i] = left;
-                    self.segments.insert(i + 1, new);
-                    return Ok(());
-                }
-                _ => continue,
+        let (start, end) = (new._start, new._end);
+        if start > end || end > self.size_of_image {
+            return Err(anyhow!(
+                "Segment {:?} is outside of the image (size {:#x}).",
+                new,
+                self.size_of_image
+            ));
+        }
+
+        for key in self.overlapped(start, end) {
+            let seg = self.segments.remove(&key).unwrap();
+            if seg._start < start {
+                self.push(Segment::new(
+                    seg._start,
+                    start,
+                    seg.covered,
+                    seg.reason.clone(),
+                ));
+            }
+            if seg._end > end {
+                self.push(Segment::new(end, seg._end, seg.covered, seg.reason));
             }
         }
 
-        println!("Failed to insert segment");
-        println!("This only happens if the segment to insert spans multiple existing segments.");
-        println!("Segment to insert: {:?}", new);
-        println!("Existing segments:");
-        for seg in self.segments.iter() {
-            println!("  {:?}", seg);
+        self.push(new);
+        Ok(())
+    }
+
+    /// Returns the keys of the segments that overlap `[start, end)`.
+    fn overlapped(&self, start: u32, end: u32) -> Vec<(u32, u32)> {
+        // Only the last segment that starts before the new segment can contain its start address. Every other
+        // overlapped segment starts inside the new segment. Zero sized segments at the start of the new segment
+        // are left in place.
+        let mut overlapped = self
+            .segments
+            .range(..(start, start))
+            .next_back()
+            .filter(|(_, seg)| seg._end > start)
+            .map(|(key, _)| *key)
+            .into_iter()
+            .collect::<Vec<_>>();
+        if start < end {
+            overlapped.extend(
+                self.segments
+                    .range((Excluded((start, start)), Excluded((end, end))))
+                    .map(|(key, _)| *key),
+            );
         }
-        Err(anyhow!("Failed to insert segment."))
+        overlapped
+    }
+
+    /// Adds a segment to the map, replacing any segment with the same range.
+    fn push(&mut self, segment: Segment) {
+        self.segments
+            .insert((segment._start, segment._end), segment);
     }
 
     /// Attempts to update segments that are uncovered and have no symbol name.
     ///
-    /// We must loop through each byte of each uncovered segment for three reasons:
+    /// We must walk each uncovered segment for three reasons:
     /// 1. A segment may contain multiple symbols
     /// 2. If a rule only covers part of a symbol (using a field), we need to ensure all other
     ///    parts of the same symbol that are not covered have their names correctly set.
     /// 3. There may be padding between symbols for alignment purposes
+    ///
+    /// Gaps with no symbol are skipped in one step using the metadata's address index.
     pub fn update_missing_symbol_names<'a, S: Source<'a> + 'a>(
         &mut self,
         metadata: &mut PdbMetadata<'a, S>,
     ) -> Result<()> {
         let mut to_insert = Vec::new();
-        for segment in &self.segments {
+        for segment in self.segments.values() {
             if !segment.symbol.is_empty() || segment.covered {
                 continue;
             }
@@ -397,7 +431,9 @@ impl SegmentList {
                     to_insert.push(segment);
                     cur = end;
                 } else {
-                    cur += 1;
+                    cur = metadata
+                        .next_symbol_address(&cur)
+                        .map_or(segment._end, |next| std::cmp::min(next, segment._end));
                 }
             }
         }
@@ -547,6 +583,13 @@ mod tests {
     use super::*;
     use crate::{file::ImageValidationEntryHeader, metadata};
 
+    impl SegmentList {
+        /// Returns the segment at the given position in address order.
+        fn segment(&self, index: usize) -> &Segment {
+            self.segments.values().nth(index).unwrap()
+        }
+    }
+
     fn create_metadata() -> metadata::PdbMetadata<'static, Cursor<&'static [u8]>> {
         let pdb = include_bytes!("../resources/test/example.pdb");
         let efi = include_bytes!("../resources/test/example.efi");
@@ -623,31 +666,31 @@ mod tests {
             .insert(Segment::new(0x400, 0x600, true, "Test".to_string()))
             .unwrap_or_else(|_| panic!("Failed to insert segment"));
         assert_eq!(segments.segments.len(), 3);
-        assert_eq!(segments.segments[0]._start, 0x0);
-        assert_eq!(segments.segments[0]._end, 0x400);
-        assert_eq!(segments.segments[1]._start, 0x400);
-        assert_eq!(segments.segments[1]._end, 0x600);
-        assert_eq!(segments.segments[1].reason, "Test");
-        assert_eq!(segments.segments[2]._start, 0x600);
-        assert_eq!(segments.segments[2]._end, 0x1000);
+        assert_eq!(segments.segment(0)._start, 0x0);
+        assert_eq!(segments.segment(0)._end, 0x400);
+        assert_eq!(segments.segment(1)._start, 0x400);
+        assert_eq!(segments.segment(1)._end, 0x600);
+        assert_eq!(segments.segment(1).reason, "Test");
+        assert_eq!(segments.segment(2)._start, 0x600);
+        assert_eq!(segments.segment(2)._end, 0x1000);
     }
 
     #[test]
     fn test_segment_list_insert_split_exact() {
         let mut segments = SegmentList::new(0x1000);
         assert_eq!(segments.segments.len(), 1);
-        assert_eq!(segments.segments[0]._start, 0x0);
-        assert_eq!(segments.segments[0]._end, 0x1000);
-        assert!(!segments.segments[0].covered());
+        assert_eq!(segments.segment(0)._start, 0x0);
+        assert_eq!(segments.segment(0)._end, 0x1000);
+        assert!(!segments.segment(0).covered());
 
         segments
             .insert(Segment::new(0x0, 0x1000, true, "Test".to_string()))
             .unwrap_or_else(|_| panic!("Failed to insert segment"));
         assert_eq!(segments.segments.len(), 1);
-        assert_eq!(segments.segments[0]._start, 0x0);
-        assert_eq!(segments.segments[0]._end, 0x1000);
-        assert!(segments.segments[0].covered());
-        assert_eq!(segments.segments[0].reason, "Test");
+        assert_eq!(segments.segment(0)._start, 0x0);
+        assert_eq!(segments.segment(0)._end, 0x1000);
+        assert!(segments.segment(0).covered());
+        assert_eq!(segments.segment(0).reason, "Test");
     }
 
     #[test]
@@ -660,12 +703,12 @@ mod tests {
             .insert(Segment::new(0x0, 0x400, true, "Test".to_string()))
             .unwrap_or_else(|_| panic!("Failed to insert segment"));
         assert_eq!(segments.segments.len(), 2);
-        assert_eq!(segments.segments[0]._start, 0x0);
-        assert_eq!(segments.segments[0]._end, 0x400);
-        assert_eq!(segments.segments[0].reason, "Test");
-        assert!(segments.segments[0].covered());
-        assert_eq!(segments.segments[1]._start, 0x400);
-        assert_eq!(segments.segments[1]._end, 0x1000);
+        assert_eq!(segments.segment(0)._start, 0x0);
+        assert_eq!(segments.segment(0)._end, 0x400);
+        assert_eq!(segments.segment(0).reason, "Test");
+        assert!(segments.segment(0).covered());
+        assert_eq!(segments.segment(1)._start, 0x400);
+        assert_eq!(segments.segment(1)._end, 0x1000);
     }
 
     #[test]
@@ -678,12 +721,12 @@ mod tests {
             .insert(Segment::new(0x600, 0x1000, true, "Test".to_string()))
             .unwrap_or_else(|_| panic!("Failed to insert segment"));
         assert_eq!(segments.segments.len(), 2);
-        assert_eq!(segments.segments[0]._start, 0x0);
-        assert_eq!(segments.segments[0]._end, 0x600);
-        assert_eq!(segments.segments[1]._start, 0x600);
-        assert_eq!(segments.segments[1]._end, 0x1000);
-        assert_eq!(segments.segments[1].reason, "Test");
-        assert!(segments.segments[1].covered());
+        assert_eq!(segments.segment(0)._start, 0x0);
+        assert_eq!(segments.segment(0)._end, 0x600);
+        assert_eq!(segments.segment(1)._start, 0x600);
+        assert_eq!(segments.segment(1)._end, 0x1000);
+        assert_eq!(segments.segment(1).reason, "Test");
+        assert!(segments.segment(1).covered());
     }
 
     #[test]
@@ -735,12 +778,117 @@ mod tests {
             .insert(Segment::new(0x200, 0x800, true, "Test".to_string()))
             .unwrap_or_else(|_| panic!("Failed to insert segment"));
 
-        // This should panic because the segment overlaps with the existing segment
+        // A segment spanning multiple existing segments replaces the parts it overlaps
+        segments
+            .insert(Segment::new(0x100, 0x300, true, "Spanning".to_string()))
+            .unwrap_or_else(|_| panic!("Failed to insert segment"));
+        assert_eq!(segments.segments.len(), 4);
+        assert_eq!(segments.segment(0)._end, 0x100);
+        assert_eq!(segments.segment(1)._start, 0x100);
+        assert_eq!(segments.segment(1)._end, 0x300);
+        assert_eq!(segments.segment(1).reason, "Spanning");
+        assert_eq!(segments.segment(2)._start, 0x300);
+        assert_eq!(segments.segment(2)._end, 0x800);
+        assert_eq!(segments.segment(2).reason, "Test");
+        assert_eq!(segments.segment(3)._start, 0x800);
+
+        // A segment outside of the image cannot be inserted
         assert!(segments
-            .insert(Segment::new(0x100, 0x300, true, "Test".to_string()))
+            .insert(Segment::new(0x3d000, 0x3e000, true, "Test".to_string()))
             .is_err());
     }
 
+    /// The original `Vec` based insert, kept to check the interval map against.
+    fn reference_insert(segments: &mut Vec<Segment>, new: Segment) -> Result<()> {
+        use std::cmp::Ordering;
+        for i in 0..segments.len() {
+            let seg = segments[i].clone();
+            match (new._start.cmp(&seg._start), new._end.cmp(&seg._end)) {
+                (Ordering::Equal, Ordering::Equal) => {
+                    segments[i] = new;
+                    return Ok(());
+                }
+                (Ordering::Greater, Ordering::Less) => {
+                    let left =
+                        Segment::new(seg._start, new._start, seg.covered, seg.reason.clone());
+                    let right = Segment::new(new._end, seg._end, seg.covered, seg.reason.clone());
+                    segments[i] = left;
+                    segments.insert(i + 1, new);
+                    segments.insert(i + 2, right);
+                    return Ok(());
+                }
+                (Ordering::Equal, Ordering::Less) => {
+                    let right = Segment::new(new._end, seg._end, seg.covered, seg.reason.clone());
+                    segments[i] = new;
+                    segments.insert(i + 1, right);
+                    return Ok(());
+                }
+                (Ordering::Greater, Ordering::Equal) => {
+                    let left =
+                        Segment::new(seg._start, new._start, seg.covered, seg.reason.clone());
+                    segments[i] = left;
+                    segments.insert(i + 1, new);
+                    return Ok(());
+                }
+                _ => continue,
+            }
+        }
+        Err(anyhow!("Failed to insert segment."))
+    }
+
+    #[test]
+    fn test_segment_list_insert_matches_reference() {
+        const SIZE: u32 = 0x100;
+        let mut state = 0x2545_f491_4f6c_dd1du64;
+        let mut next = |bound: u32| {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            (state % bound as u64) as u32
+        };
+
+        for _ in 0..2000 {
+            let mut segments = SegmentList::new(SIZE);
+            let mut reference = vec![Segment::new(0, SIZE, false, "".to_string())];
+
+            for i in 0..32 {
+                // Half of the segments fall within an existing segment so the reference keeps up.
+                let (lo, hi) = if next(2) == 0 {
+                    let seg = &reference[next(reference.len() as u32) as usize];
+                    (seg._start, seg._end)
+                } else {
+                    (0, SIZE)
+                };
+                let start = lo + next(hi - lo);
+                let end = start + 1 + next(hi - start);
+                let mut new = Segment::new(start, end, next(2) == 0, format!("Reason {}", i));
+                new.symbol = format!("Symbol {}", next(4));
+
+                segments
+                    .insert(new.clone())
+                    .unwrap_or_else(|_| panic!("Failed to insert {:?}", new));
+
+                // The interval map must always tile the image and contain the new segment.
+                let list = segments.segments.values().collect::<Vec<_>>();
+                assert_eq!(list.first().unwrap()._start, 0);
+                assert_eq!(list.last().unwrap()._end, SIZE);
+                assert!(list.windows(2).all(|w| w[0]._end == w[1]._start));
+                assert!(list
+                    .iter()
+                    .any(|seg| seg._start == start && seg._end == end && seg.symbol == new.symbol));
+
+                // The reference cannot insert spanning segments; stop comparing once it fails.
+                if reference_insert(&mut reference, new).is_err() {
+                    break;
+                }
+                assert_eq!(
+                    serde_json::to_string(&list).unwrap(),
+                    serde_json::to_string(&reference).unwrap()
+                );
+            }
+        }
+    }
+
     #[test]
     fn test_segment_list_add_pe_header() {
         let pe = include_bytes!("../resources/test/example.efi");
@@ -757,14 +905,14 @@ mod tests {
         assert_eq!(segments.segments.len(), 3);
 
         // These values are hardcoded as we know the correct values for this test image.
-        assert_eq!(segments.segments[0].start(), 0x0);
-        assert_eq!(segments.segments[0].end(), 0x400);
+        assert_eq!(segments.segment(0).start(), 0x0);
+        assert_eq!(segments.segment(0).end(), 0x400);
 
-        assert_eq!(segments.segments[1].start(), 0x400);
-        assert_eq!(segments.segments[1].end(), 0x1000);
+        assert_eq!(segments.segment(1).start(), 0x400);
+        assert_eq!(segments.segment(1).end(), 0x1000);
 
-        assert_eq!(segments.segments[2].start(), 0x1000);
-        assert_eq!(segments.segments[2].end(), pe.len() as u32);
+        assert_eq!(segments.segment(2).start(), 0x1000);
+        assert_eq!(segments.segment(2).end(), pe.len() as u32);
     }
 
     #[test]
@@ -829,6 +977,43 @@ mod tests {
         );
     }
 
+    #[test]
+    fn test_segment_list_add_overlapping_aux_entries() {
+        let mut metadata = create_metadata();
+        let mut segments = SegmentList::new(metadata.image_size() as u32);
+        let entry = |offset, size| ImageValidationEntryHeader {
+            offset,
+            size,
+            ..Default::default()
+        };
+
+        // Adjacent entries are accepted.
+        segments
+            .add_segments_from_aux_entries(&[entry(0x1000, 8), entry(0x1008, 8)], &mut metadata)
+            .unwrap_or_else(|_| panic!("Failed to add adjacent aux entries"));
+
+        // An entry that overlaps an entry already added is accepted, wherever it falls, and the whole range
+        // stays covered.
+        for overlapping in [entry(0x1004, 8), entry(0x0FF8, 0x10), entry(0x1000, 0x10)] {
+            segments
+                .add_segments_from_aux_entries(&[overlapping], &mut metadata)
+                .unwrap_or_else(|_| panic!("Failed to add overlapping aux entry"));
+        }
+        segments
+            .add_segments_from_aux_entries(&[entry(0x2000, 8), entry(0x2004, 8)], &mut metadata)
+            .unwrap_or_else(|_| panic!("Failed to add overlapping aux entries"));
+
+        let covered = |start, end| {
+            segments
+                .segments
+                .values()
+                .filter(|seg| seg._start >= start && seg._end <= end)
+                .all(|seg| seg.covered && seg.reason.starts_with("Validation Rule"))
+        };
+        assert!(covered(0x0FF8, 0x1010));
+        assert!(covered(0x2000, 0x200C));
+    }
+
     #[test]
     fn test_segment_list_update_missing_symbol_names() {
         let mut segments = SegmentList::new(0x3d400);
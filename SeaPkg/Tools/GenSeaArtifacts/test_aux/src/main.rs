@@ -269,6 +269,12 @@ impl TestSuite {
 
     /// Runs a single test against the auxiliary file.
     fn run_test(&self, test: &ImageValidationEntryHeader, verbose: bool) -> Result<Status> {
+        // None entries may be coalesced with their neighbors when the aux file is finalized, so
+        // their header is not guaranteed to exist in the aux file. There is nothing to test anyway.
+        if test.validation_type == ValidationType::None {
+            return Ok(Status::SUCCESS);
+        }
+
         // Find the header in the aux file
         let mut bytes = vec![0; test.header_size() as usize];
         bytes.pwrite_with(test, 0, LE)?;
@@ -289,7 +295,6 @@ impl TestSuite {
         set_debug_print(verbose);
 
         Ok(match test.validation_type {
-            ValidationType::None => Status::SUCCESS,
             ValidationType::NonZero => unsafe { PeCoffImageValidationNonZero(target_image, hdr) },
             ValidationType::Content { .. } => unsafe {
                 PeCoffImageValidationContent(target_image, hdr, aux)